@@ -14,7 +14,7 @@
 namespace comm {
 
 Client::Client(std::string host_address, int port, bool debug)
-    : host_address_(host_address), port_(port), debug_(debug) {
+    : host_address_(host_address), port_(port), client_fd_(-1), debug_(debug), total_bytes_sent_(0) {
 }
 
 Client::~Client() {
@@ -131,6 +131,29 @@ void Client::RecvArray(std::array<uint32_t, 2> &array) {
     utils::Logger::TraceLog(LOCATION, "Received array: " + utils::ArrayToStr(array), this->debug_);
 }
 
+void Client::SendArray(std::array<uint32_t, 3> &array) {
+    // Send array data
+    bool is_sent = internal::SendData(this->client_fd_, reinterpret_cast<const char *>(array.data()), 3 * sizeof(uint32_t));
+    if (!is_sent) {
+        utils::Logger::FatalLog(LOCATION, "Failed to send vector data");
+        this->CloseSocket();
+        exit(EXIT_FAILURE);
+    }
+    utils::Logger::TraceLog(LOCATION, "Sent array: " + utils::ArrayToStr(array), this->debug_);
+}
+
+void Client::RecvArray(std::array<uint32_t, 3> &array) {
+    // Receive vector data
+    bool is_received = internal::RecvData(this->client_fd_, reinterpret_cast<char *>(array.data()), 3 * sizeof(uint32_t));
+    if (!is_received) {
+        utils::Logger::FatalLog(LOCATION, "Failed to receive vector data");
+        this->CloseSocket();
+        exit(EXIT_FAILURE);
+    }
+    this->total_bytes_sent_ += 3 * sizeof(uint32_t);
+    utils::Logger::TraceLog(LOCATION, "Received array: " + utils::ArrayToStr(array), this->debug_);
+}
+
 void Client::SendArray(std::array<uint32_t, 4> &array) {
     // Send array data
     bool is_sent = internal::SendData(this->client_fd_, reinterpret_cast<const char *>(array.data()), 4 * sizeof(uint32_t));
@@ -162,7 +185,7 @@ int Client::GetPortNumber() {
     return this->port_;
 }
 
-uint32_t Client::GetTotalBytesSent() const {
+uint64_t Client::GetTotalBytesSent() const {
     return this->total_bytes_sent_;
 }
 
@@ -127,6 +127,26 @@ public:
      */
     void RecvArray(std::array<uint32_t, 2> &array);
 
+    /**
+     * @brief Sends an std::array<uint32_t, 3> to the connected client.
+     *
+     * Sends the provided 'array' of type std::array<uint32_t, 3> to the connected client
+     * through the socket.
+     *
+     * @param array Reference to an std::array<uint32_t, 3> to be sent to the client.
+     */
+    void SendArray(std::array<uint32_t, 3> &array);
+
+    /**
+     * @brief Receives an std::array<uint32_t, 3> from the connected client.
+     *
+     * Receives an std::array<uint32_t, 3> from the connected client through the socket
+     * and stores it in the provided 'array'.
+     *
+     * @param array Reference to an std::array<uint32_t, 3> to store the received data.
+     */
+    void RecvArray(std::array<uint32_t, 3> &array);
+
     /**
      * @brief Sends an std::array<uint32_t, 4> to the connected client.
      *
@@ -172,7 +192,7 @@ public:
      *
      * @return An unsigned integer representing the total number of bytes sent to the server.
      */
-    uint32_t GetTotalBytesSent() const;
+    uint64_t GetTotalBytesSent() const;
 
     /**
      * @brief Clears the total number of bytes sent to the server.
@@ -186,7 +206,7 @@ private:
     int         port_;             /**< Port number used for the connection */
     int         client_fd_;        /**< File descriptor for the client socket */
     bool        debug_;            /**< Flag indicating debug mode. */
-    uint32_t    total_bytes_sent_; /**< Total number of bytes sent to the server */
+    uint64_t    total_bytes_sent_; /**< Total number of bytes sent to the server */
 };
 
 }    // namespace comm
@@ -7,14 +7,43 @@
  */
 
 #include <cstdint>
+#include <stdexcept>
+#include <thread>
 #include "comm.hpp"
 
 #include "../utils/logger.hpp"
 #include "../utils/timer.hpp"
 #include "../utils/utils.hpp"
 #include "client.hpp"
+#include "query_router.hpp"
 #include "server.hpp"
 
+namespace {
+
+constexpr uint32_t kRouterTestReplicaNum = 2;
+constexpr uint32_t kRouterTestQueryNum   = 64;
+constexpr uint32_t kRouterTestQuerySize  = 8;
+
+// A party of a replica that returns its query shares as the output shares (without the last one if truncate is set).
+void EchoParty(const int port, uint32_t &query_num, const bool truncate) {
+    comm::Server server(port, false);
+    server.Setup();
+    server.Start();
+    while (true) {
+        std::vector<uint32_t> msg;
+        server.RecvVector(msg);
+        if (msg.empty() || msg[0] == 0) {
+            break;
+        }
+        std::vector<uint32_t> out(msg.begin() + 2, msg.end() - (truncate ? 1 : 0));
+        server.SendVector(out);
+        query_num += msg[0];
+    }
+    server.CloseSocket();
+}
+
+}    // namespace
+
 namespace comm {
 namespace test {
 
@@ -23,9 +52,10 @@ bool Test_ValueComm(const CommInfo &comm_info, Server &p0, Client &p1, const boo
 bool Test_ArrayComm(const CommInfo &comm_info, Server &p0, Client &p1, const bool debug);
 bool Test_VectorComm(const CommInfo &comm_info, Server &p0, Client &p1, const bool debug);
 bool Test_CountTotalComm(const CommInfo &comm_info, Server &p0, Client &p1, const bool debug);
+bool Test_QueryRouter(const CommInfo &comm_info, const bool debug);
 
 void Test_Comm(const CommInfo &comm_info, const uint32_t mode, bool debug) {
-    std::vector<std::string> modes         = {"Comm unit tests", "Start communication", "Value communication", "Array communication", "Vector communication", "Count total communication"};
+    std::vector<std::string> modes         = {"Comm unit tests", "Start communication", "Value communication", "Array communication", "Vector communication", "Count total communication", "Query router"};
     uint32_t                 selected_mode = mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -43,6 +73,9 @@ void Test_Comm(const CommInfo &comm_info, const uint32_t mode, bool debug) {
         utils::PrintTestResult("Test_VectorComm", Test_VectorComm(comm_info, p0, p1, debug));
         utils::PrintTestResult("Test_ArrayComm", Test_ArrayComm(comm_info, p0, p1, debug));
         utils::PrintTestResult("Test_CountTotalComm", Test_CountTotalComm(comm_info, p0, p1, debug));
+        if (comm_info.party_id == 0) {
+            utils::PrintTestResult("Test_QueryRouter", Test_QueryRouter(comm_info, debug));
+        }
     } else if (selected_mode == 2) {
         utils::PrintTestResult("Test_StartComm", Test_StartComm(comm_info, p0, p1, debug));
     } else if (selected_mode == 3) {
@@ -58,6 +91,8 @@ void Test_Comm(const CommInfo &comm_info, const uint32_t mode, bool debug) {
         utils::PrintTestResult("Test_StartComm", Test_StartComm(comm_info, p0, p1, debug));
         utils::PrintTestResult("Test_ValueComm", Test_ValueComm(comm_info, p0, p1, debug));
         utils::PrintTestResult("Test_CountTotalComm", Test_CountTotalComm(comm_info, p0, p1, debug));
+    } else if (selected_mode == 7) {
+        utils::PrintTestResult("Test_QueryRouter", Test_QueryRouter(comm_info, debug));
     }
     p0.CloseSocket();
     p1.CloseSocket();
@@ -162,12 +197,12 @@ bool Test_CountTotalComm(const CommInfo &comm_info, Server &p0, Client &p1, cons
     bool result = true;
     // Test count total communication.
     if (comm_info.party_id == 0) {
-        uint32_t total_bytes = 0;
+        uint64_t total_bytes = 0;
         total_bytes          = p0.GetTotalBytesSent();
         utils::Logger::DebugLog(LOCATION, "Total bytes sent: " + std::to_string(total_bytes), debug);
         result &= (total_bytes > 0);
     } else {
-        uint32_t total_bytes = 0;
+        uint64_t total_bytes = 0;
         total_bytes          = p1.GetTotalBytesSent();
         utils::Logger::DebugLog(LOCATION, "Total bytes sent: " + std::to_string(total_bytes), debug);
         result &= (total_bytes > 0);
@@ -175,5 +210,77 @@ bool Test_CountTotalComm(const CommInfo &comm_info, Server &p0, Client &p1, cons
     return result;
 }
 
+bool Test_QueryRouter(const CommInfo &comm_info, const bool debug) {
+    bool result = true;
+
+    // Replicas of echo parties on the ports following the party port
+    std::vector<ReplicaInfo> replicas;
+    std::vector<uint32_t>    query_num(kRouterTestReplicaNum * 2, 0);
+    std::vector<std::thread> parties;
+    for (uint32_t r = 0; r < kRouterTestReplicaNum; r++) {
+        int p0_port = comm_info.port_number + 1 + 2 * r;
+        int p1_port = comm_info.port_number + 2 + 2 * r;
+        replicas.emplace_back("replica" + std::to_string(r), kDefaultAddress, p0_port, kDefaultAddress, p1_port, 0);
+        parties.emplace_back(EchoParty, p0_port, std::ref(query_num[2 * r]), false);
+        parties.emplace_back(EchoParty, p1_port, std::ref(query_num[2 * r + 1]), false);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    QueryRouter router(replicas, 4, debug);
+    router.Start();
+    std::vector<std::future<QueryShares>> futures;
+    // Queries of two lengths, which must not share a batch
+    for (uint32_t i = 0; i < kRouterTestQueryNum; i++) {
+        uint32_t              length = (i % 2 == 0) ? kRouterTestQuerySize : kRouterTestQuerySize / 2;
+        std::vector<uint32_t> q_0    = utils::CreateSequence(i, i + length);
+        std::vector<uint32_t> q_1    = utils::CreateVectorWithSameValue(i, length);
+        futures.push_back(router.Submit(0, q_0, q_1));
+    }
+    // Both shares of every query must come back from the same replica
+    for (uint32_t i = 0; i < kRouterTestQueryNum; i++) {
+        QueryShares out = futures[i].get();
+        result &= (out.first.size() == ((i % 2 == 0) ? kRouterTestQuerySize : kRouterTestQuerySize / 2)) && (out.second.size() == out.first.size());
+        for (uint32_t j = 0; j < out.first.size(); j++) {
+            result &= (out.first[j] == i + j) && (out.second[j] == i);
+        }
+    }
+    router.Stop();
+    for (auto &party : parties) {
+        party.join();
+    }
+
+    uint64_t served = 0;
+    for (uint32_t r = 0; r < kRouterTestReplicaNum; r++) {
+        utils::Logger::DebugLog(LOCATION, "Replica " + std::to_string(r) + ": " + std::to_string(router.GetServedQueryNum(r)) + " queries", debug);
+        result &= (query_num[2 * r] == query_num[2 * r + 1]) && (query_num[2 * r] == router.GetServedQueryNum(r));
+        result &= (router.GetServedQueryNum(r) > 0);
+        served += router.GetServedQueryNum(r);
+    }
+    result &= (served == kRouterTestQueryNum);
+
+    // A replica whose party 0 replies with a share missing fails the futures of the batch
+    int                      p0_port        = comm_info.port_number + 1 + 2 * kRouterTestReplicaNum;
+    int                      p1_port        = comm_info.port_number + 2 + 2 * kRouterTestReplicaNum;
+    uint32_t                 short_num_0    = 0, short_num_1 = 0;
+    std::vector<ReplicaInfo> short_replicas = {ReplicaInfo("short", kDefaultAddress, p0_port, kDefaultAddress, p1_port, 0)};
+    std::thread              short_p0(EchoParty, p0_port, std::ref(short_num_0), true);
+    std::thread              short_p1(EchoParty, p1_port, std::ref(short_num_1), false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    QueryRouter short_router(short_replicas, 4, debug);
+    short_router.Start();
+    std::future<QueryShares> failed = short_router.Submit(0, utils::CreateSequence(0, kRouterTestQuerySize), utils::CreateSequence(0, kRouterTestQuerySize));
+    try {
+        failed.get();
+        result = false;
+    } catch (const std::runtime_error &e) {
+        utils::Logger::DebugLog(LOCATION, e.what(), debug);
+    }
+    short_router.Stop();
+    short_p0.join();
+    short_p1.join();
+    result &= (short_router.GetServedQueryNum(0) == 0);
+    return result;
+}
+
 }    // namespace test
 }    // namespace comm
@@ -34,7 +34,7 @@ namespace internal {
 inline bool SendData(int fd, const char *data, size_t data_size) {
     ssize_t total_sent_bytes = 0;
     while (total_sent_bytes < static_cast<ssize_t>(data_size)) {
-        ssize_t sent_bytes = send(fd, data, data_size, 0);
+        ssize_t sent_bytes = send(fd, data + total_sent_bytes, data_size - total_sent_bytes, 0);
         if (sent_bytes <= 0) {
             std::perror("send data");
             return false;
@@ -58,7 +58,7 @@ inline bool SendData(int fd, const char *data, size_t data_size) {
 inline bool RecvData(int fd, char *buffer, size_t buffer_size) {
     ssize_t total_received_bytes = 0;
     while (total_received_bytes < static_cast<ssize_t>(buffer_size)) {
-        ssize_t received_bytes = recv(fd, buffer, buffer_size, 0);
+        ssize_t received_bytes = recv(fd, buffer + total_received_bytes, buffer_size - total_received_bytes, 0);
         if (received_bytes <= 0) {
             std::perror("receive data");
             return false;
@@ -0,0 +1,122 @@
+/**
+ * @file metrics_server.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-12
+ * @copyright Copyright (c) 2024
+ * @brief Metrics server implementation.
+ */
+
+#include "metrics_server.hpp"
+
+#include "../utils/logger.hpp"
+#include "../utils/metrics.hpp"
+
+namespace {
+
+constexpr size_t kRequestBufferSize = 1024;
+constexpr time_t kClientTimeoutSec  = 1;    // An idle or slow client is dropped after this time, so Stop() does not wait for it
+
+}    // namespace
+
+namespace comm {
+
+MetricsServer::MetricsServer(const int port, const bool debug)
+    : port_(port), server_fd_(-1), debug_(debug), is_running_(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    this->Stop();
+}
+
+void MetricsServer::Start() {
+    if (this->is_running_) {
+        return;
+    }
+
+    // Create socket
+    this->server_fd_ = socket(PF_INET, SOCK_STREAM, 0);
+    if (this->server_fd_ < 0) {
+        utils::Logger::FatalLog(LOCATION, "Failed to create metrics socket");
+        exit(EXIT_FAILURE);
+    }
+
+    // Setup socket address structure (loopback only)
+    sockaddr_in server_address;
+    memset(&server_address, 0, sizeof(server_address));
+    server_address.sin_family      = AF_INET;
+    server_address.sin_port        = htons(this->port_);
+    server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    const int opt = 1;
+    if (setsockopt(this->server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        utils::Logger::FatalLog(LOCATION, "Failed to set metrics socket option");
+        exit(EXIT_FAILURE);
+    }
+    if (bind(this->server_fd_, (const struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
+        utils::Logger::FatalLog(LOCATION, "Failed to bind metrics socket");
+        exit(EXIT_FAILURE);
+    }
+    if (listen(this->server_fd_, 3) < 0) {
+        utils::Logger::FatalLog(LOCATION, "Failed to listen on metrics socket");
+        exit(EXIT_FAILURE);
+    }
+
+    this->is_running_ = true;
+    this->thread_     = std::thread(&MetricsServer::Serve, this);
+    utils::Logger::DebugLog(LOCATION, "Metrics server listening on 127.0.0.1:" + std::to_string(this->port_), this->debug_);
+}
+
+void MetricsServer::Stop() {
+    if (!this->is_running_) {
+        return;
+    }
+    this->is_running_ = false;
+    // Unblock accept in the listener thread
+    shutdown(this->server_fd_, SHUT_RDWR);
+    close(this->server_fd_);
+    this->server_fd_ = -1;
+    if (this->thread_.joinable()) {
+        this->thread_.join();
+    }
+}
+
+int MetricsServer::GetPortNumber() const {
+    return this->port_;
+}
+
+void MetricsServer::Serve() {
+    while (this->is_running_) {
+        int client_fd = accept(this->server_fd_, nullptr, nullptr);
+        if (client_fd < 0) {
+            continue;
+        }
+
+        // Bound the time spent on the client (the listener thread serves one client at a time)
+        timeval timeout{kClientTimeoutSec, 0};
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // The request line is not parsed: every path returns the metrics.
+        char buffer[kRequestBufferSize];
+        if (recv(client_fd, buffer, sizeof(buffer), 0) <= 0) {
+            utils::Logger::DebugLog(LOCATION, "No request from the metrics client", this->debug_);
+            close(client_fd);
+            continue;
+        }
+
+        std::string body     = utils::MetricsRegistry::GetInstance().ExportPrometheusText();
+        std::string response = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " +
+                               std::to_string(body.size()) +
+                               "\r\n"
+                               "Connection: close\r\n\r\n" +
+                               body;
+        if (!internal::SendData(client_fd, response.data(), response.size())) {
+            utils::Logger::DebugLog(LOCATION, "Failed to send metrics", this->debug_);
+        }
+        close(client_fd);
+    }
+}
+
+}    // namespace comm
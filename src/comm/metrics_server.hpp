@@ -0,0 +1,82 @@
+/**
+ * @file metrics_server.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-12
+ * @copyright Copyright (c) 2024
+ * @brief Metrics server class.
+ */
+
+#ifndef COMM_METRICS_SERVER_H_
+#define COMM_METRICS_SERVER_H_
+
+#include "internal/comm_configure.hpp"
+
+#include <atomic>
+#include <thread>
+
+namespace comm {
+
+/**
+ * @brief A class representing a local metrics endpoint.
+ *
+ * This class serves the metrics registry in the Prometheus text format over HTTP.
+ * The listener binds to the loopback address only and answers every request with the current metrics,
+ * so a running party process can be scraped with `curl http://127.0.0.1:<port>/metrics`.
+ */
+class MetricsServer {
+public:
+    /**
+     * @brief Constructs a MetricsServer object with a specified port and debug mode.
+     *
+     * @param port The port number on which the metrics server will listen.
+     * @param debug If true, enables debug mode; if false, debug mode is disabled.
+     */
+    MetricsServer(const int port, const bool debug);
+
+    /**
+     * @brief Destroys the MetricsServer object.
+     *
+     * Stops the listener thread if it is running.
+     */
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer &)            = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    /**
+     * @brief Starts the listener thread.
+     *
+     * Binds the socket to the loopback address and serves the metrics in a background thread.
+     */
+    void Start();
+
+    /**
+     * @brief Stops the listener thread.
+     *
+     * Closes the listening socket and waits for the background thread to finish.
+     */
+    void Stop();
+
+    /**
+     * @brief Retrieves the port number used by the metrics server.
+     *
+     * @return The port number.
+     */
+    int GetPortNumber() const;
+
+private:
+    /**
+     * @brief Accepts connections and answers them until the server is stopped.
+     */
+    void Serve();
+
+    int               port_;       /**< The port number used for the metrics server. */
+    int               server_fd_;  /**< File descriptor for the listening socket. */
+    bool              debug_;      /**< Flag indicating debug mode. */
+    std::atomic<bool> is_running_; /**< Flag indicating the listener thread is running. */
+    std::thread       thread_;     /**< The listener thread. */
+};
+
+}    // namespace comm
+
+#endif    // COMM_METRICS_SERVER_H_
@@ -0,0 +1,244 @@
+/**
+ * @file query_router.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-16
+ * @copyright Copyright (c) 2024
+ * @brief Query router implementation.
+ */
+
+#include "query_router.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "../utils/logger.hpp"
+#include "../utils/metrics.hpp"
+
+namespace {
+
+utils::Counter &RoutedQueryCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_router_queries_total", "Number of queries answered through the query router.");
+    return counter;
+}
+
+utils::Histogram &RouterBatchLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_router_batch_seconds", "Latency of a replica batch including both parties.");
+    return histogram;
+}
+
+}    // namespace
+
+namespace comm {
+
+bool ReadReplicaListFromFile(const std::string &file_path, std::vector<ReplicaInfo> &replicas) {
+    std::ifstream file(file_path);
+    if (!file.is_open()) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to open file for reading. (" + file_path + ")");
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream iss(line);
+        std::string        name, p0_address, p1_address;
+        int                p0_port, p1_port;
+        uint32_t           shard;
+        if (!(iss >> name >> p0_address >> p0_port >> p1_address >> p1_port >> shard)) {
+            utils::Logger::ErrorLog(LOCATION, "Invalid replica line: " + line);
+            return false;
+        }
+        replicas.emplace_back(name, p0_address, p0_port, p1_address, p1_port, shard);
+    }
+    return true;
+}
+
+QueryRouter::Replica::Replica(const ReplicaInfo &info)
+    : info(info), in_flight(0), latency_us(0.0), served(0) {
+}
+
+QueryRouter::QueryRouter(const std::vector<ReplicaInfo> &replicas, const uint32_t max_batch_size, const bool debug)
+    : max_batch_size_(max_batch_size), debug_(debug), is_running_(false) {
+    for (const auto &info : replicas) {
+        this->replicas_.push_back(std::make_unique<Replica>(info));
+    }
+}
+
+QueryRouter::~QueryRouter() {
+    this->Stop();
+}
+
+void QueryRouter::Start() {
+    if (this->is_running_) {
+        return;
+    }
+    if (this->replicas_.empty()) {
+        utils::Logger::FatalLog(LOCATION, "No replica is specified");
+        exit(EXIT_FAILURE);
+    }
+    for (auto &replica : this->replicas_) {
+        replica->p0 = std::make_unique<Client>(replica->info.p0_address, replica->info.p0_port, this->debug_);
+        replica->p1 = std::make_unique<Client>(replica->info.p1_address, replica->info.p1_port, this->debug_);
+        replica->p0->Setup();
+        replica->p0->Start();
+        replica->p1->Setup();
+        replica->p1->Start();
+        utils::Logger::DebugLog(LOCATION, "Connected to replica " + replica->info.name, this->debug_);
+    }
+    this->is_running_ = true;
+    for (auto &replica : this->replicas_) {
+        replica->worker = std::thread(&QueryRouter::Serve, this, std::ref(*replica));
+    }
+}
+
+void QueryRouter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (!this->is_running_) {
+            return;
+        }
+        this->is_running_ = false;
+    }
+    for (auto &replica : this->replicas_) {
+        replica->cv.notify_all();
+    }
+    for (auto &replica : this->replicas_) {
+        if (replica->worker.joinable()) {
+            replica->worker.join();
+        }
+        replica->p0->CloseSocket();
+        replica->p1->CloseSocket();
+    }
+}
+
+std::future<QueryShares> QueryRouter::Submit(const uint32_t shard, std::vector<uint32_t> q_0, std::vector<uint32_t> q_1) {
+    if (q_0.empty() || q_0.size() != q_1.size()) {
+        utils::Logger::FatalLog(LOCATION, "The shares of a query must have the same (non-zero) length");
+        exit(EXIT_FAILURE);
+    }
+    PendingQuery query;
+    query.q_0                       = std::move(q_0);
+    query.q_1                       = std::move(q_1);
+    std::future<QueryShares> result = query.promise.get_future();
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    if (!this->is_running_) {
+        utils::Logger::FatalLog(LOCATION, "The query router is not running");
+        exit(EXIT_FAILURE);
+    }
+    Replica &replica = *this->replicas_[this->SelectReplica(shard)];
+    replica.queue.push_back(std::move(query));
+    replica.cv.notify_one();
+    return result;
+}
+
+uint32_t QueryRouter::GetReplicaNum() const {
+    return this->replicas_.size();
+}
+
+uint64_t QueryRouter::GetServedQueryNum(const uint32_t replica) const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->replicas_[replica]->served;
+}
+
+double QueryRouter::GetLatencyEstimate(const uint32_t replica) const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->replicas_[replica]->latency_us;
+}
+
+size_t QueryRouter::SelectReplica(const uint32_t shard) const {
+    size_t selected = this->replicas_.size();
+    double best     = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < this->replicas_.size(); i++) {
+        const Replica &replica = *this->replicas_[i];
+        if (replica.info.shard != shard) {
+            continue;
+        }
+        // A replica without measurements is tried first (1 us per query)
+        double expected = (replica.queue.size() + replica.in_flight + 1) * std::max(replica.latency_us, 1.0);
+        if (expected < best) {
+            best     = expected;
+            selected = i;
+        }
+    }
+    if (selected == this->replicas_.size()) {
+        utils::Logger::FatalLog(LOCATION, "No replica serves shard " + std::to_string(shard));
+        exit(EXIT_FAILURE);
+    }
+    return selected;
+}
+
+void QueryRouter::Serve(Replica &replica) {
+    while (true) {
+        // Take up to max_batch_size queries
+        std::vector<PendingQuery> batch;
+        size_t                    length = 0;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            replica.cv.wait(lock, [&] { return !replica.queue.empty() || !this->is_running_; });
+            if (replica.queue.empty()) {
+                break;
+            }
+            // Queries of the same length are batched together (the wire format has one length per batch)
+            length = replica.queue.front().q_0.size();
+            while (!replica.queue.empty() && batch.size() < this->max_batch_size_ && replica.queue.front().q_0.size() == length) {
+                batch.push_back(std::move(replica.queue.front()));
+                replica.queue.pop_front();
+            }
+            replica.in_flight = batch.size();
+        }
+
+        // The same batch (in the same order) is sent to both parties before waiting for either of them
+        std::vector<uint32_t> msg_0 = {static_cast<uint32_t>(batch.size()), static_cast<uint32_t>(length)};
+        std::vector<uint32_t> msg_1 = msg_0;
+        for (const auto &query : batch) {
+            msg_0.insert(msg_0.end(), query.q_0.begin(), query.q_0.end());
+            msg_1.insert(msg_1.end(), query.q_1.begin(), query.q_1.end());
+        }
+        auto start = std::chrono::steady_clock::now();
+        replica.p0->SendVector(msg_0);
+        replica.p1->SendVector(msg_1);
+        std::vector<uint32_t> out_0, out_1;
+        replica.p0->RecvVector(out_0);
+        replica.p1->RecvVector(out_1);
+        double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        RouterBatchLatency().Observe(elapsed_us / 1e6);
+
+        if (out_0.size() != batch.size() * length || out_1.size() != batch.size() * length) {
+            // A malformed reply fails the whole batch (the shares cannot be matched to the queries)
+            utils::Logger::ErrorLog(LOCATION, "Replica " + replica.info.name + " replied with (" + std::to_string(out_0.size()) + ", " + std::to_string(out_1.size()) + ") shares for " + std::to_string(batch.size() * length));
+            for (auto &query : batch) {
+                query.promise.set_exception(std::make_exception_ptr(std::runtime_error("Malformed reply from replica " + replica.info.name)));
+            }
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            replica.in_flight = 0;
+            continue;
+        }
+        for (size_t i = 0; i < batch.size(); i++) {
+            QueryShares shares;
+            shares.first.assign(out_0.begin() + i * length, out_0.begin() + (i + 1) * length);
+            shares.second.assign(out_1.begin() + i * length, out_1.begin() + (i + 1) * length);
+            batch[i].promise.set_value(std::move(shares));
+        }
+        RoutedQueryCounter().Increment(batch.size());
+
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        double per_query   = elapsed_us / batch.size();
+        replica.latency_us = (replica.served == 0) ? per_query : (1.0 - kRouterLatencyAlpha) * replica.latency_us + kRouterLatencyAlpha * per_query;
+        replica.served += batch.size();
+        replica.in_flight = 0;
+    }
+
+    // Ask both parties to stop
+    std::vector<uint32_t> stop = {0};
+    replica.p0->SendVector(stop);
+    replica.p1->SendVector(stop);
+    utils::Logger::DebugLog(LOCATION, "Replica " + replica.info.name + " served " + std::to_string(replica.served) + " queries", this->debug_);
+}
+
+}    // namespace comm
@@ -0,0 +1,175 @@
+/**
+ * @file query_router.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-16
+ * @copyright Copyright (c) 2024
+ * @brief Query router class.
+ */
+
+#ifndef COMM_QUERY_ROUTER_H_
+#define COMM_QUERY_ROUTER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "client.hpp"
+
+namespace comm {
+
+constexpr uint32_t kDefaultRouterBatchSize = 32;     // Maximum number of queries sent to a replica in one batch
+constexpr double   kRouterLatencyAlpha     = 0.2;    // Weight of the latest batch in the latency estimate
+
+/**
+ * @brief Structure to store the addresses of one replica (a party-0/party-1 pair).
+ */
+struct ReplicaInfo {
+    std::string name;       /**< Name of the replica (for logs). */
+    std::string p0_address; /**< Host address of party 0. */
+    int         p0_port;    /**< Query port of party 0. */
+    std::string p1_address; /**< Host address of party 1. */
+    int         p1_port;    /**< Query port of party 1. */
+    uint32_t    shard;      /**< The index shard served by the replica. */
+
+    ReplicaInfo(const std::string &name, const std::string &p0_address, const int p0_port, const std::string &p1_address, const int p1_port, const uint32_t shard)
+        : name(name), p0_address(p0_address), p0_port(p0_port), p1_address(p1_address), p1_port(p1_port), shard(shard) {
+    }
+};
+
+/**
+ * @brief Read the replica list from a file.
+ *
+ * Each line is `<name> <p0_address> <p0_port> <p1_address> <p1_port> <shard>`; empty lines and lines starting with '#' are skipped.
+ *
+ * @param file_path The path to the replica list.
+ * @param replicas The replicas read from the file.
+ * @return `true` if the file was read.
+ */
+bool ReadReplicaListFromFile(const std::string &file_path, std::vector<ReplicaInfo> &replicas);
+
+using QueryShares = std::pair<std::vector<uint32_t>, std::vector<uint32_t>>;
+
+/**
+ * @brief A class routing secret-shared queries across replicas.
+ *
+ * The router holds one connection to each party of every replica. Both shares of a query are sent to the two parties
+ * of the same replica in the same batch, so the parties always evaluate matching shares. A query is assigned to the replica
+ * of its shard with the smallest expected completion time ((queue depth + 1) x per-query latency),
+ * and each replica has a worker thread that sends the pending queries in batches of up to `max_batch_size`.
+ *
+ * Wire format (per batch): the router sends `[num, length, shares...]` to each party and receives `num x length` output shares;
+ * `[0]` asks the party to stop. A batch only holds queries of the same length. If a party replies with another number of shares,
+ * the futures of the whole batch hold an exception.
+ */
+class QueryRouter {
+public:
+    /**
+     * @brief Constructs a QueryRouter object.
+     *
+     * @param replicas The replicas to route the queries to.
+     * @param max_batch_size The maximum number of queries in one batch.
+     * @param debug If true, enables debug mode; if false, debug mode is disabled.
+     */
+    QueryRouter(const std::vector<ReplicaInfo> &replicas, const uint32_t max_batch_size, const bool debug);
+
+    /**
+     * @brief Destroys the QueryRouter object.
+     *
+     * Stops the worker threads if they are running.
+     */
+    ~QueryRouter();
+
+    QueryRouter(const QueryRouter &)            = delete;
+    QueryRouter &operator=(const QueryRouter &) = delete;
+
+    /**
+     * @brief Connects to all parties and starts one worker thread per replica.
+     */
+    void Start();
+
+    /**
+     * @brief Sends the pending queries, asks the parties to stop and joins the worker threads.
+     */
+    void Stop();
+
+    /**
+     * @brief Submits a secret-shared query.
+     *
+     * @param shard The index shard to be searched.
+     * @param q_0 The share of the query for party 0.
+     * @param q_1 The share of the query for party 1.
+     * @return The output shares of party 0 and party 1 (std::runtime_error if the replica sent a malformed reply).
+     */
+    std::future<QueryShares> Submit(const uint32_t shard, std::vector<uint32_t> q_0, std::vector<uint32_t> q_1);
+
+    /**
+     * @brief Retrieves the number of replicas.
+     *
+     * @return The number of replicas.
+     */
+    uint32_t GetReplicaNum() const;
+
+    /**
+     * @brief Retrieves the number of queries answered by a replica.
+     *
+     * @param replica The index of the replica.
+     * @return The number of queries.
+     */
+    uint64_t GetServedQueryNum(const uint32_t replica) const;
+
+    /**
+     * @brief Retrieves the estimated per-query latency of a replica.
+     *
+     * @param replica The index of the replica.
+     * @return The latency in microseconds.
+     */
+    double GetLatencyEstimate(const uint32_t replica) const;
+
+private:
+    struct PendingQuery {
+        std::vector<uint32_t>     q_0;     /**< The share of the query for party 0. */
+        std::vector<uint32_t>     q_1;     /**< The share of the query for party 1. */
+        std::promise<QueryShares> promise; /**< The promise of the output shares. */
+    };
+
+    struct Replica {
+        ReplicaInfo              info;       /**< The addresses of the replica. */
+        std::unique_ptr<Client>  p0;         /**< Connection to party 0. */
+        std::unique_ptr<Client>  p1;         /**< Connection to party 1. */
+        std::deque<PendingQuery> queue;      /**< The queries waiting for a batch. */
+        uint32_t                 in_flight;  /**< The number of queries in the current batch. */
+        double                   latency_us; /**< The estimated per-query latency. */
+        uint64_t                 served;     /**< The number of answered queries. */
+        std::thread              worker;     /**< The worker thread. */
+        std::condition_variable  cv;         /**< Signals new queries or stop. */
+
+        Replica(const ReplicaInfo &info);
+    };
+
+    /**
+     * @brief Selects the replica of a shard with the smallest expected completion time (called with the lock held).
+     */
+    size_t SelectReplica(const uint32_t shard) const;
+
+    /**
+     * @brief Sends the batches of a replica until the router is stopped.
+     */
+    void Serve(Replica &replica);
+
+    std::vector<std::unique_ptr<Replica>> replicas_;       /**< The replicas. */
+    const uint32_t                        max_batch_size_; /**< The maximum number of queries in one batch. */
+    const bool                            debug_;          /**< Flag indicating debug mode. */
+    mutable std::mutex                    mutex_;          /**< Guards the queues and the statistics. */
+    bool                                  is_running_;     /**< Flag indicating the worker threads are running. */
+};
+
+}    // namespace comm
+
+#endif    // COMM_QUERY_ROUTER_H_
@@ -1,6 +1,104 @@
 import json
 
-def generate_cpp_code(party_id, json_data):
+# Operations that need a communication round (and one Beaver triple per element)
+INTERACTIVE_FUNCTIONS = {"mult": "primitives::Mult", "select": "primitives::Select"}
+LOCAL_FUNCTIONS = {"add": "primitives::Add"}
+
+
+def schedule_rounds(program):
+    """
+    Assign each step to the communication round in which its value becomes available.
+    Local operations are evaluated as soon as their operands are ready; an interactive
+    operation finishes one round after its latest operand.
+    """
+    rounds = {}
+    for step in program:
+        function = step.get("function")
+        if function not in INTERACTIVE_FUNCTIONS and function not in LOCAL_FUNCTIONS:
+            raise ValueError(f"unsupported function: {function}")
+        ready = max([rounds.get(arg, 0) for arg in step.get("args", [])], default=0)
+        rounds[step["name"]] = ready + (1 if function in INTERACTIVE_FUNCTIONS else 0)
+    return rounds
+
+
+def collect_inputs(program):
+    defined = set()
+    inputs = []
+    for step in program:
+        for arg in step.get("args", []):
+            if arg not in defined and arg not in inputs:
+                inputs.append(arg)
+        defined.add(step["name"])
+    return inputs
+
+
+def emit_group(function, steps, group_id):
+    """
+    Emit one vector call for a group of independent steps with the same function,
+    or a scalar call when the group has a single step.
+    """
+    if len(steps) == 1:
+        step = steps[0]
+        args = ', '.join(step.get("args", []))
+        if function in LOCAL_FUNCTIONS:
+            return [f"uint32_t {step['name']} = {LOCAL_FUNCTIONS[function]}({args});"]
+        return [f"uint32_t {step['name']} = {INTERACTIVE_FUNCTIONS[function]}(party, triples, {args});"]
+
+    prefix = f"{function}_{group_id}"
+    arity = len(steps[0].get("args", []))
+    lines = []
+    operands = []
+    for i in range(arity):
+        values = ', '.join(step["args"][i] for step in steps)
+        lines.append(f"std::vector<uint32_t> {prefix}_in{i} = {{{values}}};")
+        operands.append(f"{prefix}_in{i}")
+    lines.append(f"std::vector<uint32_t> {prefix}_out;")
+    if function in LOCAL_FUNCTIONS:
+        lines.append(f"{LOCAL_FUNCTIONS[function]}({', '.join(operands)}, {prefix}_out);")
+    else:
+        lines.append(f"{INTERACTIVE_FUNCTIONS[function]}(party, triples, {', '.join(operands)}, {prefix}_out);")
+    for i, step in enumerate(steps):
+        lines.append(f"uint32_t {step['name']} = {prefix}_out[{i}];")
+    return lines
+
+
+def generate_operations(program):
+    """
+    Group the independent operations of each round into vector calls.
+    In round r, the interactive operations (whose operands are all ready by round r - 1)
+    are opened together, then the local operations that become ready in round r follow
+    in program order.
+    """
+    rounds = schedule_rounds(program)
+    operations = []
+    group_id = 0
+    for r in range(max(rounds.values(), default=0) + 1):
+        steps_in_round = [step for step in program if rounds[step["name"]] == r]
+        for function in INTERACTIVE_FUNCTIONS:
+            steps = [step for step in steps_in_round if step["function"] == function]
+            if steps:
+                operations.append(f"// Round {r}: {len(steps)} x {function}")
+                operations.extend(emit_group(function, steps, group_id))
+                group_id += 1
+        # Local operations may depend on each other, so they are grouped only while they stay independent.
+        pending = [step for step in steps_in_round if step["function"] in LOCAL_FUNCTIONS]
+        while pending:
+            names = {step["name"] for step in pending}
+            ready = [step for step in pending if not any(arg in names for arg in step.get("args", []))]
+            for function in LOCAL_FUNCTIONS:
+                steps = [step for step in ready if step["function"] == function]
+                if steps:
+                    operations.extend(emit_group(function, steps, group_id))
+                    group_id += 1
+            pending = [step for step in pending if step not in ready]
+    return operations
+
+
+def count_triples(program):
+    return sum(1 for step in program if step.get("function") in INTERACTIVE_FUNCTIONS)
+
+
+def generate_cpp_code(party_id, json_data, triple_path="data/test/ss/bt", input_path="data/test/ss/input"):
     if party_id not in [0, 1]:
         raise ValueError("party_id must be either 0 or 1")
 
@@ -19,19 +117,21 @@ def generate_cpp_code(party_id, json_data):
 #include "../tools/tools.hpp"
 #include "../utils/logger.hpp"
 #include "../utils/utils.hpp"
-#include "add.hpp"
 #include "fssgate.hpp"
-#include "mult.hpp"
-#include "select.hpp"
+#include "primitives.hpp"
 
 int main() {{
     {initialization}
     {operations}
 
+    party.EndCommunication();
     return {last_output};
 }}
     '''
 
+    program = json_data.get("program", [])
+    inputs = collect_inputs(program)
+
     # Initialization code based on party_id
     initialization_code = (
         """
@@ -41,20 +141,27 @@ int main() {{
 
     comm::CommInfo               comm_info(party_id, port, host_address);
     tools::secret_sharing::Party party(comm_info);
-""".format(party_id=party_id)
-    )
 
-    # Parse JSON to generate operations
-    operations = []
-    program = json_data.get("program", [])
-    for step in program:
-        name = step.get("name")
-        function = step.get("function")
-        args = ', '.join(step.get("args", []))
-        operations.append(f"uint32_t {name} = {function}(party, {args});")
+    // Load the Beaver triples once for the whole program ({num_triples} are consumed)
+    primitives::TripleStore triples;
+    triples.Load("{triple_path}_{party_id}");
+
+    // Load the input shares ({input_names})
+    tools::secret_sharing::ShareHandler sh;
+    std::vector<uint32_t>               inputs;
+    sh.LoadShare("{input_path}_{party_id}", inputs);
+{input_bindings}
+    party.StartCommunication();
+""".format(party_id=party_id,
+           num_triples=count_triples(program),
+           triple_path=triple_path,
+           input_path=input_path,
+           input_names=', '.join(inputs),
+           input_bindings=''.join(f"    uint32_t {name} = inputs[{i}];\n" for i, name in enumerate(inputs)))
+    )
 
     # Join operations and get the last output variable
-    operations_code = "\n    ".join(operations)
+    operations_code = "\n    ".join(generate_operations(program))
     last_output = program[-1]["name"] if program else "0"
 
     # Generate the final C++ code
@@ -76,10 +183,11 @@ if __name__ == "__main__":
         "program": [
             {"name": "sum1", "function": "add", "args": ["a0", "b0"]},
             {"name": "sum2", "function": "add", "args": ["c0", "d0"]},
-            {"name": "prod", "function": "mult", "args": ["sum1", "sum2"]}
+            {"name": "prod1", "function": "mult", "args": ["sum1", "sum2"]},
+            {"name": "prod2", "function": "mult", "args": ["a0", "c0"]},
+            {"name": "sel", "function": "select", "args": ["e0", "prod1", "prod2"]}
         ]
     }
     party_id = 0
     cpp_code = generate_cpp_code(party_id, example_json)
     save_cpp_code("generated_code.cpp", cpp_code)
-
@@ -8,9 +8,17 @@
 
 #include "fssgate.hpp"
 
-#include <sdsl/csa_wt.hpp>
-#include <sdsl/suffix_arrays.hpp>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+#include "../comm/server.hpp"
+#include "../fss-gate/fm-index/bwt_index.hpp"
+#include "../fss-gate/fm-index/direct_scan.hpp"
+#include "../fss-gate/fm-index/index_registry.hpp"
+#include "../fss-gate/fm-index/query_planner.hpp"
 #include "../fss-gate/internal/fsskey_io.hpp"
 #include "../utils/file_io.hpp"
 #include "../utils/logger.hpp"
@@ -31,40 +39,166 @@ const std::string kTestCompPath   = kCurrentPath + "/data/comp/";
 const std::string kCompKeyPath_P0 = kTestCompPath + "key_p0";
 const std::string kCompKeyPath_P1 = kTestCompPath + "key_p1";
 
-const std::string kFMIPath        = kCurrentPath + "/data/fmi/";
-const std::string kFMIBTPath_F    = kFMIPath + "btf";
-const std::string kFMIBTPath_F_P0 = kFMIPath + "btf_p0";
-const std::string kFMIBTPath_F_P1 = kFMIPath + "btf_p1";
-const std::string kFMIBTPath_G    = kFMIPath + "btg";
-const std::string kFMIBTPath_G_P0 = kFMIPath + "btg_p0";
-const std::string kFMIBTPath_G_P1 = kFMIPath + "btg_p1";
-const std::string kFMIKeyPath_P0  = kFMIPath + "key_p0";
-const std::string kFMIKeyPath_P1  = kFMIPath + "key_p1";
-const std::string kFMIDBPath      = kFMIPath + "db";
-const std::string kFMIBWTPath     = kFMIPath + "bwt";
+const std::string kFMIPath           = kCurrentPath + "/data/fmi/";
+const std::string kFMICTPath_P0      = kFMIPath + "ct_p0";
+const std::string kFMICTPath_P1      = kFMIPath + "ct_p1";
+const std::string kFMIKeyPath_P0     = kFMIPath + "key_p0";
+const std::string kFMIKeyPath_P1     = kFMIPath + "key_p1";
+const std::string kFMIScanKeyPath_P0 = kFMIPath + "scan_key_p0";
+const std::string kFMIScanKeyPath_P1 = kFMIPath + "scan_key_p1";
+const std::string kFMIKeySetNumPath  = kFMIPath + "key_set_num";
+const std::string kFMIDBPath         = kFMIPath + "db";
+const std::string kFMIIndexPath      = kFMIPath + "index.bin";
+const std::string kFMIIndexName      = "fmi";    // Shared by the serving processes on the same host
+
+const std::string kKeyExt        = ".key";     // Extension of fss::internal::FssKeyIo
+const std::string kShareExt      = ".dat";     // Extension of tools::secret_sharing::ShareHandler
+const std::string kClaimedSuffix = "_used";    // A key file renamed by the process that claimed its set
 
 fss::DebugInfo          dbg_info = fss::DebugInfo();
 fss::internal::FssKeyIo key_io;
 
-using bts_t = tools::secret_sharing::bts_t;
-
-constexpr uint32_t kMaxQuerySize = 7;
-
-std::string ConstructBwtFromVector(const std::string &input) {
-    size_t input_size = input.size();
-    // Construct the suffix array using the SDSL library
-    sdsl::csa_wt<> csa;
-    sdsl::construct_im(csa, input, 1);
-    // Convert the BWT to a string
-    std::string bwt_vector = "";
-    for (size_t i = 0; i < input_size + 1; i++) {
-        if (csa.bwt[i]) {
-            bwt_vector += csa.bwt[i];
-        } else {
-            bwt_vector += '$';
+using cts_t = tools::secret_sharing::cts_t;
+
+constexpr uint32_t kMaxQuerySize           = 7;
+constexpr uint64_t kOutOfCoreMemoryDivisor = 2;    // The BWT is streamed from disk if it is larger than 1/2 of the physical memory
+
+// The costs are measured once per process (the first query pays the calibration)
+fss::fmi::CostModel cost_model;
+bool                calibrated = false;
+
+void SetupQueryPlanner(tools::secret_sharing::Party &party, const fss::fmi::FssFmi &fss_fmi, fss::fmi::QueryPlanner &planner) {
+    if (!calibrated) {
+        planner.Calibrate(party, fss_fmi);
+        cost_model = planner.GetCostModel();
+        calibrated = true;
+    }
+    planner.SetCostModel(cost_model);
+}
+
+// The text in the original order (the BWT index is built from the reversed text)
+void SetScanSentence(fss::fmi::DirectScan &scan) {
+    utils::FileIo         io;
+    std::vector<uint32_t> database;
+    io.ReadVectorFromFile(kFMIDBPath, database);
+    scan.SetSentence(utils::VectorToStr(database, ""));
+}
+
+// Whether the BWT of the index is too large to be loaded
+bool UseIndexFile() {
+    fss::fmi::BwtIndexLayout layout;
+    uint64_t                 memory = static_cast<uint64_t>(sysconf(_SC_PHYS_PAGES)) * static_cast<uint64_t>(sysconf(_SC_PAGE_SIZE));
+    return fss::fmi::ReadBwtIndexLayout(kFMIIndexPath, layout) && layout.bits_words * sizeof(uint64_t) > memory / kOutOfCoreMemoryDivisor;
+}
+
+// Write the BWT index of the (reversed) text used by the FMI search
+void WriteFMIIndex(const std::string &reversed_text) {
+    fss::fmi::BwtIndex index;
+    if (!fss::fmi::BuildBwtIndex(reversed_text, fss::fmi::kDefaultSaSampleRate, index) || !fss::fmi::WriteBwtIndexToFile(kFMIIndexPath, index)) {
+        utils::Logger::FatalLog(LOCATION, "Failed to construct the BWT index");
+        exit(EXIT_FAILURE);
+    }
+
+    fss::fmi::IndexRegistry::GetInstance().Remove(kFMIIndexName);    // The index published by previous runs is stale
+    utils::Logger::InfoLog(LOCATION, "BWT has been constructed.");
+}
+
+// The key material of the FMI search is written as indexed sets (<path>_<i>), and each set is used by one query only:
+// reusing a key opens q - r and q' - r with the same mask r, and reusing a correlated triple opens x - a and x' - a.
+std::string KeySetPath(const std::string &path, const uint32_t i) {
+    return path + "_" + std::to_string(i);
+}
+
+// Generate the correlated triples and the keys of the FMI search (one set of each per query)
+void FMIKeySetup(const uint32_t bitsize, const uint32_t key_set_num) {
+    fss::fmi::FssFmiParameters                   params(bitsize, kMaxQuerySize, dbg_info);
+    tools::secret_sharing::AdditiveSecretSharing ss(bitsize);
+    tools::secret_sharing::ShareHandler          sh;
+    utils::FileIo                                io;
+    uint32_t                                     qs = params.query_size;
+    fss::fmi::FssFmi                             fss_fmi(params);
+    fss::fmi::DirectScan                         scan(params);
+
+    for (uint32_t i = 0; i < key_set_num; i++) {
+        // Generate correlated triples (one per step, shared by the products of both bounds)
+        cts_t ct;
+        ss.GenerateCorrelatedTriples(qs - 1, 2, ct);
+        std::pair<cts_t, cts_t> ct_sh = ss.ShareCorrelatedTriples(ct);
+        sh.ExportCTShare(KeySetPath(kFMICTPath_P0, i), KeySetPath(kFMICTPath_P1, i), ct_sh);
+
+        // Generate keys
+        std::pair<fss::fmi::FssFmiKey, fss::fmi::FssFmiKey> fmi_keys = fss_fmi.GenerateKeys(qs - 1, qs);
+        key_io.WriteFssFmiKeyToFile(KeySetPath(kFMIKeyPath_P0, i), fmi_keys.first);
+        key_io.WriteFssFmiKeyToFile(KeySetPath(kFMIKeyPath_P1, i), fmi_keys.second);
+
+        std::pair<fss::fmi::DirectScanKey, fss::fmi::DirectScanKey> scan_keys = scan.GenerateKeys();
+        key_io.WriteDirectScanKeyToFile(KeySetPath(kFMIScanKeyPath_P0, i), scan_keys.first);
+        key_io.WriteDirectScanKeyToFile(KeySetPath(kFMIScanKeyPath_P1, i), scan_keys.second);
+
+        fmi_keys.first.FreeFssFmiKey();
+        fmi_keys.second.FreeFssFmiKey();
+        scan_keys.first.FreeDirectScanKey();
+        scan_keys.second.FreeDirectScanKey();
+    }
+    io.WriteValueToFile(kFMIKeySetNumPath, key_set_num);
+
+    utils::Logger::InfoLog(LOCATION, "FMI Search keys and correlated triples have been generated (" + std::to_string(key_set_num) + " queries).");
+}
+
+// Claim the key sets of the next num queries, so that both parties use the same sets.
+// Party 0 takes a set by renaming its key file (only one process on this host can win a set) and sends the indices;
+// party 1 renames its key files of these sets, and refuses a set whose file has already been renamed or removed.
+// The sets are exhausted (fatal) rather than reused.
+std::vector<uint32_t> ClaimKeySets(tools::secret_sharing::Party &party, const std::string &key_path_p0, const std::string &key_path_p1, const uint32_t num, uint32_t &next) {
+    utils::FileIo io;
+    uint32_t      key_set_num = 0;
+    io.ReadValueFromFile(kFMIKeySetNumPath, key_set_num);
+
+    std::vector<uint32_t> sets_0(num), sets_1(num);
+    if (party.GetId() == 0) {
+        for (uint32_t i = 0; i < num; i++) {
+            for (; next < key_set_num; next++) {
+                std::string path = KeySetPath(key_path_p0, next);
+                if (std::rename((path + kKeyExt).c_str(), (path + kClaimedSuffix + kKeyExt).c_str()) == 0) {
+                    break;
+                }
+            }
+            if (next >= key_set_num) {
+                utils::Logger::FatalLog(LOCATION, "The key material of the FMI search has run out (" + std::to_string(key_set_num) + " queries); run the setup again");
+                exit(EXIT_FAILURE);
+            }
+            sets_0[i] = next++;
+        }
+    }
+    party.SendRecv(sets_0, sets_1);
+    if (party.GetId() == 1) {
+        for (const uint32_t set : sets_0) {
+            std::string path = KeySetPath(key_path_p1, set);
+            if (set >= key_set_num || std::rename((path + kKeyExt).c_str(), (path + kClaimedSuffix + kKeyExt).c_str()) != 0) {
+                utils::Logger::FatalLog(LOCATION, "The key set " + std::to_string(set) + " has already been used or does not exist: " + path);
+                exit(EXIT_FAILURE);
+            }
         }
     }
-    return bwt_vector;
+    return sets_0;
+}
+
+// Read the FssFMI key and the correlated triples of a claimed set, then remove them
+void LoadFMIKeySet(const uint32_t party_id, const fss::fmi::FssFmiParameters &params, const uint32_t set, fss::fmi::FssFmiKey &fmi_key, cts_t &ct) {
+    tools::secret_sharing::ShareHandler sh;
+    std::string                         key_path = KeySetPath((party_id == 0) ? kFMIKeyPath_P0 : kFMIKeyPath_P1, set) + kClaimedSuffix;
+    std::string                         ct_path  = KeySetPath((party_id == 0) ? kFMICTPath_P0 : kFMICTPath_P1, set);
+    key_io.ReadFssFmiKeyFromFile(key_path, params, fmi_key);
+    sh.LoadCTShare(ct_path, ct);
+    std::remove((key_path + kKeyExt).c_str());
+    std::remove((ct_path + kShareExt).c_str());
+}
+
+// Read the DirectScan key of a claimed set, then remove it
+void LoadScanKeySet(const uint32_t party_id, const fss::fmi::FssFmiParameters &params, const uint32_t set, fss::fmi::DirectScanKey &scan_key) {
+    std::string key_path = KeySetPath((party_id == 0) ? kFMIScanKeyPath_P0 : kFMIScanKeyPath_P1, set) + kClaimedSuffix;
+    key_io.ReadDirectScanKeyFromFile(key_path, params, scan_key);
+    std::remove((key_path + kKeyExt).c_str());
 }
 
 }    // namespace
@@ -119,45 +253,38 @@ void CompareSetup(const uint32_t bitsize) {
     comp_keys.second.FreeCompKey();
 }
 
-void FMISearchSetup(const uint32_t bitsize, std::vector<uint32_t> &database) {
-    fmi::FssFmiParameters                        params(bitsize, kMaxQuerySize, dbg_info);
-    tools::secret_sharing::AdditiveSecretSharing ss(bitsize);
-    tools::secret_sharing::ShareHandler          sh;
-    utils::FileIo                                io;
-    uint32_t                                     qs = params.query_size;
-    fmi::FssFmi                                  fss_fmi(params);
+void FMISearchSetup(const uint32_t bitsize, std::vector<uint32_t> &database, const uint32_t key_set_num) {
+    utils::FileIo io;
 
     // Construct the BWT from the input database
     io.WriteVectorToFile(kFMIDBPath, database);
     std::reverse(database.begin(), database.end());    // To find LPM, we need to reverse the text
-    std::string bwt = ConstructBwtFromVector(utils::VectorToStr(database, ""));
-    io.WriteStringToFile(kFMIBWTPath, bwt);
-
-    utils::Logger::InfoLog(LOCATION, "BWT has been constructed.");
-
-    // Generate beaver triples
-    bts_t btf(qs - 1), btg(qs - 1);
-    ss.GenerateBeaverTriples(qs - 1, btf);
-    ss.GenerateBeaverTriples(qs - 1, btg);
-    std::pair<bts_t, bts_t> btf_sh = ss.ShareBeaverTriples(btf);
-    std::pair<bts_t, bts_t> btg_sh = ss.ShareBeaverTriples(btg);
-    sh.ExportBT(kFMIBTPath_F, btf);
-    sh.ExportBT(kFMIBTPath_G, btg);
-    sh.ExportBTShare(kFMIBTPath_F_P0, kFMIBTPath_F_P1, btf_sh);
-    sh.ExportBTShare(kFMIBTPath_G_P0, kFMIBTPath_G_P1, btg_sh);
-
-    utils::Logger::InfoLog(LOCATION, "Beaver triples have been generated.");
-
-    // Generate keys
-    std::pair<fmi::FssFmiKey, fmi::FssFmiKey> fmi_keys = fss_fmi.GenerateKeys(qs - 1, qs);
-
-    key_io.WriteFssFmiKeyToFile(kFMIKeyPath_P0, fmi_keys.first);
-    key_io.WriteFssFmiKeyToFile(kFMIKeyPath_P1, fmi_keys.second);
+    WriteFMIIndex(utils::VectorToStr(database, ""));
+    FMIKeySetup(bitsize, key_set_num);
+}
 
-    utils::Logger::InfoLog(LOCATION, "FMI Search keys have been generated.");
+void FMISearchIngest(const uint32_t bitsize, const std::string &corpus_path, const uint32_t key_set_num) {
+    utils::FileIo io;
 
-    fmi_keys.first.FreeFssFmiKey();
-    fmi_keys.second.FreeFssFmiKey();
+    // The text of the corpus replaces the database (the index file is rebuilt, the keys are regenerated)
+    std::string text;
+    if (!fmi::ReadCorpusFromFile(corpus_path, text)) {
+        utils::Logger::FatalLog(LOCATION, "Failed to read the corpus: " + corpus_path);
+        exit(EXIT_FAILURE);
+    }
+    if (text.empty() || text.size() >= utils::Pow(2, bitsize)) {
+        utils::Logger::FatalLog(LOCATION, "The corpus must have 1 to " + std::to_string(utils::Pow(2, bitsize) - 1) + " characters (" + std::to_string(text.size()) + ")");
+        exit(EXIT_FAILURE);
+    }
+    std::vector<uint32_t> database(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        database[i] = (text[i] == '1') ? 1 : 0;
+    }
+    io.WriteVectorToFile(kFMIDBPath, database);
+    std::reverse(text.begin(), text.end());    // To find LPM, we need to reverse the text
+    WriteFMIIndex(text);
+    utils::Logger::InfoLog(LOCATION, "Corpus of " + std::to_string(text.size()) + " characters has been ingested.");
+    FMIKeySetup(bitsize, key_set_num);
 }
 
 uint32_t ZeroTest(tools::secret_sharing::Party &party, const uint32_t x, const uint32_t bitsize) {
@@ -258,46 +385,151 @@ uint32_t Compare(tools::secret_sharing::Party &party, const uint32_t x, const ui
 std::vector<uint32_t> FMISearch(tools::secret_sharing::Party &party, const std::vector<uint32_t> &q, const uint32_t bitsize) {
     fmi::FssFmiParameters                        params(bitsize, kMaxQuerySize, dbg_info);
     tools::secret_sharing::AdditiveSecretSharing ss(bitsize);
-    tools::secret_sharing::ShareHandler          sh;
     utils::FileIo                                io;
     uint32_t                                     qs = q.size();
     fmi::FssFmi                                  fss_fmi(params);
-
-    // Set database (bwt)
-    std::string bwt;
-    io.ReadStringFromFile(kFMIBWTPath, bwt);
-    fss_fmi.SetSentence(bwt);
-
-    // Set beaver triples
-    bts_t btf, btg;
-    if (party.GetId() == 0) {
-        sh.LoadBTShare(kFMIBTPath_F_P0, btf);
-        sh.LoadBTShare(kFMIBTPath_G_P0, btg);
+    fmi::DirectScan                              scan(params);
+    fmi::QueryPlanner                            planner(params, scan);
+
+    // Set database (compressed bwt, or streamed from the index file if it does not fit in memory)
+    if (UseIndexFile()) {
+        if (!fss_fmi.SetIndexFile(kFMIIndexPath)) {
+            utils::Logger::FatalLog(LOCATION, "Failed to open the BWT index");
+            exit(EXIT_FAILURE);
+        }
     } else {
-        sh.LoadBTShare(kFMIBTPath_F_P1, btf);
-        sh.LoadBTShare(kFMIBTPath_G_P1, btg);
+        fmi::BwtIndex index;
+        if (!fmi::ReadBwtIndexFromFile(kFMIIndexPath, index)) {
+            utils::Logger::FatalLog(LOCATION, "Failed to read the BWT index");
+            exit(EXIT_FAILURE);
+        }
+        fss_fmi.SetCompressedIndex(index);
     }
-    fss_fmi.SetBeaverTriple(btf, btg);
+    SetScanSentence(scan);
 
-    // Read FssFMI key
-    fmi::FssFmiKey fmi_key;
-    if (party.GetId() == 0) {
-        key_io.ReadFssFmiKeyFromFile(kFMIKeyPath_P0, params, fmi_key);
+    // Start communication
+    party.StartCommunication();
+    SetupQueryPlanner(party, fss_fmi, planner);
+
+    // The query consumes a fresh key set of the chosen engine
+    std::vector<uint32_t> result(params.query_size);
+    uint32_t              next = 0;
+    if (planner.Choose(qs) == fmi::SearchEngine::kDirectScan) {
+        fmi::DirectScanKey scan_key;
+        LoadScanKeySet(party.GetId(), params, ClaimKeySets(party, kFMIScanKeyPath_P0, kFMIScanKeyPath_P1, 1, next)[0], scan_key);
+
+        // Execute the direct scan on the pattern as is
+        scan.Evaluate(party, scan_key, q, result);
+        scan_key.FreeDirectScanKey();
     } else {
-        key_io.ReadFssFmiKeyFromFile(kFMIKeyPath_P1, params, fmi_key);
+        fmi::FssFmiKey fmi_key;
+        cts_t          ct;
+        LoadFMIKeySet(party.GetId(), params, ClaimKeySets(party, kFMIKeyPath_P0, kFMIKeyPath_P1, 1, next)[0], fmi_key, ct);
+        fss_fmi.SetCorrelatedTriple(ct);
+
+        // Execute Eval^{FssFMI} algorithm (the query is padded to the query size of the key)
+        std::vector<uint32_t> q_pad(q);
+        q_pad.resize(params.query_size, 0);
+        fss_fmi.Evaluate(party, fmi_key, q_pad, result);
+        fmi_key.FreeFssFmiKey();
     }
+    result.resize(qs);
+    return result;
+}
 
-    // Start communication
+void FMISearchServe(tools::secret_sharing::Party &party, const int query_port, const uint32_t bitsize) {
+    fmi::FssFmiParameters params(bitsize, kMaxQuerySize, dbg_info);
+    fmi::FssFmi           fss_fmi(params);
+    fmi::DirectScan       scan(params);
+    fmi::QueryPlanner     planner(params, scan);
+
+    // The database is mapped from shared memory (published by the first process on this host and checked by the others),
+    // while every query consumes its own key set (see ClaimKeySets)
+    fmi::IndexRegistry &registry = fmi::IndexRegistry::GetInstance();
+    fmi::IndexView      view;
+    {
+        fmi::BwtIndex index;
+        if (!fmi::ReadBwtIndexFromFile(kFMIIndexPath, index) || !registry.Publish(kFMIIndexName, index) || !registry.Attach(kFMIIndexName, view)) {
+            utils::Logger::FatalLog(LOCATION, "Failed to load the BWT index");
+            exit(EXIT_FAILURE);
+        }
+    }
+    fss_fmi.SetIndexView(view);
+    SetScanSentence(scan);
+
+    // Wait for the router, then connect to the other party
+    comm::Server router(query_port, false);
+    router.Setup();
     party.StartCommunication();
+    SetupQueryPlanner(party, fss_fmi, planner);
+    router.Start();
+    utils::Logger::InfoLog(LOCATION, "Serving FMI queries on port " + std::to_string(query_port));
+
+    // Both parties receive the same batches in the same order (see comm::QueryRouter)
+    // The sessions of a batch run in two halves out of phase, so the rank evaluations of one half overlap the openings of the other
+    // The ranks of the FssFMI sessions of a half are evaluated in one pass over the BWT when its round is flushed
+    tools::secret_sharing::PipelinedMultiplexer mux(party, 2);
+    std::unique_ptr<rank::FssRankBatch>         rank_batch = fss_fmi.CreateRankBatch();
+    std::vector<uint32_t>                       msg, out;
+    uint64_t                                    served    = 0;
+    uint32_t                                    next_fmi  = 0;
+    uint32_t                                    next_scan = 0;
+    while (true) {
+        router.RecvVector(msg);
+        if (msg.empty() || msg[0] == 0) {
+            break;
+        }
+        uint32_t num = msg[0], length = msg[1];
+        if (length > params.query_size || msg.size() != 2 + static_cast<size_t>(num) * length) {
+            utils::Logger::FatalLog(LOCATION, "Invalid query batch (num = " + std::to_string(num) + ", length = " + std::to_string(length) + ")");
+            exit(EXIT_FAILURE);
+        }
 
-    // Execute Eval^{FssFMI} algorithm
-    std::vector<uint32_t> result(qs);
-    if (party.GetId() == 0) {
-        fss_fmi.Evaluate(party, fmi_key, q, result);
-    } else {
-        fss_fmi.Evaluate(party, fmi_key, q, result);
+        // The queries of a batch have the same length, so the whole batch runs on one engine (and takes its key sets)
+        bool                                                                 direct = planner.Choose(length) == fmi::SearchEngine::kDirectScan;
+        std::vector<uint32_t>                                                sets   = direct ? ClaimKeySets(party, kFMIScanKeyPath_P0, kFMIScanKeyPath_P1, num, next_scan) : ClaimKeySets(party, kFMIKeyPath_P0, kFMIKeyPath_P1, num, next_fmi);
+        std::vector<fmi::DirectScanKey>                                      scan_keys(direct ? num : 0);
+        std::vector<fmi::FssFmiKey>                                          fmi_keys(direct ? 0 : num);
+        std::vector<std::unique_ptr<tools::secret_sharing::ProtocolSession>> sessions;
+        std::vector<const std::vector<uint32_t> *>                           outputs;
+        mux.Clear();
+        for (uint32_t i = 0; i < num; i++) {
+            std::vector<uint32_t> q(msg.begin() + 2 + i * length, msg.begin() + 2 + (i + 1) * length);
+            if (direct) {
+                LoadScanKeySet(party.GetId(), params, sets[i], scan_keys[i]);
+                auto session = std::make_unique<fmi::DirectScanSession>(scan, party.GetId(), scan_keys[i], q);
+                outputs.push_back(&session->GetOutput());
+                sessions.push_back(std::move(session));
+            } else {
+                cts_t ct;
+                LoadFMIKeySet(party.GetId(), params, sets[i], fmi_keys[i], ct);
+                q.resize(params.query_size, 0);
+                auto session = std::make_unique<fmi::FssFmiSession>(fss_fmi, party.GetId(), fmi_keys[i], ct, q, rank_batch.get());
+                outputs.push_back(&session->GetOutput());
+                sessions.push_back(std::move(session));
+            }
+            mux.AddSession(*sessions.back());
+        }
+        mux.Run();
+
+        out.clear();
+        for (const auto *output : outputs) {
+            out.insert(out.end(), output->begin(), output->begin() + length);
+        }
+        router.SendVector(out);
+        served += num;
+        for (auto &key : scan_keys) {
+            key.FreeDirectScanKey();
+        }
+        for (auto &key : fmi_keys) {
+            key.FreeFssFmiKey();
+        }
     }
-    return result;
+    utils::Logger::InfoLog(LOCATION, "Served " + std::to_string(served) + " queries");
+
+    router.CloseSocket();
+    party.EndCommunication();
+    registry.Detach(kFMIIndexName);
 }
 
 }    // namespace fss
@@ -9,6 +9,7 @@
 #ifndef FSSGATE_H_
 #define FSSGATE_H_
 
+#include <string>
 #include <vector>
 
 #include "../fss-gate/zt/zero_test_dpf.hpp"
@@ -16,15 +17,19 @@
 
 namespace fss {
 
+constexpr uint32_t kDefaultFMIKeySetNum = 1024;    // * The FMI search can answer this many queries before the setup is run again
+
 void ZeroTestSetup(const uint32_t bitsize = 32);
 void EqualitySetup(const uint32_t bitsize = 32);
-void CompareSetup(const uint32_t bitsize = 32);                                  // * 1 is x<y else 0 (ただし|x-y| < 2^(n-1)しか判定できない)
-void FMISearchSetup(const uint32_t bitsize, std::vector<uint32_t> &database);    // * MaxQuerySize is 2^7 = 128
+void CompareSetup(const uint32_t bitsize = 32);                                                                                      // * 1 is x<y else 0 (ただし|x-y| < 2^(n-1)しか判定できない)
+void FMISearchSetup(const uint32_t bitsize, std::vector<uint32_t> &database, const uint32_t key_set_num = kDefaultFMIKeySetNum);    // * MaxQuerySize is 2^7 = 128
+void FMISearchIngest(const uint32_t bitsize, const std::string &corpus_path, const uint32_t key_set_num = kDefaultFMIKeySetNum);    // * The database is the text of a corpus file ('0' and '1', the others are skipped)
 
 uint32_t              ZeroTest(tools::secret_sharing::Party &party, const uint32_t x, const uint32_t bitsize = 32);
 uint32_t              Equality(tools::secret_sharing::Party &party, const uint32_t x, const uint32_t y, const uint32_t bitsize = 32);
 uint32_t              Compare(tools::secret_sharing::Party &party, const uint32_t x, const uint32_t y, const uint32_t bitsize = 32);
 std::vector<uint32_t> FMISearch(tools::secret_sharing::Party &party, const std::vector<uint32_t> &q, const uint32_t bitsize = 32);
+void                  FMISearchServe(tools::secret_sharing::Party &party, const int query_port, const uint32_t bitsize = 32);    // * Answers the batches of comm::QueryRouter until it stops
 
 }    // namespace fss
 
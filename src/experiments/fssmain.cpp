@@ -6,14 +6,19 @@
  * @brief FssFMI implementation.
  */
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include <getopt.h>
 #include <iostream>
 #include <map>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "../comm/comm.hpp"
+#include "../comm/metrics_server.hpp"
+#include "../comm/query_router.hpp"
 #include "../tools/random_number_generator.hpp"
 #include "../tools/secret_sharing.hpp"
 #include "../tools/tools.hpp"
@@ -26,12 +31,20 @@ namespace {
 void DisplayHelp() {
     std::cout << "Usage:" << std::endl;
     std::cout << "    ./bin/fssmain <party_id> <exec_mode> [options]" << std::endl;
+    std::cout << "    ./bin/fssmain route -r <replica_file> [options]" << std::endl;
     std::cout << "\n<party_id> : Party id (0 or 1) is required" << std::endl;
-    std::cout << "<exec_mode> : Execution mode (setup or eval) is required" << std::endl;
+    std::cout << "<exec_mode> : Execution mode (setup, eval or serve) is required" << std::endl;
+    std::cout << "route : Send FMI queries to the replicas listed in <replica_file> (one '<name> <p0_address> <p0_port> <p1_address> <p1_port> <shard>' per line)" << std::endl;
     std::cout << "\noptions:" << std::endl;
     std::cout << "    -p, --port <port_number> : Specify port number (default: 55555)" << std::endl;
     std::cout << "    -s, --server <server_address> : Specify server address (default: 127.0.0.1)" << std::endl;
     std::cout << "    -o, --output <output_file> : Specify output file name" << std::endl;
+    std::cout << "    -M, --metrics <port_number> : Serve metrics in Prometheus format on 127.0.0.1 (default: disabled)" << std::endl;
+    std::cout << "    -q, --query-port <port_number> : Port for the query router in serve mode (default: 55556)" << std::endl;
+    std::cout << "    -r, --replicas <replica_file> : Replica list for route mode" << std::endl;
+    std::cout << "    -N, --queries <num> : Number of queries sent in route mode (default: 1024)" << std::endl;
+    std::cout << "    -c, --corpus <corpus_file> : Build the FMI database from a corpus of '0' and '1' in setup mode (default: random)" << std::endl;
+    std::cout << "    -K, --key-sets <num> : Number of FMI queries the setup generates keys for, each key set is used once (default: 1024)" << std::endl;
     std::cout << "    -h, --help : Display help message" << std::endl;
 }
 
@@ -42,6 +55,61 @@ void GenerateRandomNumbers(std::vector<uint32_t> &vec, const uint32_t bitsize) {
     }
 }
 
+int RouteQueries(const std::string &replica_file, const uint32_t query_num, const uint32_t bitsize) {
+    std::vector<comm::ReplicaInfo> replicas;
+    if (!comm::ReadReplicaListFromFile(replica_file, replicas) || replicas.empty()) {
+        std::cerr << "Failed to read the replica list: " << replica_file << "\n";
+        return EXIT_FAILURE;
+    }
+    std::vector<uint32_t> shards;
+    for (const auto &replica : replicas) {
+        if (std::find(shards.begin(), shards.end(), replica.shard) == shards.end()) {
+            shards.push_back(replica.shard);
+        }
+    }
+
+    tools::secret_sharing::AdditiveSecretSharing ss(bitsize);
+    comm::QueryRouter                            router(replicas, comm::kDefaultRouterBatchSize, false);
+    router.Start();
+
+    // Random binary queries (the database is a bit string), spread over the shards
+    constexpr uint32_t                          kQuerySize = 12;
+    std::vector<std::vector<uint32_t>>          queries(query_num, std::vector<uint32_t>(kQuerySize));
+    std::vector<std::future<comm::QueryShares>> results;
+    auto                                        start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < query_num; i++) {
+        GenerateRandomNumbers(queries[i], 1);
+        tools::secret_sharing::shares_t q_sh = ss.Share(queries[i]);
+        results.push_back(router.Submit(shards[i % shards.size()], q_sh.first, q_sh.second));
+    }
+    std::vector<uint32_t> m(kQuerySize);
+    for (uint32_t i = 0; i < query_num; i++) {
+        comm::QueryShares shares;
+        try {
+            shares = results[i].get();
+        } catch (const std::runtime_error &e) {
+            utils::Logger::ErrorLog(LOCATION, "Query " + std::to_string(i) + " failed: " + e.what());
+            router.Stop();
+            return EXIT_FAILURE;
+        }
+        for (uint32_t j = 0; j < kQuerySize; j++) {
+            m[j] = utils::Mod(shares.first[j] + shares.second[j], bitsize);
+        }
+        if (i == 0) {
+            utils::Logger::InfoLog(LOCATION, "Query : " + utils::VectorToStr(queries[i]));
+            utils::Logger::InfoLog(LOCATION, "Result: " + utils::VectorToStr(m));
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    router.Stop();
+
+    utils::Logger::InfoLog(LOCATION, "Answered " + std::to_string(query_num) + " queries in " + std::to_string(elapsed) + " s (" + std::to_string(query_num / elapsed) + " queries/s)");
+    for (uint32_t i = 0; i < router.GetReplicaNum(); i++) {
+        utils::Logger::InfoLog(LOCATION, "Replica " + replicas[i].name + ": " + std::to_string(router.GetServedQueryNum(i)) + " queries, " + std::to_string(router.GetLatencyEstimate(i)) + " us/query");
+    }
+    return EXIT_SUCCESS;
+}
+
 }    // namespace
 
 int main(int argc, char *argv[]) {
@@ -51,14 +119,26 @@ int main(int argc, char *argv[]) {
     int           party_id     = -1;
     std::string   exec_mode;
     std::string   output_file;
+    int           metrics_port = -1;
+    int           query_port   = comm::kDefaultPort + 1;
+    std::string   replica_file;
+    uint32_t      query_num = 1024;
+    std::string   corpus_file;
+    uint32_t      key_set_num = fss::kDefaultFMIKeySetNum;
     utils::FileIo io(false, ".log");
 
     // Command-line options
-    const char *const short_opts  = "p:s:o:h";
+    const char *const short_opts  = "p:s:o:M:q:r:N:c:K:h";
     const option      long_opts[] = {
         {"port", required_argument, nullptr, 'p'},
         {"server", required_argument, nullptr, 's'},
         {"output", required_argument, nullptr, 'o'},
+        {"metrics", required_argument, nullptr, 'M'},
+        {"query-port", required_argument, nullptr, 'q'},
+        {"replicas", required_argument, nullptr, 'r'},
+        {"queries", required_argument, nullptr, 'N'},
+        {"corpus", required_argument, nullptr, 'c'},
+        {"key-sets", required_argument, nullptr, 'K'},
         {"help", no_argument, nullptr, 'h'},
         {nullptr, no_argument, nullptr, 0}};
 
@@ -78,6 +158,24 @@ int main(int argc, char *argv[]) {
                 case 'o':
                     output_file = optarg;
                     break;
+                case 'M':
+                    metrics_port = std::stoi(optarg);
+                    break;
+                case 'q':
+                    query_port = std::stoi(optarg);
+                    break;
+                case 'r':
+                    replica_file = optarg;
+                    break;
+                case 'N':
+                    query_num = std::stoul(optarg);
+                    break;
+                case 'c':
+                    corpus_file = optarg;
+                    break;
+                case 'K':
+                    key_set_num = std::stoul(optarg);
+                    break;
                 case 'h':
                     DisplayHelp();
                     return EXIT_SUCCESS;
@@ -98,6 +196,15 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // The router is not a party
+    if (optind < argc && std::string(argv[optind]) == "route") {
+        if (replica_file.empty()) {
+            std::cerr << "A replica list (-r, --replicas) is required in route mode.\n";
+            return EXIT_FAILURE;
+        }
+        return RouteQueries(replica_file, query_num, 10);
+    }
+
     // Validate positional arguments
     if (optind + 1 < argc) {
         try {
@@ -107,8 +214,8 @@ int main(int argc, char *argv[]) {
                 return EXIT_FAILURE;
             }
             exec_mode = argv[optind + 1];
-            if (exec_mode != "setup" && exec_mode != "eval") {
-                std::cerr << "Invalid exec_mode. It must be 'setup' or 'eval'.\n";
+            if (exec_mode != "setup" && exec_mode != "eval" && exec_mode != "serve") {
+                std::cerr << "Invalid exec_mode. It must be 'setup', 'eval' or 'serve'.\n";
                 return EXIT_FAILURE;
             }
         } catch (const std::invalid_argument &) {
@@ -128,10 +235,16 @@ int main(int argc, char *argv[]) {
               << "Execution Mode: " << exec_mode << "\n"
               << "Port: " << port << "\n"
               << "Server Address: " << host_address << "\n"
-              << "Output File: " << (output_file.empty() ? "Not specified" : output_file) << "\n";
+              << "Output File: " << (output_file.empty() ? "Not specified" : output_file) << "\n"
+              << "Metrics Port: " << (metrics_port < 0 ? "Disabled" : std::to_string(metrics_port)) << "\n";
     // Placeholder for main logic
     std::cout << "Program execution starts here...\n\n";
 
+    comm::MetricsServer metrics_server(metrics_port, false);
+    if (metrics_port >= 0) {
+        metrics_server.Start();
+    }
+
     comm::CommInfo               comm_info(party_id, port, host_address);
     tools::secret_sharing::Party party(comm_info);
 
@@ -145,9 +258,13 @@ int main(int argc, char *argv[]) {
         fss::ZeroTestSetup(bitsize);
         fss::EqualitySetup(bitsize);
         fss::CompareSetup(bitsize);
-        std::vector<uint32_t> database(utils::Pow(2, bitsize) - 1);
-        GenerateRandomNumbers(database, 1);
-        fss::FMISearchSetup(bitsize, database);
+        if (corpus_file.empty()) {
+            std::vector<uint32_t> database(utils::Pow(2, bitsize) - 1);
+            GenerateRandomNumbers(database, 1);
+            fss::FMISearchSetup(bitsize, database, key_set_num);
+        } else {
+            fss::FMISearchIngest(bitsize, corpus_file, key_set_num);
+        }
 
     } else if (exec_mode == "eval") {
         // ################################
@@ -240,6 +357,11 @@ int main(int argc, char *argv[]) {
         }
         ss.Reconst(party, m_0, m_1, m);    // 実際はユーザが復元する部分
         utils::Logger::InfoLog(LOCATION, "Result: " + utils::VectorToStr(m));
+    } else if (exec_mode == "serve") {
+        // ################################
+        // ######### Serving ##############
+        // ################################
+        fss::FMISearchServe(party, query_port, bitsize);
     }
     utils::Logger::InfoLog(LOCATION, "Program execution ends here...\n");
 
@@ -6,6 +6,46 @@
 
 namespace primitives {
 
+TripleStore::TripleStore()
+    : cursor_(0) {
+}
+
+void TripleStore::Load(const std::string &file_path) {
+    tools::secret_sharing::ShareHandler sh;
+    if (!sh.LoadBTShare(file_path, this->triples_) || this->triples_.empty()) {
+        utils::Logger::FatalLog(LOCATION, "Failed to load the Beaver triples (" + file_path + ")");
+        exit(EXIT_FAILURE);
+    }
+    this->cursor_ = 0;
+}
+
+void TripleStore::Set(const tools::secret_sharing::bts_t &bt_vec) {
+    this->triples_ = bt_vec;
+    this->cursor_  = 0;
+}
+
+const tools::secret_sharing::BeaverTriplet &TripleStore::Next() {
+    this->CheckRemaining(1);
+    return this->triples_[this->cursor_++];
+}
+
+void TripleStore::Take(const size_t num, tools::secret_sharing::bts_t &bt_vec) {
+    this->CheckRemaining(num);
+    bt_vec.assign(this->triples_.begin() + this->cursor_, this->triples_.begin() + this->cursor_ + num);
+    this->cursor_ += num;
+}
+
+size_t TripleStore::Remaining() const {
+    return this->triples_.size() - this->cursor_;
+}
+
+void TripleStore::CheckRemaining(const size_t num) const {
+    if (this->Remaining() < num) {
+        utils::Logger::FatalLog(LOCATION, "Beaver triples are exhausted (requested: " + std::to_string(num) + ", remaining: " + std::to_string(this->Remaining()) + ")");
+        exit(EXIT_FAILURE);
+    }
+}
+
 uint32_t Add(uint32_t x, uint32_t y, const uint32_t bitsize) {
 
     uint32_t result = utils::Mod(x + y, bitsize);
@@ -13,55 +53,53 @@ uint32_t Add(uint32_t x, uint32_t y, const uint32_t bitsize) {
     return result;
 }
 
-uint32_t Mult(tools::secret_sharing::Party &party, uint32_t x, uint32_t y, const uint32_t bitsize) {
+uint32_t Mult(tools::secret_sharing::Party &party, TripleStore &triples, uint32_t x, uint32_t y, const uint32_t bitsize) {
 
     tools::secret_sharing::AdditiveSecretSharing ss(bitsize);
-    tools::secret_sharing::ShareHandler          sh;
-    tools::secret_sharing::BeaverTriplet         bt;
-
-    party.StartCommunication();
-
-    if (party.GetId() == 0) {
-        tools::secret_sharing::bts_t bt_vec_0(1);
-        sh.LoadBTShare("/home/matsuda/FssFMI/data/test/ss/bt_0", bt_vec_0);    // TODO: Change the path of the Beaver Triple dynamically
-        bt = bt_vec_0[0];
-    } else {
-        tools::secret_sharing::bts_t bt_vec_1(1);
-        sh.LoadBTShare("/home/matsuda/FssFMI/data/test/ss/bt_1", bt_vec_1);    // TODO: Change the path of the Beaver Triple dynamically
-        bt = bt_vec_1[0];
-    }
 
-    uint32_t result = ss.Mult(party, bt, x, y);
+    uint32_t result = ss.Mult(party, triples.Next(), x, y);
 
     return result;
 }
 
-uint32_t Select(tools::secret_sharing::Party &party, uint32_t b, uint32_t x, uint32_t y, const uint32_t bitsize) {
+uint32_t Select(tools::secret_sharing::Party &party, TripleStore &triples, uint32_t b, uint32_t x, uint32_t y, const uint32_t bitsize) {
     /*
     if b is 1, return x; otherwise, return y.
     Computes b(x-y) + y
     */
-    tools::secret_sharing::ShareHandler  sh;
-    tools::secret_sharing::BeaverTriplet bt;
-
-    party.StartCommunication();
-
-    if (party.GetId() == 0) {
-        tools::secret_sharing::bts_t bt_vec_0(1);
-        sh.LoadBTShare("/home/matsuda/FssFMI/data/test/ss/bt_0", bt_vec_0);    // TODO: Change the path following other codes
-        bt = bt_vec_0[0];
-    } else {
-        tools::secret_sharing::bts_t bt_vec_1(1);
-        sh.LoadBTShare("/home/matsuda/FssFMI/data/test/ss/bt_1", bt_vec_1);    // TODO: Change the path following other codes
-        bt = bt_vec_1[0];
-    }
 
     // Compute (x-y) mod 2^bitsize
     uint32_t delta  = utils::Mod(x - y, bitsize);
-    uint32_t z      = Mult(party, b, delta, bitsize);
+    uint32_t z      = Mult(party, triples, b, delta, bitsize);
     uint32_t result = Add(y, z, bitsize);
 
     return result;
 }
 
+void Add(const std::vector<uint32_t> &x, const std::vector<uint32_t> &y, std::vector<uint32_t> &z, const uint32_t bitsize) {
+    z.resize(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        z[i] = utils::Mod(x[i] + y[i], bitsize);
+    }
+}
+
+void Mult(tools::secret_sharing::Party &party, TripleStore &triples, const std::vector<uint32_t> &x, const std::vector<uint32_t> &y, std::vector<uint32_t> &z, const uint32_t bitsize) {
+    tools::secret_sharing::AdditiveSecretSharing ss(bitsize);
+    tools::secret_sharing::bts_t                 bt_vec;
+
+    triples.Take(x.size(), bt_vec);
+    z.resize(x.size());
+    ss.Mult(party, bt_vec, x, y, z);
+}
+
+void Select(tools::secret_sharing::Party &party, TripleStore &triples, const std::vector<uint32_t> &b, const std::vector<uint32_t> &x, const std::vector<uint32_t> &y, std::vector<uint32_t> &z, const uint32_t bitsize) {
+    // Compute (x-y) mod 2^bitsize
+    std::vector<uint32_t> delta(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        delta[i] = utils::Mod(x[i] - y[i], bitsize);
+    }
+    Mult(party, triples, b, delta, z, bitsize);
+    Add(y, z, z, bitsize);
+}
+
 }    // namespace primitives
@@ -1,14 +1,87 @@
 #ifndef PRIMITIVES_H_
 #define PRIMITIVES_H_
 
+#include <string>
+#include <vector>
+
 #include "../comm/comm.hpp"
 #include "../tools/secret_sharing.hpp"
 
 namespace primitives {
 
+/**
+ * @brief Session-level store of the Beaver triple shares.
+ *
+ * The triples are loaded once per session and consumed through a cursor,
+ * so each multiplication takes the next unused triple without touching the file system.
+ */
+class TripleStore {
+public:
+    TripleStore();
+
+    /**
+     * @brief Loads the Beaver triple shares of this party and resets the cursor (exits if the file is missing, broken or empty).
+     * @param file_path The path to the Beaver triple shares (without the extension).
+     */
+    void Load(const std::string &file_path);
+
+    /**
+     * @brief Sets the Beaver triple shares of this party and resets the cursor.
+     * @param bt_vec The Beaver triple shares.
+     */
+    void Set(const tools::secret_sharing::bts_t &bt_vec);
+
+    /**
+     * @brief Consumes the next Beaver triple.
+     * @return The Beaver triple share.
+     */
+    const tools::secret_sharing::BeaverTriplet &Next();
+
+    /**
+     * @brief Consumes the next `num` Beaver triples.
+     * @param num The number of Beaver triples.
+     * @param bt_vec The consumed Beaver triple shares.
+     */
+    void Take(const size_t num, tools::secret_sharing::bts_t &bt_vec);
+
+    /**
+     * @brief Gets the number of unused Beaver triples.
+     * @return The number of unused Beaver triples.
+     */
+    size_t Remaining() const;
+
+private:
+    tools::secret_sharing::bts_t triples_; /**< The Beaver triple shares of this party. */
+    size_t                       cursor_;  /**< The index of the next unused Beaver triple. */
+
+    /**
+     * @brief Aborts if less than `num` Beaver triples are left.
+     */
+    void CheckRemaining(const size_t num) const;
+};
+
 uint32_t Add(uint32_t x, uint32_t y, const uint32_t bitsize = 32);
-uint32_t Mult(tools::secret_sharing::Party &party, uint32_t x, uint32_t y, const uint32_t bitsize = 32);
-uint32_t Select(tools::secret_sharing::Party &party, uint32_t b, uint32_t x, uint32_t y, const uint32_t bitsize = 32);
+uint32_t Mult(tools::secret_sharing::Party &party, TripleStore &triples, uint32_t x, uint32_t y, const uint32_t bitsize = 32);
+uint32_t Select(tools::secret_sharing::Party &party, TripleStore &triples, uint32_t b, uint32_t x, uint32_t y, const uint32_t bitsize = 32);
+
+/**
+ * @brief Element-wise addition of the shares: z[i] = x[i] + y[i].
+ */
+void Add(const std::vector<uint32_t> &x, const std::vector<uint32_t> &y, std::vector<uint32_t> &z, const uint32_t bitsize = 32);
+
+/**
+ * @brief Element-wise multiplication of the shares: z[i] = x[i] * y[i].
+ *
+ * All operands are opened in one message, so the call takes a single round for any length.
+ */
+void Mult(tools::secret_sharing::Party &party, TripleStore &triples, const std::vector<uint32_t> &x, const std::vector<uint32_t> &y, std::vector<uint32_t> &z, const uint32_t bitsize = 32);
+
+/**
+ * @brief Element-wise selection of the shares: z[i] = b[i] ? x[i] : y[i].
+ *
+ * Computed as b[i] * (x[i] - y[i]) + y[i] with a single vector multiplication (one round).
+ */
+void Select(tools::secret_sharing::Party &party, TripleStore &triples, const std::vector<uint32_t> &b, const std::vector<uint32_t> &x, const std::vector<uint32_t> &y, std::vector<uint32_t> &z, const uint32_t bitsize = 32);
 
 }    // namespace primitives
 
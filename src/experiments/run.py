@@ -91,12 +91,53 @@ def run_server_client_mode(name, func_mode, port=None, server=None, show_client_
     # print(f"Server process for '{name}' with func_mode = {func_mode} terminated.")
 
 
+def run_setup(corpus=None, key_sets=None):
+    """
+    Generate the keys of all gates. The FMI database is the text of the corpus file if given, otherwise a random text.
+    Each FMI query consumes one key set, so key_sets must cover the queries served until the next setup.
+    """
+    cmd = ["./bin/fssmain", "0", "setup"]
+    if corpus:
+        cmd.extend(["-c", corpus])
+    if key_sets:
+        cmd.extend(["-K", str(key_sets)])
+    subprocess.run(cmd, check=True)
+
+
+def run_replicas(num_replicas, num_queries, port=None, replica_file="data/replicas.txt"):
+    """
+    Launch num_replicas party pairs in serve mode on this host, then route the queries across them.
+    Each replica uses its own party port (port + 10 * r) and query ports (port + 10 * r + 1, + 2).
+    """
+    base = port if port else 56000
+    with open(replica_file, "w") as f:
+        for r in range(num_replicas):
+            p = base + 10 * r
+            f.write(f"r{r} 127.0.0.1 {p + 1} 127.0.0.1 {p + 2} 0\n")
+
+    servers = []
+    for party_id in [0, 1]:
+        for r in range(num_replicas):
+            p = base + 10 * r
+            cmd = ["./bin/fssmain", str(party_id), "serve", "-p", str(p), "-q", str(p + 1 + party_id)]
+            servers.append(subprocess.Popen(cmd, stdout=subprocess.DEVNULL))
+        time.sleep(1)  # Party 0 listens before party 1 connects
+
+    subprocess.run(["./bin/fssmain", "route", "-r", replica_file, "-N", str(num_queries)])
+    for process in servers:
+        process.wait()
+
+
 def main():
     parser = argparse.ArgumentParser(description='Run fssmain with specific options.')
     parser.add_argument('--port', type=int, help='Port number')
     parser.add_argument('--server', type=str, help='Server address')
     parser.add_argument('--show_client_output', action='store_true', help='Show client output')
     parser.add_argument('-u', '--unit_test', action='store_true', help='Run unit test')
+    parser.add_argument('--replicas', type=int, help='Serve FMI queries with this number of local replicas')
+    parser.add_argument('--queries', type=int, help='Number of queries routed to the replicas (default: 1024)')
+    parser.add_argument('--corpus', type=str, help='Ingest this corpus file (\'0\' and \'1\') as the FMI database before serving')
+    parser.add_argument('--key_sets', type=int, help='Run the setup with keys for this number of FMI queries (default: 1024)')
 
     args = parser.parse_args()
 
@@ -104,6 +145,13 @@ def main():
         parser.print_help()
         return
 
+    if args.corpus or args.key_sets:
+        run_setup(args.corpus, args.key_sets)
+
+    if args.replicas:
+        run_replicas(args.replicas, args.queries or 1024, port=args.port)
+        return
+
     if args.unit_test:
         run_standalone_program(0, "test", 1, port=args.port, server=args.server, name="fileio")
         run_server_client_mode("comm", 1, port=args.port, server=args.server, show_client_output=args.show_client_output)
@@ -8,6 +8,8 @@
 
 #include "distributed_comparison_function.hpp"
 
+#include <algorithm>
+
 #include "../../utils/logger.hpp"
 #include "../../utils/utils.hpp"
 #include "../prg/prg.hpp"
@@ -272,6 +274,138 @@ uint32_t DistributedComparisonFunction::EvaluateAt(const DcfKey &key, const uint
     return output;
 }
 
+void DistributedComparisonFunction::EvaluateAt(const std::vector<const DcfKey *> &keys, const std::vector<uint32_t> &x, std::vector<uint32_t> &outputs) const {
+    uint32_t n = this->params_.input_bitsize;
+    uint32_t e = this->params_.element_bitsize;
+    if (keys.size() != x.size()) {
+        utils::Logger::FatalLog(LOCATION, "The number of keys and points does not match");
+        exit(EXIT_FAILURE);
+    }
+    outputs.resize(x.size());
+
+    std::array<Block, kDcfLockstepWidth>    seeds, seeds_left, seeds_right, values_left, values_right;
+    std::array<bool, kDcfLockstepWidth>     control_bits;
+    std::array<uint32_t, kDcfLockstepWidth> values;
+    for (size_t base = 0; base < x.size(); base += kDcfLockstepWidth) {
+        size_t width = std::min<size_t>(kDcfLockstepWidth, x.size() - base);
+
+        // The unused lanes of the last group repeat the first seed
+        for (size_t j = 0; j < kDcfLockstepWidth; j++) {
+            seeds[j]        = keys[base + std::min(j, width - 1)]->init_seed;
+            control_bits[j] = keys[base + std::min(j, width - 1)]->party_id != 0;
+            values[j]       = 0;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            prg_seed_left.Evaluate(seeds, seeds_left);
+            prg_seed_right.Evaluate(seeds, seeds_right);
+            prg_value_left.Evaluate(seeds, values_left);
+            prg_value_right.Evaluate(seeds, values_right);
+
+            for (size_t j = 0; j < width; j++) {
+                const DcfKey         &key             = *keys[base + j];
+                const CorrectionWord &correction_word = key.correction_words[i];
+                bool                  current_bit     = (x[base + j] & (1 << (n - i - 1))) != 0;
+                Block                 next_seed       = current_bit ? seeds_right[j] : seeds_left[j];
+                bool                  next_control    = Lsb(next_seed);
+                const Block          &value_block     = current_bit ? values_right[j] : values_left[j];
+
+                values[j] += utils::Pow(-1, key.party_id) * (value_block.Convert(e) + (control_bits[j] * correction_word.value));
+                values[j] = utils::Mod(values[j], e);
+                if (control_bits[j]) {
+                    next_seed = next_seed ^ correction_word.seed;
+                    next_control ^= current_bit ? correction_word.control_right : correction_word.control_left;
+                }
+                seeds[j]        = next_seed;
+                control_bits[j] = next_control;
+            }
+        }
+
+        for (size_t j = 0; j < width; j++) {
+            const DcfKey &key    = *keys[base + j];
+            uint32_t      output = values[j] + (utils::Pow(-1, key.party_id) * (seeds[j].Convert(e) + (control_bits[j] * key.output)));
+            outputs[base + j]    = utils::Mod(output, e);
+        }
+    }
+}
+
+void DistributedComparisonFunction::EvaluateFullDomain(const DcfKey &key, uint32_t *outputs) const {
+    uint32_t n           = this->params_.input_bitsize;
+    uint32_t e           = this->params_.element_bitsize;
+    uint32_t top_bitsize = (n > kDcfSubtreeBits) ? n - kDcfSubtreeBits : 0;
+    uint32_t sub_bitsize = n - top_bitsize;
+    size_t   top_num     = static_cast<size_t>(1) << top_bitsize;
+    size_t   sub_num     = static_cast<size_t>(1) << sub_bitsize;
+
+    // Expand the top levels into the roots of the subtrees
+    std::vector<Block>    top_seeds(top_num), sub_seeds(sub_num);
+    std::vector<uint8_t>  top_control_bits(top_num), sub_control_bits(sub_num);
+    std::vector<uint32_t> top_values(top_num);
+    top_seeds[0]        = key.init_seed;
+    top_control_bits[0] = key.party_id != 0;
+    top_values[0]       = 0;
+    for (uint32_t i = 0; i < top_bitsize; i++) {
+        this->ExpandLevel(key, i, static_cast<size_t>(1) << i, top_seeds.data(), top_control_bits.data(), top_values.data());
+    }
+
+    // Expand each subtree with its values accumulated in the outputs
+    for (size_t r = 0; r < top_num; r++) {
+        uint32_t *values    = outputs + r * sub_num;
+        sub_seeds[0]        = top_seeds[r];
+        sub_control_bits[0] = top_control_bits[r];
+        values[0]           = top_values[r];
+        for (uint32_t i = 0; i < sub_bitsize; i++) {
+            this->ExpandLevel(key, top_bitsize + i, static_cast<size_t>(1) << i, sub_seeds.data(), sub_control_bits.data(), values);
+        }
+        for (size_t x = 0; x < sub_num; x++) {
+            uint32_t output = values[x] + (utils::Pow(-1, key.party_id) * (sub_seeds[x].Convert(e) + (sub_control_bits[x] * key.output)));
+            values[x]       = utils::Mod(output, e);
+        }
+    }
+}
+
+void DistributedComparisonFunction::EvaluateFullDomain(const DcfKey &key, std::vector<uint32_t> &outputs) const {
+    outputs.resize(utils::Pow(2, this->params_.input_bitsize));
+    this->EvaluateFullDomain(key, outputs.data());
+}
+
+void DistributedComparisonFunction::ExpandLevel(const DcfKey &key, const uint32_t current_tree_level, const size_t num, Block *seeds, uint8_t *control_bits, uint32_t *values) const {
+    uint32_t              e               = this->params_.element_bitsize;
+    const CorrectionWord &correction_word = key.correction_words[current_tree_level];
+
+    std::array<Block, kDcfLockstepWidth>    parent_seeds, seeds_left, seeds_right, values_left, values_right;
+    std::array<uint8_t, kDcfLockstepWidth>  parent_control_bits;
+    std::array<uint32_t, kDcfLockstepWidth> parent_values;
+    for (size_t group = (num + kDcfLockstepWidth - 1) / kDcfLockstepWidth; group-- > 0;) {
+        size_t base  = group * kDcfLockstepWidth;
+        size_t width = std::min<size_t>(kDcfLockstepWidth, num - base);
+
+        // The unused lanes of a partial group repeat its first node
+        for (size_t j = 0; j < kDcfLockstepWidth; j++) {
+            size_t node            = base + ((j < width) ? j : 0);
+            parent_seeds[j]        = seeds[node];
+            parent_control_bits[j] = control_bits[node];
+            parent_values[j]       = values[node];
+        }
+        prg_seed_left.Evaluate(parent_seeds, seeds_left);
+        prg_seed_right.Evaluate(parent_seeds, seeds_right);
+        prg_value_left.Evaluate(parent_seeds, values_left);
+        prg_value_right.Evaluate(parent_seeds, values_right);
+
+        for (size_t j = 0; j < width; j++) {
+            size_t left        = 2 * (base + j), right = left + 1;
+            bool   control_bit = parent_control_bits[j] != 0;
+
+            values[left]        = utils::Mod(parent_values[j] + utils::Pow(-1, key.party_id) * (values_left[j].Convert(e) + (control_bit * correction_word.value)), e);
+            values[right]       = utils::Mod(parent_values[j] + utils::Pow(-1, key.party_id) * (values_right[j].Convert(e) + (control_bit * correction_word.value)), e);
+            control_bits[left]  = Lsb(seeds_left[j]) ^ (control_bit & correction_word.control_left);
+            control_bits[right] = Lsb(seeds_right[j]) ^ (control_bit & correction_word.control_right);
+            seeds[left]         = control_bit ? (seeds_left[j] ^ correction_word.seed) : seeds_left[j];
+            seeds[right]        = control_bit ? (seeds_right[j] ^ correction_word.seed) : seeds_right[j];
+        }
+    }
+}
+
 void DistributedComparisonFunction::EvaluateNextSeed(
     const uint32_t current_tree_level, const CorrectionWord &correction_word,
     const Block &current_seed, const bool current_control_bit,
@@ -17,6 +17,9 @@
 namespace fss {
 namespace dcf {
 
+constexpr uint32_t kDcfLockstepWidth = 8;     // The number of points expanded by one PRG call
+constexpr uint32_t kDcfSubtreeBits   = 12;    // The leaves of a subtree expanded at a time by the full domain evaluation
+
 /**
  * @struct DcfParameters
  * @brief A struct to hold params for the Distributed Comparison Function (DCF).
@@ -161,6 +164,38 @@ public:
      */
     uint32_t EvaluateAt(const DcfKey &key, const uint32_t x) const;
 
+    /**
+     * @brief Evaluate the DCF at many points in lockstep.
+     *
+     * The points are walked down the tree level by level in groups of `kDcfLockstepWidth`,
+     * so the PRG expands the seeds of a whole group in one pipelined call.
+     * The keys may differ between the points (e.g. one key per input of a batch).
+     *
+     * @param keys The DCF keys (keys[i] is evaluated at x[i]).
+     * @param x The points at which to evaluate the DCF.
+     * @param outputs The evaluation results (same size as x).
+     */
+    void EvaluateAt(const std::vector<const DcfKey *> &keys, const std::vector<uint32_t> &x, std::vector<uint32_t> &outputs) const;
+
+    /**
+     * @brief Evaluate the DCF over the full domain.
+     *
+     * The top levels of the tree are expanded breadth first into the roots of subtrees of 2^kDcfSubtreeBits leaves,
+     * then each subtree is expanded breadth first in place, `kDcfLockstepWidth` nodes per PRG call. The buffers hold
+     * one subtree, and the values of its leaves are accumulated in the outputs directly.
+     *
+     * @param key The DCF key to use for evaluation.
+     * @param outputs The evaluation results in domain order (size: 2^input_bitsize).
+     */
+    void EvaluateFullDomain(const DcfKey &key, uint32_t *outputs) const;
+
+    /**
+     * @brief Evaluate the DCF over the full domain.
+     * @param key The DCF key to use for evaluation.
+     * @param outputs The evaluation results in domain order (resized to 2^input_bitsize).
+     */
+    void EvaluateFullDomain(const DcfKey &key, std::vector<uint32_t> &outputs) const;
+
 private:
     const DcfParameters params_; /**< Parameters for the DistributedComparisonFunction. */
 
@@ -183,6 +218,21 @@ private:
         const uint32_t current_tree_level, const CorrectionWord &correction_word,
         const Block &current_seed, const bool current_control_bit,
         std::array<Block, 2> &expanded_seeds, std::array<Block, 2> &expanded_values, std::array<bool, 2> &expanded_control_bits) const;
+
+    /**
+     * @brief Expand the first `num` nodes of a tree level in place into the 2 * num nodes of the next level.
+     *
+     * The children of the node j are the nodes 2j and 2j + 1, so the groups are expanded from the last one
+     * and no parent is overwritten before it is read.
+     *
+     * @param key The DCF key to use for evaluation.
+     * @param current_tree_level The level of the nodes.
+     * @param num The number of nodes.
+     * @param seeds The seeds of the nodes (size: 2 * num).
+     * @param control_bits The control bits of the nodes (size: 2 * num).
+     * @param values The accumulated values of the nodes (size: 2 * num).
+     */
+    void ExpandLevel(const DcfKey &key, const uint32_t current_tree_level, const size_t num, Block *seeds, uint8_t *control_bits, uint32_t *values) const;
 };
 
 namespace test {
@@ -17,11 +17,15 @@ namespace dcf {
 namespace test {
 
 bool Test_EvaluateSinglePoint(const TestInfo &test_info);
+bool Test_EvaluateLockstep(const TestInfo &test_info);
+bool Test_EvaluateFullDomain(const TestInfo &test_info);
 
 void Test_Dcf(TestInfo &test_info) {
     std::vector<std::string> modes = {
         "DCF unit tests",
         "EvaluateSinglePoint",
+        "EvaluateLockstep",
+        "EvaluateFullDomain",
     };
     uint32_t selected_mode = test_info.mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
@@ -33,8 +37,14 @@ void Test_Dcf(TestInfo &test_info) {
     if (selected_mode == 1) {
         test_info.dbg_info.debug = false;
         utils::PrintTestResult("Test_EvaluateSinglePoint", Test_EvaluateSinglePoint(test_info));
+        utils::PrintTestResult("Test_EvaluateLockstep", Test_EvaluateLockstep(test_info));
+        utils::PrintTestResult("Test_EvaluateFullDomain", Test_EvaluateFullDomain(test_info));
     } else if (selected_mode == 2) {
         utils::PrintTestResult("Test_EvaluateSinglePoint", Test_EvaluateSinglePoint(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_EvaluateLockstep", Test_EvaluateLockstep(test_info));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_EvaluateFullDomain", Test_EvaluateFullDomain(test_info));
     }
     utils::PrintText(utils::kDash);
 }
@@ -81,6 +91,84 @@ bool Test_EvaluateSinglePoint(const TestInfo &test_info) {
     return result;
 }
 
+bool Test_EvaluateLockstep(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        DcfParameters                 params(size, size, test_info.dbg_info);
+        uint32_t                      n = params.input_bitsize;
+        uint32_t                      e = params.element_bitsize;
+        DistributedComparisonFunction dcf(params);
+
+        // Three keys with random alpha, each evaluated at random points (not a multiple of the lockstep width)
+        constexpr uint32_t                     kKeyNum = 3, kPointNum = 13;
+        std::vector<std::pair<DcfKey, DcfKey>> dcf_keys;
+        std::vector<uint32_t>                  alpha(kKeyNum), beta(kKeyNum);
+        for (uint32_t k = 0; k < kKeyNum; k++) {
+            alpha[k] = utils::Mod(tools::rng::SecureRng::Rand64(), n);
+            beta[k]  = utils::Mod(tools::rng::SecureRng::Rand64(), e);
+            dcf_keys.push_back(dcf.GenerateKeys(alpha[k], beta[k]));
+        }
+
+        std::vector<const DcfKey *> keys_0, keys_1;
+        std::vector<uint32_t>       x, key_index, res_0, res_1;
+        for (uint32_t k = 0; k < kKeyNum; k++) {
+            for (uint32_t i = 0; i < kPointNum; i++) {
+                keys_0.push_back(&dcf_keys[k].first);
+                keys_1.push_back(&dcf_keys[k].second);
+                x.push_back(utils::Mod(tools::rng::SecureRng::Rand64(), n));
+                key_index.push_back(k);
+            }
+        }
+        dcf.EvaluateAt(keys_0, x, res_0);
+        dcf.EvaluateAt(keys_1, x, res_1);
+
+        for (size_t i = 0; i < x.size(); i++) {
+            uint32_t k        = key_index[i];
+            uint32_t expected = (x[i] < alpha[k]) ? beta[k] : 0;
+            result &= (res_0[i] == dcf.EvaluateAt(dcf_keys[k].first, x[i])) && (res_1[i] == dcf.EvaluateAt(dcf_keys[k].second, x[i]));
+            result &= (utils::Mod(res_0[i] + res_1[i], e) == expected);
+        }
+        utils::Logger::DebugLog(LOCATION, "Input size: " + std::to_string(n) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+
+        for (auto &keys : dcf_keys) {
+            keys.first.FreeDcfKey();
+            keys.second.FreeDcfKey();
+        }
+    }
+    return result;
+}
+
+bool Test_EvaluateFullDomain(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        DcfParameters                 params(size, size, test_info.dbg_info);
+        uint32_t                      n = params.input_bitsize;
+        uint32_t                      e = params.element_bitsize;
+        DistributedComparisonFunction dcf(params);
+
+        // The ends of the domain and a random alpha
+        for (const uint32_t alpha : {0U, utils::Pow(2, n) - 1, utils::Mod(tools::rng::SecureRng::Rand64(), n)}) {
+            uint32_t                  beta     = utils::Mod(tools::rng::SecureRng::Rand64(), e);
+            std::pair<DcfKey, DcfKey> dcf_keys = dcf.GenerateKeys(alpha, beta);
+
+            std::vector<uint32_t> res_0, res_1;
+            dcf.EvaluateFullDomain(dcf_keys.first, res_0);
+            dcf.EvaluateFullDomain(dcf_keys.second, res_1);
+            for (uint32_t x = 0; x < res_0.size(); x++) {
+                result &= (utils::Mod(res_0[x] + res_1[x], e) == ((x < alpha) ? beta : 0));
+            }
+            // The shares are the ones of the single point evaluation
+            uint32_t x = utils::Mod(tools::rng::SecureRng::Rand64(), n);
+            result &= (res_0[x] == dcf.EvaluateAt(dcf_keys.first, x)) && (res_1[x] == dcf.EvaluateAt(dcf_keys.second, x));
+
+            dcf_keys.first.FreeDcfKey();
+            dcf_keys.second.FreeDcfKey();
+        }
+        utils::Logger::DebugLog(LOCATION, "Input size: " + std::to_string(n) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
 }    // namespace test
 }    // namespace dcf
 }    // namespace fss
@@ -0,0 +1,383 @@
+/**
+ * @file distributed_key_gen.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-06
+ * @copyright Copyright (c) 2024
+ * @brief DistributedKeyGen implementation.
+ */
+
+#include "distributed_key_gen.hpp"
+
+#include <cstring>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+#include "../../utils/timer.hpp"
+#include "../../utils/utils.hpp"
+#include "../prg/prg.hpp"
+
+namespace {
+
+// Pseudorandom generators of the tree (the same as those of DistributedPointFunction)
+static const fss::prg::PRG prg_seed_left  = fss::prg::PRG::Create(fss::kPrgKeySeedLeft);
+static const fss::prg::PRG prg_seed_right = fss::prg::PRG::Create(fss::kPrgKeySeedRight);
+
+constexpr uint32_t kBlockWords = 4;    // The number of 32-bit words of a block
+
+utils::Counter &DistributedGenKeyCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_dpf_distributed_gen_keys_total", "Number of DPF keys generated by the two-party protocol.");
+    return counter;
+}
+
+utils::Histogram &DistributedGenBatchLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_dpf_distributed_gen_batch_seconds", "Latency of the two-party generation of a batch of DPF keys including the communication rounds.");
+    return histogram;
+}
+
+void AppendBlock(const fss::Block &block, std::vector<uint32_t> &words) {
+    words.push_back(_mm_extract_epi32(block, 0));
+    words.push_back(_mm_extract_epi32(block, 1));
+    words.push_back(_mm_extract_epi32(block, 2));
+    words.push_back(_mm_extract_epi32(block, 3));
+}
+
+fss::Block ReadBlock(const uint32_t *words) {
+    return fss::Block(words[3], words[2], words[1], words[0]);
+}
+
+fss::Block RandomBlock() {
+    fss::Block block;
+    block.SetRandom();
+    return block;
+}
+
+// Expand every node of a level into its children (8 seeds per PRG call)
+void ExpandLevel(const std::vector<fss::Block> &seeds, std::vector<fss::Block> &children) {
+    size_t size = seeds.size();
+    children.resize(2 * size);
+    size_t j = 0;
+    for (; j + 8 <= size; j += 8) {
+        std::array<fss::Block, 8> current, left, right;
+        std::copy(seeds.begin() + j, seeds.begin() + j + 8, current.begin());
+        prg_seed_left.Evaluate(current, left);
+        prg_seed_right.Evaluate(current, right);
+        for (size_t k = 0; k < 8; k++) {
+            children[2 * (j + k)]     = left[k];
+            children[2 * (j + k) + 1] = right[k];
+        }
+    }
+    for (; j < size; j++) {
+        prg_seed_left.Evaluate(seeds[j], children[2 * j]);
+        prg_seed_right.Evaluate(seeds[j], children[2 * j + 1]);
+    }
+}
+
+}    // namespace
+
+namespace fss {
+namespace dpf {
+
+DistributedKeyGen::DistributedKeyGen(const DpfParameters params)
+    : params_(params), output_num_(utils::Pow(2, params.input_bitsize - params.terminate_bitsize)) {
+    if (this->output_num_ != 4 && this->output_num_ != 8 && this->output_num_ != 16) {
+        utils::Logger::FatalLog(LOCATION, "Unsupported number of outputs per leaf: " + std::to_string(this->output_num_) + " (element size: " + std::to_string(params.element_bitsize) + ")");
+        exit(EXIT_FAILURE);
+    }
+}
+
+std::pair<std::vector<DpfGenCorrelation>, std::vector<DpfGenCorrelation>> DistributedKeyGen::GenerateCorrelations(const uint32_t key_num) const {
+    uint32_t nu = this->params_.terminate_bitsize;
+    uint32_t e  = this->params_.element_bitsize;
+    uint32_t m  = this->params_.input_bitsize - nu;
+
+    std::pair<std::vector<DpfGenCorrelation>, std::vector<DpfGenCorrelation>> corrs;
+    corrs.first.resize(key_num);
+    corrs.second.resize(key_num);
+    for (uint32_t k = 0; k < key_num; k++) {
+        DpfGenCorrelation &c_0 = corrs.first[k];
+        DpfGenCorrelation &c_1 = corrs.second[k];
+
+        // Bit-block triples: (u, V, u * V)
+        for (uint32_t i = 0; i < nu; i++) {
+            uint32_t u   = tools::rng::SecureRng::Rand32() & 1U;
+            Block    v   = RandomBlock();
+            Block    w   = u ? v : zero_block;
+            uint32_t u_0 = tools::rng::SecureRng::Rand32() & 1U;
+            Block    v_0 = RandomBlock();
+            Block    w_0 = RandomBlock();
+            c_0.mask_bits.push_back(u_0);
+            c_1.mask_bits.push_back(u ^ u_0);
+            c_0.mask_blocks.push_back(v_0);
+            c_1.mask_blocks.push_back(v ^ v_0);
+            c_0.product_blocks.push_back(w_0);
+            c_1.product_blocks.push_back(w ^ w_0);
+        }
+
+        // One-hot vector e_r
+        uint32_t r      = utils::Mod(tools::rng::SecureRng::Rand32(), m);
+        c_0.one_hot_pos = utils::Mod(tools::rng::SecureRng::Rand32(), m);
+        c_1.one_hot_pos = r ^ c_0.one_hot_pos;
+        c_0.one_hot.resize(this->output_num_);
+        c_1.one_hot.resize(this->output_num_);
+        for (uint32_t j = 0; j < this->output_num_; j++) {
+            c_0.one_hot[j] = utils::Mod(tools::rng::SecureRng::Rand32(), e);
+            c_1.one_hot[j] = utils::Mod((j == r ? 1 : 0) - c_0.one_hot[j], e);
+        }
+
+        // Scalar-vector triple: (a, B, a * B)
+        uint32_t a = utils::Mod(tools::rng::SecureRng::Rand32(), e);
+        c_0.scalar = utils::Mod(tools::rng::SecureRng::Rand32(), e);
+        c_1.scalar = utils::Mod(a - c_0.scalar, e);
+        c_0.vec.resize(this->output_num_);
+        c_1.vec.resize(this->output_num_);
+        c_0.product.resize(this->output_num_);
+        c_1.product.resize(this->output_num_);
+        for (uint32_t j = 0; j < this->output_num_; j++) {
+            uint32_t b     = utils::Mod(tools::rng::SecureRng::Rand32(), e);
+            c_0.vec[j]     = utils::Mod(tools::rng::SecureRng::Rand32(), e);
+            c_1.vec[j]     = utils::Mod(b - c_0.vec[j], e);
+            c_0.product[j] = utils::Mod(tools::rng::SecureRng::Rand32(), e);
+            c_1.product[j] = utils::Mod(a * b - c_0.product[j], e);
+        }
+    }
+    return corrs;
+}
+
+void DistributedKeyGen::SerializeCorrelations(const std::vector<DpfGenCorrelation> &corrs, std::vector<uint32_t> &words) const {
+    words.clear();
+    words.push_back(corrs.size());
+    for (const DpfGenCorrelation &c : corrs) {
+        for (uint32_t i = 0; i < this->params_.terminate_bitsize; i++) {
+            words.push_back(c.mask_bits[i]);
+            AppendBlock(c.mask_blocks[i], words);
+            AppendBlock(c.product_blocks[i], words);
+        }
+        words.push_back(c.one_hot_pos);
+        words.insert(words.end(), c.one_hot.begin(), c.one_hot.end());
+        words.push_back(c.scalar);
+        words.insert(words.end(), c.vec.begin(), c.vec.end());
+        words.insert(words.end(), c.product.begin(), c.product.end());
+    }
+}
+
+bool DistributedKeyGen::DeserializeCorrelations(const std::vector<uint32_t> &words, std::vector<DpfGenCorrelation> &corrs) const {
+    uint32_t nu      = this->params_.terminate_bitsize;
+    size_t   per_key = nu * (1 + 2 * kBlockWords) + 2 + 3 * this->output_num_;
+    if (words.empty() || words.size() != 1 + words[0] * per_key) {
+        utils::Logger::ErrorLog(LOCATION, "The size of the correlations does not match the parameters (" + std::to_string(words.size()) + " words)");
+        return false;
+    }
+    corrs.assign(words[0], DpfGenCorrelation());
+    const uint32_t *p = words.data() + 1;
+    for (DpfGenCorrelation &c : corrs) {
+        for (uint32_t i = 0; i < nu; i++) {
+            c.mask_bits.push_back(p[0] & 1U);
+            c.mask_blocks.push_back(ReadBlock(p + 1));
+            c.product_blocks.push_back(ReadBlock(p + 1 + kBlockWords));
+            p += 1 + 2 * kBlockWords;
+        }
+        c.one_hot_pos = *p++;
+        c.one_hot.assign(p, p + this->output_num_);
+        p += this->output_num_;
+        c.scalar = *p++;
+        c.vec.assign(p, p + this->output_num_);
+        p += this->output_num_;
+        c.product.assign(p, p + this->output_num_);
+        p += this->output_num_;
+    }
+    return true;
+}
+
+uint32_t DistributedKeyGen::GetRoundNum() const {
+    // The offsets of the one-hot vectors are opened with the first level (or alone if there is no level)
+    uint32_t nu = this->params_.terminate_bitsize;
+    return 2 * nu + 2 + (nu == 0 ? 1 : 0);
+}
+
+void DistributedKeyGen::GenerateKeys(tools::secret_sharing::Party &party, const std::vector<DpfGenCorrelation> &corrs, const std::vector<uint32_t> &alpha_sh, const uint32_t beta, std::vector<DpfKey> &keys) const {
+    uint32_t n       = this->params_.input_bitsize;
+    uint32_t e       = this->params_.element_bitsize;
+    uint32_t nu      = this->params_.terminate_bitsize;
+    uint32_t m       = n - nu;
+    uint32_t num     = this->output_num_;
+    uint32_t id      = party.GetId();
+    size_t   key_num = alpha_sh.size();
+    if (corrs.size() < key_num) {
+        utils::Logger::FatalLog(LOCATION, "Not enough correlations: " + std::to_string(corrs.size()) + " < " + std::to_string(key_num));
+        exit(EXIT_FAILURE);
+    }
+    utils::HistogramTimer latency(DistributedGenBatchLatency());
+
+    // Draw the root of the tree of this party
+    keys.clear();
+    keys.resize(key_num);
+    std::vector<std::vector<Block>>   seeds(key_num), children(key_num);
+    std::vector<std::vector<uint8_t>> control_bits(key_num), child_bits(key_num);
+    for (size_t k = 0; k < key_num; k++) {
+        keys[k].Initialize(this->params_, id);
+        keys[k].init_seed = RandomBlock();
+        seeds[k].assign(1, keys[k].init_seed);
+        control_bits[k].assign(1, static_cast<uint8_t>(id));
+    }
+
+    // The offsets alpha_hat ^ r of the one-hot vectors
+    std::array<std::vector<uint32_t>, 2> offsets;
+    offsets[id].resize(key_num);
+    for (size_t k = 0; k < key_num; k++) {
+        offsets[id][k] = utils::GetLowerNBits(alpha_sh[k], m) ^ corrs[k].one_hot_pos;
+    }
+    if (nu == 0) {
+        party.SendRecv(offsets[0], offsets[1]);
+    }
+
+    std::array<std::vector<uint32_t>, 2> msg;
+    std::vector<Block>                   right_sums(key_num), diffs(key_num);
+    std::vector<uint32_t>                alpha_bits(key_num);
+    std::vector<std::array<uint32_t, 2>> child_bit_sums(key_num);
+    for (uint32_t i = 0; i < nu; i++) {
+        // Expand every node and sum the children (the nodes off the path of alpha cancel out)
+        msg[id].clear();
+        for (size_t k = 0; k < key_num; k++) {
+            ExpandLevel(seeds[k], children[k]);
+            child_bits[k].resize(children[k].size());
+            Block                   left_sum = zero_block, right_sum = zero_block;
+            std::array<uint32_t, 2> bit_sums = {0, 0};
+            for (size_t j = 0; j < seeds[k].size(); j++) {
+                child_bits[k][2 * j]     = Lsb(children[k][2 * j]);
+                child_bits[k][2 * j + 1] = Lsb(children[k][2 * j + 1]);
+                left_sum                 = left_sum ^ children[k][2 * j];
+                right_sum                = right_sum ^ children[k][2 * j + 1];
+                bit_sums[kLeft] ^= child_bits[k][2 * j];
+                bit_sums[kRight] ^= child_bits[k][2 * j + 1];
+            }
+            right_sums[k]     = right_sum;
+            diffs[k]          = left_sum ^ right_sum;
+            child_bit_sums[k] = bit_sums;
+            alpha_bits[k]     = (alpha_sh[k] >> (n - i - 1)) & 1U;
+
+            // Round 1: open alpha_i ^ u and (L ^ R) ^ V
+            msg[id].push_back(alpha_bits[k] ^ corrs[k].mask_bits[i]);
+            AppendBlock(diffs[k] ^ corrs[k].mask_blocks[i], msg[id]);
+        }
+        if (i == 0) {
+            msg[id].insert(msg[id].end(), offsets[id].begin(), offsets[id].end());
+        }
+        msg[1 - id].clear();
+        party.SendRecv(msg[0], msg[1]);
+        if (i == 0) {
+            offsets[1 - id].assign(msg[1 - id].end() - key_num, msg[1 - id].end());
+        }
+
+        // Round 2: open the correction words (the seed is R ^ alpha_i * (L ^ R), the lose child of the path)
+        std::vector<uint32_t> opened(msg[0].size());
+        for (size_t w = 0; w < 5 * key_num; w++) {
+            opened[w] = msg[0][w] ^ msg[1][w];
+        }
+        std::array<std::vector<uint32_t>, 2> cw_msg;
+        for (size_t k = 0; k < key_num; k++) {
+            const DpfGenCorrelation &c       = corrs[k];
+            uint32_t                 e_bit   = opened[5 * k] & 1U;
+            Block                    f_block = ReadBlock(opened.data() + 5 * k + 1);
+            Block                    product = c.product_blocks[i] ^ (zero_and_all_one[e_bit] & c.mask_blocks[i]) ^ (zero_and_all_one[c.mask_bits[i]] & f_block);
+            if (id == 0) {
+                product = product ^ (zero_and_all_one[e_bit] & f_block);
+            }
+            uint32_t control_left  = child_bit_sums[k][kLeft] ^ alpha_bits[k] ^ (id == 0 ? 1U : 0U);
+            uint32_t control_right = child_bit_sums[k][kRight] ^ alpha_bits[k];
+            cw_msg[id].push_back(control_left | (control_right << 1));
+            AppendBlock(right_sums[k] ^ product, cw_msg[id]);
+        }
+        party.SendRecv(cw_msg[0], cw_msg[1]);
+
+        // Apply the correction words to the children of the nodes with a control bit
+        for (size_t k = 0; k < key_num; k++) {
+            CorrectionWord cw;
+            uint32_t       cw_bits = cw_msg[0][5 * k] ^ cw_msg[1][5 * k];
+            cw.seed                = ReadBlock(cw_msg[0].data() + 5 * k + 1) ^ ReadBlock(cw_msg[1].data() + 5 * k + 1);
+            cw.control_left        = cw_bits & 1U;
+            cw.control_right       = (cw_bits >> 1) & 1U;
+            keys[k].correction_words[i] = cw;
+            for (size_t j = 0; j < seeds[k].size(); j++) {
+                uint8_t t = control_bits[k][j];
+                Block   mask = zero_and_all_one[t];
+                children[k][2 * j]     = children[k][2 * j] ^ (mask & cw.seed);
+                children[k][2 * j + 1] = children[k][2 * j + 1] ^ (mask & cw.seed);
+                child_bits[k][2 * j] ^= t & cw.control_left;
+                child_bits[k][2 * j + 1] ^= t & cw.control_right;
+            }
+            std::swap(seeds[k], children[k]);
+            std::swap(control_bits[k], child_bits[k]);
+        }
+    }
+
+    // The output correction word (-1)^t * V with V = beta * e_{alpha_hat} - conv(s_0) + conv(s_1)
+    // (-1)^t = t_0 - t_1 is the difference of the numbers of leaves with a control bit (the other leaves are the same)
+    std::array<std::vector<uint32_t>, 2> masked;
+    std::vector<uint32_t>                signs(key_num);
+    std::vector<std::vector<uint32_t>>   values(key_num, std::vector<uint32_t>(num));
+    for (size_t k = 0; k < key_num; k++) {
+        const DpfGenCorrelation &c = corrs[k];
+        std::vector<uint32_t>    sums;
+        uint32_t                 count  = this->SumLeaves(seeds[k], control_bits[k], sums);
+        uint32_t                 offset = offsets[0][k] ^ offsets[1][k];
+        signs[k]                        = utils::Mod(id == 0 ? count : -count, e);
+        masked[id].push_back(utils::Mod(signs[k] - c.scalar, e));
+        for (uint32_t j = 0; j < num; j++) {
+            values[k][j] = utils::Mod((id == 0 ? -sums[j] : sums[j]) + beta * c.one_hot[j ^ offset], e);
+            masked[id].push_back(utils::Mod(values[k][j] - c.vec[j], e));
+        }
+    }
+    party.SendRecv(masked[0], masked[1]);
+
+    std::array<std::vector<uint32_t>, 2> outputs;
+    for (size_t k = 0; k < key_num; k++) {
+        const DpfGenCorrelation &c = corrs[k];
+        size_t                   base = k * (num + 1);
+        uint32_t                 d    = masked[0][base] + masked[1][base];
+        for (uint32_t j = 0; j < num; j++) {
+            uint32_t f = masked[0][base + 1 + j] + masked[1][base + 1 + j];
+            uint32_t z = c.product[j] + d * c.vec[j] + c.scalar * f + (id == 0 ? d * f : 0);
+            outputs[id].push_back(utils::Mod(z, e));
+        }
+    }
+    party.SendRecv(outputs[0], outputs[1]);
+    for (size_t k = 0; k < key_num; k++) {
+        std::vector<uint32_t> lanes(num);
+        for (uint32_t j = 0; j < num; j++) {
+            lanes[j] = utils::Mod(outputs[0][k * num + j] + outputs[1][k * num + j], e);
+        }
+        keys[k].output = this->PackLanes(lanes);
+    }
+    DistributedGenKeyCounter().Increment(key_num);
+}
+
+uint32_t DistributedKeyGen::SumLeaves(const std::vector<Block> &seeds, const std::vector<uint8_t> &control_bits, std::vector<uint32_t> &sums) const {
+    // Lane-wise additions wrap around at the width of the lanes, which keeps the sums mod 2^element_bitsize
+    __m128i  acc   = zero_block;
+    uint32_t count = 0;
+    for (size_t j = 0; j < seeds.size(); j++) {
+        if (this->output_num_ == 4) {
+            acc = _mm_add_epi32(acc, seeds[j]);
+        } else if (this->output_num_ == 8) {
+            acc = _mm_add_epi16(acc, seeds[j]);
+        } else {
+            acc = _mm_add_epi8(acc, seeds[j]);
+        }
+        count += control_bits[j];
+    }
+    sums = Block(acc).ConvertVec(this->output_num_, this->params_.element_bitsize);
+    return count;
+}
+
+Block DistributedKeyGen::PackLanes(const std::vector<uint32_t> &lanes) const {
+    uint32_t width = 16 / this->output_num_;    // Bytes per lane
+    uint8_t  bytes[16];
+    for (uint32_t j = 0; j < this->output_num_; j++) {
+        std::memcpy(bytes + j * width, &lanes[j], width);
+    }
+    return Block(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes)));
+}
+
+}    // namespace dpf
+}    // namespace fss
@@ -0,0 +1,137 @@
+/**
+ * @file distributed_key_gen.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-06
+ * @copyright Copyright (c) 2024
+ * @brief DistributedKeyGen class (two-party generation of DPF keys for a secret-shared alpha).
+ */
+
+#ifndef DPF_DISTRIBUTED_KEY_GEN_H_
+#define DPF_DISTRIBUTED_KEY_GEN_H_
+
+#include "../../tools/secret_sharing.hpp"
+#include "distributed_point_function.hpp"
+
+namespace fss {
+namespace dpf {
+
+/**
+ * @struct DpfGenCorrelation
+ * @brief The share of one party of the input-independent correlations consumed by the generation of one DPF key.
+ */
+struct DpfGenCorrelation {
+    std::vector<uint32_t> mask_bits;      /**< XOR shares of the bits u of the bit-block triples (one per level). */
+    std::vector<Block>    mask_blocks;    /**< XOR shares of the blocks V of the bit-block triples. */
+    std::vector<Block>    product_blocks; /**< XOR shares of u * V. */
+    uint32_t              one_hot_pos;    /**< XOR share of the position r of the one-hot vector. */
+    std::vector<uint32_t> one_hot;        /**< Additive shares of the one-hot vector e_r (one per leaf output). */
+    uint32_t              scalar;         /**< Additive share of a of the scalar-vector triple. */
+    std::vector<uint32_t> vec;            /**< Additive shares of B of the scalar-vector triple. */
+    std::vector<uint32_t> product;        /**< Additive shares of a * B. */
+
+    /**
+     * @brief Default constructor for DpfGenCorrelation.
+     */
+    DpfGenCorrelation()
+        : one_hot_pos(0), scalar(0){};
+};
+
+/**
+ * @class DistributedKeyGen
+ * @brief Generation of the keys of DistributedPointFunction by the two parties, without a party that knows alpha.
+ *
+ * The parties hold XOR shares of alpha and a public beta, and each draws the root seed of its own key. Level by level
+ * (Doerner-shelat), each party expands every node of its tree and sums the left and the right children: the nodes
+ * off the path of alpha are the same in both trees and cancel out, so the sums give the shares of the children of the
+ * path. The seed correction word, the lose child of the path, is selected by alpha_i with one bit-block triple, and the
+ * control bit corrections are linear in alpha_i; both are opened in two rounds per level, batched over all the keys.
+ * After the last level, the output correction word (-1)^t * (beta * e_{alpha_hat} - conv(s_0) + conv(s_1)) is
+ * computed from the sums of the leaves: the sign is the difference of the numbers of leaves with a control bit,
+ * e_{alpha_hat} is a rotation of a shared one-hot vector and the product takes one scalar-vector triple.
+ * The keys are the same as those of DistributedPointFunction::GenerateKeys and are evaluated with it.
+ * The correlations do not depend on alpha and can be prepared ahead (see GenerateCorrelations).
+ * Each party expands its whole tree: O(2^terminate_bitsize) PRG calls per key, 2 * terminate_bitsize + 2 rounds per batch.
+ */
+class DistributedKeyGen {
+public:
+    /**
+     * @brief Constructor for DistributedKeyGen.
+     * @param params The parameters for the DPF (4, 8 or 16 outputs per leaf, i.e. element bitsize 5 to 32).
+     */
+    DistributedKeyGen(const DpfParameters params);
+
+    /**
+     * @brief Generate the shares of the correlations of a batch of keys.
+     * @param key_num The number of keys.
+     * @return The shares of party 0 and party 1.
+     */
+    std::pair<std::vector<DpfGenCorrelation>, std::vector<DpfGenCorrelation>> GenerateCorrelations(const uint32_t key_num) const;
+
+    /**
+     * @brief Serialize the correlations of a party.
+     * @param corrs The correlations.
+     * @param words The serialized correlations.
+     */
+    void SerializeCorrelations(const std::vector<DpfGenCorrelation> &corrs, std::vector<uint32_t> &words) const;
+
+    /**
+     * @brief Deserialize the correlations of a party.
+     * @param words The serialized correlations.
+     * @param corrs The correlations.
+     * @return `true` if the words hold correlations of these parameters.
+     */
+    bool DeserializeCorrelations(const std::vector<uint32_t> &words, std::vector<DpfGenCorrelation> &corrs) const;
+
+    /**
+     * @brief Retrieves the number of communication rounds of GenerateKeys.
+     * @return The number of rounds.
+     */
+    uint32_t GetRoundNum() const;
+
+    /**
+     * @brief Generate the key of this party for every alpha of a batch (both parties call it together).
+     * @param party The party object.
+     * @param corrs The correlations of this party (one per key).
+     * @param alpha_sh The XOR shares of the alphas.
+     * @param beta The public beta.
+     * @param keys The DPF keys of this party.
+     */
+    void GenerateKeys(tools::secret_sharing::Party &party, const std::vector<DpfGenCorrelation> &corrs, const std::vector<uint32_t> &alpha_sh, const uint32_t beta, std::vector<DpfKey> &keys) const;
+
+private:
+    const DpfParameters params_;     /**< Parameters for DistributedPointFunction. */
+    const uint32_t      output_num_; /**< The number of outputs per leaf (2^(input_bitsize - terminate_bitsize)). */
+
+    /**
+     * @brief Compute the sums of the leaves of a tree.
+     * @param seeds The seeds of the leaves.
+     * @param control_bits The control bits of the leaves.
+     * @param sums The lane-wise sum of the seeds (mod 2^element_bitsize).
+     * @return The number of leaves with a control bit.
+     */
+    uint32_t SumLeaves(const std::vector<Block> &seeds, const std::vector<uint8_t> &control_bits, std::vector<uint32_t> &sums) const;
+
+    /**
+     * @brief Pack the outputs of a leaf into a block.
+     * @param lanes The outputs (size: output_num_).
+     * @return The block.
+     */
+    Block PackLanes(const std::vector<uint32_t> &lanes) const;
+};
+
+namespace test {
+
+void Test_DistributedKeyGen(tools::secret_sharing::Party &party, TestInfo &test_info);
+
+}    // namespace test
+
+namespace bench {
+
+void Bench_DistributedKeyGen(tools::secret_sharing::Party &party, const BenchInfo &bench_info);
+
+}    // namespace bench
+
+}    // namespace dpf
+}    // namespace fss
+
+#endif    // DPF_DISTRIBUTED_KEY_GEN_H_
@@ -0,0 +1,101 @@
+/**
+ * @file distributed_key_gen_bench.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-06
+ * @copyright Copyright (c) 2024
+ * @brief DistributedKeyGen benchmark implementation.
+ */
+
+#include "distributed_key_gen.hpp"
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/memory.hpp"
+#include "../../utils/timer.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+constexpr uint32_t kBenchElementSize = 32;
+
+}    // namespace
+
+namespace fss {
+namespace dpf {
+namespace bench {
+
+void Bench_DistributedKeyGen(tools::secret_sharing::Party &party, const BenchInfo &bench_info) {
+    // Define utilities
+    utils::ExecutionTimer timer_all, timer_1;
+    utils::MemoryMonitor  mem_1;
+
+    std::vector<std::string> modes         = {"Measurement of the generation of the correlations", "Measurement of execute DistributedKeyGen"};
+    uint32_t                 selected_mode = bench_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    for (const auto t : bench_info.text_size) {
+        for (const auto q : bench_info.query_size) {
+            for (uint32_t i = 0; i < bench_info.experiment_num; i++) {
+                uint32_t          key_num = utils::Pow(2, q);
+                DpfParameters     params(t, kBenchElementSize, bench_info.dbg_info);
+                DistributedKeyGen dkg(params);
+                utils::Logger::InfoLog(LOCATION, "DistributedKeyGen: (domain size, key num) = (" + std::to_string(t) + ", " + std::to_string(key_num) + ")");
+
+                // Measure total time
+                std::string mode_str     = "[" + modes[selected_mode - 1] + "],";
+                std::string measure_info = "Info,Domain size,Key num,Time";
+                utils::Logger::InfoLog(LOCATION, mode_str + measure_info);
+                measure_info = "," + std::to_string(t) + "," + std::to_string(key_num);
+                timer_all.Start();
+                // ############# START #############
+
+                // Each party generates its own correlations (the keys are not checked here)
+                timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
+                mem_1.Start();
+                timer_1.Start();
+                std::pair<std::vector<DpfGenCorrelation>, std::vector<DpfGenCorrelation>> corrs = dkg.GenerateCorrelations(key_num);
+                if (selected_mode == 1) {
+                    double time = timer_1.Print(LOCATION, mode_str + "Generate correlations" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Generate correlations" + measure_info);
+                    utils::Logger::InfoLog(LOCATION, mode_str + "Keys per second" + measure_info + "," + utils::DoubleToStr(key_num / (time * 1e-6)));
+
+                } else if (selected_mode == 2) {
+                    // Start communication
+                    party.StartCommunication();
+
+                    std::vector<uint32_t> alpha_sh(key_num);
+                    for (uint32_t j = 0; j < key_num; j++) {
+                        alpha_sh[j] = utils::Mod(tools::rng::SecureRng::Rand32(), t);
+                    }
+                    std::vector<DpfKey> keys;
+                    uint64_t            bytes_before = party.GetTotalBytesSent();
+                    mem_1.Start();
+                    timer_1.Start();
+                    dkg.GenerateKeys(party, (party.GetId() == 0) ? corrs.first : corrs.second, alpha_sh, 1, keys);
+                    double time = timer_1.Print(LOCATION, mode_str + "Execute DistributedKeyGen" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Execute DistributedKeyGen" + measure_info);
+                    utils::Logger::InfoLog(LOCATION, mode_str + "Keys per second" + measure_info + "," + utils::DoubleToStr(key_num / (time * 1e-6)));
+                    utils::Logger::InfoLog(LOCATION, mode_str + "Rounds,Bytes sent" + measure_info + "," + std::to_string(dkg.GetRoundNum()) + "," + std::to_string(party.GetTotalBytesSent() - bytes_before));
+                    for (DpfKey &key : keys) {
+                        key.FreeDpfKey();
+                    }
+                    party.OutputTotalBytesSent(measure_info);
+                }
+
+                // ############# END #############
+                double timer_res = timer_all.Print(LOCATION, mode_str + "Bench Total time" + measure_info);
+                if (utils::ExecutionTimer::IsExceedLimitTime(timer_res, bench_info.limit_time_ms, timer_all.GetTimeUnit())) {
+                    utils::Logger::InfoLog(LOCATION, "The execution time exceeds the limit time: " + std::to_string(timer_res) + " " + timer_all.GetTimeUnitStr());
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+}
+
+}    // namespace bench
+}    // namespace dpf
+}    // namespace fss
@@ -0,0 +1,183 @@
+/**
+ * @file distributed_key_gen_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-06
+ * @copyright Copyright (c) 2024
+ * @brief DistributedKeyGen test implementation.
+ */
+
+#include "distributed_key_gen.hpp"
+
+#include <thread>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/file_io.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+const std::string kCurrentPath         = utils::GetCurrentDirectory();
+const std::string kTestDkgPath         = kCurrentPath + "/data/test/dkg/";
+const std::string kDkgCorrPath_P0      = kTestDkgPath + "corr_0_";
+const std::string kDkgCorrPath_P1      = kTestDkgPath + "corr_1_";
+const std::string kDkgAlphaPath        = kTestDkgPath + "alpha_";
+const std::string kDkgAlphaSharePath_0 = kTestDkgPath + "alpha_sh_0_";
+const std::string kDkgAlphaSharePath_1 = kTestDkgPath + "alpha_sh_1_";
+const std::string kDkgBetaPath         = kTestDkgPath + "beta_";
+
+const std::vector<uint32_t> kTestElementSizes = {8, 16, 20, 32};
+constexpr uint32_t          kNumOfElement     = 10;
+
+// The full-domain evaluation supports these parameters
+bool IsTestable(const fss::dpf::DpfParameters &params) {
+    uint32_t n = params.input_bitsize, m = n - params.terminate_bitsize;
+    return n < 9 || m == 2 || (m == 3 && n < 17);
+}
+
+}    // namespace
+
+namespace fss {
+namespace dpf {
+namespace test {
+
+bool Test_DistributedKeyGenOffline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_DistributedKeyGenOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+
+void Test_DistributedKeyGen(tools::secret_sharing::Party &party, TestInfo &test_info) {
+    std::vector<std::string> modes         = {"DistributedKeyGen unit tests", "DistributedKeyGenOffline", "DistributedKeyGenOnline"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        if (party.GetId() == 0) {
+            utils::PrintTestResult("Test_DistributedKeyGenOffline", Test_DistributedKeyGenOffline(party, test_info));
+        } else {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        utils::PrintTestResult("Test_DistributedKeyGenOnline", Test_DistributedKeyGenOnline(party, test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_DistributedKeyGenOffline", Test_DistributedKeyGenOffline(party, test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_DistributedKeyGenOnline", Test_DistributedKeyGenOnline(party, test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_DistributedKeyGenOffline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        for (const auto e : kTestElementSizes) {
+            DpfParameters params(size, e, test_info.dbg_info);
+            if (!IsTestable(params)) {
+                continue;
+            }
+            DistributedKeyGen dkg(params);
+            utils::FileIo     io;
+            std::string       file_option = std::to_string(size) + "_" + std::to_string(e);
+
+            // Generate the correlations and check the serialization
+            std::pair<std::vector<DpfGenCorrelation>, std::vector<DpfGenCorrelation>> corrs = dkg.GenerateCorrelations(kNumOfElement);
+            std::vector<uint32_t>                                                     words_0, words_1, words;
+            std::vector<DpfGenCorrelation>                                            corrs_0;
+            dkg.SerializeCorrelations(corrs.first, words_0);
+            dkg.SerializeCorrelations(corrs.second, words_1);
+            result &= dkg.DeserializeCorrelations(words_0, corrs_0);
+            dkg.SerializeCorrelations(corrs_0, words);
+            result &= (words == words_0);
+            words.pop_back();
+            result &= !dkg.DeserializeCorrelations(words, corrs_0);
+
+            // Generate the alphas (the ends of the domain included) and their XOR shares
+            std::vector<uint32_t> alpha(kNumOfElement), alpha_sh_0(kNumOfElement), alpha_sh_1(kNumOfElement);
+            for (uint32_t i = 0; i < kNumOfElement; i++) {
+                alpha[i]      = utils::Mod(tools::rng::SecureRng::Rand32(), size);
+                alpha_sh_0[i] = utils::Mod(tools::rng::SecureRng::Rand32(), size);
+            }
+            alpha[0] = 0;
+            alpha[1] = utils::Pow(2, size) - 1;
+            for (uint32_t i = 0; i < kNumOfElement; i++) {
+                alpha_sh_1[i] = alpha[i] ^ alpha_sh_0[i];
+            }
+            uint32_t beta = utils::Mod(tools::rng::SecureRng::Rand32(), e) | 1U;
+
+            io.WriteVectorToFile(kDkgCorrPath_P0 + file_option, words_0);
+            io.WriteVectorToFile(kDkgCorrPath_P1 + file_option, words_1);
+            io.WriteVectorToFile(kDkgAlphaPath + file_option, alpha);
+            io.WriteVectorToFile(kDkgAlphaSharePath_0 + file_option, alpha_sh_0);
+            io.WriteVectorToFile(kDkgAlphaSharePath_1 + file_option, alpha_sh_1);
+            io.WriteValueToFile(kDkgBetaPath + file_option, beta);
+        }
+        utils::Logger::DebugLog(LOCATION, "Domain size: " + std::to_string(size) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_DistributedKeyGenOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool            result = true;
+    uint32_t        id     = party.GetId();
+    utils::Counter &rounds = utils::MetricsRegistry::GetInstance().GetCounter("fss_comm_rounds_total", "Number of communication rounds (SendRecv calls and Send/Recv pairs).");
+    party.StartCommunication();
+    for (const auto size : test_info.domain_size) {
+        for (const auto e : kTestElementSizes) {
+            DpfParameters params(size, e, test_info.dbg_info);
+            if (!IsTestable(params)) {
+                continue;
+            }
+            DistributedKeyGen                            dkg(params);
+            DistributedPointFunction                     dpf(params);
+            tools::secret_sharing::AdditiveSecretSharing ss(e);
+            utils::FileIo                                io;
+            std::string                                  file_option = std::to_string(size) + "_" + std::to_string(e);
+
+            // Read the correlations and the inputs
+            std::vector<uint32_t>          words, alpha, alpha_sh;
+            std::vector<DpfGenCorrelation> corrs;
+            uint32_t                       beta;
+            io.ReadVectorFromFile((id == 0 ? kDkgCorrPath_P0 : kDkgCorrPath_P1) + file_option, words);
+            io.ReadVectorFromFile(kDkgAlphaPath + file_option, alpha);
+            io.ReadVectorFromFile((id == 0 ? kDkgAlphaSharePath_0 : kDkgAlphaSharePath_1) + file_option, alpha_sh);
+            io.ReadValueFromFile(kDkgBetaPath + file_option, beta);
+            result &= dkg.DeserializeCorrelations(words, corrs);
+
+            // Generate the keys together
+            std::vector<DpfKey> keys;
+            uint64_t            rounds_before = rounds.Value();
+            dkg.GenerateKeys(party, corrs, alpha_sh, beta, keys);
+            result &= (rounds.Value() - rounds_before == dkg.GetRoundNum());
+
+            // Evaluate the keys and open the outputs in one round
+            uint32_t              domain = utils::Pow(2, size);
+            std::vector<uint32_t> y_sh, y_other(kNumOfElement * domain), y(kNumOfElement * domain);
+            for (uint32_t i = 0; i < kNumOfElement; i++) {
+                std::vector<uint32_t> outputs(domain);
+                dpf.EvaluateFullDomain(keys[i], outputs);
+                y_sh.insert(y_sh.end(), outputs.begin(), outputs.end());
+                result &= (keys[i].party_id == id);
+            }
+            if (id == 0) {
+                ss.Reconst(party, y_sh, y_other, y);
+            } else {
+                ss.Reconst(party, y_other, y_sh, y);
+            }
+            for (uint32_t i = 0; i < kNumOfElement; i++) {
+                for (uint32_t x = 0; x < domain; x++) {
+                    result &= (y[i * domain + x] == (x == alpha[i] ? beta : 0));
+                }
+                keys[i].FreeDpfKey();
+            }
+            utils::Logger::DebugLog(LOCATION, "(n, e)=(" + std::to_string(size) + ", " + std::to_string(e) + "), Result: " + std::to_string(result), test_info.dbg_info.debug);
+        }
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace dpf
+}    // namespace fss
@@ -11,6 +11,7 @@
 #include <algorithm>
 
 #include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
 #include "../../utils/timer.hpp"
 #include "../../utils/utils.hpp"
 #include "../prg/prg.hpp"
@@ -21,6 +22,27 @@ namespace {
 static const fss::prg::PRG prg_seed_left  = fss::prg::PRG::Create(fss::kPrgKeySeedLeft);
 static const fss::prg::PRG prg_seed_right = fss::prg::PRG::Create(fss::kPrgKeySeedRight);
 
+// Metrics of the DPF evaluation (the number of AES blocks counts the PRG calls of the tree expansion)
+utils::Counter &EvalPointCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_dpf_eval_point_total", "Number of DPF evaluations at a single point.");
+    return counter;
+}
+
+utils::Counter &EvalFullDomainCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_dpf_eval_full_domain_total", "Number of DPF full domain evaluations.");
+    return counter;
+}
+
+utils::Counter &AesBlockCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_dpf_aes_blocks_total", "Number of AES blocks computed by the DPF evaluation.");
+    return counter;
+}
+
+utils::Histogram &EvalFullDomainLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_dpf_eval_full_domain_seconds", "Latency of a DPF full domain evaluation.");
+    return histogram;
+}
+
 }    // namespace
 
 namespace fss {
@@ -180,6 +202,9 @@ uint32_t DistributedPointFunction::EvaluateAt(const DpfKey &key, const uint32_t
 #endif
     }
 
+    EvalPointCounter().Increment();
+    AesBlockCounter().Increment(2 * nu);
+
     // Calculate the final output based on the DPF protocol.
     Block    output_block = ComputeOutputBlock(seed, control_bit, key);
     uint32_t x_hat        = utils::GetLowerNBits(x, n - nu);
@@ -191,8 +216,20 @@ uint32_t DistributedPointFunction::EvaluateAt(const DpfKey &key, const uint32_t
 }
 
 void DistributedPointFunction::EvaluateFullDomain(const DpfKey &key, std::vector<uint32_t> &outputs) const {
+    this->EvaluateFullDomain(key, outputs.data());
+}
+
+void DistributedPointFunction::EvaluateFullDomain(const DpfKey &key, utils::HugeVector<uint32_t> &outputs) const {
+    outputs.resize(utils::Pow(2, this->params_.input_bitsize));
+    this->EvaluateFullDomain(key, outputs.data());
+}
+
+void DistributedPointFunction::EvaluateFullDomain(const DpfKey &key, uint32_t *outputs) const {
     uint32_t n  = this->params_.input_bitsize;
     uint32_t nu = this->params_.terminate_bitsize;
+    utils::HistogramTimer latency(EvalFullDomainLatency());
+    EvalFullDomainCounter().Increment();
+    AesBlockCounter().Increment((static_cast<uint64_t>(1) << (nu + 1)) - 2);
 
     if (n < 9) {
         FullDomainNonRecursive(key, outputs);
@@ -206,10 +243,105 @@ void DistributedPointFunction::EvaluateFullDomain(const DpfKey &key, std::vector
     }
 }
 
+void DistributedPointFunction::EvaluateFullDomainAccumulate(const DpfKey &key, std::vector<uint32_t> &accumulator) const {
+    if (accumulator.size() < utils::Pow(2, this->params_.input_bitsize)) {
+        utils::Logger::FatalLog(LOCATION, "The accumulator is smaller than the domain: " + std::to_string(accumulator.size()));
+        exit(EXIT_FAILURE);
+    }
+    this->EvaluateFullDomainAccumulate(key, accumulator.data());
+}
+
+void DistributedPointFunction::EvaluateFullDomainAccumulate(const DpfKey &key, utils::HugeVector<uint32_t> &accumulator) const {
+    if (accumulator.size() < utils::Pow(2, this->params_.input_bitsize)) {
+        utils::Logger::FatalLog(LOCATION, "The accumulator is smaller than the domain: " + std::to_string(accumulator.size()));
+        exit(EXIT_FAILURE);
+    }
+    this->EvaluateFullDomainAccumulate(key, accumulator.data());
+}
+
+void DistributedPointFunction::EvaluateFullDomainAccumulate(const DpfKey &key, uint32_t *accumulator) const {
+    uint32_t n  = this->params_.input_bitsize;
+    uint32_t nu = this->params_.terminate_bitsize;
+
+    if (n - nu != 2 || nu < 3) {
+        // Unpacked outputs
+        std::vector<uint32_t> outputs(utils::Pow(2, n));
+        this->EvaluateFullDomain(key, outputs.data());
+        for (size_t i = 0; i < outputs.size(); i++) {
+            accumulator[i] += outputs[i];
+        }
+        return;
+    }
+    utils::HistogramTimer latency(EvalFullDomainLatency());
+    EvalFullDomainCounter().Increment();
+    AesBlockCounter().Increment((static_cast<uint64_t>(1) << (nu + 1)) - 2);
+
+    // Expand the first three levels into 8 subtrees (in place, from the last node of the level)
+    std::array<Block, 8> start_seeds;
+    std::array<bool, 8>  start_control_bits = {false, false, false, false, false, false, false, false};
+    std::array<Block, 2> expanded_seeds;
+    std::array<bool, 2>  expanded_control_bits;
+    start_seeds[0]        = key.init_seed;
+    start_control_bits[0] = key.party_id != 0;
+    for (uint32_t i = 0; i < 3; i++) {
+        for (int32_t j = (1 << i) - 1; j >= 0; j--) {
+            EvaluateNextSeed(i, key.correction_words[i], start_seeds[j], start_control_bits[j], expanded_seeds, expanded_control_bits);
+            start_seeds[2 * j]            = expanded_seeds[kLeft];
+            start_seeds[2 * j + 1]        = expanded_seeds[kRight];
+            start_control_bits[2 * j]     = expanded_control_bits[kLeft];
+            start_control_bits[2 * j + 1] = expanded_control_bits[kRight];
+        }
+    }
+
+    // Traverse the 8 subtrees together; the leaf idx of subtree k is the output block (k * 2^(nu - 3) + idx)
+    uint32_t idx       = 0;
+    uint32_t depth     = 0;
+    uint32_t depth_end = nu - 3;
+    uint32_t end       = utils::Pow(2, depth_end);
+    __m128i *blocks    = reinterpret_cast<__m128i *>(accumulator);
+
+    std::vector<std::array<Block, 8>> prev_seeds(depth_end + 1);
+    std::vector<std::array<bool, 8>>  prev_control_bits(depth_end + 1);
+    std::array<Block, 8>              next_seeds;
+    prev_seeds[0]        = start_seeds;
+    prev_control_bits[0] = start_control_bits;
+
+    while (idx != end) {
+        while (depth != depth_end) {
+            bool                       keep         = (idx >> (depth_end - 1U - depth)) & 1U;
+            const CorrectionWord      &cw           = key.correction_words[depth + 3];
+            bool                       cw_control   = keep ? cw.control_right : cw.control_left;
+            const std::array<bool, 8> &control_bits = prev_control_bits[depth];
+            (keep ? prg_seed_right : prg_seed_left).Evaluate(prev_seeds[depth], next_seeds);
+            for (uint32_t k = 0; k < 8; k++) {
+                prev_seeds[depth + 1][k]        = next_seeds[k] ^ (zero_and_all_one[control_bits[k]] & cw.seed);
+                prev_control_bits[depth + 1][k] = Lsb(next_seeds[k]) ^ (control_bits[k] & cw_control);
+            }
+            depth++;
+        }
+
+        for (uint32_t k = 0; k < 8; k++) {
+            Block output = _mm_add_epi32(prev_seeds[depth][k], zero_and_all_one[prev_control_bits[depth][k]] & key.output);
+            if (key.party_id) {
+                output = _mm_sub_epi32(zero_block, output);
+            }
+            __m128i *dst = blocks + (static_cast<size_t>(k) << depth_end) + idx;
+            _mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), output));
+        }
+
+        int shift = (idx + 1U) ^ idx;
+        depth -= static_cast<int>(std::floor(std::log2(shift))) + 1;
+        idx++;
+    }
+}
+
 void DistributedPointFunction::EvaluateFullDomainOneBit(const DpfKey &key, std::vector<uint32_t> &outputs) const {
     uint32_t n  = this->params_.input_bitsize;
     uint32_t e  = this->params_.element_bitsize;
     uint32_t nu = this->params_.terminate_bitsize;
+    utils::HistogramTimer latency(EvalFullDomainLatency());
+    EvalFullDomainCounter().Increment();
+    AesBlockCounter().Increment((static_cast<uint64_t>(1) << (nu + 1)) - 2);
 
     if (n < 8) {
         Block output_block = ComputeOutputBlock(key.init_seed, key.party_id != 0, key);
@@ -224,7 +356,91 @@ void DistributedPointFunction::EvaluateFullDomainOneBit(const DpfKey &key, std::
     }
 }
 
+void DistributedPointFunction::EvaluateFullDomainChunk(const DpfKey &key, const uint32_t chunk_bitsize, const uint32_t chunk, std::vector<uint32_t> &outputs) const {
+    uint32_t n          = this->params_.input_bitsize;
+    uint32_t e          = this->params_.element_bitsize;
+    uint32_t nu         = this->params_.terminate_bitsize;
+    uint32_t term_nodes = utils::Pow(2, n - nu);
+
+    if (chunk_bitsize > n || chunk_bitsize < n - nu) {
+        utils::Logger::FatalLog(LOCATION, "Unsupported chunk size: " + std::to_string(chunk_bitsize) + " (input size: " + std::to_string(n) + ", terminate size: " + std::to_string(nu) + ")");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t depth = n - chunk_bitsize;           // The levels above the chunk
+    uint32_t width = chunk_bitsize - (n - nu);    // The levels of the subtree of the chunk
+
+    // Descend to the root of the chunk
+    std::array<Block, 2> expanded_seeds;
+    std::array<bool, 2>  expanded_control_bits;
+    Block                seed        = key.init_seed;
+    bool                 control_bit = key.party_id != 0;
+    for (uint32_t i = 0; i < depth; i++) {
+        EvaluateNextSeed(i, key.correction_words[i], seed, control_bit, expanded_seeds, expanded_control_bits);
+        bool current_bit = (chunk >> (depth - i - 1)) & 1U;
+        seed             = expanded_seeds[current_bit ? kRight : kLeft];
+        control_bit      = expanded_control_bits[current_bit ? kRight : kLeft];
+    }
+
+    // Expand the subtree level by level (8 seeds per PRG call)
+    std::vector<Block> seeds{seed}, next_seeds;
+    std::vector<bool>  control_bits{control_bit}, next_control_bits;
+    for (uint32_t i = depth; i < depth + width; i++) {
+        const CorrectionWord &cw   = key.correction_words[i];
+        size_t                size = seeds.size();
+        next_seeds.resize(2 * size);
+        next_control_bits.resize(2 * size);
+
+        size_t j = 0;
+        for (; j + 8 <= size; j += 8) {
+            std::array<Block, 8> current, left, right;
+            std::copy(seeds.begin() + j, seeds.begin() + j + 8, current.begin());
+            prg_seed_left.Evaluate(current, left);
+            prg_seed_right.Evaluate(current, right);
+            for (size_t k = 0; k < 8; k++) {
+                bool  cb                           = control_bits[j + k];
+                Block mask                         = zero_and_all_one[cb];
+                next_seeds[2 * (j + k)]            = left[k] ^ (mask & cw.seed);
+                next_seeds[2 * (j + k) + 1]        = right[k] ^ (mask & cw.seed);
+                next_control_bits[2 * (j + k)]     = Lsb(left[k]) ^ (cb & cw.control_left);
+                next_control_bits[2 * (j + k) + 1] = Lsb(right[k]) ^ (cb & cw.control_right);
+            }
+        }
+        for (; j < size; j++) {
+            EvaluateNextSeed(i, cw, seeds[j], control_bits[j], expanded_seeds, expanded_control_bits);
+            next_seeds[2 * j]            = expanded_seeds[kLeft];
+            next_seeds[2 * j + 1]        = expanded_seeds[kRight];
+            next_control_bits[2 * j]     = expanded_control_bits[kLeft];
+            next_control_bits[2 * j + 1] = expanded_control_bits[kRight];
+        }
+        std::swap(seeds, next_seeds);
+        std::swap(control_bits, next_control_bits);
+    }
+    AesBlockCounter().Increment(2 * depth + (static_cast<uint64_t>(1) << (width + 1)) - 2);
+
+    // Convert the leaves into the outputs
+    outputs.resize(utils::Pow(2, chunk_bitsize));
+    if (term_nodes == 4) {
+        uint32_t mask = utils::Mod(~0U, e);
+        for (size_t j = 0; j < seeds.size(); j++) {
+            Block output       = ComputeOutputBlock(seeds[j], control_bits[j], key);
+            outputs[4 * j + 0] = _mm_extract_epi32(output, 0) & mask;
+            outputs[4 * j + 1] = _mm_extract_epi32(output, 1) & mask;
+            outputs[4 * j + 2] = _mm_extract_epi32(output, 2) & mask;
+            outputs[4 * j + 3] = _mm_extract_epi32(output, 3) & mask;
+        }
+    } else {
+        for (size_t j = 0; j < seeds.size(); j++) {
+            std::vector<uint32_t> output = ComputeOutputBlock(seeds[j], control_bits[j], key).ConvertVec(term_nodes, e);
+            std::copy(output.begin(), output.end(), outputs.begin() + j * term_nodes);
+        }
+    }
+}
+
 void DistributedPointFunction::FullDomainNonRecursive(const DpfKey &key, std::vector<uint32_t> &outputs) const {
+    this->FullDomainNonRecursive(key, outputs.data());
+}
+
+void DistributedPointFunction::FullDomainNonRecursive(const DpfKey &key, uint32_t *outputs) const {
     uint32_t n          = this->params_.input_bitsize;
     uint32_t e          = this->params_.element_bitsize;
     uint32_t nu         = this->params_.terminate_bitsize;
@@ -291,6 +507,10 @@ void DistributedPointFunction::FullDomainNonRecursive(const DpfKey &key, std::ve
 }
 
 void DistributedPointFunction::FullDomainNonRecursiveParallel_4(const DpfKey &key, std::vector<uint32_t> &outputs) const {
+    this->FullDomainNonRecursiveParallel_4(key, outputs.data());
+}
+
+void DistributedPointFunction::FullDomainNonRecursiveParallel_4(const DpfKey &key, uint32_t *outputs) const {
     uint32_t n          = this->params_.input_bitsize;
     uint32_t e          = this->params_.element_bitsize;
     uint32_t nu         = this->params_.terminate_bitsize;
@@ -327,7 +547,7 @@ void DistributedPointFunction::FullDomainNonRecursiveParallel_4(const DpfKey &ke
     uint32_t depth     = 0;
     uint32_t depth_end = nu - 3;
     uint32_t end       = utils::Pow(2, depth_end);
-    uint32_t mask      = (1 << e) - 1;
+    uint32_t mask      = utils::Mod(~0U, e);
 
     std::vector<std::array<Block, 8>> prev_seeds(depth_end + 1);
     std::vector<std::array<bool, 8>>  prev_control_bits(depth_end + 1);
@@ -550,6 +770,10 @@ void DistributedPointFunction::FullDomainNonRecursiveParallel_4(const DpfKey &ke
 }
 
 void DistributedPointFunction::FullDomainNonRecursiveParallel_8(const DpfKey &key, std::vector<uint32_t> &outputs) const {
+    this->FullDomainNonRecursiveParallel_8(key, outputs.data());
+}
+
+void DistributedPointFunction::FullDomainNonRecursiveParallel_8(const DpfKey &key, uint32_t *outputs) const {
     uint32_t n          = this->params_.input_bitsize;
     uint32_t e          = this->params_.element_bitsize;
     uint32_t nu         = this->params_.terminate_bitsize;
@@ -586,7 +810,7 @@ void DistributedPointFunction::FullDomainNonRecursiveParallel_8(const DpfKey &ke
     uint32_t depth     = 0;
     uint32_t depth_end = nu - 3;
     uint32_t end       = utils::Pow(2, depth_end);
-    uint32_t mask      = (1 << e) - 1;
+    uint32_t mask      = utils::Mod(~0U, e);
 
     std::vector<std::array<Block, 8>> prev_seeds(depth_end + 1);
     std::vector<std::array<bool, 8>>  prev_control_bits(depth_end + 1);
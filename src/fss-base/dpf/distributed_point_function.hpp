@@ -11,6 +11,7 @@
 
 #include <vector>
 
+#include "../../utils/huge_page.hpp"
 #include "../fss_block.hpp"
 #include "../fss_configure.hpp"
 
@@ -185,6 +186,36 @@ public:
      */
     void EvaluateFullDomain(const DpfKey &key, std::vector<uint32_t> &outputs) const;
 
+    /**
+     * @brief Evaluate the Distributed Point Function (DPF) over the full domain into huge pages.
+     *
+     * Same as EvaluateFullDomain, with the outputs backed by utils::HugePageAllocator to reduce the TLB misses of the scans of large domains.
+     *
+     * @param key The DpfKey instance to use for evaluation.
+     * @param outputs The evaluation results over the full domain (resized to 2^input_bitsize).
+     */
+    void EvaluateFullDomain(const DpfKey &key, utils::HugeVector<uint32_t> &outputs) const;
+
+    /**
+     * @brief Add the evaluation of the Distributed Point Function (DPF) over the full domain to an accumulator.
+     *
+     * When a leaf holds 4 outputs (input_bitsize - terminate_bitsize = 2), the leaves are expanded 8 subtrees at a time and each
+     * packed output block is added to the accumulator with one SIMD addition, without unpacking the outputs. Other parameters are
+     * evaluated with EvaluateFullDomain and added. The accumulator is kept modulo 2^32: reduce it modulo 2^element_bitsize after the last key.
+     *
+     * @param key The DpfKey instance to use for evaluation.
+     * @param accumulator The sums of the evaluation results (size: 2^input_bitsize).
+     */
+    void EvaluateFullDomainAccumulate(const DpfKey &key, std::vector<uint32_t> &accumulator) const;
+
+    /**
+     * @brief Add the evaluation of the Distributed Point Function (DPF) over the full domain to an accumulator in huge pages.
+     *
+     * @param key The DpfKey instance to use for evaluation.
+     * @param accumulator The sums of the evaluation results (size: 2^input_bitsize).
+     */
+    void EvaluateFullDomainAccumulate(const DpfKey &key, utils::HugeVector<uint32_t> &accumulator) const;
+
     /**
      * @brief Evaluate the Distributed Point Function (DPF) over the full domain.
      *
@@ -197,6 +228,19 @@ public:
      */
     void EvaluateFullDomainOneBit(const DpfKey &key, std::vector<uint32_t> &outputs) const;
 
+    /**
+     * @brief Evaluate the Distributed Point Function (DPF) over one chunk of the full domain.
+     *
+     * The chunk is the range of inputs [chunk * 2^chunk_bitsize, (chunk + 1) * 2^chunk_bitsize), evaluated in domain order.
+     * Evaluating every chunk in turn gives the full domain with a memory footprint of one chunk.
+     *
+     * @param key The DpfKey instance to use for evaluation.
+     * @param chunk_bitsize The bit size of the chunk (at least input_bitsize - terminate_bitsize).
+     * @param chunk The index of the chunk.
+     * @param outputs A vector of uint32_t values representing the evaluation results over the chunk (size: 2^chunk_bitsize).
+     */
+    void EvaluateFullDomainChunk(const DpfKey &key, const uint32_t chunk_bitsize, const uint32_t chunk, std::vector<uint32_t> &outputs) const;
+
     /**
      * @brief Evaluate the Distributed Point Function (DPF) over the full domain in a non-recursive manner with early termination.
      *
@@ -300,6 +344,18 @@ private:
         const Block &current_seed, const bool current_control_bit,
         std::array<Block, 2> &expanded_seeds, std::array<bool, 2> &expanded_control_bits) const;
 
+    /**
+     * @brief Evaluate the DPF over the full domain into the given memory (2^input_bitsize values), whatever its allocator.
+     *
+     * @param key The DpfKey instance to use for evaluation.
+     * @param outputs The memory of the evaluation results.
+     */
+    void EvaluateFullDomain(const DpfKey &key, uint32_t *outputs) const;
+    void EvaluateFullDomainAccumulate(const DpfKey &key, uint32_t *accumulator) const;
+    void FullDomainNonRecursive(const DpfKey &key, uint32_t *outputs) const;
+    void FullDomainNonRecursiveParallel_4(const DpfKey &key, uint32_t *outputs) const;
+    void FullDomainNonRecursiveParallel_8(const DpfKey &key, uint32_t *outputs) const;
+
     /**
      * @brief Traverses the distributed point function.
      *
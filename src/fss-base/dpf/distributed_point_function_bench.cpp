@@ -11,9 +11,16 @@
 #include "../../tools/random_number_generator.hpp"
 #include "../../tools/secret_sharing.hpp"
 #include "../../utils/logger.hpp"
+#include "../../utils/memory.hpp"
 #include "../../utils/timer.hpp"
 #include "../../utils/utils.hpp"
 
+namespace {
+
+constexpr uint32_t kMemorySummaryIntervalMs = 60000;    // Interval of the periodic memory summary
+
+}    // namespace
+
 namespace fss {
 namespace dpf {
 namespace bench {
@@ -21,6 +28,9 @@ namespace bench {
 void Bench_Dpf(const BenchInfo &bench_info) {
     // Define utilities
     utils::ExecutionTimer timer_all, timer_1, timer_2;
+    utils::MemoryMonitor  mem_1;
+    utils::TlbMonitor     tlb_1;
+    utils::MemoryMonitor::SetSummaryInterval(kMemorySummaryIntervalMs);
 
     std::vector<std::string> modes         = {"Evaluate Full Domain", "Evaluate Full Domain (1-bit)", "Evaluate Full Domain Non Recursive", "Evaluate Full Domain Recursive", "Evaluate Full Domain Naive"};
     int                      selected_mode = bench_info.mode;
@@ -52,71 +62,103 @@ void Bench_Dpf(const BenchInfo &bench_info) {
             if (selected_mode == 1) {
                 utils::Logger::InfoLog(LOCATION, "DPF: (input size, element size, terminate size) = (" + std::to_string(params.input_bitsize) + ", " + std::to_string(params.element_bitsize) + ", " + std::to_string(params.terminate_bitsize) + ")");
                 timer_1.SetTimeUnit(utils::TimeUnit::NANOSECONDS);
+                mem_1.Start();
                 timer_1.Start();
                 std::pair<DpfKey, DpfKey> dpf_keys = dpf.GenerateKeys(alpha, beta);
                 timer_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
                 timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
 
+                mem_1.Start();
+                tlb_1.Start();
                 timer_1.Start();
                 std::vector<uint32_t> res_fde(fde_size);
-                dpf.EvaluateFullDomain(std::move(dpf_keys.first), res_fde);
+                dpf.EvaluateFullDomain(dpf_keys.first, res_fde);
                 timer_1.Print(LOCATION, mode_str + "Eval Full Domain Opt" + measure_info);
+                tlb_1.Print(LOCATION, mode_str + "Eval Full Domain Opt" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Eval Full Domain Opt" + measure_info);
+
+                // The same evaluation into huge pages
+                mem_1.Start();
+                tlb_1.Start();
+                timer_1.Start();
+                utils::HugeVector<uint32_t> res_fde_huge(fde_size);
+                dpf.EvaluateFullDomain(dpf_keys.first, res_fde_huge);
+                timer_1.Print(LOCATION, mode_str + "Eval Full Domain Huge" + measure_info);
+                tlb_1.Print(LOCATION, mode_str + "Eval Full Domain Huge" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Eval Full Domain Huge" + measure_info);
                 dpf_keys.first.FreeDpfKey();
                 dpf_keys.second.FreeDpfKey();
             } else if (selected_mode == 2) {
                 utils::Logger::InfoLog(LOCATION, "DPF: (input size, element size, terminate size) = (" + std::to_string(params2.input_bitsize) + ", " + std::to_string(params2.element_bitsize) + ", " + std::to_string(params2.terminate_bitsize) + ")");
                 timer_1.SetTimeUnit(utils::TimeUnit::NANOSECONDS);
+                mem_1.Start();
                 timer_1.Start();
                 std::pair<DpfKey, DpfKey> dpf_keys = dpf_one.GenerateKeys(alpha, beta);
                 timer_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
                 timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
 
+                mem_1.Start();
                 timer_1.Start();
                 std::vector<uint32_t> res_fde(fde_size);
                 dpf_one.EvaluateFullDomainOneBit(std::move(dpf_keys.first), res_fde);
                 timer_1.Print(LOCATION, mode_str + "Eval Full Domain 1bit" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Eval Full Domain 1bit" + measure_info);
                 dpf_keys.first.FreeDpfKey();
                 dpf_keys.second.FreeDpfKey();
             } else if (selected_mode == 3) {
                 utils::Logger::InfoLog(LOCATION, "DPF: (input size, element size, terminate size) = (" + std::to_string(params.input_bitsize) + ", " + std::to_string(params.element_bitsize) + ", " + std::to_string(params.terminate_bitsize) + ")");
                 timer_1.SetTimeUnit(utils::TimeUnit::NANOSECONDS);
+                mem_1.Start();
                 timer_1.Start();
                 std::pair<DpfKey, DpfKey> dpf_keys = dpf.GenerateKeys(alpha, beta);
                 timer_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
                 timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
 
+                mem_1.Start();
                 timer_1.Start();
                 std::vector<uint32_t> res_fde(fde_size);
                 dpf.FullDomainNonRecursive(std::move(dpf_keys.first), res_fde);
                 timer_1.Print(LOCATION, mode_str + "Eval Non Recursive" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Eval Non Recursive" + measure_info);
                 dpf_keys.first.FreeDpfKey();
                 dpf_keys.second.FreeDpfKey();
             } else if (selected_mode == 4) {
                 utils::Logger::InfoLog(LOCATION, "DPF: (input size, element size, terminate size) = (" + std::to_string(params.input_bitsize) + ", " + std::to_string(params.element_bitsize) + ", " + std::to_string(params.terminate_bitsize) + ")");
+                mem_1.Start();
                 timer_1.Start();
                 timer_1.SetTimeUnit(utils::TimeUnit::NANOSECONDS);
                 std::pair<DpfKey, DpfKey> dpf_keys = dpf.GenerateKeysNaive(alpha, beta);
                 timer_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
                 timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
 
+                mem_1.Start();
                 timer_1.Start();
                 std::vector<uint32_t> res_naive(fde_size);
                 dpf.FullDomainRecursive(std::move(dpf_keys.first), res_naive);
                 timer_1.Print(LOCATION, mode_str + "Eval Recursive" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Eval Recursive" + measure_info);
                 dpf_keys.first.FreeDpfKey();
                 dpf_keys.second.FreeDpfKey();
             } else if (selected_mode == 5) {
                 utils::Logger::InfoLog(LOCATION, "DPF: (input size, element size, terminate size) = (" + std::to_string(params.input_bitsize) + ", " + std::to_string(params.element_bitsize) + ", " + std::to_string(params.terminate_bitsize) + ")");
+                mem_1.Start();
                 timer_1.Start();
                 timer_1.SetTimeUnit(utils::TimeUnit::NANOSECONDS);
                 std::pair<DpfKey, DpfKey> dpf_keys = dpf.GenerateKeysNaive(alpha, beta);
                 timer_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
                 timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
 
+                mem_1.Start();
                 timer_1.Start();
                 std::vector<uint32_t> res_naive(fde_size);
                 dpf.FullDomainNaiveNaive(std::move(dpf_keys.first), res_naive);
                 timer_1.Print(LOCATION, mode_str + "Eval Naive" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Eval Naive" + measure_info);
                 dpf_keys.first.FreeDpfKey();
                 dpf_keys.second.FreeDpfKey();
             }
@@ -127,6 +169,7 @@ void Bench_Dpf(const BenchInfo &bench_info) {
                 utils::Logger::InfoLog(LOCATION, "The execution time exceeds the limit time: " + std::to_string(timer_res) + " " + timer_all.GetTimeUnitStr());
                 exit(EXIT_FAILURE);
             }
+            utils::MemoryMonitor::PrintPeriodicSummary(LOCATION);
         }
     }
 }
@@ -8,12 +8,57 @@
 
 #include "distributed_point_function.hpp"
 
+#include <algorithm>
+
 #include "../../tools/random_number_generator.hpp"
 #include "../../utils/logger.hpp"
+#include "../../utils/timer.hpp"
 #include "../../utils/utils.hpp"
 
 namespace {
 
+using fss::dpf::DistributedPointFunction;
+using fss::dpf::DpfKey;
+using fss::dpf::DpfParameters;
+
+// Element sizes of the differential test: every number of terminal nodes (2^(n-nu)) and the boundary bit widths.
+const std::vector<uint32_t> kDifferentialElementSizes = {1, 2, 4, 5, 8, 9, 16, 17, 31, 32};
+
+/**
+ * @brief A full domain evaluator and the parameters it supports.
+ */
+struct FullDomainVariant {
+    std::string name;                                                                       /**< Name of the evaluator. */
+    void (DistributedPointFunction::*evaluate)(const DpfKey &, std::vector<uint32_t> &) const; /**< The evaluator. */
+    bool (*is_supported)(const DpfParameters &);                                            /**< Whether the evaluator supports the parameters. */
+    bool is_naive;                                                                          /**< Whether the evaluator uses keys without early termination. */
+};
+
+uint32_t TerminalBits(const DpfParameters &params) {
+    return params.input_bitsize - params.terminate_bitsize;
+}
+
+// The supported parameters follow the checks of each evaluator and the dispatch of EvaluateFullDomain(OneBit).
+// The parallel evaluators expand the first three levels before the unrolled traversal, which needs at least one more level.
+const std::vector<FullDomainVariant> kFullDomainVariants = {
+    {"EvaluateFullDomain", &DistributedPointFunction::EvaluateFullDomain,
+     [](const DpfParameters &p) { return p.input_bitsize < 9 || (p.input_bitsize < 33 && TerminalBits(p) == 2) || (p.input_bitsize < 17 && TerminalBits(p) == 3); }, false},
+    {"EvaluateFullDomainOneBit", &DistributedPointFunction::EvaluateFullDomainOneBit,
+     [](const DpfParameters &p) { return p.element_bitsize == 1 && (p.input_bitsize < 11 || (p.input_bitsize < 33 && TerminalBits(p) == 7)); }, false},
+    {"FullDomainNonRecursive", &DistributedPointFunction::FullDomainNonRecursive,
+     [](const DpfParameters &p) { return true; }, false},
+    {"FullDomainNonRecursiveParallel_4", &DistributedPointFunction::FullDomainNonRecursiveParallel_4,
+     [](const DpfParameters &p) { return TerminalBits(p) == 2 && p.terminate_bitsize > 3; }, false},
+    {"FullDomainNonRecursiveParallel_8", &DistributedPointFunction::FullDomainNonRecursiveParallel_8,
+     [](const DpfParameters &p) { return TerminalBits(p) == 3 && p.terminate_bitsize > 3; }, false},
+    {"FullDomainNonRecursiveParallel_128", &DistributedPointFunction::FullDomainNonRecursiveParallel_128,
+     [](const DpfParameters &p) { return TerminalBits(p) == 7 && p.terminate_bitsize > 3; }, false},
+    {"FullDomainRecursive", &DistributedPointFunction::FullDomainRecursive,
+     [](const DpfParameters &p) { return true; }, false},
+    {"FullDomainNaiveNaive", &DistributedPointFunction::FullDomainNaiveNaive,
+     [](const DpfParameters &p) { return true; }, true},
+};
+
 bool DpfFullDomainCheck(const uint32_t alpha, const uint32_t beta, const std::vector<uint32_t> &res, const bool debug) {
     bool check = true;
     for (uint32_t i = 0; i < res.size(); i++) {
@@ -41,9 +86,12 @@ bool Test_FullDomainNonRecursiveParallel_8(const TestInfo &test_info);
 bool Test_FullDomainNonRecursive(const TestInfo &test_info);
 bool Test_FullDomainRecursive(const TestInfo &test_info);
 bool Test_FullDomainNaive(const TestInfo &test_info);
+bool Test_FullDomainDifferential(const TestInfo &test_info);
+bool Test_EvaluateFullDomainChunk(const TestInfo &test_info);
+bool Test_EvaluateFullDomainAccumulate(const TestInfo &test_info);
 
 void Test_Dpf(TestInfo &test_info) {
-    std::vector<std::string> modes         = {"DPF unit tests", "EvaluateSinglePoint", "EvaluateFullDomain", "EvaluateFullDomainOneBit", "FullDomainNonRecursiveParallel_4", "FullDomainNonRecursiveParallel_8", "FullDomainNonRecursive", "FullDomainRecursive", "FullDomainNaive"};
+    std::vector<std::string> modes         = {"DPF unit tests", "EvaluateSinglePoint", "EvaluateFullDomain", "EvaluateFullDomainOneBit", "FullDomainNonRecursiveParallel_4", "FullDomainNonRecursiveParallel_8", "FullDomainNonRecursive", "FullDomainRecursive", "FullDomainNaive", "FullDomainDifferential", "EvaluateFullDomainChunk", "EvaluateFullDomainAccumulate"};
     uint32_t                 selected_mode = test_info.mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -61,6 +109,9 @@ void Test_Dpf(TestInfo &test_info) {
         utils::PrintTestResult("Test_FullDomainNonRecursive(n=2~8)", Test_FullDomainNonRecursive(test_info));
         utils::PrintTestResult("Test_FullDomainRecursive", Test_FullDomainRecursive(test_info));
         utils::PrintTestResult("Test_FullDomainNaive", Test_FullDomainNaive(test_info));
+        utils::PrintTestResult("Test_FullDomainDifferential", Test_FullDomainDifferential(test_info));
+        utils::PrintTestResult("Test_EvaluateFullDomainChunk", Test_EvaluateFullDomainChunk(test_info));
+        utils::PrintTestResult("Test_EvaluateFullDomainAccumulate", Test_EvaluateFullDomainAccumulate(test_info));
     } else if (selected_mode == 2) {
         utils::PrintTestResult("Test_EvaluateSinglePoint", Test_EvaluateSinglePoint(test_info));
     } else if (selected_mode == 3) {
@@ -77,6 +128,12 @@ void Test_Dpf(TestInfo &test_info) {
         utils::PrintTestResult("Test_FullDomainRecursive", Test_FullDomainRecursive(test_info));
     } else if (selected_mode == 9) {
         utils::PrintTestResult("Test_FullDomainNaive", Test_FullDomainNaive(test_info));
+    } else if (selected_mode == 10) {
+        utils::PrintTestResult("Test_FullDomainDifferential", Test_FullDomainDifferential(test_info));
+    } else if (selected_mode == 11) {
+        utils::PrintTestResult("Test_EvaluateFullDomainChunk", Test_EvaluateFullDomainChunk(test_info));
+    } else if (selected_mode == 12) {
+        utils::PrintTestResult("Test_EvaluateFullDomainAccumulate", Test_EvaluateFullDomainAccumulate(test_info));
     }
     utils::PrintText(utils::kDash);
 }
@@ -376,6 +433,174 @@ bool Test_FullDomainNaive(const TestInfo &test_info) {
     return result;
 }
 
+bool Test_FullDomainDifferential(const TestInfo &test_info) {
+    bool                  result = true;
+    utils::ExecutionTimer timer;
+    timer.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
+
+    for (const auto size : test_info.domain_size) {
+        for (const auto e : kDifferentialElementSizes) {
+            // Set DPF parameters
+            DpfParameters            params(size, e, test_info.dbg_info);
+            uint32_t                 n        = params.input_bitsize;
+            uint32_t                 fde_size = utils::Pow(2, n);
+            DistributedPointFunction dpf(params);
+            std::string              param_str = "(n, e, nu)=(" + std::to_string(n) + ", " + std::to_string(e) + ", " + std::to_string(params.terminate_bitsize) + ")";
+
+            // Set input values
+            uint32_t alpha = utils::Mod(tools::rng::SecureRng().Rand32(), n);
+            uint32_t beta  = utils::Mod(tools::rng::SecureRng().Rand32(), e);
+
+            // Generate keys (with and without early termination)
+            std::pair<DpfKey, DpfKey> dpf_keys       = dpf.GenerateKeys(alpha, beta);
+            std::pair<DpfKey, DpfKey> dpf_keys_naive = dpf.GenerateKeysNaive(alpha, beta);
+
+            // Reference shares by the single point evaluation
+            std::vector<uint32_t> ref_0(fde_size), ref_1(fde_size), ref_naive_0(fde_size), ref_naive_1(fde_size);
+            for (uint32_t x = 0; x < fde_size; x++) {
+                ref_0[x]       = dpf.EvaluateAt(dpf_keys.first, x);
+                ref_1[x]       = dpf.EvaluateAt(dpf_keys.second, x);
+                ref_naive_0[x] = dpf.EvaluateAtNaive(dpf_keys_naive.first, x);
+                ref_naive_1[x] = dpf.EvaluateAtNaive(dpf_keys_naive.second, x);
+            }
+
+            std::vector<std::pair<double, std::string>> throughputs;
+            for (const auto &variant : kFullDomainVariants) {
+                if (!variant.is_supported(params)) {
+                    continue;
+                }
+                const std::pair<DpfKey, DpfKey> &keys  = variant.is_naive ? dpf_keys_naive : dpf_keys;
+                const std::vector<uint32_t>     &ref_p0 = variant.is_naive ? ref_naive_0 : ref_0;
+                const std::vector<uint32_t>     &ref_p1 = variant.is_naive ? ref_naive_1 : ref_1;
+
+                // Evaluate Full Domain of DPF
+                std::vector<uint32_t> sh_0(fde_size), sh_1(fde_size), res(fde_size);
+                timer.Start();
+                (dpf.*variant.evaluate)(keys.first, sh_0);
+                double time_us = timer.Print(LOCATION, "[FullDomainDifferential]," + variant.name + "," + std::to_string(n) + "," + std::to_string(e));
+                (dpf.*variant.evaluate)(keys.second, sh_1);
+
+                // Bit-exact agreement of the shares and the point function semantics
+                bool check = (sh_0 == ref_p0) && (sh_1 == ref_p1);
+                for (uint32_t i = 0; i < fde_size; i++) {
+                    res[i] = utils::Mod(sh_0[i] + sh_1[i], e);
+                }
+                check &= DpfFullDomainCheck(alpha, beta, res, test_info.dbg_info.debug);
+                if (!check) {
+                    utils::Logger::DebugLog(LOCATION, variant.name + " disagrees with the reference at " + param_str, test_info.dbg_info.debug);
+                }
+                result &= check;
+                throughputs.emplace_back(fde_size / std::max(time_us, 1.0), variant.name);
+            }
+
+            // Rank the evaluators by throughput (points per microsecond)
+            std::sort(throughputs.rbegin(), throughputs.rend());
+            std::string ranking;
+            for (const auto &throughput : throughputs) {
+                ranking += " " + throughput.second + "=" + std::to_string(throughput.first) + "pts/us";
+            }
+            utils::Logger::InfoLog(LOCATION, "[FullDomainDifferential] " + param_str + ranking);
+
+            dpf_keys.first.FreeDpfKey();
+            dpf_keys.second.FreeDpfKey();
+            dpf_keys_naive.first.FreeDpfKey();
+            dpf_keys_naive.second.FreeDpfKey();
+        }
+    }
+    return result;
+}
+
+bool Test_EvaluateFullDomainChunk(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        for (const auto e : {1U, 2U, size}) {
+            DpfParameters            params(size, e, test_info.dbg_info);
+            uint32_t                 n        = params.input_bitsize;
+            uint32_t                 nu       = params.terminate_bitsize;
+            uint32_t                 fde_size = utils::Pow(2, n);
+            DistributedPointFunction dpf(params);
+
+            uint32_t                  alpha    = utils::Mod(tools::rng::SecureRng().Rand32(), n);
+            uint32_t                  beta     = utils::Mod(tools::rng::SecureRng().Rand32(), e);
+            std::pair<DpfKey, DpfKey> dpf_keys = dpf.GenerateKeys(alpha, beta);
+
+            // The chunks put together are the full domain
+            std::vector<uint32_t> expected(fde_size), chunk_outputs;
+            dpf.FullDomainNonRecursive(dpf_keys.first, expected);
+            for (const uint32_t chunk_bitsize : {n - nu, std::min(n - nu + 1, n), std::max(n - nu, n / 2), n}) {
+                std::vector<uint32_t> outputs;
+                for (uint32_t chunk = 0; chunk < utils::Pow(2, n - chunk_bitsize); chunk++) {
+                    dpf.EvaluateFullDomainChunk(dpf_keys.first, chunk_bitsize, chunk, chunk_outputs);
+                    outputs.insert(outputs.end(), chunk_outputs.begin(), chunk_outputs.end());
+                }
+                result &= outputs == expected;
+                utils::Logger::DebugLog(LOCATION, "(n, e, chunk)=(" + std::to_string(n) + ", " + std::to_string(e) + ", " + std::to_string(chunk_bitsize) + "): " + (outputs == expected ? "ok" : "mismatch"), test_info.dbg_info.debug);
+            }
+
+            // The chunks of both keys reconstruct the point function
+            std::vector<uint32_t> sh_0, sh_1, out(fde_size);
+            uint32_t              chunk_bitsize = std::max(n - nu, n / 2);
+            for (uint32_t chunk = 0; chunk < utils::Pow(2, n - chunk_bitsize); chunk++) {
+                dpf.EvaluateFullDomainChunk(dpf_keys.first, chunk_bitsize, chunk, sh_0);
+                dpf.EvaluateFullDomainChunk(dpf_keys.second, chunk_bitsize, chunk, sh_1);
+                for (uint32_t i = 0; i < sh_0.size(); i++) {
+                    out[chunk * sh_0.size() + i] = utils::Mod(sh_0[i] + sh_1[i], e);
+                }
+            }
+            result &= DpfFullDomainCheck(alpha, beta, out, test_info.dbg_info.debug);
+
+            dpf_keys.first.FreeDpfKey();
+            dpf_keys.second.FreeDpfKey();
+        }
+    }
+    return result;
+}
+
+bool Test_EvaluateFullDomainAccumulate(const TestInfo &test_info) {
+    bool               result  = true;
+    constexpr uint32_t key_num = 5;
+    for (const auto size : test_info.domain_size) {
+        for (const auto e : {8U, 20U, 32U}) {
+            if (e == 8 && size >= 9) {
+                continue;    // 16 outputs per leaf are only evaluated by FullDomainNonRecursive
+            }
+            DpfParameters            params(size, e, test_info.dbg_info);
+            uint32_t                 fde_size = utils::Pow(2, size);
+            DistributedPointFunction dpf(params);
+
+            // The accumulators of both parties reconstruct the histogram of the alphas
+            std::vector<uint32_t>       expected(fde_size, 0), acc_0(fde_size, 0), outputs(fde_size);
+            utils::HugeVector<uint32_t> acc_1(fde_size, 0);
+            for (uint32_t i = 0; i < key_num; i++) {
+                uint32_t                  alpha    = utils::Mod(tools::rng::SecureRng().Rand32(), size);
+                uint32_t                  beta     = utils::Mod(tools::rng::SecureRng().Rand32(), e);
+                std::pair<DpfKey, DpfKey> dpf_keys = dpf.GenerateKeys(alpha, beta);
+                dpf.EvaluateFullDomainAccumulate(dpf_keys.first, acc_0);
+                dpf.EvaluateFullDomainAccumulate(dpf_keys.second, acc_1);
+                expected[alpha] = utils::Mod(expected[alpha] + beta, e);
+
+                // The accumulation of one key is its full domain evaluation
+                if (i == 0) {
+                    std::vector<uint32_t> single(fde_size, 0);
+                    dpf.EvaluateFullDomainAccumulate(dpf_keys.first, single);
+                    dpf.FullDomainNonRecursive(dpf_keys.first, outputs);
+                    for (uint32_t x = 0; x < fde_size; x++) {
+                        result &= utils::Mod(single[x], e) == outputs[x];
+                    }
+                }
+                dpf_keys.first.FreeDpfKey();
+                dpf_keys.second.FreeDpfKey();
+            }
+            for (uint32_t x = 0; x < fde_size; x++) {
+                outputs[x] = utils::Mod(acc_0[x] + acc_1[x], e);
+            }
+            result &= outputs == expected;
+            utils::Logger::DebugLog(LOCATION, "(n, e)=(" + std::to_string(size) + ", " + std::to_string(e) + "): " + (outputs == expected ? "ok" : "mismatch"), test_info.dbg_info.debug);
+        }
+    }
+    return result;
+}
+
 }    // namespace test
 }    // namespace dpf
 }    // namespace fss
@@ -13,6 +13,7 @@
 
 #include "../tools/random_number_generator.hpp"
 #include "../utils/logger.hpp"
+#include "../utils/utils.hpp"
 
 namespace fss {
 
@@ -25,9 +26,12 @@ const std::array<Block, 2> zero_and_all_one = {{zero_block, all_one_block}};
  * @brief Sets the data of the block to a random value using SecureRng.
  *
  * Generates two 64-bit random numbers using SecureRng and sets them as the data of the block.
+ * The low half is drawn first, so the keys derived from a seed (see prg::SeededRandomness) do not depend on the compiler.
  */
 void Block::SetRandom() {
-    data = _mm_set_epi64x(tools::rng::SecureRng::Rand64(), tools::rng::SecureRng::Rand64());
+    uint64_t low  = tools::rng::SecureRng::Rand64();
+    uint64_t high = tools::rng::SecureRng::Rand64();
+    data          = _mm_set_epi64x(high, low);
 }
 
 /**
@@ -39,7 +43,7 @@ void Block::SetRandom() {
  * @return The converted uint32_t value.
  */
 uint32_t Block::Convert(const uint32_t bit_size) const {
-    return _mm_cvtsi128_si32(data) & ((1U << bit_size) - 1U);
+    return utils::Mod(_mm_cvtsi128_si32(data), bit_size);
 }
 
 /**
@@ -60,7 +64,7 @@ std::vector<uint32_t> Block::ConvertVec(const uint32_t num, const uint32_t bit_s
         exit(EXIT_FAILURE);
     }
 
-    uint32_t mask = (1 << bit_size) - 1;
+    uint32_t mask = utils::Mod(~0U, bit_size);
 
     if (num == 4) {
         // num = 4, each part is 32 bits
@@ -123,7 +127,7 @@ void Block::FromVec(const std::vector<uint32_t> &vec, const uint32_t num, const
         exit(EXIT_FAILURE);
     }
 
-    uint32_t mask      = (1 << bit_size) - 1;
+    uint32_t mask      = utils::Mod(~0U, bit_size);
     uint8_t  bytes[16] = {0};
     if (num == 32) {
         for (int i = 0; i < 32; ++i) {
@@ -0,0 +1,189 @@
+/**
+ * @file incremental_dpf.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief Incremental Distributed Point Function (IDPF) implementation.
+ */
+
+#include "incremental_dpf.hpp"
+
+#include <array>
+
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+#include "../prg/prg.hpp"
+
+namespace {
+
+// Pseudorandom generators for the children and the output of a node
+static const fss::prg::PRG prg_seed_left  = fss::prg::PRG::Create(fss::kPrgKeySeedLeft);
+static const fss::prg::PRG prg_seed_right = fss::prg::PRG::Create(fss::kPrgKeySeedRight);
+static const fss::prg::PRG prg_value_left = fss::prg::PRG::Create(fss::kPrgKeyValueLeft);
+
+}    // namespace
+
+namespace fss {
+namespace idpf {
+
+IdpfParameters::IdpfParameters()
+    : input_bitsize(0), element_bitsize(0), debug(false) {
+}
+
+IdpfParameters::IdpfParameters(const uint32_t n, const uint32_t e, const DebugInfo &dbg_info)
+    : input_bitsize(n), element_bitsize(e), debug(dbg_info.dpf_debug) {
+}
+
+CorrectionWord::CorrectionWord()
+    : seed(Block(zero_block)), control_left(false), control_right(false), value(0) {
+}
+
+void IdpfKey::Initialize(const uint32_t n, const uint32_t party_id) {
+    this->party_id         = party_id;
+    this->init_seed        = Block(zero_block);
+    this->cw_length        = n;
+    this->correction_words = new CorrectionWord[n];
+}
+
+void IdpfKey::PrintIdpfKey(const bool debug) const {
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("IDPF Key"), debug);
+    utils::Logger::TraceLog(LOCATION, "Party ID: " + std::to_string(this->party_id), debug);
+    this->init_seed.PrintBlockHexTrace(LOCATION, "Initial seed: ", debug);
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Correction words"), debug);
+    for (uint32_t i = 0; i < this->cw_length; i++) {
+        this->correction_words[i].seed.PrintBlockHexTrace(LOCATION, "Level(" + std::to_string(i) + ") Seed -> ", debug);
+        utils::Logger::TraceLog(LOCATION, "Level(" + std::to_string(i) + ") Control bit -> (L):" + std::to_string(this->correction_words[i].control_left) + ", (R): " + std::to_string(this->correction_words[i].control_right), debug);
+        utils::Logger::TraceLog(LOCATION, "Level(" + std::to_string(i) + ") Value -> " + std::to_string(this->correction_words[i].value), debug);
+    }
+    utils::Logger::TraceLog(LOCATION, utils::kDash, debug);
+#endif
+}
+
+void IdpfKey::FreeIdpfKey() {
+    delete[] this->correction_words;
+    this->correction_words = nullptr;
+}
+
+IncrementalDpf::IncrementalDpf(const IdpfParameters params)
+    : params_(params) {
+}
+
+std::pair<IdpfKey, IdpfKey> IncrementalDpf::GenerateKeys(const std::vector<uint32_t> &alpha, const uint32_t beta) const {
+    uint32_t n = this->params_.input_bitsize;
+    uint32_t e = this->params_.element_bitsize;
+    if (alpha.size() != n) {
+        utils::Logger::FatalLog(LOCATION, "The length of alpha (" + std::to_string(alpha.size()) + ") does not match the input bitsize (" + std::to_string(n) + ")");
+        exit(EXIT_FAILURE);
+    }
+#ifdef LOG_LEVEL_TRACE
+    bool debug = this->params_.debug;
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Generate IDPF keys"), debug);
+    utils::Logger::TraceLog(LOCATION, "(input size, element size) = (" + std::to_string(n) + ", " + std::to_string(e) + ")", debug);
+    utils::Logger::TraceLog(LOCATION, "(alpha, beta) = (" + utils::VectorToStr(alpha, "") + ", " + std::to_string(beta) + ")", debug);
+#endif
+
+    std::array<IdpfKey, 2> keys;    // keys[party id]
+    keys[0].Initialize(n, 0);
+    keys[1].Initialize(n, 1);
+
+    // Initial seeds and control bits
+    std::array<Block, 2> seeds;                 // seeds[party id]
+    std::array<bool, 2>  control_bits{0, 1};    // control_bits[party id]
+    seeds[0].SetRandom();
+    seeds[1].SetRandom();
+    keys[0].init_seed = seeds[0];
+    keys[1].init_seed = seeds[1];
+
+    std::array<std::array<Block, 2>, 2> expanded_seeds;           // expanded_seeds[party id][left or right]
+    std::array<std::array<bool, 2>, 2>  expanded_control_bits;    // expanded_control_bits[party id][left or right]
+    CorrectionWord                      correction_word;
+    for (uint32_t i = 0; i < n; i++) {
+        for (int j = 0; j < 2; j++) {
+            prg_seed_left.Evaluate(seeds[j], expanded_seeds[j][kLeft]);
+            prg_seed_right.Evaluate(seeds[j], expanded_seeds[j][kRight]);
+            expanded_control_bits[j][kLeft]  = Lsb(expanded_seeds[j][kLeft]);
+            expanded_control_bits[j][kRight] = Lsb(expanded_seeds[j][kRight]);
+        }
+
+        // The seeds of the child off the path are made equal
+        bool current_bit = alpha[i] != 0;
+        bool keep = current_bit, lose = !current_bit;
+        correction_word.seed          = expanded_seeds[0][lose] ^ expanded_seeds[1][lose];
+        correction_word.control_left  = expanded_control_bits[0][kLeft] ^ expanded_control_bits[1][kLeft] ^ current_bit ^ 1;
+        correction_word.control_right = expanded_control_bits[0][kRight] ^ expanded_control_bits[1][kRight] ^ current_bit;
+        bool keep_correction          = keep ? correction_word.control_right : correction_word.control_left;
+        for (int j = 0; j < 2; j++) {
+            seeds[j] = expanded_seeds[j][keep];
+            if (control_bits[j]) {
+                seeds[j] = seeds[j] ^ correction_word.seed;
+            }
+            control_bits[j] = expanded_control_bits[j][keep] ^ (control_bits[j] & keep_correction);
+        }
+
+        // The outputs of the child on the path sum to beta: (-1)^b * (Convert(s_b) + t_b * value)
+        uint32_t value        = utils::Pow(-1, control_bits[1]) * (beta - this->ConvertNode(seeds[0]) + this->ConvertNode(seeds[1]));
+        correction_word.value = utils::Mod(value, e);
+        keys[0].correction_words[i] = correction_word;
+        keys[1].correction_words[i] = correction_word;
+
+#ifdef LOG_LEVEL_TRACE
+        std::string current_level = "|Level=" + std::to_string(i) + "| ";
+        correction_word.seed.PrintBlockHexTrace(LOCATION, current_level + "Seed correction: ", debug);
+        utils::Logger::TraceLog(LOCATION, current_level + "Control bit correction (L): " + std::to_string(correction_word.control_left) + ", (R): " + std::to_string(correction_word.control_right), debug);
+        utils::Logger::TraceLog(LOCATION, current_level + "Value correction: " + std::to_string(correction_word.value), debug);
+#endif
+    }
+
+#ifdef LOG_LEVEL_TRACE
+    utils::AddNewLine(debug);
+    keys[0].PrintIdpfKey(debug);
+    utils::AddNewLine(debug);
+    keys[1].PrintIdpfKey(debug);
+    utils::AddNewLine(debug);
+#endif
+
+    return std::make_pair(std::move(keys[0]), std::move(keys[1]));
+}
+
+IdpfNode IncrementalDpf::GetRoot(const IdpfKey &key) const {
+    return IdpfNode{key.init_seed, key.party_id != 0};
+}
+
+uint32_t IncrementalDpf::EvaluateNext(const IdpfKey &key, const uint32_t level, const IdpfNode &node, const bool bit, IdpfNode &next) const {
+    const CorrectionWord &correction_word = key.correction_words[level];
+    if (bit) {
+        prg_seed_right.Evaluate(node.seed, next.seed);
+    } else {
+        prg_seed_left.Evaluate(node.seed, next.seed);
+    }
+    next.control_bit = Lsb(next.seed);
+    if (node.control_bit) {
+        next.seed = next.seed ^ correction_word.seed;
+        next.control_bit ^= bit ? correction_word.control_right : correction_word.control_left;
+    }
+    uint32_t output = utils::Pow(-1, key.party_id) * (this->ConvertNode(next.seed) + (next.control_bit * correction_word.value));
+    return utils::Mod(output, this->params_.element_bitsize);
+}
+
+void IncrementalDpf::EvaluatePrefixes(const IdpfKey &key, const std::vector<uint32_t> &x, std::vector<uint32_t> &outputs) const {
+    if (x.size() > key.cw_length) {
+        utils::Logger::FatalLog(LOCATION, "The input is longer than the key (" + std::to_string(x.size()) + " > " + std::to_string(key.cw_length) + ")");
+        exit(EXIT_FAILURE);
+    }
+    outputs.resize(x.size());
+    IdpfNode node = this->GetRoot(key), next;
+    for (uint32_t i = 0; i < x.size(); i++) {
+        outputs[i] = this->EvaluateNext(key, i, node, x[i] != 0, next);
+        node       = next;
+    }
+}
+
+uint32_t IncrementalDpf::ConvertNode(const Block &seed) const {
+    Block value;
+    prg_value_left.Evaluate(seed, value);
+    return value.Convert(this->params_.element_bitsize);
+}
+
+}    // namespace idpf
+}    // namespace fss
@@ -0,0 +1,216 @@
+/**
+ * @file incremental_dpf.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief Incremental Distributed Point Function (IDPF) class.
+ */
+
+#ifndef IDPF_INCREMENTAL_DPF_H_
+#define IDPF_INCREMENTAL_DPF_H_
+
+#include <vector>
+
+#include "../fss_block.hpp"
+#include "../fss_configure.hpp"
+
+namespace fss {
+namespace idpf {
+
+/**
+ * @struct IdpfParameters
+ * @brief A struct to hold params for the Incremental Distributed Point Function (IDPF).
+ */
+struct IdpfParameters {
+    const uint32_t input_bitsize;   /**< The size of input in bits (the depth of the tree). */
+    const uint32_t element_bitsize; /**< The size of each element in bits. */
+    const bool     debug;           /**< Toggle this flag to enable/disable debugging. */
+
+    /**
+     * @brief Default constructor for IdpfParameters.
+     */
+    IdpfParameters();
+
+    /**
+     * @brief Parameterized constructor for IdpfParameters.
+     * @param n The input bitsize (may exceed 32, since inputs are bit strings).
+     * @param e The element bitsize.
+     * @param dbg_info Debug information.
+     */
+    IdpfParameters(const uint32_t n, const uint32_t e, const DebugInfo &dbg_info);
+};
+
+/**
+ * @struct CorrectionWord
+ * @brief A struct representing a correction word ([seed, control left, control right, value]).
+ */
+struct CorrectionWord {
+    Block    seed;          /**< Seed for correction. */
+    bool     control_left;  /**< Left control bit for correction. */
+    bool     control_right; /**< Right control bit for correction. */
+    uint32_t value;         /**< Output correction of the nodes of this level. */
+
+    /**
+     * @brief Default constructor for CorrectionWord.
+     */
+    CorrectionWord();
+
+    /**
+     * @brief Copy constructor is default for CorrectionWord.
+     */
+    CorrectionWord(const CorrectionWord &) = default;
+
+    /**
+     * @brief Copy assignment operator is default for CorrectionWord.
+     */
+    CorrectionWord &operator=(const CorrectionWord &) = default;
+};
+
+/**
+ * @struct IdpfKey
+ * @brief A struct representing a key for the Incremental Distributed Point Function (IDPF).
+ * @warning `IdpfKey` must call initialize before use.
+ */
+struct IdpfKey {
+    uint32_t        party_id;         /**< The ID of the party associated with the key. */
+    Block           init_seed;        /**< Seed for the IDPF key. */
+    uint32_t        cw_length;        /**< Size of Correction words. */
+    CorrectionWord *correction_words; /**< Pointer to an array of CorrectionWord instances (one per level). */
+
+    /**
+     * @brief Default constructor for IdpfKey.
+     */
+    IdpfKey()
+        : party_id(0), cw_length(0), correction_words(nullptr){};
+
+    /**
+     * @brief Copy constructor is deleted to prevent copying of IdpfKey.
+     */
+    IdpfKey(const IdpfKey &) = delete;
+
+    /**
+     * @brief Copy assignment operator is deleted to prevent copying of IdpfKey.
+     */
+    IdpfKey &operator=(const IdpfKey &) = delete;
+
+    /**
+     * @brief Move constructor for IdpfKey.
+     */
+    IdpfKey(IdpfKey &&) noexcept = default;
+
+    /**
+     * @brief Move assignment operator for IdpfKey.
+     */
+    IdpfKey &operator=(IdpfKey &&) noexcept = default;
+
+    bool operator==(const IdpfKey &rhs) const {
+        bool result = (party_id == rhs.party_id) && (init_seed == rhs.init_seed) && (cw_length == rhs.cw_length);
+        for (uint32_t i = 0; result && i < cw_length; i++) {
+            result &= (correction_words[i].seed == rhs.correction_words[i].seed) && (correction_words[i].control_left == rhs.correction_words[i].control_left) &&
+                      (correction_words[i].control_right == rhs.correction_words[i].control_right) && (correction_words[i].value == rhs.correction_words[i].value);
+        }
+        return result;
+    }
+
+    bool operator!=(const IdpfKey &rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Initialize the IdpfKey with specified values.
+     * @param n The size of input in bits.
+     * @param party_id The ID of the party associated with the key.
+     */
+    void Initialize(const uint32_t n, const uint32_t party_id);
+
+    /**
+     * @brief Print the details of the IdpfKey.
+     * @param debug Toggle this flag to enable/disable debugging.
+     */
+    void PrintIdpfKey(const bool debug) const;
+
+    /**
+     * @brief Free the resources associated with the IdpfKey.
+     */
+    void FreeIdpfKey();
+};
+
+/**
+ * @struct IdpfNode
+ * @brief The state of one party at a node of the tree, used to walk many inputs that share prefixes.
+ */
+struct IdpfNode {
+    Block seed;        /**< The seed of the node. */
+    bool  control_bit; /**< The control bit of the node. */
+};
+
+/**
+ * @brief Class representing the Incremental Distributed Point Function (IDPF).
+ *
+ * For a bit string alpha of n bits, the IDPF outputs shares of beta at every node on the path of alpha
+ * and shares of 0 at every other node, so a single walk along an input x of length m <= n
+ * gives the shares of beta * [x[0..i] == alpha[0..i]] for every prefix length i + 1 <= m.
+ * The output of a node is converted from its own (corrected) seed, so inputs with a common prefix
+ * share the evaluation of that prefix. Each node costs two PRG calls.
+ */
+class IncrementalDpf {
+public:
+    /**
+     * @brief Constructor for IncrementalDpf.
+     * @param params Parameters for IDPF.
+     */
+    IncrementalDpf(const IdpfParameters params);
+
+    /**
+     * @brief Generate a pair of IdpfKey instances for given alpha and beta values.
+     * @param alpha The bit string alpha (n elements of 0 or 1).
+     * @param beta The output on the path of alpha.
+     * @return A pair of IdpfKey.
+     */
+    std::pair<IdpfKey, IdpfKey> GenerateKeys(const std::vector<uint32_t> &alpha, const uint32_t beta) const;
+
+    /**
+     * @brief Get the root node of the tree for the key.
+     * @param key The IDPF key.
+     * @return The root node.
+     */
+    IdpfNode GetRoot(const IdpfKey &key) const;
+
+    /**
+     * @brief Move from a node of level `level` to its child.
+     * @param key The IDPF key.
+     * @param level The level of the node (0 for the root).
+     * @param node The current node.
+     * @param bit The direction (input bit at `level`).
+     * @param next The child node.
+     * @return The output share of the child node.
+     */
+    uint32_t EvaluateNext(const IdpfKey &key, const uint32_t level, const IdpfNode &node, const bool bit, IdpfNode &next) const;
+
+    /**
+     * @brief Evaluate the IDPF at every prefix of x.
+     * @param key The IDPF key.
+     * @param x The bit string (at most n elements of 0 or 1).
+     * @param outputs The output shares (outputs[i] for the prefix x[0..i]).
+     */
+    void EvaluatePrefixes(const IdpfKey &key, const std::vector<uint32_t> &x, std::vector<uint32_t> &outputs) const;
+
+private:
+    const IdpfParameters params_; /**< Parameters for the IncrementalDpf. */
+
+    /**
+     * @brief Convert the seed of a node to its output before the correction.
+     */
+    uint32_t ConvertNode(const Block &seed) const;
+};
+
+namespace test {
+
+void Test_Idpf(TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace idpf
+}    // namespace fss
+
+#endif    // IDPF_INCREMENTAL_DPF_H_
@@ -0,0 +1,150 @@
+/**
+ * @file incremental_dpf_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief IDPF test implementation.
+ */
+
+#include "incremental_dpf.hpp"
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+using fss::idpf::IdpfKey;
+using fss::idpf::IdpfNode;
+using fss::idpf::IdpfParameters;
+using fss::idpf::IncrementalDpf;
+
+// Input lengths of the tests (the IDPF takes bit strings longer than 32 bits).
+const std::vector<uint32_t> kIdpfInputLengths = {1, 5, 16, 40, 128};
+
+std::vector<uint32_t> RandomBits(const uint32_t n) {
+    std::vector<uint32_t> bits(n);
+    for (uint32_t i = 0; i < n; i++) {
+        bits[i] = tools::rng::SecureRng::RandBool();
+    }
+    return bits;
+}
+
+// Check that the outputs of every prefix of x are beta while x agrees with alpha, and 0 after the first difference.
+bool IdpfPrefixCheck(const std::vector<uint32_t> &alpha, const uint32_t beta, const std::vector<uint32_t> &x, const std::vector<uint32_t> &res, const bool debug) {
+    bool check   = true;
+    bool on_path = true;
+    for (uint32_t i = 0; i < x.size(); i++) {
+        on_path &= x[i] == alpha[i];
+        if ((on_path && res[i] != beta) || (!on_path && res[i] != 0)) {
+            check = false;
+            utils::Logger::DebugLog(LOCATION, "Prefix check failed at length " + std::to_string(i + 1) + " -> Result: " + std::to_string(res[i]), debug);
+        }
+    }
+    return check;
+}
+
+}    // namespace
+
+namespace fss {
+namespace idpf {
+namespace test {
+
+bool Test_EvaluatePrefixes(const TestInfo &test_info);
+bool Test_EvaluateNext(const TestInfo &test_info);
+
+void Test_Idpf(TestInfo &test_info) {
+    std::vector<std::string> modes         = {"IDPF unit tests", "EvaluatePrefixes", "EvaluateNext"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        utils::PrintTestResult("Test_EvaluatePrefixes", Test_EvaluatePrefixes(test_info));
+        utils::PrintTestResult("Test_EvaluateNext", Test_EvaluateNext(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_EvaluatePrefixes", Test_EvaluatePrefixes(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_EvaluateNext", Test_EvaluateNext(test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_EvaluatePrefixes(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto n : kIdpfInputLengths) {
+        for (const auto e : {1U, 8U, 32U}) {
+            IdpfParameters params(n, e, test_info.dbg_info);
+            IncrementalDpf idpf(params);
+
+            std::vector<uint32_t>       alpha = RandomBits(n);
+            uint32_t                    beta  = utils::Mod(tools::rng::SecureRng::Rand32() | 1, e);
+            std::pair<IdpfKey, IdpfKey> keys  = idpf.GenerateKeys(alpha, beta);
+
+            // The input alpha itself, and inputs that leave the path of alpha at every level
+            std::vector<std::vector<uint32_t>> inputs = {alpha, RandomBits(n)};
+            for (uint32_t i = 0; i < n; i++) {
+                std::vector<uint32_t> x = alpha;
+                x[i] ^= 1;
+                inputs.push_back(x);
+            }
+
+            std::vector<uint32_t> out_0, out_1, res(n);
+            for (const auto &x : inputs) {
+                idpf.EvaluatePrefixes(keys.first, x, out_0);
+                idpf.EvaluatePrefixes(keys.second, x, out_1);
+                for (uint32_t i = 0; i < n; i++) {
+                    res[i] = utils::Mod(out_0[i] + out_1[i], e);
+                }
+                result &= IdpfPrefixCheck(alpha, beta, x, res, test_info.dbg_info.debug);
+            }
+            keys.first.FreeIdpfKey();
+            keys.second.FreeIdpfKey();
+        }
+    }
+    return result;
+}
+
+bool Test_EvaluateNext(const TestInfo &test_info) {
+    bool     result = true;
+    uint32_t n = 16, e = 32;
+
+    IdpfParameters params(n, e, test_info.dbg_info);
+    IncrementalDpf idpf(params);
+
+    std::vector<uint32_t>       alpha = RandomBits(n);
+    std::pair<IdpfKey, IdpfKey> keys  = idpf.GenerateKeys(alpha, 1);
+
+    // Walking the tree from shared prefixes gives the same outputs as evaluating every input from the root
+    std::vector<uint32_t> x = RandomBits(n), y = x, out_x, out_y;
+    uint32_t              split = n / 2;
+    y[split] ^= 1;
+    for (const IdpfKey *key : {&keys.first, &keys.second}) {
+        idpf.EvaluatePrefixes(*key, x, out_x);
+        idpf.EvaluatePrefixes(*key, y, out_y);
+
+        IdpfNode node = idpf.GetRoot(*key), next, branch;
+        for (uint32_t i = 0; i < n; i++) {
+            if (i == split) {
+                result &= idpf.EvaluateNext(*key, i, node, y[i], branch) == out_y[i];
+            }
+            result &= idpf.EvaluateNext(*key, i, node, x[i], next) == out_x[i];
+            node = next;
+        }
+        for (uint32_t i = split + 1; i < n; i++) {
+            result &= idpf.EvaluateNext(*key, i, branch, y[i], next) == out_y[i];
+            branch = next;
+        }
+    }
+    keys.first.FreeIdpfKey();
+    keys.second.FreeIdpfKey();
+    return result;
+}
+
+}    // namespace test
+}    // namespace idpf
+}    // namespace fss
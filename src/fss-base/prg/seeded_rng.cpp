@@ -0,0 +1,48 @@
+/**
+ * @file seeded_rng.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-07
+ * @copyright Copyright (c) 2024
+ * @brief SeededRandomness implementation.
+ */
+
+#include "seeded_rng.hpp"
+
+#include <cstring>
+
+namespace fss {
+namespace prg {
+
+SeededRandomness::SeededRandomness(const Block &seed, const uint64_t key_index)
+    : prf_(PRG::Create(seed)), key_index_(key_index), counter_(0), offset_(sizeof(buffer_)) {
+    this->prev_ = tools::rng::SecureRng::SetThreadSource(this);
+}
+
+SeededRandomness::~SeededRandomness() {
+    tools::rng::SecureRng::SetThreadSource(this->prev_);
+}
+
+void SeededRandomness::Fill(tools::rng::byte *data, const size_t size) {
+    size_t filled = 0;
+    while (filled < size) {
+        if (this->offset_ == sizeof(this->buffer_)) {
+            this->Refill();
+        }
+        size_t len = std::min(size - filled, sizeof(this->buffer_) - this->offset_);
+        std::memcpy(data + filled, reinterpret_cast<const tools::rng::byte *>(this->buffer_.data()) + this->offset_, len);
+        this->offset_ += len;
+        filled += len;
+    }
+}
+
+void SeededRandomness::Refill() {
+    std::array<Block, kBufferBlocks> counters;
+    for (size_t i = 0; i < kBufferBlocks; i++) {
+        counters[i] = Block(this->key_index_, this->counter_++);
+    }
+    this->prf_.Evaluate(counters, this->buffer_);
+    this->offset_ = 0;
+}
+
+}    // namespace prg
+}    // namespace fss
@@ -0,0 +1,78 @@
+/**
+ * @file seeded_rng.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-07
+ * @copyright Copyright (c) 2024
+ * @brief SeededRandomness class (randomness of the key generation derived from a seed and a key index).
+ */
+
+#ifndef PRG_SEEDED_RNG_H_
+#define PRG_SEEDED_RNG_H_
+
+#include "../../tools/random_number_generator.hpp"
+#include "prg.hpp"
+
+namespace fss {
+namespace prg {
+
+/**
+ * @class SeededRandomness
+ * @brief Derive all the randomness drawn by the calling thread from a master seed and a key index while the object lives.
+ *
+ * The randomness is the AES-CTR stream AES_{seed}(key index || counter), so the key generators (and the secret
+ * sharing) called in the scope produce the same keys for the same seed and index. A dealer keeps the master seeds and
+ * the consumed indices instead of the keys, and regenerates the keys of any index on demand; the scopes are per
+ * thread, so the indices can be regenerated in parallel. Scopes can be nested; the previous source is restored at
+ * the end of the scope.
+ */
+class SeededRandomness : public tools::rng::RandomSource {
+public:
+    /**
+     * @brief Constructor for SeededRandomness.
+     * @param seed The master seed (the key of the PRF).
+     * @param key_index The index of the keys.
+     */
+    SeededRandomness(const Block &seed, const uint64_t key_index);
+
+    /**
+     * @brief Destructor for SeededRandomness (restores the previous source of the thread).
+     */
+    ~SeededRandomness() override;
+
+    // SeededRandomness is bound to the thread and the scope.
+    SeededRandomness(const SeededRandomness &)            = delete;
+    SeededRandomness &operator=(const SeededRandomness &) = delete;
+
+    /**
+     * @brief Fill the bytes with the next bytes of the stream.
+     * @param data The bytes.
+     * @param size The number of bytes.
+     */
+    void Fill(tools::rng::byte *data, const size_t size) override;
+
+private:
+    static constexpr size_t kBufferBlocks = 8; /**< The number of blocks encrypted at once. */
+
+    const PRG                        prf_;       /**< The PRF keyed with the master seed. */
+    const uint64_t                   key_index_; /**< The index of the keys. */
+    uint64_t                         counter_;   /**< The counter of the next blocks. */
+    std::array<Block, kBufferBlocks> buffer_;    /**< The encrypted blocks not consumed yet. */
+    size_t                           offset_;    /**< The number of bytes of the buffer consumed. */
+    tools::rng::RandomSource        *prev_;      /**< The source of the thread before this scope. */
+
+    /**
+     * @brief Encrypt the next blocks of the stream into the buffer.
+     */
+    void Refill();
+};
+
+namespace test {
+
+void Test_SeededRandomness(TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace prg
+}    // namespace fss
+
+#endif    // PRG_SEEDED_RNG_H_
@@ -0,0 +1,171 @@
+/**
+ * @file seeded_rng_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-07
+ * @copyright Copyright (c) 2024
+ * @brief SeededRandomness test implementation.
+ */
+
+#include "seeded_rng.hpp"
+
+#include <thread>
+
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+#include "../dpf/distributed_point_function.hpp"
+
+namespace {
+
+const fss::Block   kSeedTest{0x9c5b0a3e71d24f86, 0x2e8f4b1da7c6035e};
+const fss::Block   kSeedOther{0x41e3c9d27a5f0b68, 0xd0b7e2a4c5f31896};
+constexpr uint32_t kDrawNum     = 100;
+constexpr uint32_t kTestKeyNum  = 16;
+constexpr uint32_t kTestThreads = 4;
+
+// The DPF keys (n = e = 10) of the key index 0 of kSeedTest: the first draws of the key generation,
+// the initial seeds (high and low halves of each party) and the seed of the first correction word
+constexpr uint32_t            kPinnedBitsize = 10;
+const std::array<uint64_t, 6> kPinnedKey     = {0x9404c36eadfca715, 0xfc021bd48c89c9a2, 0xf0f537595010e3fe, 0x237720c2b268ce8f, 0xb282d8ce5bdf85c0, 0x72b957e6af0f6dd4};
+
+std::vector<uint64_t> Draw(const uint32_t num) {
+    std::vector<uint64_t> draws(num);
+    for (uint32_t i = 0; i < num; i++) {
+        draws[i] = tools::rng::SecureRng::Rand64();
+    }
+    return draws;
+}
+
+std::vector<uint64_t> DrawSeeded(const fss::Block &seed, const uint64_t key_index, const uint32_t num) {
+    fss::prg::SeededRandomness randomness(seed, key_index);
+    return Draw(num);
+}
+
+}    // namespace
+
+namespace fss {
+namespace prg {
+namespace test {
+
+bool Test_SeededStream(const TestInfo &test_info);
+bool Test_SeededKeys(const TestInfo &test_info);
+bool Test_SeededKeyPinned(const TestInfo &test_info);
+
+void Test_SeededRandomness(TestInfo &test_info) {
+    std::vector<std::string> modes         = {"SeededRandomness unit tests", "SeededStream", "SeededKeys", "SeededKeyPinned"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        utils::PrintTestResult("Test_SeededStream", Test_SeededStream(test_info));
+        utils::PrintTestResult("Test_SeededKeys", Test_SeededKeys(test_info));
+        utils::PrintTestResult("Test_SeededKeyPinned", Test_SeededKeyPinned(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_SeededStream", Test_SeededStream(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_SeededKeys", Test_SeededKeys(test_info));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_SeededKeyPinned", Test_SeededKeyPinned(test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_SeededStream(const TestInfo &test_info) {
+    bool result = true;
+
+    // The same seed and index give the same stream, another seed or index another stream
+    std::vector<uint64_t> draws = DrawSeeded(kSeedTest, 0, kDrawNum);
+    result &= (DrawSeeded(kSeedTest, 0, kDrawNum) == draws);
+    result &= (DrawSeeded(kSeedTest, 1, kDrawNum) != draws);
+    result &= (DrawSeeded(kSeedOther, 0, kDrawNum) != draws);
+
+    // The draws of any size follow the same stream
+    {
+        SeededRandomness randomness(kSeedTest, 0);
+        uint32_t         low  = tools::rng::SecureRng::Rand32();
+        uint32_t         high = tools::rng::SecureRng::Rand32();
+        result &= ((static_cast<uint64_t>(high) << 32 | low) == draws[0]);
+    }
+
+    // A nested scope does not change the stream of the outer one, and the default source is restored
+    {
+        SeededRandomness      randomness(kSeedTest, 0);
+        std::vector<uint64_t> outer = Draw(kDrawNum / 2);
+        result &= (DrawSeeded(kSeedOther, 7, kDrawNum) == DrawSeeded(kSeedOther, 7, kDrawNum));
+        std::vector<uint64_t> rest = Draw(kDrawNum - kDrawNum / 2);
+        outer.insert(outer.end(), rest.begin(), rest.end());
+        result &= (outer == draws);
+    }
+    result &= (Draw(kDrawNum) != draws);
+    utils::Logger::DebugLog(LOCATION, "First draw: " + std::to_string(draws[0]), test_info.dbg_info.debug);
+    return result;
+}
+
+bool Test_SeededKeys(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        dpf::DpfParameters            params(size, size, test_info.dbg_info);
+        dpf::DistributedPointFunction dpf(params);
+        std::vector<dpf::DpfKey>      keys_0(kTestKeyNum), keys_1(kTestKeyNum);
+        std::vector<uint8_t>          same(kTestKeyNum, 0);    // Written by the thread of the index only
+
+        // Generate the keys of every index, then regenerate them in parallel (thread i takes the indices i, i + threads, ...)
+        for (uint32_t j = 0; j < kTestKeyNum; j++) {
+            SeededRandomness                    randomness(kSeedTest, j);
+            std::pair<dpf::DpfKey, dpf::DpfKey> keys = dpf.GenerateKeys(utils::Mod(tools::rng::SecureRng::Rand32(), size), 1);
+            keys_0[j] = std::move(keys.first);
+            keys_1[j] = std::move(keys.second);
+        }
+        auto regenerate = [&](const uint32_t i) {
+            for (uint32_t j = i; j < kTestKeyNum; j += kTestThreads) {
+                SeededRandomness                    randomness(kSeedTest, j);
+                std::pair<dpf::DpfKey, dpf::DpfKey> keys = dpf.GenerateKeys(utils::Mod(tools::rng::SecureRng::Rand32(), size), 1);
+                same[j] = (keys.first == keys_0[j]) && (keys.second == keys_1[j]);
+                keys.first.FreeDpfKey();
+                keys.second.FreeDpfKey();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (uint32_t i = 0; i < kTestThreads; i++) {
+            workers.emplace_back(regenerate, i);
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        for (uint32_t j = 0; j < kTestKeyNum; j++) {
+            result &= (same[j] == 1);
+        }
+
+        // The keys of different indices differ
+        result &= !(keys_0[0] == keys_0[1]);
+        for (uint32_t j = 0; j < kTestKeyNum; j++) {
+            keys_0[j].FreeDpfKey();
+            keys_1[j].FreeDpfKey();
+        }
+        utils::Logger::DebugLog(LOCATION, "Domain size: " + std::to_string(size) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_SeededKeyPinned(const TestInfo &test_info) {
+    // The keys regenerated from a seed are the same in every build (e.g. the halves of a random block are drawn in a fixed order)
+    dpf::DpfParameters                  params(kPinnedBitsize, kPinnedBitsize, test_info.dbg_info);
+    dpf::DistributedPointFunction       dpf(params);
+    SeededRandomness                    randomness(kSeedTest, 0);
+    std::pair<dpf::DpfKey, dpf::DpfKey> keys = dpf.GenerateKeys(utils::Mod(tools::rng::SecureRng::Rand32(), kPinnedBitsize), 1);
+
+    std::array<uint64_t, 6> key = {keys.first.init_seed.GetHigh(), keys.first.init_seed.GetLow(),
+                                   keys.second.init_seed.GetHigh(), keys.second.init_seed.GetLow(),
+                                   keys.first.correction_words[0].seed.GetHigh(), keys.first.correction_words[0].seed.GetLow()};
+    keys.first.FreeDpfKey();
+    keys.second.FreeDpfKey();
+    return key == kPinnedKey;
+}
+
+}    // namespace test
+}    // namespace prg
+}    // namespace fss
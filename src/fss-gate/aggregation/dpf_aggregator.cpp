@@ -0,0 +1,124 @@
+/**
+ * @file dpf_aggregator.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-04
+ * @copyright Copyright (c) 2024
+ * @brief DpfAggregator implementation.
+ */
+
+#include "dpf_aggregator.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+utils::Counter &AggregatorReportCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_agg_reports_total", "Number of DPF reports added to the histogram shares.");
+    return counter;
+}
+
+utils::Histogram &AggregatorBatchLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_agg_batch_seconds", "Latency of the accumulation of a batch of DPF reports.");
+    return histogram;
+}
+
+}    // namespace
+
+namespace fss {
+namespace agg {
+
+DpfAggregatorParameters::DpfAggregatorParameters(const uint32_t n, const uint32_t e, const uint32_t thread_num, const DebugInfo &dbg_info)
+    : dpf_params(n, e, dbg_info), thread_num(std::max(1U, thread_num)), debug(dbg_info.debug) {
+}
+
+DpfAggregator::DpfAggregator(const DpfAggregatorParameters params)
+    : params_(params), dpf_(params.dpf_params), report_num_(0) {
+    this->accumulators_.resize(this->params_.thread_num);
+    this->Reset();
+}
+
+std::pair<dpf::DpfKey, dpf::DpfKey> DpfAggregator::GenerateReport(const uint32_t bucket) const {
+    if (bucket >= utils::Pow(2, this->params_.dpf_params.input_bitsize)) {
+        utils::Logger::FatalLog(LOCATION, "The bucket is out of range (" + std::to_string(bucket) + ")");
+        exit(EXIT_FAILURE);
+    }
+    return this->dpf_.GenerateKeys(bucket, 1);
+}
+
+void DpfAggregator::Accumulate(const std::vector<dpf::DpfKey> &keys) {
+    utils::HistogramTimer latency(AggregatorBatchLatency());
+    uint32_t              threads = std::min<size_t>(this->params_.thread_num, std::max<size_t>(keys.size(), 1));
+
+    // Thread i adds the keys i, i + threads, ... to its own accumulator
+    auto accumulate = [&](const uint32_t i) {
+        utils::HugeVector<uint32_t> &accumulator = this->accumulators_[i];
+        for (size_t j = i; j < keys.size(); j += threads) {
+            this->dpf_.EvaluateFullDomainAccumulate(keys[j], accumulator);
+        }
+    };
+    if (threads == 1) {
+        accumulate(0);
+    } else {
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (uint32_t i = 0; i < threads; i++) {
+            workers.emplace_back(accumulate, i);
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+    this->report_num_ += keys.size();
+    AggregatorReportCounter().Increment(keys.size());
+}
+
+void DpfAggregator::GetHistogram(std::vector<uint32_t> &histogram) const {
+    uint32_t e = this->params_.dpf_params.element_bitsize;
+    histogram.assign(this->accumulators_[0].begin(), this->accumulators_[0].end());
+    for (size_t i = 1; i < this->accumulators_.size(); i++) {
+        const utils::HugeVector<uint32_t> &accumulator = this->accumulators_[i];
+        for (size_t x = 0; x < histogram.size(); x++) {
+            histogram[x] += accumulator[x];
+        }
+    }
+    for (size_t x = 0; x < histogram.size(); x++) {
+        histogram[x] = utils::Mod(histogram[x], e);
+    }
+}
+
+uint64_t DpfAggregator::GetReportNum() const {
+    return this->report_num_;
+}
+
+void DpfAggregator::Reset() {
+    uint32_t domain = utils::Pow(2, this->params_.dpf_params.input_bitsize);
+    for (auto &accumulator : this->accumulators_) {
+        accumulator.assign(domain, 0);
+    }
+    this->report_num_ = 0;
+}
+
+void DpfAggregator::Reconst(const std::vector<uint32_t> &histogram_0, const std::vector<uint32_t> &histogram_1, std::vector<uint32_t> &histogram) const {
+    histogram.resize(histogram_0.size());
+    for (size_t x = 0; x < histogram_0.size(); x++) {
+        histogram[x] = utils::Mod(histogram_0[x] + histogram_1[x], this->params_.dpf_params.element_bitsize);
+    }
+}
+
+std::vector<uint32_t> DpfAggregator::GetHeavyHitters(const std::vector<uint32_t> &histogram, const uint32_t threshold) const {
+    std::vector<uint32_t> heavy_hitters;
+    for (size_t x = 0; x < histogram.size(); x++) {
+        if (histogram[x] >= threshold) {
+            heavy_hitters.push_back(static_cast<uint32_t>(x));
+        }
+    }
+    return heavy_hitters;
+}
+
+}    // namespace agg
+}    // namespace fss
@@ -0,0 +1,122 @@
+/**
+ * @file dpf_aggregator.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-04
+ * @copyright Copyright (c) 2024
+ * @brief DpfAggregator class (private histogram collection from DPF reports).
+ */
+
+#ifndef AGGREGATION_DPF_AGGREGATOR_H_
+#define AGGREGATION_DPF_AGGREGATOR_H_
+
+#include "../../fss-base/dpf/distributed_point_function.hpp"
+#include "../../utils/huge_page.hpp"
+
+namespace fss {
+namespace agg {
+
+/**
+ * @struct DpfAggregatorParameters
+ * @brief A struct to hold params for DpfAggregator.
+ */
+struct DpfAggregatorParameters {
+    const dpf::DpfParameters dpf_params; /**< The parameters for the DPF of the reports (domain: the buckets). */
+    const uint32_t           thread_num; /**< The number of threads (one accumulator each). */
+    const bool               debug;      /**< Debug utils::Mode flag. */
+
+    /**
+     * @brief Parameterized constructor for DpfAggregatorParameters.
+     * @param n The number of buckets in bits.
+     * @param e The bitsize of the counts.
+     * @param thread_num The number of threads.
+     * @param dbg_info Debug information.
+     */
+    DpfAggregatorParameters(const uint32_t n, const uint32_t e, const uint32_t thread_num, const DebugInfo &dbg_info);
+};
+
+/**
+ * @class DpfAggregator
+ * @brief One server of the two-server histogram collection.
+ *
+ * Each client submits one DPF key per server at its bucket (beta = 1). The server adds the full-domain evaluation of every key
+ * to its share of the histogram; the two shares reconstruct the count of every bucket and nothing else. The keys of a batch are
+ * split across the threads, each of which adds the packed leaf outputs straight into its own accumulator
+ * (DistributedPointFunction::EvaluateFullDomainAccumulate); the accumulators are reduced once when the share is read.
+ */
+class DpfAggregator {
+public:
+    /**
+     * @brief Constructor for DpfAggregator (empty histogram).
+     * @param params The parameters for DpfAggregator.
+     */
+    DpfAggregator(const DpfAggregatorParameters params);
+
+    /**
+     * @brief Generate the pair of keys of a report (client).
+     * @param bucket The bucket of the client.
+     * @return A pair of DpfKey (one per server).
+     */
+    std::pair<dpf::DpfKey, dpf::DpfKey> GenerateReport(const uint32_t bucket) const;
+
+    /**
+     * @brief Add the reports of a batch to the histogram share.
+     * @param keys The DpfKey of this server of each report.
+     */
+    void Accumulate(const std::vector<dpf::DpfKey> &keys);
+
+    /**
+     * @brief Reduce the accumulators into the share of the histogram.
+     * @param histogram The share of the count of every bucket (size: 2^n).
+     */
+    void GetHistogram(std::vector<uint32_t> &histogram) const;
+
+    /**
+     * @brief Retrieves the number of reports added since the last Reset.
+     * @return The number of reports.
+     */
+    uint64_t GetReportNum() const;
+
+    /**
+     * @brief Clear the histogram share.
+     */
+    void Reset();
+
+    /**
+     * @brief Reconstruct the histogram from the shares of the two servers.
+     * @param histogram_0 The share of server 0.
+     * @param histogram_1 The share of server 1.
+     * @param histogram The count of every bucket.
+     */
+    void Reconst(const std::vector<uint32_t> &histogram_0, const std::vector<uint32_t> &histogram_1, std::vector<uint32_t> &histogram) const;
+
+    /**
+     * @brief Retrieves the heavy hitters of a histogram.
+     * @param histogram The count of every bucket.
+     * @param threshold The minimum count.
+     * @return The buckets with at least threshold reports, in ascending order.
+     */
+    std::vector<uint32_t> GetHeavyHitters(const std::vector<uint32_t> &histogram, const uint32_t threshold) const;
+
+private:
+    const DpfAggregatorParameters            params_;       /**< The parameters for DpfAggregator. */
+    const dpf::DistributedPointFunction      dpf_;          /**< The DPF of the reports. */
+    std::vector<utils::HugeVector<uint32_t>> accumulators_; /**< The per-thread sums of the evaluations (mod 2^32). */
+    uint64_t                                 report_num_;   /**< The number of reports added since the last Reset. */
+};
+
+namespace test {
+
+void Test_DpfAggregator(TestInfo &test_info);
+
+}    // namespace test
+
+namespace bench {
+
+void Bench_DpfAggregator(const BenchInfo &bench_info);
+
+}    // namespace bench
+
+}    // namespace agg
+}    // namespace fss
+
+#endif    // AGGREGATION_DPF_AGGREGATOR_H_
@@ -0,0 +1,124 @@
+/**
+ * @file dpf_aggregator_bench.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-04
+ * @copyright Copyright (c) 2024
+ * @brief DpfAggregator benchmark implementation.
+ */
+
+#include "dpf_aggregator.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/memory.hpp"
+#include "../../utils/timer.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+constexpr uint32_t kBenchCountSize = 32;
+
+}    // namespace
+
+namespace fss {
+namespace agg {
+namespace bench {
+
+void Bench_DpfAggregator(const BenchInfo &bench_info) {
+    // Define utilities
+    utils::ExecutionTimer timer_all, timer_1;
+    utils::MemoryMonitor  mem_1;
+
+    std::vector<std::string> modes         = {"Measurement of naive full-domain evaluation and addition", "Measurement of DpfAggregator"};
+    uint32_t                 selected_mode = bench_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+    uint32_t max_thread_num = std::max(1U, std::thread::hardware_concurrency());
+
+    for (const auto t : bench_info.text_size) {
+        for (const auto q : bench_info.query_size) {
+            for (uint32_t i = 0; i < bench_info.experiment_num; i++) {
+                uint32_t report_num = utils::Pow(2, q);
+                utils::Logger::InfoLog(LOCATION, "DpfAggregator: (bucket size, report num) = (" + std::to_string(t) + ", " + std::to_string(report_num) + ")");
+
+                // Measure total time
+                std::string mode_str     = "[" + modes[selected_mode - 1] + "],";
+                std::string measure_info = "Info,Bucket size,Report num,Threads,Time";
+                utils::Logger::InfoLog(LOCATION, mode_str + measure_info);
+                timer_all.Start();
+                // ############# START #############
+
+                // The clients of the simulation
+                DpfAggregatorParameters  params(t, kBenchCountSize, 1, bench_info.dbg_info);
+                DpfAggregator            client(params);
+                std::vector<dpf::DpfKey> keys_0, keys_1;
+                keys_0.reserve(report_num);
+                keys_1.reserve(report_num);
+                for (uint32_t j = 0; j < report_num; j++) {
+                    std::pair<dpf::DpfKey, dpf::DpfKey> keys = client.GenerateReport(utils::Mod(tools::rng::SecureRng::Rand32(), t));
+                    keys_0.push_back(std::move(keys.first));
+                    keys_1.push_back(std::move(keys.second));
+                }
+                timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
+
+                if (selected_mode == 1) {
+                    // One output vector per key and a separate addition
+                    measure_info = "," + std::to_string(t) + "," + std::to_string(report_num) + ",1";
+                    dpf::DistributedPointFunction dpf(params.dpf_params);
+                    mem_1.Start();
+                    timer_1.Start();
+                    for (const auto *keys : {&keys_0, &keys_1}) {
+                        std::vector<uint32_t> histogram(utils::Pow(2, t), 0);
+                        for (const dpf::DpfKey &key : *keys) {
+                            std::vector<uint32_t> outputs(utils::Pow(2, t));
+                            dpf.EvaluateFullDomain(key, outputs);
+                            for (size_t x = 0; x < outputs.size(); x++) {
+                                histogram[x] += outputs[x];
+                            }
+                        }
+                    }
+                    double time = timer_1.Print(LOCATION, mode_str + "Aggregate" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Aggregate" + measure_info);
+                    utils::Logger::InfoLog(LOCATION, mode_str + "Keys per second" + measure_info + "," + utils::DoubleToStr(2.0 * report_num / (time * 1e-6)));
+
+                } else if (selected_mode == 2) {
+                    for (const uint32_t thread_num : {1U, max_thread_num}) {
+                        measure_info = "," + std::to_string(t) + "," + std::to_string(report_num) + "," + std::to_string(thread_num);
+                        DpfAggregatorParameters server_params(t, kBenchCountSize, thread_num, bench_info.dbg_info);
+                        DpfAggregator           server_0(server_params), server_1(server_params);
+                        std::vector<uint32_t>   histogram_0, histogram_1;
+                        mem_1.Start();
+                        timer_1.Start();
+                        server_0.Accumulate(keys_0);
+                        server_0.GetHistogram(histogram_0);
+                        server_1.Accumulate(keys_1);
+                        server_1.GetHistogram(histogram_1);
+                        double time = timer_1.Print(LOCATION, mode_str + "Aggregate" + measure_info);
+                        mem_1.Print(LOCATION, mode_str + "Aggregate" + measure_info);
+                        utils::Logger::InfoLog(LOCATION, mode_str + "Keys per second" + measure_info + "," + utils::DoubleToStr(2.0 * report_num / (time * 1e-6)));
+                    }
+                }
+                for (uint32_t j = 0; j < report_num; j++) {
+                    keys_0[j].FreeDpfKey();
+                    keys_1[j].FreeDpfKey();
+                }
+
+                // ############# END #############
+                double timer_res = timer_all.Print(LOCATION, mode_str + "Bench Total time" + measure_info);
+                if (utils::ExecutionTimer::IsExceedLimitTime(timer_res, bench_info.limit_time_ms, timer_all.GetTimeUnit())) {
+                    utils::Logger::InfoLog(LOCATION, "The execution time exceeds the limit time: " + std::to_string(timer_res) + " " + timer_all.GetTimeUnitStr());
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+}
+
+}    // namespace bench
+}    // namespace agg
+}    // namespace fss
@@ -0,0 +1,101 @@
+/**
+ * @file dpf_aggregator_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-04
+ * @copyright Copyright (c) 2024
+ * @brief DpfAggregator test implementation.
+ */
+
+#include "dpf_aggregator.hpp"
+
+#include <algorithm>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+const std::vector<uint32_t> kTestThreadNums = {1, 3};
+const std::vector<uint32_t> kTestCountSizes = {20, 32};
+constexpr uint32_t          kTestReportNum  = 40;
+constexpr uint32_t          kTestBatchNum   = 3;
+
+}    // namespace
+
+namespace fss {
+namespace agg {
+namespace test {
+
+bool Test_Histogram(const TestInfo &test_info);
+
+void Test_DpfAggregator(TestInfo &test_info) {
+    std::vector<std::string> modes         = {"DpfAggregator unit tests", "Histogram"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        utils::PrintTestResult("Test_Histogram", Test_Histogram(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_Histogram", Test_Histogram(test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_Histogram(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        for (const auto e : kTestCountSizes) {
+            for (const auto thread_num : kTestThreadNums) {
+                DpfAggregatorParameters params(size, e, thread_num, test_info.dbg_info);
+                DpfAggregator           server_0(params), server_1(params);
+
+                // The clients report in several batches (the first bucket is a heavy hitter)
+                std::vector<uint32_t> expected(utils::Pow(2, size), 0);
+                for (uint32_t batch = 0; batch < kTestBatchNum; batch++) {
+                    std::vector<dpf::DpfKey> keys_0, keys_1;
+                    for (uint32_t i = 0; i < kTestReportNum; i++) {
+                        uint32_t                            bucket = (i % 2 == 0) ? 0 : utils::Mod(tools::rng::SecureRng::Rand32(), size);
+                        std::pair<dpf::DpfKey, dpf::DpfKey> keys   = server_0.GenerateReport(bucket);
+                        keys_0.push_back(std::move(keys.first));
+                        keys_1.push_back(std::move(keys.second));
+                        expected[bucket]++;
+                    }
+                    server_0.Accumulate(keys_0);
+                    server_1.Accumulate(keys_1);
+                    for (size_t i = 0; i < keys_0.size(); i++) {
+                        keys_0[i].FreeDpfKey();
+                        keys_1[i].FreeDpfKey();
+                    }
+                }
+                result &= server_0.GetReportNum() == kTestBatchNum * kTestReportNum && server_1.GetReportNum() == kTestBatchNum * kTestReportNum;
+
+                std::vector<uint32_t> histogram_0, histogram_1, histogram;
+                server_0.GetHistogram(histogram_0);
+                server_1.GetHistogram(histogram_1);
+                server_0.Reconst(histogram_0, histogram_1, histogram);
+                result &= histogram == expected;
+                utils::Logger::DebugLog(LOCATION, "(n, e, threads)=(" + std::to_string(size) + ", " + std::to_string(e) + ", " + std::to_string(thread_num) + "): " + (histogram == expected ? "ok" : "mismatch"), test_info.dbg_info.debug);
+
+                // Half of the reports are at bucket 0
+                std::vector<uint32_t> heavy_hitters = server_0.GetHeavyHitters(histogram, kTestBatchNum * kTestReportNum / 2);
+                result &= !heavy_hitters.empty() && heavy_hitters.front() == 0;
+
+                // Reset clears the shares
+                server_0.Reset();
+                server_0.GetHistogram(histogram_0);
+                result &= server_0.GetReportNum() == 0 && std::all_of(histogram_0.begin(), histogram_0.end(), [](const uint32_t c) { return c == 0; });
+            }
+        }
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace agg
+}    // namespace fss
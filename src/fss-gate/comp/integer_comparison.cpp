@@ -8,8 +8,10 @@
 
 #include "integer_comparison.hpp"
 
+#include <algorithm>
 #include <bitset>
 
+#include "../../fss-base/prg/seeded_rng.hpp"
 #include "../../tools/random_number_generator.hpp"
 #include "../../utils/logger.hpp"
 #include "../../utils/utils.hpp"
@@ -110,6 +112,11 @@ std::pair<CompKey, CompKey> IntegerComparison::GenerateKeys() const {
     return std::make_pair(std::move(keys[0]), std::move(keys[1]));
 }
 
+std::pair<CompKey, CompKey> IntegerComparison::GenerateKeys(const Block &seed, const uint64_t key_index) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateKeys();
+}
+
 uint32_t IntegerComparison::Evaluate(const CompKey &comp_key, const uint32_t x, const uint32_t y) const {
     int n        = this->params_.input_bitsize;
     int e        = this->params_.element_bitsize;
@@ -136,5 +143,35 @@ uint32_t IntegerComparison::Evaluate(const CompKey &comp_key, const uint32_t x,
     return output;
 }
 
+CompSession::CompSession(const IntegerComparison &comp, const CompKey &comp_key, const uint32_t x, const uint32_t y)
+    : comp_(comp), comp_key_(comp_key), output_(0), finished_(false) {
+    uint32_t n = this->comp_.params_.input_bitsize;
+    this->xyr_ = {utils::Mod(x + comp_key.shr1_in, n), utils::Mod(y + comp_key.shr2_in, n)};
+}
+
+bool CompSession::IsFinished() const {
+    return this->finished_;
+}
+
+uint32_t CompSession::GetOpeningSize() const {
+    return this->finished_ ? 0 : this->xyr_.size();
+}
+
+void CompSession::WriteOpening(uint32_t *shares) const {
+    std::copy(this->xyr_.begin(), this->xyr_.end(), shares);
+}
+
+void CompSession::Resume(const uint32_t *opened) {
+    uint32_t n      = this->comp_.params_.input_bitsize;
+    uint32_t e      = this->comp_.params_.element_bitsize;
+    uint32_t output = this->comp_.Evaluate(this->comp_key_, utils::Mod(opened[0], n), utils::Mod(opened[1], n));
+    this->output_   = utils::Mod(output - this->comp_key_.shr_out, e);
+    this->finished_ = true;
+}
+
+uint32_t CompSession::GetOutput() const {
+    return this->output_;
+}
+
 }    // namespace comp
 }    // namespace fss
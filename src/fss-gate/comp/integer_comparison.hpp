@@ -10,6 +10,7 @@
 #define COMP_INTEGER_COMPARISON_H_
 
 #include "../../fss-base/ddcf/dual_dcf.hpp"
+#include "../../tools/protocol_session.hpp"
 #include "../../tools/secret_sharing.hpp"
 
 namespace fss {
@@ -112,6 +113,14 @@ public:
      */
     std::pair<CompKey, CompKey> GenerateKeys() const;
 
+    /**
+     * @brief Generate a pair of CompKey instances from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<CompKey, CompKey> GenerateKeys(const Block &seed, const uint64_t key_index) const;
+
     /**
      * @brief Evaluate integer comparison using the provided CompKey.
      *
@@ -126,10 +135,48 @@ public:
     uint32_t Evaluate(const CompKey &comp_key, const uint32_t x, const uint32_t y) const;
 
 private:
+    friend class CompSession;
+
     const CompParameters                          params_; /**< Parameters for IntegerComparison. */
     const ddcf::DualDistributedComparisonFunction ddcf_;   /**< Underlying DualDistributedComparisonFunction instance. */
 };
 
+/**
+ * @class CompSession
+ * @brief Resumable integer comparison of two shares: one round opens (x + r_1, y + r_2), then the key is evaluated.
+ *
+ * The key and the IntegerComparison object must outlive the session.
+ */
+class CompSession : public tools::secret_sharing::ProtocolSession {
+public:
+    /**
+     * @brief Construct a new CompSession.
+     * @param comp The IntegerComparison object.
+     * @param comp_key The CompKey of this party.
+     * @param x The share of the first input.
+     * @param y The share of the second input.
+     */
+    CompSession(const IntegerComparison &comp, const CompKey &comp_key, const uint32_t x, const uint32_t y);
+
+    bool     IsFinished() const override;
+    uint32_t GetOpeningSize() const override;
+    void     WriteOpening(uint32_t *shares) const override;
+    void     Resume(const uint32_t *opened) override;
+
+    /**
+     * @brief Get the output of the comparison (available after the session is finished).
+     * @return The share of 1 if x < y else 0 (the output mask is removed).
+     */
+    uint32_t GetOutput() const;
+
+private:
+    const IntegerComparison &comp_;     /**< The IntegerComparison object. */
+    const CompKey           &comp_key_; /**< The CompKey of this party. */
+    std::array<uint32_t, 2>  xyr_;      /**< The shares of (x + r_1, y + r_2). */
+    uint32_t                 output_;   /**< The share of the result. */
+    bool                     finished_; /**< Flag indicating the output is available. */
+};
+
 namespace test {
 
 void Test_Comp(tools::secret_sharing::Party &party, const TestInfo &test_info);
@@ -46,7 +46,7 @@ void Test_Comp(tools::secret_sharing::Party &party, const TestInfo &test_info) {
     internal::FssKeyIo                           key_io(true);
     comp::IntegerComparison                      comp(params);
 
-    std::vector<std::string> modes         = {"Generate share of data.", "Generate COMP key.", "Execute Eval^{Comp} algorithm"};
+    std::vector<std::string> modes         = {"Generate share of data.", "Generate COMP key.", "Execute Eval^{Comp} algorithm", "Execute Eval^{Comp} algorithm in sessions"};
     int                      selected_mode = test_info.mode;
     if (selected_mode < 1 || selected_mode > static_cast<int>(modes.size())) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -83,6 +83,49 @@ void Test_Comp(tools::secret_sharing::Party &party, const TestInfo &test_info) {
 
         comp_keys.first.PrintCompKey(test_info.dbg_info.debug);
         comp_keys.second.PrintCompKey(test_info.dbg_info.debug);
+    } else if (selected_mode == 4) {
+        CompKey               comp_key;
+        std::vector<uint32_t> x(kNumOfElement), y(kNumOfElement), x_sh(kNumOfElement), y_sh(kNumOfElement);
+        io.ReadVectorFromFile(kCompDataXPath, x);
+        io.ReadVectorFromFile(kCompDataYPath, y);
+        if (party.GetId() == 0) {
+            key_io.ReadCompKeyFromFile(kCompKeyPathP0, n, comp_key);
+            sh.LoadShare(kCompShareXPathP0, x_sh);
+            sh.LoadShare(kCompShareYPathP0, y_sh);
+        } else {
+            key_io.ReadCompKeyFromFile(kCompKeyPathP1, n, comp_key);
+            sh.LoadShare(kCompShareXPathP1, x_sh);
+            sh.LoadShare(kCompShareYPathP1, y_sh);
+        }
+        party.StartCommunication();
+
+        // All the comparisons open their inputs in one round
+        std::vector<CompSession>                  sessions;
+        tools::secret_sharing::SessionMultiplexer mux(party);
+        sessions.reserve(kNumOfElement);
+        for (int i = 0; i < kNumOfElement; i++) {
+            sessions.emplace_back(comp, comp_key, x_sh[i], y_sh[i]);
+        }
+        for (auto &session : sessions) {
+            mux.AddSession(session);
+        }
+        uint32_t rounds = mux.Run();
+        utils::PrintValidity(__FUNCTION__, rounds, 1, test_info.dbg_info.debug);
+
+        std::vector<uint32_t> res_0(kNumOfElement), res_1(kNumOfElement), res(kNumOfElement);
+        for (int i = 0; i < kNumOfElement; i++) {
+            ((party.GetId() == 0) ? res_0 : res_1)[i] = sessions[i].GetOutput();
+        }
+        ss.Reconst(party, res_0, res_1, res);
+        for (int i = 0; i < kNumOfElement; i++) {
+            // The comparison is only defined for |x| + |y| < 2^(n-1)
+            if (utils::Abs(utils::To2Complement(x[i], e)) + utils::Abs(utils::To2Complement(y[i], e)) >= half_domain_size) {
+                continue;
+            }
+            uint32_t expected = (utils::To2Complement(x[i], e) < utils::To2Complement(y[i], e)) ? 1 : 0;
+            utils::PrintValidity(__FUNCTION__, res[i], expected, test_info.dbg_info.debug);
+        }
+        comp_key.FreeCompKey();
     } else {
         // Read Comp key
         utils::Logger::InfoLog(LOCATION, "Read Comp key");
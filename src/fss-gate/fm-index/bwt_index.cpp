@@ -0,0 +1,265 @@
+/**
+ * @file bwt_index.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-14
+ * @copyright Copyright (c) 2024
+ * @brief BWT index implementation.
+ */
+
+#include "bwt_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <divsufsort.h>
+#include <divsufsort64.h>
+#include <fstream>
+#include <limits>
+
+#include "../../utils/logger.hpp"
+
+namespace {
+
+constexpr char     kBwtIndexMagic[8] = {'F', 'S', 'S', 'B', 'W', 'T', '\0', '\0'};
+constexpr uint32_t kWordBits         = 64;
+
+template <typename T>
+void WriteValue(std::ofstream &file, const T &value) {
+    file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool ReadValue(std::ifstream &file, T &value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+void WriteArray(std::ofstream &file, const std::vector<uint64_t> &vec) {
+    WriteValue(file, static_cast<uint64_t>(vec.size()));
+    file.write(reinterpret_cast<const char *>(vec.data()), vec.size() * sizeof(uint64_t));
+}
+
+bool ReadArray(std::ifstream &file, std::vector<uint64_t> &vec) {
+    uint64_t size = 0;
+    if (!ReadValue(file, size)) {
+        return false;
+    }
+    vec.resize(size);
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(vec.data()), size * sizeof(uint64_t)));
+}
+
+// Fill the packed BWT, the occurrence table and the sampled SA of `text + '$'` from the suffix array of `text`.
+template <typename T>
+void FillBwtIndex(const std::string &text, const std::vector<T> &sa, const uint32_t sa_sample_rate, fss::fmi::BwtIndex &index) {
+    uint64_t n       = text.size();
+    uint64_t length  = n + 1;
+    index.length     = length;
+    index.dollar_pos = 0;
+    index.zero_count = std::count(text.begin(), text.end(), '0');
+    index.bwt_bits.assign((length + kWordBits - 1) / kWordBits, 0);
+    index.occ.assign(length / fss::fmi::kOccBlockBits + 1, 0);
+    index.sa_samples.assign((length + sa_sample_rate - 1) / sa_sample_rate, 0);
+    index.sa_sample_rate = sa_sample_rate;
+
+    for (uint64_t i = 0; i < length; i++) {
+        // Row 0 is the suffix "$"; row i (i >= 1) is the suffix starting at sa[i - 1].
+        uint64_t suffix = (i == 0) ? n : static_cast<uint64_t>(sa[i - 1]);
+        if (suffix == 0) {
+            index.dollar_pos = i;
+        } else if (text[suffix - 1] == '1') {
+            index.bwt_bits[i / kWordBits] |= (1ULL << (i % kWordBits));
+        }
+        if (i % sa_sample_rate == 0) {
+            index.sa_samples[i / sa_sample_rate] = suffix;
+        }
+    }
+
+    // Occurrence table of '1' at the block boundaries
+    uint64_t words_per_block = fss::fmi::kOccBlockBits / kWordBits;
+    uint64_t ones            = 0;
+    for (uint64_t w = 0; w < index.bwt_bits.size(); w++) {
+        if (w % words_per_block == 0) {
+            index.occ[w / words_per_block] = ones;
+        }
+        ones += __builtin_popcountll(index.bwt_bits[w]);
+    }
+    if (index.bwt_bits.size() % words_per_block == 0 && index.bwt_bits.size() / words_per_block < index.occ.size()) {
+        index.occ[index.bwt_bits.size() / words_per_block] = ones;
+    }
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+
+BwtIndex::BwtIndex()
+    : length(0), dollar_pos(0), zero_count(0), sa_sample_rate(kDefaultSaSampleRate) {
+}
+
+char BwtIndex::At(const uint64_t pos) const {
+    if (pos == this->dollar_pos) {
+        return '$';
+    }
+    return ((this->bwt_bits[pos / kWordBits] >> (pos % kWordBits)) & 1ULL) ? '1' : '0';
+}
+
+uint64_t BwtIndex::Rank1(const uint64_t pos) const {
+    uint64_t block = pos / kOccBlockBits;
+    uint64_t rank  = this->occ[block];
+    uint64_t w     = block * (kOccBlockBits / kWordBits);
+    for (; w < pos / kWordBits; w++) {
+        rank += __builtin_popcountll(this->bwt_bits[w]);
+    }
+    if (pos % kWordBits != 0) {
+        rank += __builtin_popcountll(this->bwt_bits[w] & ((1ULL << (pos % kWordBits)) - 1ULL));
+    }
+    return rank;
+}
+
+std::string BwtIndex::ToString() const {
+    std::string bwt(this->length, '0');
+    for (uint64_t i = 0; i < this->length; i++) {
+        bwt[i] = this->At(i);
+    }
+    return bwt;
+}
+
+bool BuildBwtIndex(const std::string &text, const uint32_t sa_sample_rate, BwtIndex &index) {
+    if (sa_sample_rate == 0) {
+        utils::Logger::ErrorLog(LOCATION, "The sampling rate of the suffix array must be positive");
+        return false;
+    }
+    if (text.find_first_not_of("01") != std::string::npos) {
+        utils::Logger::ErrorLog(LOCATION, "The text must consist of '0' and '1'");
+        return false;
+    }
+
+    const sauchar_t *data = reinterpret_cast<const sauchar_t *>(text.data());
+    if (text.size() < static_cast<uint64_t>(std::numeric_limits<saidx_t>::max())) {
+        std::vector<saidx_t> sa(text.size());
+        if (!text.empty() && divsufsort(data, sa.data(), static_cast<saidx_t>(text.size())) != 0) {
+            utils::Logger::ErrorLog(LOCATION, "Failed to construct the suffix array");
+            return false;
+        }
+        FillBwtIndex(text, sa, sa_sample_rate, index);
+    } else {
+        std::vector<saidx64_t> sa(text.size());
+        if (divsufsort64(data, sa.data(), static_cast<saidx64_t>(text.size())) != 0) {
+            utils::Logger::ErrorLog(LOCATION, "Failed to construct the suffix array");
+            return false;
+        }
+        FillBwtIndex(text, sa, sa_sample_rate, index);
+    }
+    return true;
+}
+
+bool ReadCorpusFromFile(const std::string &corpus_path, std::string &text) {
+    std::ifstream file(corpus_path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to open file for reading. (" + corpus_path + ")");
+        return false;
+    }
+
+    // Stream the corpus and keep only the characters of the text
+    std::vector<char> buffer(kCorpusReadBufferBytes);
+    text.clear();
+    text.reserve(file.tellg());
+    file.seekg(0);
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize read_bytes = file.gcount();
+        for (std::streamsize i = 0; i < read_bytes; i++) {
+            if (buffer[i] == '0' || buffer[i] == '1') {
+                text.push_back(buffer[i]);
+            }
+        }
+    }
+    file.close();
+    return true;
+}
+
+bool BuildBwtIndexFromFile(const std::string &corpus_path, const bool reverse, const uint32_t sa_sample_rate, BwtIndex &index) {
+    std::string text;
+    if (!ReadCorpusFromFile(corpus_path, text)) {
+        return false;
+    }
+    if (reverse) {
+        std::reverse(text.begin(), text.end());
+    }
+    return BuildBwtIndex(text, sa_sample_rate, index);
+}
+
+bool WriteBwtIndexToFile(const std::string &file_path, const BwtIndex &index) {
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to open file for writing. (" + file_path + ")");
+        return false;
+    }
+
+    file.write(kBwtIndexMagic, sizeof(kBwtIndexMagic));
+    WriteValue(file, kBwtIndexVersion);
+    WriteValue(file, index.sa_sample_rate);
+    WriteValue(file, index.length);
+    WriteValue(file, index.dollar_pos);
+    WriteValue(file, index.zero_count);
+    WriteArray(file, index.bwt_bits);
+    WriteArray(file, index.occ);
+    WriteArray(file, index.sa_samples);
+
+    if (!file) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to write the BWT index. (" + file_path + ")");
+        return false;
+    }
+    return true;
+}
+
+bool ReadBwtIndexFromFile(const std::string &file_path, BwtIndex &index) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to open file for reading. (" + file_path + ")");
+        return false;
+    }
+
+    char     magic[sizeof(kBwtIndexMagic)];
+    uint32_t version = 0;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kBwtIndexMagic, sizeof(magic)) != 0 || !ReadValue(file, version) || version != kBwtIndexVersion) {
+        utils::Logger::ErrorLog(LOCATION, "Invalid BWT index file. (" + file_path + ")");
+        return false;
+    }
+    if (!ReadValue(file, index.sa_sample_rate) || !ReadValue(file, index.length) || !ReadValue(file, index.dollar_pos) || !ReadValue(file, index.zero_count) ||
+        !ReadArray(file, index.bwt_bits) || !ReadArray(file, index.occ) || !ReadArray(file, index.sa_samples)) {
+        utils::Logger::ErrorLog(LOCATION, "Truncated BWT index file. (" + file_path + ")");
+        return false;
+    }
+    return true;
+}
+
+bool ReadBwtIndexLayout(const std::string &file_path, BwtIndexLayout &layout) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to open file for reading. (" + file_path + ")");
+        return false;
+    }
+
+    char     magic[sizeof(kBwtIndexMagic)];
+    uint32_t version = 0, sa_sample_rate = 0;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kBwtIndexMagic, sizeof(magic)) != 0 || !ReadValue(file, version) || version != kBwtIndexVersion) {
+        utils::Logger::ErrorLog(LOCATION, "Invalid BWT index file. (" + file_path + ")");
+        return false;
+    }
+    if (!ReadValue(file, sa_sample_rate) || !ReadValue(file, layout.length) || !ReadValue(file, layout.dollar_pos) || !ReadValue(file, layout.zero_count) || !ReadValue(file, layout.bits_words)) {
+        utils::Logger::ErrorLog(LOCATION, "Truncated BWT index file. (" + file_path + ")");
+        return false;
+    }
+    layout.bits_offset = static_cast<uint64_t>(file.tellg());
+
+    // The packed BWT must be in the file
+    file.seekg(0, std::ios::end);
+    if (static_cast<uint64_t>(file.tellg()) < layout.bits_offset + layout.bits_words * sizeof(uint64_t) || layout.bits_words * kWordBits < layout.length) {
+        utils::Logger::ErrorLog(LOCATION, "Truncated BWT index file. (" + file_path + ")");
+        return false;
+    }
+    return true;
+}
+
+}    // namespace fmi
+}    // namespace fss
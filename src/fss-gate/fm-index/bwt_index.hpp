@@ -0,0 +1,156 @@
+/**
+ * @file bwt_index.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-14
+ * @copyright Copyright (c) 2024
+ * @brief BWT index construction and I/O.
+ */
+
+#ifndef FM_INDEX_BWT_INDEX_H_
+#define FM_INDEX_BWT_INDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../fss-base/fss_configure.hpp"
+
+namespace fss {
+namespace fmi {
+
+constexpr uint32_t kBwtIndexVersion       = 1;
+constexpr uint32_t kOccBlockBits          = 512;    // Bits of the BWT covered by one entry of the occurrence table
+constexpr uint32_t kDefaultSaSampleRate   = 32;     // Every k-th entry of the suffix array is kept
+constexpr uint32_t kCorpusReadBufferBytes = 1 << 20;
+
+/**
+ * @struct BwtIndex
+ * @brief The index of a binary text ('0' and '1') loaded by the party processes.
+ *
+ * The BWT of `text + '$'` is packed with one bit per character ('1' -> 1, '0' and '$' -> 0),
+ * and the position of '$' is stored separately.
+ */
+struct BwtIndex {
+    uint64_t              length;         /**< The length of the BWT (text size + 1). */
+    uint64_t              dollar_pos;     /**< The position of '$' in the BWT. */
+    uint64_t              zero_count;     /**< The number of '0' in the text (C['1'] - 1). */
+    uint32_t              sa_sample_rate; /**< The sampling rate of the suffix array. */
+    std::vector<uint64_t> bwt_bits;       /**< The packed BWT. */
+    std::vector<uint64_t> occ;            /**< occ[i]: the number of '1' in BWT[0, i * kOccBlockBits). */
+    std::vector<uint64_t> sa_samples;     /**< sa_samples[i]: SA[i * sa_sample_rate] of `text + '$'`. */
+
+    /**
+     * @brief Default constructor for BwtIndex.
+     */
+    BwtIndex();
+
+    bool operator==(const BwtIndex &rhs) const {
+        return (length == rhs.length) && (dollar_pos == rhs.dollar_pos) && (zero_count == rhs.zero_count) && (sa_sample_rate == rhs.sa_sample_rate) &&
+               (bwt_bits == rhs.bwt_bits) && (occ == rhs.occ) && (sa_samples == rhs.sa_samples);
+    }
+
+    bool operator!=(const BwtIndex &rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Get the character of the BWT at the given position.
+     * @param pos The position in the BWT.
+     * @return '0', '1' or '$'.
+     */
+    char At(const uint64_t pos) const;
+
+    /**
+     * @brief Count the number of '1' in BWT[0, pos) using the occurrence table.
+     * @param pos The end position (exclusive).
+     * @return The number of '1'.
+     */
+    uint64_t Rank1(const uint64_t pos) const;
+
+    /**
+     * @brief Convert the packed BWT to the string form used by FssFmi::SetSentence.
+     * @return The BWT as a string of '0', '1' and '$'.
+     */
+    std::string ToString() const;
+};
+
+/**
+ * @struct BwtIndexLayout
+ * @brief The header of a BWT index file and the location of the packed BWT in it (used to stream the BWT from disk).
+ */
+struct BwtIndexLayout {
+    uint64_t length;      /**< The length of the BWT. */
+    uint64_t dollar_pos;  /**< The position of '$' in the BWT. */
+    uint64_t zero_count;  /**< The number of '0' in the text. */
+    uint64_t bits_offset; /**< The byte offset of the packed BWT in the file. */
+    uint64_t bits_words;  /**< The number of 64-bit words of the packed BWT. */
+};
+
+/**
+ * @brief Construct the BWT index of a binary text.
+ *
+ * The suffix array is built with libdivsufsort (64-bit variant for texts of 2^31 characters or more).
+ *
+ * @param text The text consisting of '0' and '1'.
+ * @param sa_sample_rate The sampling rate of the suffix array.
+ * @param index The constructed index.
+ * @return `true` if the index was constructed.
+ */
+bool BuildBwtIndex(const std::string &text, const uint32_t sa_sample_rate, BwtIndex &index);
+
+/**
+ * @brief Read the text of a corpus file.
+ *
+ * The corpus is read in blocks of `kCorpusReadBufferBytes`; characters other than '0' and '1' (e.g. separators and newlines) are skipped.
+ *
+ * @param corpus_path The path to the corpus file.
+ * @param text The text consisting of '0' and '1'.
+ * @return `true` if the corpus was read.
+ */
+bool ReadCorpusFromFile(const std::string &corpus_path, std::string &text);
+
+/**
+ * @brief Construct the BWT index from a corpus file (see ReadCorpusFromFile).
+ *
+ * @param corpus_path The path to the corpus file.
+ * @param reverse Reverse the text before the construction (used to find the longest prefix match).
+ * @param sa_sample_rate The sampling rate of the suffix array.
+ * @param index The constructed index.
+ * @return `true` if the index was constructed.
+ */
+bool BuildBwtIndexFromFile(const std::string &corpus_path, const bool reverse, const uint32_t sa_sample_rate, BwtIndex &index);
+
+/**
+ * @brief Write the BWT index to a binary file.
+ * @param file_path The path to the index file.
+ * @param index The index to be written.
+ * @return `true` if the index was written.
+ */
+bool WriteBwtIndexToFile(const std::string &file_path, const BwtIndex &index);
+
+/**
+ * @brief Read the BWT index from a binary file.
+ * @param file_path The path to the index file.
+ * @param index The index read from the file.
+ * @return `true` if the index was read.
+ */
+bool ReadBwtIndexFromFile(const std::string &file_path, BwtIndex &index);
+
+/**
+ * @brief Read the header of a BWT index file without loading the index.
+ * @param file_path The path to the index file.
+ * @param layout The header and the location of the packed BWT.
+ * @return `true` if the header was read.
+ */
+bool ReadBwtIndexLayout(const std::string &file_path, BwtIndexLayout &layout);
+
+namespace test {
+
+void Test_BwtIndex(TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace fmi
+}    // namespace fss
+
+#endif    // FM_INDEX_BWT_INDEX_H_
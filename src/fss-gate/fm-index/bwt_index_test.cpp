@@ -0,0 +1,151 @@
+/**
+ * @file bwt_index_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-14
+ * @copyright Copyright (c) 2024
+ * @brief BWT index test implementation.
+ */
+
+#include "bwt_index.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/file_io.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+const std::string kCurrentPath       = utils::GetCurrentDirectory();
+const std::string kTestFMIPath       = kCurrentPath + "/data/test/fmi/";
+const std::string kTestCorpusPath    = kTestFMIPath + "corpus.txt";
+const std::string kTestIndexFilePath = kTestFMIPath + "index.bin";
+
+constexpr uint32_t kTestSaSampleRate = 4;
+
+// Naive construction of the suffix array of `text + '$'` by sorting the suffixes.
+std::vector<uint64_t> NaiveSuffixArray(const std::string &text) {
+    std::vector<uint64_t> sa(text.size() + 1);
+    std::iota(sa.begin(), sa.end(), 0);
+    std::sort(sa.begin(), sa.end(), [&text](const uint64_t a, const uint64_t b) {
+        return text.compare(a, std::string::npos, text, b, std::string::npos) < 0;
+    });
+    return sa;
+}
+
+std::string NaiveBwt(const std::string &text, const std::vector<uint64_t> &sa) {
+    std::string bwt;
+    for (const auto suffix : sa) {
+        bwt += (suffix == 0) ? '$' : text[suffix - 1];
+    }
+    return bwt;
+}
+
+std::string GenerateRandomText(const uint32_t size) {
+    std::string text;
+    for (uint32_t i = 0; i < size; i++) {
+        text += (tools::rng::SecureRng::Rand64() & 1) ? '1' : '0';
+    }
+    return text;
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+namespace test {
+
+bool Test_BuildBwtIndex(const TestInfo &test_info);
+bool Test_BwtIndexFileIo(const TestInfo &test_info);
+
+void Test_BwtIndex(TestInfo &test_info) {
+    std::vector<std::string> modes         = {"BWT index unit tests", "BuildBwtIndex", "BwtIndexFileIo"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        utils::PrintTestResult("Test_BuildBwtIndex", Test_BuildBwtIndex(test_info));
+        utils::PrintTestResult("Test_BwtIndexFileIo", Test_BwtIndexFileIo(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_BuildBwtIndex", Test_BuildBwtIndex(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_BwtIndexFileIo", Test_BwtIndexFileIo(test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_BuildBwtIndex(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        std::string           text = GenerateRandomText(utils::Pow(2, size) - 1);
+        std::vector<uint64_t> sa   = NaiveSuffixArray(text);
+        std::string           bwt  = NaiveBwt(text, sa);
+
+        BwtIndex index;
+        result &= BuildBwtIndex(text, kTestSaSampleRate, index);
+
+        // BWT, occurrence table and sampled suffix array
+        result &= (index.ToString() == bwt);
+        result &= (index.zero_count == static_cast<uint64_t>(std::count(text.begin(), text.end(), '0')));
+        uint64_t ones = 0;
+        for (uint64_t i = 0; i <= index.length; i++) {
+            result &= (index.Rank1(i) == ones);
+            if (i < index.length && bwt[i] == '1') {
+                ones++;
+            }
+        }
+        for (uint64_t i = 0; i < index.length; i += kTestSaSampleRate) {
+            result &= (index.sa_samples[i / kTestSaSampleRate] == sa[i]);
+        }
+        utils::Logger::DebugLog(LOCATION, "Text size: " + std::to_string(text.size()) + ", BWT check: " + std::to_string(index.ToString() == bwt), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_BwtIndexFileIo(const TestInfo &test_info) {
+    bool          result = true;
+    utils::FileIo io(false, "");
+    for (const auto size : test_info.domain_size) {
+        std::string text = GenerateRandomText(utils::Pow(2, size) - 1);
+
+        // Corpus file with a newline every 64 characters (skipped by the ingest)
+        std::string corpus;
+        for (size_t i = 0; i < text.size(); i += 64) {
+            corpus += text.substr(i, 64) + "\n";
+        }
+        io.WriteStringToFile(kTestCorpusPath, corpus);
+
+        BwtIndex index_from_text, index_from_file, index_read;
+        std::reverse(text.begin(), text.end());
+        result &= BuildBwtIndex(text, kTestSaSampleRate, index_from_text);
+        result &= BuildBwtIndexFromFile(kTestCorpusPath, true, kTestSaSampleRate, index_from_file);
+        result &= WriteBwtIndexToFile(kTestIndexFilePath, index_from_file);
+        result &= ReadBwtIndexFromFile(kTestIndexFilePath, index_read);
+
+        result &= (index_from_text == index_from_file) && (index_from_file == index_read);
+
+        // The header gives the location of the packed BWT without loading the index
+        BwtIndexLayout layout;
+        result &= ReadBwtIndexLayout(kTestIndexFilePath, layout);
+        result &= layout.length == index_read.length && layout.dollar_pos == index_read.dollar_pos && layout.zero_count == index_read.zero_count && layout.bits_words == index_read.bwt_bits.size();
+        std::ifstream         file(kTestIndexFilePath, std::ios::binary);
+        std::vector<uint64_t> bits(layout.bits_words);
+        file.seekg(layout.bits_offset);
+        file.read(reinterpret_cast<char *>(bits.data()), bits.size() * sizeof(uint64_t));
+        result &= bits == index_read.bwt_bits;
+        utils::Logger::DebugLog(LOCATION, "Text size: " + std::to_string(text.size()) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace fmi
+}    // namespace fss
@@ -0,0 +1,317 @@
+/**
+ * @file direct_scan.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief DirectScan implementation.
+ */
+
+#include "direct_scan.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+
+#include "../../fss-base/prg/seeded_rng.hpp"
+#include "../../tools/random_number_generator.hpp"
+#include "../../tools/secret_sharing.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+utils::Counter &ScanQueryCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_fmi_scan_queries_total", "Number of queries evaluated by the direct scan.");
+    return counter;
+}
+
+utils::Counter &ScanNodeCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_fmi_scan_nodes_total", "Number of IDPF nodes evaluated by the direct scan.");
+    return counter;
+}
+
+utils::Histogram &ScanQueryLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_fmi_scan_query_seconds", "Latency of a direct scan query including the communication rounds.");
+    return histogram;
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+
+void DirectScanKey::PrintDirectScanKey(const FssFmiParameters &params, const bool debug) const {
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("DirectScan key"), debug);
+    this->idpf_key.PrintIdpfKey(debug);
+    utils::Logger::TraceLog(LOCATION, "Share of r_in: " + utils::VectorToStr(this->shr_in), debug);
+    for (const auto &zt_key : this->zt_keys) {
+        zt_key.PrintZeroTestKey(params.zt_params, debug);
+    }
+    utils::Logger::TraceLog(LOCATION, utils::kDash, debug);
+#endif
+}
+
+void DirectScanKey::FreeDirectScanKey() {
+    this->idpf_key.FreeIdpfKey();
+    for (auto &zt_key : this->zt_keys) {
+        zt_key.FreeZeroTestKey();
+    }
+}
+
+DirectScan::DirectScan(const FssFmiParameters params)
+    : params_(params), idpf_(idpf::IdpfParameters(params.query_size, params.text_bitsize, params.dbg_info)), zt_(params.zt_params) {
+}
+
+std::pair<DirectScanKey, DirectScanKey> DirectScan::GenerateKeys() const {
+    uint32_t                                     t  = this->params_.text_bitsize;
+    uint32_t                                     qs = this->params_.query_size;
+    tools::secret_sharing::AdditiveSecretSharing ss(t);
+#ifdef LOG_LEVEL_TRACE
+    bool debug = this->params_.debug;
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Generate DirectScan keys"), debug);
+#endif
+
+    std::array<DirectScanKey, 2> scan_key;
+
+    // The IDPF is keyed by the least significant bits of the input masks
+    std::vector<uint32_t> r_in(qs), alpha(qs);
+    for (uint32_t i = 0; i < qs; i++) {
+        r_in[i]  = utils::Mod(tools::rng::SecureRng::Rand32(), t);
+        alpha[i] = r_in[i] & 1;
+    }
+    std::pair<idpf::IdpfKey, idpf::IdpfKey> idpf_keys = this->idpf_.GenerateKeys(alpha, 1);
+    tools::secret_sharing::shares_t         r_in_sh   = ss.Share(r_in);
+    scan_key[0].idpf_key                              = std::move(idpf_keys.first);
+    scan_key[1].idpf_key                              = std::move(idpf_keys.second);
+    scan_key[0].shr_in                                = std::move(r_in_sh.first);
+    scan_key[1].shr_in                                = std::move(r_in_sh.second);
+
+    for (uint32_t j = 0; j < 2; j++) {
+        scan_key[j].zt_keys.reserve(qs);
+    }
+    for (uint32_t i = 0; i < qs; i++) {
+        std::pair<zt::ZeroTestKey, zt::ZeroTestKey> zt_key = this->zt_.GenerateKeys();
+        scan_key[0].zt_keys.push_back(std::move(zt_key.first));
+        scan_key[1].zt_keys.push_back(std::move(zt_key.second));
+    }
+
+#ifdef LOG_LEVEL_TRACE
+    utils::AddNewLine(debug);
+    scan_key[0].PrintDirectScanKey(this->params_, debug);
+    utils::AddNewLine(debug);
+    scan_key[1].PrintDirectScanKey(this->params_, debug);
+    utils::AddNewLine(debug);
+#endif
+
+    return std::make_pair(std::move(scan_key[0]), std::move(scan_key[1]));
+}
+
+std::pair<DirectScanKey, DirectScanKey> DirectScan::GenerateKeys(const Block &seed, const uint64_t key_index) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateKeys();
+}
+
+void DirectScan::SetSentence(const std::string &sentence) {
+    uint32_t qs = this->params_.query_size;
+    uint32_t n  = sentence.size();
+    this->text_.assign(sentence.begin(), sentence.end());
+
+    // Sort the windows of length query size (shorter at the end of the text)
+    std::string_view text(this->text_);
+    this->order_.resize(n);
+    std::iota(this->order_.begin(), this->order_.end(), 0);
+    std::sort(this->order_.begin(), this->order_.end(), [&text, qs](const uint32_t a, const uint32_t b) {
+        return text.substr(a, qs) < text.substr(b, qs);
+    });
+
+    this->lcp_.assign(n, 0);
+    for (uint32_t i = 1; i < n; i++) {
+        std::string_view prev = text.substr(this->order_[i - 1], qs);
+        std::string_view curr = text.substr(this->order_[i], qs);
+        uint32_t         l    = 0;
+        while (l < prev.size() && l < curr.size() && prev[l] == curr[l]) {
+            l++;
+        }
+        this->lcp_[i] = l;
+    }
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "Nodes of the windows: " + std::to_string(this->CountNodes(qs)), this->params_.debug);
+#endif
+}
+
+uint64_t DirectScan::CountNodes(const uint32_t length) const {
+    uint64_t node_num = 0;
+    uint32_t n        = this->text_.size();
+    for (uint32_t i = 0; i < n; i++) {
+        node_num += std::min(length, n - this->order_[i]) - std::min(length, this->lcp_[i]);
+    }
+    return node_num;
+}
+
+void DirectScan::Evaluate(tools::secret_sharing::Party &party, const DirectScanKey &scan_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &output) const {
+    uint32_t                                     t = this->params_.text_bitsize;
+    uint32_t                                     m = q.size();
+    tools::secret_sharing::AdditiveSecretSharing ss(t);
+    utils::HistogramTimer                        latency(ScanQueryLatency());
+    ScanQueryCounter().Increment();
+
+    std::vector<uint32_t> masked, masked_0(m), masked_1(m), opened(m);
+    this->MaskPattern(scan_key, q, masked);
+    if (party.GetId() == 0) {
+        masked_0 = std::move(masked);
+    } else {
+        masked_1 = std::move(masked);
+    }
+    ss.Reconst(party, masked_0, masked_1, opened);    // * ROUND: 1
+
+    std::vector<uint32_t> counts;
+    this->Scan(scan_key, opened, counts, nullptr);
+
+    // Zero test of the occurrence counts
+    std::vector<uint32_t> xsh_0(m), xsh_1(m), xr(m);
+    for (uint32_t i = 0; i < m; i++) {
+        if (party.GetId() == 0) {
+            xsh_0[i] = utils::Mod(counts[i] + scan_key.zt_keys[i].shr_in, t);
+        } else {
+            xsh_1[i] = utils::Mod(counts[i] + scan_key.zt_keys[i].shr_in, t);
+        }
+    }
+    ss.Reconst(party, xsh_0, xsh_1, xr);    // * ROUND: 2
+    output.resize(m);
+    for (uint32_t i = 0; i < m; i++) {
+        output[i] = this->zt_.EvaluateAt(scan_key.zt_keys[i], xr[i]);
+    }
+}
+
+void DirectScan::EvaluateMatches(tools::secret_sharing::Party &party, const DirectScanKey &scan_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &matches) const {
+    uint32_t                                     t = this->params_.text_bitsize;
+    uint32_t                                     m = q.size();
+    tools::secret_sharing::AdditiveSecretSharing ss(t);
+    ScanQueryCounter().Increment();
+
+    std::vector<uint32_t> masked, masked_0(m), masked_1(m), opened(m);
+    this->MaskPattern(scan_key, q, masked);
+    if (party.GetId() == 0) {
+        masked_0 = std::move(masked);
+    } else {
+        masked_1 = std::move(masked);
+    }
+    ss.Reconst(party, masked_0, masked_1, opened);    // * ROUND: 1
+
+    std::vector<uint32_t> counts;
+    this->Scan(scan_key, opened, counts, &matches);
+}
+
+void DirectScan::MaskPattern(const DirectScanKey &scan_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &masked) const {
+    uint32_t t = this->params_.text_bitsize;
+    if (q.size() > this->params_.query_size) {
+        utils::Logger::FatalLog(LOCATION, "The pattern is longer than the query size (" + std::to_string(q.size()) + " > " + std::to_string(this->params_.query_size) + ")");
+        exit(EXIT_FAILURE);
+    }
+    masked.resize(q.size());
+    for (uint32_t i = 0; i < q.size(); i++) {
+        masked[i] = utils::Mod(q[i] + scan_key.shr_in[i], t);
+    }
+}
+
+uint64_t DirectScan::Scan(const DirectScanKey &scan_key, const std::vector<uint32_t> &opened, std::vector<uint32_t> &counts, std::vector<uint32_t> *matches) const {
+    uint32_t t = this->params_.text_bitsize;
+    uint32_t m = opened.size();
+    uint32_t n = this->text_.size();
+
+    counts.assign(m, 0);
+    if (matches != nullptr) {
+        matches->assign(n, 0);
+    }
+    if (m == 0) {
+        return 0;
+    }
+
+    // nodes[d] is the node of depth d on the current window, and outputs[d] is the output of nodes[d + 1]
+    std::vector<idpf::IdpfNode> nodes(m + 1);
+    std::vector<uint32_t>       outputs(m, 0);
+    std::vector<bool>           masked_bits(m);
+    for (uint32_t d = 0; d < m; d++) {
+        masked_bits[d] = (utils::Mod(opened[d], t) & 1) != 0;
+    }
+    nodes[0] = this->idpf_.GetRoot(scan_key.idpf_key);
+
+    uint64_t node_num = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t p      = this->order_[i];
+        uint32_t length = std::min(m, n - p);
+        for (uint32_t d = std::min(m, this->lcp_[i]); d < length; d++) {
+            bool bit   = (this->text_[p + d] == '1') ^ masked_bits[d];
+            outputs[d] = this->idpf_.EvaluateNext(scan_key.idpf_key, d, nodes[d], bit, nodes[d + 1]);
+            node_num++;
+        }
+        for (uint32_t d = 0; d < length; d++) {
+            counts[d] += outputs[d];
+        }
+        if (matches != nullptr && length == m) {
+            (*matches)[p] = outputs[m - 1];
+        }
+    }
+    for (uint32_t d = 0; d < m; d++) {
+        counts[d] = utils::Mod(counts[d], t);
+    }
+    ScanNodeCounter().Increment(node_num);
+    return node_num;
+}
+
+DirectScanSession::DirectScanSession(const DirectScan &scan, const uint32_t party_id, const DirectScanKey &scan_key, const std::vector<uint32_t> &q)
+    : scan_(scan), scan_key_(scan_key), phase_(Phase::kPattern), output_(q.size()) {
+    ScanQueryCounter().Increment();
+    this->scan_.MaskPattern(scan_key, q, this->opening_);
+    if (q.empty()) {
+        this->phase_ = Phase::kFinished;
+    }
+}
+
+bool DirectScanSession::IsFinished() const {
+    return this->phase_ == Phase::kFinished;
+}
+
+uint32_t DirectScanSession::GetOpeningSize() const {
+    return this->opening_.size();
+}
+
+void DirectScanSession::WriteOpening(uint32_t *shares) const {
+    std::copy(this->opening_.begin(), this->opening_.end(), shares);
+}
+
+void DirectScanSession::Resume(const uint32_t *opened) {
+    uint32_t t = this->scan_.params_.text_bitsize;
+    uint32_t m = this->output_.size();
+
+    switch (this->phase_) {
+        case Phase::kPattern: {
+            std::vector<uint32_t> pattern(opened, opened + m), counts;
+            this->scan_.Scan(this->scan_key_, pattern, counts, nullptr);
+            // Zero test of the occurrence counts
+            for (uint32_t i = 0; i < m; i++) {
+                this->opening_[i] = utils::Mod(counts[i] + this->scan_key_.zt_keys[i].shr_in, t);
+            }
+            this->phase_ = Phase::kZeroTest;
+            break;
+        }
+        case Phase::kZeroTest:
+            for (uint32_t i = 0; i < m; i++) {
+                this->output_[i] = this->scan_.zt_.EvaluateAt(this->scan_key_.zt_keys[i], utils::Mod(opened[i], t));
+            }
+            this->opening_.clear();
+            this->phase_ = Phase::kFinished;
+            break;
+        case Phase::kFinished:
+            break;
+    }
+}
+
+const std::vector<uint32_t> &DirectScanSession::GetOutput() const {
+    return this->output_;
+}
+
+}    // namespace fmi
+}    // namespace fss
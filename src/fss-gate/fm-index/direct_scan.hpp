@@ -0,0 +1,217 @@
+/**
+ * @file direct_scan.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief DirectScan class (pattern matching by a DPF scan of the text).
+ */
+
+#ifndef FM_INDEX_DIRECT_SCAN_H_
+#define FM_INDEX_DIRECT_SCAN_H_
+
+#include "../../fss-base/idpf/incremental_dpf.hpp"
+#include "fss_fmi.hpp"
+
+namespace fss {
+namespace fmi {
+
+/**
+ * @struct DirectScanKey
+ * @brief A key for the direct scan (one IDPF key over the masked pattern bits and one ZeroTest key per prefix).
+ */
+struct DirectScanKey {
+    idpf::IdpfKey                idpf_key; /**< The IDPF key (alpha: the least significant bits of the input masks, beta: 1). */
+    std::vector<uint32_t>        shr_in;   /**< Shares of the input masks of the pattern (one per character). */
+    std::vector<zt::ZeroTestKey> zt_keys;  /**< The ZeroTest keys (one per prefix length). */
+
+    /**
+     * @brief Default constructor for DirectScanKey.
+     */
+    DirectScanKey(){};
+
+    /**
+     * @brief Copy constructor (deleted).
+     */
+    DirectScanKey(const DirectScanKey &) = delete;
+
+    /**
+     * @brief Copy assignment operator (deleted).
+     */
+    DirectScanKey &operator=(const DirectScanKey &) = delete;
+
+    /**
+     * @brief Move constructor (default).
+     */
+    DirectScanKey(DirectScanKey &&) noexcept = default;
+
+    /**
+     * @brief Move assignment operator (default).
+     */
+    DirectScanKey &operator=(DirectScanKey &&) noexcept = default;
+
+    bool operator==(const DirectScanKey &rhs) const {
+        return this->idpf_key == rhs.idpf_key && this->shr_in == rhs.shr_in && this->zt_keys == rhs.zt_keys;
+    }
+
+    bool operator!=(const DirectScanKey &rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Print the details of the DirectScanKey.
+     * @param params The parameters for FssFmi.
+     * @param debug Debug utils::Mode flag.
+     */
+    void PrintDirectScanKey(const FssFmiParameters &params, const bool debug) const;
+
+    /**
+     * @brief Free the resources associated with the DirectScanKey.
+     */
+    void FreeDirectScanKey();
+};
+
+/**
+ * @class DirectScan
+ * @brief Pattern matching over the public text by evaluating an IDPF at every text position.
+ *
+ * The masked pattern is opened in a single round. Since the characters are bits, the least significant bit
+ * of q_k + r_k is q_k xor lsb(r_k), so the walk of the IDPF along (T[p + k] xor opened bit) stays on the path of
+ * the key exactly while T[p..p + k] matches the pattern, for every prefix length at once.
+ * Text positions are walked in the sorted order of their windows and the nodes of common prefixes are shared,
+ * so the number of evaluated nodes is that of the trie of the windows (at most text size * pattern length).
+ * The outputs are the same as FssFmi::Evaluate (the ZeroTest of the occurrence count of every prefix)
+ * with 2 rounds instead of 2 * (query size - 1) + 1.
+ */
+class DirectScan {
+public:
+    /**
+     * @brief Constructor for DirectScan.
+     * @param params The parameters for FssFmi (the pattern length is at most the query size).
+     */
+    DirectScan(const FssFmiParameters params);
+
+    /**
+     * @brief Generate a pair of DirectScanKey.
+     * @return A pair of DirectScanKey.
+     */
+    std::pair<DirectScanKey, DirectScanKey> GenerateKeys() const;
+
+    /**
+     * @brief Generate a pair of DirectScanKey from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<DirectScanKey, DirectScanKey> GenerateKeys(const Block &seed, const uint64_t key_index) const;
+
+    /**
+     * @brief Set the public text (not reversed) and sort its windows.
+     * @param sentence The text of '0' and '1'.
+     */
+    void SetSentence(const std::string &sentence);
+
+    /**
+     * @brief Retrieves the number of IDPF nodes evaluated for a pattern of the given length.
+     * @param length The length of the pattern.
+     * @return The number of nodes.
+     */
+    uint64_t CountNodes(const uint32_t length) const;
+
+    /**
+     * @brief Evaluate the ZeroTest of the occurrence count of every prefix of the pattern.
+     * @param party The party object.
+     * @param scan_key The DirectScanKey of this party.
+     * @param q The share of the pattern (at most the query size).
+     * @param output The shares of the ZeroTest results (size: q.size()).
+     */
+    void Evaluate(tools::secret_sharing::Party &party, const DirectScanKey &scan_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &output) const;
+
+    /**
+     * @brief Evaluate the match indicator of the whole pattern at every text position (one round).
+     * @param party The party object.
+     * @param scan_key The DirectScanKey of this party.
+     * @param q The share of the pattern (at most the query size).
+     * @param matches The shares of [T[p..p + q.size()) == q] (size: text length).
+     */
+    void EvaluateMatches(tools::secret_sharing::Party &party, const DirectScanKey &scan_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &matches) const;
+
+private:
+    friend class DirectScanSession;
+    friend class QueryPlanner;
+
+    const FssFmiParameters      params_; /**< The parameters for FssFmi. */
+    const idpf::IncrementalDpf  idpf_;   /**< The IDPF for the match indicators. */
+    const zt::ZeroTest          zt_;     /**< The ZeroTest object. */
+    utils::HugeString           text_;   /**< The public text. */
+    utils::HugeVector<uint32_t> order_;  /**< The text positions in the sorted order of their windows. */
+    utils::HugeVector<uint32_t> lcp_;    /**< The common prefix length of each window with the previous one (at most the query size). */
+
+    /**
+     * @brief Compute the masked pattern of this party (q + r) to be opened.
+     */
+    void MaskPattern(const DirectScanKey &scan_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &masked) const;
+
+    /**
+     * @brief Walk the windows of the text with the opened pattern.
+     * @param scan_key The DirectScanKey of this party.
+     * @param opened The opened pattern (q + r).
+     * @param counts The shares of the occurrence count of every prefix (size: opened.size()).
+     * @param matches The shares of the match indicator of the whole pattern per position (nullptr to skip).
+     * @return The number of evaluated nodes.
+     */
+    uint64_t Scan(const DirectScanKey &scan_key, const std::vector<uint32_t> &opened, std::vector<uint32_t> &counts, std::vector<uint32_t> *matches) const;
+};
+
+/**
+ * @brief Resumable evaluation of DirectScan::Evaluate.
+ *
+ * The first round opens the masked pattern and the second round opens the inputs of the ZeroTest,
+ * so a batch of sessions finishes in 2 rounds through tools::secret_sharing::SessionMultiplexer.
+ * The key and the DirectScan object must outlive the session.
+ */
+class DirectScanSession : public tools::secret_sharing::ProtocolSession {
+public:
+    /**
+     * @brief Construct a new DirectScanSession.
+     * @param scan The DirectScan object (text).
+     * @param party_id The ID of this party.
+     * @param scan_key The DirectScanKey of this party.
+     * @param q The share of the pattern.
+     */
+    DirectScanSession(const DirectScan &scan, const uint32_t party_id, const DirectScanKey &scan_key, const std::vector<uint32_t> &q);
+
+    bool     IsFinished() const override;
+    uint32_t GetOpeningSize() const override;
+    void     WriteOpening(uint32_t *shares) const override;
+    void     Resume(const uint32_t *opened) override;
+
+    /**
+     * @brief Get the output of DirectScan::Evaluate (available after the session is finished).
+     * @return The shares of the ZeroTest results.
+     */
+    const std::vector<uint32_t> &GetOutput() const;
+
+private:
+    enum class Phase {
+        kPattern,  /**< Opening the masked pattern. */
+        kZeroTest, /**< Opening the inputs of the ZeroTest. */
+        kFinished, /**< The output is available. */
+    };
+
+    const DirectScan      &scan_;     /**< The DirectScan object. */
+    const DirectScanKey   &scan_key_; /**< The DirectScanKey of this party. */
+    Phase                  phase_;    /**< The current phase. */
+    std::vector<uint32_t>  opening_;  /**< The shares opened in the current round. */
+    std::vector<uint32_t>  output_;   /**< The shares of the ZeroTest results. */
+};
+
+namespace test {
+
+void Test_DirectScan(tools::secret_sharing::Party &party, TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace fmi
+}    // namespace fss
+
+#endif    // FM_INDEX_DIRECT_SCAN_H_
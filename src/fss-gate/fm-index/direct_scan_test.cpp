@@ -0,0 +1,276 @@
+/**
+ * @file direct_scan_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief DirectScan test implementation.
+ */
+
+#include "direct_scan.hpp"
+
+#include <memory>
+#include <thread>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/file_io.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+#include "../internal/fsskey_io.hpp"
+
+namespace {
+
+const std::string kCurrentPath      = utils::GetCurrentDirectory();
+const std::string kTestScanPath     = kCurrentPath + "/data/test/scan/";
+const std::string kScanKeyPath_P0   = kTestScanPath + "key_0_";
+const std::string kScanKeyPath_P1   = kTestScanPath + "key_1_";
+const std::string kScanDBPath       = kTestScanPath + "db_";
+const std::string kScanQueryPath    = kTestScanPath + "query_";
+const std::string kScanQueryPath_P0 = kTestScanPath + "query_0_";
+const std::string kScanQueryPath_P1 = kTestScanPath + "query_1_";
+
+constexpr uint32_t kQuerySize  = 4;
+constexpr uint32_t kQueryNum   = 2;    // A random query and a query taken from the text
+constexpr uint32_t kSessionNum = 8;
+
+void GenerateRandomNumbers(std::vector<uint32_t> &vec, const uint32_t bitsize) {
+    // Generate random vector
+    for (size_t i = 0; i < vec.size(); i++) {
+        vec[i] = utils::Mod(tools::rng::SecureRng::Rand64(), bitsize);
+    }
+}
+
+// The occurrence count of every prefix of q in the text
+std::vector<uint32_t> CountPrefixes(const std::string &text, const std::vector<uint32_t> &q) {
+    std::vector<uint32_t> counts(q.size(), 0);
+    for (size_t p = 0; p < text.size(); p++) {
+        for (size_t d = 0; d < q.size() && p + d < text.size() && text[p + d] - '0' == static_cast<int>(q[d]); d++) {
+            counts[d]++;
+        }
+    }
+    return counts;
+}
+
+std::string ReadText(utils::FileIo &io, const uint32_t size) {
+    std::vector<uint32_t> pub_db;
+    io.ReadVectorFromFile(kScanDBPath + std::to_string(size), pub_db);
+    return utils::VectorToStr(pub_db, "");
+}
+
+std::vector<uint32_t> ReadQuery(utils::FileIo &io, const uint32_t size, const uint32_t qs, const uint32_t i) {
+    std::vector<uint32_t> queries;
+    io.ReadVectorFromFile(kScanQueryPath + std::to_string(size), queries);
+    return std::vector<uint32_t>(queries.begin() + i * qs, queries.begin() + (i + 1) * qs);
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+namespace test {
+
+bool Test_DirectScanOffline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_DirectScanOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_DirectScanSessionOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+
+void Test_DirectScan(tools::secret_sharing::Party &party, TestInfo &test_info) {
+    std::vector<std::string> modes         = {"DirectScan unit tests", "DirectScanOffline", "DirectScanOnline", "DirectScanSessionOnline"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        if (party.GetId() == 0) {
+            utils::PrintTestResult("Test_DirectScanOffline", Test_DirectScanOffline(party, test_info));
+        } else {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        utils::PrintTestResult("Test_DirectScanOnline", Test_DirectScanOnline(party, test_info));
+        utils::PrintTestResult("Test_DirectScanSessionOnline", Test_DirectScanSessionOnline(party, test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_DirectScanOffline", Test_DirectScanOffline(party, test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_DirectScanOnline", Test_DirectScanOnline(party, test_info));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_DirectScanSessionOnline", Test_DirectScanSessionOnline(party, test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_DirectScanOffline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters                             params(size, kQuerySize, test_info.dbg_info);
+        uint32_t                                     ts = params.text_size;
+        uint32_t                                     qs = params.query_size;
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        tools::secret_sharing::ShareHandler          sh;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        DirectScan                                   scan(params);
+
+        std::vector<uint32_t> pub_db(ts - 1), queries(kQueryNum * qs);
+        GenerateRandomNumbers(pub_db, 1);
+        GenerateRandomNumbers(queries, 1);
+        uint32_t pos = tools::rng::SecureRng::Rand32() % (ts - qs);
+        std::copy(pub_db.begin() + pos, pub_db.begin() + pos + qs, queries.begin() + qs);
+        io.WriteVectorToFile(kScanDBPath + std::to_string(size), pub_db);
+        io.WriteVectorToFile(kScanQueryPath + std::to_string(size), queries);
+
+        std::pair<std::vector<uint32_t>, std::vector<uint32_t>> q_sh = ss.Share(queries);
+        sh.ExportShare(kScanQueryPath_P0 + std::to_string(size), kScanQueryPath_P1 + std::to_string(size), q_sh);
+
+        // Generate key of DirectScan
+        std::pair<DirectScanKey, DirectScanKey> scan_keys = scan.GenerateKeys();
+        utils::Logger::DebugLog(LOCATION, "Write DirectScan key to file.", test_info.dbg_info.debug);
+        key_io.WriteDirectScanKeyToFile(kScanKeyPath_P0 + std::to_string(size), scan_keys.first);
+        key_io.WriteDirectScanKeyToFile(kScanKeyPath_P1 + std::to_string(size), scan_keys.second);
+        DirectScanKey scan_key_0, scan_key_1;
+        key_io.ReadDirectScanKeyFromFile(kScanKeyPath_P0 + std::to_string(size), params, scan_key_0);
+        key_io.ReadDirectScanKeyFromFile(kScanKeyPath_P1 + std::to_string(size), params, scan_key_1);
+        result &= (scan_keys.first == scan_key_0) && (scan_keys.second == scan_key_1);
+
+        // The nodes of the windows are bounded by the text size * the query size
+        scan.SetSentence(utils::VectorToStr(pub_db, ""));
+        uint64_t node_num = scan.CountNodes(qs);
+        result &= node_num >= qs && node_num <= static_cast<uint64_t>(ts - 1) * qs && scan.CountNodes(1) == 2;
+        utils::Logger::DebugLog(LOCATION, "Nodes: " + std::to_string(node_num) + " (text size * query size: " + std::to_string((ts - 1) * qs) + ")", test_info.dbg_info.debug);
+
+        scan_keys.first.FreeDirectScanKey();
+        scan_keys.second.FreeDirectScanKey();
+        scan_key_0.FreeDirectScanKey();
+        scan_key_1.FreeDirectScanKey();
+    }
+    return result;
+}
+
+bool Test_DirectScanOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters                             params(size, kQuerySize, test_info.dbg_info);
+        uint32_t                                     qs = params.query_size;
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        tools::secret_sharing::ShareHandler          sh;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        DirectScan                                   scan(params);
+
+        std::string text = ReadText(io, size);
+        scan.SetSentence(text);
+
+        // Read DirectScan key and input data
+        DirectScanKey         scan_key;
+        std::vector<uint32_t> q_sh(kQueryNum * qs);
+        if (party.GetId() == 0) {
+            key_io.ReadDirectScanKeyFromFile(kScanKeyPath_P0 + std::to_string(size), params, scan_key);
+            sh.LoadShare(kScanQueryPath_P0 + std::to_string(size), q_sh);
+        } else {
+            key_io.ReadDirectScanKeyFromFile(kScanKeyPath_P1 + std::to_string(size), params, scan_key);
+            sh.LoadShare(kScanQueryPath_P1 + std::to_string(size), q_sh);
+        }
+
+        // Start communication
+        party.StartCommunication();
+
+        for (uint32_t i = 0; i < kQueryNum; i++) {
+            std::vector<uint32_t> q = ReadQuery(io, size, qs, i);
+            std::vector<uint32_t> q_i(q_sh.begin() + i * qs, q_sh.begin() + (i + 1) * qs);
+
+            // The ZeroTest of every prefix (a shorter pattern gives the first outputs)
+            for (const uint32_t m : {qs, qs / 2}) {
+                std::vector<uint32_t> q_m(q_i.begin(), q_i.begin() + m), out_0(m), out_1(m), res(m);
+                if (party.GetId() == 0) {
+                    scan.Evaluate(party, scan_key, q_m, out_0);
+                } else {
+                    scan.Evaluate(party, scan_key, q_m, out_1);
+                }
+                ss.Reconst(party, out_0, out_1, res);
+
+                std::vector<uint32_t> expected = CountPrefixes(text, q);
+                for (uint32_t d = 0; d < m; d++) {
+                    result &= res[d] == (expected[d] == 0 ? 1U : 0U);
+                }
+                utils::Logger::DebugLog(LOCATION, "Eq: " + utils::VectorToStr(res), test_info.dbg_info.debug);
+            }
+
+            // The match indicators of the whole pattern
+            std::vector<uint32_t> matches_0(text.size()), matches_1(text.size()), res(text.size());
+            if (party.GetId() == 0) {
+                scan.EvaluateMatches(party, scan_key, q_i, matches_0);
+            } else {
+                scan.EvaluateMatches(party, scan_key, q_i, matches_1);
+            }
+            ss.Reconst(party, matches_0, matches_1, res);
+            std::string q_str = utils::VectorToStr(q, "");
+            for (uint32_t p = 0; p < text.size(); p++) {
+                result &= res[p] == (text.compare(p, qs, q_str) == 0 ? 1U : 0U);
+            }
+        }
+        scan_key.FreeDirectScanKey();
+    }
+    return result;
+}
+
+bool Test_DirectScanSessionOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters                             params(size, kQuerySize, test_info.dbg_info);
+        uint32_t                                     qs = params.query_size;
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        tools::secret_sharing::ShareHandler          sh;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        DirectScan                                   scan(params);
+
+        std::string text = ReadText(io, size);
+        scan.SetSentence(text);
+
+        DirectScanKey         scan_key;
+        std::vector<uint32_t> q_sh(kQueryNum * qs);
+        if (party.GetId() == 0) {
+            key_io.ReadDirectScanKeyFromFile(kScanKeyPath_P0 + std::to_string(size), params, scan_key);
+            sh.LoadShare(kScanQueryPath_P0 + std::to_string(size), q_sh);
+        } else {
+            key_io.ReadDirectScanKeyFromFile(kScanKeyPath_P1 + std::to_string(size), params, scan_key);
+            sh.LoadShare(kScanQueryPath_P1 + std::to_string(size), q_sh);
+        }
+
+        // Start communication
+        party.StartCommunication();
+
+        // All sessions finish in 2 rounds
+        std::vector<std::unique_ptr<DirectScanSession>> sessions;
+        tools::secret_sharing::SessionMultiplexer       mux(party);
+        for (uint32_t i = 0; i < kSessionNum; i++) {
+            uint32_t              j = i % kQueryNum;
+            std::vector<uint32_t> q_j(q_sh.begin() + j * qs, q_sh.begin() + (j + 1) * qs);
+            sessions.push_back(std::make_unique<DirectScanSession>(scan, party.GetId(), scan_key, q_j));
+            mux.AddSession(*sessions.back());
+        }
+        result &= mux.Run() == 2;
+
+        for (uint32_t i = 0; i < kSessionNum; i++) {
+            std::vector<uint32_t> out_0(qs), out_1(qs), res(qs);
+            if (party.GetId() == 0) {
+                out_0 = sessions[i]->GetOutput();
+            } else {
+                out_1 = sessions[i]->GetOutput();
+            }
+            ss.Reconst(party, out_0, out_1, res);
+
+            std::vector<uint32_t> expected = CountPrefixes(text, ReadQuery(io, size, qs, i % kQueryNum));
+            for (uint32_t d = 0; d < qs; d++) {
+                result &= res[d] == (expected[d] == 0 ? 1U : 0U);
+            }
+        }
+        scan_key.FreeDirectScanKey();
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace fmi
+}    // namespace fss
@@ -10,12 +10,38 @@
 
 #include <algorithm>
 
+#include "../../fss-base/prg/seeded_rng.hpp"
 #include "../../tools/random_number_generator.hpp"
 #include "../../tools/secret_sharing.hpp"
 #include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
 #include "../../utils/timer.hpp"
 #include "../../utils/utils.hpp"
 
+namespace {
+
+utils::Counter &FmiQueryCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_fmi_queries_total", "Number of FssFMI queries (Evaluate and EvaluateCount).");
+    return counter;
+}
+
+utils::Histogram &FmiQueryLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_fmi_query_seconds", "Latency of a FssFMI query including the communication rounds.");
+    return histogram;
+}
+
+utils::Gauge &FmiCorrelatedTripleGauge() {
+    static utils::Gauge &gauge = utils::MetricsRegistry::GetInstance().GetGauge("fss_fmi_correlated_triples", "Number of correlated triples loaded for the backward search (one per step for f and g).");
+    return gauge;
+}
+
+utils::Gauge &FmiBwtBytesGauge() {
+    static utils::Gauge &gauge = utils::MetricsRegistry::GetInstance().GetGauge("fss_fmi_bwt_bytes", "Resident bytes of the BWT scanned by the rank evaluations.");
+    return gauge;
+}
+
+}    // namespace
+
 namespace fss {
 namespace fmi {
 
@@ -56,23 +82,144 @@ void FssFmiKey::FreeFssFmiKey() {
     }
 }
 
+FssFmiCountKey::FssFmiCountKey(const uint32_t rank_key_num)
+    : rank_key_num(rank_key_num) {
+}
+
+void FssFmiCountKey::PrintFssFmiCountKey(const FssFmiParameters &params, const bool debug) const {
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("FssFMI count key"), debug);
+    for (uint32_t i = 0; i < rank_key_num; i++) {
+        this->rank_keys_f[i].PrintFssRankKey(params.rank_params, debug);
+        this->rank_keys_g[i].PrintFssRankKey(params.rank_params, debug);
+    }
+    utils::Logger::TraceLog(LOCATION, utils::kDash, debug);
+#endif
+}
+
+void FssFmiCountKey::FreeFssFmiCountKey() {
+    for (uint32_t i = 0; i < rank_key_num; i++) {
+        this->rank_keys_f[i].FreeFssRankKey();
+        this->rank_keys_g[i].FreeFssRankKey();
+    }
+}
+
 FssFmi::FssFmi(const FssFmiParameters params)
     : params_(params), rank_(rank::FssRank(params.rank_params)), zt_(params.zt_params) {
 }
 
-void FssFmi::SetBeaverTriple(const tools::secret_sharing::bts_t &btf, const tools::secret_sharing::bts_t &btg) {
-    this->btf_ = std::move(btf);
-    this->btg_ = std::move(btg);
+void FssFmi::SetCorrelatedTriple(const tools::secret_sharing::cts_t &ct) {
+    this->ct_ = ct;
+    FmiCorrelatedTripleGauge().Set(this->ct_.size());
 }
 
 void FssFmi::SetSentence(const std::string &sentence) {
-    this->pub_db_ = sentence;
+    this->disk_db_.reset();
+    this->packed_db_.reset();
+    this->own_db_ = std::make_shared<utils::HugeString>(sentence.begin(), sentence.end());
+    this->pub_db_ = std::string_view(this->own_db_->data(), this->own_db_->size());
     this->cf1_    = std::count(sentence.begin(), sentence.end(), '0');
+    FmiBwtBytesGauge().Set(this->pub_db_.size());
 #ifdef LOG_LEVEL_TRACE
     utils::Logger::TraceLog(LOCATION, "cf1: " + std::to_string(this->cf1_), this->params_.debug);
 #endif
 }
 
+void FssFmi::SetIndexView(const IndexView &view) {
+    this->disk_db_.reset();
+    this->packed_db_.reset();
+    this->own_db_.reset();
+    this->pub_db_ = view.bwt;
+    this->cf1_    = view.zero_count;
+    FmiBwtBytesGauge().Set(this->pub_db_.size());
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "cf1: " + std::to_string(this->cf1_), this->params_.debug);
+#endif
+}
+
+void FssFmi::SetCompressedSentence(const std::string_view sentence) {
+    this->disk_db_.reset();
+    this->own_db_.reset();
+    this->pub_db_    = std::string_view();
+    this->packed_db_ = std::make_shared<rank::CompressedBwt>();
+    this->packed_db_->Build(sentence);
+    this->cf1_ = this->packed_db_->GetZeroCount();
+    FmiBwtBytesGauge().Set(this->packed_db_->GetByteSize());
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "cf1: " + std::to_string(this->cf1_) + ", compressed: " + std::to_string(this->packed_db_->GetByteSize()) + " bytes", this->params_.debug);
+#endif
+}
+
+void FssFmi::SetCompressedIndex(const BwtIndex &index) {
+    this->disk_db_.reset();
+    this->own_db_.reset();
+    this->pub_db_    = std::string_view();
+    this->packed_db_ = std::make_shared<rank::CompressedBwt>();
+    this->packed_db_->BuildFromBits(index.bwt_bits, index.length, index.dollar_pos);
+    this->cf1_ = this->packed_db_->GetZeroCount();
+    FmiBwtBytesGauge().Set(this->packed_db_->GetByteSize());
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "cf1: " + std::to_string(this->cf1_) + ", compressed: " + std::to_string(this->packed_db_->GetByteSize()) + " bytes", this->params_.debug);
+#endif
+}
+
+bool FssFmi::SetIndexFile(const std::string &file_path) {
+    BwtIndexLayout layout;
+    auto           disk_db = std::make_shared<rank::DiskBwt>();
+    if (!ReadBwtIndexLayout(file_path, layout) || !disk_db->Open(file_path, layout.bits_offset, layout.length, layout.dollar_pos)) {
+        return false;
+    }
+    this->own_db_.reset();
+    this->packed_db_.reset();
+    this->pub_db_  = std::string_view();
+    this->disk_db_ = std::move(disk_db);
+    this->cf1_     = layout.zero_count;
+    FmiBwtBytesGauge().Set(2 * rank::kDiskBwtChunkWords * sizeof(uint64_t));    // Only the read buffers are resident
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "cf1: " + std::to_string(this->cf1_) + ", direct I/O: " + std::to_string(this->disk_db_->IsDirectIo()), this->params_.debug);
+#endif
+    return true;
+}
+
+std::array<uint32_t, 2> FssFmi::EvaluateRank(const rank::FssRankKey &rank_key, const uint32_t pos) const {
+    if (this->packed_db_) {
+        return this->rank_.Evaluate(rank_key, *this->packed_db_, pos);
+    }
+    if (this->disk_db_) {
+        return this->rank_.Evaluate(rank_key, *this->disk_db_, pos);
+    }
+    return this->rank_.Evaluate(rank_key, this->pub_db_, pos);
+}
+
+void FssFmi::EvaluateRankPair(const rank::FssRankKey &rank_key_f, const rank::FssRankKey &rank_key_g, const uint32_t fr, const uint32_t gr, std::array<uint32_t, 2> &rankf, std::array<uint32_t, 2> &rankg) const {
+    if (this->disk_db_) {
+        // The out-of-core rank streams the outputs in chunks and does not hold them
+        rankf = this->rank_.Evaluate(rank_key_f, *this->disk_db_, fr);
+        rankg = this->rank_.Evaluate(rank_key_g, *this->disk_db_, gr);
+        return;
+    }
+    std::vector<const rank::FssRankKey *> keys = {&rank_key_f, &rank_key_g};
+    std::vector<uint32_t>                 pos  = {fr, gr};
+    std::vector<std::array<uint32_t, 2>>  ranks;
+    if (this->packed_db_) {
+        this->rank_.EvaluateBatch(keys, pos, *this->packed_db_, ranks);
+    } else {
+        this->rank_.EvaluateBatch(keys, pos, this->pub_db_, ranks);
+    }
+    rankf = ranks[0];
+    rankg = ranks[1];
+}
+
+std::unique_ptr<rank::FssRankBatch> FssFmi::CreateRankBatch() const {
+    if (this->disk_db_) {
+        return std::make_unique<rank::FssRankBatch>(this->rank_, *this->disk_db_);
+    }
+    if (this->packed_db_) {
+        return std::make_unique<rank::FssRankBatch>(this->rank_, *this->packed_db_);
+    }
+    return std::make_unique<rank::FssRankBatch>(this->rank_, this->pub_db_);
+}
+
 std::pair<FssFmiKey, FssFmiKey> FssFmi::GenerateKeys(const uint32_t rank_key_num, const uint32_t zt_key_num) const {
 #ifdef LOG_LEVEL_TRACE
     bool debug = this->params_.debug;
@@ -123,12 +270,97 @@ std::pair<FssFmiKey, FssFmiKey> FssFmi::GenerateKeys(const uint32_t rank_key_num
     return std::make_pair(std::move(fmi_key[0]), std::move(fmi_key[1]));
 }
 
+std::pair<FssFmiKey, FssFmiKey> FssFmi::GenerateKeys(const Block &seed, const uint64_t key_index, const uint32_t rank_key_num, const uint32_t zt_key_num) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateKeys(rank_key_num, zt_key_num);
+}
+
+std::pair<FssFmiCountKey, FssFmiCountKey> FssFmi::GenerateCountKeys(const uint32_t rank_key_num) const {
+#ifdef LOG_LEVEL_TRACE
+    bool debug = this->params_.debug;
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Generate FssFMI count keys"), debug);
+#endif
+
+    std::array<FssFmiCountKey, 2> count_key{FssFmiCountKey(rank_key_num), FssFmiCountKey(rank_key_num)};
+    for (uint32_t j = 0; j < 2; j++) {
+        count_key[j].rank_keys_f.reserve(rank_key_num);
+        count_key[j].rank_keys_g.reserve(rank_key_num);
+    }
+    for (uint32_t i = 0; i < rank_key_num; i++) {
+        std::pair<rank::FssRankKey, rank::FssRankKey> rank_key_f = this->rank_.GenerateKeys();
+        std::pair<rank::FssRankKey, rank::FssRankKey> rank_key_g = this->rank_.GenerateKeys();
+        count_key[0].rank_keys_f.push_back(std::move(rank_key_f.first));
+        count_key[1].rank_keys_f.push_back(std::move(rank_key_f.second));
+        count_key[0].rank_keys_g.push_back(std::move(rank_key_g.first));
+        count_key[1].rank_keys_g.push_back(std::move(rank_key_g.second));
+    }
+
+#ifdef LOG_LEVEL_TRACE
+    utils::AddNewLine(debug);
+    count_key[0].PrintFssFmiCountKey(this->params_, debug);
+    utils::AddNewLine(debug);
+    count_key[1].PrintFssFmiCountKey(this->params_, debug);
+    utils::AddNewLine(debug);
+#endif
+
+    return std::make_pair(std::move(count_key[0]), std::move(count_key[1]));
+}
+
+std::pair<FssFmiCountKey, FssFmiCountKey> FssFmi::GenerateCountKeys(const Block &seed, const uint64_t key_index, const uint32_t rank_key_num) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateCountKeys(rank_key_num);
+}
+
 void FssFmi::Evaluate(tools::secret_sharing::Party &party, const FssFmiKey &fmi_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &output) const {
+    uint32_t                                     t  = this->params_.text_bitsize;
+    uint32_t                                     qs = this->params_.query_size;
+    tools::secret_sharing::AdditiveSecretSharing ss(t);
+    utils::HistogramTimer                        latency(FmiQueryLatency());
+    FmiQueryCounter().Increment();
+
+    std::vector<uint32_t> intersh(qs);
+    this->BackwardSearch(party, fmi_key.rank_keys_f, fmi_key.rank_keys_g, q, intersh);
+
+    // Equality check of f, g
+    std::vector<uint32_t> xsh_0(qs), xsh_1(qs), xr(qs);
+    for (uint32_t i = 0; i < qs; i++) {
+        if (party.GetId() == 0) {
+            xsh_0[i] = utils::Mod(intersh[i] + fmi_key.zt_keys[i].shr_in, t);
+        } else {
+            xsh_1[i] = utils::Mod(intersh[i] + fmi_key.zt_keys[i].shr_in, t);
+        }
+    }
+    ss.Reconst(party, xsh_0, xsh_1, xr);    // * ROUND: 3
+    for (uint32_t i = 0; i < qs; i++) {
+        output[i] = this->zt_.EvaluateAt(fmi_key.zt_keys[i], xr[i]);
+    }
+}
+
+uint32_t FssFmi::EvaluateCount(tools::secret_sharing::Party &party, const FssFmiCountKey &count_key, const std::vector<uint32_t> &q) const {
+    uint32_t qs = this->params_.query_size;
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Evaluate FssFmi (count only)"), this->params_.debug);
+#endif
+
+    utils::HistogramTimer latency(FmiQueryLatency());
+    FmiQueryCounter().Increment();
+
+    // The share of g - f for the whole query is the share of the occurrence count.
+    std::vector<uint32_t> intersh(qs);
+    this->BackwardSearch(party, count_key.rank_keys_f, count_key.rank_keys_g, q, intersh);
+    return intersh[qs - 1];
+}
+
+void FssFmi::BackwardSearch(tools::secret_sharing::Party &party, const std::vector<rank::FssRankKey> &rank_keys_f, const std::vector<rank::FssRankKey> &rank_keys_g, const std::vector<uint32_t> &q, std::vector<uint32_t> &intersh) const {
     uint32_t                                     t  = this->params_.text_bitsize;
     uint32_t                                     ts = this->params_.text_size;
     uint32_t                                     qs = this->params_.query_size;
     tools::secret_sharing::AdditiveSecretSharing ss(t);
     utils::ExecutionTimer                        timer;
+    if (this->ct_.size() + 1 < qs) {
+        utils::Logger::FatalLog(LOCATION, "The number of correlated triples is less than the number of steps");
+        exit(EXIT_FAILURE);
+    }
 
 #ifdef LOG_LEVEL_TRACE
     const bool debug = this->params_.debug;
@@ -137,18 +369,17 @@ void FssFmi::Evaluate(tools::secret_sharing::Party &party, const FssFmiKey &fmi_
     utils::Logger::TraceLog(LOCATION, "(text size, query size): (" + std::to_string(ts) + ", " + std::to_string(qs) + ")", debug);
 #endif
 
-    uint32_t              fsh_0{0}, fsh_1{0}, gsh_0{0}, gsh_1{0};
-    std::vector<uint32_t> intersh_0(qs), intersh_1(qs);
+    uint32_t fsh_0{0}, fsh_1{0}, gsh_0{0}, gsh_1{0};
 
     // Calculate f_1, g_1
     if (party.GetId() == 0) {
-        fsh_0        = utils::Mod(this->cf1_ * q[0], t);
-        gsh_0        = utils::Mod((ts - 1 - this->cf1_) * q[0], t);
-        intersh_0[0] = utils::Mod(gsh_0 - fsh_0, t);
+        fsh_0      = utils::Mod(this->cf1_ * q[0], t);
+        gsh_0      = utils::Mod((ts - 1 - this->cf1_) * q[0], t);
+        intersh[0] = utils::Mod(gsh_0 - fsh_0, t);
     } else {
-        fsh_1        = utils::Mod(this->cf1_ * q[0] + 1, t);
-        gsh_1        = utils::Mod(this->cf1_ + ((ts - 1 - this->cf1_) * q[0]) + 1, t);
-        intersh_1[0] = utils::Mod(gsh_1 - fsh_1, t);
+        fsh_1      = utils::Mod(this->cf1_ * q[0] + 1, t);
+        gsh_1      = utils::Mod(this->cf1_ + ((ts - 1 - this->cf1_) * q[0]) + 1, t);
+        intersh[0] = utils::Mod(gsh_1 - fsh_1, t);
     }
 
 #ifdef LOG_LEVEL_TRACE
@@ -166,22 +397,20 @@ void FssFmi::Evaluate(tools::secret_sharing::Party &party, const FssFmiKey &fmi_
         // timer.Start();
         std::array<uint32_t, 2> fgr_0{0, 0}, fgr_1{0, 0}, fgr{0, 0};
         if (party.GetId() == 0) {
-            fgr_0[0] = utils::Mod(fsh_0 - fmi_key.rank_keys_f[i - 1].shr_in, t);
-            fgr_0[1] = utils::Mod(gsh_0 - fmi_key.rank_keys_g[i - 1].shr_in, t);
+            fgr_0[0] = utils::Mod(fsh_0 - rank_keys_f[i - 1].shr_in, t);
+            fgr_0[1] = utils::Mod(gsh_0 - rank_keys_g[i - 1].shr_in, t);
         } else {
-            fgr_1[0] = utils::Mod(fsh_1 - fmi_key.rank_keys_f[i - 1].shr_in, t);
-            fgr_1[1] = utils::Mod(gsh_1 - fmi_key.rank_keys_g[i - 1].shr_in, t);
+            fgr_1[0] = utils::Mod(fsh_1 - rank_keys_f[i - 1].shr_in, t);
+            fgr_1[1] = utils::Mod(gsh_1 - rank_keys_g[i - 1].shr_in, t);
         }
         ss.Reconst(party, fgr_0, fgr_1, fgr);    // * ROUND: 1
 
         // Calculate rank f, g
         std::array<uint32_t, 2> rankf_0{0, 0}, rankf_1{0, 0}, rankg_0{0, 0}, rankg_1{0, 0};
         if (party.GetId() == 0) {
-            rankf_0 = this->rank_.Evaluate(fmi_key.rank_keys_f[i - 1], this->pub_db_, fgr[0]);
-            rankg_0 = this->rank_.Evaluate(fmi_key.rank_keys_g[i - 1], this->pub_db_, fgr[1]);
+            this->EvaluateRankPair(rank_keys_f[i - 1], rank_keys_g[i - 1], fgr[0], fgr[1], rankf_0, rankg_0);
         } else {
-            rankf_1 = this->rank_.Evaluate(fmi_key.rank_keys_f[i - 1], this->pub_db_, fgr[0]);
-            rankg_1 = this->rank_.Evaluate(fmi_key.rank_keys_g[i - 1], this->pub_db_, fgr[1]);
+            this->EvaluateRankPair(rank_keys_f[i - 1], rank_keys_g[i - 1], fgr[0], fgr[1], rankf_1, rankg_1);
         }
 #ifdef LOG_LEVEL_TRACE
         // Debug: Reconst rank
@@ -194,27 +423,27 @@ void FssFmi::Evaluate(tools::secret_sharing::Party &party, const FssFmiKey &fmi_
         utils::Logger::TraceLog(LOCATION, "rankg0_" + std::to_string(i + 1) + ": " + std::to_string(rankg[0]) + ", rankg1_" + std::to_string(i + 1) + ": " + std::to_string(rankg[1]), debug);
 #endif
 
-        // rank_0 if q[i] = 0 else rank_1
+        // rank_0 if q[i] = 0 else rank_1 (q[i] - a is opened once for f and g)
         std::array<uint32_t, 2> mfg_0 = {0, 0}, mfg_1 = {0, 0};
         if (party.GetId() == 0) {
-            mfg_0 = ss.Mult2(party, this->btf_[i - 1], this->btg_[i - 1], q[i], utils::Mod(rankf_0[1] - rankf_0[0], t), q[i], utils::Mod(rankg_0[1] - rankg_0[0], t));
+            mfg_0 = ss.Mult2(party, this->ct_[i - 1], q[i], utils::Mod(rankf_0[1] - rankf_0[0], t), utils::Mod(rankg_0[1] - rankg_0[0], t));
             fsh_0 = utils::Mod(rankf_0[0] + mfg_0[0], t);
             gsh_0 = utils::Mod(rankg_0[0] + mfg_0[1], t);
         } else {
-            mfg_1 = ss.Mult2(party, this->btf_[i - 1], this->btg_[i - 1], q[i], utils::Mod(rankf_1[1] - rankf_1[0], t), q[i], utils::Mod(rankg_1[1] - rankg_1[0], t));
+            mfg_1 = ss.Mult2(party, this->ct_[i - 1], q[i], utils::Mod(rankf_1[1] - rankf_1[0], t), utils::Mod(rankg_1[1] - rankg_1[0], t));
             fsh_1 = utils::Mod(rankf_1[0] + mfg_1[0], t);
             gsh_1 = utils::Mod(rankg_1[0] + mfg_1[1], t);
         }
 
         // Add CF_1
         if (party.GetId() == 0) {
-            fsh_0        = utils::Mod(fsh_0 + (this->cf1_ * q[i]), t);
-            gsh_0        = utils::Mod(gsh_0 + (this->cf1_ * q[i]), t);
-            intersh_0[i] = utils::Mod(gsh_0 - fsh_0, t);
+            fsh_0      = utils::Mod(fsh_0 + (this->cf1_ * q[i]), t);
+            gsh_0      = utils::Mod(gsh_0 + (this->cf1_ * q[i]), t);
+            intersh[i] = utils::Mod(gsh_0 - fsh_0, t);
         } else {
-            fsh_1        = utils::Mod(fsh_1 + (this->cf1_ * q[i]) + 1, t);
-            gsh_1        = utils::Mod(gsh_1 + (this->cf1_ * q[i]) + 1, t);
-            intersh_1[i] = utils::Mod(gsh_1 - fsh_1, t);
+            fsh_1      = utils::Mod(fsh_1 + (this->cf1_ * q[i]) + 1, t);
+            gsh_1      = utils::Mod(gsh_1 + (this->cf1_ * q[i]) + 1, t);
+            intersh[i] = utils::Mod(gsh_1 - fsh_1, t);
         }
 #ifdef LOG_LEVEL_TRACE
         // Debug: Reconst f, g
@@ -228,21 +457,147 @@ void FssFmi::Evaluate(tools::secret_sharing::Party &party, const FssFmiKey &fmi_
 #endif
         // timer.Print(LOCATION, "Evaluate FssFmi" + std::to_string(i + 1));
     }
+}
 
-    // Equality check of f, g
-    std::vector<uint32_t> xsh_0(qs), xsh_1(qs), xr(qs);
-    for (uint32_t i = 0; i < qs; i++) {
-        if (party.GetId() == 0) {
-            xsh_0[i] = utils::Mod(intersh_0[i] + fmi_key.zt_keys[i].shr_in, t);
-        } else {
-            xsh_1[i] = utils::Mod(intersh_1[i] + fmi_key.zt_keys[i].shr_in, t);
+FssFmiSession::FssFmiSession(const FssFmi &fss_fmi, const uint32_t party_id, const FssFmiKey &fmi_key, const tools::secret_sharing::cts_t &ct, const std::vector<uint32_t> &q, rank::FssRankBatch *rank_batch)
+    : fss_fmi_(fss_fmi), party_id_(party_id), fmi_key_(fmi_key), ct_(ct), q_(q), rank_batch_(rank_batch), phase_(Phase::kRankInput), step_(1), fsh_(0), gsh_(0),
+      rankf_{0, 0}, rankg_{0, 0}, intersh_(fss_fmi.params_.query_size), output_(fss_fmi.params_.query_size) {
+    uint32_t t   = this->fss_fmi_.params_.text_bitsize;
+    uint32_t ts  = this->fss_fmi_.params_.text_size;
+    uint32_t cf1 = this->fss_fmi_.cf1_;
+    if (this->ct_.size() + 1 < this->fss_fmi_.params_.query_size) {
+        utils::Logger::FatalLog(LOCATION, "The number of correlated triples is less than the number of steps");
+        exit(EXIT_FAILURE);
+    }
+    FmiQueryCounter().Increment();
+
+    // Calculate f_1, g_1
+    if (this->party_id_ == 0) {
+        this->fsh_ = utils::Mod(cf1 * q[0], t);
+        this->gsh_ = utils::Mod((ts - 1 - cf1) * q[0], t);
+    } else {
+        this->fsh_ = utils::Mod(cf1 * q[0] + 1, t);
+        this->gsh_ = utils::Mod(cf1 + ((ts - 1 - cf1) * q[0]) + 1, t);
+    }
+    this->intersh_[0] = utils::Mod(this->gsh_ - this->fsh_, t);
+    if (this->fss_fmi_.params_.query_size == 1) {
+        this->phase_ = Phase::kZeroTest;
+    }
+}
+
+bool FssFmiSession::IsFinished() const {
+    return this->phase_ == Phase::kFinished;
+}
+
+uint32_t FssFmiSession::GetOpeningSize() const {
+    switch (this->phase_) {
+        case Phase::kRankInput:
+            return 2;
+        case Phase::kSelect:
+            return 3;
+        case Phase::kZeroTest:
+            return this->intersh_.size();
+        default:
+            return 0;
+    }
+}
+
+void FssFmiSession::WriteOpening(uint32_t *shares) const {
+    // Computed when written (not in Resume), so the ranks added to a rank batch are flushed before the selection opens them
+    uint32_t t = this->fss_fmi_.params_.text_bitsize;
+    uint32_t i = this->step_;
+    switch (this->phase_) {
+        case Phase::kRankInput:
+            // Reconst f - r_in, g - r_in
+            shares[0] = utils::Mod(this->fsh_ - this->fmi_key_.rank_keys_f[i - 1].shr_in, t);
+            shares[1] = utils::Mod(this->gsh_ - this->fmi_key_.rank_keys_g[i - 1].shr_in, t);
+            break;
+        case Phase::kSelect: {
+            // rank_0 if q[i] = 0 else rank_1 (same openings as AdditiveSecretSharing::Mult2 with a correlated triple)
+            const tools::secret_sharing::CorrelatedTriplet &ct = this->ct_[i - 1];
+            shares[0]                                          = utils::Mod(this->q_[i] - ct.a, t);
+            shares[1]                                          = utils::Mod(utils::Mod(this->rankf_[1] - this->rankf_[0], t) - ct.b[0], t);
+            shares[2]                                          = utils::Mod(utils::Mod(this->rankg_[1] - this->rankg_[0], t) - ct.b[1], t);
+            break;
         }
+        case Phase::kZeroTest:
+            // Equality check of f, g
+            for (uint32_t j = 0; j < this->intersh_.size(); j++) {
+                shares[j] = utils::Mod(this->intersh_[j] + this->fmi_key_.zt_keys[j].shr_in, t);
+            }
+            break;
+        case Phase::kFinished:
+            break;
     }
-    ss.Reconst(party, xsh_0, xsh_1, xr);    // * ROUND: 3
-    for (uint32_t i = 0; i < qs; i++) {
-        output[i] = this->zt_.EvaluateAt(fmi_key.zt_keys[i], xr[i]);
+}
+
+void FssFmiSession::Resume(const uint32_t *opened) {
+    uint32_t t   = this->fss_fmi_.params_.text_bitsize;
+    uint32_t qs  = this->fss_fmi_.params_.query_size;
+    uint32_t cf1 = this->fss_fmi_.cf1_;
+    uint32_t i   = this->step_;
+
+    switch (this->phase_) {
+        case Phase::kRankInput: {
+            // Calculate rank f, g
+            uint32_t fr = utils::Mod(opened[0], t);
+            uint32_t gr = utils::Mod(opened[1], t);
+            if (this->rank_batch_ != nullptr) {
+                // The ranks are written when the multiplexer flushes the batch at the end of this round
+                this->rank_batch_->Add(this->fmi_key_.rank_keys_f[i - 1], fr, this->rankf_);
+                this->rank_batch_->Add(this->fmi_key_.rank_keys_g[i - 1], gr, this->rankg_);
+            } else {
+                this->fss_fmi_.EvaluateRankPair(this->fmi_key_.rank_keys_f[i - 1], this->fmi_key_.rank_keys_g[i - 1], fr, gr, this->rankf_, this->rankg_);
+            }
+            this->phase_ = Phase::kSelect;
+            break;
+        }
+        case Phase::kSelect: {
+            const tools::secret_sharing::CorrelatedTriplet &ct = this->ct_[i - 1];
+            std::array<uint32_t, 3>                         de;
+            for (uint32_t j = 0; j < 3; j++) {
+                de[j] = utils::Mod(opened[j], t);
+            }
+            uint32_t mf = utils::Mod((de[1] * ct.a) + (de[0] * ct.b[0]) + ct.c[0], t);
+            uint32_t mg = utils::Mod((de[2] * ct.a) + (de[0] * ct.b[1]) + ct.c[1], t);
+            if (this->party_id_ == 0) {
+                mf = utils::Mod(mf + (de[0] * de[1]), t);
+                mg = utils::Mod(mg + (de[0] * de[2]), t);
+            }
+            this->fsh_ = utils::Mod(this->rankf_[0] + mf, t);
+            this->gsh_ = utils::Mod(this->rankg_[0] + mg, t);
+
+            // Add CF_1
+            if (this->party_id_ == 0) {
+                this->fsh_ = utils::Mod(this->fsh_ + (cf1 * this->q_[i]), t);
+                this->gsh_ = utils::Mod(this->gsh_ + (cf1 * this->q_[i]), t);
+            } else {
+                this->fsh_ = utils::Mod(this->fsh_ + (cf1 * this->q_[i]) + 1, t);
+                this->gsh_ = utils::Mod(this->gsh_ + (cf1 * this->q_[i]) + 1, t);
+            }
+            this->intersh_[i] = utils::Mod(this->gsh_ - this->fsh_, t);
+            this->step_++;
+            this->phase_ = (this->step_ < qs) ? Phase::kRankInput : Phase::kZeroTest;
+            break;
+        }
+        case Phase::kZeroTest:
+            for (uint32_t j = 0; j < qs; j++) {
+                this->output_[j] = this->fss_fmi_.zt_.EvaluateAt(this->fmi_key_.zt_keys[j], utils::Mod(opened[j], t));
+            }
+            this->phase_ = Phase::kFinished;
+            break;
+        case Phase::kFinished:
+            break;
     }
 }
 
+tools::secret_sharing::RoundBatch *FssFmiSession::GetRoundBatch() const {
+    return this->rank_batch_;
+}
+
+const std::vector<uint32_t> &FssFmiSession::GetOutput() const {
+    return this->output_;
+}
+
 }    // namespace fmi
 }    // namespace fss
@@ -9,8 +9,13 @@
 #ifndef FM_INDEX_FSS_FMI_H_
 #define FM_INDEX_FSS_FMI_H_
 
+#include <memory>
+#include <string_view>
+
+#include "../../tools/protocol_session.hpp"
 #include "../rank/fss_rank.hpp"
 #include "../zt/zero_test_dpf.hpp"
+#include "index_registry.hpp"
 
 namespace fss {
 namespace fmi {
@@ -102,6 +107,68 @@ struct FssFmiKey {
     void FreeFssFmiKey();
 };
 
+/**
+ * @struct FssFmiCountKey
+ * @brief A key for the count-only FssFMI evaluation (no ZeroTest keys).
+ */
+struct FssFmiCountKey {
+    uint32_t                      rank_key_num; /**< The number of rank keys. */
+    std::vector<rank::FssRankKey> rank_keys_f;  /**< The FssRank key associated with the FssFmiCountKey. */
+    std::vector<rank::FssRankKey> rank_keys_g;  /**< The FssRank key associated with the FssFmiCountKey. */
+
+    /**
+     * @brief Default constructor for FssFmiCountKey.
+     */
+    FssFmiCountKey()
+        : rank_key_num(0){};
+
+    /**
+     * @brief Constructor for FssFmiCountKey with the specified number of rank keys.
+     * @param rank_key_num The number of rank keys.
+     */
+    FssFmiCountKey(const uint32_t rank_key_num);
+
+    /**
+     * @brief Copy constructor (deleted).
+     */
+    FssFmiCountKey(const FssFmiCountKey &) = delete;
+
+    /**
+     * @brief Copy assignment operator (deleted).
+     */
+    FssFmiCountKey &operator=(const FssFmiCountKey &) = delete;
+
+    /**
+     * @brief Move constructor (default).
+     */
+    FssFmiCountKey(FssFmiCountKey &&) noexcept = default;
+
+    /**
+     * @brief Move assignment operator (default).
+     */
+    FssFmiCountKey &operator=(FssFmiCountKey &&) noexcept = default;
+
+    bool operator==(const FssFmiCountKey &rhs) const {
+        return this->rank_keys_f == rhs.rank_keys_f && this->rank_keys_g == rhs.rank_keys_g;
+    }
+
+    bool operator!=(const FssFmiCountKey &rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Print the details of the FssFMI count key.
+     * @param params The parameters for FssFmi.
+     * @param debug Debug utils::Mode flag.
+     */
+    void PrintFssFmiCountKey(const FssFmiParameters &params, const bool debug) const;
+
+    /**
+     * @brief Free the resources associated with the FssFMI count key.
+     */
+    void FreeFssFmiCountKey();
+};
+
 class FssFmi {
 public:
     /**
@@ -112,19 +179,181 @@ public:
 
     std::pair<FssFmiKey, FssFmiKey> GenerateKeys(const uint32_t rank_key_num, const uint32_t zt_key_num) const;
 
-    void SetBeaverTriple(const tools::secret_sharing::bts_t &btf, const tools::secret_sharing::bts_t &btg);
+    /**
+     * @brief Generate keys for FssFMI from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @param rank_key_num The number of rank keys (query size - 1).
+     * @param zt_key_num The number of zero test keys.
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<FssFmiKey, FssFmiKey> GenerateKeys(const Block &seed, const uint64_t key_index, const uint32_t rank_key_num, const uint32_t zt_key_num) const;
+
+    /**
+     * @brief Set the shares of the correlated triples of the selections.
+     * @param ct The shares (query size - 1, fan-out 2: q[i] is multiplied by the rank differences of f and g).
+     */
+    void SetCorrelatedTriple(const tools::secret_sharing::cts_t &ct);
 
     void SetSentence(const std::string &sentence);
 
+    /**
+     * @brief Use a published index without copying it.
+     * @param view The view of the index (must stay attached while this object is used).
+     */
+    void SetIndexView(const IndexView &view);
+
+    /**
+     * @brief Keep only the compressed form of the sentence (see rank::CompressedBwt).
+     * @param sentence The sentence (BWT).
+     */
+    void SetCompressedSentence(const std::string_view sentence);
+
+    /**
+     * @brief Keep only the compressed form of the BWT of the index (the BWT is not expanded to a string).
+     * @param index The index.
+     */
+    void SetCompressedIndex(const BwtIndex &index);
+
+    /**
+     * @brief Stream the BWT from an index file for every rank instead of loading it (see rank::DiskBwt).
+     * @param file_path The path to the index file (must stay in place while this object is used).
+     * @return `true` if the index file was opened.
+     */
+    bool SetIndexFile(const std::string &file_path);
+
     void Evaluate(tools::secret_sharing::Party &party, const FssFmiKey &fmi_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &output) const;
 
+    /**
+     * @brief Generate keys for the count-only evaluation.
+     * @param rank_key_num The number of rank keys (query size - 1).
+     * @return A pair of FssFmiCountKey.
+     */
+    std::pair<FssFmiCountKey, FssFmiCountKey> GenerateCountKeys(const uint32_t rank_key_num) const;
+
+    /**
+     * @brief Generate keys for the count-only evaluation from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @param rank_key_num The number of rank keys (query size - 1).
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<FssFmiCountKey, FssFmiCountKey> GenerateCountKeys(const Block &seed, const uint64_t key_index, const uint32_t rank_key_num) const;
+
+    /**
+     * @brief Evaluate the backward search and return the share of the occurrence count (g - f) of the whole query.
+     * @param party The party object.
+     * @param count_key The FssFmiCountKey of this party.
+     * @param q The share of the query.
+     * @return The share of the number of occurrences of the query.
+     */
+    uint32_t EvaluateCount(tools::secret_sharing::Party &party, const FssFmiCountKey &count_key, const std::vector<uint32_t> &q) const;
+
+    /**
+     * @brief Create a rank batch on the sentence (compressed, on disk or as a string) for the sessions of a round (see FssFmiSession).
+     * @return The rank batch (must not outlive this object).
+     */
+    std::unique_ptr<rank::FssRankBatch> CreateRankBatch() const;
+
+private:
+    friend class FssFmiSession;
+    friend class QueryPlanner;
+
+    const FssFmiParameters               params_;    /**< The parameters for FssFmi. */
+    const rank::FssRank                  rank_;      /**< The FssRank object. */
+    const zt::ZeroTest                   zt_;        /**< The ZeroTest object. */
+    std::shared_ptr<utils::HugeString>   own_db_;    /**< The sentence owned by this object (set by SetSentence, on huge pages if large). */
+    std::string_view                     pub_db_;    /**< The sentence for the FssFmi object. */
+    std::shared_ptr<rank::CompressedBwt> packed_db_; /**< The compressed sentence (used instead of pub_db_ if set). */
+    std::shared_ptr<rank::DiskBwt>       disk_db_;   /**< The sentence on disk (used instead of pub_db_ if set). */
+    uint32_t                             cf1_;       /**< The value of CF1. */
+    tools::secret_sharing::cts_t         ct_;        /**< The correlated triples for f and g functions. */
+
+    /**
+     * @brief Run the backward search and store the share of g_i - f_i for every prefix of the query.
+     * @param party The party object.
+     * @param rank_keys_f The FssRank keys for f.
+     * @param rank_keys_g The FssRank keys for g.
+     * @param q The share of the query.
+     * @param intersh The share of g_i - f_i (size: query size).
+     */
+    void BackwardSearch(tools::secret_sharing::Party &party, const std::vector<rank::FssRankKey> &rank_keys_f, const std::vector<rank::FssRankKey> &rank_keys_g, const std::vector<uint32_t> &q, std::vector<uint32_t> &intersh) const;
+
+    /**
+     * @brief Evaluate FssRank on the sentence (compressed, on disk or as a string).
+     * @param rank_key The FssRank key.
+     * @param pos The opened position (minus r_in).
+     * @return The shares of the ranks of '0' and '1'.
+     */
+    std::array<uint32_t, 2> EvaluateRank(const rank::FssRankKey &rank_key, const uint32_t pos) const;
+
+    /**
+     * @brief Evaluate the FssRank of f and g of a step with one pass over the sentence (see FssRank::EvaluateBatch).
+     * @param rank_key_f The FssRank key of f.
+     * @param rank_key_g The FssRank key of g.
+     * @param fr The opened position of f (minus r_in).
+     * @param gr The opened position of g (minus r_in).
+     * @param rankf The shares of the ranks of f.
+     * @param rankg The shares of the ranks of g.
+     */
+    void EvaluateRankPair(const rank::FssRankKey &rank_key_f, const rank::FssRankKey &rank_key_g, const uint32_t fr, const uint32_t gr, std::array<uint32_t, 2> &rankf, std::array<uint32_t, 2> &rankg) const;
+};
+
+/**
+ * @brief Resumable evaluation of FssFmi::Evaluate.
+ *
+ * Each step of the backward search opens (f - r_in, g - r_in) for FssRank, then the correlated triple differences of the selection;
+ * the final round opens the inputs of the ZeroTest. A query takes 2 * (query size - 1) + 1 rounds,
+ * and many sessions can share each round through tools::secret_sharing::SessionMultiplexer.
+ * The key and the FssFmi object must outlive the session. The correlated triples are copied into the session,
+ * so concurrent sessions never open differences against the same triple.
+ * With a rank batch (see FssFmi::CreateRankBatch), the ranks of all the sessions of a round are evaluated in one pass over the sentence.
+ */
+class FssFmiSession : public tools::secret_sharing::ProtocolSession {
+public:
+    /**
+     * @brief Construct a new FssFmiSession and compute f_1, g_1.
+     * @param fss_fmi The FssFmi object (database).
+     * @param party_id The ID of this party.
+     * @param fmi_key The FssFmiKey of this party.
+     * @param ct The correlated triple shares of this session (query size - 1, fan-out 2).
+     * @param q The share of the query.
+     * @param rank_batch The rank batch shared by the sessions of a round (must outlive the session; nullptr evaluates the ranks in Resume).
+     */
+    FssFmiSession(const FssFmi &fss_fmi, const uint32_t party_id, const FssFmiKey &fmi_key, const tools::secret_sharing::cts_t &ct, const std::vector<uint32_t> &q, rank::FssRankBatch *rank_batch = nullptr);
+
+    bool                               IsFinished() const override;
+    uint32_t                           GetOpeningSize() const override;
+    void                               WriteOpening(uint32_t *shares) const override;
+    void                               Resume(const uint32_t *opened) override;
+    tools::secret_sharing::RoundBatch *GetRoundBatch() const override;
+
+    /**
+     * @brief Get the output of FssFmi::Evaluate (available after the session is finished).
+     * @return The shares of the ZeroTest results.
+     */
+    const std::vector<uint32_t> &GetOutput() const;
+
 private:
-    const FssFmiParameters       params_;    /**< The parameters for FssFmi. */
-    const rank::FssRank          rank_;      /**< The FssRank object. */
-    const zt::ZeroTest           zt_;        /**< The ZeroTest object. */
-    std::string                  pub_db_;    /**< The sentence for the FssFmi object. */
-    uint32_t                     cf1_;       /**< The value of CF1. */
-    tools::secret_sharing::bts_t btf_, btg_; /**< The Beaver triple for f and g functions. */
+    enum class Phase {
+        kRankInput, /**< Opening (f - r_in, g - r_in) of the current step. */
+        kSelect,    /**< Opening the correlated triple differences of the selection. */
+        kZeroTest,  /**< Opening the inputs of the ZeroTest. */
+        kFinished,  /**< The output is available. */
+    };
+
+    const FssFmi                       &fss_fmi_;       /**< The FssFmi object. */
+    const uint32_t                      party_id_;      /**< The ID of this party. */
+    const FssFmiKey                    &fmi_key_;       /**< The FssFmiKey of this party. */
+    const tools::secret_sharing::cts_t  ct_;            /**< The correlated triple shares of this session. */
+    std::vector<uint32_t>               q_;             /**< The share of the query. */
+    rank::FssRankBatch *const           rank_batch_;    /**< The rank batch of the round (nullptr if the ranks are evaluated in Resume). */
+    Phase                               phase_;         /**< The current phase. */
+    uint32_t                            step_;          /**< The current step of the backward search (1 to query size - 1). */
+    uint32_t                            fsh_, gsh_;     /**< The shares of f_i and g_i. */
+    std::array<uint32_t, 2>             rankf_, rankg_; /**< The shares of rank_0 and rank_1 for f and g. */
+    std::vector<uint32_t>               intersh_;       /**< The shares of g_i - f_i. */
+    std::vector<uint32_t>               output_;        /**< The shares of the ZeroTest results. */
 };
 
 namespace test {
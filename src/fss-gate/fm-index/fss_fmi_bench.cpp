@@ -8,52 +8,37 @@
 
 #include "fss_fmi.hpp"
 
-#include <sdsl/csa_wt.hpp>
-#include <sdsl/suffix_arrays.hpp>
+#include <algorithm>
 
 #include "../../tools/random_number_generator.hpp"
 #include "../../utils/file_io.hpp"
 #include "../../utils/logger.hpp"
+#include "../../utils/memory.hpp"
 #include "../../utils/timer.hpp"
 #include "../../utils/utils.hpp"
 #include "../internal/fsskey_io.hpp"
+#include "bwt_index.hpp"
 
 namespace {
 
 const std::string kCurrentPath     = utils::GetCurrentDirectory();
 const std::string kBenchFMIPath    = kCurrentPath + "/data/bench/fmi/";
-const std::string kFMIBTPath_F     = kBenchFMIPath + "btf";
-const std::string kFMIBTPath_F_P0  = kBenchFMIPath + "btf_p0";
-const std::string kFMIBTPath_F_P1  = kBenchFMIPath + "btf_p1";
-const std::string kFMIBTPath_G     = kBenchFMIPath + "btg";
-const std::string kFMIBTPath_G_P0  = kBenchFMIPath + "btg_p0";
-const std::string kFMIBTPath_G_P1  = kBenchFMIPath + "btg_p1";
+const std::string kFMICTPath       = kBenchFMIPath + "ct";
+const std::string kFMICTPath_P0    = kBenchFMIPath + "ct_p0";
+const std::string kFMICTPath_P1    = kBenchFMIPath + "ct_p1";
 const std::string kFMIKeyPath_P0   = kBenchFMIPath + "key_p0";
 const std::string kFMIKeyPath_P1   = kBenchFMIPath + "key_p1";
 const std::string kFMIDBPath       = kBenchFMIPath + "db";
-const std::string kFMIBWTPath      = kBenchFMIPath + "bwt";
+const std::string kFMIIndexPath    = kBenchFMIPath + "index";
 const std::string kFMIQueryPath    = kBenchFMIPath + "query";
 const std::string kFMIQueryPath_P0 = kBenchFMIPath + "query_p0";
 const std::string kFMIQueryPath_P1 = kBenchFMIPath + "query_p1";
+const std::string kFMITransPath_P0 = kBenchFMIPath + "transcript_p0";
+const std::string kFMITransPath_P1 = kBenchFMIPath + "transcript_p1";
 
-using bts_t = tools::secret_sharing::bts_t;
-
-std::string ConstructBwtFromVector(const std::string &input) {
-    size_t input_size = input.size();
-    // Construct the suffix array using the SDSL library
-    sdsl::csa_wt<> csa;
-    sdsl::construct_im(csa, input, 1);
-    // Convert the BWT to a string
-    std::string bwt_vector = "";
-    for (size_t i = 0; i < input_size + 1; i++) {
-        if (csa.bwt[i]) {
-            bwt_vector += csa.bwt[i];
-        } else {
-            bwt_vector += '$';
-        }
-    }
-    return bwt_vector;
-}
+using cts_t = tools::secret_sharing::cts_t;
+
+constexpr uint32_t kMemorySummaryIntervalMs = 60000;    // Interval of the periodic memory summary
 
 void GenerateRandomNumbers(std::vector<uint32_t> &vec, const uint32_t bitsize) {
     // Generate random vector
@@ -71,11 +56,14 @@ namespace bench {
 void Bench_FssFmi(tools::secret_sharing::Party &party, const BenchInfo &bench_info) {
     // Define utilities
     utils::ExecutionTimer               timer_all, timer_1, timer_2;
+    utils::MemoryMonitor                mem_1, mem_2;
+    utils::TlbMonitor                   tlb_2;
     utils::FileIo                       io;
     tools::secret_sharing::ShareHandler sh;
     internal::FssKeyIo                  key_io;
+    utils::MemoryMonitor::SetSummaryInterval(kMemorySummaryIntervalMs);
 
-    std::vector<std::string> modes         = {"Measurement of share generation", "Measurement of FssFMI key", "Measurement of execute Eval^{FssFMI}"};
+    std::vector<std::string> modes         = {"Measurement of share generation", "Measurement of FssFMI key", "Measurement of execute Eval^{FssFMI}", "Record Eval^{FssFMI} transcript", "Measurement of execute Eval^{FssFMI} (replay, single party)"};
     uint32_t                 selected_mode = bench_info.mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -103,67 +91,84 @@ void Bench_FssFmi(tools::secret_sharing::Party &party, const BenchInfo &bench_in
 
                 if (selected_mode == 1) {
                     // Generate data
+                    mem_1.Start();
                     timer_1.Start();
                     std::vector<uint32_t> pub_db(ts - 1);
                     std::vector<uint32_t> q(qs);
                     GenerateRandomNumbers(pub_db, 1);
                     GenerateRandomNumbers(q, 1);
                     std::reverse(pub_db.begin(), pub_db.end());    // To find LPM, we need to reverse the text
-                    std::string bwt = ConstructBwtFromVector(utils::VectorToStr(pub_db, ""));
+                    BwtIndex index;
+                    if (!BuildBwtIndex(utils::VectorToStr(pub_db, ""), kDefaultSaSampleRate, index)) {
+                        exit(EXIT_FAILURE);
+                    }
                     io.WriteVectorToFile(kFMIDBPath + "_t" + std::to_string(t), pub_db);
                     io.WriteVectorToFile(kFMIQueryPath + file_option, q);
-                    io.WriteStringToFile(kFMIBWTPath + "_t" + std::to_string(t), bwt);
+                    WriteBwtIndexToFile(kFMIIndexPath + "_t" + std::to_string(t), index);
                     timer_1.Print(LOCATION, mode_str + "Generate data" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Generate data" + measure_info);
 
                     // Generate query shares
+                    mem_1.Start();
                     timer_1.Start();
                     std::pair<std::vector<uint32_t>, std::vector<uint32_t>> q_sh = ss.Share(q);
                     sh.ExportShare(kFMIQueryPath_P0 + file_option, kFMIQueryPath_P1 + file_option, q_sh);
                     timer_1.Print(LOCATION, mode_str + "Generate share of query" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Generate share of query" + measure_info);
 
                 } else if (selected_mode == 2) {
                     timer_all.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
                     timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
 
-                    // Generate shares of beaver triples
+                    // Generate shares of correlated triples
+                    mem_1.Start();
                     timer_1.Start();
-                    bts_t btf(qs), btg(qs);
-                    ss.GenerateBeaverTriples(qs, btf);
-                    ss.GenerateBeaverTriples(qs, btg);
-                    std::pair<bts_t, bts_t> btf_sh = ss.ShareBeaverTriples(btf);
-                    std::pair<bts_t, bts_t> btg_sh = ss.ShareBeaverTriples(btg);
-                    sh.ExportBT(kFMIBTPath_F + file_option, btf);
-                    sh.ExportBT(kFMIBTPath_G + file_option, btg);
-                    sh.ExportBTShare(kFMIBTPath_F_P0 + file_option, kFMIBTPath_F_P1 + file_option, btf_sh);
-                    sh.ExportBTShare(kFMIBTPath_G_P0 + file_option, kFMIBTPath_G_P1 + file_option, btg_sh);
-                    timer_1.Print(LOCATION, mode_str + "Generate share of beaver triples" + measure_info);
+                    cts_t ct;
+                    ss.GenerateCorrelatedTriples(qs - 1, 2, ct);
+                    std::pair<cts_t, cts_t> ct_sh = ss.ShareCorrelatedTriples(ct);
+                    sh.ExportCT(kFMICTPath + file_option, ct);
+                    sh.ExportCTShare(kFMICTPath_P0 + file_option, kFMICTPath_P1 + file_option, ct_sh);
+                    timer_1.Print(LOCATION, mode_str + "Generate share of correlated triples" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Generate share of correlated triples" + measure_info);
 
                     // Generate key of FssFMI
+                    mem_1.Start();
                     timer_1.Start();
                     std::pair<FssFmiKey, FssFmiKey> fmi_keys = fss_fmi.GenerateKeys(qs - 1, qs);
                     key_io.WriteFssFmiKeyToFile(kFMIKeyPath_P0 + file_option, fmi_keys.first);
                     key_io.WriteFssFmiKeyToFile(kFMIKeyPath_P1 + file_option, fmi_keys.second);
                     timer_1.Print(LOCATION, mode_str + "Generate FssFMI key" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Generate FssFMI key" + measure_info);
+
+                } else if (selected_mode >= 3) {
+                    // Mode 4 records the messages of the other party and mode 5 replays them without the other party
+                    std::string trans_path = ((party.GetId() == 0) ? kFMITransPath_P0 : kFMITransPath_P1) + file_option;
+                    if (selected_mode == 5 && !party.StartReplay(trans_path)) {
+                        exit(EXIT_FAILURE);
+                    }
 
-                } else if (selected_mode == 3) {
                     // Start communication
                     party.StartCommunication();
+                    if (selected_mode == 4 && !party.StartRecording(trans_path)) {
+                        exit(EXIT_FAILURE);
+                    }
 
+                    mem_1.Start();
                     timer_1.Start();
                     // Set database (bwt)
-                    std::string bwt;
-                    io.ReadStringFromFile(kFMIBWTPath + "_t" + std::to_string(t), bwt);
-                    fss_fmi.SetSentence(bwt);
-                    // Set beaver triples
-                    bts_t btf, btg;
+                    BwtIndex index;
+                    if (!ReadBwtIndexFromFile(kFMIIndexPath + "_t" + std::to_string(t), index)) {
+                        exit(EXIT_FAILURE);
+                    }
+                    fss_fmi.SetSentence(index.ToString());
+                    // Set correlated triples
+                    cts_t ct;
                     if (party.GetId() == 0) {
-                        sh.LoadBTShare(kFMIBTPath_F_P0 + file_option, btf);
-                        sh.LoadBTShare(kFMIBTPath_G_P0 + file_option, btg);
+                        sh.LoadCTShare(kFMICTPath_P0 + file_option, ct);
                     } else {
-                        sh.LoadBTShare(kFMIBTPath_F_P1 + file_option, btf);
-                        sh.LoadBTShare(kFMIBTPath_G_P1 + file_option, btg);
+                        sh.LoadCTShare(kFMICTPath_P1 + file_option, ct);
                     }
-                    fss_fmi.SetBeaverTriple(btf, btg);
+                    fss_fmi.SetCorrelatedTriple(ct);
                     // Read FssFMI key
                     FssFmiKey fmi_key;
                     if (party.GetId() == 0) {
@@ -179,8 +184,11 @@ void Bench_FssFmi(tools::secret_sharing::Party &party, const BenchInfo &bench_in
                         sh.LoadShare(kFMIQueryPath_P1 + file_option, q_1);
                     }
                     timer_1.Print(LOCATION, mode_str + "Set data" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Set data" + measure_info);
 
                     // Execute Eval^{FssFMI} algorithm
+                    mem_2.Start();
+                    tlb_2.Start();
                     timer_2.Start();
                     std::vector<uint32_t> eq(qs), eq_0(qs), eq_1(qs);
                     if (party.GetId() == 0) {
@@ -190,9 +198,12 @@ void Bench_FssFmi(tools::secret_sharing::Party &party, const BenchInfo &bench_in
                     }
                     ss.Reconst(party, eq_0, eq_1, eq);
                     timer_2.Print(LOCATION, mode_str + "Execute Eval^{FssFMI}" + measure_info);
+                    tlb_2.Print(LOCATION, mode_str + "Execute Eval^{FssFMI}" + measure_info);
+                    mem_2.Print(LOCATION, mode_str + "Execute Eval^{FssFMI}" + measure_info);
                     fmi_key.FreeFssFmiKey();
                     timer_1.Print(LOCATION, mode_str + "FssFMI Total time" + measure_info);
                     party.OutputTotalBytesSent(measure_info);
+                    party.StopTranscript();
                 }
 
                 // ############# END #############
@@ -201,6 +212,7 @@ void Bench_FssFmi(tools::secret_sharing::Party &party, const BenchInfo &bench_in
                     utils::Logger::InfoLog(LOCATION, "The execution time exceeds the limit time: " + std::to_string(timer_res) + " " + timer_all.GetTimeUnitStr());
                     exit(EXIT_FAILURE);
                 }
+                utils::MemoryMonitor::PrintPeriodicSummary(LOCATION);
             }
         }
     }
@@ -8,6 +8,7 @@
 
 #include "fss_fmi.hpp"
 
+#include <algorithm>
 #include <sdsl/csa_wt.hpp>
 #include <sdsl/suffix_arrays.hpp>
 #include <thread>
@@ -20,25 +21,27 @@
 
 namespace {
 
-const std::string kCurrentPath     = utils::GetCurrentDirectory();
-const std::string kTestFMIPath     = kCurrentPath + "/data/test/fmi/";
-const std::string kFMIBTPath_F     = kTestFMIPath + "btf";
-const std::string kFMIBTPath_F_P0  = kTestFMIPath + "btf_p0";
-const std::string kFMIBTPath_F_P1  = kTestFMIPath + "btf_p1";
-const std::string kFMIBTPath_G     = kTestFMIPath + "btg";
-const std::string kFMIBTPath_G_P0  = kTestFMIPath + "btg_p0";
-const std::string kFMIBTPath_G_P1  = kTestFMIPath + "btg_p1";
-const std::string kFMIKeyPath_P0   = kTestFMIPath + "key_p0";
-const std::string kFMIKeyPath_P1   = kTestFMIPath + "key_p1";
-const std::string kFMIDBPath       = kTestFMIPath + "db";
-const std::string kFMIBWTPath      = kTestFMIPath + "bwt";
-const std::string kFMIQueryPath    = kTestFMIPath + "query";
-const std::string kFMIQueryPath_P0 = kTestFMIPath + "query_p0";
-const std::string kFMIQueryPath_P1 = kTestFMIPath + "query_p1";
-
-using bts_t = tools::secret_sharing::bts_t;
-
-constexpr uint32_t kQuerySize = 4;
+const std::string kCurrentPath      = utils::GetCurrentDirectory();
+const std::string kTestFMIPath      = kCurrentPath + "/data/test/fmi/";
+const std::string kFMICTPath        = kTestFMIPath + "ct";
+const std::string kFMICTPath_P0     = kTestFMIPath + "ct_p0";
+const std::string kFMICTPath_P1     = kTestFMIPath + "ct_p1";
+const std::string kFMIKeyPath_P0    = kTestFMIPath + "key_p0";
+const std::string kFMIKeyPath_P1    = kTestFMIPath + "key_p1";
+const std::string kFMICntKeyPath_P0 = kTestFMIPath + "cntkey_p0";
+const std::string kFMICntKeyPath_P1 = kTestFMIPath + "cntkey_p1";
+const std::string kFMIDBPath        = kTestFMIPath + "db";
+const std::string kFMIBWTPath       = kTestFMIPath + "bwt";
+const std::string kFMIIndexPath_P0  = kTestFMIPath + "index_p0.bin";
+const std::string kFMIIndexPath_P1  = kTestFMIPath + "index_p1.bin";
+const std::string kFMIQueryPath     = kTestFMIPath + "query";
+const std::string kFMIQueryPath_P0  = kTestFMIPath + "query_p0";
+const std::string kFMIQueryPath_P1  = kTestFMIPath + "query_p1";
+
+using cts_t = tools::secret_sharing::cts_t;
+
+constexpr uint32_t kQuerySize  = 4;
+constexpr uint32_t kSessionNum = 8;
 
 std::string ConstructBwtFromVector(const std::string &input) {
     size_t input_size = input.size();
@@ -126,9 +129,12 @@ namespace test {
 
 bool Test_FssFMIOffline(tools::secret_sharing::Party &party, const TestInfo &test_info);
 bool Test_FssFMIOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_FssFMICountOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_FssFMISessionOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_FssFMIDiskOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
 
 void Test_FssFmi(tools::secret_sharing::Party &party, TestInfo &test_info) {
-    std::vector<std::string> modes         = {"FssFMI unit tests", "FssFMIOffline", "FssFMIOnline"};
+    std::vector<std::string> modes         = {"FssFMI unit tests", "FssFMIOffline", "FssFMIOnline", "FssFMICountOnline", "FssFMISessionOnline", "FssFMIDiskOnline"};
     uint32_t                 selected_mode = test_info.mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -144,10 +150,19 @@ void Test_FssFmi(tools::secret_sharing::Party &party, TestInfo &test_info) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
         utils::PrintTestResult("Test_FssFMIOnline", Test_FssFMIOnline(party, test_info));
+        utils::PrintTestResult("Test_FssFMICountOnline", Test_FssFMICountOnline(party, test_info));
+        utils::PrintTestResult("Test_FssFMISessionOnline", Test_FssFMISessionOnline(party, test_info));
+        utils::PrintTestResult("Test_FssFMIDiskOnline", Test_FssFMIDiskOnline(party, test_info));
     } else if (selected_mode == 2) {
         utils::PrintTestResult("Test_FssFMIOffline", Test_FssFMIOffline(party, test_info));
     } else if (selected_mode == 3) {
         utils::PrintTestResult("Test_FssFMIOnline", Test_FssFMIOnline(party, test_info));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_FssFMICountOnline", Test_FssFMICountOnline(party, test_info));
+    } else if (selected_mode == 5) {
+        utils::PrintTestResult("Test_FssFMISessionOnline", Test_FssFMISessionOnline(party, test_info));
+    } else if (selected_mode == 6) {
+        utils::PrintTestResult("Test_FssFMIDiskOnline", Test_FssFMIDiskOnline(party, test_info));
     }
     utils::PrintText(utils::kDash);
 }
@@ -189,19 +204,14 @@ bool Test_FssFMIOffline(tools::secret_sharing::Party &party, const TestInfo &tes
         utils::Logger::DebugLog(LOCATION, "q_0: " + utils::VectorToStr(q_sh.first), test_info.dbg_info.debug);
         utils::Logger::DebugLog(LOCATION, "q_1: " + utils::VectorToStr(q_sh.second), test_info.dbg_info.debug);
 
-        // Generate beaver triples
-        bts_t btf(qs - 1), btg(qs - 1);
-        ss.GenerateBeaverTriples(qs - 1, btf);
-        ss.GenerateBeaverTriples(qs - 1, btg);
-        std::pair<bts_t, bts_t> btf_sh = ss.ShareBeaverTriples(btf);
-        std::pair<bts_t, bts_t> btg_sh = ss.ShareBeaverTriples(btg);
-        sh.ExportBT(kFMIBTPath_F, btf);
-        sh.ExportBT(kFMIBTPath_G, btg);
-        sh.ExportBTShare(kFMIBTPath_F_P0, kFMIBTPath_F_P1, btf_sh);
-        sh.ExportBTShare(kFMIBTPath_G_P0, kFMIBTPath_G_P1, btg_sh);
+        // Generate correlated triples (q[i] is multiplied by the rank differences of f and g)
+        cts_t ct;
+        ss.GenerateCorrelatedTriples(qs - 1, 2, ct);
+        std::pair<cts_t, cts_t> ct_sh = ss.ShareCorrelatedTriples(ct);
+        sh.ExportCT(kFMICTPath, ct);
+        sh.ExportCTShare(kFMICTPath_P0, kFMICTPath_P1, ct_sh);
         for (uint32_t i = 0; i < qs - 1; i++) {
-            utils::Logger::DebugLog(LOCATION, "Share of bt: " + btf[i].ToStr() + " -> " + btf_sh.first[i].ToStr(false) + ", " + btf_sh.second[i].ToStr(false), test_info.dbg_info.debug);
-            utils::Logger::DebugLog(LOCATION, "Share of bt: " + btg[i].ToStr() + " -> " + btg_sh.first[i].ToStr(false) + ", " + btg_sh.second[i].ToStr(false), test_info.dbg_info.debug);
+            utils::Logger::DebugLog(LOCATION, "Share of ct: " + ct[i].ToStr() + " -> " + ct_sh.first[i].ToStr(false) + ", " + ct_sh.second[i].ToStr(false), test_info.dbg_info.debug);
         }
 
         // Generate key of FssFMI
@@ -218,6 +228,26 @@ bool Test_FssFMIOffline(tools::secret_sharing::Party &party, const TestInfo &tes
         fmi_keys.second.FreeFssFmiKey();
         fmi_key_0.FreeFssFmiKey();
         fmi_key_1.FreeFssFmiKey();
+
+        // The keys generated from a seed are regenerated from the seed and the index
+        const Block                     seed(0x6b1f3c8e20d94a75, 0xc3e9a0572b4d8f16);
+        std::pair<FssFmiKey, FssFmiKey> seeded_keys   = fss_fmi.GenerateKeys(seed, 0, qs - 1, qs);
+        std::pair<FssFmiKey, FssFmiKey> regenerated   = fss_fmi.GenerateKeys(seed, 0, qs - 1, qs);
+        std::pair<FssFmiKey, FssFmiKey> other_indices = fss_fmi.GenerateKeys(seed, 1, qs - 1, qs);
+        result &= (seeded_keys.first == regenerated.first) && (seeded_keys.second == regenerated.second);
+        result &= !(seeded_keys.first == other_indices.first);
+        for (auto *keys : {&seeded_keys, &regenerated, &other_indices}) {
+            keys->first.FreeFssFmiKey();
+            keys->second.FreeFssFmiKey();
+        }
+
+        // Generate count-only key of FssFMI
+        std::pair<FssFmiCountKey, FssFmiCountKey> cnt_keys = fss_fmi.GenerateCountKeys(qs - 1);
+        utils::Logger::DebugLog(LOCATION, "Write FssFMI count key to file.", test_info.dbg_info.debug);
+        key_io.WriteFssFmiCountKeyToFile(kFMICntKeyPath_P0, cnt_keys.first);
+        key_io.WriteFssFmiCountKeyToFile(kFMICntKeyPath_P1, cnt_keys.second);
+        cnt_keys.first.FreeFssFmiCountKey();
+        cnt_keys.second.FreeFssFmiCountKey();
     }
     return result;
 }
@@ -238,16 +268,14 @@ bool Test_FssFMIOnline(tools::secret_sharing::Party &party, const TestInfo &test
         io.ReadStringFromFile(kFMIBWTPath, bwt);
         fss_fmi.SetSentence(bwt);
 
-        // Set beaver triples
-        bts_t btf, btg;
+        // Set correlated triples
+        cts_t ct;
         if (party.GetId() == 0) {
-            sh.LoadBTShare(kFMIBTPath_F_P0, btf);
-            sh.LoadBTShare(kFMIBTPath_G_P0, btg);
+            sh.LoadCTShare(kFMICTPath_P0, ct);
         } else {
-            sh.LoadBTShare(kFMIBTPath_F_P1, btf);
-            sh.LoadBTShare(kFMIBTPath_G_P1, btg);
+            sh.LoadCTShare(kFMICTPath_P1, ct);
         }
-        fss_fmi.SetBeaverTriple(btf, btg);
+        fss_fmi.SetCorrelatedTriple(ct);
 
         // Read FssFMI key
         FssFmiKey fmi_key;
@@ -301,6 +329,223 @@ bool Test_FssFMIOnline(tools::secret_sharing::Party &party, const TestInfo &test
     return result;
 }
 
+bool Test_FssFMICountOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        // The plain and the compressed bwt give the same shares
+        for (const bool compressed : {false, true}) {
+            FssFmiParameters                             params(size, kQuerySize, test_info.dbg_info);
+            uint32_t                                     qs = params.query_size;
+            tools::secret_sharing::AdditiveSecretSharing ss(size);
+            utils::FileIo                                io;
+            tools::secret_sharing::ShareHandler          sh;
+            internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+            FssFmi                                       fss_fmi(params);
+
+            // Set database (bwt or compressed bwt)
+            std::string bwt;
+            io.ReadStringFromFile(kFMIBWTPath, bwt);
+            if (compressed) {
+                fss_fmi.SetCompressedSentence(bwt);
+            } else {
+                fss_fmi.SetSentence(bwt);
+            }
+
+            // Set correlated triples and read FssFMI count key
+            cts_t          ct;
+            FssFmiCountKey cnt_key;
+            if (party.GetId() == 0) {
+                sh.LoadCTShare(kFMICTPath_P0, ct);
+                key_io.ReadFssFmiCountKeyFromFile(kFMICntKeyPath_P0, params, cnt_key);
+            } else {
+                sh.LoadCTShare(kFMICTPath_P1, ct);
+                key_io.ReadFssFmiCountKeyFromFile(kFMICntKeyPath_P1, params, cnt_key);
+            }
+            fss_fmi.SetCorrelatedTriple(ct);
+
+            // Read input data
+            std::vector<uint32_t> q_0(qs), q_1(qs);
+            if (party.GetId() == 0) {
+                sh.LoadShare(kFMIQueryPath_P0, q_0);
+            } else {
+                sh.LoadShare(kFMIQueryPath_P1, q_1);
+            }
+
+            // Start communication
+            party.StartCommunication();
+
+            // Execute count-only Eval^{FssFMI} algorithm
+            uint32_t cnt_0{0}, cnt_1{0};
+            if (party.GetId() == 0) {
+                cnt_0 = fss_fmi.EvaluateCount(party, cnt_key, q_0);
+            } else {
+                cnt_1 = fss_fmi.EvaluateCount(party, cnt_key, q_1);
+            }
+            uint32_t cnt = ss.Reconst(party, cnt_0, cnt_1);
+            cnt_key.FreeFssFmiCountKey();
+
+            // Check the result
+            std::vector<uint32_t> pub_db, q;
+            io.ReadVectorFromFile(kFMIDBPath, pub_db);
+            io.ReadVectorFromFile(kFMIQueryPath, q);
+            std::string q_str = utils::VectorToStr(q, "");
+            std::string text  = utils::VectorToStr(pub_db, "");
+
+            sdsl::csa_wt<> fm_index;
+            sdsl::construct_im(fm_index, text, 1);
+            uint32_t expected = sdsl::count(fm_index, q_str.begin(), q_str.end());
+            utils::Logger::DebugLog(LOCATION, "Query : " + q_str + (compressed ? " (compressed)" : ""), test_info.dbg_info.debug);
+            utils::Logger::DebugLog(LOCATION, "Count : " + std::to_string(cnt) + " (expected: " + std::to_string(expected) + ")", test_info.dbg_info.debug);
+            result &= cnt == expected;
+        }
+    }
+    return result;
+}
+
+bool Test_FssFMISessionOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters                             params(size, kQuerySize, test_info.dbg_info);
+        uint32_t                                     qs = params.query_size;
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        tools::secret_sharing::ShareHandler          sh;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        FssFmi                                       fss_fmi(params);
+
+        // Set database (bwt)
+        std::string bwt;
+        io.ReadStringFromFile(kFMIBWTPath, bwt);
+        fss_fmi.SetSentence(bwt);
+
+        // Set correlated triples, read FssFMI key and input data
+        cts_t                 ct;
+        FssFmiKey             fmi_key;
+        std::vector<uint32_t> q_sh(qs);
+        if (party.GetId() == 0) {
+            sh.LoadCTShare(kFMICTPath_P0, ct);
+            key_io.ReadFssFmiKeyFromFile(kFMIKeyPath_P0, params, fmi_key);
+            sh.LoadShare(kFMIQueryPath_P0, q_sh);
+        } else {
+            sh.LoadCTShare(kFMICTPath_P1, ct);
+            key_io.ReadFssFmiKeyFromFile(kFMIKeyPath_P1, params, fmi_key);
+            sh.LoadShare(kFMIQueryPath_P1, q_sh);
+        }
+        fss_fmi.SetCorrelatedTriple(ct);
+
+        // Start communication
+        party.StartCommunication();
+
+        // Reference: blocking Eval^{FssFMI} algorithm
+        std::vector<uint32_t> eq(qs), eq_0(qs), eq_1(qs);
+        fss_fmi.Evaluate(party, fmi_key, q_sh, (party.GetId() == 0) ? eq_0 : eq_1);
+        ss.Reconst(party, eq_0, eq_1, eq);
+
+        // The same query in kSessionNum sessions interleaved on this thread
+        std::vector<FssFmiSession>                sessions;
+        tools::secret_sharing::SessionMultiplexer mux(party);
+        sessions.reserve(kSessionNum);
+        for (uint32_t i = 0; i < kSessionNum; i++) {
+            sessions.emplace_back(fss_fmi, party.GetId(), fmi_key, ct, q_sh);
+        }
+        for (auto &session : sessions) {
+            mux.AddSession(session);
+        }
+        uint32_t rounds = mux.Run();
+        result &= (rounds == 2 * (qs - 1) + 1);
+
+        for (const auto &session : sessions) {
+            std::vector<uint32_t> seq(qs), seq_0(qs), seq_1(qs);
+            ((party.GetId() == 0) ? seq_0 : seq_1) = session.GetOutput();
+            ss.Reconst(party, seq_0, seq_1, seq);
+            result &= (seq == eq);
+        }
+
+        // The same sessions in two batches out of phase, with the ranks of each round evaluated in one pass
+        std::vector<FssFmiSession>                  pipelined;
+        tools::secret_sharing::PipelinedMultiplexer pipe(party, 2);
+        std::unique_ptr<rank::FssRankBatch>         rank_batch = fss_fmi.CreateRankBatch();
+        pipelined.reserve(kSessionNum);
+        for (uint32_t i = 0; i < kSessionNum; i++) {
+            pipelined.emplace_back(fss_fmi, party.GetId(), fmi_key, ct, q_sh, rank_batch.get());
+        }
+        for (auto &session : pipelined) {
+            pipe.AddSession(session);
+        }
+        result &= (pipe.Run() == std::min<uint32_t>(kSessionNum, 2) * (2 * (qs - 1) + 1));
+        for (const auto &session : pipelined) {
+            std::vector<uint32_t> seq(qs), seq_0(qs), seq_1(qs);
+            ((party.GetId() == 0) ? seq_0 : seq_1) = session.GetOutput();
+            ss.Reconst(party, seq_0, seq_1, seq);
+            result &= (seq == eq);
+        }
+        fmi_key.FreeFssFmiKey();
+
+        utils::Logger::DebugLog(LOCATION, "Eq: " + utils::VectorToStr(eq), test_info.dbg_info.debug);
+        utils::Logger::DebugLog(LOCATION, "Sessions: " + std::to_string(kSessionNum) + ", Rounds: " + std::to_string(rounds), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_FssFMIDiskOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters                             params(size, kQuerySize, test_info.dbg_info);
+        uint32_t                                     qs = params.query_size;
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        tools::secret_sharing::ShareHandler          sh;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        FssFmi                                       fss_fmi(params), fss_fmi_ref(params);
+
+        // Set database (bwt index streamed from disk, the shares are the same as the string one)
+        std::string           bwt;
+        std::vector<uint32_t> db;
+        io.ReadStringFromFile(kFMIBWTPath, bwt);
+        io.ReadVectorFromFile(kFMIDBPath, db);
+        std::string reversed = utils::VectorToStr(db, "");
+        std::reverse(reversed.begin(), reversed.end());
+        BwtIndex index;
+        result &= BuildBwtIndex(reversed, kDefaultSaSampleRate, index) && index.ToString() == bwt;
+        result &= WriteBwtIndexToFile(party.GetId() == 0 ? kFMIIndexPath_P0 : kFMIIndexPath_P1, index);
+        result &= fss_fmi.SetIndexFile(party.GetId() == 0 ? kFMIIndexPath_P0 : kFMIIndexPath_P1);
+        fss_fmi_ref.SetSentence(bwt);
+
+        // Set correlated triples, read FssFMI key and input data
+        cts_t                 ct;
+        FssFmiKey             fmi_key;
+        std::vector<uint32_t> q_sh(qs);
+        if (party.GetId() == 0) {
+            sh.LoadCTShare(kFMICTPath_P0, ct);
+            key_io.ReadFssFmiKeyFromFile(kFMIKeyPath_P0, params, fmi_key);
+            sh.LoadShare(kFMIQueryPath_P0, q_sh);
+        } else {
+            sh.LoadCTShare(kFMICTPath_P1, ct);
+            key_io.ReadFssFmiKeyFromFile(kFMIKeyPath_P1, params, fmi_key);
+            sh.LoadShare(kFMIQueryPath_P1, q_sh);
+        }
+        fss_fmi.SetCorrelatedTriple(ct);
+        fss_fmi_ref.SetCorrelatedTriple(ct);
+
+        // Start communication
+        party.StartCommunication();
+
+        // The disk-backed index must give the same result as the in-memory bwt
+        std::vector<uint32_t> eq(qs), eq_0(qs), eq_1(qs);
+        std::vector<uint32_t> ref(qs), ref_0(qs), ref_1(qs);
+        fss_fmi.Evaluate(party, fmi_key, q_sh, (party.GetId() == 0) ? eq_0 : eq_1);
+        ss.Reconst(party, eq_0, eq_1, eq);
+        fss_fmi_ref.Evaluate(party, fmi_key, q_sh, (party.GetId() == 0) ? ref_0 : ref_1);
+        ss.Reconst(party, ref_0, ref_1, ref);
+        fmi_key.FreeFssFmiKey();
+        result &= (eq == ref);
+
+        utils::Logger::DebugLog(LOCATION, "Eq (disk)  : " + utils::VectorToStr(eq), test_info.dbg_info.debug);
+        utils::Logger::DebugLog(LOCATION, "Eq (memory): " + utils::VectorToStr(ref), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
 }    // namespace test
 }    // namespace fmi
 }    // namespace fss
@@ -0,0 +1,272 @@
+/**
+ * @file index_registry.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-17
+ * @copyright Copyright (c) 2024
+ * @brief Shared-memory registry of BWT indexes implementation.
+ */
+
+#include "index_registry.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+
+namespace {
+
+constexpr char     kIndexSegmentMagic[8] = {'F', 'S', 'S', 'S', 'H', 'M', '\0', '\0'};
+constexpr uint32_t kPublishWaitMs        = 30000;    // The time for the first publisher of a name to fill its segment
+constexpr uint32_t kPublishPollMs        = 10;
+
+utils::Gauge &MappedIndexBytes() {
+    static utils::Gauge &gauge = utils::MetricsRegistry::GetInstance().GetGauge("fss_index_mapped_bytes", "Bytes of shared-memory indexes mapped by this process.");
+    return gauge;
+}
+
+utils::Gauge &AttachedIndexes() {
+    static utils::Gauge &gauge = utils::MetricsRegistry::GetInstance().GetGauge("fss_index_attached", "Number of shared-memory indexes attached by this process.");
+    return gauge;
+}
+
+uint32_t PageSize() {
+    return static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+}
+
+bool IsValidName(const std::string &name) {
+    return !name.empty() && name.find('/') == std::string::npos;
+}
+
+// The size of a shared memory segment (-1 on failure)
+off_t SegmentSize(const int fd) {
+    struct stat st;
+    return (fstat(fd, &st) == 0) ? st.st_size : -1;
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+
+IndexRegistry &IndexRegistry::GetInstance() {
+    static IndexRegistry instance;
+    return instance;
+}
+
+bool IndexRegistry::Publish(const std::string &name, const BwtIndex &index) {
+    if (!IsValidName(name)) {
+        utils::Logger::ErrorLog(LOCATION, "Invalid index name: " + name);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    std::string                 shm_name = kIndexSegmentPrefix + name;
+
+    // Another process may have created the segment and not yet resized or filled it (e.g. both parties start at the same time),
+    // so an existing segment is mapped only once its magic number is written, and a segment removed meanwhile is created again
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kPublishWaitMs);
+    int  fd       = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    while (fd < 0 && errno == EEXIST) {
+        SegmentState state = this->ProbeSegment(shm_name);
+        if (state == SegmentState::kReady) {
+            // Already published: accept it only if the content is the same
+            Segment segment;
+            if (!this->MapSegment(name, segment)) {
+                return false;
+            }
+            bool same = (segment.header->length == index.length) && (segment.header->zero_count == index.zero_count);
+            for (uint64_t i = 0; same && i < index.length; i++) {
+                same = (segment.data[i] == index.At(i));
+            }
+            this->UnmapSegment(segment);
+            if (!same) {
+                utils::Logger::ErrorLog(LOCATION, "A different index is published under the name " + name);
+            }
+            return same;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            utils::Logger::ErrorLog(LOCATION, "The shared memory segment " + shm_name + " was not completed within " + std::to_string(kPublishWaitMs) + " ms");
+            return false;
+        }
+        if (state == SegmentState::kIncomplete) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(kPublishPollMs));
+        }
+        fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to create the shared memory segment " + shm_name + " (" + std::strerror(errno) + ")");
+        return false;
+    }
+
+    uint32_t data_offset = PageSize();
+    size_t   size        = data_offset + index.length;
+    if (ftruncate(fd, size) != 0) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to resize the shared memory segment " + shm_name + " (" + std::strerror(errno) + ")");
+        close(fd);
+        shm_unlink(shm_name.c_str());
+        return false;
+    }
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to map the shared memory segment " + shm_name + " (" + std::strerror(errno) + ")");
+        shm_unlink(shm_name.c_str());
+        return false;
+    }
+
+    SegmentHeader *header = new (addr) SegmentHeader();
+    char          *data   = static_cast<char *>(addr) + data_offset;
+    header->version       = kIndexSegmentVersion;
+    header->data_offset   = data_offset;
+    header->length        = index.length;
+    header->zero_count    = index.zero_count;
+    header->attach_count.store(0);
+    for (uint64_t i = 0; i < index.length; i++) {
+        data[i] = index.At(i);
+    }
+    // The magic number is written last, so a partially written segment is never attached
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, kIndexSegmentMagic, sizeof(kIndexSegmentMagic));
+    munmap(addr, size);
+
+    utils::Logger::InfoLog(LOCATION, "Published index " + name + " (" + std::to_string(index.length) + " bytes)");
+    return true;
+}
+
+bool IndexRegistry::Attach(const std::string &name, IndexView &view) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto                        it = this->segments_.find(name);
+    if (it == this->segments_.end()) {
+        Segment segment;
+        if (!this->MapSegment(name, segment)) {
+            return false;
+        }
+        it = this->segments_.emplace(name, segment).first;
+        MappedIndexBytes().Add(static_cast<int64_t>(segment.header->length));
+        AttachedIndexes().Add(1);
+    }
+    Segment &segment = it->second;
+    segment.refs++;
+    segment.header->attach_count.fetch_add(1);
+    view.bwt        = std::string_view(segment.data, segment.header->length);
+    view.zero_count = segment.header->zero_count;
+    return true;
+}
+
+void IndexRegistry::Detach(const std::string &name) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto                        it = this->segments_.find(name);
+    if (it == this->segments_.end()) {
+        utils::Logger::WarnLog(LOCATION, "Index " + name + " is not attached");
+        return;
+    }
+    Segment &segment = it->second;
+    segment.header->attach_count.fetch_sub(1);
+    if (--segment.refs == 0) {
+        MappedIndexBytes().Add(-static_cast<int64_t>(segment.header->length));
+        AttachedIndexes().Add(-1);
+        this->UnmapSegment(segment);
+        this->segments_.erase(it);
+    }
+}
+
+bool IndexRegistry::Remove(const std::string &name) {
+    std::string shm_name = kIndexSegmentPrefix + name;
+    if (!IsValidName(name) || (shm_unlink(shm_name.c_str()) != 0 && errno != ENOENT)) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to remove the shared memory segment " + shm_name);
+        return false;
+    }
+    return true;
+}
+
+uint64_t IndexRegistry::GetAttachCount(const std::string &name) const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto                        it = this->segments_.find(name);
+    return (it == this->segments_.end()) ? 0 : it->second.header->attach_count.load();
+}
+
+bool IndexRegistry::MapSegment(const std::string &name, Segment &segment) const {
+    std::string shm_name = kIndexSegmentPrefix + name;
+    int         fd       = shm_open(shm_name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        utils::Logger::ErrorLog(LOCATION, "Index " + name + " is not published (" + std::strerror(errno) + ")");
+        return false;
+    }
+
+    // The header page is writable for the attach count; the BWT is mapped read-only
+    // (the size is checked first, since the pages beyond the end of the segment cannot be accessed)
+    uint32_t page_size = PageSize();
+    off_t    size      = SegmentSize(fd);
+    if (size < static_cast<off_t>(page_size)) {
+        utils::Logger::ErrorLog(LOCATION, "Invalid or incomplete index segment " + shm_name);
+        close(fd);
+        return false;
+    }
+    void *head = mmap(nullptr, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (head == MAP_FAILED) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to map the header of " + shm_name + " (" + std::strerror(errno) + ")");
+        close(fd);
+        return false;
+    }
+    segment.header = static_cast<SegmentHeader *>(head);
+    if (std::memcmp(segment.header->magic, kIndexSegmentMagic, sizeof(kIndexSegmentMagic)) != 0 || segment.header->version != kIndexSegmentVersion ||
+        segment.header->data_offset != page_size || static_cast<uint64_t>(size) < segment.header->data_offset + segment.header->length) {
+        utils::Logger::ErrorLog(LOCATION, "Invalid or incomplete index segment " + shm_name);
+        munmap(head, page_size);
+        close(fd);
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    segment.data = nullptr;
+    segment.refs = 0;
+    if (segment.header->length > 0) {
+        void *data = mmap(nullptr, segment.header->length, PROT_READ, MAP_SHARED, fd, segment.header->data_offset);
+        if (data == MAP_FAILED) {
+            utils::Logger::ErrorLog(LOCATION, "Failed to map the BWT of " + shm_name + " (" + std::strerror(errno) + ")");
+            munmap(head, page_size);
+            close(fd);
+            return false;
+        }
+        segment.data = static_cast<const char *>(data);
+    }
+    close(fd);
+    return true;
+}
+
+IndexRegistry::SegmentState IndexRegistry::ProbeSegment(const std::string &shm_name) const {
+    int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return (errno == ENOENT) ? SegmentState::kAbsent : SegmentState::kIncomplete;
+    }
+    uint32_t page_size = PageSize();
+    if (SegmentSize(fd) < static_cast<off_t>(page_size)) {
+        close(fd);
+        return SegmentState::kIncomplete;
+    }
+    void *head = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (head == MAP_FAILED) {
+        return SegmentState::kIncomplete;
+    }
+    bool ready = std::memcmp(static_cast<const SegmentHeader *>(head)->magic, kIndexSegmentMagic, sizeof(kIndexSegmentMagic)) == 0;
+    munmap(head, page_size);
+    return ready ? SegmentState::kReady : SegmentState::kIncomplete;
+}
+
+void IndexRegistry::UnmapSegment(const Segment &segment) const {
+    if (segment.data != nullptr) {
+        munmap(const_cast<char *>(segment.data), segment.header->length);
+    }
+    munmap(segment.header, PageSize());
+}
+
+}    // namespace fmi
+}    // namespace fss
@@ -0,0 +1,150 @@
+/**
+ * @file index_registry.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-17
+ * @copyright Copyright (c) 2024
+ * @brief Shared-memory registry of BWT indexes.
+ */
+
+#ifndef FM_INDEX_INDEX_REGISTRY_H_
+#define FM_INDEX_INDEX_REGISTRY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "bwt_index.hpp"
+
+namespace fss {
+namespace fmi {
+
+constexpr uint32_t kIndexSegmentVersion = 1;
+const std::string  kIndexSegmentPrefix  = "/fssfmi.";    // POSIX shared memory name prefix
+
+/**
+ * @struct IndexView
+ * @brief A non-owning view of a published index, as used by FssFmi::SetIndexView.
+ */
+struct IndexView {
+    std::string_view bwt;        /**< The BWT as a string of '0', '1' and '$'. */
+    uint64_t         zero_count; /**< The number of '0' in the BWT. */
+
+    IndexView()
+        : zero_count(0) {
+    }
+};
+
+/**
+ * @class IndexRegistry
+ * @brief A process-wide registry of indexes stored in named shared-memory segments.
+ *
+ * An index is published once per host and every worker process maps the same pages read-only,
+ * so the memory for an index is paid once regardless of the number of workers.
+ * A segment consists of one header page (mapped read-write for the attach count) followed by the BWT characters (mapped read-only).
+ * Attaching the same name twice in a process reuses the mapping; the attach count in the header covers all processes.
+ * The count is not corrected for processes that exit without detaching.
+ */
+class IndexRegistry {
+public:
+    /**
+     * @brief Get the process-wide instance.
+     * @return The registry.
+     */
+    static IndexRegistry &GetInstance();
+
+    /**
+     * @brief Publish an index under the given name.
+     *
+     * If the name is already published with the same content, nothing is done.
+     * A segment being created by another process is waited for (up to 30 s) until its content is complete.
+     *
+     * @param name The name of the index (without '/').
+     * @param index The index to be published.
+     * @return `true` if the index is available under the name.
+     */
+    bool Publish(const std::string &name, const BwtIndex &index);
+
+    /**
+     * @brief Attach to a published index.
+     * @param name The name of the index.
+     * @param view The view of the index (valid until the matching Detach).
+     * @return `true` if the index was attached.
+     */
+    bool Attach(const std::string &name, IndexView &view);
+
+    /**
+     * @brief Detach from an index attached by this process.
+     * @param name The name of the index.
+     */
+    void Detach(const std::string &name);
+
+    /**
+     * @brief Remove the name of an index. Processes attached to it keep their mappings.
+     * @param name The name of the index.
+     * @return `true` if the name is no longer published.
+     */
+    bool Remove(const std::string &name);
+
+    /**
+     * @brief Get the number of attachments of an index over all processes.
+     * @param name The name of the index (attached by this process).
+     * @return The number of attachments (0 if not attached by this process).
+     */
+    uint64_t GetAttachCount(const std::string &name) const;
+
+private:
+    struct SegmentHeader {
+        char                  magic[8];     /**< The magic number. */
+        uint32_t              version;      /**< The segment version. */
+        uint32_t              data_offset;  /**< The offset of the BWT (page aligned). */
+        uint64_t              length;       /**< The length of the BWT. */
+        uint64_t              zero_count;   /**< The number of '0' in the BWT. */
+        std::atomic<uint64_t> attach_count; /**< The number of attachments over all processes. */
+    };
+
+    enum class SegmentState {
+        kAbsent,     /**< The name is not published. */
+        kIncomplete, /**< The segment exists, but its publisher has not finished writing it. */
+        kReady,      /**< The segment is complete. */
+    };
+
+    struct Segment {
+        SegmentHeader *header; /**< The header page (read-write). */
+        const char    *data;   /**< The BWT (read-only). */
+        uint32_t       refs;   /**< The number of attachments in this process. */
+    };
+
+    IndexRegistry() = default;
+
+    /**
+     * @brief Map a published segment (called with the lock held).
+     */
+    bool MapSegment(const std::string &name, Segment &segment) const;
+
+    /**
+     * @brief Check whether a segment exists and is complete, without mapping its BWT.
+     */
+    SegmentState ProbeSegment(const std::string &shm_name) const;
+
+    /**
+     * @brief Unmap a segment.
+     */
+    void UnmapSegment(const Segment &segment) const;
+
+    std::map<std::string, Segment> segments_; /**< The segments attached by this process. */
+    mutable std::mutex             mutex_;    /**< Guards the segments. */
+};
+
+namespace test {
+
+void Test_IndexRegistry(TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace fmi
+}    // namespace fss
+
+#endif    // FM_INDEX_INDEX_REGISTRY_H_
@@ -0,0 +1,192 @@
+/**
+ * @file index_registry_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-17
+ * @copyright Copyright (c) 2024
+ * @brief Shared-memory registry of BWT indexes test implementation.
+ */
+
+#include "index_registry.hpp"
+
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+const std::string kTestIndexName = "test_" + std::to_string(getpid());
+
+constexpr uint32_t kTestSaSampleRate = 4;
+constexpr uint32_t kTestPublisherNum = 4;
+
+std::string GenerateRandomText(const uint32_t size) {
+    std::string text;
+    for (uint32_t i = 0; i < size; i++) {
+        text += (tools::rng::SecureRng::Rand64() & 1) ? '1' : '0';
+    }
+    return text;
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+namespace test {
+
+bool Test_IndexRegistryAttach(const TestInfo &test_info);
+bool Test_IndexRegistryProcesses(const TestInfo &test_info);
+bool Test_IndexRegistryConcurrentPublish(const TestInfo &test_info);
+
+void Test_IndexRegistry(TestInfo &test_info) {
+    std::vector<std::string> modes         = {"Index registry unit tests", "Attach", "Processes", "ConcurrentPublish"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        utils::PrintTestResult("Test_IndexRegistryAttach", Test_IndexRegistryAttach(test_info));
+        utils::PrintTestResult("Test_IndexRegistryProcesses", Test_IndexRegistryProcesses(test_info));
+        utils::PrintTestResult("Test_IndexRegistryConcurrentPublish", Test_IndexRegistryConcurrentPublish(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_IndexRegistryAttach", Test_IndexRegistryAttach(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_IndexRegistryProcesses", Test_IndexRegistryProcesses(test_info));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_IndexRegistryConcurrentPublish", Test_IndexRegistryConcurrentPublish(test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_IndexRegistryAttach(const TestInfo &test_info) {
+    bool           result   = true;
+    IndexRegistry &registry = IndexRegistry::GetInstance();
+    for (const auto size : test_info.domain_size) {
+        BwtIndex index, other;
+        result &= BuildBwtIndex(GenerateRandomText(utils::Pow(2, size) - 1), kTestSaSampleRate, index);
+        result &= BuildBwtIndex(GenerateRandomText(utils::Pow(2, size) - 1), kTestSaSampleRate, other);
+
+        // Publishing the same content twice is accepted, a different content is not
+        result &= registry.Publish(kTestIndexName, index);
+        result &= registry.Publish(kTestIndexName, index);
+        result &= (index == other) || !registry.Publish(kTestIndexName, other);
+
+        // Two attachments share one mapping
+        IndexView view_0, view_1;
+        result &= registry.Attach(kTestIndexName, view_0);
+        result &= registry.Attach(kTestIndexName, view_1);
+        result &= (view_0.bwt.data() == view_1.bwt.data());
+        result &= (view_0.bwt == index.ToString()) && (view_0.zero_count == index.zero_count);
+        result &= (registry.GetAttachCount(kTestIndexName) == 2);
+
+        registry.Detach(kTestIndexName);
+        result &= (registry.GetAttachCount(kTestIndexName) == 1);
+        result &= registry.Remove(kTestIndexName);
+        result &= (view_0.bwt == index.ToString());    // Still mapped after the name is removed
+        registry.Detach(kTestIndexName);
+        result &= (registry.GetAttachCount(kTestIndexName) == 0);
+
+        IndexView removed;
+        result &= !registry.Attach(kTestIndexName, removed);
+        utils::Logger::DebugLog(LOCATION, "Text size: " + std::to_string(index.length - 1) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_IndexRegistryProcesses(const TestInfo &test_info) {
+    bool           result   = true;
+    IndexRegistry &registry = IndexRegistry::GetInstance();
+    for (const auto size : test_info.domain_size) {
+        BwtIndex index;
+        result &= BuildBwtIndex(GenerateRandomText(utils::Pow(2, size) - 1), kTestSaSampleRate, index);
+        result &= registry.Publish(kTestIndexName, index);
+
+        // A worker process attaches by name before the parent, and both are counted while attached
+        int  to_parent[2], to_child[2];
+        char signal = 0;
+        result &= (pipe(to_parent) == 0) && (pipe(to_child) == 0);
+        pid_t pid = fork();
+        if (pid == 0) {
+            IndexView child_view;
+            bool      ok = registry.Attach(kTestIndexName, child_view);
+            ok &= (child_view.bwt == index.ToString());
+            ok &= (write(to_parent[1], &signal, 1) == 1) && (read(to_child[0], &signal, 1) == 1);
+            registry.Detach(kTestIndexName);
+            _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        IndexView view;
+        result &= (pid > 0) && (read(to_parent[0], &signal, 1) == 1);
+        result &= registry.Attach(kTestIndexName, view);
+        result &= (view.bwt == index.ToString()) && (registry.GetAttachCount(kTestIndexName) == 2);
+        result &= (write(to_child[1], &signal, 1) == 1);
+
+        int status = 0;
+        result &= (waitpid(pid, &status, 0) == pid) && WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS);
+        result &= (registry.GetAttachCount(kTestIndexName) == 1);
+        for (int fd : {to_parent[0], to_parent[1], to_child[0], to_child[1]}) {
+            close(fd);
+        }
+
+        registry.Detach(kTestIndexName);
+        result &= registry.Remove(kTestIndexName);
+        utils::Logger::DebugLog(LOCATION, "Text size: " + std::to_string(index.length - 1) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_IndexRegistryConcurrentPublish(const TestInfo &test_info) {
+    bool           result   = true;
+    IndexRegistry &registry = IndexRegistry::GetInstance();
+    std::string    shm_name = kIndexSegmentPrefix + kTestIndexName;
+    for (const auto size : test_info.domain_size) {
+        BwtIndex index;
+        result &= BuildBwtIndex(GenerateRandomText(utils::Pow(2, size) - 1), kTestSaSampleRate, index);
+
+        // An empty segment stands for a publisher that has created the name but not resized it yet
+        int stub = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        result &= (stub >= 0);
+
+        // The workers publish at the same time and wait for the segment instead of reading it
+        std::vector<pid_t> pids;
+        for (uint32_t i = 0; i < kTestPublisherNum; i++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                IndexView view;
+                bool      ok = registry.Publish(kTestIndexName, index) && registry.Attach(kTestIndexName, view);
+                ok &= (view.bwt == index.ToString());
+                registry.Detach(kTestIndexName);
+                _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            result &= (pid > 0);
+            pids.push_back(pid);
+        }
+
+        // The stub is abandoned, so one of the workers (or this process) creates the segment again
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        close(stub);
+        result &= registry.Remove(kTestIndexName);
+        result &= registry.Publish(kTestIndexName, index);
+
+        for (const pid_t pid : pids) {
+            int status = 0;
+            result &= (waitpid(pid, &status, 0) == pid) && WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS);
+        }
+        result &= registry.Remove(kTestIndexName);
+        utils::Logger::DebugLog(LOCATION, "Text size: " + std::to_string(index.length - 1) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace fmi
+}    // namespace fss
@@ -0,0 +1,418 @@
+/**
+ * @file kstep_fmi.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-30
+ * @copyright Copyright (c) 2024
+ * @brief KStepFmi implementation.
+ */
+
+#include "kstep_fmi.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "../../fss-base/prg/seeded_rng.hpp"
+#include "../../tools/random_number_generator.hpp"
+#include "../../tools/secret_sharing.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+utils::Counter &KStepQueryCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_fmi_kstep_queries_total", "Number of FssFMI queries evaluated k symbols per step.");
+    return counter;
+}
+
+utils::Histogram &KStepQueryLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_fmi_kstep_query_seconds", "Latency of a k-step FssFMI query including the communication rounds.");
+    return histogram;
+}
+
+utils::Gauge &KStepTableBytesGauge() {
+    static utils::Gauge &gauge = utils::MetricsRegistry::GetInstance().GetGauge("fss_fmi_kstep_table_bytes", "Resident bytes of the k-mer tables.");
+    return gauge;
+}
+
+// Sum the children of every node of the prefix tree: values[2^l + v] = values[2^(l+1) + v] + values[2^(l+1) + 2^l + v]
+void SumPrefixes(std::vector<uint32_t> &values, const uint32_t k) {
+    for (uint32_t l = k - 1; l >= 1; l--) {
+        for (uint32_t v = 0; v < (1U << l); v++) {
+            values[(1U << l) + v] = values[(2U << l) + v] + values[(2U << l) + (1U << l) + v];
+        }
+    }
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+
+KmerTable::KmerTable()
+    : kmer_size_(0), zero_count_(0) {
+}
+
+bool KmerTable::Build(const std::string_view bwt, const uint32_t k) {
+    if (k == 0 || k > kMaxKmerSize) {
+        utils::Logger::ErrorLog(LOCATION, "The k-mer size must be 1 to " + std::to_string(kMaxKmerSize) + " (" + std::to_string(k) + ")");
+        return false;
+    }
+    uint64_t n = bwt.size();
+
+    // The number of '0' before every row
+    utils::HugeVector<uint32_t> zeros(n + 1, 0);
+    uint64_t                    dollar_pos = n;
+    for (uint64_t j = 0; j < n; j++) {
+        if (bwt[j] == '$' && dollar_pos == n) {
+            dollar_pos = j;
+        } else if (bwt[j] != '0' && bwt[j] != '1') {
+            utils::Logger::ErrorLog(LOCATION, "Invalid character in the BWT at " + std::to_string(j));
+            return false;
+        }
+        zeros[j + 1] = zeros[j] + (bwt[j] == '0');
+    }
+    if (dollar_pos == n) {
+        utils::Logger::ErrorLog(LOCATION, "The BWT has no '$'");
+        return false;
+    }
+
+    // LF_c(p) = C[c] + rank_c(p), C = {1, 1 + the number of '0'} ('$' is the first row)
+    const std::array<uint32_t, 2> c_table = {1, 1 + zeros[n]};
+    auto lf = [&](const uint32_t c, const uint64_t p) -> uint32_t {
+        uint32_t rank = (c == 0) ? zeros[p] : static_cast<uint32_t>(p - zeros[p] - (dollar_pos < p));
+        return c_table[c] + rank;
+    };
+
+    // Read k characters by the LF mapping from every row
+    this->kmer_size_  = k;
+    this->zero_count_ = zeros[n];
+    this->labels_.assign(n, 0);
+    this->short_rows_.clear();
+    for (uint64_t j = 0; j < n; j++) {
+        uint64_t row    = j;
+        uint32_t label  = 0;
+        uint32_t length = 0;
+        while (length < k && row != dollar_pos) {
+            uint32_t c = bwt[row] - '0';
+            label |= c << length;
+            row = lf(c, row);
+            length++;
+        }
+        this->labels_[j] = static_cast<uint8_t>(label);
+        if (length < k) {
+            this->short_rows_.emplace_back(j, length);
+        }
+    }
+
+    // C_w of every prefix, extending the prefixes by one character
+    this->offsets_.assign(2U << k, 0);
+    for (uint32_t l = 1; l <= k; l++) {
+        for (uint32_t v = 0; v < (1U << l); v++) {
+            uint32_t parent               = this->offsets_[(1U << (l - 1)) + (v & ((1U << (l - 1)) - 1))];
+            this->offsets_[(1U << l) + v] = lf((v >> (l - 1)) & 1, parent);
+        }
+    }
+    KStepTableBytesGauge().Set(this->GetByteSize());
+    return true;
+}
+
+uint32_t KmerTable::GetKmerSize() const {
+    return this->kmer_size_;
+}
+
+uint32_t KmerTable::GetZeroCount() const {
+    return this->zero_count_;
+}
+
+uint32_t KmerTable::GetOffset(const uint32_t length, const uint32_t kmer) const {
+    return this->offsets_[(1U << length) + kmer];
+}
+
+void KmerTable::Ranks(const uint32_t *outputs, const uint32_t bitsize, std::vector<uint32_t> &ranks) const {
+    uint32_t k = this->kmer_size_;
+    ranks.assign(2U << k, 0);
+
+    // One pass over the rows for the 2^k columns (the sums wrap around 2^32, a multiple of 2^bitsize)
+    uint32_t *leaves = ranks.data() + (1U << k);
+    for (size_t j = 0; j < this->labels_.size(); j++) {
+        leaves[this->labels_[j]] += outputs[j];
+    }
+    for (const auto &[row, length] : this->short_rows_) {
+        leaves[this->labels_[row]] -= outputs[row];
+    }
+
+    // The column of a prefix is the sum of the columns of its extensions, plus the short rows of that length or more
+    SumPrefixes(ranks, k);
+    for (const auto &[row, length] : this->short_rows_) {
+        for (uint32_t l = 1; l <= length; l++) {
+            ranks[(1U << l) + (this->labels_[row] & ((1U << l) - 1))] += outputs[row];
+        }
+    }
+    for (auto &rank : ranks) {
+        rank = utils::Mod(rank, bitsize);
+    }
+}
+
+uint64_t KmerTable::GetByteSize() const {
+    return this->labels_.size() * sizeof(uint8_t) + this->short_rows_.size() * sizeof(std::pair<uint32_t, uint32_t>) + this->offsets_.size() * sizeof(uint32_t);
+}
+
+KStepFmiParameters::KStepFmiParameters(const uint32_t t, const uint32_t q, const uint32_t k, const DebugInfo &dbg_info)
+    : fmi_params(t, q, dbg_info), kmer_size(k), step_num((k == 0) ? 0 : (utils::Pow(2, q) - 1 + k - 1) / k), select_params(dpf::DpfParameters(std::max(k, kMinSelectBitsize), t, dbg_info)), debug(dbg_info.fmi_debug) {
+}
+
+void KStepFmiKey::PrintKStepFmiKey(const KStepFmiParameters &params, const bool debug) const {
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("KStepFmi key"), debug);
+    for (uint32_t i = 0; i < this->step_num; i++) {
+        this->rank_keys_f[i].PrintFssRankKey(params.fmi_params.rank_params, debug);
+        this->rank_keys_g[i].PrintFssRankKey(params.fmi_params.rank_params, debug);
+        this->select_keys[i].dpf_key.PrintDpfKey(params.select_params, debug);
+        utils::Logger::TraceLog(LOCATION, "Share(r_in) of the k-mer: " + std::to_string(this->select_keys[i].shr_in), debug);
+    }
+    for (const auto &zt_key : this->zt_keys) {
+        zt_key.PrintZeroTestKey(params.fmi_params.zt_params, debug);
+    }
+    utils::Logger::TraceLog(LOCATION, utils::kDash, debug);
+#endif
+}
+
+void KStepFmiKey::FreeKStepFmiKey() {
+    for (uint32_t i = 0; i < this->step_num; i++) {
+        this->rank_keys_f[i].FreeFssRankKey();
+        this->rank_keys_g[i].FreeFssRankKey();
+        this->select_keys[i].dpf_key.FreeDpfKey();
+    }
+    for (auto &zt_key : this->zt_keys) {
+        zt_key.FreeZeroTestKey();
+    }
+}
+
+KStepFmi::KStepFmi(const KStepFmiParameters params)
+    : params_(params), rank_(params.fmi_params.rank_params), select_dpf_(params.select_params), zt_(params.fmi_params.zt_params), ct_used_(false) {
+    if (params.kmer_size == 0 || params.kmer_size > kMaxKmerSize || params.kmer_size > params.fmi_params.text_bitsize) {
+        utils::Logger::FatalLog(LOCATION, "The k-mer size must be 1 to " + std::to_string(kMaxKmerSize) + " and at most the text bitsize (" + std::to_string(params.kmer_size) + ")");
+        exit(EXIT_FAILURE);
+    }
+}
+
+uint32_t KStepFmi::GetStepLength(const uint32_t step) const {
+    uint32_t k  = this->params_.kmer_size;
+    uint32_t qs = this->params_.fmi_params.query_size;
+    return std::min(k, qs - 1 - step * k);
+}
+
+std::vector<uint32_t> KStepFmi::GetCorrelatedTripleFanOuts() const {
+    // The g - f of the shorter prefixes, then f and g of the whole step
+    std::vector<uint32_t> fan_outs;
+    for (uint32_t s = 0; s < this->params_.step_num; s++) {
+        uint32_t m = this->GetStepLength(s);
+        fan_outs.insert(fan_outs.end(), (1U << m) - 2, 1);
+        fan_outs.insert(fan_outs.end(), 1U << m, 2);
+    }
+    return fan_outs;
+}
+
+std::pair<KStepFmiKey, KStepFmiKey> KStepFmi::GenerateKeys() const {
+    uint32_t t     = this->params_.fmi_params.text_bitsize;
+    uint32_t k     = this->params_.kmer_size;
+    uint32_t qs    = this->params_.fmi_params.query_size;
+    uint32_t steps = this->params_.step_num;
+#ifdef LOG_LEVEL_TRACE
+    bool debug = this->params_.debug;
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Generate KStepFmi keys"), debug);
+    utils::Logger::TraceLog(LOCATION, "(text size, query size, k) = (" + std::to_string(t) + ", " + std::to_string(this->params_.fmi_params.query_bitsize) + ", " + std::to_string(k) + ")", debug);
+#endif
+
+    std::array<KStepFmiKey, 2> kstep_key;
+    for (uint32_t j = 0; j < 2; j++) {
+        kstep_key[j].step_num = steps;
+        kstep_key[j].rank_keys_f.reserve(steps);
+        kstep_key[j].rank_keys_g.reserve(steps);
+        kstep_key[j].select_keys.reserve(steps);
+        kstep_key[j].zt_keys.reserve(qs);
+    }
+    for (uint32_t i = 0; i < steps; i++) {
+        std::pair<rank::FssRankKey, rank::FssRankKey> rank_key_f = this->rank_.GenerateKeys();
+        std::pair<rank::FssRankKey, rank::FssRankKey> rank_key_g = this->rank_.GenerateKeys();
+        kstep_key[0].rank_keys_f.push_back(std::move(rank_key_f.first));
+        kstep_key[1].rank_keys_f.push_back(std::move(rank_key_f.second));
+        kstep_key[0].rank_keys_g.push_back(std::move(rank_key_g.first));
+        kstep_key[1].rank_keys_g.push_back(std::move(rank_key_g.second));
+
+        // The opened k-mer is w + r_in mod 2^t, whose lower k bits select the DPF output at r_in mod 2^k
+        uint32_t                            r_in = utils::Mod(tools::rng::SecureRng().Rand64(), t);
+        std::pair<dpf::DpfKey, dpf::DpfKey> keys = this->select_dpf_.GenerateKeys(utils::Mod(r_in, k), 1);
+        std::array<KmerSelectKey, 2>        select_key;
+        select_key[0].dpf_key = std::move(keys.first);
+        select_key[1].dpf_key = std::move(keys.second);
+        select_key[0].shr_in  = utils::Mod(tools::rng::SecureRng().Rand64(), t);
+        select_key[1].shr_in  = utils::Mod(r_in - select_key[0].shr_in, t);
+        kstep_key[0].select_keys.push_back(std::move(select_key[0]));
+        kstep_key[1].select_keys.push_back(std::move(select_key[1]));
+    }
+    for (uint32_t i = 0; i < qs; i++) {
+        std::pair<zt::ZeroTestKey, zt::ZeroTestKey> zt_key = this->zt_.GenerateKeys();
+        kstep_key[0].zt_keys.push_back(std::move(zt_key.first));
+        kstep_key[1].zt_keys.push_back(std::move(zt_key.second));
+    }
+
+#ifdef LOG_LEVEL_TRACE
+    utils::AddNewLine(debug);
+    kstep_key[0].PrintKStepFmiKey(this->params_, debug);
+    utils::AddNewLine(debug);
+    kstep_key[1].PrintKStepFmiKey(this->params_, debug);
+    utils::AddNewLine(debug);
+#endif
+
+    return std::make_pair(std::move(kstep_key[0]), std::move(kstep_key[1]));
+}
+
+std::pair<KStepFmiKey, KStepFmiKey> KStepFmi::GenerateKeys(const Block &seed, const uint64_t key_index) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateKeys();
+}
+
+void KStepFmi::SetCorrelatedTriple(const tools::secret_sharing::cts_t &ct) {
+    this->ct_      = ct;
+    this->ct_used_ = false;
+}
+
+void KStepFmi::SetSentence(const std::string &sentence) {
+    if (!this->table_.Build(sentence, this->params_.kmer_size)) {
+        utils::Logger::FatalLog(LOCATION, "Failed to build the k-mer tables");
+        exit(EXIT_FAILURE);
+    }
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "cf1: " + std::to_string(this->table_.GetZeroCount()) + ", tables: " + std::to_string(this->table_.GetByteSize()) + " bytes", this->params_.debug);
+#endif
+}
+
+uint64_t KStepFmi::GetTableByteSize() const {
+    return this->table_.GetByteSize();
+}
+
+void KStepFmi::Evaluate(tools::secret_sharing::Party &party, const KStepFmiKey &kstep_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &output) const {
+    uint32_t                                     t   = this->params_.fmi_params.text_bitsize;
+    uint32_t                                     ts  = this->params_.fmi_params.text_size;
+    uint32_t                                     qs  = this->params_.fmi_params.query_size;
+    uint32_t                                     k   = this->params_.kmer_size;
+    uint32_t                                     id  = party.GetId();
+    uint32_t                                     cf1 = this->table_.GetZeroCount();
+    tools::secret_sharing::AdditiveSecretSharing ss(t);
+    utils::HistogramTimer                        latency(KStepQueryLatency());
+    KStepQueryCounter().Increment();
+    if (this->ct_.size() < this->GetCorrelatedTripleFanOuts().size()) {
+        utils::Logger::FatalLog(LOCATION, "Not enough correlated triples (" + std::to_string(this->ct_.size()) + " < " + std::to_string(this->GetCorrelatedTripleFanOuts().size()) + ")");
+        exit(EXIT_FAILURE);
+    }
+    if (this->ct_used_) {
+        utils::Logger::FatalLog(LOCATION, "The correlated triples have been used by another query (set fresh ones for every query)");
+        exit(EXIT_FAILURE);
+    }
+    this->ct_used_ = true;
+#ifdef LOG_LEVEL_TRACE
+    const bool debug = this->params_.debug;
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Evaluate KStepFmi"), debug);
+    utils::Logger::TraceLog(LOCATION, "(text size, query size, k): (" + std::to_string(ts) + ", " + std::to_string(qs) + ", " + std::to_string(k) + ")", debug);
+#endif
+
+    // Calculate f_1, g_1 (same as FssFmi)
+    std::vector<uint32_t> intersh(qs);
+    uint32_t              fsh = utils::Mod(cf1 * q[0] + id, t);
+    uint32_t              gsh = utils::Mod((ts - 1 - cf1) * q[0] + (cf1 + 1) * id, t);
+    intersh[0]                = utils::Mod(gsh - fsh, t);
+
+    utils::HugeVector<uint32_t> outputs_f(ts), outputs_g(ts);
+    std::vector<uint32_t>       ranks_f, ranks_g, onehot(2U << k), select_out(1U << this->params_.select_params.input_bitsize);
+    uint32_t                    i = 1, ct_pos = 0;
+    for (uint32_t s = 0; s < this->params_.step_num; s++) {
+        const rank::FssRankKey &rank_key_f = kstep_key.rank_keys_f[s];
+        const rank::FssRankKey &rank_key_g = kstep_key.rank_keys_g[s];
+        const KmerSelectKey    &select_key = kstep_key.select_keys[s];
+        uint32_t                m          = this->GetStepLength(s);
+
+        // Reconst f - r_in, g - r_in and the k-mer w + r_in
+        uint32_t wsh = 0;
+        for (uint32_t b = 0; b < m; b++) {
+            wsh += q[i + b] << b;
+        }
+        std::vector<uint32_t> x_0(3), x_1(3), x(3);
+        std::vector<uint32_t> &x_own = (id == 0) ? x_0 : x_1;
+        x_own                        = {utils::Mod(fsh - rank_key_f.shr_in, t), utils::Mod(gsh - rank_key_g.shr_in, t), utils::Mod(wsh + select_key.shr_in, t)};
+        ss.Reconst(party, x_0, x_1, x);    // * ROUND: 1
+
+        // Ranks of all k-mers at f and g
+        this->rank_.EvaluateOutputs(rank_key_f, x[0], outputs_f);
+        this->rank_.EvaluateOutputs(rank_key_g, x[1], outputs_g);
+        this->table_.Ranks(outputs_f.data(), t, ranks_f);
+        this->table_.Ranks(outputs_g.data(), t, ranks_g);
+
+        // One-hot vector of w (and of its prefixes)
+        this->select_dpf_.EvaluateFullDomain(select_key.dpf_key, select_out);
+        uint32_t masked = utils::Mod(x[2], k);
+        for (uint32_t v = 0; v < (1U << k); v++) {
+            onehot[(1U << k) + v] = select_out[utils::Mod(masked - v, k)];
+        }
+        SumPrefixes(onehot, k);
+
+        // Select the ranks of w: g - f of the shorter prefixes, then f and g (+ C_w) by the same bit of w
+        uint32_t              ct_num = 2 * (1U << m) - 2;
+        std::vector<uint32_t> xv, yv, zv;
+        xv.reserve(ct_num);
+        yv.reserve(3 * (1U << m) - 2);
+        for (uint32_t l = 1; l < m; l++) {
+            for (uint32_t v = 0; v < (1U << l); v++) {
+                xv.push_back(utils::Mod(onehot[(1U << l) + v], t));
+                yv.push_back(utils::Mod(ranks_g[(1U << l) + v] - ranks_f[(1U << l) + v], t));
+            }
+        }
+        for (uint32_t v = 0; v < (1U << m); v++) {
+            xv.push_back(utils::Mod(onehot[(1U << m) + v], t));
+            yv.push_back(utils::Mod(ranks_f[(1U << m) + v] + this->table_.GetOffset(m, v) * id, t));
+            yv.push_back(utils::Mod(ranks_g[(1U << m) + v] + this->table_.GetOffset(m, v) * id, t));
+        }
+        tools::secret_sharing::cts_t ct(this->ct_.begin() + ct_pos, this->ct_.begin() + ct_pos + ct_num);
+        ss.MultMany(party, ct, xv, yv, zv);    // * ROUND: 2
+        ct_pos += ct_num;
+
+        // Sum the products of each prefix
+        uint32_t pos = 0;
+        for (uint32_t l = 1; l < m; l++) {
+            uint32_t sum = 0;
+            for (uint32_t v = 0; v < (1U << l); v++) {
+                sum += zv[pos++];
+            }
+            intersh[i + l - 1] = utils::Mod(sum, t);
+        }
+        fsh = 0;
+        gsh = 0;
+        for (uint32_t v = 0; v < (1U << m); v++) {
+            fsh += zv[pos + 2 * v];
+            gsh += zv[pos + 2 * v + 1];
+        }
+        fsh                = utils::Mod(fsh, t);
+        gsh                = utils::Mod(gsh, t);
+        intersh[i + m - 1] = utils::Mod(gsh - fsh, t);
+#ifdef LOG_LEVEL_TRACE
+        uint32_t f = ss.Reconst(party, (id == 0) ? fsh : 0, (id == 1) ? fsh : 0);
+        uint32_t g = ss.Reconst(party, (id == 0) ? gsh : 0, (id == 1) ? gsh : 0);
+        utils::Logger::TraceLog(LOCATION, "f_" + std::to_string(i + m) + ": " + std::to_string(f) + ", g_" + std::to_string(i + m) + ": " + std::to_string(g), debug);
+#endif
+        i += m;
+    }
+
+    // Equality check of f, g
+    std::vector<uint32_t> xsh_0(qs), xsh_1(qs), xr(qs);
+    for (uint32_t j = 0; j < qs; j++) {
+        ((id == 0) ? xsh_0 : xsh_1)[j] = utils::Mod(intersh[j] + kstep_key.zt_keys[j].shr_in, t);
+    }
+    ss.Reconst(party, xsh_0, xsh_1, xr);    // * ROUND: 3
+    for (uint32_t j = 0; j < qs; j++) {
+        output[j] = this->zt_.EvaluateAt(kstep_key.zt_keys[j], xr[j]);
+    }
+}
+
+}    // namespace fmi
+}    // namespace fss
@@ -0,0 +1,316 @@
+/**
+ * @file kstep_fmi.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-30
+ * @copyright Copyright (c) 2024
+ * @brief KStepFmi class (backward search advancing k symbols per step).
+ */
+
+#ifndef FM_INDEX_KSTEP_FMI_H_
+#define FM_INDEX_KSTEP_FMI_H_
+
+#include <string_view>
+
+#include "fss_fmi.hpp"
+
+namespace fss {
+namespace fmi {
+
+constexpr uint32_t kMaxKmerSize      = 8;    // The k-mer labels are stored in one byte per row
+constexpr uint32_t kMinSelectBitsize = 2;    // The full-domain evaluation of the DPF needs at least 4 leaves
+
+/**
+ * @class KmerTable
+ * @brief The occurrence tables of all 2^k k-mers of a BWT, stored as one k-mer label per row.
+ *
+ * The label of row j is the string of the (at most k) characters read by the LF mapping from row j,
+ * i.e. the characters preceding the suffix of the row, first one in the least significant bit.
+ * Since the LF mapping keeps the order of the rows with the same character, the composition of the LF mappings of
+ * the k-mer w = c_1 ... c_k is LF_w(p) = C_w + rank_w(p), where rank_w(p) counts the rows j < p labeled w
+ * and C_w = LF_w(0). The column of w is the indicator of the rows labeled w, so the 2^k columns (and those of the
+ * shorter prefixes) take N bytes in total. Rows with fewer than k preceding characters (the first suffixes of the text
+ * and the '$' row) are kept aside with their length.
+ */
+class KmerTable {
+public:
+    /**
+     * @brief Default constructor for KmerTable (empty).
+     */
+    KmerTable();
+
+    /**
+     * @brief Build the labels and the offsets C_w of the BWT.
+     * @param bwt The BWT of '0', '1' and one '$'.
+     * @param k The length of the k-mers (1 to kMaxKmerSize).
+     * @return `true` if the tables are built.
+     */
+    bool Build(const std::string_view bwt, const uint32_t k);
+
+    /**
+     * @brief Retrieves the length of the k-mers.
+     * @return The length of the k-mers.
+     */
+    uint32_t GetKmerSize() const;
+
+    /**
+     * @brief Retrieves the number of '0' in the BWT.
+     * @return The number of '0'.
+     */
+    uint32_t GetZeroCount() const;
+
+    /**
+     * @brief Retrieves C_w of a prefix (LF_w(0)).
+     * @param length The length of the prefix (1 to k).
+     * @param kmer The prefix (first character in the least significant bit).
+     * @return C_w.
+     */
+    uint32_t GetOffset(const uint32_t length, const uint32_t kmer) const;
+
+    /**
+     * @brief Compute the inner products of the outputs with the columns of every prefix of length 1 to k.
+     * @param outputs The shares of the rows (size: at least the length of the BWT).
+     * @param bitsize The bitsize of the shares.
+     * @param ranks The shares of rank_w: ranks[2^length + kmer] (size: 2^(k + 1)).
+     */
+    void Ranks(const uint32_t *outputs, const uint32_t bitsize, std::vector<uint32_t> &ranks) const;
+
+    /**
+     * @brief Retrieves the resident bytes of the tables.
+     * @return The number of bytes.
+     */
+    uint64_t GetByteSize() const;
+
+private:
+    uint32_t                                   kmer_size_;  /**< The length of the k-mers. */
+    uint32_t                                   zero_count_; /**< The number of '0' in the BWT. */
+    utils::HugeVector<uint8_t>                 labels_;     /**< The k-mer label of each row (lower bits only for the short rows). */
+    std::vector<std::pair<uint32_t, uint32_t>> short_rows_; /**< The rows with fewer than k preceding characters and their length. */
+    std::vector<uint32_t>                      offsets_;    /**< C_w of every prefix: offsets_[2^length + kmer]. */
+};
+
+struct KStepFmiParameters {
+    const FssFmiParameters   fmi_params;    /**< The parameters for FssFmi (text, query, FssRank and ZeroTest). */
+    const uint32_t           kmer_size;     /**< The number of query bits consumed per step (k). */
+    const uint32_t           step_num;      /**< The number of steps after the first symbol (ceil((query size - 1) / k)). */
+    const dpf::DpfParameters select_params; /**< The parameters for the DPF selecting the k-mer (domain 2^max(k, kMinSelectBitsize)). */
+    const bool               debug;         /**< Debug utils::Mode flag. */
+
+    /**
+     * @brief Parameterized constructor for KStepFmiParameters.
+     * @param t The size of the text in bits.
+     * @param q The size of the query in bits.
+     * @param k The number of query bits consumed per step (1 to kMaxKmerSize).
+     * @param dbg_info Debug information.
+     */
+    KStepFmiParameters(const uint32_t t, const uint32_t q, const uint32_t k, const DebugInfo &dbg_info);
+};
+
+/**
+ * @struct KmerSelectKey
+ * @brief A key of the selection gate (a DPF over the 2^k k-mers at the mask of the k-mer).
+ */
+struct KmerSelectKey {
+    dpf::DpfKey dpf_key; /**< The DPF key (alpha: r_in mod 2^k, beta: 1). */
+    uint32_t    shr_in;  /**< Share of r_in. */
+
+    /**
+     * @brief Default constructor for KmerSelectKey.
+     */
+    KmerSelectKey()
+        : shr_in(0){};
+
+    /**
+     * @brief Copy constructor (deleted).
+     */
+    KmerSelectKey(const KmerSelectKey &) = delete;
+
+    /**
+     * @brief Copy assignment operator (deleted).
+     */
+    KmerSelectKey &operator=(const KmerSelectKey &) = delete;
+
+    /**
+     * @brief Move constructor (default).
+     */
+    KmerSelectKey(KmerSelectKey &&) noexcept = default;
+
+    /**
+     * @brief Move assignment operator (default).
+     */
+    KmerSelectKey &operator=(KmerSelectKey &&) noexcept = default;
+
+    bool operator==(const KmerSelectKey &rhs) const {
+        return this->dpf_key == rhs.dpf_key && this->shr_in == rhs.shr_in;
+    }
+
+    bool operator!=(const KmerSelectKey &rhs) const {
+        return !(*this == rhs);
+    }
+};
+
+/**
+ * @struct KStepFmiKey
+ * @brief A key for KStepFmi (one FssRank key for f and g and one selection key per step, one ZeroTest key per prefix).
+ */
+struct KStepFmiKey {
+    uint32_t                      step_num;    /**< The number of steps. */
+    std::vector<rank::FssRankKey> rank_keys_f; /**< The FssRank keys for f. */
+    std::vector<rank::FssRankKey> rank_keys_g; /**< The FssRank keys for g. */
+    std::vector<KmerSelectKey>    select_keys; /**< The keys of the selection gate. */
+    std::vector<zt::ZeroTestKey>  zt_keys;     /**< The ZeroTest keys (one per prefix length). */
+
+    /**
+     * @brief Default constructor for KStepFmiKey.
+     */
+    KStepFmiKey()
+        : step_num(0){};
+
+    /**
+     * @brief Copy constructor (deleted).
+     */
+    KStepFmiKey(const KStepFmiKey &) = delete;
+
+    /**
+     * @brief Copy assignment operator (deleted).
+     */
+    KStepFmiKey &operator=(const KStepFmiKey &) = delete;
+
+    /**
+     * @brief Move constructor (default).
+     */
+    KStepFmiKey(KStepFmiKey &&) noexcept = default;
+
+    /**
+     * @brief Move assignment operator (default).
+     */
+    KStepFmiKey &operator=(KStepFmiKey &&) noexcept = default;
+
+    bool operator==(const KStepFmiKey &rhs) const {
+        return this->rank_keys_f == rhs.rank_keys_f && this->rank_keys_g == rhs.rank_keys_g && this->select_keys == rhs.select_keys && this->zt_keys == rhs.zt_keys;
+    }
+
+    bool operator!=(const KStepFmiKey &rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Print the details of the KStepFmiKey.
+     * @param params The parameters for KStepFmi.
+     * @param debug Debug utils::Mode flag.
+     */
+    void PrintKStepFmiKey(const KStepFmiParameters &params, const bool debug) const;
+
+    /**
+     * @brief Free the resources associated with the KStepFmiKey.
+     */
+    void FreeKStepFmiKey();
+};
+
+/**
+ * @class KStepFmi
+ * @brief FssFmi::Evaluate advancing the interval by k query bits per step.
+ *
+ * Each step opens (f - r_in, g - r_in) and the masked k-mer of the query (w + r_in) in one round. Each party
+ * computes the ranks of all 2^k k-mers (and their prefixes) from the two FssRank outputs with KmerTable, and the
+ * selection DPF gives the shares of the one-hot vector of w. A second round multiplies the one-hot vectors with the
+ * ranks (correlated triples), which gives f and g after k symbols and g - f of the k - 1 intermediate prefixes.
+ * The outputs are the same as FssFmi::Evaluate with 2 * ceil((query size - 1) / k) + 1 rounds instead of
+ * 2 * (query size - 1) + 1. A bit of the one-hot vector of w multiplies both f and g with one opened difference,
+ * so a step opens 5 * 2^k - 4 values for 2 * 2^k - 2 correlated triples.
+ */
+class KStepFmi {
+public:
+    /**
+     * @brief Constructor for KStepFmi.
+     * @param params The parameters for KStepFmi.
+     */
+    KStepFmi(const KStepFmiParameters params);
+
+    /**
+     * @brief Generate a pair of KStepFmiKey.
+     * @return A pair of KStepFmiKey.
+     */
+    std::pair<KStepFmiKey, KStepFmiKey> GenerateKeys() const;
+
+    /**
+     * @brief Generate a pair of KStepFmiKey from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<KStepFmiKey, KStepFmiKey> GenerateKeys(const Block &seed, const uint64_t key_index) const;
+
+    /**
+     * @brief Retrieves the fan-outs of the correlated triples used by a query.
+     *
+     * Each bit of the one-hot vector of a shorter prefix multiplies g - f (fan-out 1), and each bit of the
+     * one-hot vector of the whole step multiplies both f and g (fan-out 2).
+     *
+     * @return The fan-out of each correlated triple.
+     */
+    std::vector<uint32_t> GetCorrelatedTripleFanOuts() const;
+
+    /**
+     * @brief Set the shares of the correlated triples of the selections.
+     * @param ct The shares (fan-outs: GetCorrelatedTripleFanOuts()), used by the next Evaluate only.
+     */
+    void SetCorrelatedTriple(const tools::secret_sharing::cts_t &ct);
+
+    /**
+     * @brief Set the BWT and build its k-mer tables.
+     * @param sentence The BWT.
+     */
+    void SetSentence(const std::string &sentence);
+
+    /**
+     * @brief Retrieves the resident bytes of the k-mer tables.
+     * @return The number of bytes.
+     */
+    uint64_t GetTableByteSize() const;
+
+    /**
+     * @brief Evaluate the ZeroTest of the occurrence count of every prefix of the query (same outputs as FssFmi::Evaluate).
+     *
+     * The key and the correlated triples are single-use: every query needs a fresh key and a fresh SetCorrelatedTriple
+     * (reusing the triples would open two differences against the same triple).
+     *
+     * @param party The party object.
+     * @param kstep_key The KStepFmiKey of this party.
+     * @param q The share of the query.
+     * @param output The shares of the ZeroTest results (size: query size).
+     */
+    void Evaluate(tools::secret_sharing::Party &party, const KStepFmiKey &kstep_key, const std::vector<uint32_t> &q, std::vector<uint32_t> &output) const;
+
+private:
+    const KStepFmiParameters            params_;     /**< The parameters for KStepFmi. */
+    const rank::FssRank                 rank_;       /**< The FssRank object. */
+    const dpf::DistributedPointFunction select_dpf_; /**< The DPF of the selection gate. */
+    const zt::ZeroTest                  zt_;         /**< The ZeroTest object. */
+    KmerTable                           table_;      /**< The k-mer tables of the BWT. */
+    tools::secret_sharing::cts_t        ct_;         /**< The correlated triples of the selections. */
+    mutable bool                        ct_used_;    /**< Whether ct_ has been used by Evaluate. */
+
+    /**
+     * @brief Retrieves the number of query bits consumed by a step.
+     * @param step The step (0 to step_num - 1).
+     * @return The number of query bits (k, or less for the last step).
+     */
+    uint32_t GetStepLength(const uint32_t step) const;
+};
+
+namespace test {
+
+void Test_KStepFmi(tools::secret_sharing::Party &party, TestInfo &test_info);
+
+}    // namespace test
+
+namespace bench {
+
+void Bench_KStepFmi(tools::secret_sharing::Party &party, const BenchInfo &bench_info);
+
+}    // namespace bench
+
+}    // namespace fmi
+}    // namespace fss
+
+#endif    // FM_INDEX_KSTEP_FMI_H_
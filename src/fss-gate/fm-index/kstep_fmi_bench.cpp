@@ -0,0 +1,186 @@
+/**
+ * @file kstep_fmi_bench.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-30
+ * @copyright Copyright (c) 2024
+ * @brief KStepFmi benchmark implementation.
+ */
+
+#include "kstep_fmi.hpp"
+
+#include <algorithm>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/file_io.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/memory.hpp"
+#include "../../utils/timer.hpp"
+#include "../../utils/utils.hpp"
+#include "../internal/fsskey_io.hpp"
+#include "bwt_index.hpp"
+
+namespace {
+
+const std::string kCurrentPath       = utils::GetCurrentDirectory();
+const std::string kBenchKStepPath    = kCurrentPath + "/data/bench/kstep/";
+const std::string kKStepCTPath_P0    = kBenchKStepPath + "ct_p0";
+const std::string kKStepCTPath_P1    = kBenchKStepPath + "ct_p1";
+const std::string kKStepKeyPath_P0   = kBenchKStepPath + "key_p0";
+const std::string kKStepKeyPath_P1   = kBenchKStepPath + "key_p1";
+const std::string kKStepIndexPath    = kBenchKStepPath + "index";
+const std::string kKStepQueryPath_P0 = kBenchKStepPath + "query_p0";
+const std::string kKStepQueryPath_P1 = kBenchKStepPath + "query_p1";
+
+using cts_t = tools::secret_sharing::cts_t;
+
+const std::vector<uint32_t> kBenchSteps = {1, 2, 4, 8};    // The number of query bits per step (k)
+
+void GenerateRandomNumbers(std::vector<uint32_t> &vec, const uint32_t bitsize) {
+    // Generate random vector
+    for (size_t i = 0; i < vec.size(); i++) {
+        vec[i] = utils::Mod(tools::rng::SecureRng::Rand64(), bitsize);
+    }
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+namespace bench {
+
+void Bench_KStepFmi(tools::secret_sharing::Party &party, const BenchInfo &bench_info) {
+    // Define utilities
+    utils::ExecutionTimer               timer_all, timer_1, timer_2;
+    utils::MemoryMonitor                mem_1, mem_2;
+    utils::FileIo                       io;
+    tools::secret_sharing::ShareHandler sh;
+    internal::FssKeyIo                  key_io;
+
+    std::vector<std::string> modes         = {"Measurement of share generation", "Measurement of k-step FssFMI key", "Measurement of execute Eval^{k-step FssFMI}"};
+    uint32_t                 selected_mode = bench_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    for (const auto t : bench_info.text_size) {
+        for (const auto q : bench_info.query_size) {
+            for (uint32_t i = 0; i < bench_info.experiment_num; i++) {
+                FssFmiParameters                             fmi_params(t, q, bench_info.dbg_info);
+                uint32_t                                     ts = fmi_params.text_size;
+                uint32_t                                     qs = fmi_params.query_size;
+                tools::secret_sharing::AdditiveSecretSharing ss(t);
+                utils::Logger::InfoLog(LOCATION, "k-step FssFMI: (text size, query size) = (" + std::to_string(t) + ", " + std::to_string(q) + ")");
+
+                // Measure total time
+                std::string mode_str     = "[" + modes[selected_mode - 1] + "],";
+                std::string measure_info = "Info,Text size,Query size,k,Time";
+                utils::Logger::InfoLog(LOCATION, mode_str + measure_info);
+                std::string file_option = "_t" + std::to_string(t) + "_q" + std::to_string(q);
+                timer_all.Start();
+                // ############# START #############
+
+                if (selected_mode == 1) {
+                    // Generate data and query shares
+                    measure_info = "," + std::to_string(t) + "," + std::to_string(q);
+                    mem_1.Start();
+                    timer_1.Start();
+                    std::vector<uint32_t> pub_db(ts - 1), query(qs);
+                    GenerateRandomNumbers(pub_db, 1);
+                    GenerateRandomNumbers(query, 1);
+                    std::reverse(pub_db.begin(), pub_db.end());    // To find LPM, we need to reverse the text
+                    BwtIndex index;
+                    if (!BuildBwtIndex(utils::VectorToStr(pub_db, ""), kDefaultSaSampleRate, index)) {
+                        exit(EXIT_FAILURE);
+                    }
+                    WriteBwtIndexToFile(kKStepIndexPath + "_t" + std::to_string(t), index);
+                    std::pair<std::vector<uint32_t>, std::vector<uint32_t>> q_sh = ss.Share(query);
+                    sh.ExportShare(kKStepQueryPath_P0 + file_option, kKStepQueryPath_P1 + file_option, q_sh);
+                    timer_1.Print(LOCATION, mode_str + "Generate data" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Generate data" + measure_info);
+
+                } else if (selected_mode == 2) {
+                    timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
+                    for (const auto k : kBenchSteps) {
+                        KStepFmiParameters params(t, q, k, bench_info.dbg_info);
+                        KStepFmi           kstep(params);
+                        std::string        k_option = file_option + "_k" + std::to_string(k);
+                        measure_info                = "," + std::to_string(t) + "," + std::to_string(q) + "," + std::to_string(k);
+
+                        // Generate shares of correlated triples and the keys
+                        mem_1.Start();
+                        timer_1.Start();
+                        cts_t ct;
+                        ss.GenerateCorrelatedTriples(kstep.GetCorrelatedTripleFanOuts(), ct);
+                        std::pair<cts_t, cts_t> ct_sh = ss.ShareCorrelatedTriples(ct);
+                        sh.ExportCTShare(kKStepCTPath_P0 + k_option, kKStepCTPath_P1 + k_option, ct_sh);
+                        std::pair<KStepFmiKey, KStepFmiKey> kstep_keys = kstep.GenerateKeys();
+                        key_io.WriteKStepFmiKeyToFile(kKStepKeyPath_P0 + k_option, kstep_keys.first);
+                        key_io.WriteKStepFmiKeyToFile(kKStepKeyPath_P1 + k_option, kstep_keys.second);
+                        timer_1.Print(LOCATION, mode_str + "Generate k-step FssFMI key" + measure_info);
+                        mem_1.Print(LOCATION, mode_str + "Generate k-step FssFMI key" + measure_info);
+                        utils::Logger::InfoLog(LOCATION, mode_str + "Correlated triples" + measure_info + "," + std::to_string(ct.size()));
+                        kstep_keys.first.FreeKStepFmiKey();
+                        kstep_keys.second.FreeKStepFmiKey();
+                    }
+
+                } else if (selected_mode == 3) {
+                    // Start communication
+                    party.StartCommunication();
+
+                    BwtIndex index;
+                    if (!ReadBwtIndexFromFile(kKStepIndexPath + "_t" + std::to_string(t), index)) {
+                        exit(EXIT_FAILURE);
+                    }
+                    std::string           bwt = index.ToString();
+                    std::vector<uint32_t> q_sh(qs);
+                    sh.LoadShare(((party.GetId() == 0) ? kKStepQueryPath_P0 : kKStepQueryPath_P1) + file_option, q_sh);
+
+                    for (const auto k : kBenchSteps) {
+                        KStepFmiParameters params(t, q, k, bench_info.dbg_info);
+                        KStepFmi           kstep(params);
+                        std::string        k_option = file_option + "_k" + std::to_string(k);
+                        measure_info                = "," + std::to_string(t) + "," + std::to_string(q) + "," + std::to_string(k);
+
+                        // Build the k-mer tables (memory) and set the keys
+                        mem_1.Start();
+                        timer_1.Start();
+                        kstep.SetSentence(bwt);
+                        timer_1.Print(LOCATION, mode_str + "Build k-mer tables" + measure_info);
+                        mem_1.Print(LOCATION, mode_str + "Build k-mer tables" + measure_info);
+                        utils::Logger::InfoLog(LOCATION, mode_str + "Table bytes" + measure_info + "," + std::to_string(kstep.GetTableByteSize()));
+                        cts_t       ct;
+                        KStepFmiKey kstep_key;
+                        sh.LoadCTShare(((party.GetId() == 0) ? kKStepCTPath_P0 : kKStepCTPath_P1) + k_option, ct);
+                        key_io.ReadKStepFmiKeyFromFile(((party.GetId() == 0) ? kKStepKeyPath_P0 : kKStepKeyPath_P1) + k_option, params, kstep_key);
+                        kstep.SetCorrelatedTriple(ct);
+
+                        // Execute Eval^{k-step FssFMI} algorithm (the compute and the rounds)
+                        uint64_t bytes_before = party.GetTotalBytesSent();
+                        mem_2.Start();
+                        timer_2.Start();
+                        std::vector<uint32_t> eq(qs), eq_0(qs), eq_1(qs);
+                        kstep.Evaluate(party, kstep_key, q_sh, (party.GetId() == 0) ? eq_0 : eq_1);
+                        ss.Reconst(party, eq_0, eq_1, eq);
+                        timer_2.Print(LOCATION, mode_str + "Execute Eval^{k-step FssFMI}" + measure_info);
+                        mem_2.Print(LOCATION, mode_str + "Execute Eval^{k-step FssFMI}" + measure_info);
+                        utils::Logger::InfoLog(LOCATION, mode_str + "Rounds,Bytes sent" + measure_info + "," + std::to_string(2 * params.step_num + 1) + "," + std::to_string(party.GetTotalBytesSent() - bytes_before));
+                        kstep_key.FreeKStepFmiKey();
+                    }
+                    party.OutputTotalBytesSent(measure_info);
+                }
+
+                // ############# END #############
+                double timer_res = timer_all.Print(LOCATION, mode_str + "Bench Total time" + measure_info);
+                if (utils::ExecutionTimer::IsExceedLimitTime(timer_res, bench_info.limit_time_ms, timer_all.GetTimeUnit())) {
+                    utils::Logger::InfoLog(LOCATION, "The execution time exceeds the limit time: " + std::to_string(timer_res) + " " + timer_all.GetTimeUnitStr());
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+}
+
+}    // namespace bench
+}    // namespace fmi
+}    // namespace fss
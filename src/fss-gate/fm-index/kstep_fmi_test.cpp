@@ -0,0 +1,280 @@
+/**
+ * @file kstep_fmi_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-30
+ * @copyright Copyright (c) 2024
+ * @brief KStepFmi test implementation.
+ */
+
+#include "kstep_fmi.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/file_io.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+#include "../internal/fsskey_io.hpp"
+#include "bwt_index.hpp"
+
+namespace {
+
+const std::string kCurrentPath       = utils::GetCurrentDirectory();
+const std::string kTestKStepPath     = kCurrentPath + "/data/test/kstep/";
+const std::string kKStepCTPath_P0    = kTestKStepPath + "ct_0_";
+const std::string kKStepCTPath_P1    = kTestKStepPath + "ct_1_";
+const std::string kKStepKeyPath_P0   = kTestKStepPath + "key_0_";
+const std::string kKStepKeyPath_P1   = kTestKStepPath + "key_1_";
+const std::string kKStepDBPath       = kTestKStepPath + "db_";
+const std::string kKStepQueryPath    = kTestKStepPath + "query_";
+const std::string kKStepQueryPath_P0 = kTestKStepPath + "query_0_";
+const std::string kKStepQueryPath_P1 = kTestKStepPath + "query_1_";
+
+using cts_t = tools::secret_sharing::cts_t;
+
+constexpr uint32_t          kQuerySize = 4;
+constexpr uint32_t          kQueryNum  = 2;            // A random query and a query taken from the text
+const std::vector<uint32_t> kSteps     = {1, 3, 4};    // 4 does not divide query size - 1
+
+void GenerateRandomNumbers(std::vector<uint32_t> &vec, const uint32_t bitsize) {
+    // Generate random vector
+    for (size_t i = 0; i < vec.size(); i++) {
+        vec[i] = utils::Mod(tools::rng::SecureRng::Rand64(), bitsize);
+    }
+}
+
+// The occurrence count of every prefix of q in the text
+std::vector<uint32_t> CountPrefixes(const std::string &text, const std::vector<uint32_t> &q) {
+    std::vector<uint32_t> counts(q.size(), 0);
+    for (size_t p = 0; p < text.size(); p++) {
+        for (size_t d = 0; d < q.size() && p + d < text.size() && text[p + d] - '0' == static_cast<int>(q[d]); d++) {
+            counts[d]++;
+        }
+    }
+    return counts;
+}
+
+// The BWT of the reversed text (to find LPM, we need to reverse the text)
+std::string ReversedBwt(const std::string &text) {
+    std::string reversed(text.rbegin(), text.rend());
+    fss::fmi::BwtIndex index;
+    if (!fss::fmi::BuildBwtIndex(reversed, fss::fmi::kDefaultSaSampleRate, index)) {
+        return "";
+    }
+    return index.ToString();
+}
+
+std::string ReadText(utils::FileIo &io, const uint32_t size) {
+    std::vector<uint32_t> pub_db;
+    io.ReadVectorFromFile(kKStepDBPath + std::to_string(size), pub_db);
+    return utils::VectorToStr(pub_db, "");
+}
+
+std::string FileOption(const uint32_t size, const uint32_t k, const uint32_t query) {
+    return std::to_string(size) + "_k" + std::to_string(k) + "_q" + std::to_string(query);
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+namespace test {
+
+bool Test_KmerTable(const TestInfo &test_info);
+bool Test_KStepFmiOffline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_KStepFmiOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+
+void Test_KStepFmi(tools::secret_sharing::Party &party, TestInfo &test_info) {
+    std::vector<std::string> modes         = {"KStepFmi unit tests", "KmerTable", "KStepFmiOffline", "KStepFmiOnline"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        if (party.GetId() == 0) {
+            utils::PrintTestResult("Test_KStepFmiOffline", Test_KStepFmiOffline(party, test_info));
+        } else {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        utils::PrintTestResult("Test_KStepFmiOnline", Test_KStepFmiOnline(party, test_info));
+        utils::PrintTestResult("Test_KmerTable", Test_KmerTable(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_KmerTable", Test_KmerTable(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_KStepFmiOffline", Test_KStepFmiOffline(party, test_info));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_KStepFmiOnline", Test_KStepFmiOnline(party, test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_KmerTable(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        std::vector<uint32_t> pub_db(utils::Pow(2, size) - 1);
+        GenerateRandomNumbers(pub_db, 1);
+        std::string bwt = ReversedBwt(utils::VectorToStr(pub_db, ""));
+        uint32_t    n   = bwt.size();
+
+        // LF_c(p) = C[c] + rank_c(p) on the string
+        std::vector<uint32_t> zeros(n + 1, 0), ones(n + 1, 0);
+        for (uint32_t j = 0; j < n; j++) {
+            zeros[j + 1] = zeros[j] + (bwt[j] == '0');
+            ones[j + 1]  = ones[j] + (bwt[j] == '1');
+        }
+        auto lf = [&](const uint32_t c, const uint32_t p) {
+            return (c == 0) ? 1 + zeros[p] : 1 + zeros[n] + ones[p];
+        };
+
+        for (uint32_t k = 1; k <= kMaxKmerSize; k++) {
+            KmerTable table;
+            result &= table.Build(bwt, k) && table.GetZeroCount() == zeros[n];
+
+            // C_w + rank_w(p) is the composition of the LF mappings of w for every prefix w and position p
+            std::vector<uint32_t> indicator(n), ranks;
+            for (uint32_t p = 0; p <= n; p++) {
+                for (uint32_t j = 0; j < n; j++) {
+                    indicator[j] = (j < p) ? 1 : 0;
+                }
+                table.Ranks(indicator.data(), size + 1, ranks);
+                for (uint32_t l = 1; l <= k; l++) {
+                    for (uint32_t v = 0; v < (1U << l); v++) {
+                        uint32_t expected = p;
+                        for (uint32_t b = 0; b < l; b++) {
+                            expected = lf((v >> b) & 1, expected);
+                        }
+                        result &= table.GetOffset(l, v) + ranks[(1U << l) + v] == expected;
+                    }
+                }
+            }
+            utils::Logger::DebugLog(LOCATION, "Size: " + std::to_string(size) + ", k: " + std::to_string(k) + ", tables: " + std::to_string(table.GetByteSize()) + " bytes", test_info.dbg_info.debug);
+        }
+
+        // The BWT must have one '$'
+        KmerTable table;
+        result &= !table.Build("0101", 2) && !table.Build(bwt, 0) && !table.Build(bwt, kMaxKmerSize + 1);
+    }
+    return result;
+}
+
+bool Test_KStepFmiOffline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters                             fmi_params(size, kQuerySize, test_info.dbg_info);
+        uint32_t                                     ts = fmi_params.text_size;
+        uint32_t                                     qs = fmi_params.query_size;
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        tools::secret_sharing::ShareHandler          sh;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+
+        std::vector<uint32_t> pub_db(ts - 1), queries(kQueryNum * qs);
+        GenerateRandomNumbers(pub_db, 1);
+        GenerateRandomNumbers(queries, 1);
+        uint32_t pos = tools::rng::SecureRng::Rand32() % (ts - qs);
+        std::copy(pub_db.begin() + pos, pub_db.begin() + pos + qs, queries.begin() + qs);
+        io.WriteVectorToFile(kKStepDBPath + std::to_string(size), pub_db);
+        io.WriteVectorToFile(kKStepQueryPath + std::to_string(size), queries);
+
+        std::pair<std::vector<uint32_t>, std::vector<uint32_t>> q_sh = ss.Share(queries);
+        sh.ExportShare(kKStepQueryPath_P0 + std::to_string(size), kKStepQueryPath_P1 + std::to_string(size), q_sh);
+
+        for (const auto k : kSteps) {
+            KStepFmiParameters params(size, kQuerySize, k, test_info.dbg_info);
+            KStepFmi           kstep(params);
+
+            // The keys and the correlated triples are single-use, so every query has its own
+            for (uint32_t i = 0; i < kQueryNum; i++) {
+                // Generate correlated triples
+                cts_t ct;
+                ss.GenerateCorrelatedTriples(kstep.GetCorrelatedTripleFanOuts(), ct);
+                std::pair<cts_t, cts_t> ct_sh = ss.ShareCorrelatedTriples(ct);
+                sh.ExportCTShare(kKStepCTPath_P0 + FileOption(size, k, i), kKStepCTPath_P1 + FileOption(size, k, i), ct_sh);
+
+                // Generate key of KStepFmi
+                std::pair<KStepFmiKey, KStepFmiKey> kstep_keys = kstep.GenerateKeys();
+                key_io.WriteKStepFmiKeyToFile(kKStepKeyPath_P0 + FileOption(size, k, i), kstep_keys.first);
+                key_io.WriteKStepFmiKeyToFile(kKStepKeyPath_P1 + FileOption(size, k, i), kstep_keys.second);
+                KStepFmiKey kstep_key_0, kstep_key_1;
+                key_io.ReadKStepFmiKeyFromFile(kKStepKeyPath_P0 + FileOption(size, k, i), params, kstep_key_0);
+                key_io.ReadKStepFmiKeyFromFile(kKStepKeyPath_P1 + FileOption(size, k, i), params, kstep_key_1);
+                result &= (kstep_keys.first == kstep_key_0) && (kstep_keys.second == kstep_key_1);
+                result &= kstep_key_0.step_num == (qs - 1 + k - 1) / k;
+
+                kstep_keys.first.FreeKStepFmiKey();
+                kstep_keys.second.FreeKStepFmiKey();
+                kstep_key_0.FreeKStepFmiKey();
+                kstep_key_1.FreeKStepFmiKey();
+            }
+        }
+    }
+    return result;
+}
+
+bool Test_KStepFmiOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters                             fmi_params(size, kQuerySize, test_info.dbg_info);
+        uint32_t                                     qs = fmi_params.query_size;
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        tools::secret_sharing::ShareHandler          sh;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+
+        std::string           text = ReadText(io, size);
+        std::vector<uint32_t> queries, q_sh(kQueryNum * qs);
+        io.ReadVectorFromFile(kKStepQueryPath + std::to_string(size), queries);
+        sh.LoadShare(((party.GetId() == 0) ? kKStepQueryPath_P0 : kKStepQueryPath_P1) + std::to_string(size), q_sh);
+
+        // Start communication
+        party.StartCommunication();
+
+        for (const auto k : kSteps) {
+            KStepFmiParameters params(size, kQuerySize, k, test_info.dbg_info);
+            KStepFmi           kstep(params);
+            kstep.SetSentence(ReversedBwt(text));
+
+            // The ZeroTest of the occurrence count of every prefix
+            for (uint32_t i = 0; i < kQueryNum; i++) {
+                // Set the correlated triples and read the KStepFmi key of this query
+                cts_t       ct;
+                KStepFmiKey kstep_key;
+                if (party.GetId() == 0) {
+                    sh.LoadCTShare(kKStepCTPath_P0 + FileOption(size, k, i), ct);
+                    key_io.ReadKStepFmiKeyFromFile(kKStepKeyPath_P0 + FileOption(size, k, i), params, kstep_key);
+                } else {
+                    sh.LoadCTShare(kKStepCTPath_P1 + FileOption(size, k, i), ct);
+                    key_io.ReadKStepFmiKeyFromFile(kKStepKeyPath_P1 + FileOption(size, k, i), params, kstep_key);
+                }
+                kstep.SetCorrelatedTriple(ct);
+
+                std::vector<uint32_t> q(queries.begin() + i * qs, queries.begin() + (i + 1) * qs);
+                std::vector<uint32_t> q_i(q_sh.begin() + i * qs, q_sh.begin() + (i + 1) * qs);
+                std::vector<uint32_t> out_0(qs), out_1(qs), res(qs);
+                if (party.GetId() == 0) {
+                    kstep.Evaluate(party, kstep_key, q_i, out_0);
+                } else {
+                    kstep.Evaluate(party, kstep_key, q_i, out_1);
+                }
+                ss.Reconst(party, out_0, out_1, res);
+
+                std::vector<uint32_t> expected = CountPrefixes(text, q);
+                for (uint32_t d = 0; d < qs; d++) {
+                    result &= res[d] == (expected[d] == 0 ? 1U : 0U);
+                }
+                utils::Logger::DebugLog(LOCATION, "k: " + std::to_string(k) + ", Eq: " + utils::VectorToStr(res), test_info.dbg_info.debug);
+                kstep_key.FreeKStepFmiKey();
+            }
+        }
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace fmi
+}    // namespace fss
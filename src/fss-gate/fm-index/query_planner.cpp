@@ -0,0 +1,192 @@
+/**
+ * @file query_planner.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief QueryPlanner implementation.
+ */
+
+#include "query_planner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+// The microbenchmark of the calibration
+constexpr uint32_t kCalibrationPings     = 8;           // Rounds of one word for the round trip time
+constexpr uint32_t kCalibrationWords     = 1U << 18;    // Words exchanged for the bandwidth (1 MiB)
+constexpr uint32_t kCalibrationRankEvals = 4;           // FssRank evaluations
+constexpr uint32_t kCalibrationZtEvals   = 16;          // ZeroTest evaluations
+
+utils::Counter &BackwardSearchCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_fmi_planner_backward_search_total", "Number of queries planned on the backward search.");
+    return counter;
+}
+
+utils::Counter &DirectScanCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_fmi_planner_direct_scan_total", "Number of queries planned on the direct scan.");
+    return counter;
+}
+
+double SecondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The measurements are exchanged as the bits of the doubles (two words each)
+void AppendDouble(const double value, std::vector<uint32_t> &words) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    words.push_back(static_cast<uint32_t>(bits >> 32));
+    words.push_back(static_cast<uint32_t>(bits));
+}
+
+double ReadDouble(const std::vector<uint32_t> &words, const size_t i) {
+    uint64_t bits = (static_cast<uint64_t>(words[2 * i]) << 32) | words[2 * i + 1];
+    double   value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+
+std::string SearchEngineToStr(const SearchEngine engine) {
+    switch (engine) {
+        case SearchEngine::kBackwardSearch:
+            return "BackwardSearch";
+        case SearchEngine::kDirectScan:
+            return "DirectScan";
+    }
+    return "Unknown";
+}
+
+CostModel::CostModel()
+    : rtt_sec(0), bytes_per_sec(0), rank_sec(0), node_sec(0), zt_sec(0) {
+}
+
+QueryPlanner::QueryPlanner(const FssFmiParameters params, const DirectScan &scan)
+    : params_(params), scan_(scan) {
+}
+
+void QueryPlanner::Calibrate(tools::secret_sharing::Party &party, const FssFmi &fss_fmi) {
+    uint32_t  t  = this->params_.text_bitsize;
+    uint32_t  qs = this->params_.query_size;
+    CostModel model;
+
+    // Round trip time
+    uint32_t ping_0 = 0, ping_1 = 0;
+    party.SendRecv(ping_0, ping_1);    // Warm up
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kCalibrationPings; i++) {
+        party.SendRecv(ping_0, ping_1);
+    }
+    model.rtt_sec = SecondsSince(start) / kCalibrationPings;
+
+    // Bandwidth (each party sends and receives the payload in a round)
+    std::vector<uint32_t> payload_0(kCalibrationWords), payload_1(kCalibrationWords);
+    start = std::chrono::steady_clock::now();
+    party.SendRecv(payload_0, payload_1);
+    double transfer     = std::max(SecondsSince(start) - model.rtt_sec, 1e-9);
+    model.bytes_per_sec = 2.0 * kCalibrationWords * sizeof(uint32_t) / transfer;
+
+    // FssRank with a local key (the time does not depend on the key)
+    std::pair<rank::FssRankKey, rank::FssRankKey> rank_keys = fss_fmi.rank_.GenerateKeys();
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kCalibrationRankEvals; i++) {
+        fss_fmi.EvaluateRank(rank_keys.first, utils::Mod(tools::rng::SecureRng::Rand32(), t));
+    }
+    model.rank_sec = SecondsSince(start) / kCalibrationRankEvals;
+    rank_keys.first.FreeFssRankKey();
+    rank_keys.second.FreeFssRankKey();
+
+    // A whole scan with a local key (the nodes do not depend on the pattern), then the ZeroTest
+    std::pair<DirectScanKey, DirectScanKey> scan_keys = this->scan_.GenerateKeys();
+    std::vector<uint32_t>                   opened(qs), counts;
+    for (uint32_t i = 0; i < qs; i++) {
+        opened[i] = tools::rng::SecureRng::Rand32();
+    }
+    start             = std::chrono::steady_clock::now();
+    uint64_t node_num = this->scan_.Scan(scan_keys.first, opened, counts, nullptr);
+    model.node_sec    = node_num > 0 ? SecondsSince(start) / node_num : 0;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kCalibrationZtEvals; i++) {
+        this->scan_.zt_.EvaluateAt(scan_keys.first.zt_keys[i % qs], utils::Mod(tools::rng::SecureRng::Rand32(), t));
+    }
+    model.zt_sec = SecondsSince(start) / kCalibrationZtEvals;
+    scan_keys.first.FreeDirectScanKey();
+    scan_keys.second.FreeDirectScanKey();
+
+    // Keep the worse of both parties, so that both make the same choices
+    std::vector<uint32_t> mine, other;
+    for (const double value : {model.rtt_sec, model.bytes_per_sec, model.rank_sec, model.node_sec, model.zt_sec}) {
+        AppendDouble(value, mine);
+    }
+    other.resize(mine.size());
+    if (party.GetId() == 0) {
+        party.SendRecv(mine, other);
+    } else {
+        party.SendRecv(other, mine);
+    }
+    model.rtt_sec       = std::max(model.rtt_sec, ReadDouble(other, 0));
+    model.bytes_per_sec = std::min(model.bytes_per_sec, ReadDouble(other, 1));
+    model.rank_sec      = std::max(model.rank_sec, ReadDouble(other, 2));
+    model.node_sec      = std::max(model.node_sec, ReadDouble(other, 3));
+    model.zt_sec        = std::max(model.zt_sec, ReadDouble(other, 4));
+    this->model_        = model;
+
+    utils::Logger::DebugLog(LOCATION, "Cost model: rtt = " + std::to_string(model.rtt_sec * 1e6) + " us, bandwidth = " + std::to_string(model.bytes_per_sec / 1e6) + " MB/s, rank = " + std::to_string(model.rank_sec * 1e6) + " us, node = " + std::to_string(model.node_sec * 1e9) + " ns, zt = " + std::to_string(model.zt_sec * 1e6) + " us", this->params_.debug);
+}
+
+void QueryPlanner::SetCostModel(const CostModel &model) {
+    this->model_ = model;
+}
+
+const CostModel &QueryPlanner::GetCostModel() const {
+    return this->model_;
+}
+
+double QueryPlanner::EstimateSeconds(const SearchEngine engine, const uint32_t length) const {
+    const CostModel &model = this->model_;
+    double           rounds, words, compute;
+    if (engine == SearchEngine::kBackwardSearch) {
+        // The query is padded to the query size: each step opens (f, g) and the selection (3 words)
+        double steps = this->params_.query_size - 1;
+        rounds       = 2 * steps + 1;
+        words        = 5 * steps + this->params_.query_size;
+        compute      = 2 * steps * model.rank_sec + this->params_.query_size * model.zt_sec;
+    } else {
+        rounds  = 2;
+        words   = 2.0 * length;
+        compute = this->scan_.CountNodes(length) * model.node_sec + length * model.zt_sec;
+    }
+    double transfer = model.bytes_per_sec > 0 ? words * sizeof(uint32_t) / model.bytes_per_sec : 0;
+    return rounds * model.rtt_sec + transfer + compute;
+}
+
+SearchEngine QueryPlanner::Choose(const uint32_t length) const {
+    double       backward = this->EstimateSeconds(SearchEngine::kBackwardSearch, length);
+    double       direct   = this->EstimateSeconds(SearchEngine::kDirectScan, length);
+    SearchEngine engine   = direct < backward ? SearchEngine::kDirectScan : SearchEngine::kBackwardSearch;
+    if (engine == SearchEngine::kDirectScan) {
+        DirectScanCounter().Increment();
+    } else {
+        BackwardSearchCounter().Increment();
+    }
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "Length " + std::to_string(length) + ": backward search " + std::to_string(backward) + " s, direct scan " + std::to_string(direct) + " s -> " + SearchEngineToStr(engine), this->params_.debug);
+#endif
+    return engine;
+}
+
+}    // namespace fmi
+}    // namespace fss
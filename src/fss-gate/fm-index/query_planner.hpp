@@ -0,0 +1,116 @@
+/**
+ * @file query_planner.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief QueryPlanner class (choice between the backward search and the direct scan).
+ */
+
+#ifndef FM_INDEX_QUERY_PLANNER_H_
+#define FM_INDEX_QUERY_PLANNER_H_
+
+#include "direct_scan.hpp"
+#include "fss_fmi.hpp"
+
+namespace fss {
+namespace fmi {
+
+/**
+ * @brief The engines answering a query.
+ */
+enum class SearchEngine {
+    kBackwardSearch, /**< FssFmi (2 * (query size - 1) + 1 rounds, a rank per step). */
+    kDirectScan,     /**< DirectScan (2 rounds, an IDPF node per distinct window prefix). */
+};
+
+/**
+ * @brief Get the name of the engine.
+ * @param engine The engine.
+ * @return The name of the engine.
+ */
+std::string SearchEngineToStr(const SearchEngine engine);
+
+/**
+ * @struct CostModel
+ * @brief The measured costs used to estimate the latency of a query.
+ */
+struct CostModel {
+    double rtt_sec;       /**< The time of a communication round without payload. */
+    double bytes_per_sec; /**< The bandwidth between the parties. */
+    double rank_sec;      /**< The time of one FssRank evaluation. */
+    double node_sec;      /**< The time of one IDPF node of the direct scan. */
+    double zt_sec;        /**< The time of one ZeroTest evaluation. */
+
+    /**
+     * @brief Default constructor for CostModel (all costs are zero).
+     */
+    CostModel();
+};
+
+/**
+ * @class QueryPlanner
+ * @brief Choose the engine of each query from the text size, the pattern length and the measured costs.
+ *
+ * The backward search always runs the whole query size (the key is for padded queries), while the direct scan
+ * evaluates the nodes of the trie of the text windows up to the pattern length. Calibrate runs a short
+ * microbenchmark and both parties keep the worse of the two measurements, so they choose the same engine.
+ */
+class QueryPlanner {
+public:
+    /**
+     * @brief Constructor for QueryPlanner.
+     * @param params The parameters for FssFmi.
+     * @param scan The DirectScan object with the text (must outlive the planner).
+     */
+    QueryPlanner(const FssFmiParameters params, const DirectScan &scan);
+
+    /**
+     * @brief Measure the costs on this host and the link (both parties must call it at the same time).
+     * @param party The party object (the communication must be started).
+     * @param fss_fmi The FssFmi object with the index.
+     */
+    void Calibrate(tools::secret_sharing::Party &party, const FssFmi &fss_fmi);
+
+    /**
+     * @brief Set the costs (e.g. the result of an earlier calibration).
+     * @param model The cost model.
+     */
+    void SetCostModel(const CostModel &model);
+
+    /**
+     * @brief Retrieves the costs.
+     * @return The cost model.
+     */
+    const CostModel &GetCostModel() const;
+
+    /**
+     * @brief Estimate the latency of a query.
+     * @param engine The engine.
+     * @param length The length of the pattern.
+     * @return The estimated seconds.
+     */
+    double EstimateSeconds(const SearchEngine engine, const uint32_t length) const;
+
+    /**
+     * @brief Choose the engine with the lower estimate (the backward search on a tie).
+     * @param length The length of the pattern.
+     * @return The engine.
+     */
+    SearchEngine Choose(const uint32_t length) const;
+
+private:
+    const FssFmiParameters params_; /**< The parameters for FssFmi. */
+    const DirectScan      &scan_;   /**< The DirectScan object. */
+    CostModel              model_;  /**< The cost model. */
+};
+
+namespace test {
+
+void Test_QueryPlanner(tools::secret_sharing::Party &party, TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace fmi
+}    // namespace fss
+
+#endif    // FM_INDEX_QUERY_PLANNER_H_
@@ -0,0 +1,149 @@
+/**
+ * @file query_planner_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-19
+ * @copyright Copyright (c) 2024
+ * @brief QueryPlanner test implementation.
+ */
+
+#include "query_planner.hpp"
+
+#include <thread>
+
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+#include "bwt_index.hpp"
+
+namespace {
+
+constexpr uint32_t kQuerySize = 4;
+
+// Both parties need the same text for the same choices
+std::string GenerateText(const uint32_t length) {
+    std::string text(length, '0');
+    for (uint32_t i = 0; i < length; i++) {
+        text[i] = ((i * 2654435761U) >> 13) & 1 ? '1' : '0';
+    }
+    return text;
+}
+
+}    // namespace
+
+namespace fss {
+namespace fmi {
+namespace test {
+
+bool Test_QueryPlannerCostModel(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_QueryPlannerCalibrate(tools::secret_sharing::Party &party, const TestInfo &test_info);
+
+void Test_QueryPlanner(tools::secret_sharing::Party &party, TestInfo &test_info) {
+    std::vector<std::string> modes         = {"QueryPlanner unit tests", "QueryPlannerCostModel", "QueryPlannerCalibrate"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        if (party.GetId() == 0) {
+            utils::PrintTestResult("Test_QueryPlannerCostModel", Test_QueryPlannerCostModel(party, test_info));
+        } else {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        utils::PrintTestResult("Test_QueryPlannerCalibrate", Test_QueryPlannerCalibrate(party, test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_QueryPlannerCostModel", Test_QueryPlannerCostModel(party, test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_QueryPlannerCalibrate", Test_QueryPlannerCalibrate(party, test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_QueryPlannerCostModel(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters params(size, kQuerySize, test_info.dbg_info);
+        uint32_t         qs = params.query_size;
+        DirectScan       scan(params);
+        QueryPlanner     planner(params, scan);
+        scan.SetSentence(GenerateText(params.text_size - 1));
+
+        // A slow link favors the 2 rounds of the direct scan
+        CostModel wan;
+        wan.rtt_sec       = 1e-2;
+        wan.bytes_per_sec = 1e8;
+        wan.rank_sec      = 1e-5;
+        wan.node_sec      = 1e-8;
+        wan.zt_sec        = 1e-6;
+        planner.SetCostModel(wan);
+        for (uint32_t length = 1; length <= qs; length++) {
+            result &= planner.Choose(length) == SearchEngine::kDirectScan;
+        }
+
+        // Expensive nodes favor the rank of the backward search
+        CostModel slow_scan;
+        slow_scan.rtt_sec       = 1e-6;
+        slow_scan.bytes_per_sec = 1e10;
+        slow_scan.rank_sec      = 1e-7;
+        slow_scan.node_sec      = 1e-3;
+        slow_scan.zt_sec        = 1e-6;
+        planner.SetCostModel(slow_scan);
+        result &= planner.Choose(qs) == SearchEngine::kBackwardSearch;
+
+        // The estimate of the direct scan grows with the pattern, while the backward search always runs the query size
+        double prev = 0;
+        for (uint32_t length = 1; length <= qs; length++) {
+            double direct = planner.EstimateSeconds(SearchEngine::kDirectScan, length);
+            result &= direct >= prev && planner.EstimateSeconds(SearchEngine::kBackwardSearch, length) == planner.EstimateSeconds(SearchEngine::kBackwardSearch, qs);
+            prev = direct;
+        }
+    }
+    return result;
+}
+
+bool Test_QueryPlannerCalibrate(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssFmiParameters params(size, kQuerySize, test_info.dbg_info);
+        uint32_t         qs = params.query_size;
+        FssFmi           fss_fmi(params);
+        DirectScan       scan(params);
+        QueryPlanner     planner(params, scan);
+
+        std::string text = GenerateText(params.text_size - 1);
+        std::string reversed(text.rbegin(), text.rend());
+        BwtIndex    index;
+        result &= BuildBwtIndex(reversed, kDefaultSaSampleRate, index);
+        fss_fmi.SetSentence(index.ToString());
+        scan.SetSentence(text);
+
+        // Start communication
+        party.StartCommunication();
+        planner.Calibrate(party, fss_fmi);
+
+        const CostModel &model = planner.GetCostModel();
+        result &= model.rtt_sec > 0 && model.bytes_per_sec > 0 && model.rank_sec > 0 && model.node_sec > 0 && model.zt_sec > 0;
+
+        // Both parties choose the same engine for every length
+        std::vector<uint32_t> choices(qs), choices_0(qs), choices_1(qs);
+        for (uint32_t length = 1; length <= qs; length++) {
+            choices[length - 1] = static_cast<uint32_t>(planner.Choose(length));
+            utils::Logger::DebugLog(LOCATION, "Length " + std::to_string(length) + ": " + SearchEngineToStr(static_cast<SearchEngine>(choices[length - 1])), test_info.dbg_info.debug);
+        }
+        if (party.GetId() == 0) {
+            choices_0 = choices;
+            party.SendRecv(choices_0, choices_1);
+        } else {
+            choices_1 = choices;
+            party.SendRecv(choices_0, choices_1);
+        }
+        result &= choices_0 == choices_1;
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace fmi
+}    // namespace fss
@@ -70,6 +70,9 @@ std::vector<std::string> ParseRow(const std::string &line, const char del) {
     while (std::getline(ss, cell, del)) {
         row.push_back(cell);
     }
+    if (!line.empty() && line.back() == del) {
+        row.push_back("");    // A trailing empty cell (e.g. a zero block is encoded to an empty string)
+    }
     return row;
 }
 
@@ -192,6 +195,62 @@ void FssKeyIo::WriteFssFmiKeyToFile(const std::string &file_path, const fmi::Fss
     utils::Logger::DebugLog(LOCATION, "FSS FMI key has been written to the file (" + file_path + this->ext_ + ")", this->debug_);
 }
 
+void FssKeyIo::WriteFssFmiCountKeyToFile(const std::string &file_path, const fmi::FssFmiCountKey &count_key) {
+    // Open the file
+    std::ofstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+
+    this->ExportFssFmiCountKey(file, count_key);
+
+    // Close the file
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "FSS FMI count key has been written to the file (" + file_path + this->ext_ + ")", this->debug_);
+}
+
+void FssKeyIo::WriteIntervalKeyToFile(const std::string &file_path, const interval::IntervalKey &interval_key) {
+    // Open the file
+    std::ofstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+
+    this->ExportIntervalKey(file, interval_key);
+
+    // Close the file
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "Interval key has been written to the file (" + file_path + this->ext_ + ")", this->debug_);
+}
+
+void FssKeyIo::WriteDirectScanKeyToFile(const std::string &file_path, const fmi::DirectScanKey &scan_key) {
+    // Open the file
+    std::ofstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+
+    this->ExportDirectScanKey(file, scan_key);
+
+    // Close the file
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "DirectScan key has been written to the file (" + file_path + this->ext_ + ")", this->debug_);
+}
+
+void FssKeyIo::WriteKStepFmiKeyToFile(const std::string &file_path, const fmi::KStepFmiKey &kstep_key) {
+    // Open the file
+    std::ofstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+
+    this->ExportKStepFmiKey(file, kstep_key);
+
+    // Close the file
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "KStepFmi key has been written to the file (" + file_path + this->ext_ + ")", this->debug_);
+}
+
 void FssKeyIo::ReadDpfKeyFromFile(const std::string &file_path, const dpf::DpfParameters &params, dpf::DpfKey &dpf_key, const bool is_naive) {
     // Open the file for reading
     std::ifstream file;
@@ -290,6 +349,62 @@ void FssKeyIo::ReadFssFmiKeyFromFile(const std::string &file_path, const fmi::Fs
     utils::Logger::DebugLog(LOCATION, "FSS FMI key read from file (" + file_path + this->ext_ + ")", this->debug_);
 }
 
+void FssKeyIo::ReadFssFmiCountKeyFromFile(const std::string &file_path, const fmi::FssFmiParameters &params, fmi::FssFmiCountKey &count_key) {
+    // Open the file for reading
+    std::ifstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+
+    this->ImportFssFmiCountKey(file, params, count_key);
+
+    // Close the file
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "FSS FMI count key read from file (" + file_path + this->ext_ + ")", this->debug_);
+}
+
+void FssKeyIo::ReadIntervalKeyFromFile(const std::string &file_path, const uint32_t n, const uint32_t z_num, interval::IntervalKey &interval_key) {
+    // Open the file for reading
+    std::ifstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+
+    this->ImportIntervalKey(file, n, z_num, interval_key);
+
+    // Close the file
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "Interval key read from file (" + file_path + this->ext_ + ")", this->debug_);
+}
+
+void FssKeyIo::ReadDirectScanKeyFromFile(const std::string &file_path, const fmi::FssFmiParameters &params, fmi::DirectScanKey &scan_key) {
+    // Open the file for reading
+    std::ifstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+
+    this->ImportDirectScanKey(file, params, scan_key);
+
+    // Close the file
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "DirectScan key read from file (" + file_path + this->ext_ + ")", this->debug_);
+}
+
+void FssKeyIo::ReadKStepFmiKeyFromFile(const std::string &file_path, const fmi::KStepFmiParameters &params, fmi::KStepFmiKey &kstep_key) {
+    // Open the file for reading
+    std::ifstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+
+    this->ImportKStepFmiKey(file, params, kstep_key);
+
+    // Close the file
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "KStepFmi key read from file (" + file_path + this->ext_ + ")", this->debug_);
+}
+
 void FssKeyIo::ExportDpfKey(std::ofstream &file, const dpf::DpfKey &dpf_key, const bool is_naive) {
     file << dpf_key.party_id << std::endl;
     file << Base64Encoder::Encode(dpf_key.init_seed.GetHigh()) << this->del_ << Base64Encoder::Encode(dpf_key.init_seed.GetLow()) << std::endl;
@@ -333,7 +448,11 @@ void FssKeyIo::ExportZeroTestKey(std::ofstream &file, const zt::ZeroTestKey &zt_
 }
 
 void FssKeyIo::ExportFssRankKey(std::ofstream &file, const rank::FssRankKey &rank_key) {
-    this->ExportDpfKey(file, rank_key.dpf_key);
+    if (rank_key.backend == rank::RankBackend::kDcf) {
+        this->ExportDcfKey(file, rank_key.dcf_key);
+    } else {
+        this->ExportDpfKey(file, rank_key.dpf_key);
+    }
     file << rank_key.shr_in << std::endl;
 }
 
@@ -348,6 +467,60 @@ void FssKeyIo::ExportFssFmiKey(std::ofstream &file, const fmi::FssFmiKey &fmi_ke
     }
 }
 
+void FssKeyIo::ExportFssFmiCountKey(std::ofstream &file, const fmi::FssFmiCountKey &count_key) {
+    for (uint32_t i = 0; i < count_key.rank_key_num; i++) {
+        this->ExportFssRankKey(file, count_key.rank_keys_f[i]);
+        this->ExportFssRankKey(file, count_key.rank_keys_g[i]);
+    }
+}
+
+void FssKeyIo::ExportIntervalKey(std::ofstream &file, const interval::IntervalKey &interval_key) {
+    this->ExportDcfKey(file, interval_key.dcf_key);
+    file << interval_key.shr_in;
+    for (const auto shr_z : interval_key.shr_z) {
+        file << this->del_ << shr_z;
+    }
+    file << std::endl;
+}
+
+void FssKeyIo::ExportIdpfKey(std::ofstream &file, const idpf::IdpfKey &idpf_key) {
+    file << idpf_key.party_id << std::endl;
+    file << Base64Encoder::Encode(idpf_key.init_seed.GetHigh()) << this->del_ << Base64Encoder::Encode(idpf_key.init_seed.GetLow()) << std::endl;
+    for (uint32_t i = 0; i < idpf_key.cw_length; i++) {
+        file << Base64Encoder::Encode(idpf_key.correction_words[i].seed.GetHigh()) << this->del_
+             << Base64Encoder::Encode(idpf_key.correction_words[i].seed.GetLow()) << this->del_
+             << idpf_key.correction_words[i].control_left << this->del_
+             << idpf_key.correction_words[i].control_right << this->del_
+             << idpf_key.correction_words[i].value << std::endl;
+    }
+}
+
+void FssKeyIo::ExportDirectScanKey(std::ofstream &file, const fmi::DirectScanKey &scan_key) {
+    this->ExportIdpfKey(file, scan_key.idpf_key);
+    for (size_t i = 0; i < scan_key.shr_in.size(); i++) {
+        if (i > 0) {
+            file << this->del_;
+        }
+        file << scan_key.shr_in[i];
+    }
+    file << std::endl;
+    for (const auto &zt_key : scan_key.zt_keys) {
+        this->ExportZeroTestKey(file, zt_key);
+    }
+}
+
+void FssKeyIo::ExportKStepFmiKey(std::ofstream &file, const fmi::KStepFmiKey &kstep_key) {
+    for (uint32_t i = 0; i < kstep_key.step_num; i++) {
+        this->ExportFssRankKey(file, kstep_key.rank_keys_f[i]);
+        this->ExportFssRankKey(file, kstep_key.rank_keys_g[i]);
+        this->ExportDpfKey(file, kstep_key.select_keys[i].dpf_key);
+        file << kstep_key.select_keys[i].shr_in << std::endl;
+    }
+    for (const auto &zt_key : kstep_key.zt_keys) {
+        this->ExportZeroTestKey(file, zt_key);
+    }
+}
+
 void FssKeyIo::ImportDpfKey(std::ifstream &file, const dpf::DpfParameters &params, dpf::DpfKey &dpf_key, const bool is_naive) {
     dpf::DpfKey key;
     key.Initialize(params, 0, is_naive);
@@ -455,8 +628,12 @@ void FssKeyIo::ImportZeroTestKey(std::ifstream &file, const zt::ZeroTestParamete
 
 void FssKeyIo::ImportFssRankKey(std::ifstream &file, const rank::FssRankParameters &params, rank::FssRankKey &rank_key) {
     rank::FssRankKey key;
-    dpf::DpfKey      dpf_key;
-    this->ImportDpfKey(file, params.dpf_params, key.dpf_key);
+    key.backend = params.backend;
+    if (params.backend == rank::RankBackend::kDcf) {
+        this->ImportDcfKey(file, params.text_bitsize, key.dcf_key);
+    } else {
+        this->ImportDpfKey(file, params.dpf_params, key.dpf_key);
+    }
 
     std::vector<std::string> row;
     if (this->ReadNextRow(file, row)) {
@@ -485,6 +662,110 @@ void FssKeyIo::ImportFssFmiKey(std::ifstream &file, const fmi::FssFmiParameters
     fmi_key = std::move(key);
 }
 
+void FssKeyIo::ImportFssFmiCountKey(std::ifstream &file, const fmi::FssFmiParameters &params, fmi::FssFmiCountKey &count_key) {
+    fmi::FssFmiCountKey key{params.query_size - 1};
+    for (uint32_t i = 0; i < key.rank_key_num; i++) {
+        rank::FssRankKey rank_key_f, rank_key_g;
+        this->ImportFssRankKey(file, params.rank_params, rank_key_f);
+        this->ImportFssRankKey(file, params.rank_params, rank_key_g);
+        key.rank_keys_f.push_back(std::move(rank_key_f));
+        key.rank_keys_g.push_back(std::move(rank_key_g));
+    }
+    count_key = std::move(key);
+}
+
+void FssKeyIo::ImportIntervalKey(std::ifstream &file, const uint32_t n, const uint32_t z_num, interval::IntervalKey &interval_key) {
+    interval::IntervalKey key;
+    this->ImportDcfKey(file, n, key.dcf_key);
+
+    std::vector<std::string> row;
+    if (this->ReadNextRow(file, row) && row.size() == z_num + 1) {
+        key.shr_in = std::stoul(row[0]);
+        for (uint32_t j = 0; j < z_num; j++) {
+            key.shr_z.push_back(std::stoul(row[j + 1]));
+        }
+    } else {
+        utils::Logger::ErrorLog(LOCATION, "Failed to read share of r_in, z");
+    }
+    interval_key = std::move(key);
+}
+
+void FssKeyIo::ImportIdpfKey(std::ifstream &file, const uint32_t n, idpf::IdpfKey &idpf_key) {
+    idpf::IdpfKey key;
+    key.Initialize(n, 0);
+    std::vector<std::string> row;
+    if (this->ReadNextRow(file, row)) {
+        key.party_id = std::stoul(row[0]);
+    } else {
+        utils::Logger::ErrorLog(LOCATION, "Failed to read party id");
+    }
+    if (this->ReadNextRow(file, row)) {
+        key.init_seed = Block(Base64Encoder::Decode(row[0]), Base64Encoder::Decode(row[1]));
+    } else {
+        utils::Logger::ErrorLog(LOCATION, "Failed to read seed");
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        if (this->ReadNextRow(file, row)) {
+            key.correction_words[i].seed          = Block(Base64Encoder::Decode(row[0]), Base64Encoder::Decode(row[1]));
+            key.correction_words[i].control_left  = StrToBool(row[2]);
+            key.correction_words[i].control_right = StrToBool(row[3]);
+            key.correction_words[i].value         = std::stoul(row[4]);
+        } else {
+            utils::Logger::ErrorLog(LOCATION, "Failed to read correction word");
+        }
+    }
+    idpf_key = std::move(key);
+}
+
+void FssKeyIo::ImportDirectScanKey(std::ifstream &file, const fmi::FssFmiParameters &params, fmi::DirectScanKey &scan_key) {
+    uint32_t           qs = params.query_size;
+    fmi::DirectScanKey key;
+    this->ImportIdpfKey(file, qs, key.idpf_key);
+
+    std::vector<std::string> row;
+    if (this->ReadNextRow(file, row) && row.size() == qs) {
+        for (uint32_t i = 0; i < qs; i++) {
+            key.shr_in.push_back(std::stoul(row[i]));
+        }
+    } else {
+        utils::Logger::ErrorLog(LOCATION, "Failed to read share of r_in");
+    }
+    for (uint32_t i = 0; i < qs; i++) {
+        zt::ZeroTestKey zt_key;
+        this->ImportZeroTestKey(file, params.zt_params, zt_key);
+        key.zt_keys.push_back(std::move(zt_key));
+    }
+    scan_key = std::move(key);
+}
+
+void FssKeyIo::ImportKStepFmiKey(std::ifstream &file, const fmi::KStepFmiParameters &params, fmi::KStepFmiKey &kstep_key) {
+    fmi::KStepFmiKey key;
+    key.step_num = params.step_num;
+    for (uint32_t i = 0; i < key.step_num; i++) {
+        rank::FssRankKey   rank_key_f, rank_key_g;
+        fmi::KmerSelectKey select_key;
+        this->ImportFssRankKey(file, params.fmi_params.rank_params, rank_key_f);
+        this->ImportFssRankKey(file, params.fmi_params.rank_params, rank_key_g);
+        this->ImportDpfKey(file, params.select_params, select_key.dpf_key);
+
+        std::vector<std::string> row;
+        if (this->ReadNextRow(file, row)) {
+            select_key.shr_in = std::stoul(row[0]);
+        } else {
+            utils::Logger::ErrorLog(LOCATION, "Failed to read share of r_in");
+        }
+        key.rank_keys_f.push_back(std::move(rank_key_f));
+        key.rank_keys_g.push_back(std::move(rank_key_g));
+        key.select_keys.push_back(std::move(select_key));
+    }
+    for (uint32_t i = 0; i < params.fmi_params.query_size; i++) {
+        zt::ZeroTestKey zt_key;
+        this->ImportZeroTestKey(file, params.fmi_params.zt_params, zt_key);
+        key.zt_keys.push_back(std::move(zt_key));
+    }
+    kstep_key = std::move(key);
+}
+
 bool FssKeyIo::ReadNextRow(std::ifstream &file, std::vector<std::string> &row) {
     std::string line;
     if (std::getline(file, line)) {
@@ -14,9 +14,13 @@
 #include "../../fss-base/dcf/distributed_comparison_function.hpp"
 #include "../../fss-base/ddcf/dual_dcf.hpp"
 #include "../../fss-base/dpf/distributed_point_function.hpp"
+#include "../../fss-base/idpf/incremental_dpf.hpp"
 #include "../../utils/file_io.hpp"
 #include "../comp/integer_comparison.hpp"
+#include "../fm-index/direct_scan.hpp"
 #include "../fm-index/fss_fmi.hpp"
+#include "../fm-index/kstep_fmi.hpp"
+#include "../interval/interval_containment.hpp"
 #include "../rank/fss_rank.hpp"
 #include "../zt/zero_test_dpf.hpp"
 
@@ -34,6 +38,10 @@ public:
     void WriteZeroTestKeyToFile(const std::string &file_path, const zt::ZeroTestKey &zt_key);
     void WriteFssRankKeyToFile(const std::string &file_path, const rank::FssRankKey &rank_key);
     void WriteFssFmiKeyToFile(const std::string &file_path, const fmi::FssFmiKey &fmi_key);
+    void WriteFssFmiCountKeyToFile(const std::string &file_path, const fmi::FssFmiCountKey &count_key);
+    void WriteIntervalKeyToFile(const std::string &file_path, const interval::IntervalKey &interval_key);
+    void WriteDirectScanKeyToFile(const std::string &file_path, const fmi::DirectScanKey &scan_key);
+    void WriteKStepFmiKeyToFile(const std::string &file_path, const fmi::KStepFmiKey &kstep_key);
 
     void ReadDpfKeyFromFile(const std::string &file_path, const dpf::DpfParameters &params, dpf::DpfKey &dpf_key, const bool is_naive = false);
     void ReadDcfKeyFromFile(const std::string &file_path, const uint32_t n, dcf::DcfKey &dcf_key);
@@ -42,6 +50,10 @@ public:
     void ReadZeroTestKeyFromFile(const std::string &file_path, const zt::ZeroTestParameters &params, zt::ZeroTestKey &zt_key);
     void ReadFssRankKeyFromFile(const std::string &file_path, const rank::FssRankParameters &params, rank::FssRankKey &rank_key);
     void ReadFssFmiKeyFromFile(const std::string &file_path, const fmi::FssFmiParameters &params, fmi::FssFmiKey &fmi_key);
+    void ReadFssFmiCountKeyFromFile(const std::string &file_path, const fmi::FssFmiParameters &params, fmi::FssFmiCountKey &count_key);
+    void ReadIntervalKeyFromFile(const std::string &file_path, const uint32_t n, const uint32_t z_num, interval::IntervalKey &interval_key);
+    void ReadDirectScanKeyFromFile(const std::string &file_path, const fmi::FssFmiParameters &params, fmi::DirectScanKey &scan_key);
+    void ReadKStepFmiKeyFromFile(const std::string &file_path, const fmi::KStepFmiParameters &params, fmi::KStepFmiKey &kstep_key);
 
 private:
     const bool        debug_;
@@ -64,6 +76,11 @@ private:
     void ExportZeroTestKey(std::ofstream &file, const zt::ZeroTestKey &zt_key);
     void ExportFssRankKey(std::ofstream &file, const rank::FssRankKey &rank_key);
     void ExportFssFmiKey(std::ofstream &file, const fmi::FssFmiKey &fmi_key);
+    void ExportFssFmiCountKey(std::ofstream &file, const fmi::FssFmiCountKey &count_key);
+    void ExportIntervalKey(std::ofstream &file, const interval::IntervalKey &interval_key);
+    void ExportIdpfKey(std::ofstream &file, const idpf::IdpfKey &idpf_key);
+    void ExportDirectScanKey(std::ofstream &file, const fmi::DirectScanKey &scan_key);
+    void ExportKStepFmiKey(std::ofstream &file, const fmi::KStepFmiKey &kstep_key);
 
     void ImportDpfKey(std::ifstream &file, const dpf::DpfParameters &params, dpf::DpfKey &dpf_key, const bool is_naive = false);
     void ImportDcfKey(std::ifstream &file, const uint32_t n, dcf::DcfKey &dcf_key);
@@ -72,6 +89,11 @@ private:
     void ImportZeroTestKey(std::ifstream &file, const zt::ZeroTestParameters &params, zt::ZeroTestKey &zt_key);
     void ImportFssRankKey(std::ifstream &file, const rank::FssRankParameters &params, rank::FssRankKey &rank_key);
     void ImportFssFmiKey(std::ifstream &file, const fmi::FssFmiParameters &params, fmi::FssFmiKey &fmi_key);
+    void ImportFssFmiCountKey(std::ifstream &file, const fmi::FssFmiParameters &params, fmi::FssFmiCountKey &count_key);
+    void ImportIntervalKey(std::ifstream &file, const uint32_t n, const uint32_t z_num, interval::IntervalKey &interval_key);
+    void ImportIdpfKey(std::ifstream &file, const uint32_t n, idpf::IdpfKey &idpf_key);
+    void ImportDirectScanKey(std::ifstream &file, const fmi::FssFmiParameters &params, fmi::DirectScanKey &scan_key);
+    void ImportKStepFmiKey(std::ifstream &file, const fmi::KStepFmiParameters &params, fmi::KStepFmiKey &kstep_key);
 };
 
 /**
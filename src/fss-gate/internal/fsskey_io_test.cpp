@@ -32,6 +32,8 @@ const std::string kZtKeyPathP0       = kKeyIoPath + "ztkey_0";
 const std::string kZtKeyPathP1       = kKeyIoPath + "ztkey_1";
 const std::string kFmiKeyPathP0      = kKeyIoPath + "fmikey_0";
 const std::string kFmiKeyPathP1      = kKeyIoPath + "fmikey_1";
+const std::string kFmiCountKeyPathP0 = kKeyIoPath + "fmicountkey_0";
+const std::string kFmiCountKeyPathP1 = kKeyIoPath + "fmicountkey_1";
 
 }    // namespace
 
@@ -46,9 +48,10 @@ bool Test_CompKeyIo(const TestInfo &test_info);
 bool Test_RankKeyIo(const TestInfo &test_info);
 bool Test_ZeroTestKeyIo(const TestInfo &test_info);
 bool Test_FmiKeyIo(const TestInfo &test_info);
+bool Test_FmiCountKeyIo(const TestInfo &test_info);
 
 void Test_FssKeyIo(TestInfo &test_info) {
-    std::vector<std::string> modes         = {"Key I/O unit tests", "DpfKeyIo", "DcfKeyIo", "DdcfKeyIo", "CompKeyIo", "RankKeyIo", "ZeroTestKeyIo", "FmiKeyIo"};
+    std::vector<std::string> modes         = {"Key I/O unit tests", "DpfKeyIo", "DcfKeyIo", "DdcfKeyIo", "CompKeyIo", "RankKeyIo", "ZeroTestKeyIo", "FmiKeyIo", "FmiCountKeyIo"};
     uint32_t                 selected_mode = test_info.mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -65,6 +68,7 @@ void Test_FssKeyIo(TestInfo &test_info) {
         utils::PrintTestResult("Test_RankKeyIo", Test_RankKeyIo(test_info));
         utils::PrintTestResult("Test_ZeroTestKeyIo", Test_ZeroTestKeyIo(test_info));
         utils::PrintTestResult("Test_FmiKeyIo", Test_FmiKeyIo(test_info));
+        utils::PrintTestResult("Test_FmiCountKeyIo", Test_FmiCountKeyIo(test_info));
     } else if (selected_mode == 2) {
         utils::PrintTestResult("Test_DpfKeyIo", Test_DpfKeyIo(test_info));
     } else if (selected_mode == 3) {
@@ -79,6 +83,8 @@ void Test_FssKeyIo(TestInfo &test_info) {
         utils::PrintTestResult("Test_ZeroTestKeyIo", Test_ZeroTestKeyIo(test_info));
     } else if (selected_mode == 8) {
         utils::PrintTestResult("Test_FmiKeyIo", Test_FmiKeyIo(test_info));
+    } else if (selected_mode == 9) {
+        utils::PrintTestResult("Test_FmiCountKeyIo", Test_FmiCountKeyIo(test_info));
     }
     utils::PrintText(utils::kDash);
 }
@@ -341,6 +347,39 @@ bool Test_FmiKeyIo(const TestInfo &test_info) {
     return result;
 }
 
+bool Test_FmiCountKeyIo(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        // Setting FM-Index parameter
+        uint32_t              q = 4;
+        fmi::FssFmiParameters params(size, q, test_info.dbg_info);
+        uint32_t              qs = utils::Pow(2, q);
+        fmi::FssFmi           fmi(params);
+        FssKeyIo              key_io(test_info.dbg_info.debug);
+        fmi::FssFmiCountKey   count_key_0, count_key_1;
+
+        // Generate FM-Index count keys
+        std::pair<fmi::FssFmiCountKey, fmi::FssFmiCountKey> count_keys = fmi.GenerateCountKeys(qs - 1);
+
+        // Write and read FM-Index count keys
+        utils::Logger::DebugLog(LOCATION, "Write FM-Index count key", test_info.dbg_info.debug);
+        key_io.WriteFssFmiCountKeyToFile(kFmiCountKeyPathP0, count_keys.first);
+        key_io.WriteFssFmiCountKeyToFile(kFmiCountKeyPathP1, count_keys.second);
+        utils::Logger::DebugLog(LOCATION, "Read FM-Index count key", test_info.dbg_info.debug);
+        key_io.ReadFssFmiCountKeyFromFile(kFmiCountKeyPathP0, params, count_key_0);
+        key_io.ReadFssFmiCountKeyFromFile(kFmiCountKeyPathP1, params, count_key_1);
+
+        result &= count_key_0 == count_keys.first;
+        result &= count_key_1 == count_keys.second;
+
+        count_keys.first.FreeFssFmiCountKey();
+        count_keys.second.FreeFssFmiCountKey();
+        count_key_0.FreeFssFmiCountKey();
+        count_key_1.FreeFssFmiCountKey();
+    }
+    return result;
+}
+
 }    // namespace test
 }    // namespace internal
 }    // namespace fss
@@ -0,0 +1,258 @@
+/**
+ * @file interval_containment.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-18
+ * @copyright Copyright (c) 2024
+ * @brief Interval containment and spline gate implementation.
+ */
+
+#include "interval_containment.hpp"
+
+#include <algorithm>
+
+#include "../../fss-base/prg/seeded_rng.hpp"
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+
+namespace fss {
+namespace interval {
+
+IntervalParameters::IntervalParameters()
+    : input_bitsize(0), element_bitsize(0), debug(false), dbg_info(DebugInfo()) {
+}
+
+IntervalParameters::IntervalParameters(const uint32_t n, const uint32_t e, const DebugInfo &dbg_info)
+    : input_bitsize(n), element_bitsize(e), debug(dbg_info.debug), dbg_info(dbg_info) {
+}
+
+IntervalKey::IntervalKey()
+    : shr_in(0) {
+}
+
+void IntervalKey::PrintIntervalKey(const bool debug) const {
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Interval Key"), debug);
+    this->dcf_key.PrintDcfKey(debug);
+    utils::Logger::TraceLog(LOCATION, "Share(r_in): " + std::to_string(this->shr_in), debug);
+    utils::Logger::TraceLog(LOCATION, "Share(z): " + utils::VectorToStr(this->shr_z), debug);
+    utils::Logger::TraceLog(LOCATION, utils::kDash, debug);
+#endif
+}
+
+void IntervalKey::FreeIntervalKey() {
+    this->dcf_key.FreeDcfKey();
+}
+
+IntervalContainment::IntervalContainment(const IntervalParameters params, const std::vector<Interval> &intervals)
+    : params_(params), intervals_(intervals),
+      dcf_(dcf::DistributedComparisonFunction(dcf::DcfParameters(params.input_bitsize, params.element_bitsize, params.dbg_info))) {
+    uint32_t n = this->params_.input_bitsize;
+    uint32_t N = utils::Pow(2, n);
+    if (intervals.empty() || n >= 32) {
+        utils::Logger::FatalLog(LOCATION, "At least one interval and an input size below 32 bits are required");
+        exit(EXIT_FAILURE);
+    }
+    for (const auto &interval : intervals) {
+        if (interval.left >= interval.right || interval.right > N) {
+            utils::Logger::FatalLog(LOCATION, "Invalid interval [" + std::to_string(interval.left) + ", " + std::to_string(interval.right) + ")");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Adjacent intervals share a boundary, so the DCF is evaluated once per distinct boundary
+    for (const auto &interval : intervals) {
+        this->boundaries_.push_back(interval.left);
+        this->boundaries_.push_back(utils::Mod(interval.right, n));
+    }
+    std::sort(this->boundaries_.begin(), this->boundaries_.end());
+    this->boundaries_.erase(std::unique(this->boundaries_.begin(), this->boundaries_.end()), this->boundaries_.end());
+    for (const auto &interval : intervals) {
+        auto left  = std::lower_bound(this->boundaries_.begin(), this->boundaries_.end(), interval.left);
+        auto right = std::lower_bound(this->boundaries_.begin(), this->boundaries_.end(), utils::Mod(interval.right, n));
+        this->index_.push_back({static_cast<uint32_t>(left - this->boundaries_.begin()), static_cast<uint32_t>(right - this->boundaries_.begin())});
+    }
+}
+
+std::pair<IntervalKey, IntervalKey> IntervalContainment::GenerateKeys() const {
+    uint32_t              e = this->params_.element_bitsize;
+    std::vector<uint32_t> z;
+
+    std::pair<IntervalKey, IntervalKey> keys = this->GenerateBaseKeys(z);
+    for (uint32_t j = 0; j < z.size(); j++) {
+        uint32_t shr_z_0 = utils::Mod(tools::rng::SecureRng::Rand64(), e);
+        keys.first.shr_z.push_back(shr_z_0);
+        keys.second.shr_z.push_back(utils::Mod(z[j] - shr_z_0, e));
+    }
+
+#ifdef LOG_LEVEL_TRACE
+    utils::AddNewLine(this->params_.debug);
+    keys.first.PrintIntervalKey(this->params_.debug);
+    utils::AddNewLine(this->params_.debug);
+    keys.second.PrintIntervalKey(this->params_.debug);
+    utils::AddNewLine(this->params_.debug);
+#endif
+
+    return keys;
+}
+
+std::pair<IntervalKey, IntervalKey> IntervalContainment::GenerateKeys(const Block &seed, const uint64_t key_index) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateKeys();
+}
+
+void IntervalContainment::Evaluate(const IntervalKey &key, const uint32_t x, std::vector<uint32_t> &outputs) const {
+    std::vector<const dcf::DcfKey *> dcf_keys;
+    std::vector<uint32_t>            points, dcf_outputs;
+    this->AppendDcfInputs(key, x, dcf_keys, points);
+    this->dcf_.EvaluateAt(dcf_keys, points, dcf_outputs);
+
+    uint32_t e = this->params_.element_bitsize;
+    outputs.resize(this->intervals_.size());
+    for (uint32_t j = 0; j < this->intervals_.size(); j++) {
+        outputs[j] = utils::Mod(this->EvaluateTerm(key.dcf_key.party_id, x, dcf_outputs.data(), j) + key.shr_z[j], e);
+    }
+}
+
+void IntervalContainment::EvaluateBatch(const std::vector<IntervalKey> &keys, const std::vector<uint32_t> &x, std::vector<uint32_t> &outputs) const {
+    if (keys.size() != x.size()) {
+        utils::Logger::FatalLog(LOCATION, "The number of keys and inputs does not match");
+        exit(EXIT_FAILURE);
+    }
+    std::vector<const dcf::DcfKey *> dcf_keys;
+    std::vector<uint32_t>            points, dcf_outputs;
+    for (size_t i = 0; i < x.size(); i++) {
+        this->AppendDcfInputs(keys[i], x[i], dcf_keys, points);
+    }
+    this->dcf_.EvaluateAt(dcf_keys, points, dcf_outputs);
+
+    uint32_t e = this->params_.element_bitsize;
+    uint32_t m = this->intervals_.size();
+    uint32_t b = this->boundaries_.size();
+    outputs.resize(x.size() * m);
+    for (size_t i = 0; i < x.size(); i++) {
+        for (uint32_t j = 0; j < m; j++) {
+            outputs[i * m + j] = utils::Mod(this->EvaluateTerm(keys[i].dcf_key.party_id, x[i], dcf_outputs.data() + i * b, j) + keys[i].shr_z[j], e);
+        }
+    }
+}
+
+uint32_t IntervalContainment::GetIntervalNum() const {
+    return this->intervals_.size();
+}
+
+std::pair<IntervalKey, IntervalKey> IntervalContainment::GenerateBaseKeys(std::vector<uint32_t> &z) const {
+    uint32_t n = this->params_.input_bitsize;
+    uint32_t e = this->params_.element_bitsize;
+    uint32_t N = utils::Pow(2, n);
+
+    // The DCF outputs 1 for x < 2^n - 1 + r_in
+    uint32_t r_in  = utils::Mod(tools::rng::SecureRng::Rand64(), n);
+    uint32_t gamma = utils::Mod(N - 1 + r_in, n);
+
+    std::array<IntervalKey, 2>          keys;
+    std::pair<dcf::DcfKey, dcf::DcfKey> dcf_keys = this->dcf_.GenerateKeys(gamma, 1);
+    keys[0].dcf_key                              = std::move(dcf_keys.first);
+    keys[1].dcf_key                              = std::move(dcf_keys.second);
+    keys[0].shr_in                               = utils::Mod(tools::rng::SecureRng::Rand64(), n);
+    keys[1].shr_in                               = utils::Mod(r_in - keys[0].shr_in, n);
+
+    // Correction term of [p, q] = [left, right - 1] (wrap-arounds of the masked bounds)
+    z.resize(this->intervals_.size());
+    for (uint32_t j = 0; j < this->intervals_.size(); j++) {
+        uint32_t p        = this->intervals_[j].left;
+        uint32_t q        = this->intervals_[j].right - 1;
+        uint32_t q_prime  = utils::Mod(q + 1, n);
+        uint32_t alpha_p  = utils::Mod(p + r_in, n);
+        uint32_t alpha_q  = utils::Mod(q + r_in, n);
+        uint32_t alpha_qp = utils::Mod(q + 1 + r_in, n);
+        z[j]              = utils::Mod((alpha_p > alpha_q) - (alpha_p > p) + (alpha_qp > q_prime) + (alpha_q == N - 1), e);
+    }
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "r_in: " + std::to_string(r_in) + ", gamma: " + std::to_string(gamma), this->params_.debug);
+    utils::Logger::TraceLog(LOCATION, "z: " + utils::VectorToStr(z), this->params_.debug);
+#endif
+    return std::make_pair(std::move(keys[0]), std::move(keys[1]));
+}
+
+void IntervalContainment::AppendDcfInputs(const IntervalKey &key, const uint32_t x, std::vector<const dcf::DcfKey *> &keys, std::vector<uint32_t> &points) const {
+    uint32_t n = this->params_.input_bitsize;
+    uint32_t N = utils::Pow(2, n);
+    for (const auto boundary : this->boundaries_) {
+        keys.push_back(&key.dcf_key);
+        points.push_back(utils::Mod(x + N - 1 - boundary, n));
+    }
+}
+
+uint32_t IntervalContainment::EvaluateTerm(const uint32_t party_id, const uint32_t x, const uint32_t *dcf_outputs, const uint32_t j) const {
+    uint32_t p       = this->boundaries_[this->index_[j][0]];
+    uint32_t q_prime = this->boundaries_[this->index_[j][1]];
+    return party_id * ((x > p) - (x > q_prime)) - dcf_outputs[this->index_[j][0]] + dcf_outputs[this->index_[j][1]];
+}
+
+SplineGate::SplineGate(const IntervalParameters params, const std::vector<Interval> &intervals, const std::vector<uint32_t> &values)
+    : ic_(params, intervals), values_(values) {
+    if (values.size() != intervals.size()) {
+        utils::Logger::FatalLog(LOCATION, "The number of values and intervals does not match");
+        exit(EXIT_FAILURE);
+    }
+}
+
+std::pair<IntervalKey, IntervalKey> SplineGate::GenerateKeys() const {
+    uint32_t              e = this->ic_.params_.element_bitsize;
+    std::vector<uint32_t> z;
+
+    std::pair<IntervalKey, IntervalKey> keys     = this->ic_.GenerateBaseKeys(z);
+    uint32_t                            z_spline = 0;
+    for (uint32_t j = 0; j < z.size(); j++) {
+        z_spline = utils::Mod(z_spline + this->values_[j] * z[j], e);
+    }
+    uint32_t shr_z_0 = utils::Mod(tools::rng::SecureRng::Rand64(), e);
+    keys.first.shr_z.push_back(shr_z_0);
+    keys.second.shr_z.push_back(utils::Mod(z_spline - shr_z_0, e));
+    return keys;
+}
+
+std::pair<IntervalKey, IntervalKey> SplineGate::GenerateKeys(const Block &seed, const uint64_t key_index) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateKeys();
+}
+
+uint32_t SplineGate::Evaluate(const IntervalKey &key, const uint32_t x) const {
+    std::vector<const dcf::DcfKey *> dcf_keys;
+    std::vector<uint32_t>            points, dcf_outputs;
+    this->ic_.AppendDcfInputs(key, x, dcf_keys, points);
+    this->ic_.dcf_.EvaluateAt(dcf_keys, points, dcf_outputs);
+
+    uint32_t output = key.shr_z[0];
+    for (uint32_t j = 0; j < this->values_.size(); j++) {
+        output += this->values_[j] * this->ic_.EvaluateTerm(key.dcf_key.party_id, x, dcf_outputs.data(), j);
+    }
+    return utils::Mod(output, this->ic_.params_.element_bitsize);
+}
+
+void SplineGate::EvaluateBatch(const std::vector<IntervalKey> &keys, const std::vector<uint32_t> &x, std::vector<uint32_t> &outputs) const {
+    if (keys.size() != x.size()) {
+        utils::Logger::FatalLog(LOCATION, "The number of keys and inputs does not match");
+        exit(EXIT_FAILURE);
+    }
+    std::vector<const dcf::DcfKey *> dcf_keys;
+    std::vector<uint32_t>            points, dcf_outputs;
+    for (size_t i = 0; i < x.size(); i++) {
+        this->ic_.AppendDcfInputs(keys[i], x[i], dcf_keys, points);
+    }
+    this->ic_.dcf_.EvaluateAt(dcf_keys, points, dcf_outputs);
+
+    uint32_t b = this->ic_.boundaries_.size();
+    outputs.resize(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        uint32_t output = keys[i].shr_z[0];
+        for (uint32_t j = 0; j < this->values_.size(); j++) {
+            output += this->values_[j] * this->ic_.EvaluateTerm(keys[i].dcf_key.party_id, x[i], dcf_outputs.data() + i * b, j);
+        }
+        outputs[i] = utils::Mod(output, this->ic_.params_.element_bitsize);
+    }
+}
+
+}    // namespace interval
+}    // namespace fss
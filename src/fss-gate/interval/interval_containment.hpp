@@ -0,0 +1,249 @@
+/**
+ * @file interval_containment.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-18
+ * @copyright Copyright (c) 2024
+ * @brief Interval containment and spline gate classes.
+ */
+
+#ifndef INTERVAL_INTERVAL_CONTAINMENT_H_
+#define INTERVAL_INTERVAL_CONTAINMENT_H_
+
+#include <array>
+#include <vector>
+
+#include "../../fss-base/dcf/distributed_comparison_function.hpp"
+#include "../../tools/secret_sharing.hpp"
+
+namespace fss {
+namespace interval {
+
+/**
+ * @struct IntervalParameters
+ * @brief A struct to hold params for the IntervalContainment and SplineGate.
+ */
+struct IntervalParameters {
+    const uint32_t  input_bitsize;   /**< The size of input in bits. */
+    const uint32_t  element_bitsize; /**< The size of each element in bits. */
+    const bool      debug;           /**< Toggle this flag to enable/disable debugging. */
+    const DebugInfo dbg_info;        /**< Debug information. */
+
+    /**
+     * @brief Default constructor for IntervalParameters.
+     */
+    IntervalParameters();
+
+    /**
+     * @brief Parameterized constructor for IntervalParameters.
+     * @param n The input bitsize.
+     * @param e The element bitsize.
+     * @param dbg_info Debug information.
+     */
+    IntervalParameters(const uint32_t n, const uint32_t e, const DebugInfo &dbg_info);
+};
+
+/**
+ * @struct Interval
+ * @brief A public interval [left, right) of the input domain (0 <= left < right <= 2^n).
+ */
+struct Interval {
+    uint32_t left;  /**< The lower bound (inclusive). */
+    uint32_t right; /**< The upper bound (exclusive). */
+};
+
+/**
+ * @struct IntervalKey
+ * @brief A struct representing a key for the interval containment and spline gates.
+ *
+ * A single DCF key is shared by all intervals, since the comparison point depends only on the input mask.
+ */
+struct IntervalKey {
+    dcf::DcfKey           dcf_key; /**< The DCF key (x < 2^n - 1 + r_in). */
+    uint32_t              shr_in;  /**< Share of the input mask r_in. */
+    std::vector<uint32_t> shr_z;   /**< Shares of the correction terms (one per interval, or one for a spline). */
+
+    /**
+     * @brief Default constructor for IntervalKey.
+     */
+    IntervalKey();
+
+    /**
+     * @brief Copy constructor is deleted to prevent copying of IntervalKey.
+     */
+    IntervalKey(const IntervalKey &) = delete;
+
+    /**
+     * @brief Copy assignment operator is deleted to prevent copying of IntervalKey.
+     */
+    IntervalKey &operator=(const IntervalKey &) = delete;
+
+    /**
+     * @brief Move constructor for IntervalKey.
+     */
+    IntervalKey(IntervalKey &&) noexcept = default;
+
+    /**
+     * @brief Move assignment operator for IntervalKey.
+     */
+    IntervalKey &operator=(IntervalKey &&) noexcept = default;
+
+    bool operator==(const IntervalKey &rhs) const {
+        return this->dcf_key == rhs.dcf_key && this->shr_in == rhs.shr_in && this->shr_z == rhs.shr_z;
+    }
+
+    bool operator!=(const IntervalKey &rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Print the details of the IntervalKey.
+     * @param debug Toggle this flag to enable/disable debugging.
+     */
+    void PrintIntervalKey(const bool debug) const;
+
+    /**
+     * @brief Free the resources associated with the IntervalKey.
+     */
+    void FreeIntervalKey();
+};
+
+/**
+ * @class IntervalContainment
+ * @brief The interval containment gate of Boyle et al. (EUROCRYPT 2021) on the DCF.
+ *
+ * For the masked input x + r_in (opened once), each party outputs shares of 1[x in I_j] for every interval I_j.
+ * The key is one DCF key plus one correction share per interval, and the evaluation is local:
+ * the DCF is evaluated once per distinct interval boundary.
+ */
+class IntervalContainment {
+public:
+    /**
+     * @brief Constructor for IntervalContainment.
+     * @param params The parameters for IntervalContainment.
+     * @param intervals The public intervals.
+     */
+    IntervalContainment(const IntervalParameters params, const std::vector<Interval> &intervals);
+
+    /**
+     * @brief Generate a pair of IntervalKey (one correction share per interval).
+     * @return A pair of IntervalKey.
+     */
+    std::pair<IntervalKey, IntervalKey> GenerateKeys() const;
+
+    /**
+     * @brief Generate a pair of IntervalKey from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<IntervalKey, IntervalKey> GenerateKeys(const Block &seed, const uint64_t key_index) const;
+
+    /**
+     * @brief Evaluate the interval containment for one input.
+     * @param key The IntervalKey of this party.
+     * @param x The masked input x + r_in.
+     * @param outputs The shares of 1[x in I_j] (one per interval).
+     */
+    void Evaluate(const IntervalKey &key, const uint32_t x, std::vector<uint32_t> &outputs) const;
+
+    /**
+     * @brief Evaluate the interval containment for a batch of inputs, running the DCF of all inputs in lockstep.
+     * @param keys The IntervalKey of this party (one per input).
+     * @param x The masked inputs.
+     * @param outputs The shares of 1[x_i in I_j] at outputs[i * (number of intervals) + j].
+     */
+    void EvaluateBatch(const std::vector<IntervalKey> &keys, const std::vector<uint32_t> &x, std::vector<uint32_t> &outputs) const;
+
+    /**
+     * @brief Retrieves the number of intervals.
+     * @return The number of intervals.
+     */
+    uint32_t GetIntervalNum() const;
+
+private:
+    friend class SplineGate;
+
+    const IntervalParameters                 params_;     /**< Parameters for IntervalContainment. */
+    const std::vector<Interval>              intervals_;  /**< The public intervals. */
+    const dcf::DistributedComparisonFunction dcf_;        /**< The DCF for the comparisons. */
+    std::vector<uint32_t>                    boundaries_; /**< The distinct boundaries (left and right mod 2^n). */
+    std::vector<std::array<uint32_t, 2>>     index_;      /**< Indices of the boundaries of each interval. */
+
+    /**
+     * @brief Generate the DCF keys and the input mask, and compute the plain correction terms of each interval.
+     */
+    std::pair<IntervalKey, IntervalKey> GenerateBaseKeys(std::vector<uint32_t> &z) const;
+
+    /**
+     * @brief Compute the DCF inputs of one masked input (one per boundary).
+     */
+    void AppendDcfInputs(const IntervalKey &key, const uint32_t x, std::vector<const dcf::DcfKey *> &keys, std::vector<uint32_t> &points) const;
+
+    /**
+     * @brief Compute the share of 1[x in I_j] without the correction term from the DCF outputs of the boundaries.
+     */
+    uint32_t EvaluateTerm(const uint32_t party_id, const uint32_t x, const uint32_t *dcf_outputs, const uint32_t j) const;
+};
+
+/**
+ * @class SplineGate
+ * @brief Piecewise-constant function with public values on public intervals: sum_j values[j] * 1[x in I_j].
+ *
+ * The key has the same DCF key as IntervalContainment and a single correction share,
+ * and the output is obtained with the same single masked opening.
+ */
+class SplineGate {
+public:
+    /**
+     * @brief Constructor for SplineGate.
+     * @param params The parameters for SplineGate.
+     * @param intervals The public intervals.
+     * @param values The public value of each interval.
+     */
+    SplineGate(const IntervalParameters params, const std::vector<Interval> &intervals, const std::vector<uint32_t> &values);
+
+    /**
+     * @brief Generate a pair of IntervalKey (one correction share).
+     * @return A pair of IntervalKey.
+     */
+    std::pair<IntervalKey, IntervalKey> GenerateKeys() const;
+
+    /**
+     * @brief Generate a pair of IntervalKey from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<IntervalKey, IntervalKey> GenerateKeys(const Block &seed, const uint64_t key_index) const;
+
+    /**
+     * @brief Evaluate the spline for one input.
+     * @param key The IntervalKey of this party.
+     * @param x The masked input x + r_in.
+     * @return The share of the spline value.
+     */
+    uint32_t Evaluate(const IntervalKey &key, const uint32_t x) const;
+
+    /**
+     * @brief Evaluate the spline for a batch of inputs, running the DCF of all inputs in lockstep.
+     * @param keys The IntervalKey of this party (one per input).
+     * @param x The masked inputs.
+     * @param outputs The shares of the spline values.
+     */
+    void EvaluateBatch(const std::vector<IntervalKey> &keys, const std::vector<uint32_t> &x, std::vector<uint32_t> &outputs) const;
+
+private:
+    const IntervalContainment   ic_;     /**< The interval containment gate. */
+    const std::vector<uint32_t> values_; /**< The public value of each interval. */
+};
+
+namespace test {
+
+void Test_Interval(tools::secret_sharing::Party &party, TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace interval
+}    // namespace fss
+
+#endif    // INTERVAL_INTERVAL_CONTAINMENT_H_
@@ -0,0 +1,251 @@
+/**
+ * @file interval_containment_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-18
+ * @copyright Copyright (c) 2024
+ * @brief Interval containment and spline gate test implementation.
+ */
+
+#include "interval_containment.hpp"
+
+#include <thread>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/file_io.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+#include "../internal/fsskey_io.hpp"
+
+namespace {
+
+const std::string kCurrentPath            = utils::GetCurrentDirectory();
+const std::string kTestIntervalPath       = kCurrentPath + "/data/test/interval/";
+const std::string kIntervalKeyPath_P0     = kTestIntervalPath + "key_0_";
+const std::string kIntervalKeyPath_P1     = kTestIntervalPath + "key_1_";
+const std::string kSplineKeyPath_P0       = kTestIntervalPath + "spline_key_0_";
+const std::string kSplineKeyPath_P1       = kTestIntervalPath + "spline_key_1_";
+const std::string kIntervalDataPath_X     = kTestIntervalPath + "data_";
+const std::string kIntervalSharePath_X_P0 = kTestIntervalPath + "sh_0_";
+const std::string kIntervalSharePath_X_P1 = kTestIntervalPath + "sh_1_";
+
+constexpr uint32_t kNumOfElement = 10;
+
+// Overlapping, adjacent and full-range intervals of [0, 2^n)
+std::vector<fss::interval::Interval> TestIntervals(const uint32_t n) {
+    uint32_t N = utils::Pow(2, n);
+    return {{0, 1}, {1, N / 4}, {N / 4, N / 2}, {N / 2 + 3, N}, {5, N}, {0, N}};
+}
+
+std::vector<uint32_t> TestValues(const uint32_t n) {
+    return {3, 5, 7, 11, 13, 17};
+}
+
+bool InInterval(const fss::interval::Interval &interval, const uint32_t x) {
+    return interval.left <= x && x < interval.right;
+}
+
+uint32_t SplineValue(const std::vector<fss::interval::Interval> &intervals, const std::vector<uint32_t> &values, const uint32_t x, const uint32_t e) {
+    uint32_t value = 0;
+    for (size_t j = 0; j < intervals.size(); j++) {
+        value += InInterval(intervals[j], x) ? values[j] : 0;
+    }
+    return utils::Mod(value, e);
+}
+
+}    // namespace
+
+namespace fss {
+namespace interval {
+namespace test {
+
+bool Test_IntervalOffline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_IntervalOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+
+void Test_Interval(tools::secret_sharing::Party &party, TestInfo &test_info) {
+    std::vector<std::string> modes         = {"Interval containment unit tests", "IntervalOffline", "IntervalOnline"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        if (party.GetId() == 0) {
+            utils::PrintTestResult("Test_IntervalOffline", Test_IntervalOffline(party, test_info));
+        } else {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        utils::PrintTestResult("Test_IntervalOnline", Test_IntervalOnline(party, test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_IntervalOffline", Test_IntervalOffline(party, test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_IntervalOnline", Test_IntervalOnline(party, test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_IntervalOffline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        // Set parameters
+        IntervalParameters                           params(size, size, test_info.dbg_info);
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        tools::secret_sharing::ShareHandler          sh;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        std::vector<Interval>                        intervals = TestIntervals(size);
+        std::vector<uint32_t>                        values    = TestValues(size);
+        IntervalContainment                          ic(params, intervals);
+        SplineGate                                   spline(params, intervals, values);
+
+        // Check every input of the domain with both keys
+        std::pair<IntervalKey, IntervalKey> ic_keys     = ic.GenerateKeys();
+        std::pair<IntervalKey, IntervalKey> spline_keys = spline.GenerateKeys();
+        uint32_t                            r_ic        = utils::Mod(ic_keys.first.shr_in + ic_keys.second.shr_in, size);
+        uint32_t                            r_spline    = utils::Mod(spline_keys.first.shr_in + spline_keys.second.shr_in, size);
+        std::vector<uint32_t>               xr_0, y_0, y_1, batch_0, batch_1;
+        std::vector<IntervalKey>            batch_keys_0, batch_keys_1;
+        for (uint32_t x = 0; x < utils::Pow(2, size); x++) {
+            uint32_t xr = utils::Mod(x + r_ic, size);
+            ic.Evaluate(ic_keys.first, xr, y_0);
+            ic.Evaluate(ic_keys.second, xr, y_1);
+            for (size_t j = 0; j < intervals.size(); j++) {
+                result &= (utils::Mod(y_0[j] + y_1[j], size) == InInterval(intervals[j], x));
+            }
+            uint32_t xs = utils::Mod(x + r_spline, size);
+            result &= (utils::Mod(spline.Evaluate(spline_keys.first, xs) + spline.Evaluate(spline_keys.second, xs), size) == SplineValue(intervals, values, x, size));
+        }
+
+        // The batch evaluation matches the evaluation of each input
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            std::pair<IntervalKey, IntervalKey> keys = ic.GenerateKeys();
+            uint32_t                            r_in = utils::Mod(keys.first.shr_in + keys.second.shr_in, size);
+            xr_0.push_back(utils::Mod(tools::rng::SecureRng::Rand64() + r_in, size));
+            batch_keys_0.push_back(std::move(keys.first));
+            batch_keys_1.push_back(std::move(keys.second));
+        }
+        ic.EvaluateBatch(batch_keys_0, xr_0, batch_0);
+        ic.EvaluateBatch(batch_keys_1, xr_0, batch_1);
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            ic.Evaluate(batch_keys_0[i], xr_0[i], y_0);
+            ic.Evaluate(batch_keys_1[i], xr_0[i], y_1);
+            for (size_t j = 0; j < intervals.size(); j++) {
+                result &= (batch_0[i * intervals.size() + j] == y_0[j]) && (batch_1[i * intervals.size() + j] == y_1[j]);
+            }
+        }
+        for (auto &key : batch_keys_0) {
+            key.FreeIntervalKey();
+        }
+        for (auto &key : batch_keys_1) {
+            key.FreeIntervalKey();
+        }
+        ic_keys.first.FreeIntervalKey();
+        ic_keys.second.FreeIntervalKey();
+        spline_keys.first.FreeIntervalKey();
+        spline_keys.second.FreeIntervalKey();
+
+        // Generate input data and keys for the online test
+        std::vector<uint32_t> x(kNumOfElement);
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            x[i] = utils::Mod(tools::rng::SecureRng::Rand64(), size);
+        }
+        x[0] = 0;
+        x[1] = utils::Pow(2, size) - 1;
+        std::pair<std::vector<uint32_t>, std::vector<uint32_t>> x_sh = ss.Share(x);
+        io.WriteVectorToFile(kIntervalDataPath_X + std::to_string(size), x);
+        sh.ExportShare(kIntervalSharePath_X_P0 + std::to_string(size), kIntervalSharePath_X_P1 + std::to_string(size), x_sh);
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            std::pair<IntervalKey, IntervalKey> keys = ic.GenerateKeys();
+            key_io.WriteIntervalKeyToFile(kIntervalKeyPath_P0 + std::to_string(size) + "_" + std::to_string(i), keys.first);
+            key_io.WriteIntervalKeyToFile(kIntervalKeyPath_P1 + std::to_string(size) + "_" + std::to_string(i), keys.second);
+
+            IntervalKey key_0, key_1;
+            key_io.ReadIntervalKeyFromFile(kIntervalKeyPath_P0 + std::to_string(size) + "_" + std::to_string(i), size, intervals.size(), key_0);
+            key_io.ReadIntervalKeyFromFile(kIntervalKeyPath_P1 + std::to_string(size) + "_" + std::to_string(i), size, intervals.size(), key_1);
+            result &= (keys.first == key_0) & (keys.second == key_1);
+
+            std::pair<IntervalKey, IntervalKey> s_keys = spline.GenerateKeys();
+            key_io.WriteIntervalKeyToFile(kSplineKeyPath_P0 + std::to_string(size) + "_" + std::to_string(i), s_keys.first);
+            key_io.WriteIntervalKeyToFile(kSplineKeyPath_P1 + std::to_string(size) + "_" + std::to_string(i), s_keys.second);
+
+            keys.first.FreeIntervalKey();
+            keys.second.FreeIntervalKey();
+            key_0.FreeIntervalKey();
+            key_1.FreeIntervalKey();
+            s_keys.first.FreeIntervalKey();
+            s_keys.second.FreeIntervalKey();
+        }
+        utils::Logger::DebugLog(LOCATION, "Domain size: " + std::to_string(size) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_IntervalOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        IntervalParameters                           params(size, size, test_info.dbg_info);
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        std::vector<Interval>                        intervals = TestIntervals(size);
+        std::vector<uint32_t>                        values    = TestValues(size);
+        IntervalContainment                          ic(params, intervals);
+        SplineGate                                   spline(params, intervals, values);
+        uint32_t                                     id = party.GetId();
+
+        // Read keys and input data
+        std::vector<IntervalKey> ic_keys(kNumOfElement), spline_keys(kNumOfElement);
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            key_io.ReadIntervalKeyFromFile((id == 0 ? kIntervalKeyPath_P0 : kIntervalKeyPath_P1) + std::to_string(size) + "_" + std::to_string(i), size, intervals.size(), ic_keys[i]);
+            key_io.ReadIntervalKeyFromFile((id == 0 ? kSplineKeyPath_P0 : kSplineKeyPath_P1) + std::to_string(size) + "_" + std::to_string(i), size, 1, spline_keys[i]);
+        }
+        std::vector<uint32_t> x, x_sh;
+        io.ReadVectorFromFile(kIntervalDataPath_X + std::to_string(size), x);
+        io.ReadVectorFromFile((id == 0 ? kIntervalSharePath_X_P0 : kIntervalSharePath_X_P1) + std::to_string(size), x_sh);
+
+        // Open x + r_in of all inputs in one round
+        std::vector<uint32_t> xr_sh(2 * kNumOfElement), xr_other(2 * kNumOfElement), xr(2 * kNumOfElement);
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            xr_sh[i]                 = utils::Mod(x_sh[i] + ic_keys[i].shr_in, size);
+            xr_sh[kNumOfElement + i] = utils::Mod(x_sh[i] + spline_keys[i].shr_in, size);
+        }
+        party.StartCommunication();
+        if (id == 0) {
+            ss.Reconst(party, xr_sh, xr_other, xr);
+        } else {
+            ss.Reconst(party, xr_other, xr_sh, xr);
+        }
+        std::vector<uint32_t> xr_ic(xr.begin(), xr.begin() + kNumOfElement), xr_spline(xr.begin() + kNumOfElement, xr.end());
+
+        // Evaluate all inputs and open the results in one round
+        std::vector<uint32_t> y_ic, y_spline, y_other, y;
+        ic.EvaluateBatch(ic_keys, xr_ic, y_ic);
+        spline.EvaluateBatch(spline_keys, xr_spline, y_spline);
+        y_ic.insert(y_ic.end(), y_spline.begin(), y_spline.end());
+        y_other.resize(y_ic.size());
+        y.resize(y_ic.size());
+        if (id == 0) {
+            ss.Reconst(party, y_ic, y_other, y);
+        } else {
+            ss.Reconst(party, y_other, y_ic, y);
+        }
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            for (size_t j = 0; j < intervals.size(); j++) {
+                result &= (y[i * intervals.size() + j] == InInterval(intervals[j], x[i]));
+            }
+            result &= (y[kNumOfElement * intervals.size() + i] == SplineValue(intervals, values, x[i], size));
+            utils::Logger::DebugLog(LOCATION, "x: " + std::to_string(x[i]) + ", spline: " + std::to_string(y[kNumOfElement * intervals.size() + i]), test_info.dbg_info.debug);
+        }
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            ic_keys[i].FreeIntervalKey();
+            spline_keys[i].FreeIntervalKey();
+        }
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace interval
+}    // namespace fss
@@ -0,0 +1,260 @@
+/**
+ * @file batch_pir.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-02
+ * @copyright Copyright (c) 2024
+ * @brief BatchPir implementation.
+ */
+
+#include "batch_pir.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+utils::Counter &BatchPirQueryCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_pir_batch_queries_total", "Number of batches answered by BatchPir.");
+    return counter;
+}
+
+utils::Histogram &BatchPirEvalLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_pir_batch_eval_seconds", "Latency of the evaluation of every bucket of a batch.");
+    return histogram;
+}
+
+// SplitMix64 finalizer of (index, seed, hash number)
+uint64_t HashIndex(const uint32_t index, const uint64_t seed, const uint32_t k) {
+    uint64_t z = seed + (static_cast<uint64_t>(index) << 2) + k + 1;
+    z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z          = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+std::array<uint32_t, fss::pir::kCuckooHashNum> ComputeCandidates(const fss::pir::BatchPirParameters &params, const uint32_t index) {
+    std::array<uint32_t, fss::pir::kCuckooHashNum> candidates;
+    for (uint32_t k = 0; k < fss::pir::kCuckooHashNum; k++) {
+        candidates[k] = static_cast<uint32_t>(HashIndex(index, params.hash_seed, k) % params.bucket_num);
+    }
+    return candidates;
+}
+
+// Store every index of the database in each of its distinct candidate buckets (ascending, since the indices are visited in order)
+std::vector<std::vector<uint32_t>> BuildBuckets(const fss::pir::BatchPirParameters &params) {
+    std::vector<std::vector<uint32_t>> buckets(params.bucket_num);
+    uint32_t                           n = utils::Pow(2, params.database_bitsize);
+    for (uint32_t i = 0; i < n; i++) {
+        std::array<uint32_t, fss::pir::kCuckooHashNum> candidates = ComputeCandidates(params, i);
+        for (uint32_t k = 0; k < fss::pir::kCuckooHashNum; k++) {
+            if (std::find(candidates.begin(), candidates.begin() + k, candidates[k]) == candidates.begin() + k) {
+                buckets[candidates[k]].push_back(i);
+            }
+        }
+    }
+    return buckets;
+}
+
+uint32_t ComputeBucketBitsize(const std::vector<std::vector<uint32_t>> &buckets) {
+    size_t max_size = 0;
+    for (const auto &bucket : buckets) {
+        max_size = std::max(max_size, bucket.size());
+    }
+    uint32_t bitsize = fss::pir::kMinBucketBitsize;
+    while ((static_cast<size_t>(1) << bitsize) < max_size) {
+        bitsize++;
+    }
+    return bitsize;
+}
+
+}    // namespace
+
+namespace fss {
+namespace pir {
+
+BatchPirParameters::BatchPirParameters(const uint32_t n, const uint32_t e, const uint32_t b, const DebugInfo &dbg_info, const uint64_t seed)
+    : database_bitsize(n), element_bitsize(e), batch_size(b), bucket_num(std::max<uint32_t>((3 * b + 1) / 2, kCuckooHashNum)), hash_seed(seed), debug(dbg_info.debug), dbg_info(dbg_info) {
+}
+
+void BatchPirKey::FreeBatchPirKey() {
+    for (auto &dpf_key : this->dpf_keys) {
+        dpf_key.FreeDpfKey();
+    }
+}
+
+BatchPir::BatchPir(const BatchPirParameters params)
+    : params_(params),
+      buckets_(BuildBuckets(params)),
+      bucket_bitsize_(ComputeBucketBitsize(this->buckets_)),
+      dpf_(dpf::DpfParameters(this->bucket_bitsize_, params.element_bitsize, params.dbg_info)) {
+}
+
+uint32_t BatchPir::GetBucketNum() const {
+    return this->params_.bucket_num;
+}
+
+uint32_t BatchPir::GetBucketBitsize() const {
+    return this->bucket_bitsize_;
+}
+
+const std::vector<uint32_t> &BatchPir::GetBucket(const uint32_t bucket) const {
+    return this->buckets_[bucket];
+}
+
+bool BatchPir::AssignBuckets(const std::vector<uint32_t> &indices, std::vector<uint32_t> &slots) const {
+    uint32_t n = utils::Pow(2, this->params_.database_bitsize);
+    if (indices.size() > this->params_.batch_size) {
+        utils::Logger::ErrorLog(LOCATION, "The number of indices exceeds the batch size (" + std::to_string(indices.size()) + " > " + std::to_string(this->params_.batch_size) + ")");
+        return false;
+    }
+
+    // The index held by each bucket (n: empty)
+    std::vector<uint32_t> owners(this->params_.bucket_num, n);
+    for (const uint32_t index : indices) {
+        if (index >= n) {
+            utils::Logger::ErrorLog(LOCATION, "The index is out of range (" + std::to_string(index) + ")");
+            return false;
+        }
+        std::array<uint32_t, kCuckooHashNum> candidates = this->GetCandidates(index);
+        if (std::any_of(candidates.begin(), candidates.end(), [&](const uint32_t b) { return owners[b] == index; })) {
+            continue;    // Duplicate index
+        }
+
+        // Random-walk cuckoo insertion
+        uint32_t current = index;
+        bool     placed  = false;
+        for (uint32_t eviction = 0; eviction <= kCuckooMaxEvictions && !placed; eviction++) {
+            candidates = this->GetCandidates(current);
+            for (const uint32_t b : candidates) {
+                if (owners[b] == n) {
+                    owners[b] = current;
+                    placed    = true;
+                    break;
+                }
+            }
+            if (!placed) {
+                uint32_t b = candidates[tools::rng::SecureRng::Rand64() % kCuckooHashNum];
+                std::swap(owners[b], current);
+            }
+        }
+        if (!placed) {
+            utils::Logger::ErrorLog(LOCATION, "The cuckoo hashing failed after " + std::to_string(kCuckooMaxEvictions) + " evictions");
+            return false;
+        }
+    }
+
+    slots.resize(indices.size());
+    for (size_t j = 0; j < indices.size(); j++) {
+        std::array<uint32_t, kCuckooHashNum> candidates = this->GetCandidates(indices[j]);
+        slots[j]                                        = *std::find_if(candidates.begin(), candidates.end(), [&](const uint32_t b) { return owners[b] == indices[j]; });
+    }
+    return true;
+}
+
+bool BatchPir::GenerateKeys(const std::vector<uint32_t> &indices, std::pair<BatchPirKey, BatchPirKey> &keys, std::vector<uint32_t> &slots) const {
+    if (!this->AssignBuckets(indices, slots)) {
+        return false;
+    }
+    uint32_t m = this->params_.bucket_num;
+
+    // The position of the index of each occupied bucket
+    std::vector<uint32_t> alpha(m), beta(m, 0);
+    for (size_t j = 0; j < indices.size(); j++) {
+        alpha[slots[j]] = this->GetPosition(slots[j], indices[j]);
+        beta[slots[j]]  = 1;
+    }
+
+    keys.first.dpf_keys.clear();
+    keys.second.dpf_keys.clear();
+    keys.first.dpf_keys.reserve(m);
+    keys.second.dpf_keys.reserve(m);
+    for (uint32_t b = 0; b < m; b++) {
+        if (beta[b] == 0) {
+            alpha[b] = utils::Mod(tools::rng::SecureRng::Rand64(), this->bucket_bitsize_);
+        }
+        std::pair<dpf::DpfKey, dpf::DpfKey> dpf_keys = this->dpf_.GenerateKeys(alpha[b], beta[b]);
+        keys.first.dpf_keys.push_back(std::move(dpf_keys.first));
+        keys.second.dpf_keys.push_back(std::move(dpf_keys.second));
+    }
+    return true;
+}
+
+void BatchPir::SetDatabase(const std::vector<uint32_t> &database) {
+    uint32_t n = utils::Pow(2, this->params_.database_bitsize);
+    if (database.size() != n) {
+        utils::Logger::FatalLog(LOCATION, "The size of the database does not match the database bitsize (" + std::to_string(database.size()) + " != " + std::to_string(n) + ")");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t domain = static_cast<uint64_t>(1) << this->bucket_bitsize_;
+    this->tables_.assign(domain * this->params_.bucket_num, 0);
+    for (uint32_t b = 0; b < this->params_.bucket_num; b++) {
+        for (size_t x = 0; x < this->buckets_[b].size(); x++) {
+            this->tables_[b * domain + x] = utils::Mod(database[this->buckets_[b][x]], this->params_.element_bitsize);
+        }
+    }
+}
+
+void BatchPir::Evaluate(const BatchPirKey &key, std::vector<uint32_t> &answers, const uint32_t thread_num) const {
+    uint32_t m = this->params_.bucket_num;
+    if (key.dpf_keys.size() != m) {
+        utils::Logger::FatalLog(LOCATION, "The number of DPF keys does not match the number of buckets (" + std::to_string(key.dpf_keys.size()) + " != " + std::to_string(m) + ")");
+        exit(EXIT_FAILURE);
+    }
+    utils::HistogramTimer latency(BatchPirEvalLatency());
+    BatchPirQueryCounter().Increment();
+
+    uint64_t domain = static_cast<uint64_t>(1) << this->bucket_bitsize_;
+    uint32_t e      = this->params_.element_bitsize;
+    answers.resize(m);
+
+    // Each thread evaluates a contiguous range of buckets into its own output buffer
+    auto evaluate_range = [&](const uint32_t begin, const uint32_t end) {
+        std::vector<uint32_t> outputs(domain);
+        for (uint32_t b = begin; b < end; b++) {
+            this->dpf_.EvaluateFullDomain(key.dpf_keys[b], outputs);
+            const uint32_t *table = this->tables_.data() + b * domain;
+            uint32_t        sum   = 0;
+            for (uint64_t x = 0; x < domain; x++) {
+                sum += outputs[x] * table[x];
+            }
+            answers[b] = utils::Mod(sum, e);
+        }
+    };
+
+    uint32_t threads = std::max<uint32_t>(1, std::min(thread_num, m));
+    if (threads == 1) {
+        evaluate_range(0, m);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (uint32_t i = 0; i < threads; i++) {
+        workers.emplace_back(evaluate_range, static_cast<uint32_t>(static_cast<uint64_t>(m) * i / threads), static_cast<uint32_t>(static_cast<uint64_t>(m) * (i + 1) / threads));
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void BatchPir::Decode(const std::vector<uint32_t> &answers_0, const std::vector<uint32_t> &answers_1, const std::vector<uint32_t> &slots, std::vector<uint32_t> &outputs) const {
+    outputs.resize(slots.size());
+    for (size_t j = 0; j < slots.size(); j++) {
+        outputs[j] = utils::Mod(answers_0[slots[j]] + answers_1[slots[j]], this->params_.element_bitsize);
+    }
+}
+
+std::array<uint32_t, kCuckooHashNum> BatchPir::GetCandidates(const uint32_t index) const {
+    return ComputeCandidates(this->params_, index);
+}
+
+uint32_t BatchPir::GetPosition(const uint32_t bucket, const uint32_t index) const {
+    const std::vector<uint32_t> &entries = this->buckets_[bucket];
+    return static_cast<uint32_t>(std::lower_bound(entries.begin(), entries.end(), index) - entries.begin());
+}
+
+}    // namespace pir
+}    // namespace fss
@@ -0,0 +1,211 @@
+/**
+ * @file batch_pir.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-02
+ * @copyright Copyright (c) 2024
+ * @brief BatchPir class (many-index retrieval with cuckoo-hashed buckets of small-domain DPFs).
+ */
+
+#ifndef PIR_BATCH_PIR_H_
+#define PIR_BATCH_PIR_H_
+
+#include <array>
+
+#include "../../fss-base/dpf/distributed_point_function.hpp"
+#include "../../utils/huge_page.hpp"
+
+namespace fss {
+namespace pir {
+
+constexpr uint32_t kCuckooHashNum      = 3;                        // The number of candidate buckets of an index
+constexpr uint32_t kCuckooMaxEvictions = 500;                      // The number of evictions before the insertion fails
+constexpr uint32_t kMinBucketBitsize   = 2;                        // The full-domain evaluation of the DPF needs at least 4 leaves
+constexpr uint64_t kDefaultHashSeed    = 0x9e3779b97f4a7c15ULL;    // The public seed of the hash functions
+
+/**
+ * @struct BatchPirParameters
+ * @brief A struct to hold params for BatchPir.
+ */
+struct BatchPirParameters {
+    const uint32_t  database_bitsize; /**< The size of the database in bits (N = 2^n entries). */
+    const uint32_t  element_bitsize;  /**< The size of each entry in bits. */
+    const uint32_t  batch_size;       /**< The maximum number of indices per batch (B). */
+    const uint32_t  bucket_num;       /**< The number of buckets (M = ceil(1.5 B)). */
+    const uint64_t  hash_seed;        /**< The public seed of the kCuckooHashNum hash functions. */
+    const bool      debug;            /**< Debug utils::Mode flag. */
+    const DebugInfo dbg_info;         /**< Debug information. */
+
+    /**
+     * @brief Parameterized constructor for BatchPirParameters.
+     * @param n The database bitsize.
+     * @param e The element bitsize.
+     * @param b The maximum number of indices per batch.
+     * @param dbg_info Debug information.
+     * @param seed The public seed of the hash functions.
+     */
+    BatchPirParameters(const uint32_t n, const uint32_t e, const uint32_t b, const DebugInfo &dbg_info, const uint64_t seed = kDefaultHashSeed);
+};
+
+/**
+ * @struct BatchPirKey
+ * @brief A key for BatchPir (one DPF key per bucket; the keys of the empty buckets select nothing).
+ */
+struct BatchPirKey {
+    std::vector<dpf::DpfKey> dpf_keys; /**< The DPF keys of the buckets. */
+
+    /**
+     * @brief Default constructor for BatchPirKey.
+     */
+    BatchPirKey(){};
+
+    /**
+     * @brief Copy constructor (deleted).
+     */
+    BatchPirKey(const BatchPirKey &) = delete;
+
+    /**
+     * @brief Copy assignment operator (deleted).
+     */
+    BatchPirKey &operator=(const BatchPirKey &) = delete;
+
+    /**
+     * @brief Move constructor (default).
+     */
+    BatchPirKey(BatchPirKey &&) noexcept = default;
+
+    /**
+     * @brief Move assignment operator (default).
+     */
+    BatchPirKey &operator=(BatchPirKey &&) noexcept = default;
+
+    bool operator==(const BatchPirKey &rhs) const {
+        return this->dpf_keys == rhs.dpf_keys;
+    }
+
+    bool operator!=(const BatchPirKey &rhs) const {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief Free the resources associated with the BatchPirKey.
+     */
+    void FreeBatchPirKey();
+};
+
+/**
+ * @class BatchPir
+ * @brief Retrieval of B secret indices of a public database with about 3N full-domain work instead of B * N.
+ *
+ * Every index i of the database is stored in its kCuckooHashNum buckets h_1(i), ..., h_3(i) (probabilistic batch
+ * code), so the buckets hold about 3N / M entries each. The client places each index of the batch into one of its
+ * buckets by cuckoo hashing and generates one DPF key per bucket over the domain of the largest bucket (beta = 0 for
+ * the empty buckets, so the servers do not learn the occupancy). Each server evaluates every bucket over its small
+ * domain and answers the inner products with the bucket entries; the client adds the two answers of the bucket of
+ * each index. The layout only depends on the public parameters.
+ */
+class BatchPir {
+public:
+    /**
+     * @brief Constructor for BatchPir (builds the bucket layout).
+     * @param params The parameters for BatchPir.
+     */
+    BatchPir(const BatchPirParameters params);
+
+    /**
+     * @brief Retrieves the number of buckets.
+     * @return The number of buckets (M).
+     */
+    uint32_t GetBucketNum() const;
+
+    /**
+     * @brief Retrieves the domain size of the DPFs of the buckets in bits.
+     * @return The bucket bitsize.
+     */
+    uint32_t GetBucketBitsize() const;
+
+    /**
+     * @brief Retrieves the indices stored in a bucket.
+     * @param bucket The bucket (0 to M - 1).
+     * @return The indices in ascending order.
+     */
+    const std::vector<uint32_t> &GetBucket(const uint32_t bucket) const;
+
+    /**
+     * @brief Place the indices of a batch into the buckets by cuckoo hashing.
+     * @param indices The indices (at most batch size; duplicates share a bucket).
+     * @param slots The bucket of each index.
+     * @return `true` if every index is placed.
+     */
+    bool AssignBuckets(const std::vector<uint32_t> &indices, std::vector<uint32_t> &slots) const;
+
+    /**
+     * @brief Generate a pair of BatchPirKey for the indices (client).
+     * @param indices The indices (at most batch size).
+     * @param keys The pair of BatchPirKey.
+     * @param slots The bucket of each index (kept by the client for Decode).
+     * @return `true` if the keys are generated (false if the cuckoo hashing fails).
+     */
+    bool GenerateKeys(const std::vector<uint32_t> &indices, std::pair<BatchPirKey, BatchPirKey> &keys, std::vector<uint32_t> &slots) const;
+
+    /**
+     * @brief Set the database and copy its entries into the buckets (server).
+     * @param database The entries (size: 2^database_bitsize).
+     */
+    void SetDatabase(const std::vector<uint32_t> &database);
+
+    /**
+     * @brief Evaluate the DPF of every bucket and answer its inner product with the bucket entries (server).
+     * @param key The BatchPirKey of this server.
+     * @param answers The answers of the buckets (size: M).
+     * @param thread_num The number of threads the buckets are split across.
+     */
+    void Evaluate(const BatchPirKey &key, std::vector<uint32_t> &answers, const uint32_t thread_num = 1) const;
+
+    /**
+     * @brief Reconstruct the entries of the indices from the answers of the two servers (client).
+     * @param answers_0 The answers of server 0.
+     * @param answers_1 The answers of server 1.
+     * @param slots The bucket of each index (from GenerateKeys).
+     * @param outputs The entries of the indices.
+     */
+    void Decode(const std::vector<uint32_t> &answers_0, const std::vector<uint32_t> &answers_1, const std::vector<uint32_t> &slots, std::vector<uint32_t> &outputs) const;
+
+private:
+    const BatchPirParameters            params_;         /**< The parameters for BatchPir. */
+    std::vector<std::vector<uint32_t>>  buckets_;        /**< The indices stored in each bucket. */
+    uint32_t                            bucket_bitsize_; /**< The domain size of the DPFs in bits. */
+    const dpf::DistributedPointFunction dpf_;            /**< The DPF of the buckets. */
+    utils::HugeVector<uint32_t>         tables_;         /**< The entries of the buckets (2^bucket_bitsize per bucket, zero padded). */
+
+    /**
+     * @brief Compute the candidate buckets of an index.
+     * @param index The index.
+     * @return The kCuckooHashNum buckets.
+     */
+    std::array<uint32_t, kCuckooHashNum> GetCandidates(const uint32_t index) const;
+
+    /**
+     * @brief Retrieves the position of an index in a bucket.
+     * @param bucket The bucket.
+     * @param index The index (stored in the bucket).
+     * @return The position.
+     */
+    uint32_t GetPosition(const uint32_t bucket, const uint32_t index) const;
+};
+
+namespace test {
+
+void Test_BatchPir(TestInfo &test_info);
+
+}    // namespace test
+
+namespace bench {
+
+void Bench_BatchPir(const BenchInfo &bench_info);
+
+}    // namespace bench
+
+}    // namespace pir
+}    // namespace fss
+
+#endif    // PIR_BATCH_PIR_H_
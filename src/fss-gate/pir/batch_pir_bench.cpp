@@ -0,0 +1,151 @@
+/**
+ * @file batch_pir_bench.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-02
+ * @copyright Copyright (c) 2024
+ * @brief BatchPir benchmark implementation.
+ */
+
+#include "batch_pir.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/memory.hpp"
+#include "../../utils/timer.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+constexpr uint32_t kBenchElementSize = 32;
+
+void GenerateRandomNumbers(std::vector<uint32_t> &vec, const uint32_t bitsize) {
+    // Generate random vector
+    for (size_t i = 0; i < vec.size(); i++) {
+        vec[i] = utils::Mod(tools::rng::SecureRng::Rand64(), bitsize);
+    }
+}
+
+}    // namespace
+
+namespace fss {
+namespace pir {
+namespace bench {
+
+void Bench_BatchPir(const BenchInfo &bench_info) {
+    // Define utilities
+    utils::ExecutionTimer timer_all, timer_1;
+    utils::MemoryMonitor  mem_1;
+
+    std::vector<std::string> modes         = {"Measurement of naive repeated full-domain evaluation", "Measurement of BatchPir"};
+    uint32_t                 selected_mode = bench_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+    uint32_t thread_num = std::max(1U, std::thread::hardware_concurrency());
+
+    for (const auto t : bench_info.text_size) {
+        for (const auto q : bench_info.query_size) {
+            for (uint32_t i = 0; i < bench_info.experiment_num; i++) {
+                uint32_t              n = utils::Pow(2, t);
+                uint32_t              b = utils::Pow(2, q);
+                std::vector<uint32_t> database(n), indices(b);
+                GenerateRandomNumbers(database, kBenchElementSize);
+                GenerateRandomNumbers(indices, t);
+                utils::Logger::InfoLog(LOCATION, "BatchPir: (database size, batch size) = (" + std::to_string(t) + ", " + std::to_string(b) + ")");
+
+                // Measure total time
+                std::string mode_str     = "[" + modes[selected_mode - 1] + "],";
+                std::string measure_info = "Info,Database size,Batch size,Time";
+                utils::Logger::InfoLog(LOCATION, mode_str + measure_info);
+                measure_info = "," + std::to_string(t) + "," + std::to_string(b);
+                timer_all.Start();
+                // ############# START #############
+
+                if (selected_mode == 1) {
+                    // One DPF over the whole database per index
+                    dpf::DpfParameters            params(t, kBenchElementSize, bench_info.dbg_info);
+                    dpf::DistributedPointFunction dpf(params);
+                    timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
+
+                    mem_1.Start();
+                    timer_1.Start();
+                    std::vector<std::pair<dpf::DpfKey, dpf::DpfKey>> dpf_keys;
+                    dpf_keys.reserve(b);
+                    for (const uint32_t index : indices) {
+                        dpf_keys.push_back(dpf.GenerateKeys(index, 1));
+                    }
+                    timer_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+
+                    mem_1.Start();
+                    timer_1.Start();
+                    std::vector<uint32_t> outputs(n), answers(b);
+                    for (uint32_t j = 0; j < b; j++) {
+                        dpf.EvaluateFullDomain(dpf_keys[j].first, outputs);
+                        uint32_t sum = 0;
+                        for (uint32_t x = 0; x < n; x++) {
+                            sum += outputs[x] * database[x];
+                        }
+                        answers[j] = sum;
+                    }
+                    timer_1.Print(LOCATION, mode_str + "Eval" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Eval" + measure_info);
+                    utils::Logger::InfoLog(LOCATION, mode_str + "Full-domain points" + measure_info + "," + std::to_string(static_cast<uint64_t>(n) * b));
+                    for (auto &keys : dpf_keys) {
+                        keys.first.FreeDpfKey();
+                        keys.second.FreeDpfKey();
+                    }
+
+                } else if (selected_mode == 2) {
+                    // One small-domain DPF per bucket
+                    timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
+                    mem_1.Start();
+                    timer_1.Start();
+                    BatchPirParameters params(t, kBenchElementSize, b, bench_info.dbg_info);
+                    BatchPir           pir(params);
+                    pir.SetDatabase(database);
+                    timer_1.Print(LOCATION, mode_str + "Build buckets" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Build buckets" + measure_info);
+
+                    mem_1.Start();
+                    timer_1.Start();
+                    std::pair<BatchPirKey, BatchPirKey> keys;
+                    std::vector<uint32_t>               slots;
+                    if (!pir.GenerateKeys(indices, keys, slots)) {
+                        exit(EXIT_FAILURE);
+                    }
+                    timer_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+                    mem_1.Print(LOCATION, mode_str + "Gen Key" + measure_info);
+
+                    std::vector<uint32_t> answers;
+                    for (const uint32_t threads : {1U, thread_num}) {
+                        mem_1.Start();
+                        timer_1.Start();
+                        pir.Evaluate(keys.first, answers, threads);
+                        timer_1.Print(LOCATION, mode_str + "Eval (" + std::to_string(threads) + " threads)" + measure_info);
+                        mem_1.Print(LOCATION, mode_str + "Eval (" + std::to_string(threads) + " threads)" + measure_info);
+                    }
+                    uint64_t points = static_cast<uint64_t>(pir.GetBucketNum()) << pir.GetBucketBitsize();
+                    utils::Logger::InfoLog(LOCATION, mode_str + "Full-domain points" + measure_info + "," + std::to_string(points));
+                    keys.first.FreeBatchPirKey();
+                    keys.second.FreeBatchPirKey();
+                }
+
+                // ############# END #############
+                double timer_res = timer_all.Print(LOCATION, mode_str + "Bench Total time" + measure_info);
+                if (utils::ExecutionTimer::IsExceedLimitTime(timer_res, bench_info.limit_time_ms, timer_all.GetTimeUnit())) {
+                    utils::Logger::InfoLog(LOCATION, "The execution time exceeds the limit time: " + std::to_string(timer_res) + " " + timer_all.GetTimeUnitStr());
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+}
+
+}    // namespace bench
+}    // namespace pir
+}    // namespace fss
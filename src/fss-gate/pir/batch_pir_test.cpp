@@ -0,0 +1,159 @@
+/**
+ * @file batch_pir_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-02
+ * @copyright Copyright (c) 2024
+ * @brief BatchPir test implementation.
+ */
+
+#include "batch_pir.hpp"
+
+#include <algorithm>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+
+namespace {
+
+const std::vector<uint32_t> kTestBatchSizes  = {1, 4, 16, 64};
+const std::vector<uint32_t> kTestThreadNums  = {1, 2, 4};
+constexpr uint32_t          kTestElementSize = 16;
+
+void GenerateRandomIndices(std::vector<uint32_t> &indices, const uint32_t bitsize) {
+    for (size_t i = 0; i < indices.size(); i++) {
+        indices[i] = utils::Mod(tools::rng::SecureRng::Rand64(), bitsize);
+    }
+}
+
+}    // namespace
+
+namespace fss {
+namespace pir {
+namespace test {
+
+bool Test_CuckooHash(const TestInfo &test_info);
+bool Test_BatchPirEvaluate(const TestInfo &test_info);
+
+void Test_BatchPir(TestInfo &test_info) {
+    std::vector<std::string> modes         = {"BatchPir unit tests", "CuckooHash", "BatchPir"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        utils::PrintTestResult("Test_CuckooHash", Test_CuckooHash(test_info));
+        utils::PrintTestResult("Test_BatchPirEvaluate", Test_BatchPirEvaluate(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_CuckooHash", Test_CuckooHash(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_BatchPirEvaluate", Test_BatchPirEvaluate(test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_CuckooHash(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        for (const auto b : kTestBatchSizes) {
+            BatchPirParameters params(size, kTestElementSize, b, test_info.dbg_info);
+            BatchPir           pir(params);
+
+            // Every index of the database is stored in 1 to kCuckooHashNum buckets
+            std::vector<uint32_t> copies(utils::Pow(2, size), 0);
+            for (uint32_t bucket = 0; bucket < pir.GetBucketNum(); bucket++) {
+                const std::vector<uint32_t> &entries = pir.GetBucket(bucket);
+                result &= std::is_sorted(entries.begin(), entries.end());
+                result &= entries.size() <= (1U << pir.GetBucketBitsize());
+                for (const uint32_t index : entries) {
+                    copies[index]++;
+                }
+            }
+            result &= std::all_of(copies.begin(), copies.end(), [](const uint32_t c) { return c >= 1 && c <= kCuckooHashNum; });
+
+            // The slots hold their index and the distinct indices get distinct slots
+            std::vector<uint32_t> indices(std::min(b, utils::Pow(2, size))), slots;
+            GenerateRandomIndices(indices, size);
+            indices.push_back(indices.front());    // Duplicate
+            indices.resize(std::min<size_t>(indices.size(), b));
+            result &= pir.AssignBuckets(indices, slots);
+            for (size_t j = 0; j < indices.size(); j++) {
+                const std::vector<uint32_t> &entries = pir.GetBucket(slots[j]);
+                result &= std::binary_search(entries.begin(), entries.end(), indices[j]);
+                for (size_t k = 0; k < j; k++) {
+                    result &= (indices[j] == indices[k]) == (slots[j] == slots[k]);
+                }
+            }
+            if (!result) {
+                utils::Logger::DebugLog(LOCATION, "Cuckoo hashing failed: (n, B) = (" + std::to_string(size) + ", " + std::to_string(b) + ")", test_info.dbg_info.debug);
+            }
+        }
+
+        // The batch size and the range of the indices are checked
+        BatchPirParameters    params(size, kTestElementSize, 2, test_info.dbg_info);
+        BatchPir              pir(params);
+        std::vector<uint32_t> slots;
+        result &= !pir.AssignBuckets({0, 1, 2}, slots);
+        result &= !pir.AssignBuckets({utils::Pow(2, size)}, slots);
+    }
+    return result;
+}
+
+bool Test_BatchPirEvaluate(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        std::vector<uint32_t> database(utils::Pow(2, size));
+        GenerateRandomIndices(database, kTestElementSize);
+
+        for (const auto b : kTestBatchSizes) {
+            BatchPirParameters params(size, kTestElementSize, b, test_info.dbg_info);
+            BatchPir           pir(params);
+            pir.SetDatabase(database);
+
+            std::vector<uint32_t> indices(b), slots;
+            GenerateRandomIndices(indices, size);
+            std::pair<BatchPirKey, BatchPirKey> keys;
+            if (!pir.GenerateKeys(indices, keys, slots)) {
+                return false;
+            }
+            result &= keys.first.dpf_keys.size() == pir.GetBucketNum() && keys.second.dpf_keys.size() == pir.GetBucketNum();
+
+            // The answers do not depend on the number of threads
+            std::vector<uint32_t> answers_0, answers_1, outputs;
+            pir.Evaluate(keys.first, answers_0, 1);
+            pir.Evaluate(keys.second, answers_1, 1);
+            for (const auto thread_num : kTestThreadNums) {
+                std::vector<uint32_t> answers_0_t, answers_1_t;
+                pir.Evaluate(keys.first, answers_0_t, thread_num);
+                pir.Evaluate(keys.second, answers_1_t, thread_num);
+                result &= answers_0_t == answers_0 && answers_1_t == answers_1;
+            }
+
+            pir.Decode(answers_0, answers_1, slots, outputs);
+            for (size_t j = 0; j < indices.size(); j++) {
+                if (outputs[j] != database[indices[j]]) {
+                    result = false;
+                    utils::Logger::DebugLog(LOCATION, "(n, B) = (" + std::to_string(size) + ", " + std::to_string(b) + "), index=" + std::to_string(indices[j]) + " -> Result: " + std::to_string(outputs[j]) + " (expected: " + std::to_string(database[indices[j]]) + ")", test_info.dbg_info.debug);
+                }
+            }
+
+            // The empty buckets select nothing
+            for (uint32_t bucket = 0; bucket < pir.GetBucketNum(); bucket++) {
+                if (std::find(slots.begin(), slots.end(), bucket) == slots.end()) {
+                    result &= utils::Mod(answers_0[bucket] + answers_1[bucket], kTestElementSize) == 0;
+                }
+            }
+            keys.first.FreeBatchPirKey();
+            keys.second.FreeBatchPirKey();
+        }
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace pir
+}    // namespace fss
@@ -0,0 +1,364 @@
+/**
+ * @file compressed_bwt.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-04-24
+ * @copyright Copyright (c) 2024
+ * @brief CompressedBwt implementation.
+ */
+
+#include "compressed_bwt.hpp"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "../../utils/logger.hpp"
+
+namespace {
+
+constexpr uint64_t kAllOnes = ~0ULL;
+
+uint32_t PopCount(const uint64_t *words) {
+    uint32_t count = 0;
+    for (uint32_t k = 0; k < fss::rank::kBwtBlockWords; k++) {
+        count += __builtin_popcountll(words[k]);
+    }
+    return count;
+}
+
+// Set the bits [begin, end) of the block
+void SetRun(uint64_t *words, uint32_t begin, const uint32_t end) {
+    while (begin < end) {
+        uint32_t k   = begin / 64;
+        uint32_t off = begin % 64;
+        uint32_t len = std::min(end - begin, 64 - off);
+        words[k] |= (len == 64) ? kAllOnes : (((1ULL << len) - 1) << off);
+        begin += len;
+    }
+}
+
+// Add the values of a full block to the sums of '0' and '1', expanding 4 bits of the block into a mask per vector
+void AccumulateBlock(const uint64_t *words, const uint32_t *values, __m128i &acc0, __m128i &acc1) {
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    for (uint32_t k = 0; k < 2 * fss::rank::kBwtBlockWords; k++) {
+        uint32_t half = static_cast<uint32_t>(words[k / 2] >> (32 * (k % 2)));
+        __m128i  bits = _mm_set1_epi32(static_cast<int>(half));
+        __m128i  sel  = lanes;
+        for (uint32_t j = 0; j < 8; j++) {
+            __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + 32 * k + 4 * j));
+            __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(bits, sel), sel);
+            acc1         = _mm_add_epi32(acc1, _mm_and_si128(mask, v));
+            acc0         = _mm_add_epi32(acc0, _mm_andnot_si128(mask, v));
+            sel          = _mm_slli_epi32(sel, 4);
+        }
+    }
+}
+
+// Expand the bits of a full block into one mask per character ('1' is all ones)
+void ExpandMasks(const uint64_t *words, uint32_t *masks) {
+    for (uint32_t i = 0; i < fss::rank::kBwtBlockBits; i++) {
+        masks[i] = 0U - static_cast<uint32_t>((words[i / 64] >> (i % 64)) & 1ULL);
+    }
+}
+
+// Add the values of a full block to the sums of '0' and '1' with the expanded masks
+void AccumulateMasked(const uint32_t *masks, const uint32_t *values, __m128i &acc0, __m128i &acc1) {
+    for (uint32_t j = 0; j < fss::rank::kBwtBlockBits; j += 4) {
+        __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + j));
+        __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i *>(masks + j));
+        acc1         = _mm_add_epi32(acc1, _mm_and_si128(mask, v));
+        acc0         = _mm_add_epi32(acc0, _mm_andnot_si128(mask, v));
+    }
+}
+
+// Add the values of a uniform block
+void AccumulateUniform(const uint32_t *values, __m128i &acc) {
+    for (uint32_t j = 0; j < fss::rank::kBwtBlockBits; j += 4) {
+        acc = _mm_add_epi32(acc, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + j)));
+    }
+}
+
+uint32_t HorizontalSum(const __m128i acc) {
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+}    // namespace
+
+namespace fss {
+namespace rank {
+
+CompressedBwt::CompressedBwt()
+    : length_(0), zero_count_(0), offsets_(1, 0) {
+}
+
+void CompressedBwt::Build(const std::string_view sentence) {
+    std::vector<uint64_t> bits((sentence.size() + 63) / 64, 0);
+    this->others_.clear();
+    for (uint64_t i = 0; i < sentence.size(); i++) {
+        if (sentence[i] == '1') {
+            bits[i / 64] |= 1ULL << (i % 64);
+        } else if (sentence[i] != '0') {
+            this->others_.push_back(i);
+        }
+    }
+    std::vector<uint64_t> others = std::move(this->others_);
+    this->BuildFromBits(bits, sentence.size(), sentence.size());
+    this->others_ = std::move(others);
+    this->zero_count_ -= this->others_.size();
+}
+
+void CompressedBwt::BuildFromBits(const std::vector<uint64_t> &bits, const uint64_t length, const uint64_t dollar_pos) {
+    if (bits.size() * 64 < length) {
+        utils::Logger::FatalLog(LOCATION, "The packed BWT is shorter than its length");
+        exit(EXIT_FAILURE);
+    }
+    this->length_     = length;
+    this->zero_count_ = length;
+    this->types_.clear();
+    this->offsets_.assign(1, 0);
+    this->payload_.clear();
+    this->others_.clear();
+    if (dollar_pos < length) {
+        this->others_.push_back(dollar_pos);
+        this->zero_count_--;
+    }
+
+    uint64_t words[kBwtBlockWords];
+    for (uint64_t begin = 0; begin < length; begin += kBwtBlockBits) {
+        uint32_t num = static_cast<uint32_t>(std::min<uint64_t>(kBwtBlockBits, length - begin));
+        for (uint32_t k = 0; k < kBwtBlockWords; k++) {
+            uint64_t w = begin / 64 + k;
+            words[k]   = (w < bits.size()) ? bits[w] : 0;
+        }
+        // Clear the bits past the end of the BWT
+        for (uint32_t i = num; i < kBwtBlockBits; i++) {
+            words[i / 64] &= ~(1ULL << (i % 64));
+        }
+        if (dollar_pos >= begin && dollar_pos < begin + num) {
+            words[(dollar_pos - begin) / 64] &= ~(1ULL << ((dollar_pos - begin) % 64));
+        }
+        this->zero_count_ -= PopCount(words);
+        this->AppendBlock(words, num);
+    }
+}
+
+void CompressedBwt::AppendBlock(const uint64_t *words, const uint32_t num) {
+    uint32_t ones = PopCount(words);
+    if (ones == 0) {
+        this->types_.push_back(BwtBlockType::kZeros);
+    } else if (ones == num) {
+        this->types_.push_back(BwtBlockType::kOnes);
+    } else {
+        // Run lengths of the block (the first run may be empty if the block starts with '1')
+        std::vector<uint16_t> runs;
+        bool                  bit = false;
+        uint32_t              len = 0;
+        for (uint32_t i = 0; i < num && runs.size() <= kBwtMaxRuns; i++) {
+            if (((words[i / 64] >> (i % 64)) & 1ULL) != bit) {
+                runs.push_back(static_cast<uint16_t>(len));
+                bit = !bit;
+                len = 0;
+            }
+            len++;
+        }
+        runs.push_back(static_cast<uint16_t>(len));
+
+        if (runs.size() <= kBwtMaxRuns) {
+            uint16_t header = static_cast<uint16_t>(runs.size());
+            size_t   offset = this->payload_.size();
+            this->payload_.resize(offset + sizeof(uint16_t) * (runs.size() + 1));
+            std::memcpy(this->payload_.data() + offset, &header, sizeof(uint16_t));
+            std::memcpy(this->payload_.data() + offset + sizeof(uint16_t), runs.data(), sizeof(uint16_t) * runs.size());
+            this->types_.push_back(BwtBlockType::kRuns);
+        } else {
+            size_t offset = this->payload_.size();
+            this->payload_.resize(offset + sizeof(uint64_t) * kBwtBlockWords);
+            std::memcpy(this->payload_.data() + offset, words, sizeof(uint64_t) * kBwtBlockWords);
+            this->types_.push_back(BwtBlockType::kRaw);
+        }
+    }
+    this->offsets_.push_back(this->payload_.size());
+}
+
+void CompressedBwt::DecodeBlock(const uint64_t block, uint64_t *words) const {
+    const uint8_t *data = this->payload_.data() + this->offsets_[block];
+    switch (this->types_[block]) {
+        case BwtBlockType::kZeros:
+            std::fill(words, words + kBwtBlockWords, 0ULL);
+            break;
+        case BwtBlockType::kOnes: {
+            std::fill(words, words + kBwtBlockWords, 0ULL);
+            SetRun(words, 0, static_cast<uint32_t>(std::min<uint64_t>(kBwtBlockBits, this->length_ - block * kBwtBlockBits)));
+            break;
+        }
+        case BwtBlockType::kRuns: {
+            std::fill(words, words + kBwtBlockWords, 0ULL);
+            uint16_t num, len;
+            uint32_t pos = 0;
+            std::memcpy(&num, data, sizeof(uint16_t));
+            for (uint16_t r = 0; r < num; r++) {
+                std::memcpy(&len, data + sizeof(uint16_t) * (r + 1), sizeof(uint16_t));
+                if (r % 2 == 1) {
+                    SetRun(words, pos, pos + len);
+                }
+                pos += len;
+            }
+            break;
+        }
+        case BwtBlockType::kRaw:
+            std::memcpy(words, data, sizeof(uint64_t) * kBwtBlockWords);
+            break;
+    }
+}
+
+char CompressedBwt::At(const uint64_t pos) const {
+    if (std::find(this->others_.begin(), this->others_.end(), pos) != this->others_.end()) {
+        return '$';
+    }
+    uint64_t words[kBwtBlockWords];
+    this->DecodeBlock(pos / kBwtBlockBits, words);
+    uint64_t i = pos % kBwtBlockBits;
+    return ((words[i / 64] >> (i % 64)) & 1ULL) ? '1' : '0';
+}
+
+uint64_t CompressedBwt::GetLength() const {
+    return this->length_;
+}
+
+uint64_t CompressedBwt::GetZeroCount() const {
+    return this->zero_count_;
+}
+
+uint64_t CompressedBwt::GetByteSize() const {
+    return this->types_.size() * sizeof(BwtBlockType) + this->offsets_.size() * sizeof(uint64_t) + this->payload_.size() + this->others_.size() * sizeof(uint64_t);
+}
+
+uint64_t CompressedBwt::GetBlockNum(const BwtBlockType type) const {
+    return std::count(this->types_.begin(), this->types_.end(), type);
+}
+
+std::array<uint32_t, 2> CompressedBwt::InnerProducts(const uint32_t *values, const uint64_t size) const {
+    if (size < this->length_) {
+        utils::Logger::FatalLog(LOCATION, "The values are shorter than the BWT");
+        exit(EXIT_FAILURE);
+    }
+
+    __m128i  acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+    uint64_t full = this->length_ / kBwtBlockBits;
+    uint64_t words[kBwtBlockWords];
+    for (uint64_t b = 0; b < full; b++) {
+        const uint32_t *block_values = values + b * kBwtBlockBits;
+        switch (this->types_[b]) {
+            case BwtBlockType::kZeros:
+                AccumulateUniform(block_values, acc0);
+                break;
+            case BwtBlockType::kOnes:
+                AccumulateUniform(block_values, acc1);
+                break;
+            case BwtBlockType::kRuns:
+            case BwtBlockType::kRaw:
+                this->DecodeBlock(b, words);
+                AccumulateBlock(words, block_values, acc0, acc1);
+                break;
+        }
+    }
+    std::array<uint32_t, 2> sums = {HorizontalSum(acc0), HorizontalSum(acc1)};
+
+    // The last block may be partial
+    if (full < this->types_.size()) {
+        this->DecodeBlock(full, words);
+        for (uint64_t i = full * kBwtBlockBits; i < this->length_; i++) {
+            uint64_t j = i - full * kBwtBlockBits;
+            sums[(words[j / 64] >> (j % 64)) & 1ULL] += values[i];
+        }
+    }
+
+    // The positions of '$' were counted as '0'
+    for (const uint64_t pos : this->others_) {
+        sums[0] -= values[pos];
+    }
+    return sums;
+}
+
+void CompressedBwt::InnerProducts(const std::vector<const uint32_t *> &values, const uint64_t size, std::vector<std::array<uint32_t, 2>> &sums) const {
+    if (size < this->length_) {
+        utils::Logger::FatalLog(LOCATION, "The values are shorter than the BWT");
+        exit(EXIT_FAILURE);
+    }
+
+    // The lanes are summed per block (the accumulators stay in registers for any batch size)
+    size_t               num  = values.size();
+    uint64_t             full = this->length_ / kBwtBlockBits;
+    uint64_t             words[kBwtBlockWords];
+    alignas(16) uint32_t masks[kBwtBlockBits];
+    sums.assign(num, {0, 0});
+    for (uint64_t b = 0; b < full; b++) {
+        uint64_t offset = b * kBwtBlockBits;
+        bool     mixed  = (this->types_[b] == BwtBlockType::kRuns || this->types_[b] == BwtBlockType::kRaw);
+        if (mixed) {
+            // Decode and expand the block once for all the vectors
+            this->DecodeBlock(b, words);
+            ExpandMasks(words, masks);
+        }
+        for (size_t k = 0; k < num; k++) {
+            __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+            if (mixed) {
+                AccumulateMasked(masks, values[k] + offset, acc0, acc1);
+            } else {
+                AccumulateUniform(values[k] + offset, (this->types_[b] == BwtBlockType::kZeros) ? acc0 : acc1);
+            }
+            sums[k][0] += HorizontalSum(acc0);
+            sums[k][1] += HorizontalSum(acc1);
+        }
+    }
+
+    // The last block may be partial
+    if (full < this->types_.size()) {
+        this->DecodeBlock(full, words);
+        for (uint64_t i = full * kBwtBlockBits; i < this->length_; i++) {
+            uint64_t j = i - full * kBwtBlockBits;
+            uint64_t c = (words[j / 64] >> (j % 64)) & 1ULL;
+            for (size_t k = 0; k < num; k++) {
+                sums[k][c] += values[k][i];
+            }
+        }
+    }
+
+    // The positions of '$' were counted as '0'
+    for (const uint64_t pos : this->others_) {
+        for (size_t k = 0; k < num; k++) {
+            sums[k][0] -= values[k][pos];
+        }
+    }
+}
+
+void CompressedBwt::RunningCounts(const uint64_t block, std::array<uint32_t, 2> &counts, uint32_t *counts_0, uint32_t *counts_1) const {
+    uint64_t begin = block * kBwtBlockBits;
+    uint64_t num   = (begin < this->length_) ? std::min<uint64_t>(kBwtBlockBits, this->length_ - begin) : 0;
+    uint64_t words[kBwtBlockWords];
+    if (num > 0) {
+        this->DecodeBlock(block, words);
+    }
+
+    // The positions of '$' in the block are not counted (they decode as '0')
+    auto     other = std::lower_bound(this->others_.begin(), this->others_.end(), begin);
+    uint64_t skip  = (other != this->others_.end()) ? *other - begin : kBwtBlockBits;
+    for (uint64_t i = 0; i < num; i++) {
+        if (i == skip) {
+            ++other;
+            skip = (other != this->others_.end()) ? *other - begin : kBwtBlockBits;
+        } else {
+            counts[(words[i / 64] >> (i % 64)) & 1ULL]++;
+        }
+        counts_0[i] = counts[0];
+        counts_1[i] = counts[1];
+    }
+    std::fill(counts_0 + num, counts_0 + kBwtBlockBits, counts[0]);
+    std::fill(counts_1 + num, counts_1 + kBwtBlockBits, counts[1]);
+}
+
+}    // namespace rank
+}    // namespace fss
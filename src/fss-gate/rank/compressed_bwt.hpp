@@ -0,0 +1,163 @@
+/**
+ * @file compressed_bwt.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-04-24
+ * @copyright Copyright (c) 2024
+ * @brief CompressedBwt class (block-compressed BWT for the rank kernel).
+ */
+
+#ifndef RANK_COMPRESSED_BWT_H_
+#define RANK_COMPRESSED_BWT_H_
+
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include "../../fss-base/fss_configure.hpp"
+#include "../../utils/huge_page.hpp"
+
+namespace fss {
+namespace rank {
+
+constexpr uint32_t kBwtBlockBits  = 512;                    // Characters covered by one block
+constexpr uint32_t kBwtBlockWords = kBwtBlockBits / 64;     // 64-bit words of a decoded block
+constexpr uint32_t kBwtMaxRuns    = 29;                     // Runs of a run-length block (smaller than a raw block)
+
+/**
+ * @brief The encodings of a block of the BWT.
+ */
+enum class BwtBlockType : uint8_t {
+    kZeros, /**< Only '0' (no payload). */
+    kOnes,  /**< Only '1' (no payload). */
+    kRuns,  /**< Run-length encoded (the first bit, the number of runs and the run lengths as uint16). */
+    kRaw,   /**< One bit per character (64 bytes). */
+};
+
+/**
+ * @class CompressedBwt
+ * @brief A BWT over '0' and '1' stored as a bitvector of fixed-size blocks.
+ *
+ * Each block of kBwtBlockBits characters is stored uniform, run-length encoded or raw, whichever is smallest.
+ * Characters other than '0' and '1' (the '$' of the BWT) are kept in a separate list.
+ * InnerProducts decodes one block at a time and expands its bits into SIMD masks right before they are
+ * applied to the DPF outputs, so the BWT is never expanded to one byte per character.
+ */
+class CompressedBwt {
+public:
+    /**
+     * @brief Default constructor for CompressedBwt (empty BWT).
+     */
+    CompressedBwt();
+
+    /**
+     * @brief Compress a BWT given as a string.
+     * @param sentence The BWT ('0', '1' and other characters such as '$').
+     */
+    void Build(const std::string_view sentence);
+
+    /**
+     * @brief Compress a BWT packed with one bit per character (see fmi::BwtIndex).
+     * @param bits The packed BWT (bit i % 64 of word i / 64 is character i).
+     * @param length The length of the BWT.
+     * @param dollar_pos The position of '$' (length or more if there is none).
+     */
+    void BuildFromBits(const std::vector<uint64_t> &bits, const uint64_t length, const uint64_t dollar_pos);
+
+    /**
+     * @brief Get the character at the given position.
+     * @param pos The position in the BWT.
+     * @return '0', '1' or '$'.
+     */
+    char At(const uint64_t pos) const;
+
+    /**
+     * @brief Retrieves the length of the BWT.
+     * @return The number of characters.
+     */
+    uint64_t GetLength() const;
+
+    /**
+     * @brief Retrieves the number of '0' in the BWT.
+     * @return The number of '0'.
+     */
+    uint64_t GetZeroCount() const;
+
+    /**
+     * @brief Retrieves the resident size of the compressed BWT.
+     * @return The number of bytes of the block table and the payload.
+     */
+    uint64_t GetByteSize() const;
+
+    /**
+     * @brief Retrieves the number of blocks of each encoding.
+     * @param type The encoding.
+     * @return The number of blocks.
+     */
+    uint64_t GetBlockNum(const BwtBlockType type) const;
+
+    /**
+     * @brief Compute the sums of the values at the positions of '0' and '1' (modulo 2^32).
+     * @param values The values (e.g. the DPF outputs, whatever their allocator).
+     * @param size The number of values (at least the length of the BWT).
+     * @return The sums for '0' and '1'.
+     */
+    std::array<uint32_t, 2> InnerProducts(const uint32_t *values, const uint64_t size) const;
+
+    /**
+     * @brief Compute the sums of several value vectors with one pass over the BWT.
+     *
+     * Each block is decoded and expanded into masks once, then applied to the block of every vector while
+     * the masks stay in L1, so the BWT is read once for the whole batch instead of once per vector.
+     *
+     * @param values The value vectors (each of at least the length of the BWT).
+     * @param size The number of values of each vector.
+     * @param sums The sums for '0' and '1' of each vector.
+     */
+    void InnerProducts(const std::vector<const uint32_t *> &values, const uint64_t size, std::vector<std::array<uint32_t, 2>> &sums) const;
+
+    /**
+     * @brief Compute the number of '0' and '1' up to each character of a block (inclusive, modulo 2^32).
+     *
+     * The counts are carried from block to block, so calling it for the blocks in order gives the running counts
+     * of the whole BWT. The counts stay constant after the end of the BWT (including the blocks past its end).
+     *
+     * @param block The index of the block.
+     * @param counts The counts before the block, updated to the counts after it.
+     * @param counts_0 The number of '0' up to each character of the block (size: kBwtBlockBits).
+     * @param counts_1 The number of '1' up to each character of the block (size: kBwtBlockBits).
+     */
+    void RunningCounts(const uint64_t block, std::array<uint32_t, 2> &counts, uint32_t *counts_0, uint32_t *counts_1) const;
+
+private:
+    uint64_t                   length_;     /**< The length of the BWT. */
+    uint64_t                   zero_count_; /**< The number of '0'. */
+    std::vector<BwtBlockType>  types_;      /**< The encoding of each block. */
+    std::vector<uint64_t>      offsets_;    /**< The offset of each block in the payload (size: blocks + 1). */
+    utils::HugeVector<uint8_t> payload_;    /**< The encoded blocks (on huge pages if large). */
+    std::vector<uint64_t>      others_;     /**< The positions of the characters other than '0' and '1'. */
+
+    /**
+     * @brief Append a block given as decoded words.
+     * @param words The bits of the block.
+     * @param num The number of characters of the block.
+     */
+    void AppendBlock(const uint64_t *words, const uint32_t num);
+
+    /**
+     * @brief Decode a block into words.
+     * @param block The index of the block.
+     * @param words The bits of the block (kBwtBlockWords words).
+     */
+    void DecodeBlock(const uint64_t block, uint64_t *words) const;
+};
+
+namespace test {
+
+void Test_CompressedBwt(TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace rank
+}    // namespace fss
+
+#endif    // RANK_COMPRESSED_BWT_H_
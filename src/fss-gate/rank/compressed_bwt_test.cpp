@@ -0,0 +1,167 @@
+/**
+ * @file compressed_bwt_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-04-24
+ * @copyright Copyright (c) 2024
+ * @brief CompressedBwt test implementation.
+ */
+
+#include "compressed_bwt.hpp"
+
+#include <algorithm>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+#include "fss_rank.hpp"
+
+namespace {
+
+// Runs of random lengths up to max_run (max_run = 1 gives a random text)
+std::string GenerateRunText(const uint32_t length, const uint32_t max_run) {
+    std::string text;
+    char        c = '0';
+    while (text.size() < length) {
+        uint32_t run = 1 + tools::rng::SecureRng::Rand32() % max_run;
+        text.append(std::min<size_t>(run, length - text.size()), max_run == 1 ? ('0' + tools::rng::SecureRng::RandBool()) : c);
+        c = (c == '0') ? '1' : '0';
+    }
+    return text;
+}
+
+// The texts of the tests: random, low-entropy, uniform and with '$' (the BWT of a text of 2^n - 1 characters)
+std::vector<std::string> GenerateTexts(const uint32_t size) {
+    uint32_t                 ts = utils::Pow(2, size);
+    std::vector<std::string> texts;
+    texts.push_back(GenerateRunText(ts, 1));
+    texts.push_back(GenerateRunText(ts, 200));
+    texts.push_back(std::string(ts, '0'));
+    texts.push_back(std::string(ts, '1'));
+    texts.push_back(GenerateRunText(ts - 3, 40));
+    for (uint32_t i = 1; i < 4; i++) {
+        texts[i][tools::rng::SecureRng::Rand32() % ts] = '$';
+    }
+    return texts;
+}
+
+}    // namespace
+
+namespace fss {
+namespace rank {
+namespace test {
+
+bool Test_CompressedBwtAccess(const TestInfo &test_info);
+bool Test_CompressedBwtInnerProducts(const TestInfo &test_info);
+bool Test_CompressedBwtRank(const TestInfo &test_info);
+
+void Test_CompressedBwt(TestInfo &test_info) {
+    std::vector<std::string> modes         = {"CompressedBwt unit tests", "CompressedBwtAccess", "CompressedBwtInnerProducts", "CompressedBwtRank"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        utils::PrintTestResult("Test_CompressedBwtAccess", Test_CompressedBwtAccess(test_info));
+        utils::PrintTestResult("Test_CompressedBwtInnerProducts", Test_CompressedBwtInnerProducts(test_info));
+        utils::PrintTestResult("Test_CompressedBwtRank", Test_CompressedBwtRank(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_CompressedBwtAccess", Test_CompressedBwtAccess(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_CompressedBwtInnerProducts", Test_CompressedBwtInnerProducts(test_info));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_CompressedBwtRank", Test_CompressedBwtRank(test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_CompressedBwtAccess(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        for (const auto &text : GenerateTexts(size)) {
+            CompressedBwt bwt;
+            bwt.Build(text);
+            result &= bwt.GetLength() == text.size();
+            result &= bwt.GetZeroCount() == static_cast<uint64_t>(std::count(text.begin(), text.end(), '0'));
+            for (uint64_t i = 0; i < text.size(); i++) {
+                result &= bwt.At(i) == text[i];
+            }
+
+            // The same BWT packed with one bit per character
+            std::vector<uint64_t> bits((text.size() + 63) / 64, 0);
+            uint64_t              dollar_pos = text.find('$');
+            for (uint64_t i = 0; i < text.size(); i++) {
+                if (text[i] == '1') {
+                    bits[i / 64] |= 1ULL << (i % 64);
+                }
+            }
+            CompressedBwt packed;
+            packed.BuildFromBits(bits, text.size(), dollar_pos == std::string::npos ? text.size() : dollar_pos);
+            result &= packed.GetByteSize() == bwt.GetByteSize() && packed.GetZeroCount() == bwt.GetZeroCount();
+            for (uint64_t i = 0; i < text.size(); i++) {
+                result &= packed.At(i) == text[i];
+            }
+
+            utils::Logger::DebugLog(LOCATION, "Length: " + std::to_string(text.size()) + ", compressed: " + std::to_string(bwt.GetByteSize()) + " bytes (zeros: " + std::to_string(bwt.GetBlockNum(BwtBlockType::kZeros)) + ", ones: " + std::to_string(bwt.GetBlockNum(BwtBlockType::kOnes)) + ", runs: " + std::to_string(bwt.GetBlockNum(BwtBlockType::kRuns)) + ", raw: " + std::to_string(bwt.GetBlockNum(BwtBlockType::kRaw)) + ")", test_info.dbg_info.debug);
+        }
+
+        // Long runs take less than the packed BWT (one bit per character)
+        std::string   runs = GenerateRunText(utils::Pow(2, size), 200);
+        CompressedBwt bwt;
+        bwt.Build(runs);
+        result &= bwt.GetBlockNum(BwtBlockType::kRaw) == 0 && bwt.GetByteSize() < runs.size() / 8;
+    }
+    return result;
+}
+
+bool Test_CompressedBwtInnerProducts(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        std::vector<uint32_t> values(utils::Pow(2, size));
+        for (auto &value : values) {
+            value = tools::rng::SecureRng::Rand32();
+        }
+        for (const auto &text : GenerateTexts(size)) {
+            CompressedBwt bwt;
+            bwt.Build(text);
+            std::array<uint32_t, 2> expected = {0, 0};
+            for (size_t i = 0; i < text.size(); i++) {
+                if (text[i] == '0' || text[i] == '1') {
+                    expected[text[i] - '0'] += values[i];
+                }
+            }
+            result &= bwt.InnerProducts(values.data(), values.size()) == expected;
+        }
+    }
+    return result;
+}
+
+bool Test_CompressedBwtRank(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssRankParameters params(size, test_info.dbg_info);
+        FssRank           fss_rank(params);
+
+        for (const auto &text : GenerateTexts(size)) {
+            CompressedBwt bwt;
+            bwt.Build(text);
+            std::pair<FssRankKey, FssRankKey> rank_keys = fss_rank.GenerateKeys();
+            uint32_t                          pos       = 1 + tools::rng::SecureRng::Rand32() % (utils::Pow(2, size) - 1);
+
+            // Each share is the same as the one of the uncompressed sentence
+            result &= fss_rank.Evaluate(rank_keys.first, bwt, pos) == fss_rank.Evaluate(rank_keys.first, text, pos);
+            result &= fss_rank.Evaluate(rank_keys.second, bwt, pos) == fss_rank.Evaluate(rank_keys.second, text, pos);
+
+            rank_keys.first.FreeFssRankKey();
+            rank_keys.second.FreeFssRankKey();
+        }
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace rank
+}    // namespace fss
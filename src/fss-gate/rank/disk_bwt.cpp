@@ -0,0 +1,159 @@
+/**
+ * @file disk_bwt.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-24
+ * @copyright Copyright (c) 2024
+ * @brief DiskBwt implementation.
+ */
+
+#include "disk_bwt.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+
+#include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
+
+namespace {
+
+constexpr uint64_t kBufferBytes = fss::rank::kDiskBwtChunkWords * sizeof(uint64_t) + 2 * fss::rank::kDiskBwtAlignment;
+
+utils::Counter &DiskBytesCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_rank_disk_bytes_total", "Number of bytes of the BWT read from disk by the out-of-core rank.");
+    return counter;
+}
+
+struct AlignedFree {
+    void operator()(uint8_t *ptr) const {
+        std::free(ptr);
+    }
+};
+
+std::unique_ptr<uint8_t, AlignedFree> AllocateBuffer() {
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, fss::rank::kDiskBwtAlignment, kBufferBytes) != 0) {
+        utils::Logger::FatalLog(LOCATION, "Failed to allocate the read buffer of the BWT");
+        exit(EXIT_FAILURE);
+    }
+    return std::unique_ptr<uint8_t, AlignedFree>(static_cast<uint8_t *>(ptr));
+}
+
+}    // namespace
+
+namespace fss {
+namespace rank {
+
+DiskBwt::DiskBwt()
+    : fd_(-1), direct_io_(false), bits_offset_(0), length_(0), dollar_pos_(0) {
+}
+
+DiskBwt::~DiskBwt() {
+    this->Close();
+}
+
+bool DiskBwt::Open(const std::string &file_path, const uint64_t bits_offset, const uint64_t length, const uint64_t dollar_pos) {
+    this->Close();
+    if (bits_offset % sizeof(uint64_t) != 0) {
+        utils::Logger::ErrorLog(LOCATION, "The packed BWT is not aligned to words. (" + file_path + ")");
+        return false;
+    }
+
+    // Bypass the page cache if the file system supports it
+    this->fd_        = open(file_path.c_str(), O_RDONLY | O_DIRECT);
+    this->direct_io_ = this->fd_ >= 0;
+    if (this->fd_ < 0 && errno == EINVAL) {
+        this->fd_ = open(file_path.c_str(), O_RDONLY);
+        if (this->fd_ >= 0) {
+            posix_fadvise(this->fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+    }
+    if (this->fd_ < 0) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to open file for reading. (" + file_path + ": " + std::strerror(errno) + ")");
+        return false;
+    }
+    this->bits_offset_ = bits_offset;
+    this->length_      = length;
+    this->dollar_pos_  = dollar_pos;
+    return true;
+}
+
+void DiskBwt::Close() {
+    if (this->fd_ >= 0) {
+        close(this->fd_);
+    }
+    this->fd_        = -1;
+    this->direct_io_ = false;
+}
+
+uint64_t DiskBwt::GetLength() const {
+    return this->length_;
+}
+
+uint64_t DiskBwt::GetDollarPos() const {
+    return this->dollar_pos_;
+}
+
+bool DiskBwt::IsDirectIo() const {
+    return this->direct_io_;
+}
+
+void DiskBwt::Stream(const uint64_t word_begin, const uint64_t word_end, const std::function<void(const uint64_t *words, const uint64_t first_word, const uint64_t num_words)> &consume) const {
+    if (word_begin >= word_end) {
+        return;
+    }
+    std::array<std::unique_ptr<uint8_t, AlignedFree>, 2> buffers = {AllocateBuffer(), AllocateBuffer()};
+
+    // Read the next chunk while the current one is consumed
+    uint64_t                      first = word_begin;
+    uint64_t                      num   = std::min(kDiskBwtChunkWords, word_end - first);
+    std::future<const uint64_t *> next  = std::async(std::launch::async, &DiskBwt::ReadWords, this, buffers[0].get(), first, num);
+    for (uint32_t i = 0; first < word_end; i ^= 1) {
+        const uint64_t *words      = next.get();
+        uint64_t        next_first = first + num;
+        uint64_t        next_num   = std::min(kDiskBwtChunkWords, word_end - std::min(word_end, next_first));
+        if (next_num > 0) {
+            next = std::async(std::launch::async, &DiskBwt::ReadWords, this, buffers[i ^ 1].get(), next_first, next_num);
+        }
+        consume(words, first, num);
+        first = next_first;
+        num   = next_num;
+    }
+}
+
+const uint64_t *DiskBwt::ReadWords(uint8_t *buffer, const uint64_t first_word, const uint64_t num_words) const {
+    if (this->fd_ < 0) {
+        utils::Logger::FatalLog(LOCATION, "The BWT file is not open");
+        exit(EXIT_FAILURE);
+    }
+
+    // Direct I/O needs aligned offsets and sizes, so the range is widened to the alignment
+    uint64_t begin         = this->bits_offset_ + first_word * sizeof(uint64_t);
+    uint64_t end           = begin + num_words * sizeof(uint64_t);
+    uint64_t aligned_begin = begin / kDiskBwtAlignment * kDiskBwtAlignment;
+    uint64_t aligned_end   = (end + kDiskBwtAlignment - 1) / kDiskBwtAlignment * kDiskBwtAlignment;
+    uint64_t done          = 0;
+    while (aligned_begin + done < end) {
+        ssize_t bytes = pread(this->fd_, buffer + done, aligned_end - aligned_begin - done, aligned_begin + done);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            utils::Logger::FatalLog(LOCATION, "Failed to read the BWT at byte " + std::to_string(aligned_begin + done) + (bytes < 0 ? " (" + std::string(std::strerror(errno)) + ")" : " (end of file)"));
+            exit(EXIT_FAILURE);
+        }
+        done += static_cast<uint64_t>(bytes);
+    }
+    DiskBytesCounter().Increment(done);
+    return reinterpret_cast<const uint64_t *>(buffer + (begin - aligned_begin));
+}
+
+}    // namespace rank
+}    // namespace fss
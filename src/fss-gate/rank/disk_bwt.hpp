@@ -0,0 +1,122 @@
+/**
+ * @file disk_bwt.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-24
+ * @copyright Copyright (c) 2024
+ * @brief DiskBwt class (packed BWT streamed from an index file for the out-of-core rank).
+ */
+
+#ifndef RANK_DISK_BWT_H_
+#define RANK_DISK_BWT_H_
+
+#include <functional>
+#include <string>
+
+#include "../../fss-base/fss_configure.hpp"
+
+namespace fss {
+namespace rank {
+
+constexpr uint64_t kDiskBwtAlignment  = 4096;       // Alignment of the offsets, sizes and buffers of direct I/O
+constexpr uint64_t kDiskBwtChunkWords = 1 << 17;    // 64-bit words read at a time (1 MiB)
+
+/**
+ * @class DiskBwt
+ * @brief A BWT over '0' and '1' packed with one bit per character and read from a file on demand.
+ *
+ * Only the file descriptor is kept in memory. Stream reads the packed BWT sequentially in chunks of
+ * kDiskBwtChunkWords words into two aligned buffers: the next chunk is read in the background while the
+ * current one is consumed, so the consumer (the DPF leaf generation of the rank) overlaps with the disk.
+ * The file is opened with O_DIRECT to bypass the page cache, and with buffered I/O and sequential read-ahead
+ * advice if the file system does not support it.
+ */
+class DiskBwt {
+public:
+    /**
+     * @brief Default constructor for DiskBwt (no file).
+     */
+    DiskBwt();
+
+    /**
+     * @brief Destructor for DiskBwt (closes the file).
+     */
+    ~DiskBwt();
+
+    /**
+     * @brief Copy constructor (deleted).
+     */
+    DiskBwt(const DiskBwt &) = delete;
+
+    /**
+     * @brief Copy assignment operator (deleted).
+     */
+    DiskBwt &operator=(const DiskBwt &) = delete;
+
+    /**
+     * @brief Open the packed BWT in a file.
+     * @param file_path The path to the file (e.g. a BWT index file, see fmi::ReadBwtIndexLayout).
+     * @param bits_offset The byte offset of the packed BWT in the file (bit i % 64 of word i / 64 is character i).
+     * @param length The length of the BWT.
+     * @param dollar_pos The position of '$' (length or more if there is none).
+     * @return `true` if the file was opened.
+     */
+    bool Open(const std::string &file_path, const uint64_t bits_offset, const uint64_t length, const uint64_t dollar_pos);
+
+    /**
+     * @brief Close the file.
+     */
+    void Close();
+
+    /**
+     * @brief Retrieves the length of the BWT.
+     * @return The number of characters.
+     */
+    uint64_t GetLength() const;
+
+    /**
+     * @brief Retrieves the position of '$'.
+     * @return The position of '$' (length or more if there is none).
+     */
+    uint64_t GetDollarPos() const;
+
+    /**
+     * @brief Check whether the file is read with direct I/O.
+     * @return `true` if the page cache is bypassed.
+     */
+    bool IsDirectIo() const;
+
+    /**
+     * @brief Read the words [word_begin, word_end) of the packed BWT in order.
+     * @param word_begin The first word.
+     * @param word_end The end word (exclusive).
+     * @param consume Called with the words of each chunk and the index of its first word.
+     */
+    void Stream(const uint64_t word_begin, const uint64_t word_end, const std::function<void(const uint64_t *words, const uint64_t first_word, const uint64_t num_words)> &consume) const;
+
+private:
+    int      fd_;          /**< The file descriptor (-1 if no file is open). */
+    bool     direct_io_;   /**< Whether the file is opened with O_DIRECT. */
+    uint64_t bits_offset_; /**< The byte offset of the packed BWT in the file. */
+    uint64_t length_;      /**< The length of the BWT. */
+    uint64_t dollar_pos_;  /**< The position of '$'. */
+
+    /**
+     * @brief Read words of the packed BWT into a buffer.
+     * @param buffer The buffer (aligned to kDiskBwtAlignment, kDiskBwtChunkWords words and two alignments).
+     * @param first_word The first word.
+     * @param num_words The number of words.
+     * @return The words in the buffer.
+     */
+    const uint64_t *ReadWords(uint8_t *buffer, const uint64_t first_word, const uint64_t num_words) const;
+};
+
+namespace test {
+
+void Test_DiskBwt(TestInfo &test_info);
+
+}    // namespace test
+
+}    // namespace rank
+}    // namespace fss
+
+#endif    // RANK_DISK_BWT_H_
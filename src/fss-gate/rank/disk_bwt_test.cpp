@@ -0,0 +1,153 @@
+/**
+ * @file disk_bwt_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-24
+ * @copyright Copyright (c) 2024
+ * @brief DiskBwt test implementation.
+ */
+
+#include "disk_bwt.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/file_io.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/utils.hpp"
+#include "fss_rank.hpp"
+
+namespace {
+
+const std::string  kCurrentPath    = utils::GetCurrentDirectory();
+const std::string  kTestRankPath   = kCurrentPath + "/data/test/rank/";
+const std::string  kTestBwtPath    = kTestRankPath + "bwt.bin";
+constexpr uint64_t kTestBitsOffset = 48;    // The packed BWT follows a header as in a BWT index file
+
+// Pack the text with one bit per character
+std::vector<uint64_t> PackText(const std::string &text) {
+    std::vector<uint64_t> bits((text.size() + 63) / 64, 0);
+    for (uint64_t i = 0; i < text.size(); i++) {
+        if (text[i] == '1') {
+            bits[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+    return bits;
+}
+
+// Write the packed BWT after a header of kTestBitsOffset bytes
+bool WriteBwtFile(const std::vector<uint64_t> &bits) {
+    std::ofstream file(kTestBwtPath, std::ios::binary | std::ios::trunc);
+    std::string   header(kTestBitsOffset, '\0');
+    file.write(header.data(), header.size());
+    file.write(reinterpret_cast<const char *>(bits.data()), bits.size() * sizeof(uint64_t));
+    return static_cast<bool>(file);
+}
+
+// A random text of the given length with '$' at dollar_pos
+std::string GenerateText(const uint64_t length, const uint64_t dollar_pos) {
+    std::string text(length, '0');
+    for (auto &c : text) {
+        c = tools::rng::SecureRng::RandBool() ? '1' : '0';
+    }
+    if (dollar_pos < length) {
+        text[dollar_pos] = '$';
+    }
+    return text;
+}
+
+}    // namespace
+
+namespace fss {
+namespace rank {
+namespace test {
+
+bool Test_DiskBwtStream(const TestInfo &test_info);
+bool Test_DiskBwtRank(const TestInfo &test_info);
+
+void Test_DiskBwt(TestInfo &test_info) {
+    std::vector<std::string> modes         = {"DiskBwt unit tests", "DiskBwtStream", "DiskBwtRank"};
+    uint32_t                 selected_mode = test_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        test_info.dbg_info.debug = false;
+        utils::PrintTestResult("Test_DiskBwtStream", Test_DiskBwtStream(test_info));
+        utils::PrintTestResult("Test_DiskBwtRank", Test_DiskBwtRank(test_info));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_DiskBwtStream", Test_DiskBwtStream(test_info));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_DiskBwtRank", Test_DiskBwtRank(test_info));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_DiskBwtStream(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        // Longer than a chunk, and not a multiple of the alignment
+        uint64_t              words = std::max<uint64_t>(utils::Pow(2, size) / 64, kDiskBwtChunkWords + 100);
+        std::vector<uint64_t> bits(words);
+        for (auto &word : bits) {
+            word = tools::rng::SecureRng::Rand64();
+        }
+        result &= WriteBwtFile(bits);
+
+        DiskBwt bwt;
+        result &= bwt.Open(kTestBwtPath, kTestBitsOffset, words * 64, words * 64);
+        result &= bwt.GetLength() == words * 64;
+
+        // Every range is read in order and matches the file
+        for (const auto &range : std::vector<std::pair<uint64_t, uint64_t>>{{0, words}, {1, words - 1}, {words - 1, words}, {kDiskBwtChunkWords - 1, kDiskBwtChunkWords + 1}, {5, 5}}) {
+            uint64_t expected = range.first;
+            bwt.Stream(range.first, range.second, [&](const uint64_t *chunk, const uint64_t first_word, const uint64_t num_words) {
+                result &= first_word == expected && num_words <= kDiskBwtChunkWords;
+                result &= std::equal(chunk, chunk + num_words, bits.begin() + first_word);
+                expected += num_words;
+            });
+            result &= expected == std::max(range.first, range.second);
+        }
+        utils::Logger::DebugLog(LOCATION, "Words: " + std::to_string(words) + ", direct I/O: " + std::to_string(bwt.IsDirectIo()), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_DiskBwtRank(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        // The BWT of a text of 2^t - 1 characters and a shorter sentence without '$', with the keys of both backends
+        for (const auto backend : {RankBackend::kDpf, RankBackend::kDcf}) {
+            FssRankParameters params(size, test_info.dbg_info, backend);
+            FssRank           fss_rank(params);
+            uint64_t          ts = utils::Pow(2, size);
+
+            for (const auto length : {ts, ts - 100}) {
+                uint64_t    dollar_pos = (length == ts) ? tools::rng::SecureRng::Rand32() % length : length;
+                std::string text       = GenerateText(length, dollar_pos);
+                result &= WriteBwtFile(PackText(text));
+
+                DiskBwt bwt;
+                result &= bwt.Open(kTestBwtPath, kTestBitsOffset, length, dollar_pos);
+
+                std::pair<FssRankKey, FssRankKey> rank_keys = fss_rank.GenerateKeys();
+                for (const uint32_t pos : {1U, 2U, static_cast<uint32_t>(ts - 1), 1 + tools::rng::SecureRng::Rand32() % static_cast<uint32_t>(ts - 1)}) {
+                    // Each share is the same as the one of the sentence in memory
+                    result &= fss_rank.Evaluate(rank_keys.first, bwt, pos) == fss_rank.Evaluate(rank_keys.first, text, pos);
+                    result &= fss_rank.Evaluate(rank_keys.second, bwt, pos) == fss_rank.Evaluate(rank_keys.second, text, pos);
+                }
+
+                rank_keys.first.FreeFssRankKey();
+                rank_keys.second.FreeFssRankKey();
+            }
+        }
+    }
+    return result;
+}
+
+}    // namespace test
+}    // namespace rank
+}    // namespace fss
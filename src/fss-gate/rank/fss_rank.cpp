@@ -8,8 +8,10 @@
 
 #include "fss_rank.hpp"
 
+#include "../../fss-base/prg/seeded_rng.hpp"
 #include "../../tools/random_number_generator.hpp"
 #include "../../utils/logger.hpp"
+#include "../../utils/metrics.hpp"
 #include "../../utils/timer.hpp"
 #include "../../utils/utils.hpp"
 
@@ -17,7 +19,11 @@
 
 namespace {
 
-void CalculateReverseCumulativeSum(std::vector<uint32_t> &vec, const uint32_t bitsize) {
+constexpr uint32_t kDiskRankChunkBits  = 16;                          // DPF outputs generated at a time by the out-of-core rank
+constexpr uint32_t kBatchRankChunkBits = 12;                          // DPF outputs held per key by the batched rank
+constexpr uint32_t kBatchRankBlock     = fss::rank::kBwtBlockBits;    // Characters applied to the outputs of a batch at a time (in L1)
+
+void CalculateReverseCumulativeSum(utils::HugeVector<uint32_t> &vec, const uint32_t bitsize) {
     uint32_t tmp = vec[vec.size() - 1];    // Assign the last value
     for (long i = vec.size() - 2; i >= 0; --i) {
         tmp    = utils::Mod(tmp + vec[i], bitsize);    // Calculate the cumulative sum
@@ -25,8 +31,24 @@ void CalculateReverseCumulativeSum(std::vector<uint32_t> &vec, const uint32_t bi
     }
 }
 
-void RotateRight(std::vector<uint32_t> &vec, size_t n) {
-    std::rotate(vec.rbegin(), vec.rbegin() + n, vec.rend());
+void RotateRight(utils::HugeVector<uint32_t> &vec, size_t n) {
+    // The shift is taken modulo the size (pos - 1 wraps around for the masked position 0)
+    std::rotate(vec.rbegin(), vec.rbegin() + (n % vec.size()), vec.rend());
+}
+
+utils::Counter &RankEvalCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_rank_eval_total", "Number of FssRank evaluations.");
+    return counter;
+}
+
+utils::Histogram &RankEvalLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_rank_eval_seconds", "Latency of a FssRank evaluation.");
+    return histogram;
+}
+
+utils::Histogram &RankBatchEvalLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_rank_batch_eval_seconds", "Latency of a batched FssRank evaluation.");
+    return histogram;
 }
 
 }    // namespace
@@ -35,33 +57,42 @@ namespace fss {
 namespace rank {
 
 FssRankParameters::FssRankParameters()
-    : text_bitsize(0), debug(false) {
+    : text_bitsize(0), backend(RankBackend::kDpf), debug(false) {
 }
 
-FssRankParameters::FssRankParameters(const uint32_t t, const DebugInfo &dbg_info)
-    : text_bitsize(t), dpf_params(dpf::DpfParameters(t, t, dbg_info)), debug(dbg_info.rank_debug), dbg_info(dbg_info) {
+FssRankParameters::FssRankParameters(const uint32_t t, const DebugInfo &dbg_info, const RankBackend backend)
+    : text_bitsize(t), backend(backend), dpf_params(dpf::DpfParameters(t, t, dbg_info)), dcf_params(dcf::DcfParameters(t, t, dbg_info)), debug(dbg_info.rank_debug), dbg_info(dbg_info) {
 }
 
 FssRankKey::FssRankKey()
-    : shr_in(0) {
+    : backend(RankBackend::kDpf), shr_in(0) {
 }
 
 void FssRankKey::PrintFssRankKey(const FssRankParameters &params, const bool debug) const {
 #ifdef LOG_LEVEL_TRACE
     utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("FssRank Key"), debug);
-    this->dpf_key.PrintDpfKey(params.dpf_params, debug);
+    if (this->backend == RankBackend::kDcf) {
+        this->dcf_key.PrintDcfKey(debug);
+    } else {
+        this->dpf_key.PrintDpfKey(params.dpf_params, debug);
+    }
     utils::Logger::TraceLog(LOCATION, "Share(r_in): " + std::to_string(this->shr_in), debug);
     utils::Logger::TraceLog(LOCATION, utils::kDash, debug);
 #endif
 }
 
 void FssRankKey::FreeFssRankKey() {
-    this->dpf_key.FreeDpfKey();
+    if (this->backend == RankBackend::kDcf) {
+        this->dcf_key.FreeDcfKey();
+    } else {
+        this->dpf_key.FreeDpfKey();
+    }
 }
 
 FssRank::FssRank(const FssRankParameters params)
     : params_(params),
-      dpf_(params.dpf_params) {
+      dpf_(params.dpf_params),
+      dcf_(params.dcf_params) {
 }
 
 std::pair<FssRankKey, FssRankKey> FssRank::GenerateKeys() const {
@@ -74,9 +105,19 @@ std::pair<FssRankKey, FssRankKey> FssRank::GenerateKeys() const {
 
     std::array<FssRankKey, 2> rank_key;
 
-    // Generate DPF keys
-    uint32_t                            r_in = utils::Mod(tools::rng::SecureRng().Rand64(), t);
-    std::pair<dpf::DpfKey, dpf::DpfKey> keys = this->dpf_.GenerateKeys(r_in, 1);
+    // Generate DPF keys (DCF keys of the comparison with 2^t - r_in, see EvaluateDcfOutputs)
+    uint32_t r_in = utils::Mod(tools::rng::SecureRng().Rand64(), t);
+    if (this->params_.backend == RankBackend::kDcf) {
+        std::pair<dcf::DcfKey, dcf::DcfKey> keys = this->dcf_.GenerateKeys(utils::Mod(utils::Pow(2, t) - r_in, t), 1);
+        rank_key[0].dcf_key                      = std::move(keys.first);
+        rank_key[1].dcf_key                      = std::move(keys.second);
+    } else {
+        std::pair<dpf::DpfKey, dpf::DpfKey> keys = this->dpf_.GenerateKeys(r_in, 1);
+        rank_key[0].dpf_key                      = std::move(keys.first);
+        rank_key[1].dpf_key                      = std::move(keys.second);
+    }
+    rank_key[0].backend = this->params_.backend;
+    rank_key[1].backend = this->params_.backend;
 
     // Generate share of r_in
     rank_key[0].shr_in = utils::Mod(tools::rng::SecureRng().Rand64(), t);
@@ -85,10 +126,6 @@ std::pair<FssRankKey, FssRankKey> FssRank::GenerateKeys() const {
     utils::Logger::TraceLog(LOCATION, "r_in: " + std::to_string(r_in) + " -> (" + std::to_string(rank_key[0].shr_in) + ", " + std::to_string(rank_key[1].shr_in) + ")", debug);
 #endif
 
-    // Set DPF keys
-    rank_key[0].dpf_key = std::move(keys.first);
-    rank_key[1].dpf_key = std::move(keys.second);
-
 #ifdef LOG_LEVEL_TRACE
     utils::AddNewLine(debug);
     rank_key[0].PrintFssRankKey(this->params_, debug);
@@ -100,16 +137,330 @@ std::pair<FssRankKey, FssRankKey> FssRank::GenerateKeys() const {
     return std::make_pair(std::move(rank_key[0]), std::move(rank_key[1]));
 }
 
-std::array<uint32_t, 2> FssRank::Evaluate(const FssRankKey &rank_key, const std::string &sentence, const uint32_t pos) const {
+std::pair<FssRankKey, FssRankKey> FssRank::GenerateKeys(const Block &seed, const uint64_t key_index) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateKeys();
+}
+
+std::array<uint32_t, 2> FssRank::Evaluate(const FssRankKey &rank_key, const std::string_view sentence, const uint32_t pos) const {
     uint32_t t = this->params_.text_bitsize;
+    utils::HistogramTimer latency(RankEvalLatency());
+    RankEvalCounter().Increment();
 
 #ifdef LOG_LEVEL_TRACE
     bool debug = this->params_.debug;
     utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Calculate rank value"), debug);
 #endif
 
+    utils::HugeVector<uint32_t> outputs(utils::Pow(2, t));
+    this->EvaluateOutputs(rank_key, pos, outputs);
+
+    // Calculate the rank value
+    std::array<uint32_t, 2> rank = {0, 0};
+    for (size_t i = 0; i < sentence.size(); i++) {
+        if (sentence[i] == '0') {
+            rank[0] = utils::Mod(rank[0] + outputs[i], t);
+        } else if (sentence[i] == '1') {
+            rank[1] = utils::Mod(rank[1] + outputs[i], t);
+        } else {
+        }
+    }
+
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "Rank: (" + std::to_string(rank[0]) + ", " + std::to_string(rank[1]) + ")", debug);
+#endif
+
+    return rank;
+}
+
+std::array<uint32_t, 2> FssRank::Evaluate(const FssRankKey &rank_key, const CompressedBwt &sentence, const uint32_t pos) const {
+    uint32_t t = this->params_.text_bitsize;
+    utils::HistogramTimer latency(RankEvalLatency());
+    RankEvalCounter().Increment();
+
+#ifdef LOG_LEVEL_TRACE
+    bool debug = this->params_.debug;
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Calculate rank value (compressed)"), debug);
+#endif
+
+    utils::HugeVector<uint32_t> outputs(utils::Pow(2, t));
+    this->EvaluateOutputs(rank_key, pos, outputs);
+
+    // Calculate the rank value (the sums wrap around 2^32, a multiple of 2^t)
+    std::array<uint32_t, 2> rank = sentence.InnerProducts(outputs.data(), outputs.size());
+    rank[0]                      = utils::Mod(rank[0], t);
+    rank[1]                      = utils::Mod(rank[1], t);
+
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "Rank: (" + std::to_string(rank[0]) + ", " + std::to_string(rank[1]) + ")", debug);
+#endif
+
+    return rank;
+}
+
+std::array<uint32_t, 2> FssRank::Evaluate(const FssRankKey &rank_key, const DiskBwt &sentence, const uint32_t pos) const {
+    uint32_t t  = this->params_.text_bitsize;
+    uint32_t nu = this->params_.dpf_params.terminate_bitsize;
+    this->CheckBackend(rank_key);
+    utils::HistogramTimer latency(RankEvalLatency());
+    RankEvalCounter().Increment();
+
+#ifdef LOG_LEVEL_TRACE
+    bool debug = this->params_.debug;
+    utils::Logger::TraceLog(LOCATION, utils::Logger::StrWithSep("Calculate rank value (disk)"), debug);
+#endif
+
+    uint64_t size          = static_cast<uint64_t>(1) << t;
+    uint64_t length        = std::min(sentence.GetLength(), size);
+    uint64_t dollar_pos    = sentence.GetDollarPos();
+    uint64_t shift         = (pos + size - 1) % size;
+    uint32_t chunk_bitsize = std::max(std::min(t, kDiskRankChunkBits), t - nu);
+
+    if (this->params_.backend == RankBackend::kDcf) {
+        // The outputs have no running form in the order of the sentence: hold them and stream the sentence only
+        utils::HugeVector<uint32_t> outputs(size);
+        this->EvaluateDcfOutputs(rank_key, pos, outputs);
+        std::array<uint32_t, 2> rank = {0, 0};
+        sentence.Stream(0, (length + 63) / 64, [&](const uint64_t *words, const uint64_t first_word, const uint64_t num_words) {
+            uint64_t to = std::min(length, (first_word + num_words) * 64);
+            for (uint64_t j = first_word * 64; j < to; j++) {
+                if (j != dollar_pos) {
+                    rank[(words[j / 64 - first_word] >> (j % 64)) & 1ULL] += outputs[j];
+                }
+            }
+        });
+        return {utils::Mod(rank[0], t), utils::Mod(rank[1], t)};
+    }
+
+    // The DPF outputs in domain order are the rotated outputs from position `shift` to the end, then from 0 to `shift`
+    std::vector<uint32_t> outputs;
+    uint32_t              chunk = 0;
+    size_t                k     = 0;
+
+    auto next = [&]() {
+        if (k == outputs.size()) {
+            this->dpf_.EvaluateFullDomainChunk(rank_key.dpf_key, chunk_bitsize, chunk++, outputs);
+            k = 0;
+        }
+        return outputs[k++];
+    };
+
+    // Sum the rotated outputs times the number of each character up to their position (the reverse cumulative sum, reordered)
+    auto scan = [&](const uint64_t begin, const uint64_t end, std::array<uint32_t, 2> &counts, std::array<uint32_t, 2> &sums, uint32_t &total) {
+        uint64_t stored = std::max(begin, std::min(end, length));
+        sentence.Stream(begin / 64, (begin < stored) ? (stored + 63) / 64 : 0, [&](const uint64_t *words, const uint64_t first_word, const uint64_t num_words) {
+            uint64_t to = std::min(stored, (first_word + num_words) * 64);
+            for (uint64_t j = std::max(begin, first_word * 64); j < to; j++) {
+                uint32_t output = next();
+                if (j != dollar_pos) {
+                    counts[(words[j / 64 - first_word] >> (j % 64)) & 1ULL]++;
+                }
+                sums[0] += output * counts[0];
+                sums[1] += output * counts[1];
+                total += output;
+            }
+        });
+        for (uint64_t j = stored; j < end; j++) {
+            uint32_t output = next();
+            sums[0] += output * counts[0];
+            sums[1] += output * counts[1];
+            total += output;
+        }
+    };
+    std::array<uint32_t, 2> counts_1 = {0, 0}, sums_1 = {0, 0}, counts_2 = {0, 0}, sums_2 = {0, 0};
+    uint32_t                total_1 = 0, total_2 = 0;
+    scan(shift, size, counts_1, sums_1, total_1);
+    scan(0, shift, counts_2, sums_2, total_2);
+
+    // The counts of the first segment start after the characters of the second one (the sums wrap around 2^32, a multiple of 2^t)
+    std::array<uint32_t, 2> rank = {utils::Mod(sums_1[0] + counts_2[0] * total_1 + sums_2[0], t), utils::Mod(sums_1[1] + counts_2[1] * total_1 + sums_2[1], t)};
+
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "Rank: (" + std::to_string(rank[0]) + ", " + std::to_string(rank[1]) + ")", debug);
+#endif
+
+    return rank;
+}
+
+void FssRank::EvaluateBatch(const std::vector<const FssRankKey *> &rank_keys, const std::vector<uint32_t> &pos, const std::string_view sentence, std::vector<std::array<uint32_t, 2>> &ranks) const {
+    uint32_t t = this->params_.text_bitsize;
+    utils::HistogramTimer latency(RankBatchEvalLatency());
+    RankEvalCounter().Increment(rank_keys.size());
+    size_t length = std::min<size_t>(sentence.size(), utils::Pow(2, t));
+
+    if (this->params_.backend == RankBackend::kDpf) {
+        std::array<uint32_t, 2> counts = {0, 0};
+        this->EvaluateBatchBlocks(
+            rank_keys, pos, [&](const uint64_t begin, uint32_t *counts_0, uint32_t *counts_1) {
+                for (uint64_t i = 0; i < kBatchRankBlock; i++) {
+                    if (begin + i < length) {
+                        counts[0] += (sentence[begin + i] == '0');
+                        counts[1] += (sentence[begin + i] == '1');
+                    }
+                    counts_0[i] = counts[0];
+                    counts_1[i] = counts[1];
+                }
+            },
+            ranks);
+        return;
+    }
+
+    // The DCF outputs have no running form: hold the outputs of the batch and apply the masks of each block
+    std::vector<utils::HugeVector<uint32_t>> outputs;
+    this->EvaluateBatchOutputs(rank_keys, pos, outputs);
+
+    // Turn each block of the sentence into masks once and apply them to the outputs of every key
+    size_t                num = rank_keys.size();
+    std::vector<uint32_t> sums_0(num, 0), sums_1(num, 0);
+    alignas(16) uint32_t  mask_0[kBatchRankBlock], mask_1[kBatchRankBlock];
+    for (size_t begin = 0; begin < length; begin += kBatchRankBlock) {
+        size_t len = std::min<size_t>(kBatchRankBlock, length - begin);
+        for (size_t i = 0; i < len; i++) {
+            mask_0[i] = 0U - static_cast<uint32_t>(sentence[begin + i] == '0');
+            mask_1[i] = 0U - static_cast<uint32_t>(sentence[begin + i] == '1');
+        }
+        for (size_t k = 0; k < num; k++) {
+            const uint32_t *values = outputs[k].data() + begin;
+            uint32_t        acc_0 = 0, acc_1 = 0;
+            for (size_t i = 0; i < len; i++) {
+                acc_0 += values[i] & mask_0[i];
+                acc_1 += values[i] & mask_1[i];
+            }
+            sums_0[k] += acc_0;
+            sums_1[k] += acc_1;
+        }
+    }
+
+    // The sums wrap around 2^32, a multiple of 2^t
+    ranks.resize(num);
+    for (size_t k = 0; k < num; k++) {
+        ranks[k] = {utils::Mod(sums_0[k], t), utils::Mod(sums_1[k], t)};
+    }
+}
+
+void FssRank::EvaluateBatch(const std::vector<const FssRankKey *> &rank_keys, const std::vector<uint32_t> &pos, const CompressedBwt &sentence, std::vector<std::array<uint32_t, 2>> &ranks) const {
+    uint32_t t = this->params_.text_bitsize;
+    utils::HistogramTimer latency(RankBatchEvalLatency());
+    RankEvalCounter().Increment(rank_keys.size());
+
+    if (this->params_.backend == RankBackend::kDpf) {
+        std::array<uint32_t, 2> counts = {0, 0};
+        this->EvaluateBatchBlocks(
+            rank_keys, pos, [&](const uint64_t begin, uint32_t *counts_0, uint32_t *counts_1) {
+                sentence.RunningCounts(begin / kBwtBlockBits, counts, counts_0, counts_1);
+            },
+            ranks);
+        return;
+    }
+
+    // The DCF outputs have no running form: hold the outputs of the batch
+    std::vector<utils::HugeVector<uint32_t>> outputs;
+    this->EvaluateBatchOutputs(rank_keys, pos, outputs);
+
+    std::vector<const uint32_t *> values(outputs.size());
+    for (size_t k = 0; k < outputs.size(); k++) {
+        values[k] = outputs[k].data();
+    }
+    sentence.InnerProducts(values, utils::Pow(2, t), ranks);
+    for (std::array<uint32_t, 2> &rank : ranks) {
+        rank[0] = utils::Mod(rank[0], t);
+        rank[1] = utils::Mod(rank[1], t);
+    }
+}
+
+void FssRank::EvaluateBatchBlocks(const std::vector<const FssRankKey *> &rank_keys, const std::vector<uint32_t> &pos, const std::function<void(const uint64_t, uint32_t *, uint32_t *)> &running_counts, std::vector<std::array<uint32_t, 2>> &ranks) const {
+    uint32_t t  = this->params_.text_bitsize;
+    uint32_t nu = this->params_.dpf_params.terminate_bitsize;
+    if (rank_keys.size() != pos.size()) {
+        utils::Logger::FatalLog(LOCATION, "The number of rank keys and positions does not match");
+        exit(EXIT_FAILURE);
+    }
+
+    // The rotated outputs of a key start at the DPF output 2^t - shift and wrap around to 0
+    struct OutputStream {
+        std::vector<uint32_t> outputs; /**< The DPF outputs of the current chunk. */
+        uint32_t              chunk;   /**< The index of the current chunk. */
+        size_t                next;    /**< The next output in the chunk. */
+    };
+    size_t                    num           = rank_keys.size();
+    uint64_t                  size          = static_cast<uint64_t>(1) << t;
+    uint32_t                  chunk_bitsize = std::max(std::min(t, kBatchRankChunkBits), t - nu);
+    uint32_t                  chunk_num     = static_cast<uint32_t>(size >> chunk_bitsize);
+    std::vector<OutputStream> streams(num);
+    for (size_t k = 0; k < num; k++) {
+        this->CheckBackend(*rank_keys[k]);
+        uint64_t shift   = (pos[k] + size - 1) % size;
+        uint64_t start   = (size - shift) % size;
+        streams[k].chunk = static_cast<uint32_t>(start >> chunk_bitsize);
+        streams[k].next  = start & ((static_cast<uint64_t>(1) << chunk_bitsize) - 1);
+        this->dpf_.EvaluateFullDomainChunk(rank_keys[k]->dpf_key, chunk_bitsize, streams[k].chunk, streams[k].outputs);
+    }
+
+    // rank_c = sum_j o_j * (the number of c up to position j) for the rotated outputs o (the reverse cumulative sum, reordered):
+    // each block of the running counts is computed once and multiplied with the next block of the outputs of every key
+    std::vector<uint32_t> sums_0(num, 0), sums_1(num, 0);
+    alignas(16) uint32_t  counts_0[kBatchRankBlock], counts_1[kBatchRankBlock];
+    for (uint64_t begin = 0; begin < size; begin += kBatchRankBlock) {
+        size_t len = static_cast<size_t>(std::min<uint64_t>(kBatchRankBlock, size - begin));
+        running_counts(begin, counts_0, counts_1);
+        for (size_t k = 0; k < num; k++) {
+            OutputStream &stream = streams[k];
+            uint32_t      acc_0 = 0, acc_1 = 0;
+            for (size_t i = 0; i < len;) {
+                if (stream.next == stream.outputs.size()) {
+                    uint32_t chunk = (stream.chunk + 1) % chunk_num;
+                    if (chunk != stream.chunk) {
+                        stream.chunk = chunk;
+                        this->dpf_.EvaluateFullDomainChunk(rank_keys[k]->dpf_key, chunk_bitsize, chunk, stream.outputs);
+                    }
+                    stream.next = 0;
+                }
+                size_t          n      = std::min(len - i, stream.outputs.size() - stream.next);
+                const uint32_t *values = stream.outputs.data() + stream.next;
+                for (size_t j = 0; j < n; j++) {
+                    acc_0 += values[j] * counts_0[i + j];
+                    acc_1 += values[j] * counts_1[i + j];
+                }
+                stream.next += n;
+                i += n;
+            }
+            sums_0[k] += acc_0;
+            sums_1[k] += acc_1;
+        }
+    }
+
+    // The sums wrap around 2^32, a multiple of 2^t
+    ranks.resize(num);
+    for (size_t k = 0; k < num; k++) {
+        ranks[k] = {utils::Mod(sums_0[k], t), utils::Mod(sums_1[k], t)};
+    }
+}
+
+void FssRank::EvaluateBatchOutputs(const std::vector<const FssRankKey *> &rank_keys, const std::vector<uint32_t> &pos, std::vector<utils::HugeVector<uint32_t>> &outputs) const {
+    if (rank_keys.size() != pos.size()) {
+        utils::Logger::FatalLog(LOCATION, "The number of rank keys and positions does not match");
+        exit(EXIT_FAILURE);
+    }
+    outputs.clear();
+    outputs.reserve(rank_keys.size());
+    for (size_t k = 0; k < rank_keys.size(); k++) {
+        outputs.emplace_back(utils::Pow(2, this->params_.text_bitsize));
+        this->EvaluateOutputs(*rank_keys[k], pos[k], outputs.back());
+    }
+}
+
+void FssRank::EvaluateOutputs(const FssRankKey &rank_key, const uint32_t pos, utils::HugeVector<uint32_t> &outputs) const {
+    uint32_t t = this->params_.text_bitsize;
+#ifdef LOG_LEVEL_TRACE
+    bool debug = this->params_.debug;
+#endif
+    this->CheckBackend(rank_key);
+    if (this->params_.backend == RankBackend::kDcf) {
+        this->EvaluateDcfOutputs(rank_key, pos, outputs);
+        return;
+    }
+
     // Setup DPF key and evaluate full domain
-    std::vector<uint32_t> outputs(utils::Pow(2, t));
     this->dpf_.EvaluateFullDomain(rank_key.dpf_key, outputs);
 
     // Rotate the output vector
@@ -123,23 +474,126 @@ std::array<uint32_t, 2> FssRank::Evaluate(const FssRankKey &rank_key, const std:
 #ifdef LOG_LEVEL_TRACE
     utils::Logger::TraceLog(LOCATION, "ReverseCumulativeSum: " + utils::VectorToStr(outputs), debug);
 #endif
+}
 
-    // Calculate the rank value
-    std::array<uint32_t, 2> rank = {0, 0};
-    for (size_t i = 0; i < sentence.size(); i++) {
-        if (sentence[i] == '0') {
-            rank[0] = utils::Mod(rank[0] + outputs[i], t);
-        } else if (sentence[i] == '1') {
-            rank[1] = utils::Mod(rank[1] + outputs[i], t);
-        } else {
-        }
+void FssRank::CheckBackend(const FssRankKey &rank_key) const {
+    if (rank_key.backend != this->params_.backend) {
+        utils::Logger::FatalLog(LOCATION, "The backend of the rank key does not match the parameters (DPF and DCF keys are not interchangeable)");
+        exit(EXIT_FAILURE);
     }
+}
 
+void FssRank::EvaluateDcfOutputs(const FssRankKey &rank_key, const uint32_t pos, utils::HugeVector<uint32_t> &outputs) const {
+    uint32_t t    = this->params_.text_bitsize;
+    uint32_t b    = utils::Mod(pos - 1, t);    // pos - 1 wraps around for the masked position 0
+    uint32_t lead = static_cast<uint32_t>(rank_key.dcf_key.party_id == 0);
 #ifdef LOG_LEVEL_TRACE
-    utils::Logger::TraceLog(LOCATION, "Rank: (" + std::to_string(rank[0]) + ", " + std::to_string(rank[1]) + ")", debug);
+    bool debug = this->params_.debug;
 #endif
 
-    return rank;
+    // Evaluate the full domain (h) and reverse the segments [0, b] and (b, 2^t) in place to get h(b - i)
+    outputs.resize(utils::Pow(2, t));
+    this->dcf_.EvaluateFullDomain(rank_key.dcf_key, outputs.data());
+    uint32_t h_b = outputs[b];
+    std::reverse(outputs.begin(), outputs.begin() + b + 1);
+    std::reverse(outputs.begin() + b + 1, outputs.end());
+
+    // [i <= b] - h(b - i) + h(b) (party 0 adds the public indicator)
+    for (size_t i = 0; i <= b; i++) {
+        outputs[i] = utils::Mod(lead + h_b - outputs[i], t);
+    }
+    for (size_t i = static_cast<size_t>(b) + 1; i < outputs.size(); i++) {
+        outputs[i] = utils::Mod(h_b - outputs[i], t);
+    }
+#ifdef LOG_LEVEL_TRACE
+    utils::Logger::TraceLog(LOCATION, "DCF outputs: " + utils::VectorToStr(outputs), debug);
+#endif
+}
+
+FssRankBatch::FssRankBatch(const FssRank &rank, const std::string_view sentence)
+    : rank_(rank), sentence_(sentence), packed_(nullptr), disk_(nullptr) {
+}
+
+FssRankBatch::FssRankBatch(const FssRank &rank, const CompressedBwt &sentence)
+    : rank_(rank), packed_(&sentence), disk_(nullptr) {
+}
+
+FssRankBatch::FssRankBatch(const FssRank &rank, const DiskBwt &sentence)
+    : rank_(rank), packed_(nullptr), disk_(&sentence) {
+}
+
+void FssRankBatch::Add(const FssRankKey &rank_key, const uint32_t pos, std::array<uint32_t, 2> &output) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->keys_.push_back(&rank_key);
+    this->pos_.push_back(pos);
+    this->outputs_.push_back(&output);
+}
+
+void FssRankBatch::Flush() {
+    std::vector<std::array<uint32_t, 2>> ranks;
+    if (this->keys_.empty()) {
+        return;
+    }
+    if (this->disk_ != nullptr) {
+        ranks.reserve(this->keys_.size());
+        for (size_t k = 0; k < this->keys_.size(); k++) {
+            ranks.push_back(this->rank_.Evaluate(*this->keys_[k], *this->disk_, this->pos_[k]));
+        }
+    } else if (this->packed_ != nullptr) {
+        this->rank_.EvaluateBatch(this->keys_, this->pos_, *this->packed_, ranks);
+    } else {
+        this->rank_.EvaluateBatch(this->keys_, this->pos_, this->sentence_, ranks);
+    }
+    for (size_t k = 0; k < ranks.size(); k++) {
+        *this->outputs_[k] = ranks[k];
+    }
+    this->keys_.clear();
+    this->pos_.clear();
+    this->outputs_.clear();
+}
+
+FssRankSession::FssRankSession(const FssRank &rank, const FssRankKey &rank_key, const std::string_view sentence, const uint32_t pos)
+    : rank_(rank), rank_key_(rank_key), sentence_(sentence), packed_(nullptr), batch_(nullptr), posr_(utils::Mod(pos - rank_key.shr_in, rank.params_.text_bitsize)), output_{0, 0}, finished_(false) {
+}
+
+FssRankSession::FssRankSession(const FssRank &rank, const FssRankKey &rank_key, const CompressedBwt &sentence, const uint32_t pos)
+    : rank_(rank), rank_key_(rank_key), packed_(&sentence), batch_(nullptr), posr_(utils::Mod(pos - rank_key.shr_in, rank.params_.text_bitsize)), output_{0, 0}, finished_(false) {
+}
+
+FssRankSession::FssRankSession(const FssRank &rank, const FssRankKey &rank_key, FssRankBatch &batch, const uint32_t pos)
+    : rank_(rank), rank_key_(rank_key), packed_(nullptr), batch_(&batch), posr_(utils::Mod(pos - rank_key.shr_in, rank.params_.text_bitsize)), output_{0, 0}, finished_(false) {
+}
+
+bool FssRankSession::IsFinished() const {
+    return this->finished_;
+}
+
+uint32_t FssRankSession::GetOpeningSize() const {
+    return this->finished_ ? 0 : 1;
+}
+
+void FssRankSession::WriteOpening(uint32_t *shares) const {
+    shares[0] = this->posr_;
+}
+
+void FssRankSession::Resume(const uint32_t *opened) {
+    uint32_t pos = utils::Mod(opened[0], this->rank_.params_.text_bitsize);
+    if (this->batch_ != nullptr) {
+        this->batch_->Add(this->rank_key_, pos, this->output_);    // Written when the round is flushed
+    } else if (this->packed_ != nullptr) {
+        this->output_ = this->rank_.Evaluate(this->rank_key_, *this->packed_, pos);
+    } else {
+        this->output_ = this->rank_.Evaluate(this->rank_key_, this->sentence_, pos);
+    }
+    this->finished_ = true;
+}
+
+tools::secret_sharing::RoundBatch *FssRankSession::GetRoundBatch() const {
+    return this->batch_;
+}
+
+const std::array<uint32_t, 2> &FssRankSession::GetOutput() const {
+    return this->output_;
 }
 
 }    // namespace rank
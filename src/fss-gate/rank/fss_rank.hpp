@@ -9,15 +9,34 @@
 #ifndef RANK_FSS_RANK_H_
 #define RANK_FSS_RANK_H_
 
+#include <functional>
+#include <mutex>
+#include <string_view>
+
+#include "../../fss-base/dcf/distributed_comparison_function.hpp"
 #include "../../fss-base/dpf/distributed_point_function.hpp"
+#include "../../tools/protocol_session.hpp"
 #include "../../tools/secret_sharing.hpp"
+#include "compressed_bwt.hpp"
+#include "disk_bwt.hpp"
 
 namespace fss {
 namespace rank {
 
+/**
+ * @brief The function behind the shares of the indicator of the positions below pos.
+ *
+ * kDpf evaluates a point function at the mask, rotates the outputs and sums them from the end (two passes over 2^t values).
+ * kDcf evaluates a comparison function, whose outputs are the indicator once two segments are reversed in place
+ * (no sequential pass), at the cost of a larger key (a correction word per level, no early termination).
+ */
+enum class RankBackend { kDpf, kDcf };
+
 struct FssRankParameters {
     const uint32_t           text_bitsize; /**< The size of the text in bits. */
+    const RankBackend        backend;      /**< The function behind the rank keys. */
     const dpf::DpfParameters dpf_params;   /**< The parameters for DPF. */
+    const dcf::DcfParameters dcf_params;   /**< The parameters for DCF. */
     const bool               debug;        /**< Toggle this flag to enable/disable debugging. */
     const DebugInfo          dbg_info;     /**< Debug information. */
 
@@ -30,12 +49,15 @@ struct FssRankParameters {
      * @brief Parameterized constructor for FssRankParameters.
      * @param t The size of the text in bits.
      * @param debug Debug utils::Mode flag.
+     * @param backend The function behind the rank keys.
      */
-    FssRankParameters(const uint32_t t, const DebugInfo &dbg_info);
+    FssRankParameters(const uint32_t t, const DebugInfo &dbg_info, const RankBackend backend = RankBackend::kDpf);
 };
 
 struct FssRankKey {
+    RankBackend backend; /**< The function behind the key (only the key of this function is set). */
     dpf::DpfKey dpf_key; /**< The DPF key associated with the FssRankKey. */
+    dcf::DcfKey dcf_key; /**< The DCF key associated with the FssRankKey. */
     uint32_t    shr_in;  /**< Random value for input. */
 
     /**
@@ -64,7 +86,10 @@ struct FssRankKey {
     FssRankKey &operator=(FssRankKey &&) noexcept = default;
 
     bool operator==(const FssRankKey &rhs) const {
-        return this->dpf_key == rhs.dpf_key && this->shr_in == rhs.shr_in;
+        if (this->backend != rhs.backend || this->shr_in != rhs.shr_in) {
+            return false;
+        }
+        return (this->backend == RankBackend::kDcf) ? this->dcf_key == rhs.dcf_key : this->dpf_key == rhs.dpf_key;
     }
 
     bool operator!=(const FssRankKey &rhs) const {
@@ -101,18 +126,248 @@ public:
      */
     std::pair<FssRankKey, FssRankKey> GenerateKeys() const;
 
+    /**
+     * @brief Generate keys for FssRank from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<FssRankKey, FssRankKey> GenerateKeys(const Block &seed, const uint64_t key_index) const;
+
     /**
      * @brief Evaluate rank for a given sentence and position.
      * @param rank_key Rank key.
-     * @param sentence The sentence to be evaluated.
+     * @param sentence The sentence to be evaluated (not copied; e.g. a shared-memory index).
      * @param pos The position to evaluate the rank at.
      * @return An array of two uint32_t values representing the rank calculation result.
      */
-    std::array<uint32_t, 2> Evaluate(const FssRankKey &rank_key, const std::string &sentence, const uint32_t pos) const;
+    std::array<uint32_t, 2> Evaluate(const FssRankKey &rank_key, const std::string_view sentence, const uint32_t pos) const;
+
+    /**
+     * @brief Evaluate rank for a given compressed sentence and position (same result as the string version).
+     * @param rank_key Rank key.
+     * @param sentence The compressed sentence to be evaluated.
+     * @param pos The position to evaluate the rank at.
+     * @return An array of two uint32_t values representing the rank calculation result.
+     */
+    std::array<uint32_t, 2> Evaluate(const FssRankKey &rank_key, const CompressedBwt &sentence, const uint32_t pos) const;
+
+    /**
+     * @brief Evaluate rank for a sentence streamed from disk (same result as the string version).
+     *
+     * The full domain is evaluated in chunks in the order of the rotated outputs, and the reverse cumulative sum
+     * is folded into a running count of each character, so neither the sentence nor the 2^t outputs are held in memory.
+     * The DCF keys hold the 2^t outputs in memory and stream the sentence only.
+     *
+     * @param rank_key Rank key.
+     * @param sentence The sentence on disk.
+     * @param pos The position to evaluate the rank at.
+     * @return An array of two uint32_t values representing the rank calculation result.
+     */
+    std::array<uint32_t, 2> Evaluate(const FssRankKey &rank_key, const DiskBwt &sentence, const uint32_t pos) const;
+
+    /**
+     * @brief Evaluate the ranks of a batch of keys with one pass over the sentence.
+     *
+     * The sentence is read once in blocks, and each block is applied to the outputs of all the keys while it is in L1,
+     * so the sentence is streamed once per batch instead of once per key. The DPF keys produce their outputs block by
+     * block from chunks of the full domain (see EvaluateBatchBlocks), so the batch holds one chunk per key instead of
+     * B * 2^t values; the DCF keys hold their outputs (B * 2^t values).
+     *
+     * @param rank_keys The rank keys.
+     * @param pos The opened position of each key.
+     * @param sentence The sentence to be evaluated.
+     * @param ranks The results (same as Evaluate for each key).
+     */
+    void EvaluateBatch(const std::vector<const FssRankKey *> &rank_keys, const std::vector<uint32_t> &pos, const std::string_view sentence, std::vector<std::array<uint32_t, 2>> &ranks) const;
+
+    /**
+     * @brief Evaluate the ranks of a batch of keys with one pass over the compressed sentence (see CompressedBwt::RunningCounts
+     * for the DPF keys and CompressedBwt::InnerProducts for the DCF keys).
+     * @param rank_keys The rank keys.
+     * @param pos The opened position of each key.
+     * @param sentence The compressed sentence to be evaluated.
+     * @param ranks The results (same as Evaluate for each key).
+     */
+    void EvaluateBatch(const std::vector<const FssRankKey *> &rank_keys, const std::vector<uint32_t> &pos, const CompressedBwt &sentence, std::vector<std::array<uint32_t, 2>> &ranks) const;
+
+    /**
+     * @brief Compute the shares of the indicator of the positions below pos (the full domain evaluation, rotated and summed
+     * for the DPF keys, reversed in two segments for the DCF keys).
+     *
+     * The rank of any column of the sentence is the inner product of these shares with the column
+     * (e.g. the k-mer columns of KStepFmi).
+     *
+     * @param rank_key Rank key.
+     * @param pos The position to evaluate the rank at.
+     * @param outputs The shares (size: 2^t).
+     */
+    void EvaluateOutputs(const FssRankKey &rank_key, const uint32_t pos, utils::HugeVector<uint32_t> &outputs) const;
 
 private:
-    const FssRankParameters             params_; /**< The parameters for FssRank. */
-    const dpf::DistributedPointFunction dpf_;    /**< The DPF object for FssRank. */
+    friend class FssRankSession;
+
+    const FssRankParameters                  params_; /**< The parameters for FssRank. */
+    const dpf::DistributedPointFunction      dpf_;    /**< The DPF object for FssRank. */
+    const dcf::DistributedComparisonFunction dcf_;    /**< The DCF object for FssRank. */
+
+    /**
+     * @brief Check that the rank key was generated for the backend of the parameters (fatal otherwise).
+     * @param rank_key Rank key.
+     */
+    void CheckBackend(const FssRankKey &rank_key) const;
+
+    /**
+     * @brief Compute the outputs of a DCF key (see EvaluateOutputs).
+     *
+     * With the mask r_in and b = pos - 1, the indicator of the positions up to b + r_in is
+     * [i <= b] - h(b - i) + h(b) for h(y) = [y < 2^t - r_in] (the wrap of y + r_in, up to a constant).
+     *
+     * @param rank_key Rank key.
+     * @param pos The position to evaluate the rank at.
+     * @param outputs The shares (size: 2^t).
+     */
+    void EvaluateDcfOutputs(const FssRankKey &rank_key, const uint32_t pos, utils::HugeVector<uint32_t> &outputs) const;
+
+    /**
+     * @brief Evaluate the ranks of a batch of DPF keys block by block (see EvaluateBatch).
+     *
+     * With the rotated DPF outputs o, rank_c = sum_j o_j * (the number of c up to position j), so no reverse cumulative
+     * sum is needed. Each key evaluates its outputs in chunks of the full domain (EvaluateFullDomainChunk) in the order of
+     * the rotated outputs, and every block of the running counts is multiplied with the next block of the outputs of all
+     * the keys while both are in L1.
+     *
+     * @param rank_keys The rank keys.
+     * @param pos The opened position of each key.
+     * @param running_counts Writes the number of '0' and '1' up to each character of the block starting at the given position
+     * (kBwtBlockBits characters, constant after the end of the sentence); called for the blocks in order.
+     * @param ranks The results (same as Evaluate for each key).
+     */
+    void EvaluateBatchBlocks(const std::vector<const FssRankKey *> &rank_keys, const std::vector<uint32_t> &pos, const std::function<void(const uint64_t, uint32_t *, uint32_t *)> &running_counts, std::vector<std::array<uint32_t, 2>> &ranks) const;
+
+    /**
+     * @brief Compute the outputs of every key of a batch (see EvaluateOutputs).
+     * @param rank_keys The rank keys.
+     * @param pos The opened position of each key.
+     * @param outputs The outputs of each key.
+     */
+    void EvaluateBatchOutputs(const std::vector<const FssRankKey *> &rank_keys, const std::vector<uint32_t> &pos, std::vector<utils::HugeVector<uint32_t>> &outputs) const;
+};
+
+/**
+ * @class FssRankBatch
+ * @brief The ranks queued by the sessions of a round, evaluated together when the round is flushed.
+ *
+ * The sessions built with a batch queue their key and opened position in Resume, and the multiplexer flushes the batch
+ * once the sessions of the round are resumed (see tools::secret_sharing::RoundBatch), so the ranks of the whole round
+ * take one FssRank::EvaluateBatch (one pass over the sentence) instead of one pass per rank.
+ * A sentence on disk is evaluated key by key (the out-of-core rank streams its own chunks).
+ * The sentence and the FssRank object must outlive the batch.
+ */
+class FssRankBatch : public tools::secret_sharing::RoundBatch {
+public:
+    /**
+     * @brief Construct a new FssRankBatch on a sentence.
+     * @param rank The FssRank object.
+     * @param sentence The sentence (BWT).
+     */
+    FssRankBatch(const FssRank &rank, const std::string_view sentence);
+
+    /**
+     * @brief Construct a new FssRankBatch on a compressed sentence.
+     * @param rank The FssRank object.
+     * @param sentence The compressed sentence (BWT).
+     */
+    FssRankBatch(const FssRank &rank, const CompressedBwt &sentence);
+
+    /**
+     * @brief Construct a new FssRankBatch on a sentence on disk.
+     * @param rank The FssRank object.
+     * @param sentence The sentence (BWT) on disk.
+     */
+    FssRankBatch(const FssRank &rank, const DiskBwt &sentence);
+
+    /**
+     * @brief Queue a rank (thread-safe).
+     * @param rank_key The rank key (must outlive the flush).
+     * @param pos The opened position (minus r_in).
+     * @param output The destination of the shares of the ranks, written by Flush.
+     */
+    void Add(const FssRankKey &rank_key, const uint32_t pos, std::array<uint32_t, 2> &output);
+
+    /**
+     * @brief Evaluate the queued ranks and write their outputs.
+     */
+    void Flush() override;
+
+private:
+    const FssRank                         &rank_;     /**< The FssRank object. */
+    std::string_view                       sentence_; /**< The sentence (used if packed_ and disk_ are null). */
+    const CompressedBwt                   *packed_;   /**< The compressed sentence. */
+    const DiskBwt                         *disk_;     /**< The sentence on disk. */
+    std::mutex                             mutex_;    /**< The lock of the queue. */
+    std::vector<const FssRankKey *>        keys_;     /**< The queued rank keys. */
+    std::vector<uint32_t>                  pos_;      /**< The queued positions. */
+    std::vector<std::array<uint32_t, 2> *> outputs_;  /**< The destinations of the queued ranks. */
+};
+
+/**
+ * @class FssRankSession
+ * @brief Resumable rank of a shared position: one round opens pos - r_in, then the rank is evaluated on the sentence.
+ *
+ * A session built with a FssRankBatch queues its rank, which is evaluated with the ranks of the other sessions of
+ * the round when the multiplexer flushes the batch. The key, the sentence (or batch) and the FssRank object must outlive the session.
+ */
+class FssRankSession : public tools::secret_sharing::ProtocolSession {
+public:
+    /**
+     * @brief Construct a new FssRankSession on a sentence.
+     * @param rank The FssRank object.
+     * @param rank_key The FssRankKey of this party.
+     * @param sentence The sentence (BWT).
+     * @param pos The share of the position.
+     */
+    FssRankSession(const FssRank &rank, const FssRankKey &rank_key, const std::string_view sentence, const uint32_t pos);
+
+    /**
+     * @brief Construct a new FssRankSession on a compressed sentence.
+     * @param rank The FssRank object.
+     * @param rank_key The FssRankKey of this party.
+     * @param sentence The compressed sentence (BWT).
+     * @param pos The share of the position.
+     */
+    FssRankSession(const FssRank &rank, const FssRankKey &rank_key, const CompressedBwt &sentence, const uint32_t pos);
+
+    /**
+     * @brief Construct a new FssRankSession evaluated with the other sessions of its round.
+     * @param rank The FssRank object.
+     * @param rank_key The FssRankKey of this party.
+     * @param batch The batch of the round (on the sentence).
+     * @param pos The share of the position.
+     */
+    FssRankSession(const FssRank &rank, const FssRankKey &rank_key, FssRankBatch &batch, const uint32_t pos);
+
+    bool                               IsFinished() const override;
+    uint32_t                           GetOpeningSize() const override;
+    void                               WriteOpening(uint32_t *shares) const override;
+    void                               Resume(const uint32_t *opened) override;
+    tools::secret_sharing::RoundBatch *GetRoundBatch() const override;
+
+    /**
+     * @brief Get the output of FssRank::Evaluate (available after the session is finished).
+     * @return The shares of the ranks of '0' and '1'.
+     */
+    const std::array<uint32_t, 2> &GetOutput() const;
+
+private:
+    const FssRank          &rank_;     /**< The FssRank object. */
+    const FssRankKey       &rank_key_; /**< The FssRankKey of this party. */
+    std::string_view        sentence_; /**< The sentence (used if packed_ and batch_ are null). */
+    const CompressedBwt    *packed_;   /**< The compressed sentence. */
+    FssRankBatch           *batch_;    /**< The batch of the round. */
+    uint32_t                posr_;     /**< The share of pos - r_in. */
+    std::array<uint32_t, 2> output_;   /**< The shares of the ranks. */
+    bool                    finished_; /**< Flag indicating the output is available. */
 };
 
 namespace test {
@@ -121,6 +376,12 @@ void Test_FssRank(tools::secret_sharing::Party &party, TestInfo &test_info);
 
 }    // namespace test
 
+namespace bench {
+
+void Bench_FssRank(tools::secret_sharing::Party &party, const BenchInfo &bench_info);
+
+}    // namespace bench
+
 }    // namespace rank
 }    // namespace fss
 
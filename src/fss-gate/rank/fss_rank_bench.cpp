@@ -0,0 +1,169 @@
+/**
+ * @file fss_rank_bench.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-07-10
+ * @copyright Copyright (c) 2024
+ * @brief FssRank benchmark implementation.
+ */
+
+#include "fss_rank.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "../../tools/random_number_generator.hpp"
+#include "../../utils/logger.hpp"
+#include "../../utils/memory.hpp"
+#include "../../utils/timer.hpp"
+#include "../../utils/utils.hpp"
+#include "../internal/fsskey_io.hpp"
+
+namespace {
+
+const std::string kCurrentPath    = utils::GetCurrentDirectory();
+const std::string kBenchRankPath  = kCurrentPath + "/data/bench/rank/";
+const std::string kRankKeyPath_P0 = kBenchRankPath + "key_p0";
+
+constexpr uint32_t kMaxBatchSize = 64;
+
+std::string GenerateBinaryString(const uint32_t length) {
+    std::string result(length, '0');
+    for (uint32_t i = 0; i < length; i++) {
+        result[i] = tools::rng::SecureRng::RandBool() ? '1' : '0';
+    }
+    return result;
+}
+
+// The size of the key written by FssKeyIo (in bytes)
+uint64_t KeyFileSize(const std::string &file_path) {
+    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+    return file ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+}    // namespace
+
+namespace fss {
+namespace rank {
+namespace bench {
+
+void Bench_FssRank(tools::secret_sharing::Party &party, const BenchInfo &bench_info) {
+    // Define utilities
+    utils::ExecutionTimer timer_all, timer_1;
+    utils::MemoryMonitor  mem_1;
+    internal::FssKeyIo    key_io;
+
+    std::vector<std::string> modes         = {"Measurement of FssRank (DPF, rotate and suffix sum)", "Measurement of FssRank (DCF, segment reversal)", "Measurement of FssRank (DPF, throughput per query against the batch size)"};
+    uint32_t                 selected_mode = bench_info.mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+    RankBackend backend = (selected_mode == 2) ? RankBackend::kDcf : RankBackend::kDpf;
+
+    for (const auto t : bench_info.text_size) {
+        for (uint32_t i = 0; i < bench_info.experiment_num; i++) {
+            FssRankParameters params(t, bench_info.dbg_info, backend);
+            FssRank           fss_rank(params);
+            uint32_t          ts = utils::Pow(2, t);
+            utils::Logger::InfoLog(LOCATION, "FssRank: (text size) = (" + std::to_string(t) + ")");
+
+            // Measure total time
+            std::string mode_str     = "[" + modes[selected_mode - 1] + "],";
+            std::string measure_info = "Info,Text size,Time";
+            utils::Logger::InfoLog(LOCATION, mode_str + measure_info);
+            measure_info = "," + std::to_string(t);
+            timer_all.Start();
+            // ############# START #############
+
+            // Both keys are evaluated locally (the rank is reconstructed to check the keys)
+            std::string   text = GenerateBinaryString(ts - 1);
+            CompressedBwt packed;
+            packed.Build(text);
+
+            timer_1.SetTimeUnit(utils::TimeUnit::MICROSECONDS);
+            if (selected_mode == 3) {
+                // B queries share one pass over the sentence (see FssRank::EvaluateBatch)
+                utils::Logger::InfoLog(LOCATION, mode_str + "Info,Text size,Batch size,Time");
+                for (uint32_t b = 1; b <= kMaxBatchSize; b *= 2) {
+                    std::vector<std::pair<FssRankKey, FssRankKey>> keys;
+                    std::vector<const FssRankKey *>                keys_0, keys_1;
+                    std::vector<uint32_t>                          pos, posr;
+                    std::vector<std::array<uint32_t, 2>>           ranks_0, ranks_1;
+                    keys.reserve(b);
+                    for (uint32_t j = 0; j < b; j++) {
+                        keys.push_back(fss_rank.GenerateKeys());
+                        keys_0.push_back(&keys.back().first);
+                        keys_1.push_back(&keys.back().second);
+                        pos.push_back(1 + tools::rng::SecureRng::Rand32() % (ts - 1));
+                        posr.push_back(utils::Mod(pos.back() - keys.back().first.shr_in - keys.back().second.shr_in, t));
+                    }
+                    std::string batch_info = measure_info + "," + std::to_string(b);
+
+                    mem_1.Start();
+                    timer_1.Start();
+                    fss_rank.EvaluateBatch(keys_0, posr, packed, ranks_0);
+                    double time = timer_1.Print(LOCATION, mode_str + "Evaluate batch" + batch_info);
+                    mem_1.Print(LOCATION, mode_str + "Evaluate batch" + batch_info);
+                    utils::Logger::InfoLog(LOCATION, mode_str + "Time per query" + batch_info + "," + std::to_string(time / b));
+
+                    fss_rank.EvaluateBatch(keys_1, posr, packed, ranks_1);
+                    for (uint32_t j = 0; j < b; j++) {
+                        uint32_t count = std::count(text.begin(), text.begin() + pos[j], '1');
+                        if (utils::Mod(ranks_0[j][1] + ranks_1[j][1], t) != count) {
+                            utils::Logger::ErrorLog(LOCATION, "The rank does not match: " + std::to_string(utils::Mod(ranks_0[j][1] + ranks_1[j][1], t)) + " != " + std::to_string(count));
+                        }
+                        keys[j].first.FreeFssRankKey();
+                        keys[j].second.FreeFssRankKey();
+                    }
+                }
+            } else {
+                mem_1.Start();
+                timer_1.Start();
+                std::pair<FssRankKey, FssRankKey> keys = fss_rank.GenerateKeys();
+                timer_1.Print(LOCATION, mode_str + "Generate keys" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Generate keys" + measure_info);
+                key_io.WriteFssRankKeyToFile(kRankKeyPath_P0, keys.first);
+                utils::Logger::InfoLog(LOCATION, mode_str + "Key size (bytes)" + measure_info + "," + std::to_string(KeyFileSize(kRankKeyPath_P0 + ".key")));
+
+                uint32_t pos  = 1 + tools::rng::SecureRng::Rand32() % (ts - 1);
+                uint32_t posr = utils::Mod(pos - keys.first.shr_in - keys.second.shr_in, t);
+
+                // The shares of the indicator only (the passes replaced by the DCF), then the whole rank
+                utils::HugeVector<uint32_t> outputs(ts);
+                mem_1.Start();
+                timer_1.Start();
+                fss_rank.EvaluateOutputs(keys.first, posr, outputs);
+                timer_1.Print(LOCATION, mode_str + "Evaluate outputs" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Evaluate outputs" + measure_info);
+
+                mem_1.Start();
+                timer_1.Start();
+                std::array<uint32_t, 2> rank_0 = fss_rank.Evaluate(keys.first, packed, posr);
+                timer_1.Print(LOCATION, mode_str + "Evaluate rank" + measure_info);
+                mem_1.Print(LOCATION, mode_str + "Evaluate rank" + measure_info);
+
+                std::array<uint32_t, 2> rank_1 = fss_rank.Evaluate(keys.second, packed, posr);
+                uint32_t                count  = 0;
+                for (uint32_t j = 0; j < pos; j++) {
+                    count += (text[j] == '1');
+                }
+                if (utils::Mod(rank_0[1] + rank_1[1], t) != count) {
+                    utils::Logger::ErrorLog(LOCATION, "The rank does not match: " + std::to_string(utils::Mod(rank_0[1] + rank_1[1], t)) + " != " + std::to_string(count));
+                }
+                keys.first.FreeFssRankKey();
+                keys.second.FreeFssRankKey();
+            }
+
+            // ############# END #############
+            double timer_res = timer_all.Print(LOCATION, mode_str + "Bench Total time" + measure_info);
+            if (utils::ExecutionTimer::IsExceedLimitTime(timer_res, bench_info.limit_time_ms, timer_all.GetTimeUnit())) {
+                utils::Logger::InfoLog(LOCATION, "The execution time exceeds the limit time: " + std::to_string(timer_res) + " " + timer_all.GetTimeUnitStr());
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+}    // namespace bench
+}    // namespace rank
+}    // namespace fss
@@ -32,6 +32,8 @@ const std::string kRankAlpSharePath_P1     = kTestRankPath + "alp_share_p1";
 const std::string kRankBeaverTriplePath    = kTestRankPath + "bt";
 const std::string kRankBeaverTriplePath_P0 = kTestRankPath + "bt_p0";
 const std::string kRankBeaverTriplePath_P1 = kTestRankPath + "bt_p1";
+const std::string kRankDcfKeyPath_P0       = kTestRankPath + "dcf_key_p0";
+const std::string kRankDcfKeyPath_P1       = kTestRankPath + "dcf_key_p1";
 
 using bts_t = tools::secret_sharing::bts_t;
 
@@ -61,9 +63,12 @@ namespace test {
 
 bool Test_FssRankOffline(tools::secret_sharing::Party &party, const TestInfo &test_info);
 bool Test_FssRankOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_FssRankBatch(const TestInfo &test_info);
+bool Test_FssRankDcf(const TestInfo &test_info);
+bool Test_FssRankSessionOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
 
 void Test_FssRank(tools::secret_sharing::Party &party, TestInfo &test_info) {
-    std::vector<std::string> modes         = {"FssRank unit tests", "FssRankOffline", "FssRankOnline"};
+    std::vector<std::string> modes         = {"FssRank unit tests", "FssRankOffline", "FssRankOnline", "FssRankBatch", "FssRankDcf", "FssRankSessionOnline"};
     uint32_t                 selected_mode = test_info.mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -79,10 +84,19 @@ void Test_FssRank(tools::secret_sharing::Party &party, TestInfo &test_info) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
         utils::PrintTestResult("Test_FssRankOnline", Test_FssRankOnline(party, test_info));
+        utils::PrintTestResult("Test_FssRankBatch", Test_FssRankBatch(test_info));
+        utils::PrintTestResult("Test_FssRankDcf", Test_FssRankDcf(test_info));
+        utils::PrintTestResult("Test_FssRankSessionOnline", Test_FssRankSessionOnline(party, test_info));
     } else if (selected_mode == 2) {
         utils::PrintTestResult("Test_FssRankOffline", Test_FssRankOffline(party, test_info));
     } else if (selected_mode == 3) {
         utils::PrintTestResult("Test_FssRankOnline", Test_FssRankOnline(party, test_info));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_FssRankBatch", Test_FssRankBatch(test_info));
+    } else if (selected_mode == 5) {
+        utils::PrintTestResult("Test_FssRankDcf", Test_FssRankDcf(test_info));
+    } else if (selected_mode == 6) {
+        utils::PrintTestResult("Test_FssRankSessionOnline", Test_FssRankSessionOnline(party, test_info));
     }
     utils::PrintText(utils::kDash);
 }
@@ -240,6 +254,159 @@ bool Test_FssRankOnline(tools::secret_sharing::Party &party, const TestInfo &tes
     return result;
 }
 
+bool Test_FssRankBatch(const TestInfo &test_info) {
+    bool               result    = true;
+    constexpr uint32_t kBatchNum = 5;
+    for (const auto size : test_info.domain_size) {
+        FssRankParameters params(size, test_info.dbg_info);
+        FssRank           fss_rank(params);
+        uint32_t          ts = utils::Pow(2, size);
+
+        // A text with '$' and a length that is not a multiple of the block size
+        std::string db    = GenerateBinaryString(ts > 8 ? ts - 3 : ts);
+        db[db.size() / 2] = '$';
+        CompressedBwt packed;
+        packed.Build(db);
+
+        // Both parties evaluate the batch locally; the positions (1 to the length) are opened as pos - r_in
+        std::vector<FssRankKey>              keys_0(kBatchNum), keys_1(kBatchNum);
+        std::vector<const FssRankKey *>      batch_0(kBatchNum), batch_1(kBatchNum);
+        std::vector<uint32_t>                pos(kBatchNum), posr(kBatchNum);
+        std::vector<std::array<uint32_t, 2>> ranks_0, ranks_1, packed_0, packed_1;
+        for (uint32_t k = 0; k < kBatchNum; k++) {
+            std::pair<FssRankKey, FssRankKey> keys = fss_rank.GenerateKeys();
+            keys_0[k]                              = std::move(keys.first);
+            keys_1[k]                              = std::move(keys.second);
+            batch_0[k]                             = &keys_0[k];
+            batch_1[k]                             = &keys_1[k];
+            pos[k]                                 = (k == 0) ? db.size() : 1 + tools::rng::SecureRng::Rand32() % db.size();
+            posr[k]                                = utils::Mod(pos[k] - keys_0[k].shr_in - keys_1[k].shr_in, size);
+        }
+        fss_rank.EvaluateBatch(batch_0, posr, db, ranks_0);
+        fss_rank.EvaluateBatch(batch_1, posr, db, ranks_1);
+        fss_rank.EvaluateBatch(batch_0, posr, packed, packed_0);
+        fss_rank.EvaluateBatch(batch_1, posr, packed, packed_1);
+
+        // Same shares as the evaluation of each key, and the ranks of the text
+        for (uint32_t k = 0; k < kBatchNum; k++) {
+            result &= (ranks_0[k] == fss_rank.Evaluate(keys_0[k], db, posr[k])) && (ranks_1[k] == fss_rank.Evaluate(keys_1[k], db, posr[k]));
+            result &= (packed_0[k] == ranks_0[k]) && (packed_1[k] == ranks_1[k]);
+            for (uint32_t c = 0; c < 2; c++) {
+                result &= (utils::Mod(ranks_0[k][c] + ranks_1[k][c], size) == Rank(db, pos[k], c ? '1' : '0'));
+            }
+            keys_0[k].FreeFssRankKey();
+            keys_1[k].FreeFssRankKey();
+        }
+        utils::Logger::DebugLog(LOCATION, "Domain size: " + std::to_string(size) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_FssRankDcf(const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssRankParameters  params(size, test_info.dbg_info, RankBackend::kDcf);
+        FssRank            fss_rank(params);
+        internal::FssKeyIo key_io(test_info.dbg_info.debug);
+        uint32_t           ts = utils::Pow(2, size);
+
+        // A text with '$' and a length that is not a multiple of the block size
+        std::string db    = GenerateBinaryString(ts > 8 ? ts - 3 : ts);
+        db[db.size() / 2] = '$';
+        CompressedBwt packed;
+        packed.Build(db);
+
+        // The keys read back from FssKeyIo are the same
+        std::pair<FssRankKey, FssRankKey> keys = fss_rank.GenerateKeys();
+        FssRankKey                        key_0, key_1;
+        key_io.WriteFssRankKeyToFile(kRankDcfKeyPath_P0, keys.first);
+        key_io.WriteFssRankKeyToFile(kRankDcfKeyPath_P1, keys.second);
+        key_io.ReadFssRankKeyFromFile(kRankDcfKeyPath_P0, params, key_0);
+        key_io.ReadFssRankKeyFromFile(kRankDcfKeyPath_P1, params, key_1);
+        result &= (key_0 == keys.first) && (key_1 == keys.second) && (key_0.backend == RankBackend::kDcf);
+
+        // The outputs are the shares of the indicator of the positions below pos (all of them for the position 2^t),
+        // and the ranks those of the text; the positions (1 to 2^t) are opened as pos - r_in
+        for (const uint32_t pos : {1U, 2U, static_cast<uint32_t>(db.size()), ts, 1 + tools::rng::SecureRng::Rand32() % ts}) {
+            uint32_t                    posr = utils::Mod(pos - key_0.shr_in - key_1.shr_in, size);
+            utils::HugeVector<uint32_t> outputs_0(ts), outputs_1(ts);
+            fss_rank.EvaluateOutputs(key_0, posr, outputs_0);
+            fss_rank.EvaluateOutputs(key_1, posr, outputs_1);
+            for (uint32_t i = 0; i < ts; i++) {
+                result &= (utils::Mod(outputs_0[i] + outputs_1[i], size) == static_cast<uint32_t>(i < pos));
+            }
+
+            std::array<uint32_t, 2> rank_0 = fss_rank.Evaluate(key_0, db, posr);
+            std::array<uint32_t, 2> rank_1 = fss_rank.Evaluate(key_1, db, posr);
+            result &= (fss_rank.Evaluate(key_0, packed, posr) == rank_0) && (fss_rank.Evaluate(key_1, packed, posr) == rank_1);
+            for (uint32_t c = 0; c < 2; c++) {
+                result &= (utils::Mod(rank_0[c] + rank_1[c], size) == Rank(db, std::min<uint32_t>(pos, db.size()), c ? '1' : '0'));
+            }
+        }
+        keys.first.FreeFssRankKey();
+        keys.second.FreeFssRankKey();
+        key_0.FreeFssRankKey();
+        key_1.FreeFssRankKey();
+        utils::Logger::DebugLog(LOCATION, "Domain size: " + std::to_string(size) + ", Result: " + std::to_string(result), test_info.dbg_info.debug);
+    }
+    return result;
+}
+
+bool Test_FssRankSessionOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        FssRankParameters                            params(size, test_info.dbg_info);
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        FssRank                                      fss_rank(params);
+
+        // Set database (as a string and compressed)
+        std::string db;
+        io.ReadStringFromFile(kRankDBPath, db);
+        CompressedBwt packed;
+        packed.Build(db);
+
+        // Read FssRank key and the share of the position
+        FssRankKey rank_key;
+        uint32_t   pos(0), pos_sh(0);
+        io.ReadValueFromFile(kRankPosPath, pos);
+        if (party.GetId() == 0) {
+            key_io.ReadFssRankKeyFromFile(kRankKeyPath_P0, params, rank_key);
+            io.ReadValueFromFile(kRankPosSharePath_P0, pos_sh);
+        } else {
+            key_io.ReadFssRankKeyFromFile(kRankKeyPath_P1, params, rank_key);
+            io.ReadValueFromFile(kRankPosSharePath_P1, pos_sh);
+        }
+        party.StartCommunication();
+
+        // All the sessions open pos - r_in in the same round (the batched ones are evaluated when the round is flushed)
+        std::vector<FssRankSession>               sessions;
+        tools::secret_sharing::SessionMultiplexer mux(party);
+        FssRankBatch                              batch(fss_rank, db), packed_batch(fss_rank, packed);
+        sessions.reserve(5);
+        sessions.emplace_back(fss_rank, rank_key, db, pos_sh);
+        sessions.emplace_back(fss_rank, rank_key, packed, pos_sh);
+        sessions.emplace_back(fss_rank, rank_key, batch, pos_sh);
+        sessions.emplace_back(fss_rank, rank_key, batch, pos_sh);
+        sessions.emplace_back(fss_rank, rank_key, packed_batch, pos_sh);
+        for (auto &session : sessions) {
+            mux.AddSession(session);
+        }
+        result &= (mux.Run() == 1);
+
+        for (const auto &session : sessions) {
+            std::vector<uint32_t> rank(2), rank_0(2), rank_1(2);
+            ((party.GetId() == 0) ? rank_0 : rank_1) = {session.GetOutput()[0], session.GetOutput()[1]};
+            ss.Reconst(party, rank_0, rank_1, rank);
+            result &= (rank[0] == Rank(db, pos, '0')) && (rank[1] == Rank(db, pos, '1'));
+            utils::Logger::DebugLog(LOCATION, "Position: " + std::to_string(pos) + ", Rank: " + utils::VectorToStr(rank), test_info.dbg_info.debug);
+        }
+        rank_key.FreeFssRankKey();
+    }
+    return result;
+}
+
 }    // namespace test
 }    // namespace rank
 }    // namespace fss
@@ -8,6 +8,7 @@
 
 #include "zero_test_dpf.hpp"
 
+#include "../../fss-base/prg/seeded_rng.hpp"
 #include "../../tools/random_number_generator.hpp"
 #include "../../utils/logger.hpp"
 #include "../../utils/utils.hpp"
@@ -79,6 +80,11 @@ std::pair<ZeroTestKey, ZeroTestKey> ZeroTest::GenerateKeys() const {
     return std::make_pair(std::move(keys[0]), std::move(keys[1]));
 }
 
+std::pair<ZeroTestKey, ZeroTestKey> ZeroTest::GenerateKeys(const Block &seed, const uint64_t key_index) const {
+    prg::SeededRandomness randomness(seed, key_index);
+    return this->GenerateKeys();
+}
+
 uint32_t ZeroTest::EvaluateAt(const ZeroTestKey &zt_key, const uint32_t x) const {
     uint32_t output = this->dpf_.EvaluateAt(zt_key.dpf_key, x);
 #ifdef LOG_LEVEL_DEBUG
@@ -89,5 +95,30 @@ uint32_t ZeroTest::EvaluateAt(const ZeroTestKey &zt_key, const uint32_t x) const
     return output;
 }
 
+ZeroTestSession::ZeroTestSession(const ZeroTest &zt, const ZeroTestKey &zt_key, const uint32_t x)
+    : zt_(zt), zt_key_(zt_key), xr_(utils::Mod(x + zt_key.shr_in, zt.params_.input_bitsize)), output_(0), finished_(false) {
+}
+
+bool ZeroTestSession::IsFinished() const {
+    return this->finished_;
+}
+
+uint32_t ZeroTestSession::GetOpeningSize() const {
+    return this->finished_ ? 0 : 1;
+}
+
+void ZeroTestSession::WriteOpening(uint32_t *shares) const {
+    shares[0] = this->xr_;
+}
+
+void ZeroTestSession::Resume(const uint32_t *opened) {
+    this->output_   = this->zt_.EvaluateAt(this->zt_key_, utils::Mod(opened[0], this->zt_.params_.input_bitsize));
+    this->finished_ = true;
+}
+
+uint32_t ZeroTestSession::GetOutput() const {
+    return this->output_;
+}
+
 }    // namespace zt
 }    // namespace fss
@@ -10,6 +10,7 @@
 #define ZT_ZERO_TEST_DPF_H_
 
 #include "../../fss-base/dpf/distributed_point_function.hpp"
+#include "../../tools/protocol_session.hpp"
 #include "../../tools/secret_sharing.hpp"
 
 namespace fss {
@@ -111,6 +112,14 @@ public:
      */
     std::pair<ZeroTestKey, ZeroTestKey> GenerateKeys() const;
 
+    /**
+     * @brief Generate a pair of ZeroTestKey instances from a seed (see prg::SeededRandomness).
+     * @param seed The master seed.
+     * @param key_index The index of the keys.
+     * @return The same keys for the same seed and index.
+     */
+    std::pair<ZeroTestKey, ZeroTestKey> GenerateKeys(const Block &seed, const uint64_t key_index) const;
+
     /**
      * @brief Evaluate the Zero Test at a specific point.
      * @param zt_key The ZeroTestKey instance to use for evaluation.
@@ -120,10 +129,47 @@ public:
     uint32_t EvaluateAt(const ZeroTestKey &zt_key, const uint32_t x) const;
 
 private:
+    friend class ZeroTestSession;
+
     const ZeroTestParameters            params_; /**< Parameters for ZeroTest. */
     const dpf::DistributedPointFunction dpf_;    /**< Underlying DistributedPointFunction instance. */
 };
 
+/**
+ * @class ZeroTestSession
+ * @brief Resumable Zero Test of a share: one round opens x + r_in, then the key is evaluated at the opened value.
+ *
+ * The key and the ZeroTest object must outlive the session.
+ */
+class ZeroTestSession : public tools::secret_sharing::ProtocolSession {
+public:
+    /**
+     * @brief Construct a new ZeroTestSession.
+     * @param zt The ZeroTest object.
+     * @param zt_key The ZeroTestKey of this party.
+     * @param x The share of the input.
+     */
+    ZeroTestSession(const ZeroTest &zt, const ZeroTestKey &zt_key, const uint32_t x);
+
+    bool     IsFinished() const override;
+    uint32_t GetOpeningSize() const override;
+    void     WriteOpening(uint32_t *shares) const override;
+    void     Resume(const uint32_t *opened) override;
+
+    /**
+     * @brief Get the output of the Zero Test (available after the session is finished).
+     * @return The share of 1 if x = 0 else 0.
+     */
+    uint32_t GetOutput() const;
+
+private:
+    const ZeroTest    &zt_;       /**< The ZeroTest object. */
+    const ZeroTestKey &zt_key_;   /**< The ZeroTestKey of this party. */
+    uint32_t           xr_;       /**< The share of x + r_in. */
+    uint32_t           output_;   /**< The share of the result. */
+    bool               finished_; /**< Flag indicating the output is available. */
+};
+
 namespace test {
 
 void Test_ZeroTest(tools::secret_sharing::Party &party, TestInfo &test_info);
@@ -43,9 +43,10 @@ bool Test_ZeroTestOffline(tools::secret_sharing::Party &party, const TestInfo &t
 bool Test_ZeroTestOneBitOffline(tools::secret_sharing::Party &party, const TestInfo &test_info);
 bool Test_ZeroTestOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
 bool Test_ZeroTestOneBitOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
+bool Test_ZeroTestSessionOnline(tools::secret_sharing::Party &party, const TestInfo &test_info);
 
 void Test_ZeroTest(tools::secret_sharing::Party &party, TestInfo &test_info) {
-    std::vector<std::string> modes         = {"Zero Test unit tests", "ZeroTestOffline", "ZeroTestOneBitOffline", "ZeroTestOnline", "ZeroTestOneBitOnline"};
+    std::vector<std::string> modes         = {"Zero Test unit tests", "ZeroTestOffline", "ZeroTestOneBitOffline", "ZeroTestOnline", "ZeroTestOneBitOnline", "ZeroTestSessionOnline"};
     uint32_t                 selected_mode = test_info.mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -63,6 +64,7 @@ void Test_ZeroTest(tools::secret_sharing::Party &party, TestInfo &test_info) {
         }
         utils::PrintTestResult("Test_ZeroTestOnline", Test_ZeroTestOnline(party, test_info));
         utils::PrintTestResult("Test_ZeroTestOneBitOnline", Test_ZeroTestOneBitOnline(party, test_info));
+        utils::PrintTestResult("Test_ZeroTestSessionOnline", Test_ZeroTestSessionOnline(party, test_info));
     } else if (selected_mode == 2) {
         utils::PrintTestResult("Test_ZeroTestOffline", Test_ZeroTestOffline(party, test_info));
     } else if (selected_mode == 3) {
@@ -71,6 +73,8 @@ void Test_ZeroTest(tools::secret_sharing::Party &party, TestInfo &test_info) {
         utils::PrintTestResult("Test_ZeroTestOnline", Test_ZeroTestOnline(party, test_info));
     } else if (selected_mode == 5) {
         utils::PrintTestResult("Test_ZeroTestOneBitOnline", Test_ZeroTestOneBitOnline(party, test_info));
+    } else if (selected_mode == 6) {
+        utils::PrintTestResult("Test_ZeroTestSessionOnline", Test_ZeroTestSessionOnline(party, test_info));
     }
     utils::PrintText(utils::kDash);
 }
@@ -250,6 +254,54 @@ bool Test_ZeroTestOneBitOnline(tools::secret_sharing::Party &party, const TestIn
     return result;
 }
 
+bool Test_ZeroTestSessionOnline(tools::secret_sharing::Party &party, const TestInfo &test_info) {
+    bool result = true;
+    for (const auto size : test_info.domain_size) {
+        ZeroTestParameters                           params(size, size, test_info.dbg_info);
+        tools::secret_sharing::AdditiveSecretSharing ss(size);
+        utils::FileIo                                io;
+        internal::FssKeyIo                           key_io(test_info.dbg_info.debug);
+        ZeroTest                                     zt(params);
+
+        // Read Zero Test key and input data
+        ZeroTestKey           zt_key;
+        std::vector<uint32_t> x, x_sh;
+        io.ReadVectorFromFile(kZtDataPath_X, x);
+        if (party.GetId() == 0) {
+            key_io.ReadZeroTestKeyFromFile(kZtKeyPath_P0, params, zt_key);
+            io.ReadVectorFromFile(kZtSharePath_X_P0, x_sh);
+        } else {
+            key_io.ReadZeroTestKeyFromFile(kZtKeyPath_P1, params, zt_key);
+            io.ReadVectorFromFile(kZtSharePath_X_P1, x_sh);
+        }
+        party.StartCommunication();
+
+        // Every element in its own session, all opened in one round
+        std::vector<ZeroTestSession>              sessions;
+        tools::secret_sharing::SessionMultiplexer mux(party);
+        sessions.reserve(kNumOfElement);
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            sessions.emplace_back(zt, zt_key, x_sh[i]);
+        }
+        for (auto &session : sessions) {
+            mux.AddSession(session);
+        }
+        result &= (mux.Run() == 1);
+
+        std::vector<uint32_t> e_0(kNumOfElement), e_1(kNumOfElement), e(kNumOfElement);
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            ((party.GetId() == 0) ? e_0 : e_1)[i] = sessions[i].GetOutput();
+        }
+        ss.Reconst(party, e_0, e_1, e);
+        for (uint32_t i = 0; i < kNumOfElement; i++) {
+            result &= (e[i] == (x[i] == 0 ? 1 : 0));
+        }
+        utils::Logger::DebugLog(LOCATION, "e: " + utils::VectorToStr(e), test_info.dbg_info.debug);
+        zt_key.FreeZeroTestKey();
+    }
+    return result;
+}
+
 }    // namespace test
 }    // namespace zt
 }    // namespace fss
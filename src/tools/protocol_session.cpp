@@ -0,0 +1,430 @@
+/**
+ * @file protocol_session.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-15
+ * @copyright Copyright (c) 2024
+ * @brief Resumable protocol sessions, the session multiplexers and the session scheduler implementation.
+ */
+
+#include "protocol_session.hpp"
+
+#include <algorithm>
+#include <future>
+#include <thread>
+
+#include "../utils/logger.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/utils.hpp"
+
+namespace {
+
+utils::Gauge &SessionsInFlight() {
+    static utils::Gauge &gauge = utils::MetricsRegistry::GetInstance().GetGauge("fss_sessions_in_flight", "Number of unfinished sessions in the session multiplexers.");
+    return gauge;
+}
+
+utils::Gauge &SessionsPending() {
+    static utils::Gauge &gauge = utils::MetricsRegistry::GetInstance().GetGauge("fss_sessions_pending", "Number of sessions waiting for admission in the session schedulers.");
+    return gauge;
+}
+
+utils::Counter &DeadlineMisses() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_session_deadline_misses_total", "Number of scheduled sessions finished after their deadline.");
+    return counter;
+}
+
+utils::Counter &SessionsRejected() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_sessions_rejected_total", "Number of sessions refused because the waiting queue was full.");
+    return counter;
+}
+
+utils::Histogram &SessionRounds() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_session_rounds", "Number of scheduler rounds from the arrival to the end of a session.", {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024});
+    return histogram;
+}
+
+// Flush the batches of the resumed sessions (each batch once, in the order of the sessions)
+void FlushRoundBatches(const std::vector<tools::secret_sharing::ProtocolSession *> &sessions) {
+    std::vector<tools::secret_sharing::RoundBatch *> batches;
+    for (const tools::secret_sharing::ProtocolSession *session : sessions) {
+        tools::secret_sharing::RoundBatch *batch = session->GetRoundBatch();
+        if (batch != nullptr && std::find(batches.begin(), batches.end(), batch) == batches.end()) {
+            batches.push_back(batch);
+        }
+    }
+    for (tools::secret_sharing::RoundBatch *batch : batches) {
+        batch->Flush();
+    }
+}
+
+}    // namespace
+
+namespace tools {
+namespace secret_sharing {
+
+SessionMultiplexer::SessionMultiplexer(Party &party)
+    : party_(party) {
+}
+
+void SessionMultiplexer::AddSession(ProtocolSession &session) {
+    this->sessions_.push_back(&session);
+}
+
+void SessionMultiplexer::Clear() {
+    this->sessions_.clear();
+}
+
+uint32_t SessionMultiplexer::Run() {
+    uint32_t                       rounds = 0;
+    std::vector<ProtocolSession *> active;
+    std::vector<uint32_t>          x_vec_0, x_vec_1;
+
+    while (true) {
+        // Collect the openings of the unfinished sessions
+        active.clear();
+        size_t total = 0;
+        for (ProtocolSession *session : this->sessions_) {
+            if (!session->IsFinished()) {
+                active.push_back(session);
+                total += session->GetOpeningSize();
+            }
+        }
+        SessionsInFlight().Set(static_cast<int64_t>(active.size()));
+        if (active.empty()) {
+            break;
+        }
+
+        x_vec_0.assign(total, 0);
+        x_vec_1.assign(total, 0);
+        std::vector<uint32_t> &own    = (this->party_.GetId() == 0) ? x_vec_0 : x_vec_1;
+        size_t                 offset = 0;
+        for (ProtocolSession *session : active) {
+            session->WriteOpening(own.data() + offset);
+            offset += session->GetOpeningSize();
+        }
+
+        // One message for all sessions in this round
+        this->party_.SendRecv(x_vec_0, x_vec_1);
+        for (size_t i = 0; i < total; i++) {
+            x_vec_0[i] += x_vec_1[i];
+        }
+
+        offset = 0;
+        for (ProtocolSession *session : active) {
+            uint32_t size = session->GetOpeningSize();
+            session->Resume(x_vec_0.data() + offset);
+            offset += size;
+        }
+        FlushRoundBatches(active);
+        rounds++;
+    }
+    return rounds;
+}
+
+PipelinedMultiplexer::PipelinedMultiplexer(Party &party, const uint32_t depth)
+    : party_(party), batches_(std::max<uint32_t>(depth, 1)), session_num_(0) {
+}
+
+void PipelinedMultiplexer::AddSession(ProtocolSession &session) {
+    this->batches_[this->session_num_++ % this->batches_.size()].push_back(&session);
+}
+
+void PipelinedMultiplexer::Clear() {
+    for (auto &batch : this->batches_) {
+        batch.clear();
+    }
+    this->session_num_ = 0;
+}
+
+uint32_t PipelinedMultiplexer::Run() {
+    struct Flight {
+        std::vector<ProtocolSession *> active;    /**< The unfinished sessions of the batch. */
+        std::vector<uint32_t>          sent;      /**< The shares of this party. */
+        std::vector<uint32_t>          received;  /**< The shares of the other party. */
+        std::shared_future<void>       send;      /**< The sending of the openings. */
+        std::shared_future<void>       recv;      /**< The receiving of the openings. */
+        bool                           in_flight; /**< Flag indicating the openings are posted. */
+    };
+    std::vector<Flight>      flights(this->batches_.size());
+    std::shared_future<void> last_send, last_recv;
+    bool                     overlap = (this->party_.GetTranscriptMode() == TranscriptMode::kNone);
+    uint32_t                 id      = this->party_.GetId();
+
+    // Collect the openings of the unfinished sessions of a batch and post them
+    auto post = [&](const size_t b) {
+        Flight &flight = flights[b];
+        flight.active.clear();
+        flight.sent.clear();
+        for (ProtocolSession *session : this->batches_[b]) {
+            if (!session->IsFinished()) {
+                size_t offset = flight.sent.size();
+                flight.active.push_back(session);
+                flight.sent.resize(offset + session->GetOpeningSize());
+                session->WriteOpening(flight.sent.data() + offset);
+            }
+        }
+        flight.in_flight = !flight.active.empty();
+        if (!flight.in_flight) {
+            return;
+        }
+        if (!overlap) {
+            flight.received.assign(flight.sent.size(), 0);
+            if (id == 0) {
+                this->party_.SendRecv(flight.sent, flight.received);
+            } else {
+                this->party_.SendRecv(flight.received, flight.sent);
+            }
+            return;
+        }
+        // The messages leave and arrive in the order they are posted (each transfer waits for the previous one)
+        flight.send = std::async(std::launch::async, [this, &flight, prev = last_send]() {
+                          if (prev.valid()) {
+                              prev.wait();
+                          }
+                          this->party_.Send(flight.sent);
+                      }).share();
+        flight.recv = std::async(std::launch::async, [this, &flight, prev = last_recv]() {
+                          if (prev.valid()) {
+                              prev.wait();
+                          }
+                          this->party_.Recv(flight.received);
+                      }).share();
+        last_send   = flight.send;
+        last_recv   = flight.recv;
+    };
+
+    for (size_t b = 0; b < flights.size(); b++) {
+        post(b);
+    }
+    uint32_t messages = 0;
+    bool     running  = true;
+    while (running) {
+        running = false;
+        for (size_t b = 0; b < flights.size(); b++) {
+            Flight &flight = flights[b];
+            if (!flight.in_flight) {
+                continue;
+            }
+            if (overlap) {
+                flight.send.get();
+                flight.recv.get();
+            }
+            if (flight.received.size() != flight.sent.size()) {
+                utils::Logger::FatalLog(LOCATION, "The openings of the parties do not match");
+                exit(EXIT_FAILURE);
+            }
+            // Resume this batch while the openings of the other batches are in flight
+            size_t offset = 0;
+            for (ProtocolSession *session : flight.active) {
+                uint32_t size = session->GetOpeningSize();
+                for (size_t i = offset; i < offset + size; i++) {
+                    flight.received[i] += flight.sent[i];
+                }
+                session->Resume(flight.received.data() + offset);
+                offset += size;
+            }
+            FlushRoundBatches(flight.active);
+            messages++;
+            post(b);
+            running |= flight.in_flight;
+        }
+    }
+    return messages;
+}
+
+SessionScheduler::SessionScheduler(Party &party, const SchedulerLimits &limits)
+    : party_(party), limits_(limits), memory_in_use_(0), round_(0), next_seq_(0), deadline_miss_(0) {
+}
+
+bool SessionScheduler::AddSession(ProtocolSession &session, const SessionOptions &options) {
+    if (this->limits_.max_pending != 0 && this->pending_.size() >= this->limits_.max_pending) {
+        SessionsRejected().Increment(1);
+        return false;
+    }
+    this->pending_.push_back({&session, options, this->next_seq_++, this->round_});
+    return true;
+}
+
+bool SessionScheduler::IsMoreUrgent(const Entry &lhs, const Entry &rhs) {
+    if (lhs.options.priority != rhs.options.priority) {
+        return lhs.options.priority < rhs.options.priority;
+    }
+    if (lhs.options.deadline != rhs.options.deadline) {
+        return lhs.options.deadline < rhs.options.deadline;
+    }
+    return lhs.seq < rhs.seq;
+}
+
+void SessionScheduler::Admit() {
+    std::stable_sort(this->pending_.begin(), this->pending_.end(), IsMoreUrgent);
+    size_t admitted = 0;
+    for (const Entry &entry : this->pending_) {
+        // A session larger than the limit runs alone; otherwise stop at the first session that does not fit (no overtaking)
+        bool fits = (this->limits_.memory_limit == 0) ||
+                    (this->memory_in_use_ + entry.options.memory_bytes <= this->limits_.memory_limit) ||
+                    this->running_.empty();
+        if (!fits) {
+            break;
+        }
+        this->memory_in_use_ += entry.options.memory_bytes;
+        this->running_.push_back(entry);
+        admitted++;
+    }
+    this->pending_.erase(this->pending_.begin(), this->pending_.begin() + admitted);
+}
+
+void SessionScheduler::Retire() {
+    auto finished = [this](const Entry &entry) {
+        if (!entry.session->IsFinished()) {
+            return false;
+        }
+        this->memory_in_use_ -= entry.options.memory_bytes;
+        SessionRounds().Observe(static_cast<double>(this->round_ - entry.added_at));
+        if (this->round_ > entry.options.deadline) {
+            this->deadline_miss_++;
+            DeadlineMisses().Increment(1);
+        }
+        return true;
+    };
+    this->running_.erase(std::remove_if(this->running_.begin(), this->running_.end(), finished), this->running_.end());
+}
+
+bool SessionScheduler::RunRound() {
+    // Retire again after the admission (sessions without rounds finish on arrival)
+    this->Retire();
+    this->Admit();
+    this->Retire();
+    SessionsInFlight().Set(static_cast<int64_t>(this->running_.size()));
+    SessionsPending().Set(static_cast<int64_t>(this->pending_.size()));
+    if (this->running_.empty()) {
+        return false;
+    }
+
+    // Advance the most urgent sessions within the limits of the round (at least one)
+    std::stable_sort(this->running_.begin(), this->running_.end(), IsMoreUrgent);
+    std::vector<Entry *> selected;
+    std::vector<size_t>  offsets;
+    size_t               total = 0;
+    for (Entry &entry : this->running_) {
+        if (this->limits_.max_sessions_per_round != 0 && selected.size() >= this->limits_.max_sessions_per_round) {
+            break;
+        }
+        size_t size = entry.session->GetOpeningSize();
+        if (this->limits_.max_words_per_round != 0 && !selected.empty() && total + size > this->limits_.max_words_per_round) {
+            continue;
+        }
+        selected.push_back(&entry);
+        offsets.push_back(total);
+        total += size;
+    }
+
+    std::vector<uint32_t>  x_vec_0(total, 0), x_vec_1(total, 0);
+    std::vector<uint32_t> &own = (this->party_.GetId() == 0) ? x_vec_0 : x_vec_1;
+    for (size_t i = 0; i < selected.size(); i++) {
+        selected[i]->session->WriteOpening(own.data() + offsets[i]);
+    }
+
+    // One message for the selected sessions in this round
+    this->party_.SendRecv(x_vec_0, x_vec_1);
+    for (size_t i = 0; i < total; i++) {
+        x_vec_0[i] += x_vec_1[i];
+    }
+    this->ResumeAll(selected, offsets, x_vec_0);
+    std::vector<ProtocolSession *> resumed(selected.size());
+    for (size_t i = 0; i < selected.size(); i++) {
+        resumed[i] = selected[i]->session;
+    }
+    FlushRoundBatches(resumed);
+    this->round_++;
+    return true;
+}
+
+void SessionScheduler::ResumeAll(const std::vector<Entry *> &selected, const std::vector<size_t> &offsets, const std::vector<uint32_t> &opened) const {
+    uint32_t thread_num = std::min<uint32_t>(std::max<uint32_t>(this->limits_.thread_num, 1), selected.size());
+    if (thread_num <= 1) {
+        for (size_t i = 0; i < selected.size(); i++) {
+            selected[i]->session->Resume(opened.data() + offsets[i]);
+        }
+        return;
+    }
+    // Thread t resumes the sessions t, t + thread_num, ... (the sessions share no state but their round batches)
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < thread_num; t++) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = t; i < selected.size(); i += thread_num) {
+                selected[i]->session->Resume(opened.data() + offsets[i]);
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+uint64_t SessionScheduler::Run() {
+    uint64_t rounds = 0;
+    while (this->RunRound()) {
+        rounds++;
+    }
+    return rounds;
+}
+
+uint64_t SessionScheduler::GetRound() const {
+    return this->round_;
+}
+
+size_t SessionScheduler::GetPendingNum() const {
+    return this->pending_.size();
+}
+
+size_t SessionScheduler::GetRunningNum() const {
+    return this->running_.size();
+}
+
+uint64_t SessionScheduler::GetDeadlineMissNum() const {
+    return this->deadline_miss_;
+}
+
+MultSession::MultSession(const uint32_t party_id, const uint32_t bitsize, const bts_t &bt_vec, const std::vector<uint32_t> &x, const std::vector<uint32_t> &y)
+    : party_id_(party_id), bitsize_(bitsize), bt_vec_(bt_vec.begin(), bt_vec.begin() + std::min(bt_vec.size(), x.size())), de_(x.size() * 2), z_(x.size()), finished_(x.empty()) {
+    if (bt_vec.size() < x.size() || y.size() != x.size()) {
+        utils::Logger::FatalLog(LOCATION, "The number of Beaver triples or operands does not match");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < x.size(); i++) {
+        this->de_[2 * i]     = utils::Mod(x[i] - bt_vec[i].a, bitsize);
+        this->de_[2 * i + 1] = utils::Mod(y[i] - bt_vec[i].b, bitsize);
+    }
+}
+
+bool MultSession::IsFinished() const {
+    return this->finished_;
+}
+
+uint32_t MultSession::GetOpeningSize() const {
+    return this->finished_ ? 0 : this->de_.size();
+}
+
+void MultSession::WriteOpening(uint32_t *shares) const {
+    std::copy(this->de_.begin(), this->de_.end(), shares);
+}
+
+void MultSession::Resume(const uint32_t *opened) {
+    for (size_t i = 0; i < this->z_.size(); i++) {
+        uint32_t d = utils::Mod(opened[2 * i], this->bitsize_);
+        uint32_t e = utils::Mod(opened[2 * i + 1], this->bitsize_);
+        if (this->party_id_ == 0) {
+            this->z_[i] = utils::Mod((e * this->bt_vec_[i].a) + (d * this->bt_vec_[i].b) + this->bt_vec_[i].c + (d * e), this->bitsize_);
+        } else {
+            this->z_[i] = utils::Mod((e * this->bt_vec_[i].a) + (d * this->bt_vec_[i].b) + this->bt_vec_[i].c, this->bitsize_);
+        }
+    }
+    this->finished_ = true;
+}
+
+const std::vector<uint32_t> &MultSession::GetOutput() const {
+    return this->z_;
+}
+
+}    // namespace secret_sharing
+}    // namespace tools
@@ -0,0 +1,337 @@
+/**
+ * @file protocol_session.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-15
+ * @copyright Copyright (c) 2024
+ * @brief Resumable protocol sessions, the session multiplexers and the session scheduler.
+ */
+
+#ifndef TOOLS_PROTOCOL_SESSION_H_
+#define TOOLS_PROTOCOL_SESSION_H_
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "secret_sharing.hpp"
+
+namespace tools {
+namespace secret_sharing {
+
+/**
+ * @brief Local work queued by the sessions of a round and done once for all of them.
+ *
+ * A session that returns a batch from GetRoundBatch may queue its work in Resume instead of doing it, as long as
+ * its next opening does not need the result before the batch is flushed. The multiplexers and the scheduler flush
+ * every batch of the round once all its sessions are resumed and before the openings of the next round are collected
+ * (e.g. the ranks of all the sessions of a round with one pass over the BWT). Resume may run on several threads.
+ */
+class RoundBatch {
+public:
+    virtual ~RoundBatch() = default;
+
+    /**
+     * @brief Do the work queued by the sessions resumed since the last flush.
+     */
+    virtual void Flush() = 0;
+};
+
+/**
+ * @brief A protocol execution split at its communication rounds.
+ *
+ * Instead of blocking in Party::SendRecv, a session exposes the shares it wants to open in the current round
+ * and is resumed with the opened values. The local computation up to the next opening runs inside Resume.
+ * Both parties must drive their sessions in the same order, and the opening size of a round must not depend on private data.
+ */
+class ProtocolSession {
+public:
+    virtual ~ProtocolSession() = default;
+
+    /**
+     * @brief Check whether the session has no more rounds.
+     * @return `true` if the output of the session is available.
+     */
+    virtual bool IsFinished() const = 0;
+
+    /**
+     * @brief Get the number of shares opened in the current round (must be positive unless finished).
+     * @return The number of shares.
+     */
+    virtual uint32_t GetOpeningSize() const = 0;
+
+    /**
+     * @brief Write the shares of this party opened in the current round.
+     * @param shares The destination (GetOpeningSize() elements).
+     */
+    virtual void WriteOpening(uint32_t *shares) const = 0;
+
+    /**
+     * @brief Resume the session with the opened values and run until the next opening.
+     * @param opened The sum of both shares (mod 2^32, reduced by the session).
+     */
+    virtual void Resume(const uint32_t *opened) = 0;
+
+    /**
+     * @brief Get the batch that completes the work queued by Resume (see RoundBatch).
+     * @return The batch, or nullptr if Resume does all the work.
+     */
+    virtual RoundBatch *GetRoundBatch() const {
+        return nullptr;
+    }
+};
+
+/**
+ * @brief Runs many sessions on one thread and one connection.
+ *
+ * In every round, the openings of all unfinished sessions are concatenated into a single message,
+ * so N sessions of R rounds take R round trips instead of N * R.
+ * Several multiplexers (each with its own Party) can run on separate threads.
+ */
+class SessionMultiplexer {
+public:
+    /**
+     * @brief Construct a new SessionMultiplexer.
+     * @param party The party used for the openings.
+     */
+    SessionMultiplexer(Party &party);
+
+    /**
+     * @brief Add a session (not owned) to the multiplexer.
+     * @param session The session to be executed.
+     */
+    void AddSession(ProtocolSession &session);
+
+    /**
+     * @brief Remove all sessions.
+     */
+    void Clear();
+
+    /**
+     * @brief Run all sessions to completion.
+     * @return The number of communication rounds.
+     */
+    uint32_t Run();
+
+private:
+    Party                         &party_;    /**< The party used for the openings. */
+    std::vector<ProtocolSession *> sessions_; /**< The sessions to be executed. */
+};
+
+/**
+ * @brief Runs several batches of sessions out of phase on one connection.
+ *
+ * The sessions are dealt round-robin into `depth` batches. Each batch advances like a SessionMultiplexer
+ * (one message per round), but its openings are sent and received by background threads (Party::Send and
+ * Party::Recv), so while the openings of one batch are in flight, the main thread resumes the other batches
+ * (e.g. the rank evaluations of the next FssFmi step). A round then costs about max(compute, network)
+ * instead of their sum. Both parties must add the same sessions in the same order.
+ * With a transcript (recording or replaying), the rounds fall back to the blocking SendRecv.
+ */
+class PipelinedMultiplexer {
+public:
+    /**
+     * @brief Construct a new PipelinedMultiplexer.
+     * @param party The party used for the openings.
+     * @param depth The number of batches in flight (at least 1).
+     */
+    PipelinedMultiplexer(Party &party, const uint32_t depth = 2);
+
+    /**
+     * @brief Add a session (not owned) to the next batch.
+     * @param session The session to be executed.
+     */
+    void AddSession(ProtocolSession &session);
+
+    /**
+     * @brief Remove all sessions.
+     */
+    void Clear();
+
+    /**
+     * @brief Run all sessions to completion.
+     * @return The number of messages exchanged (the rounds of all batches).
+     */
+    uint32_t Run();
+
+private:
+    Party                                      &party_;       /**< The party used for the openings. */
+    std::vector<std::vector<ProtocolSession *>> batches_;     /**< The sessions of each batch. */
+    size_t                                      session_num_; /**< The number of sessions added. */
+};
+
+/**
+ * @brief The priority class of a scheduled session.
+ */
+enum class SessionPriority {
+    kInteractive, /**< Short queries waiting for an answer (served first). */
+    kBatch,       /**< Long or background queries (served with the remaining capacity). */
+};
+
+/**
+ * @brief The scheduling options of a session.
+ *
+ * All the fields are public parameters and must be the same on both parties.
+ */
+struct SessionOptions {
+    SessionPriority priority     = SessionPriority::kBatch;              /**< The priority class. */
+    uint64_t        deadline     = std::numeric_limits<uint64_t>::max(); /**< The scheduler round by which the session should finish. */
+    uint64_t        memory_bytes = 0;                                    /**< The estimated memory of the session while it runs. */
+};
+
+/**
+ * @brief The capacity limits of a session scheduler (0 means unlimited).
+ */
+struct SchedulerLimits {
+    uint32_t max_sessions_per_round = 0; /**< The maximum number of sessions advanced in one round. */
+    uint64_t max_words_per_round    = 0; /**< The maximum number of shares opened in one round. */
+    uint64_t memory_limit           = 0; /**< The maximum total memory of the running sessions. */
+    uint32_t max_pending            = 0; /**< The maximum number of sessions waiting for admission. */
+    uint32_t thread_num             = 1; /**< The number of threads resuming the sessions of a round. */
+};
+
+/**
+ * @brief Runs many sessions on one connection, advancing the most urgent ones round by round.
+ *
+ * The unit of work is one round of a session (one opening followed by the local computation up to the next one).
+ * In every round, the running sessions are ordered by (priority, deadline, arrival) and advanced in this order
+ * as long as the round stays within the session and word limits, so a long batch session yields the round to the
+ * interactive ones instead of holding the connection until it finishes (earliest-deadline-first within a class).
+ * Waiting sessions are admitted in the same order while the memory of the running sessions stays within the limit,
+ * and AddSession refuses new sessions when the waiting queue is full.
+ * Every decision depends on the public options only, so both parties advance the same sessions in every round
+ * as long as they add the same sessions in the same order.
+ */
+class SessionScheduler {
+public:
+    /**
+     * @brief Construct a new SessionScheduler.
+     * @param party The party used for the openings.
+     * @param limits The capacity limits.
+     */
+    SessionScheduler(Party &party, const SchedulerLimits &limits = SchedulerLimits());
+
+    /**
+     * @brief Add a session (not owned) to the waiting queue.
+     * @param session The session to be executed.
+     * @param options The scheduling options.
+     * @return `false` if the waiting queue is full (the session is not added).
+     */
+    bool AddSession(ProtocolSession &session, const SessionOptions &options = SessionOptions());
+
+    /**
+     * @brief Admit the waiting sessions and run one communication round.
+     * @return `false` if there is no session left.
+     */
+    bool RunRound();
+
+    /**
+     * @brief Run all sessions to completion.
+     * @return The number of communication rounds.
+     */
+    uint64_t Run();
+
+    /**
+     * @brief Get the number of rounds run so far (the clock of the deadlines).
+     * @return The number of rounds.
+     */
+    uint64_t GetRound() const;
+
+    /**
+     * @brief Get the number of sessions waiting for admission.
+     * @return The number of sessions.
+     */
+    size_t GetPendingNum() const;
+
+    /**
+     * @brief Get the number of admitted sessions not finished yet.
+     * @return The number of sessions.
+     */
+    size_t GetRunningNum() const;
+
+    /**
+     * @brief Get the number of sessions finished after their deadline.
+     * @return The number of sessions.
+     */
+    uint64_t GetDeadlineMissNum() const;
+
+private:
+    struct Entry {
+        ProtocolSession *session;  /**< The session. */
+        SessionOptions   options;  /**< The scheduling options. */
+        uint64_t         seq;      /**< The arrival order. */
+        uint64_t         added_at; /**< The round at which the session was added. */
+    };
+
+    Party                &party_;         /**< The party used for the openings. */
+    const SchedulerLimits limits_;        /**< The capacity limits. */
+    std::vector<Entry>    pending_;       /**< The sessions waiting for admission. */
+    std::vector<Entry>    running_;       /**< The admitted sessions. */
+    uint64_t              memory_in_use_; /**< The total memory of the running sessions. */
+    uint64_t              round_;         /**< The number of rounds run so far. */
+    uint64_t              next_seq_;      /**< The arrival order of the next session. */
+    uint64_t              deadline_miss_; /**< The number of sessions finished after their deadline. */
+
+    /**
+     * @brief Compare the urgency of two sessions.
+     * @return `true` if lhs is served before rhs.
+     */
+    static bool IsMoreUrgent(const Entry &lhs, const Entry &rhs);
+
+    /**
+     * @brief Move the waiting sessions to the running ones while the memory limit allows.
+     */
+    void Admit();
+
+    /**
+     * @brief Remove the finished sessions and release their memory.
+     */
+    void Retire();
+
+    /**
+     * @brief Resume the selected sessions with the opened values (on limits_.thread_num threads).
+     * @param selected The sessions advanced in this round.
+     * @param offsets The offsets of their openings.
+     * @param opened The opened values.
+     */
+    void ResumeAll(const std::vector<Entry *> &selected, const std::vector<size_t> &offsets, const std::vector<uint32_t> &opened) const;
+};
+
+/**
+ * @brief Element-wise multiplication of the shares with Beaver triples as a one-round session.
+ */
+class MultSession : public ProtocolSession {
+public:
+    /**
+     * @brief Construct a new MultSession.
+     * @param party_id The ID of this party.
+     * @param bitsize The bit size of the shares.
+     * @param bt_vec The Beaver triple shares (one per element, copied so that each session owns its triples).
+     * @param x The shares of the first operand.
+     * @param y The shares of the second operand.
+     */
+    MultSession(const uint32_t party_id, const uint32_t bitsize, const bts_t &bt_vec, const std::vector<uint32_t> &x, const std::vector<uint32_t> &y);
+
+    bool     IsFinished() const override;
+    uint32_t GetOpeningSize() const override;
+    void     WriteOpening(uint32_t *shares) const override;
+    void     Resume(const uint32_t *opened) override;
+
+    /**
+     * @brief Get the shares of the product (available after the session is finished).
+     * @return The shares of x * y.
+     */
+    const std::vector<uint32_t> &GetOutput() const;
+
+private:
+    const uint32_t        party_id_; /**< The ID of this party. */
+    const uint32_t        bitsize_;  /**< The bit size of the shares. */
+    const bts_t           bt_vec_;   /**< The Beaver triple shares of this session. */
+    std::vector<uint32_t> de_;       /**< The shares of (x - a, y - b) for each element. */
+    std::vector<uint32_t> z_;        /**< The shares of the product. */
+    bool                  finished_; /**< Flag indicating the product is available. */
+};
+
+}    // namespace secret_sharing
+}    // namespace tools
+
+#endif    // TOOLS_PROTOCOL_SESSION_H_
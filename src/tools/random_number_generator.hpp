@@ -25,6 +25,22 @@ namespace rng {
 
 using byte = uint8_t;    // Alias for a byte
 
+/**
+ * @class RandomSource
+ * @brief A source of randomness that replaces the default one of SecureRng on a thread (see SecureRng::SetThreadSource).
+ */
+class RandomSource {
+public:
+    virtual ~RandomSource() = default;
+
+    /**
+     * @brief Fill the bytes with randomness.
+     * @param data The bytes.
+     * @param size The number of bytes.
+     */
+    virtual void Fill(byte *data, const size_t size) = 0;
+};
+
 class SecureRng {
 public:
     // Generate a random 16-bit number.
@@ -47,9 +63,26 @@ public:
         return (Rand<uint16_t>() & 0x01) != 0;
     }
 
+    // Draw the randomness of the calling thread from the source (nullptr restores the default), and return the previous source.
+    static inline RandomSource *SetThreadSource(RandomSource *source) {
+        RandomSource *prev = ThreadSource();
+        ThreadSource()     = source;
+        return prev;
+    }
+
 private:
+    static inline RandomSource *&ThreadSource() {
+        static thread_local RandomSource *source = nullptr;
+        return source;
+    }
+
     template <typename T>
     static T Rand() {
+        if (ThreadSource() != nullptr) {
+            T rand_num;
+            ThreadSource()->Fill(reinterpret_cast<byte *>(&rand_num), sizeof(T));
+            return rand_num;
+        }
 
 #ifdef RANDOM_SEED_FIXED
         std::uniform_int_distribution<T> dist(std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
@@ -9,18 +9,63 @@
 #include "secret_sharing.hpp"
 
 #include "../utils/logger.hpp"
+#include "../utils/metrics.hpp"
 #include "../utils/timer.hpp"
 #include "../utils/utils.hpp"
 #include "random_number_generator.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 namespace tools {
+namespace {
+
+utils::Counter &RoundCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_comm_rounds_total", "Number of communication rounds (SendRecv calls and Send/Recv pairs).");
+    return counter;
+}
+
+utils::Counter &BytesSentCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("fss_comm_bytes_sent_total", "Number of bytes sent to the other party.");
+    return counter;
+}
+
+utils::Histogram &RoundLatency() {
+    static utils::Histogram &histogram = utils::MetricsRegistry::GetInstance().GetHistogram("fss_comm_round_seconds", "Latency of a communication round (from the send to the receive of a split round).");
+    return histogram;
+}
+
+/**
+ * @brief Record a communication round of a party to the metrics registry.
+ *
+ * The round latency is observed and the bytes sent during the round are added when leaving the scope.
+ */
+class RoundRecorder {
+public:
+    RoundRecorder(const secret_sharing::Party &party)
+        : party_(party), bytes_sent_(party.GetTotalBytesSent()), latency_(RoundLatency()) {
+    }
+
+    ~RoundRecorder() {
+        RoundCounter().Increment();
+        BytesSentCounter().Increment(this->party_.GetTotalBytesSent() - this->bytes_sent_);
+    }
+
+private:
+    const secret_sharing::Party &party_;
+    const uint64_t               bytes_sent_;
+    utils::HistogramTimer        latency_;
+};
+
+}    // namespace
+
 namespace secret_sharing {
 
 Party::Party(const comm::CommInfo &comm_info)
-    : id_(comm_info.party_id), p0_(comm::Server(comm_info.port_number, false)), p1_(comm::Client(comm_info.host_address, comm_info.port_number, false)), is_started_(false) {
+    : id_(comm_info.party_id), p0_(comm::Server(comm_info.port_number, false)), p1_(comm::Client(comm_info.host_address, comm_info.port_number, false)), is_started_(false), replay_bytes_sent_(0),
+      split_first_round_(0), split_sent_num_(0), split_received_num_(0) {
 }
 
 void Party::StartCommunication(const bool debug) {
@@ -33,6 +78,12 @@ void Party::StartCommunication(const bool debug) {
         return;
     }
 
+    // The replayed rounds do not use the sockets
+    if (this->transcript_.GetMode() == TranscriptMode::kReplay) {
+        utils::Logger::DebugLog(LOCATION, "Replaying the transcript of party " + std::to_string(this->id_) + " (no connection).", debug);
+        return;
+    }
+
     // Start communication based on party ID
     if (id_ == 0) {
         this->p0_.Setup();
@@ -68,6 +119,15 @@ uint32_t Party::GetId() const {
 }
 
 void Party::SendRecv(uint32_t &x_0, uint32_t &x_1) {
+    RoundRecorder recorder(*this);
+    uint32_t     &received = (this->id_ == 0) ? x_1 : x_0;
+    if (this->transcript_.GetMode() == TranscriptMode::kReplay) {
+        uint64_t num;
+        const uint32_t *values = this->ReplayRound(1, sizeof(uint32_t), num);
+        this->CheckReplayedNum(num, 1);
+        received = *values;
+        return;
+    }
     if (id_ == 0) {
         this->p0_.SendValue(x_0);
         this->p0_.RecvValue(x_1);
@@ -75,9 +135,21 @@ void Party::SendRecv(uint32_t &x_0, uint32_t &x_1) {
         this->p1_.RecvValue(x_0);
         this->p1_.SendValue(x_1);
     }
+    if (this->transcript_.GetMode() == TranscriptMode::kRecord) {
+        this->transcript_.Record(1, &received, 1);
+    }
 }
 
 void Party::SendRecv(std::vector<uint32_t> &x_vec_0, std::vector<uint32_t> &x_vec_1) {
+    RoundRecorder          recorder(*this);
+    std::vector<uint32_t> &sent     = (this->id_ == 0) ? x_vec_0 : x_vec_1;
+    std::vector<uint32_t> &received = (this->id_ == 0) ? x_vec_1 : x_vec_0;
+    if (this->transcript_.GetMode() == TranscriptMode::kReplay) {
+        uint64_t        num;
+        const uint32_t *values = this->ReplayRound(sent.size(), sizeof(std::size_t) + sent.size() * sizeof(uint32_t), num);
+        received.assign(values, values + num);
+        return;
+    }
     if (this->id_ == 0) {
         this->p0_.SendVector(x_vec_0);
         this->p0_.RecvVector(x_vec_1);
@@ -85,9 +157,43 @@ void Party::SendRecv(std::vector<uint32_t> &x_vec_0, std::vector<uint32_t> &x_ve
         this->p1_.RecvVector(x_vec_0);
         this->p1_.SendVector(x_vec_1);
     }
+    if (this->transcript_.GetMode() == TranscriptMode::kRecord) {
+        this->transcript_.Record(sent.size(), received.data(), received.size());
+    }
 }
 
 void Party::SendRecv(std::array<uint32_t, 2> &x_arr_0, std::array<uint32_t, 2> &x_arr_1) {
+    RoundRecorder            recorder(*this);
+    std::array<uint32_t, 2> &received = (this->id_ == 0) ? x_arr_1 : x_arr_0;
+    if (this->transcript_.GetMode() == TranscriptMode::kReplay) {
+        uint64_t        num;
+        const uint32_t *values = this->ReplayRound(2, 2 * sizeof(uint32_t), num);
+        this->CheckReplayedNum(num, 2);
+        std::copy(values, values + 2, received.begin());
+        return;
+    }
+    if (this->id_ == 0) {
+        this->p0_.SendArray(x_arr_0);
+        this->p0_.RecvArray(x_arr_1);
+    } else {
+        this->p1_.RecvArray(x_arr_0);
+        this->p1_.SendArray(x_arr_1);
+    }
+    if (this->transcript_.GetMode() == TranscriptMode::kRecord) {
+        this->transcript_.Record(2, received.data(), 2);
+    }
+}
+
+void Party::SendRecv(std::array<uint32_t, 3> &x_arr_0, std::array<uint32_t, 3> &x_arr_1) {
+    RoundRecorder            recorder(*this);
+    std::array<uint32_t, 3> &received = (this->id_ == 0) ? x_arr_1 : x_arr_0;
+    if (this->transcript_.GetMode() == TranscriptMode::kReplay) {
+        uint64_t        num;
+        const uint32_t *values = this->ReplayRound(3, 3 * sizeof(uint32_t), num);
+        this->CheckReplayedNum(num, 3);
+        std::copy(values, values + 3, received.begin());
+        return;
+    }
     if (this->id_ == 0) {
         this->p0_.SendArray(x_arr_0);
         this->p0_.RecvArray(x_arr_1);
@@ -95,9 +201,21 @@ void Party::SendRecv(std::array<uint32_t, 2> &x_arr_0, std::array<uint32_t, 2> &
         this->p1_.RecvArray(x_arr_0);
         this->p1_.SendArray(x_arr_1);
     }
+    if (this->transcript_.GetMode() == TranscriptMode::kRecord) {
+        this->transcript_.Record(3, received.data(), 3);
+    }
 }
 
 void Party::SendRecv(std::array<uint32_t, 4> &x_arr_0, std::array<uint32_t, 4> &x_arr_1) {
+    RoundRecorder            recorder(*this);
+    std::array<uint32_t, 4> &received = (this->id_ == 0) ? x_arr_1 : x_arr_0;
+    if (this->transcript_.GetMode() == TranscriptMode::kReplay) {
+        uint64_t        num;
+        const uint32_t *values = this->ReplayRound(4, 4 * sizeof(uint32_t), num);
+        this->CheckReplayedNum(num, 4);
+        std::copy(values, values + 4, received.begin());
+        return;
+    }
     if (this->id_ == 0) {
         this->p0_.SendArray(x_arr_0);
         this->p0_.RecvArray(x_arr_1);
@@ -105,24 +223,53 @@ void Party::SendRecv(std::array<uint32_t, 4> &x_arr_0, std::array<uint32_t, 4> &
         this->p1_.RecvArray(x_arr_0);
         this->p1_.SendArray(x_arr_1);
     }
+    if (this->transcript_.GetMode() == TranscriptMode::kRecord) {
+        this->transcript_.Record(4, received.data(), 4);
+    }
 }
 
-uint32_t Party::GetTotalBytesSent() const {
+void Party::Send(std::vector<uint32_t> &x_vec) {
+    if (this->transcript_.GetMode() != TranscriptMode::kNone) {
+        utils::Logger::FatalLog(LOCATION, "Split rounds are not supported with a transcript");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t round        = this->StartSplitHalf(true);
+    uint64_t bytes_before = this->GetTotalBytesSent();
     if (this->id_ == 0) {
-        return this->p0_.GetTotalBytesSent();
+        this->p0_.SendVector(x_vec);
     } else {
-        return this->p1_.GetTotalBytesSent();
+        this->p1_.SendVector(x_vec);
     }
+    BytesSentCounter().Increment(this->GetTotalBytesSent() - bytes_before);
+    this->FinishSplitHalf(round);
 }
 
-uint32_t Party::OutputTotalBytesSent(const std::string &message) const {
+void Party::Recv(std::vector<uint32_t> &x_vec) {
+    if (this->transcript_.GetMode() != TranscriptMode::kNone) {
+        utils::Logger::FatalLog(LOCATION, "Split rounds are not supported with a transcript");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t round = this->StartSplitHalf(false);
     if (this->id_ == 0) {
-        utils::Logger::InfoLog(LOCATION, "Total bytes sent" + message + "," + std::to_string(this->p0_.GetTotalBytesSent()) + ",bytes");
-        return this->p0_.GetTotalBytesSent();
+        this->p0_.RecvVector(x_vec);
     } else {
-        utils::Logger::InfoLog(LOCATION, "Total bytes sent" + message + "," + std::to_string(this->p1_.GetTotalBytesSent()) + ",bytes");
-        return this->p1_.GetTotalBytesSent();
+        this->p1_.RecvVector(x_vec);
     }
+    this->FinishSplitHalf(round);
+}
+
+uint64_t Party::GetTotalBytesSent() const {
+    if (this->id_ == 0) {
+        return this->p0_.GetTotalBytesSent() + this->replay_bytes_sent_;
+    } else {
+        return this->p1_.GetTotalBytesSent() + this->replay_bytes_sent_;
+    }
+}
+
+uint64_t Party::OutputTotalBytesSent(const std::string &message) const {
+    uint64_t total_bytes = this->GetTotalBytesSent();
+    utils::Logger::InfoLog(LOCATION, "Total bytes sent" + message + "," + std::to_string(total_bytes) + ",bytes");
+    return total_bytes;
 }
 
 void Party::ClearTotalBytesSent() {
@@ -131,6 +278,64 @@ void Party::ClearTotalBytesSent() {
     } else {
         this->p1_.ClearTotalBytesSent();
     }
+    this->replay_bytes_sent_ = 0;
+}
+
+bool Party::StartRecording(const std::string &file_path) {
+    if (!this->is_started_) {
+        utils::Logger::ErrorLog(LOCATION, "Communication has not started.");
+        return false;
+    }
+    return this->transcript_.StartRecording(file_path, this->id_);
+}
+
+bool Party::StartReplay(const std::string &file_path) {
+    return this->transcript_.StartReplay(file_path, this->id_);
+}
+
+void Party::StopTranscript() {
+    this->transcript_.Stop();
+}
+
+TranscriptMode Party::GetTranscriptMode() const {
+    return this->transcript_.GetMode();
+}
+
+const uint32_t *Party::ReplayRound(const uint64_t sent_num, const uint64_t sent_bytes, uint64_t &received_num) {
+    const uint32_t *received = this->transcript_.Replay(sent_num, received_num);
+    this->replay_bytes_sent_ += sent_bytes;
+    return received;
+}
+
+uint64_t Party::StartSplitHalf(const bool is_send) {
+    std::lock_guard<std::mutex> lock(this->split_mutex_);
+    uint64_t                    round = is_send ? this->split_sent_num_++ : this->split_received_num_++;
+    // The round starts with the first of its halves (the other party may send before this one does)
+    while (this->split_first_round_ + this->split_rounds_.size() <= round) {
+        this->split_rounds_.push_back({std::chrono::steady_clock::now(), 0});
+    }
+    return round;
+}
+
+void Party::FinishSplitHalf(const uint64_t round) {
+    std::lock_guard<std::mutex> lock(this->split_mutex_);
+    SplitRound                 &split = this->split_rounds_[round - this->split_first_round_];
+    if (++split.finished_halves == 2) {
+        RoundCounter().Increment();
+        RoundLatency().Observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - split.start).count());
+    }
+    // Both halves finish in order, so the finished rounds are at the front
+    while (!this->split_rounds_.empty() && this->split_rounds_.front().finished_halves == 2) {
+        this->split_rounds_.pop_front();
+        this->split_first_round_++;
+    }
+}
+
+void Party::CheckReplayedNum(const uint64_t received_num, const uint64_t expected_num) const {
+    if (received_num != expected_num) {
+        utils::Logger::FatalLog(LOCATION, "The replayed round has " + std::to_string(received_num) + " values instead of " + std::to_string(expected_num) + " (corrupt or mismatched transcript)");
+        exit(EXIT_FAILURE);
+    }
 }
 
 BeaverTriplet::BeaverTriplet()
@@ -149,6 +354,23 @@ std::string BeaverTriplet::ToStr(const bool sup) const {
     }
 }
 
+CorrelatedTriplet::CorrelatedTriplet()
+    : a(0UL) {
+}
+
+CorrelatedTriplet::CorrelatedTriplet(uint32_t val_a, std::vector<uint32_t> val_b, std::vector<uint32_t> val_c)
+    : a(val_a), b(std::move(val_b)), c(std::move(val_c)) {
+}
+
+uint32_t CorrelatedTriplet::GetFanOut() const {
+    return this->b.size();
+}
+
+std::string CorrelatedTriplet::ToStr(const bool sup) const {
+    std::string str = "(" + std::to_string(this->a) + ", " + utils::VectorToStr(this->b) + ", " + utils::VectorToStr(this->c) + ")";
+    return sup ? "(a, b, c) = " + str : str;
+}
+
 AdditiveSecretSharing::AdditiveSecretSharing()
     : bitsize_(32) {
 }
@@ -201,6 +423,14 @@ void AdditiveSecretSharing::Reconst(Party &party, std::array<uint32_t, 2> &x_arr
     }
 }
 
+void AdditiveSecretSharing::Reconst(Party &party, std::array<uint32_t, 3> &x_arr_0, std::array<uint32_t, 3> &x_arr_1, std::array<uint32_t, 3> &output) const {
+    size_t length = output.size();
+    party.SendRecv(x_arr_0, x_arr_1);
+    for (size_t i = 0; i < length; i++) {
+        output[i] = utils::Mod(x_arr_0[i] + x_arr_1[i], this->bitsize_);
+    }
+}
+
 void AdditiveSecretSharing::Reconst(Party &party, std::array<uint32_t, 4> &x_arr_0, std::array<uint32_t, 4> &x_arr_1, std::array<uint32_t, 4> &output) const {
     size_t length = output.size();
     party.SendRecv(x_arr_0, x_arr_1);
@@ -232,6 +462,40 @@ std::pair<bts_t, bts_t> AdditiveSecretSharing::ShareBeaverTriples(const bts_t &b
     return std::make_pair(bt_vec_0, bt_vec_1);
 }
 
+void AdditiveSecretSharing::GenerateCorrelatedTriples(const uint32_t ct_num, const uint32_t fan_out, cts_t &ct_vec) const {
+    this->GenerateCorrelatedTriples(std::vector<uint32_t>(ct_num, fan_out), ct_vec);
+}
+
+void AdditiveSecretSharing::GenerateCorrelatedTriples(const std::vector<uint32_t> &fan_outs, cts_t &ct_vec) const {
+    ct_vec.resize(fan_outs.size());
+    for (size_t i = 0; i < fan_outs.size(); i++) {
+        uint32_t              val_a = utils::Mod(rng::SecureRng::Rand64(), this->bitsize_);
+        std::vector<uint32_t> val_b(fan_outs[i]), val_c(fan_outs[i]);
+        for (uint32_t j = 0; j < fan_outs[i]; j++) {
+            val_b[j] = utils::Mod(rng::SecureRng::Rand64(), this->bitsize_);
+            val_c[j] = utils::Mod(val_a * val_b[j], this->bitsize_);
+        }
+        ct_vec[i] = CorrelatedTriplet(val_a, std::move(val_b), std::move(val_c));
+    }
+}
+
+std::pair<cts_t, cts_t> AdditiveSecretSharing::ShareCorrelatedTriples(const cts_t &ct_vec) const {
+    cts_t ct_vec_0(ct_vec.size());
+    cts_t ct_vec_1(ct_vec.size());
+    for (size_t i = 0; i < ct_vec.size(); i++) {
+        share_t a_sh  = this->Share(ct_vec[i].a);
+        ct_vec_0[i].a = a_sh.first;
+        ct_vec_1[i].a = a_sh.second;
+        shares_t b_sh = this->Share(ct_vec[i].b);
+        shares_t c_sh = this->Share(ct_vec[i].c);
+        ct_vec_0[i].b = std::move(b_sh.first);
+        ct_vec_1[i].b = std::move(b_sh.second);
+        ct_vec_0[i].c = std::move(c_sh.first);
+        ct_vec_1[i].c = std::move(c_sh.second);
+    }
+    return std::make_pair(ct_vec_0, ct_vec_1);
+}
+
 uint32_t AdditiveSecretSharing::Mult(Party &party, const BeaverTriplet &bt, const uint32_t x, const uint32_t y) const {
     uint32_t                z;
     std::array<uint32_t, 2> de{0, 0}, de_0{0, 0}, de_1{0, 0};
@@ -282,6 +546,75 @@ std::array<uint32_t, 2> AdditiveSecretSharing::Mult2(Party &party, const BeaverT
     return z;
 }
 
+std::array<uint32_t, 2> AdditiveSecretSharing::Mult2(Party &party, const CorrelatedTriplet &ct, const uint32_t x, const uint32_t y1, const uint32_t y2) const {
+    if (ct.GetFanOut() != 2) {
+        utils::Logger::FatalLog(LOCATION, "Mult2 needs a correlated triple of 2 values (" + std::to_string(ct.GetFanOut()) + ")");
+        exit(EXIT_FAILURE);
+    }
+    std::array<uint32_t, 2> z;
+    std::array<uint32_t, 3> de{0, 0, 0}, de_0{0, 0, 0}, de_1{0, 0, 0};
+    // Calculate the differences de_0 and de_1 based on party_id (x - a is opened once).
+    if (party.GetId() == 0) {
+        de_0[0] = utils::Mod(x - ct.a, this->bitsize_);
+        de_0[1] = utils::Mod(y1 - ct.b[0], this->bitsize_);
+        de_0[2] = utils::Mod(y2 - ct.b[1], this->bitsize_);
+    } else {
+        de_1[0] = utils::Mod(x - ct.a, this->bitsize_);
+        de_1[1] = utils::Mod(y1 - ct.b[0], this->bitsize_);
+        de_1[2] = utils::Mod(y2 - ct.b[1], this->bitsize_);
+    }
+    // Calculate the final differences de based on de_0 and de_1.
+    Reconst(party, de_0, de_1, de);
+    // Calculate the secure multiplication result based on party_id.
+    if (party.GetId() == 0) {
+        z[0] = utils::Mod((de[1] * ct.a) + (de[0] * ct.b[0]) + ct.c[0] + (de[0] * de[1]), this->bitsize_);
+        z[1] = utils::Mod((de[2] * ct.a) + (de[0] * ct.b[1]) + ct.c[1] + (de[0] * de[2]), this->bitsize_);
+    } else {
+        z[0] = utils::Mod((de[1] * ct.a) + (de[0] * ct.b[0]) + ct.c[0], this->bitsize_);
+        z[1] = utils::Mod((de[2] * ct.a) + (de[0] * ct.b[1]) + ct.c[1], this->bitsize_);
+    }
+    return z;
+}
+
+void AdditiveSecretSharing::MultMany(Party &party, const CorrelatedTriplet &ct, const uint32_t x, const std::vector<uint32_t> &y_vec, std::vector<uint32_t> &z_vec) const {
+    this->MultMany(party, cts_t{ct}, std::vector<uint32_t>{x}, y_vec, z_vec);
+}
+
+void AdditiveSecretSharing::MultMany(Party &party, const cts_t &ct_vec, const std::vector<uint32_t> &x_vec, const std::vector<uint32_t> &y_vec, std::vector<uint32_t> &z_vec) const {
+    size_t num = ct_vec.size(), total = 0;
+    for (size_t i = 0; i < num; i++) {
+        total += ct_vec[i].GetFanOut();
+    }
+    if (x_vec.size() != num || y_vec.size() != total) {
+        utils::Logger::FatalLog(LOCATION, "The operands do not match the correlated triples (" + std::to_string(x_vec.size()) + " x " + std::to_string(y_vec.size()) + " for " + std::to_string(num) + " triples of " + std::to_string(total) + " values)");
+        exit(EXIT_FAILURE);
+    }
+
+    // Calculate the differences d = x - a (once per operand) and e_j = y_j - b_j
+    std::vector<uint32_t>  de_vec(num + total), de_vec_0(num + total), de_vec_1(num + total);
+    std::vector<uint32_t> &de_own = (party.GetId() == 0) ? de_vec_0 : de_vec_1;
+    for (size_t i = 0, offset = 0; i < num; offset += ct_vec[i].GetFanOut(), i++) {
+        de_own[i] = utils::Mod(x_vec[i] - ct_vec[i].a, this->bitsize_);
+        for (uint32_t j = 0; j < ct_vec[i].GetFanOut(); j++) {
+            de_own[num + offset + j] = utils::Mod(y_vec[offset + j] - ct_vec[i].b[j], this->bitsize_);
+        }
+    }
+    // Calculate the final differences de based on de_0 and de_1.
+    Reconst(party, de_vec_0, de_vec_1, de_vec);
+    // z_j = e_j * a + d * b_j + c_j (+ d * e_j for party 0)
+    z_vec.resize(total);
+    for (size_t i = 0, offset = 0; i < num; offset += ct_vec[i].GetFanOut(), i++) {
+        uint32_t d = de_vec[i];
+        for (uint32_t j = 0; j < ct_vec[i].GetFanOut(); j++) {
+            uint32_t e        = de_vec[num + offset + j];
+            z_vec[offset + j] = utils::Mod((e * ct_vec[i].a) + (d * ct_vec[i].b[j]) + ct_vec[i].c[j], this->bitsize_);
+            if (party.GetId() == 0) {
+                z_vec[offset + j] = utils::Mod(z_vec[offset + j] + (d * e), this->bitsize_);
+            }
+        }
+    }
+}
+
 void AdditiveSecretSharing::Mult(Party &party, const bts_t &bt_vec, const std::vector<uint32_t> &x_vec, const std::vector<uint32_t> &y_vec, std::vector<uint32_t> &z_vec) const {
     size_t                num = z_vec.size();
     std::vector<uint32_t> de_vec(num * 2), de_vec_0(num * 2), de_vec_1(num * 2);
@@ -488,8 +821,80 @@ void ShareHandler::ExportBTShare(const std::string &file_path_p0, const std::str
     this->WriteBeaverTriplesToFile(file_path_p1, bt_vec_sh.second);
 }
 
-void ShareHandler::LoadBTShare(const std::string &file_path, bts_t &bt_vec_sh) {
-    this->ReadBeaverTriplesFromFile(file_path, bt_vec_sh);
+bool ShareHandler::LoadBTShare(const std::string &file_path, bts_t &bt_vec_sh) {
+    return this->ReadBeaverTriplesFromFile(file_path, bt_vec_sh);
+}
+
+void ShareHandler::ExportCT(const std::string &file_path, cts_t &ct_vec) {
+    std::ofstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        exit(EXIT_FAILURE);
+    }
+    this->WriteCorrelatedTriples(file, ct_vec);
+    file.close();
+    utils::Logger::DebugLog(LOCATION, "Correlated triples have been written to the file (" + file_path + ")", this->debug_);
+}
+
+void ShareHandler::ExportCTShare(const std::string &file_path_p0, const std::string &file_path_p1, std::pair<cts_t, cts_t> &ct_vec_sh) {
+    this->ExportCT(file_path_p0, ct_vec_sh.first);
+    this->ExportCT(file_path_p1, ct_vec_sh.second);
+}
+
+void ShareHandler::LoadCTShare(const std::string &file_path, cts_t &ct_vec_sh) {
+    // Missing or broken triples are fatal (running with part of them would open differences against garbage)
+    std::ifstream file;
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        utils::Logger::FatalLog(LOCATION, "Failed to open the correlated triples (" + file_path + ")");
+        exit(EXIT_FAILURE);
+    }
+    if (!this->ReadCorrelatedTriples(file, ct_vec_sh)) {
+        utils::Logger::FatalLog(LOCATION, "Failed to read the correlated triples (" + file_path + ")");
+        exit(EXIT_FAILURE);
+    }
+    file.close();
+}
+
+void ShareHandler::WriteCorrelatedTriples(std::ostream &stream, const cts_t &ct_vec) {
+    stream << ct_vec.size() << "\n";
+    for (const auto &ct : ct_vec) {
+        stream << ct.a;
+        for (const auto b : ct.b) {
+            stream << "," << b;
+        }
+        for (const auto c : ct.c) {
+            stream << "," << c;
+        }
+        stream << "\n";
+    }
+}
+
+bool ShareHandler::ReadCorrelatedTriples(std::istream &stream, cts_t &ct_vec) {
+    std::string line;
+    if (!std::getline(stream, line) || line.empty()) {
+        return false;
+    }
+    uint64_t size = 0;
+    try {
+        size = std::stoull(line);
+    } catch (const std::exception &) {
+        return false;
+    }
+    cts_t cts;
+    cts.reserve(size);
+    for (uint64_t i = 0; i < size; i++) {
+        std::vector<uint32_t> vec;
+        if (!std::getline(stream, line)) {
+            return false;
+        }
+        this->io_.SplitStringToUint32(line, vec);
+        if (vec.empty() || vec.size() % 2 == 0) {
+            return false;
+        }
+        uint32_t fan_out = (vec.size() - 1) / 2;
+        cts.emplace_back(vec[0], std::vector<uint32_t>(vec.begin() + 1, vec.begin() + 1 + fan_out), std::vector<uint32_t>(vec.begin() + 1 + fan_out, vec.end()));
+    }
+    ct_vec = std::move(cts);
+    return true;
 }
 
 void ShareHandler::WriteBeaverTriplesToFile(const std::string &file_path, bts_t &bt_vec) {
@@ -508,26 +913,31 @@ void ShareHandler::WriteBeaverTriplesToFile(const std::string &file_path, bts_t
     utils::Logger::DebugLog(LOCATION, "Beaver Triple have been written to the file (" + file_path + ")", this->debug_);
 }
 
-void ShareHandler::ReadBeaverTriplesFromFile(const std::string &file_path, bts_t &bt_vec) {
+bool ShareHandler::ReadBeaverTriplesFromFile(const std::string &file_path, bts_t &bt_vec) {
     // Open the file
     std::ifstream file;
-    if (this->io_.OpenFile(file, file_path, LOCATION)) {
-        // Read the number of elements from the first line of the file
-        uint32_t size = this->io_.ReadNumCountFromFile(file, LOCATION);
-        bts_t    bts;
-        bts.reserve(size);
-        for (uint32_t i = 0; i < size; i++) {
-            std::string line;
-            if (std::getline(file, line)) {
-                std::vector<uint32_t> vec;
-                io_.SplitStringToUint32(line, vec);
+    if (!this->io_.OpenFile(file, file_path, LOCATION)) {
+        return false;
+    }
+    // Read the number of elements from the first line of the file
+    uint32_t size = this->io_.ReadNumCountFromFile(file, LOCATION);
+    bts_t    bts;
+    bts.reserve(size);
+    for (uint32_t i = 0; i < size; i++) {
+        std::string line;
+        if (std::getline(file, line)) {
+            std::vector<uint32_t> vec;
+            io_.SplitStringToUint32(line, vec);
+            if (vec.size() == 3) {
                 bts.push_back(BeaverTriplet(vec[0], vec[1], vec[2]));
             }
         }
-        // Close the file
-        file.close();
-        bt_vec = std::move(bts);
     }
+    // Close the file
+    file.close();
+    bool complete = (bts.size() == size);
+    bt_vec        = std::move(bts);
+    return complete;
 }
 
 }    // namespace secret_sharing
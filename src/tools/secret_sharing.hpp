@@ -10,7 +10,11 @@
 #define SECRET_SHARING_H_
 
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,6 +23,7 @@
 #include "../comm/comm.hpp"
 #include "../comm/server.hpp"
 #include "../utils/file_io.hpp"
+#include "transcript.hpp"
 
 namespace tools {
 namespace secret_sharing {
@@ -94,6 +99,17 @@ public:
      */
     void SendRecv(std::array<uint32_t, 2> &x_arr_0, std::array<uint32_t, 2> &x_arr_1);
 
+    /**
+     * @brief Sends and receives arrays of data between the two parties.
+     *
+     * This method facilitates the exchange of arrays of unsigned 32-bit integers between the two parties
+     * in the communication protocol.
+     *
+     * @param x_arr_0 A reference to a array of unsigned 32-bit integers to be sent/received.
+     * @param x_arr_1 A reference to a array of unsigned 32-bit integers where the received values will be stored.
+     */
+    void SendRecv(std::array<uint32_t, 3> &x_arr_0, std::array<uint32_t, 3> &x_arr_1);
+
     /**
      * @brief Sends and receives arrays of data between the two parties.
      *
@@ -105,9 +121,28 @@ public:
      */
     void SendRecv(std::array<uint32_t, 4> &x_arr_0, std::array<uint32_t, 4> &x_arr_1);
 
-    uint32_t GetTotalBytesSent() const;
+    /**
+     * @brief Send a vector to the other party (the first half of a round).
+     *
+     * Send and Recv split a round so that several rounds can be in flight: one thread may send while another
+     * receives, and the k-th message sent by one party is the k-th message received by the other. Both parties
+     * must send before they wait for the message of the same round. Not available while recording or replaying a transcript.
+     * The k-th Send and the k-th Recv count as one round in the metrics (as one SendRecv), with the latency from the start
+     * of the first of them to the end of the last one.
+     *
+     * @param x_vec The values to be sent.
+     */
+    void Send(std::vector<uint32_t> &x_vec);
+
+    /**
+     * @brief Receive the next vector sent by the other party (the second half of a round).
+     * @param x_vec The values received.
+     */
+    void Recv(std::vector<uint32_t> &x_vec);
 
-    uint32_t OutputTotalBytesSent(const std::string &message) const;
+    uint64_t GetTotalBytesSent() const;
+
+    uint64_t OutputTotalBytesSent(const std::string &message) const;
 
     /**
      * @brief Clears the total number of bytes sent by the party.
@@ -116,11 +151,89 @@ public:
      */
     void ClearTotalBytesSent();
 
+    /**
+     * @brief Record the messages received from the other party in the following rounds.
+     *
+     * The communication must be started. The transcript is closed by StopTranscript or the destructor.
+     *
+     * @param file_path The path of the transcript file.
+     * @return `true` if the transcript file is created.
+     */
+    bool StartRecording(const std::string &file_path);
+
+    /**
+     * @brief Replay a transcript recorded by this party instead of communicating.
+     *
+     * In the following rounds, SendRecv returns the recorded messages of the other party without any socket
+     * (StartCommunication does not connect), so a single party can run a session alone, e.g. under a profiler.
+     * The bytes sent are counted as if they were sent.
+     *
+     * @param file_path The path of the transcript file.
+     * @return `true` if the transcript file is loaded.
+     */
+    bool StartReplay(const std::string &file_path);
+
+    /**
+     * @brief Stop recording or replaying.
+     */
+    void StopTranscript();
+
+    /**
+     * @brief Retrieves the transcript mode of the party.
+     * @return The transcript mode.
+     */
+    TranscriptMode GetTranscriptMode() const;
+
 private:
-    const uint32_t id_;         /**< ID of the party. */
-    comm::Server   p0_;         /**< Server communication instance. */
-    comm::Client   p1_;         /**< Client communication instance. */
-    bool           is_started_; /**< Flag indicating whether the communication has started. */
+    const uint32_t id_;                /**< ID of the party. */
+    comm::Server   p0_;                /**< Server communication instance. */
+    comm::Client   p1_;                /**< Client communication instance. */
+    bool           is_started_;        /**< Flag indicating whether the communication has started. */
+    Transcript     transcript_;        /**< The recorded or replayed messages. */
+    uint64_t       replay_bytes_sent_; /**< The bytes that would have been sent in the replayed rounds. */
+
+    /**
+     * @struct SplitRound
+     * @brief A split round in flight (see Send and Recv).
+     */
+    struct SplitRound {
+        std::chrono::steady_clock::time_point start;           /**< The start of the first half. */
+        uint32_t                              finished_halves; /**< The number of halves finished. */
+    };
+    std::mutex             split_mutex_;        /**< Guards the split rounds (Send and Recv may run on different threads). */
+    std::deque<SplitRound> split_rounds_;       /**< The split rounds in flight, from split_first_round_. */
+    uint64_t               split_first_round_;  /**< The index of the first split round in flight. */
+    uint64_t               split_sent_num_;     /**< The number of Send calls. */
+    uint64_t               split_received_num_; /**< The number of Recv calls. */
+
+    /**
+     * @brief Get the message of the other party of a replayed round.
+     * @param sent_num The number of values sent in the round.
+     * @param sent_bytes The number of bytes sent in the round.
+     * @param received_num The number of values received in the round.
+     * @return The values received.
+     */
+    const uint32_t *ReplayRound(const uint64_t sent_num, const uint64_t sent_bytes, uint64_t &received_num);
+
+    /**
+     * @brief Check the number of values of a replayed round received into a fixed-size message (fatal if it differs).
+     * @param received_num The number of values received in the round.
+     * @param expected_num The size of the message.
+     */
+    void CheckReplayedNum(const uint64_t received_num, const uint64_t expected_num) const;
+
+    /**
+     * @brief Start a half of a split round.
+     * @param is_send True for Send, false for Recv.
+     * @return The index of the round.
+     */
+    uint64_t StartSplitHalf(const bool is_send);
+
+    /**
+     * @brief Finish a half of a split round (the round is recorded to the metrics when both halves are finished).
+     * @param round The index of the round.
+     */
+    void FinishSplitHalf(const uint64_t round);
 };
 
 struct BeaverTriplet {
@@ -163,6 +276,47 @@ struct BeaverTriplet {
 
 using bts_t = std::vector<BeaverTriplet>;
 
+/**
+ * @struct CorrelatedTriplet
+ * @brief A one-to-many Beaver triple (a, b_1 ... b_m, c_1 ... c_m) with c_j = a * b_j.
+ *
+ * The products of one shared operand x with m values y_j open x - a once instead of m times,
+ * so MultMany sends 1 + m values and the triple takes 1 + 2m values instead of 2m and 3m.
+ */
+struct CorrelatedTriplet {
+    uint32_t              a; /**< The shared operand mask. */
+    std::vector<uint32_t> b; /**< The masks of the m values. */
+    std::vector<uint32_t> c; /**< The products a * b_j. */
+
+    /**
+     * @brief Constructs an empty CorrelatedTriplet (a = 0, m = 0).
+     */
+    CorrelatedTriplet();
+
+    /**
+     * @brief Constructs a CorrelatedTriplet object with specified values.
+     * @param val_a The value for the 'a' component.
+     * @param val_b The values for the 'b' components.
+     * @param val_c The values for the 'c' components (same size as val_b).
+     */
+    CorrelatedTriplet(uint32_t val_a, std::vector<uint32_t> val_b, std::vector<uint32_t> val_c);
+
+    /**
+     * @brief Retrieves the number of values multiplied by the shared operand (m).
+     * @return The number of values.
+     */
+    uint32_t GetFanOut() const;
+
+    /**
+     * @brief Generates a string representation of the CorrelatedTriplet object.
+     * @param sup Indicates whether to generate a supplementary format string "(a, b, c) = (...)".
+     * @return A string representation of the CorrelatedTriplet object.
+     */
+    std::string ToStr(const bool sup = true) const;
+};
+
+using cts_t = std::vector<CorrelatedTriplet>;
+
 class AdditiveSecretSharing {
 
 public:
@@ -239,6 +393,18 @@ public:
      */
     void Reconst(Party &party, std::array<uint32_t, 2> &x_arr_0, std::array<uint32_t, 2> &x_arr_1, std::array<uint32_t, 2> &output) const;
 
+    /**
+     * @brief Reconstructs an array of secret values from their shares.
+     *
+     * Reconstructs the array of secret values from their share arrays 'x_arr_0' and 'x_arr_1' using secret sharing techniques.
+     *
+     * @param party The Party object representing the party that will perform the reconstruction.
+     * @param x_arr_0 The first share array of the secret values.
+     * @param x_arr_1 The second share array of the secret values.
+     * @param output The reconstructed array of secret values.
+     */
+    void Reconst(Party &party, std::array<uint32_t, 3> &x_arr_0, std::array<uint32_t, 3> &x_arr_1, std::array<uint32_t, 3> &output) const;
+
     /**
      * @brief Reconstructs an array of secret values from their shares.
      *
@@ -272,6 +438,28 @@ public:
      */
     std::pair<bts_t, bts_t> ShareBeaverTriples(const bts_t &bt_vec) const;
 
+    /**
+     * @brief Generates one-to-many correlated triples.
+     * @param ct_num The number of correlated triples to generate.
+     * @param fan_out The number of values multiplied by the shared operand (m).
+     * @param ct_vec The vector to store the generated correlated triples.
+     */
+    void GenerateCorrelatedTriples(const uint32_t ct_num, const uint32_t fan_out, cts_t &ct_vec) const;
+
+    /**
+     * @brief Generates one-to-many correlated triples of different fan-outs.
+     * @param fan_outs The fan-out of each correlated triple.
+     * @param ct_vec The vector to store the generated correlated triples.
+     */
+    void GenerateCorrelatedTriples(const std::vector<uint32_t> &fan_outs, cts_t &ct_vec) const;
+
+    /**
+     * @brief Shares one-to-many correlated triples using secret sharing.
+     * @param ct_vec The vector of correlated triples to be shared.
+     * @return A pair of share vectors representing the correlated triples.
+     */
+    std::pair<cts_t, cts_t> ShareCorrelatedTriples(const cts_t &ct_vec) const;
+
     /**
      * @brief Performs secure multiplication of two secret-shared values.
      *
@@ -303,6 +491,44 @@ public:
      */
     std::array<uint32_t, 2> Mult2(Party &party, const BeaverTriplet &bt1, const BeaverTriplet &bt2, const uint32_t x1, const uint32_t y1, const uint32_t x2, const uint32_t y2) const;
 
+    /**
+     * @brief Performs secure multiplication of one secret-shared value with two secret-shared values.
+     *
+     * Same result as Mult2 with x1 = x2 = x, but opens x - a once (3 values instead of 4).
+     *
+     * @param party The party object representing the current party.
+     * @param ct The correlated triple used for secure multiplication (m = 2).
+     * @param x The secret-shared value of the shared operand.
+     * @param y1 The secret-shared value of the first value.
+     * @param y2 The secret-shared value of the second value.
+     * @return An array representing the secret-shared result of the multiplication as [x * y1, x * y2].
+     */
+    std::array<uint32_t, 2> Mult2(Party &party, const CorrelatedTriplet &ct, const uint32_t x, const uint32_t y1, const uint32_t y2) const;
+
+    /**
+     * @brief Performs secure multiplication of one secret-shared value with many secret-shared values.
+     * @param party The party object representing the current party.
+     * @param ct The correlated triple used for secure multiplication (m = the size of y_vec).
+     * @param x The secret-shared value of the shared operand.
+     * @param y_vec The vector of secret-shared values.
+     * @param z_vec The vector to store the secret-shared results x * y_j.
+     */
+    void MultMany(Party &party, const CorrelatedTriplet &ct, const uint32_t x, const std::vector<uint32_t> &y_vec, std::vector<uint32_t> &z_vec) const;
+
+    /**
+     * @brief Performs secure multiplication of many shared operands with many secret-shared values in one round.
+     *
+     * The values of the i-th operand are the next GetFanOut() values of ct_vec[i] in y_vec, so triples of
+     * different fan-outs can be mixed.
+     *
+     * @param party The party object representing the current party.
+     * @param ct_vec The vector of correlated triples (one per shared operand).
+     * @param x_vec The vector of secret-shared values of the shared operands.
+     * @param y_vec The concatenated vectors of secret-shared values.
+     * @param z_vec The vector to store the secret-shared results (same layout as y_vec).
+     */
+    void MultMany(Party &party, const cts_t &ct_vec, const std::vector<uint32_t> &x_vec, const std::vector<uint32_t> &y_vec, std::vector<uint32_t> &z_vec) const;
+
     /**
      * @brief Performs secure multiplication of two vectors of secret-shared values.
      *
@@ -560,8 +786,49 @@ public:
      *
      * @param file_path The file path from which to load the Beaver triple shares.
      * @param bt_vec_sh Reference to the vector to store the loaded Beaver triple shares.
+     * @return `true` if the file was opened and every Beaver triple in it was read.
+     */
+    bool LoadBTShare(const std::string &file_path, bts_t &bt_vec_sh);
+
+    /**
+     * @brief Exports correlated triples to a file.
+     * @param file_path The file path to export the correlated triples.
+     * @param ct_vec Reference to the vector containing the correlated triples.
+     */
+    void ExportCT(const std::string &file_path, cts_t &ct_vec);
+
+    /**
+     * @brief Exports correlated triple shares to files.
+     * @param file_path_p0 The file path for the first correlated triple share vector.
+     * @param file_path_p1 The file path for the second correlated triple share vector.
+     * @param ct_vec_sh The pair containing the correlated triple share vectors to be exported.
+     */
+    void ExportCTShare(const std::string &file_path_p0, const std::string &file_path_p1, std::pair<cts_t, cts_t> &ct_vec_sh);
+
+    /**
+     * @brief Loads correlated triple shares from a file (exits if the file is missing or broken).
+     * @param file_path The file path from which to load the correlated triple shares.
+     * @param ct_vec_sh Reference to the vector to store the loaded correlated triple shares.
+     */
+    void LoadCTShare(const std::string &file_path, cts_t &ct_vec_sh);
+
+    /**
+     * @brief Writes correlated triples to a stream (the same format as the files).
+     *
+     * One line holds the number of triples, then one line per triple: a, b_1, ..., b_m, c_1, ..., c_m.
+     *
+     * @param stream The output stream.
+     * @param ct_vec Reference to the vector containing the correlated triples.
+     */
+    void WriteCorrelatedTriples(std::ostream &stream, const cts_t &ct_vec);
+
+    /**
+     * @brief Reads correlated triples from a stream written by WriteCorrelatedTriples.
+     * @param stream The input stream.
+     * @param ct_vec Reference to the vector to store the read correlated triples.
+     * @return `true` if all triples are read.
      */
-    void LoadBTShare(const std::string &file_path, bts_t &bt_vec_sh);
+    bool ReadCorrelatedTriples(std::istream &stream, cts_t &ct_vec);
 
 private:
     const bool    debug_; /**< Flag indicating whether to print debug messages. */
@@ -583,8 +850,9 @@ private:
      *
      * @param file_path The file path from which to read the Beaver triples.
      * @param bt_vec Reference to the vector to store the read Beaver triples.
+     * @return `true` if the file was opened and every Beaver triple in it was read.
      */
-    void ReadBeaverTriplesFromFile(const std::string &file_path, bts_t &bt_vec);
+    bool ReadBeaverTriplesFromFile(const std::string &file_path, bts_t &bt_vec);
 };
 
 }    // namespace secret_sharing
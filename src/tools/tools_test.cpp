@@ -13,7 +13,9 @@
 
 #include "../utils/file_io.hpp"
 #include "../utils/logger.hpp"
+#include "../utils/metrics.hpp"
 #include "../utils/utils.hpp"
+#include "protocol_session.hpp"
 #include "secret_sharing.hpp"
 
 namespace {
@@ -62,6 +64,47 @@ const std::string kTestMultBoolVecXPathP1 = kUtilsPath + "multvecxb_1";
 const std::string kTestMultBoolVecYPath   = kUtilsPath + "multvecyb";
 const std::string kTestMultBoolVecYPathP0 = kUtilsPath + "multvecyb_0";
 const std::string kTestMultBoolVecYPathP1 = kUtilsPath + "multvecyb_1";
+const std::string kTestCTPath             = kUtilsPath + "ct";
+const std::string kTestCTPathP0           = kUtilsPath + "ct_0";
+const std::string kTestCTPathP1           = kUtilsPath + "ct_1";
+const std::string kTestMultManyXPath      = kUtilsPath + "multmanyx";
+const std::string kTestMultManyXPathP0    = kUtilsPath + "multmanyx_0";
+const std::string kTestMultManyXPathP1    = kUtilsPath + "multmanyx_1";
+const std::string kTestMultManyYPath      = kUtilsPath + "multmanyy";
+const std::string kTestMultManyYPathP0    = kUtilsPath + "multmanyy_0";
+const std::string kTestMultManyYPathP1    = kUtilsPath + "multmanyy_1";
+const std::string kTestTranscriptPathP0   = kUtilsPath + "transcript_0";
+const std::string kTestTranscriptPathP1   = kUtilsPath + "transcript_1";
+
+// A session of a fixed number of rounds: each round opens the share (width copies) and party 0 takes the opened value + 1
+class CountSession : public tools::secret_sharing::ProtocolSession {
+public:
+    CountSession(const uint32_t party_id, const uint32_t share, const uint32_t rounds, const uint32_t width)
+        : party_id_(party_id), share_(share), rounds_(rounds), width_(width) {
+    }
+    bool IsFinished() const override {
+        return this->rounds_ == 0;
+    }
+    uint32_t GetOpeningSize() const override {
+        return this->rounds_ == 0 ? 0 : this->width_;
+    }
+    void WriteOpening(uint32_t *shares) const override {
+        std::fill(shares, shares + this->width_, this->share_);
+    }
+    void Resume(const uint32_t *opened) override {
+        this->share_ = (this->party_id_ == 0) ? opened[0] + 1 : 0;
+        this->rounds_--;
+    }
+    uint32_t GetShare() const {
+        return this->share_;
+    }
+
+private:
+    const uint32_t party_id_;
+    uint32_t       share_;
+    uint32_t       rounds_;
+    const uint32_t width_;
+};
 
 }    // namespace
 
@@ -77,9 +120,15 @@ bool Test_AdditiveSSOnline(secret_sharing::Party &party, const bool debug);
 bool Test_BooleanSSOnline(secret_sharing::Party &party, const bool debug);
 bool Test_AdditiveSSMultOnline(secret_sharing::Party &party, const bool debug);
 bool Test_BooleanSSAndOrOnline(secret_sharing::Party &party, const bool debug);
+bool Test_MultSessionOnline(secret_sharing::Party &party, const bool debug);
+bool Test_TranscriptReplayOnline(secret_sharing::Party &party, const bool debug);
+bool Test_AdditiveSSMultManyOffline(secret_sharing::Party &party, const bool debug);
+bool Test_AdditiveSSMultManyOnline(secret_sharing::Party &party, const bool debug);
+bool Test_SessionSchedulerOnline(secret_sharing::Party &party, const bool debug);
+bool Test_PipelinedMultiplexerOnline(secret_sharing::Party &party, const bool debug);
 
 void Test_SecretSharing(const comm::CommInfo &comm_info, const uint32_t mode, bool debug) {
-    std::vector<std::string> modes         = {"SecretSharing unit tests", "PartyComm", "AdditiveSSOffline", "BooleanSSOffline", "AdditiveSSMultOffline", "BooleanSSAndOrOffline", "AdditiveSSOnline", "BooleanSSOnline", "AdditiveSSMultOnline", "BooleanSSAndOrOnline"};
+    std::vector<std::string> modes         = {"SecretSharing unit tests", "PartyComm", "AdditiveSSOffline", "BooleanSSOffline", "AdditiveSSMultOffline", "BooleanSSAndOrOffline", "AdditiveSSOnline", "BooleanSSOnline", "AdditiveSSMultOnline", "BooleanSSAndOrOnline", "MultSessionOnline", "TranscriptReplayOnline", "AdditiveSSMultManyOffline", "AdditiveSSMultManyOnline", "SessionSchedulerOnline", "PipelinedMultiplexerOnline"};
     uint32_t                 selected_mode = mode;
     if (selected_mode < 1 || selected_mode > modes.size()) {
         utils::OptionHelpMessage(LOCATION, modes);
@@ -96,6 +145,7 @@ void Test_SecretSharing(const comm::CommInfo &comm_info, const uint32_t mode, bo
             utils::PrintTestResult("Test_BooleanSSOffline", Test_BooleanSSOffline(party, debug));
             utils::PrintTestResult("Test_AdditiveSSMultOffline", Test_AdditiveSSMultOffline(party, debug));
             utils::PrintTestResult("Test_BooleanSSAndOrOffline", Test_BooleanSSAndOrOffline(party, debug));
+            utils::PrintTestResult("Test_AdditiveSSMultManyOffline", Test_AdditiveSSMultManyOffline(party, debug));
         } else {
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
@@ -103,6 +153,11 @@ void Test_SecretSharing(const comm::CommInfo &comm_info, const uint32_t mode, bo
         utils::PrintTestResult("Test_BooleanSSOnline", Test_BooleanSSOnline(party, debug));
         utils::PrintTestResult("Test_AdditiveSSMultOnline", Test_AdditiveSSMultOnline(party, debug));
         utils::PrintTestResult("Test_BooleanSSAndOrOnline", Test_BooleanSSAndOrOnline(party, debug));
+        utils::PrintTestResult("Test_MultSessionOnline", Test_MultSessionOnline(party, debug));
+        utils::PrintTestResult("Test_TranscriptReplayOnline", Test_TranscriptReplayOnline(party, debug));
+        utils::PrintTestResult("Test_AdditiveSSMultManyOnline", Test_AdditiveSSMultManyOnline(party, debug));
+        utils::PrintTestResult("Test_SessionSchedulerOnline", Test_SessionSchedulerOnline(party, debug));
+        utils::PrintTestResult("Test_PipelinedMultiplexerOnline", Test_PipelinedMultiplexerOnline(party, debug));
     } else if (selected_mode == 2) {
         utils::PrintTestResult("Test_PartyComm", Test_PartyComm(party, debug));
     } else if (selected_mode == 3) {
@@ -121,6 +176,18 @@ void Test_SecretSharing(const comm::CommInfo &comm_info, const uint32_t mode, bo
         utils::PrintTestResult("Test_AdditiveSSMultOnline", Test_AdditiveSSMultOnline(party, debug));
     } else if (selected_mode == 10) {
         utils::PrintTestResult("Test_BooleanSSAndOrOnline", Test_BooleanSSAndOrOnline(party, debug));
+    } else if (selected_mode == 11) {
+        utils::PrintTestResult("Test_MultSessionOnline", Test_MultSessionOnline(party, debug));
+    } else if (selected_mode == 12) {
+        utils::PrintTestResult("Test_TranscriptReplayOnline", Test_TranscriptReplayOnline(party, debug));
+    } else if (selected_mode == 13) {
+        utils::PrintTestResult("Test_AdditiveSSMultManyOffline", Test_AdditiveSSMultManyOffline(party, debug));
+    } else if (selected_mode == 14) {
+        utils::PrintTestResult("Test_AdditiveSSMultManyOnline", Test_AdditiveSSMultManyOnline(party, debug));
+    } else if (selected_mode == 15) {
+        utils::PrintTestResult("Test_SessionSchedulerOnline", Test_SessionSchedulerOnline(party, debug));
+    } else if (selected_mode == 16) {
+        utils::PrintTestResult("Test_PipelinedMultiplexerOnline", Test_PipelinedMultiplexerOnline(party, debug));
     }
     utils::PrintText(utils::kDash);
 }
@@ -174,7 +241,7 @@ bool Test_PartyComm(secret_sharing::Party &party, const bool debug) {
     result &= (x_arr4_0[0] == 5) & (x_arr4_0[1] == 10) & (x_arr4_0[2] == 15) & (x_arr4_0[3] == 20) & (x_arr4_1[0] == 10) & (x_arr4_1[1] == 15) & (x_arr4_1[2] == 20) & (x_arr4_1[3] == 25);
 
     // Test total bytes sent
-    uint32_t total_bytes = 0;
+    uint64_t total_bytes = 0;
     total_bytes          = party.GetTotalBytesSent();
     utils::Logger::DebugLog(LOCATION, "Total bytes sent: " + std::to_string(total_bytes), debug);
     result &= (total_bytes > 0);
@@ -579,5 +646,338 @@ bool Test_BooleanSSAndOrOnline(secret_sharing::Party &party, const bool debug) {
     return result;
 }
 
+bool Test_MultSessionOnline(secret_sharing::Party &party, const bool debug) {
+    bool                                  result  = true;
+    uint32_t                              bitsize = 5;
+    secret_sharing::AdditiveSecretSharing ss_a(bitsize);
+    secret_sharing::ShareHandler          sh;
+
+    uint32_t              num   = 4;
+    std::vector<uint32_t> x_vec = utils::CreateVectorWithSameValue(2, num);
+    std::vector<uint32_t> y_vec = utils::CreateSequence(0, num);
+    party.StartCommunication();
+
+    // Shares and Beaver triples of Test_AdditiveSSMultOffline
+    std::vector<uint32_t> x_vec_sh(num), y_vec_sh(num);
+    secret_sharing::bts_t bt_vec_sh;
+    if (party.GetId() == 0) {
+        sh.LoadShare(kTestMultVecXPathP0, x_vec_sh);
+        sh.LoadShare(kTestMultVecYPathP0, y_vec_sh);
+        sh.LoadBTShare(kTestBTPathP0, bt_vec_sh);
+    } else {
+        sh.LoadShare(kTestMultVecXPathP1, x_vec_sh);
+        sh.LoadShare(kTestMultVecYPathP1, y_vec_sh);
+        sh.LoadBTShare(kTestBTPathP1, bt_vec_sh);
+    }
+
+    // One session per element, all opened in a single round (each session keeps its own copy of the triple)
+    std::vector<secret_sharing::MultSession> sessions;
+    sessions.reserve(num);
+    secret_sharing::SessionMultiplexer mux(party);
+    for (uint32_t i = 0; i < num; i++) {
+        sessions.emplace_back(party.GetId(), bitsize, secret_sharing::bts_t{bt_vec_sh[i]}, std::vector<uint32_t>{x_vec_sh[i]}, std::vector<uint32_t>{y_vec_sh[i]});
+    }
+    for (auto &session : sessions) {
+        mux.AddSession(session);
+    }
+    uint32_t rounds = mux.Run();
+
+    std::vector<uint32_t> z_vec_0(num), z_vec_1(num), z_vec_res(num);
+    for (uint32_t i = 0; i < num; i++) {
+        if (party.GetId() == 0) {
+            z_vec_0[i] = sessions[i].GetOutput()[0];
+        } else {
+            z_vec_1[i] = sessions[i].GetOutput()[0];
+        }
+    }
+    ss_a.Reconst(party, z_vec_0, z_vec_1, z_vec_res);
+
+    utils::Logger::DebugLog(LOCATION, "Rounds: " + std::to_string(rounds), debug);
+    utils::Logger::DebugLog(LOCATION, "Reconst: " + utils::VectorToStr(z_vec_res), debug);
+
+    result &= (rounds == 1);
+    for (size_t i = 0; i < z_vec_res.size(); i++) {
+        result &= (z_vec_res[i] == utils::Mod(x_vec[i] * y_vec[i], bitsize));
+    }
+    return result;
+}
+
+bool Test_TranscriptReplayOnline(secret_sharing::Party &party, const bool debug) {
+    bool                                  result  = true;
+    uint32_t                              bitsize = 5;
+    secret_sharing::AdditiveSecretSharing ss_a(bitsize);
+    secret_sharing::ShareHandler          sh;
+    const std::string                     path = (party.GetId() == 0) ? kTestTranscriptPathP0 : kTestTranscriptPathP1;
+
+    // Shares and Beaver triples of Test_AdditiveSSMultOffline
+    std::vector<uint32_t> x_vec_sh, y_vec_sh;
+    secret_sharing::bts_t bt_vec_sh;
+    if (party.GetId() == 0) {
+        sh.LoadShare(kTestMultVecXPathP0, x_vec_sh);
+        sh.LoadShare(kTestMultVecYPathP0, y_vec_sh);
+        sh.LoadBTShare(kTestBTPathP0, bt_vec_sh);
+    } else {
+        sh.LoadShare(kTestMultVecXPathP1, x_vec_sh);
+        sh.LoadShare(kTestMultVecYPathP1, y_vec_sh);
+        sh.LoadBTShare(kTestBTPathP1, bt_vec_sh);
+    }
+
+    // A session with rounds of every message type
+    auto run = [&](secret_sharing::Party &p) {
+        std::vector<uint32_t> outputs;
+        uint32_t              x_0 = 0, x_1 = 0;
+        (p.GetId() == 0 ? x_0 : x_1) = 7 + p.GetId();
+        p.SendRecv(x_0, x_1);
+        outputs.push_back(x_0);
+        outputs.push_back(x_1);
+
+        std::array<uint32_t, 2> a2_0 = {1, 2}, a2_1 = {3, 4};
+        std::array<uint32_t, 4> a4_0 = {5, 6, 7, 8}, a4_1 = {9, 10, 11, 12};
+        p.SendRecv(a2_0, a2_1);
+        p.SendRecv(a4_0, a4_1);
+        outputs.insert(outputs.end(), a2_0.begin(), a2_0.end());
+        outputs.insert(outputs.end(), a4_1.begin(), a4_1.end());
+
+        std::vector<uint32_t> z_vec_0(x_vec_sh.size()), z_vec_1(x_vec_sh.size()), z_vec(x_vec_sh.size());
+        ss_a.Mult(p, bt_vec_sh, x_vec_sh, y_vec_sh, (p.GetId() == 0) ? z_vec_0 : z_vec_1);
+        ss_a.Reconst(p, z_vec_0, z_vec_1, z_vec);
+        outputs.insert(outputs.end(), z_vec.begin(), z_vec.end());
+        return outputs;
+    };
+
+    // Record the session with the other party
+    party.StartCommunication();
+    party.ClearTotalBytesSent();
+    result &= party.StartRecording(path);
+    std::vector<uint32_t> recorded       = run(party);
+    uint64_t              recorded_bytes = party.GetTotalBytesSent();
+    party.StopTranscript();
+
+    // Replay it alone (the other party replays its own transcript)
+    secret_sharing::Party replay(comm::CommInfo(party.GetId(), comm::kDefaultPort, comm::kDefaultAddress));
+    result &= replay.StartReplay(path);
+    replay.StartCommunication();
+    std::vector<uint32_t> replayed = run(replay);
+    utils::Logger::DebugLog(LOCATION, "Recorded: " + utils::VectorToStr(recorded) + " (" + std::to_string(recorded_bytes) + " bytes)", debug);
+    utils::Logger::DebugLog(LOCATION, "Replayed: " + utils::VectorToStr(replayed) + " (" + std::to_string(replay.GetTotalBytesSent()) + " bytes)", debug);
+
+    result &= (replayed == recorded) && (replay.GetTotalBytesSent() == recorded_bytes);
+    result &= (replay.GetTranscriptMode() == secret_sharing::TranscriptMode::kReplay) && (party.GetTranscriptMode() == secret_sharing::TranscriptMode::kNone);
+    return result;
+}
+
+bool Test_AdditiveSSMultManyOffline(secret_sharing::Party &party, const bool debug) {
+    bool                                  result  = true;
+    uint32_t                              bitsize = 5;
+    secret_sharing::AdditiveSecretSharing ss_a(bitsize);
+    utils::FileIo                         io;
+    secret_sharing::ShareHandler          sh;
+
+    // Three operands with 2, 2 and 4 values (the first one is also used by Mult2)
+    std::vector<uint32_t> x_vec = {3, 5, 7};
+    std::vector<uint32_t> y_vec = utils::CreateSequence(1, 9);
+    secret_sharing::cts_t ct_vec, ct_vec_4;
+    ss_a.GenerateCorrelatedTriples(2, 2, ct_vec);
+    ss_a.GenerateCorrelatedTriples(1, 4, ct_vec_4);
+    ct_vec.push_back(ct_vec_4[0]);
+    std::pair<secret_sharing::cts_t, secret_sharing::cts_t> ct_vec_sh = ss_a.ShareCorrelatedTriples(ct_vec);
+    std::pair<std::vector<uint32_t>, std::vector<uint32_t>> x_vec_sh  = ss_a.Share(x_vec);
+    std::pair<std::vector<uint32_t>, std::vector<uint32_t>> y_vec_sh  = ss_a.Share(y_vec);
+
+    io.WriteVectorToFile(kTestMultManyXPath, x_vec);
+    io.WriteVectorToFile(kTestMultManyYPath, y_vec);
+    sh.ExportShare(kTestMultManyXPathP0, kTestMultManyXPathP1, x_vec_sh);
+    sh.ExportShare(kTestMultManyYPathP0, kTestMultManyYPathP1, y_vec_sh);
+    sh.ExportCT(kTestCTPath, ct_vec);
+    sh.ExportCTShare(kTestCTPathP0, kTestCTPathP1, ct_vec_sh);
+
+    for (size_t i = 0; i < ct_vec.size(); i++) {
+        utils::Logger::DebugLog(LOCATION, "Share of ct: " + ct_vec[i].ToStr() + " -> " + ct_vec_sh.first[i].ToStr(false) + ", " + ct_vec_sh.second[i].ToStr(false), debug);
+        result &= ct_vec[i].GetFanOut() == ct_vec[i].c.size();
+        for (uint32_t j = 0; j < ct_vec[i].GetFanOut(); j++) {
+            result &= ct_vec[i].c[j] == utils::Mod(ct_vec[i].a * ct_vec[i].b[j], bitsize);
+            result &= utils::Mod(ct_vec_sh.first[i].c[j] + ct_vec_sh.second[i].c[j], bitsize) == ct_vec[i].c[j];
+        }
+    }
+
+    // The stream and the file give the same triples
+    std::stringstream     stream;
+    secret_sharing::cts_t ct_stream, ct_file;
+    sh.WriteCorrelatedTriples(stream, ct_vec_sh.first);
+    result &= sh.ReadCorrelatedTriples(stream, ct_stream);
+    sh.LoadCTShare(kTestCTPathP0, ct_file);
+    result &= ct_stream.size() == ct_vec.size() && ct_file.size() == ct_vec.size();
+    for (size_t i = 0; i < ct_stream.size() && i < ct_file.size(); i++) {
+        result &= ct_stream[i].a == ct_vec_sh.first[i].a && ct_stream[i].b == ct_vec_sh.first[i].b && ct_stream[i].c == ct_vec_sh.first[i].c;
+        result &= ct_file[i].a == ct_stream[i].a && ct_file[i].b == ct_stream[i].b && ct_file[i].c == ct_stream[i].c;
+    }
+    std::stringstream broken("2\n1,2\n"), broken_size("x\n1,2,3\n");
+    result &= !sh.ReadCorrelatedTriples(broken, ct_stream);
+    result &= !sh.ReadCorrelatedTriples(broken_size, ct_stream);
+    return result;
+}
+
+bool Test_AdditiveSSMultManyOnline(secret_sharing::Party &party, const bool debug) {
+    bool                                  result  = true;
+    uint32_t                              bitsize = 5;
+    secret_sharing::AdditiveSecretSharing ss_a(bitsize);
+    utils::FileIo                         io;
+    secret_sharing::ShareHandler          sh;
+    party.StartCommunication();
+
+    std::vector<uint32_t> x_vec, y_vec, x_vec_sh, y_vec_sh;
+    secret_sharing::cts_t ct_vec_sh;
+    io.ReadVectorFromFile(kTestMultManyXPath, x_vec);
+    io.ReadVectorFromFile(kTestMultManyYPath, y_vec);
+    sh.LoadShare((party.GetId() == 0) ? kTestMultManyXPathP0 : kTestMultManyXPathP1, x_vec_sh);
+    sh.LoadShare((party.GetId() == 0) ? kTestMultManyYPathP0 : kTestMultManyYPathP1, y_vec_sh);
+    sh.LoadCTShare((party.GetId() == 0) ? kTestCTPathP0 : kTestCTPathP1, ct_vec_sh);
+
+    // All operands in one round
+    std::vector<uint32_t> z_vec_0(y_vec.size()), z_vec_1(y_vec.size()), z_vec_res(y_vec.size());
+    ss_a.MultMany(party, ct_vec_sh, x_vec_sh, y_vec_sh, (party.GetId() == 0) ? z_vec_0 : z_vec_1);
+    ss_a.Reconst(party, z_vec_0, z_vec_1, z_vec_res);
+    utils::Logger::DebugLog(LOCATION, "Reconst: " + utils::VectorToStr(z_vec_res), debug);
+    for (size_t i = 0, offset = 0; i < x_vec.size(); offset += ct_vec_sh[i].GetFanOut(), i++) {
+        for (uint32_t j = 0; j < ct_vec_sh[i].GetFanOut(); j++) {
+            result &= (z_vec_res[offset + j] == utils::Mod(x_vec[i] * y_vec[offset + j], bitsize));
+        }
+    }
+
+    // Mult2 with a correlated triple opens the shared operand once
+    party.ClearTotalBytesSent();
+    std::array<uint32_t, 2> z_0{0, 0}, z_1{0, 0}, z_res{0, 0};
+    ((party.GetId() == 0) ? z_0 : z_1) = ss_a.Mult2(party, ct_vec_sh[0], x_vec_sh[0], y_vec_sh[0], y_vec_sh[1]);
+    uint64_t ct_bytes                  = party.GetTotalBytesSent();
+    ss_a.Reconst(party, z_0, z_1, z_res);
+    utils::Logger::DebugLog(LOCATION, "Mult2: " + std::to_string(z_res[0]) + ", " + std::to_string(z_res[1]) + " (" + std::to_string(ct_bytes) + " bytes)", debug);
+    result &= (z_res[0] == utils::Mod(x_vec[0] * y_vec[0], bitsize)) && (z_res[1] == utils::Mod(x_vec[0] * y_vec[1], bitsize));
+    result &= (ct_bytes == 3 * sizeof(uint32_t));
+    return result;
+}
+
+bool Test_SessionSchedulerOnline(secret_sharing::Party &party, const bool debug) {
+    bool     result = true;
+    uint32_t id     = party.GetId();
+    party.StartCommunication();
+
+    // The shares of x (party 0 holds x, party 1 holds 0) give x + rounds
+    auto reconst = [&](const CountSession &session) {
+        std::vector<uint32_t> x_0 = {id == 0 ? session.GetShare() : 0}, x_1 = {id == 1 ? session.GetShare() : 0};
+        party.SendRecv(x_0, x_1);
+        return x_0[0] + x_1[0];
+    };
+
+    // Without limits, all sessions advance in every round (on two threads)
+    {
+        secret_sharing::SchedulerLimits limits;
+        limits.thread_num = 2;
+        secret_sharing::SessionScheduler scheduler(party, limits);
+        std::vector<CountSession>        sessions;
+        for (uint32_t i = 0; i < 4; i++) {
+            sessions.emplace_back(id, id == 0 ? 10 * i : 0, i + 1, i + 1);
+        }
+        for (auto &session : sessions) {
+            result &= scheduler.AddSession(session);
+        }
+        result &= (scheduler.Run() == 4);
+        for (uint32_t i = 0; i < 4; i++) {
+            result &= (reconst(sessions[i]) == 10 * i + i + 1);
+        }
+    }
+
+    // One session per round: the interactive session goes first, then the batch sessions by deadline
+    {
+        secret_sharing::SchedulerLimits limits;
+        limits.max_sessions_per_round = 1;
+        secret_sharing::SessionScheduler scheduler(party, limits);
+        CountSession                     long_batch(id, 0, 5, 8), late_batch(id, 0, 2, 1), interactive(id, 0, 2, 1);
+        secret_sharing::SessionOptions   batch_opt, late_opt, interactive_opt;
+        batch_opt.deadline       = 20;
+        late_opt.deadline        = 3;
+        interactive_opt.priority = secret_sharing::SessionPriority::kInteractive;
+        scheduler.AddSession(long_batch, batch_opt);
+        scheduler.AddSession(late_batch, late_opt);
+        scheduler.AddSession(interactive, interactive_opt);
+        std::vector<uint64_t> finished(3, 0);
+        while (scheduler.RunRound()) {
+            const CountSession *order[3] = {&interactive, &late_batch, &long_batch};
+            for (uint32_t i = 0; i < 3; i++) {
+                if (order[i]->IsFinished() && finished[i] == 0) {
+                    finished[i] = scheduler.GetRound();
+                }
+            }
+        }
+        utils::Logger::DebugLog(LOCATION, "Finished rounds: " + utils::VectorToStr(finished), debug);
+        result &= (finished == std::vector<uint64_t>{2, 4, 9});
+        result &= (scheduler.GetDeadlineMissNum() == 1);    // late_batch finishes at round 4 > 3
+        result &= (reconst(long_batch) == 5);
+    }
+
+    // Memory limit and backpressure: 60 + 60 > 100 runs the sessions one after another, an oversize session runs alone
+    {
+        secret_sharing::SchedulerLimits limits;
+        limits.memory_limit = 100;
+        limits.max_pending  = 3;
+        secret_sharing::SessionScheduler scheduler(party, limits);
+        CountSession                     first(id, 0, 2, 1), second(id, 0, 2, 1), oversize(id, 0, 1, 1), rejected(id, 0, 1, 1);
+        secret_sharing::SessionOptions   small_opt, large_opt;
+        small_opt.memory_bytes = 60;
+        large_opt.memory_bytes = 200;
+        result &= scheduler.AddSession(first, small_opt);
+        result &= scheduler.AddSession(second, small_opt);
+        result &= scheduler.AddSession(oversize, large_opt);
+        result &= !scheduler.AddSession(rejected, small_opt);
+        result &= scheduler.RunRound();
+        result &= (scheduler.GetRunningNum() == 1 && scheduler.GetPendingNum() == 2);
+        result &= (scheduler.Run() == 4);
+        result &= first.IsFinished() && second.IsFinished() && oversize.IsFinished() && !rejected.IsFinished();
+    }
+    return result;
+}
+
+bool Test_PipelinedMultiplexerOnline(secret_sharing::Party &party, const bool debug) {
+    bool            result = true;
+    uint32_t        id     = party.GetId();
+    utils::Counter &rounds = utils::MetricsRegistry::GetInstance().GetCounter("fss_comm_rounds_total", "Number of communication rounds (SendRecv calls and Send/Recv pairs).");
+    party.StartCommunication();
+
+    // Sessions of 1 to 6 rounds in 1 to 3 batches: every batch takes as many messages as its longest session
+    for (uint32_t depth = 1; depth <= 3; depth++) {
+        secret_sharing::PipelinedMultiplexer mux(party, depth);
+        std::vector<CountSession>            sessions;
+        for (uint32_t i = 0; i < 6; i++) {
+            sessions.emplace_back(id, id == 0 ? 100 * i : 0, i + 1, 2 * i + 1);
+        }
+        for (auto &session : sessions) {
+            mux.AddSession(session);
+        }
+        uint64_t rounds_before = rounds.Value();
+        uint32_t messages      = mux.Run();
+        uint32_t expected      = 0;
+        for (uint32_t b = 0; b < depth; b++) {
+            uint32_t longest = 0;
+            for (uint32_t i = b; i < sessions.size(); i += depth) {
+                longest = std::max(longest, i + 1);
+            }
+            expected += longest;
+        }
+        result &= (messages == expected);
+        result &= (rounds.Value() - rounds_before == messages);    // Each Send/Recv pair is a round
+
+        // Reconstruct the outputs with the blocking rounds afterwards
+        std::vector<uint32_t> x_0(sessions.size(), 0), x_1(sessions.size(), 0);
+        for (uint32_t i = 0; i < sessions.size(); i++) {
+            ((id == 0) ? x_0 : x_1)[i] = sessions[i].GetShare();
+        }
+        party.SendRecv(x_0, x_1);
+        for (uint32_t i = 0; i < sessions.size(); i++) {
+            result &= (x_0[i] + x_1[i] == 100 * i + i + 1);
+        }
+        utils::Logger::DebugLog(LOCATION, "Depth: " + std::to_string(depth) + ", Messages: " + std::to_string(messages), debug);
+    }
+    return result;
+}
+
 }    // namespace test
 }    // namespace tools
@@ -0,0 +1,147 @@
+/**
+ * @file transcript.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-28
+ * @copyright Copyright (c) 2024
+ * @brief Transcript implementation.
+ */
+
+#include "transcript.hpp"
+
+#include <cstring>
+
+#include "../utils/logger.hpp"
+
+namespace {
+
+constexpr char     kTranscriptMagic[8] = {'F', 'S', 'S', 'T', 'R', 'S', '\0', '\0'};
+constexpr uint32_t kTranscriptVersion  = 1;
+constexpr uint64_t kRoundHeaderWords   = 4;    // The sent and received counts (uint64) in uint32 words
+
+template <typename T>
+void WriteValue(std::ofstream &file, const T &value) {
+    file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool ReadValue(std::ifstream &file, T &value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+}    // namespace
+
+namespace tools {
+namespace secret_sharing {
+
+Transcript::Transcript()
+    : mode_(TranscriptMode::kNone), offset_(0), rounds_(0) {
+}
+
+bool Transcript::StartRecording(const std::string &file_path, const uint32_t party_id) {
+    this->Stop();
+    this->file_.open(file_path, std::ios::binary | std::ios::trunc);
+    if (!this->file_.is_open()) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to open file for writing. (" + file_path + ")");
+        return false;
+    }
+    this->file_.write(kTranscriptMagic, sizeof(kTranscriptMagic));
+    WriteValue(this->file_, kTranscriptVersion);
+    WriteValue(this->file_, party_id);
+    this->mode_ = TranscriptMode::kRecord;
+    return true;
+}
+
+bool Transcript::StartReplay(const std::string &file_path, const uint32_t party_id) {
+    this->Stop();
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to open file for reading. (" + file_path + ")");
+        return false;
+    }
+
+    char     magic[sizeof(kTranscriptMagic)];
+    uint32_t version = 0, id = 0;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kTranscriptMagic, sizeof(magic)) != 0 || !ReadValue(file, version) || version != kTranscriptVersion || !ReadValue(file, id)) {
+        utils::Logger::ErrorLog(LOCATION, "Invalid transcript file. (" + file_path + ")");
+        return false;
+    }
+    if (id != party_id) {
+        utils::Logger::ErrorLog(LOCATION, "The transcript was recorded by party " + std::to_string(id) + ". (" + file_path + ")");
+        return false;
+    }
+
+    // Load all rounds, so that the replay does not read the file
+    std::streamoff begin = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff end = file.tellg();
+    file.seekg(begin);
+    if ((end - begin) % sizeof(uint32_t) != 0) {
+        utils::Logger::ErrorLog(LOCATION, "Truncated transcript file. (" + file_path + ")");
+        return false;
+    }
+    this->data_.resize((end - begin) / sizeof(uint32_t));
+    if (!file.read(reinterpret_cast<char *>(this->data_.data()), end - begin)) {
+        utils::Logger::ErrorLog(LOCATION, "Failed to read the transcript. (" + file_path + ")");
+        this->data_.clear();
+        return false;
+    }
+    this->mode_ = TranscriptMode::kReplay;
+    return true;
+}
+
+void Transcript::Stop() {
+    if (this->file_.is_open()) {
+        this->file_.close();
+    }
+    this->data_.clear();
+    this->data_.shrink_to_fit();
+    this->mode_   = TranscriptMode::kNone;
+    this->offset_ = 0;
+    this->rounds_ = 0;
+}
+
+TranscriptMode Transcript::GetMode() const {
+    return this->mode_;
+}
+
+uint64_t Transcript::GetRoundNum() const {
+    return this->rounds_;
+}
+
+void Transcript::Record(const uint64_t sent_num, const uint32_t *received, const uint64_t received_num) {
+    WriteValue(this->file_, sent_num);
+    WriteValue(this->file_, received_num);
+    this->file_.write(reinterpret_cast<const char *>(received), received_num * sizeof(uint32_t));
+    if (!this->file_) {
+        utils::Logger::FatalLog(LOCATION, "Failed to write the transcript (round " + std::to_string(this->rounds_) + ")");
+        exit(EXIT_FAILURE);
+    }
+    this->rounds_++;
+}
+
+const uint32_t *Transcript::Replay(const uint64_t sent_num, uint64_t &received_num) {
+    uint64_t recorded_sent = 0;
+    received_num           = 0;
+    if (this->data_.size() - this->offset_ < kRoundHeaderWords) {
+        utils::Logger::FatalLog(LOCATION, "The transcript has no round " + std::to_string(this->rounds_));
+        exit(EXIT_FAILURE);
+    }
+    std::memcpy(&recorded_sent, this->data_.data() + this->offset_, sizeof(uint64_t));
+    std::memcpy(&received_num, this->data_.data() + this->offset_ + 2, sizeof(uint64_t));
+    // The count is read from the file, so it is compared with the remaining words (the sum could wrap around)
+    if (received_num > this->data_.size() - this->offset_ - kRoundHeaderWords) {
+        utils::Logger::FatalLog(LOCATION, "The transcript is truncated at round " + std::to_string(this->rounds_) + " (" + std::to_string(received_num) + " values recorded)");
+        exit(EXIT_FAILURE);
+    }
+    if (recorded_sent != sent_num) {
+        utils::Logger::FatalLog(LOCATION, "The replay diverged at round " + std::to_string(this->rounds_) + " (sent " + std::to_string(sent_num) + " values, recorded " + std::to_string(recorded_sent) + ")");
+        exit(EXIT_FAILURE);
+    }
+    const uint32_t *received = this->data_.data() + this->offset_ + kRoundHeaderWords;
+    this->offset_ += kRoundHeaderWords + received_num;
+    this->rounds_++;
+    return received;
+}
+
+}    // namespace secret_sharing
+}    // namespace tools
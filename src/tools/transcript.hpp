@@ -0,0 +1,107 @@
+/**
+ * @file transcript.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-28
+ * @copyright Copyright (c) 2024
+ * @brief Transcript class (record and replay of the messages of a party).
+ */
+
+#ifndef TOOLS_TRANSCRIPT_H_
+#define TOOLS_TRANSCRIPT_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace tools {
+namespace secret_sharing {
+
+/**
+ * @brief The mode of a transcript.
+ */
+enum class TranscriptMode {
+    kNone,   /**< The messages are exchanged with the other party only. */
+    kRecord, /**< The received messages are appended to the transcript file. */
+    kReplay, /**< The received messages are read from the transcript file instead of the socket. */
+};
+
+/**
+ * @class Transcript
+ * @brief The messages received by one party during a session, in order.
+ *
+ * Each round of Party::SendRecv is stored as the number of values sent and the values received.
+ * A replayed party gets the recorded messages of the other party without any socket, so its computation can be
+ * profiled alone and deterministically. The number of values sent is checked in every round to detect a replay
+ * that diverges from the recorded session (e.g. a different query or key).
+ *
+ * File format: magic "FSSTRS", version, party ID, then per round: sent count (uint64), received count (uint64) and the received values (uint32).
+ */
+class Transcript {
+public:
+    /**
+     * @brief Default constructor for Transcript (kNone).
+     */
+    Transcript();
+
+    /**
+     * @brief Create a transcript file and record the following rounds.
+     * @param file_path The path of the transcript file.
+     * @param party_id The ID of the recording party.
+     * @return `true` if the file is created.
+     */
+    bool StartRecording(const std::string &file_path, const uint32_t party_id);
+
+    /**
+     * @brief Load a transcript file and replay its rounds.
+     * @param file_path The path of the transcript file.
+     * @param party_id The ID of the replaying party (must be the recording party).
+     * @return `true` if the file is loaded.
+     */
+    bool StartReplay(const std::string &file_path, const uint32_t party_id);
+
+    /**
+     * @brief Close the transcript file and return to kNone.
+     */
+    void Stop();
+
+    /**
+     * @brief Retrieves the mode of the transcript.
+     * @return The mode.
+     */
+    TranscriptMode GetMode() const;
+
+    /**
+     * @brief Retrieves the number of rounds recorded or replayed since the start.
+     * @return The number of rounds.
+     */
+    uint64_t GetRoundNum() const;
+
+    /**
+     * @brief Append a round (kRecord).
+     * @param sent_num The number of values sent.
+     * @param received The values received.
+     * @param received_num The number of values received.
+     */
+    void Record(const uint64_t sent_num, const uint32_t *received, const uint64_t received_num);
+
+    /**
+     * @brief Get the next round (kReplay). Exits if the transcript is exhausted or the sent count differs.
+     * @param sent_num The number of values sent in this round.
+     * @param received_num The number of values received in this round.
+     * @return The values received.
+     */
+    const uint32_t *Replay(const uint64_t sent_num, uint64_t &received_num);
+
+private:
+    TranscriptMode        mode_;    /**< The mode. */
+    std::ofstream         file_;    /**< The recorded file (kRecord). */
+    std::vector<uint32_t> data_;    /**< The rounds of the loaded file (kReplay). */
+    uint64_t              offset_;  /**< The offset of the next round in data_ (kReplay). */
+    uint64_t              rounds_;  /**< The number of rounds since the start. */
+};
+
+}    // namespace secret_sharing
+}    // namespace tools
+
+#endif    // TOOLS_TRANSCRIPT_H_
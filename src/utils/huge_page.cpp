@@ -0,0 +1,138 @@
+/**
+ * @file huge_page.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-26
+ * @copyright Copyright (c) 2024
+ * @brief Huge-page-backed allocator implementation.
+ */
+
+#include "huge_page.hpp"
+
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include "logger.hpp"
+#include "metrics.hpp"
+
+namespace {
+
+constexpr std::size_t kPageSize = 4096;
+
+std::mutex             options_mutex;
+utils::HugePageOptions options;
+
+utils::Gauge &GetHugePageGauge() {
+    static utils::Gauge &gauge = utils::MetricsRegistry::GetInstance().GetGauge("utils_huge_page_bytes", "Bytes currently mapped by the huge page allocator");
+    return gauge;
+}
+
+utils::Counter &GetFallbackCounter() {
+    static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("utils_huge_page_fallback_total", "Explicit huge page allocations served by transparent huge pages");
+    return counter;
+}
+
+std::size_t RoundUp(const std::size_t bytes, const std::size_t unit) {
+    return (bytes + unit - 1) / unit * unit;
+}
+
+// Map the pages of the huge page pool (nullptr if the pool cannot serve the request)
+void *MapExplicit(const std::size_t length) {
+    void *p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    return (p == MAP_FAILED) ? nullptr : p;
+}
+
+// Map 4 KiB pages aligned to kHugePageSize, so that the kernel can back them with transparent huge pages
+void *MapAligned(const std::size_t length, const bool transparent) {
+    std::size_t mapped = length + utils::kHugePageSize;
+    void       *p      = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+    uintptr_t begin   = reinterpret_cast<uintptr_t>(p);
+    uintptr_t aligned = RoundUp(begin, utils::kHugePageSize);
+    if (aligned > begin) {
+        munmap(p, aligned - begin);
+    }
+    std::size_t tail = mapped - (aligned - begin) - length;
+    if (tail > 0) {
+        munmap(reinterpret_cast<void *>(aligned + length), tail);
+    }
+    // madvise fails if transparent huge pages are disabled, and the mapping stays with 4 KiB pages
+    if (transparent) {
+        madvise(reinterpret_cast<void *>(aligned), length, MADV_HUGEPAGE);
+    }
+    return reinterpret_cast<void *>(aligned);
+}
+
+}    // namespace
+
+namespace utils {
+
+HugePageOptions::HugePageOptions()
+    : mode(HugePageMode::kTransparent), prefault(true), lock(false) {
+}
+
+void SetHugePageOptions(const HugePageOptions &new_options) {
+    std::lock_guard<std::mutex> lock(options_mutex);
+    options = new_options;
+}
+
+HugePageOptions GetHugePageOptions() {
+    std::lock_guard<std::mutex> lock(options_mutex);
+    return options;
+}
+
+void *AllocateHugePages(const std::size_t bytes) {
+    if (bytes < kHugePageThreshold) {
+        return ::operator new(bytes, std::align_val_t(kHugePageAlignment));
+    }
+
+    HugePageOptions opt    = GetHugePageOptions();
+    std::size_t     length = RoundUp(bytes, kHugePageSize);
+    void           *p      = nullptr;
+    if (opt.mode == HugePageMode::kExplicit) {
+        p = MapExplicit(length);
+        if (p == nullptr) {
+            GetFallbackCounter().Increment();
+        }
+    }
+    if (p == nullptr) {
+        p = MapAligned(length, opt.mode != HugePageMode::kNone);
+    }
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    // Touch every page so that the scans do not take the page faults
+    if (opt.prefault) {
+        volatile char *bytes_ptr = static_cast<char *>(p);
+        for (std::size_t i = 0; i < length; i += kPageSize) {
+            bytes_ptr[i] = 0;
+        }
+    }
+    if (opt.lock && mlock(p, length) != 0) {
+        Logger::WarnLog(LOCATION, "mlock failed: " + std::string(std::strerror(errno)));
+    }
+    GetHugePageGauge().Add(static_cast<int64_t>(length));
+    return p;
+}
+
+void FreeHugePages(void *ptr, const std::size_t bytes) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (bytes < kHugePageThreshold) {
+        ::operator delete(ptr, std::align_val_t(kHugePageAlignment));
+        return;
+    }
+    // munmap also unlocks the pages
+    std::size_t length = RoundUp(bytes, kHugePageSize);
+    munmap(ptr, length);
+    GetHugePageGauge().Add(-static_cast<int64_t>(length));
+}
+
+}    // namespace utils
@@ -0,0 +1,124 @@
+/**
+ * @file huge_page.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-26
+ * @copyright Copyright (c) 2024
+ * @brief Huge-page-backed allocator.
+ */
+
+#ifndef UTILS_HUGE_PAGE_H_
+#define UTILS_HUGE_PAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+constexpr std::size_t kHugePageSize      = static_cast<std::size_t>(1) << 21;    // 2 MiB
+constexpr std::size_t kHugePageThreshold = kHugePageSize;                         // Smaller allocations use operator new
+constexpr std::size_t kHugePageAlignment = 64;                                    // Alignment of the smaller allocations
+
+/**
+ * @enum HugePageMode
+ * @brief How the large allocations are backed.
+ */
+enum class HugePageMode {
+    kNone,        /**< 4 KiB pages (mmap only). */
+    kTransparent, /**< Transparent huge pages (madvise(MADV_HUGEPAGE) on a 2 MiB aligned mapping). */
+    kExplicit,    /**< Pages of the huge page pool (MAP_HUGETLB), or transparent huge pages if the pool is empty. */
+};
+
+/**
+ * @struct HugePageOptions
+ * @brief The process-wide options of AllocateHugePages.
+ */
+struct HugePageOptions {
+    HugePageMode mode;     /**< How the large allocations are backed. */
+    bool         prefault; /**< Fault every page at the allocation instead of at the first access. */
+    bool         lock;     /**< Lock the pages in memory (mlock; skipped with a warning above RLIMIT_MEMLOCK). */
+
+    /**
+     * @brief Default constructor for HugePageOptions (transparent huge pages, prefaulted, not locked).
+     */
+    HugePageOptions();
+};
+
+/**
+ * @brief Set the options of the following allocations.
+ * @param options The options.
+ */
+void SetHugePageOptions(const HugePageOptions &options);
+
+/**
+ * @brief Get the options of the allocations.
+ * @return The options.
+ */
+HugePageOptions GetHugePageOptions();
+
+/**
+ * @brief Allocate memory, backed by huge pages if it is kHugePageThreshold bytes or more.
+ * @param bytes The number of bytes.
+ * @return The memory (aligned to kHugePageSize if large, to kHugePageAlignment otherwise).
+ * @throw std::bad_alloc if the memory cannot be allocated.
+ */
+void *AllocateHugePages(const std::size_t bytes);
+
+/**
+ * @brief Free memory allocated by AllocateHugePages.
+ * @param ptr The memory.
+ * @param bytes The number of bytes given to AllocateHugePages.
+ */
+void FreeHugePages(void *ptr, const std::size_t bytes) noexcept;
+
+/**
+ * @class HugePageAllocator
+ * @brief A standard allocator backed by AllocateHugePages.
+ *
+ * Containers of the full-domain outputs and the BWT use it to reduce the TLB misses of the sequential scans.
+ * Allocations smaller than kHugePageThreshold are served by operator new.
+ */
+template <typename T>
+class HugePageAllocator {
+public:
+    using value_type = T;
+
+    HugePageAllocator() noexcept = default;
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) noexcept {
+    }
+
+    T *allocate(const std::size_t n) {
+        return static_cast<T *>(AllocateHugePages(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, const std::size_t n) noexcept {
+        FreeHugePages(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U> &) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U> &) const noexcept {
+        return false;
+    }
+};
+
+template <typename T>
+using HugeVector = std::vector<T, HugePageAllocator<T>>;
+using HugeString = std::basic_string<char, std::char_traits<char>, HugePageAllocator<char>>;
+
+namespace test {
+
+void Test_HugePage(const uint32_t mode, bool debug);
+
+}    // namespace test
+
+}    // namespace utils
+
+#endif    // UTILS_HUGE_PAGE_H_
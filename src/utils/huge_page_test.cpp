@@ -0,0 +1,106 @@
+/**
+ * @file huge_page_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-26
+ * @copyright Copyright (c) 2024
+ * @brief Huge-page-backed allocator test implementation.
+ */
+
+#include "huge_page.hpp"
+
+#include <numeric>
+
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "utils.hpp"
+
+namespace {
+
+constexpr uint32_t kTestAllocSize = 1 << 24;    // 16 MiB
+
+int64_t MappedBytes() {
+    return utils::MetricsRegistry::GetInstance().GetGauge("utils_huge_page_bytes", "Bytes currently mapped by the huge page allocator").Value();
+}
+
+}    // namespace
+
+namespace utils {
+namespace test {
+
+bool Test_HugePageAllocate(const bool debug);
+bool Test_HugePageVector(const bool debug);
+
+void Test_HugePage(const uint32_t mode, bool debug) {
+    std::vector<std::string> modes         = {"Huge page unit tests", "Allocate", "Vector"};
+    uint32_t                 selected_mode = mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        debug = false;
+        utils::PrintTestResult("Test_HugePageAllocate", Test_HugePageAllocate(debug));
+        utils::PrintTestResult("Test_HugePageVector", Test_HugePageVector(debug));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_HugePageAllocate", Test_HugePageAllocate(debug));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_HugePageVector", Test_HugePageVector(debug));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_HugePageAllocate(const bool debug) {
+    bool            result   = true;
+    HugePageOptions original = GetHugePageOptions();
+    for (const HugePageMode mode : {HugePageMode::kNone, HugePageMode::kTransparent, HugePageMode::kExplicit}) {
+        HugePageOptions opt;
+        opt.mode = mode;
+        opt.lock = true;
+        SetHugePageOptions(opt);
+
+        // Large allocations are aligned to a huge page and counted by the gauge until they are freed
+        int64_t before = MappedBytes();
+        char   *large  = static_cast<char *>(AllocateHugePages(kTestAllocSize + 1));
+        result &= reinterpret_cast<uintptr_t>(large) % kHugePageSize == 0;
+        result &= MappedBytes() - before == static_cast<int64_t>(kTestAllocSize + kHugePageSize);
+        large[0]              = 1;
+        large[kTestAllocSize] = 2;
+        result &= large[0] == 1 && large[kTestAllocSize] == 2;
+        FreeHugePages(large, kTestAllocSize + 1);
+        result &= MappedBytes() == before;
+
+        // Small allocations do not take a huge page
+        char *small = static_cast<char *>(AllocateHugePages(100));
+        result &= reinterpret_cast<uintptr_t>(small) % kHugePageAlignment == 0 && MappedBytes() == before;
+        FreeHugePages(small, 100);
+        utils::Logger::DebugLog(LOCATION, "Mode " + std::to_string(static_cast<int>(mode)) + ": " + (result ? "OK" : "NG"), debug);
+    }
+    SetHugePageOptions(original);
+    return result;
+}
+
+bool Test_HugePageVector(const bool debug) {
+    bool                 result = true;
+    HugeVector<uint32_t> vec(kTestAllocSize / sizeof(uint32_t));
+    std::iota(vec.begin(), vec.end(), 0);
+    result &= reinterpret_cast<uintptr_t>(vec.data()) % kHugePageSize == 0;
+    result &= vec.back() == kTestAllocSize / sizeof(uint32_t) - 1;
+
+    // Growing past the threshold moves a small vector to huge pages
+    HugeVector<uint32_t> grown;
+    for (uint32_t i = 0; i < kTestAllocSize / sizeof(uint32_t); i++) {
+        grown.push_back(i);
+    }
+    result &= grown == vec;
+
+    HugeString str(kTestAllocSize, '1');
+    str[0] = '0';
+    result &= str.size() == kTestAllocSize && str.find('0') == 0 && str.rfind('0') == 0;
+    utils::Logger::DebugLog(LOCATION, "Mapped: " + std::to_string(MappedBytes()) + " B", debug);
+    return result;
+}
+
+}    // namespace test
+}    // namespace utils
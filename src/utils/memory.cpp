@@ -0,0 +1,343 @@
+/**
+ * @file memory.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-10
+ * @copyright Copyright (c) 2024
+ * @brief Memory monitor implementation.
+ */
+
+#include "memory.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+
+#include "logger.hpp"
+
+namespace {
+
+std::atomic<uint64_t> live_bytes{0};
+std::atomic<uint64_t> peak_bytes{0};
+std::atomic<uint64_t> alloc_count{0};
+std::atomic<uint64_t> free_count{0};
+
+// Read VmRSS and VmHWM (in kB) from /proc/self/status.
+void ReadProcStatus(uint64_t &rss_kb, uint64_t &peak_rss_kb) {
+    rss_kb      = 0;
+    peak_rss_kb = 0;
+    std::ifstream status("/proc/self/status");
+    std::string   line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            rss_kb = std::strtoull(line.c_str() + 6, nullptr, 10);
+        } else if (line.compare(0, 6, "VmHWM:") == 0) {
+            peak_rss_kb = std::strtoull(line.c_str() + 6, nullptr, 10);
+        }
+    }
+}
+
+// Open a counter of the data TLB read misses of the calling thread and its children (-1 if unavailable)
+int OpenTlbCounter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HW_CACHE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.inherit        = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+}    // namespace
+
+#ifdef MEMORY_TRACKING_ENABLED
+
+namespace {
+
+// Each block is prefixed by a header that stores the requested size.
+// The header keeps the alignment guaranteed by malloc (16 bytes on x86-64).
+constexpr std::size_t kHeaderSize = 16;
+
+// The offset of an over-aligned block from the start of its allocation (a multiple of the alignment that holds the header)
+std::size_t AlignedOffset(const std::align_val_t align) {
+    return std::max(static_cast<std::size_t>(align), kHeaderSize);
+}
+
+// Store the size in the header just before the block and count the allocation.
+void *Count(void *block, const std::size_t size) {
+    *reinterpret_cast<std::size_t *>(static_cast<char *>(block) - kHeaderSize) = size;
+    uint64_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return block;
+}
+
+// Uncount the block read from its header.
+void Uncount(void *block) {
+    live_bytes.fetch_sub(*reinterpret_cast<std::size_t *>(static_cast<char *>(block) - kHeaderSize), std::memory_order_relaxed);
+    free_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void *CountedAlloc(std::size_t size) {
+    void *p = std::malloc(size + kHeaderSize);
+    if (p == nullptr) {
+        return nullptr;
+    }
+    return Count(static_cast<char *>(p) + kHeaderSize, size);
+}
+
+void CountedFree(void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    Uncount(ptr);
+    std::free(static_cast<char *>(ptr) - kHeaderSize);
+}
+
+void *CountedAlignedAlloc(std::size_t size, const std::align_val_t align) {
+    std::size_t alignment = static_cast<std::size_t>(align);
+    std::size_t offset    = AlignedOffset(align);
+    // aligned_alloc takes a size that is a multiple of the alignment
+    void *p = std::aligned_alloc(alignment, (offset + size + alignment - 1) / alignment * alignment);
+    if (p == nullptr) {
+        return nullptr;
+    }
+    return Count(static_cast<char *>(p) + offset, size);
+}
+
+void CountedAlignedFree(void *ptr, const std::align_val_t align) {
+    if (ptr == nullptr) {
+        return;
+    }
+    Uncount(ptr);
+    std::free(static_cast<char *>(ptr) - AlignedOffset(align));
+}
+
+}    // namespace
+
+// Counting global allocator hook (including the over-aligned allocations of std::align_val_t).
+void *operator new(std::size_t size) {
+    void *p = CountedAlloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size) {
+    void *p = CountedAlloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return CountedAlloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return CountedAlloc(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    CountedFree(ptr);
+}
+
+void *operator new(std::size_t size, std::align_val_t align) {
+    void *p = CountedAlignedAlloc(size, align);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+    void *p = CountedAlignedAlloc(size, align);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return CountedAlignedAlloc(size, align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return CountedAlignedAlloc(size, align);
+}
+
+void operator delete(void *ptr, std::align_val_t align) noexcept {
+    CountedAlignedFree(ptr, align);
+}
+
+void operator delete[](void *ptr, std::align_val_t align) noexcept {
+    CountedAlignedFree(ptr, align);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t align) noexcept {
+    CountedAlignedFree(ptr, align);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t align) noexcept {
+    CountedAlignedFree(ptr, align);
+}
+
+void operator delete(void *ptr, std::align_val_t align, const std::nothrow_t &) noexcept {
+    CountedAlignedFree(ptr, align);
+}
+
+void operator delete[](void *ptr, std::align_val_t align, const std::nothrow_t &) noexcept {
+    CountedAlignedFree(ptr, align);
+}
+
+#endif
+
+namespace utils {
+
+uint32_t                                           MemoryMonitor::summary_interval_ms_ = 0;
+std::chrono::time_point<std::chrono::steady_clock> MemoryMonitor::last_summary_        = std::chrono::steady_clock::now();
+
+MemoryUsage::MemoryUsage()
+    : live_bytes(0), peak_bytes(0), alloc_count(0), free_count(0), rss_kb(0), peak_rss_kb(0) {
+}
+
+MemoryMonitor::MemoryMonitor() {
+}
+
+void MemoryMonitor::Start() {
+    ResetPeak();
+    this->start_ = GetCurrentUsage();
+}
+
+MemoryUsage MemoryMonitor::Print(const std::string &location, const std::string &message) {
+    MemoryUsage current = GetCurrentUsage();
+    MemoryUsage usage;
+    usage.live_bytes  = current.live_bytes - this->start_.live_bytes;
+    usage.peak_bytes  = current.peak_bytes - this->start_.live_bytes;
+    usage.alloc_count = current.alloc_count - this->start_.alloc_count;
+    usage.free_count  = current.free_count - this->start_.free_count;
+    usage.rss_kb      = current.rss_kb;
+    usage.peak_rss_kb = current.peak_rss_kb;
+
+    Logger::InfoLog(location, message + ",Memory," + std::to_string(usage.peak_bytes) + ",B," + std::to_string(usage.alloc_count) + ",allocs," + std::to_string(usage.peak_rss_kb) + ",kB");
+
+    return usage;
+}
+
+MemoryUsage MemoryMonitor::GetCurrentUsage() {
+    MemoryUsage usage;
+    usage.live_bytes  = live_bytes.load(std::memory_order_relaxed);
+    usage.peak_bytes  = peak_bytes.load(std::memory_order_relaxed);
+    usage.alloc_count = alloc_count.load(std::memory_order_relaxed);
+    usage.free_count  = free_count.load(std::memory_order_relaxed);
+    ReadProcStatus(usage.rss_kb, usage.peak_rss_kb);
+    return usage;
+}
+
+void MemoryMonitor::ResetPeak() {
+    peak_bytes.store(live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // Writing "5" to clear_refs resets VmHWM to the current RSS (Linux 4.0+).
+    // If the file cannot be written, VmHWM remains the peak since the process started.
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs) {
+        clear_refs << "5";
+    }
+}
+
+bool MemoryMonitor::IsTrackingEnabled() {
+#ifdef MEMORY_TRACKING_ENABLED
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MemoryMonitor::SetSummaryInterval(const uint32_t interval_ms) {
+    summary_interval_ms_ = interval_ms;
+    last_summary_        = std::chrono::steady_clock::now();
+}
+
+bool MemoryMonitor::PrintPeriodicSummary(const std::string &location) {
+    if (summary_interval_ms_ == 0) {
+        return false;
+    }
+    std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_summary_).count() < summary_interval_ms_) {
+        return false;
+    }
+    last_summary_ = now;
+
+    MemoryUsage usage = GetCurrentUsage();
+    Logger::InfoLog(location, "Memory summary,Live," + std::to_string(usage.live_bytes) + ",B,Peak," + std::to_string(usage.peak_bytes) + ",B,Allocs," + std::to_string(usage.alloc_count) + ",Frees," + std::to_string(usage.free_count) + ",RSS," + std::to_string(usage.rss_kb) + ",kB,Peak RSS," + std::to_string(usage.peak_rss_kb) + ",kB");
+    return true;
+}
+
+TlbMonitor::TlbMonitor()
+    : fd_(OpenTlbCounter()) {
+}
+
+TlbMonitor::~TlbMonitor() {
+    if (this->fd_ >= 0) {
+        close(this->fd_);
+    }
+}
+
+void TlbMonitor::Start() {
+    if (this->fd_ >= 0) {
+        ioctl(this->fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(this->fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+int64_t TlbMonitor::Print(const std::string &location, const std::string &message) {
+    int64_t misses = -1;
+    if (this->fd_ >= 0) {
+        uint64_t count = 0;
+        ioctl(this->fd_, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(this->fd_, &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count))) {
+            misses = static_cast<int64_t>(count);
+        }
+    }
+    Logger::InfoLog(location, message + ",TLB," + std::to_string(misses) + ",misses");
+    return misses;
+}
+
+bool TlbMonitor::IsAvailable() const {
+    return this->fd_ >= 0;
+}
+
+}    // namespace utils
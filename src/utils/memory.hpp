@@ -0,0 +1,173 @@
+/**
+ * @file memory.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-10
+ * @copyright Copyright (c) 2024
+ * @brief Memory monitor class.
+ */
+
+#ifndef UTILS_MEMORY_H_
+#define UTILS_MEMORY_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace utils {
+
+/**
+ * @struct MemoryUsage
+ * @brief A snapshot of the memory usage of the process.
+ *
+ * The allocation counters are only updated when the counting allocator hook is
+ * compiled in (`MEMORY_TRACKING_ENABLED`). The RSS values are read from `/proc/self/status`.
+ */
+struct MemoryUsage {
+    uint64_t live_bytes;  /**< Bytes currently allocated through operator new. */
+    uint64_t peak_bytes;  /**< Peak of live bytes since the last reset. */
+    uint64_t alloc_count; /**< Number of calls to operator new. */
+    uint64_t free_count;  /**< Number of calls to operator delete. */
+    uint64_t rss_kb;      /**< Resident set size (VmRSS) in kB. */
+    uint64_t peak_rss_kb; /**< Peak resident set size (VmHWM) in kB. */
+
+    /**
+     * @brief Default constructor for MemoryUsage.
+     */
+    MemoryUsage();
+};
+
+/**
+ * @class MemoryMonitor
+ * @brief A utility class for measuring the memory usage of a code segment.
+ *
+ * The `MemoryMonitor` class is used next to `ExecutionTimer`.
+ * `Start` records the current counters and resets the peak values,
+ * and `Print` logs the allocations, the peak live bytes and the peak RSS observed since `Start`.
+ *
+ * @note
+ * - The peak values are process-wide, so nested monitors reset the peak of the outer one.
+ * - Build with `MEMORY_TRACKING_ENABLED` (`make bench MEMORY_TRACKING=1`) to enable the allocation counters.
+ */
+class MemoryMonitor {
+public:
+    /**
+     * @brief Default constructor for the MemoryMonitor class.
+     */
+    MemoryMonitor();
+
+    /**
+     * @brief Record the current memory usage and reset the peak values.
+     */
+    void Start();
+
+    /**
+     * @brief Log the memory usage since the start.
+     *
+     * The log line has the form `message,Memory,<peak live>,B,<allocs>,allocs,<peak rss>,kB`.
+     *
+     * @param location The location of the caller.
+     * @param message The message to be logged.
+     * @return The memory usage since the start (counters are relative to `Start`).
+     */
+    MemoryUsage Print(const std::string &location, const std::string &message = "");
+
+    /**
+     * @brief Get the current memory usage of the process.
+     * @return The current memory usage.
+     */
+    static MemoryUsage GetCurrentUsage();
+
+    /**
+     * @brief Reset the peak live bytes and the peak RSS of the process.
+     */
+    static void ResetPeak();
+
+    /**
+     * @brief Check whether the counting allocator hook is compiled in.
+     * @return `true` if the allocation counters are available.
+     */
+    static bool IsTrackingEnabled();
+
+    /**
+     * @brief Set the interval of the periodic summary line.
+     * @param interval_ms The interval in milliseconds (0 disables the summary).
+     */
+    static void SetSummaryInterval(const uint32_t interval_ms);
+
+    /**
+     * @brief Log a summary line of the current memory usage if the summary interval has elapsed.
+     *
+     * Long-running loops call this method once per iteration.
+     *
+     * @param location The location of the caller.
+     * @return `true` if the summary line was logged.
+     */
+    static bool PrintPeriodicSummary(const std::string &location);
+
+private:
+    MemoryUsage start_; /**< The memory usage at the start. */
+
+    static uint32_t                                           summary_interval_ms_; /**< The interval of the periodic summary. */
+    static std::chrono::time_point<std::chrono::steady_clock> last_summary_;        /**< The time point of the last summary. */
+};
+
+/**
+ * @class TlbMonitor
+ * @brief A utility class for counting the data TLB misses of a code segment.
+ *
+ * The `TlbMonitor` class is used next to `MemoryMonitor` to compare 4 KiB pages with huge pages (see `HugePageAllocator`).
+ * The misses are counted by `perf_event_open` for the calling thread and the threads it creates after `Start`.
+ *
+ * @note
+ * - The counter is unavailable if `perf_event_paranoid` forbids it or in most containers; `Print` then logs `-1`.
+ */
+class TlbMonitor {
+public:
+    /**
+     * @brief Default constructor for the TlbMonitor class (opens the counter).
+     */
+    TlbMonitor();
+
+    /**
+     * @brief Destructor for the TlbMonitor class (closes the counter).
+     */
+    ~TlbMonitor();
+
+    TlbMonitor(const TlbMonitor &)            = delete;
+    TlbMonitor &operator=(const TlbMonitor &) = delete;
+
+    /**
+     * @brief Reset and enable the counter.
+     */
+    void Start();
+
+    /**
+     * @brief Log the data TLB misses since the start.
+     *
+     * The log line has the form `message,TLB,<misses>,misses`.
+     *
+     * @param location The location of the caller.
+     * @param message The message to be logged.
+     * @return The number of misses since the start (-1 if the counter is unavailable).
+     */
+    int64_t Print(const std::string &location, const std::string &message = "");
+
+    /**
+     * @brief Check whether the counter could be opened.
+     * @return `true` if the misses are counted.
+     */
+    bool IsAvailable() const;
+
+private:
+    int fd_; /**< The file descriptor of the counter (-1 if unavailable). */
+};
+
+namespace test {
+
+void Test_MemoryMonitor(const uint32_t mode, bool debug);
+
+}    // namespace test
+
+}    // namespace utils
+
+#endif    // UTILS_MEMORY_H_
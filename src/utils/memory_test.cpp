@@ -0,0 +1,115 @@
+/**
+ * @file memory_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-10
+ * @copyright Copyright (c) 2024
+ * @brief Memory monitor test implementation.
+ */
+
+#include "memory.hpp"
+
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "logger.hpp"
+#include "utils.hpp"
+
+namespace {
+
+constexpr uint32_t kTestAllocSize = 1 << 24;    // 16 MiB
+
+}    // namespace
+
+namespace utils {
+namespace test {
+
+bool Test_AllocationCounter(const bool debug);
+bool Test_PeakRss(const bool debug);
+bool Test_TlbMonitor(const bool debug);
+
+void Test_MemoryMonitor(const uint32_t mode, bool debug) {
+    std::vector<std::string> modes         = {"Memory monitor unit tests", "Allocation counter", "Peak RSS", "TLB monitor"};
+    uint32_t                 selected_mode = mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        debug = false;
+        utils::PrintTestResult("Test_AllocationCounter", Test_AllocationCounter(debug));
+        utils::PrintTestResult("Test_PeakRss", Test_PeakRss(debug));
+        utils::PrintTestResult("Test_TlbMonitor", Test_TlbMonitor(debug));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_AllocationCounter", Test_AllocationCounter(debug));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_PeakRss", Test_PeakRss(debug));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_TlbMonitor", Test_TlbMonitor(debug));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_AllocationCounter(const bool debug) {
+    if (!MemoryMonitor::IsTrackingEnabled()) {
+        utils::Logger::DebugLog(LOCATION, "Allocation counter is disabled (MEMORY_TRACKING_ENABLED is not defined)", debug);
+        return true;
+    }
+
+    MemoryMonitor monitor;
+    monitor.Start();
+    {
+        std::vector<uint32_t> vec(kTestAllocSize / sizeof(uint32_t));
+        vec[0] = 1;
+    }
+    MemoryUsage usage = monitor.Print(LOCATION, "Test_AllocationCounter");
+    utils::Logger::DebugLog(LOCATION, "Peak: " + std::to_string(usage.peak_bytes) + ", Live: " + std::to_string(usage.live_bytes), debug);
+
+    // The vector is freed at the end of the scope, so only the peak keeps its size.
+    bool result = usage.peak_bytes >= kTestAllocSize && usage.alloc_count >= 1 && usage.free_count >= 1 && usage.live_bytes < kTestAllocSize;
+
+    // The over-aligned allocations (e.g. the small blocks of HugePageAllocator) are counted as well
+    monitor.Start();
+    void *aligned = ::operator new(kTestAllocSize, std::align_val_t(4096));
+    result &= reinterpret_cast<uintptr_t>(aligned) % 4096 == 0;
+    ::operator delete(aligned, std::align_val_t(4096));
+    usage = monitor.Print(LOCATION, "Test_AllocationCounter (aligned)");
+    result &= usage.peak_bytes >= kTestAllocSize && usage.live_bytes < kTestAllocSize;
+    return result;
+}
+
+bool Test_PeakRss(const bool debug) {
+    MemoryMonitor monitor;
+    monitor.Start();
+    std::vector<uint8_t> vec(kTestAllocSize);
+    for (uint32_t i = 0; i < kTestAllocSize; i += 4096) {
+        vec[i] = 1;    // Touch every page
+    }
+    MemoryUsage usage = monitor.Print(LOCATION, "Test_PeakRss");
+    utils::Logger::DebugLog(LOCATION, "RSS: " + std::to_string(usage.rss_kb) + " kB, Peak RSS: " + std::to_string(usage.peak_rss_kb) + " kB", debug);
+
+    return usage.peak_rss_kb >= kTestAllocSize / 1024 && usage.peak_rss_kb >= usage.rss_kb;
+}
+
+bool Test_TlbMonitor(const bool debug) {
+    TlbMonitor monitor;
+    if (!monitor.IsAvailable()) {
+        utils::Logger::DebugLog(LOCATION, "TLB monitor is disabled (perf_event_open is not permitted)", debug);
+        return monitor.Print(LOCATION, "Test_TlbMonitor") == -1;
+    }
+
+    monitor.Start();
+    std::vector<uint8_t> vec(kTestAllocSize);
+    for (uint32_t i = 0; i < kTestAllocSize; i += 4096) {
+        vec[i] = 1;    // Touch every page
+    }
+    int64_t misses = monitor.Print(LOCATION, "Test_TlbMonitor");
+    utils::Logger::DebugLog(LOCATION, "Misses: " + std::to_string(misses), debug);
+
+    return misses >= 0;
+}
+
+}    // namespace test
+}    // namespace utils
@@ -0,0 +1,148 @@
+/**
+ * @file metrics.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-12
+ * @copyright Copyright (c) 2024
+ * @brief Metrics registry implementation.
+ */
+
+#include "metrics.hpp"
+
+#include <sstream>
+
+namespace {
+
+std::string FormatDouble(const double value) {
+    std::ostringstream oss;
+    oss.precision(17);
+    oss << value;
+    return oss.str();
+}
+
+}    // namespace
+
+namespace utils {
+
+Counter::Counter()
+    : value_(0) {
+}
+
+Gauge::Gauge()
+    : value_(0) {
+}
+
+Histogram::Histogram(const std::vector<double> &bounds)
+    : bounds_(bounds), buckets_(new std::atomic<uint64_t>[bounds.size() + 1]), count_(0), sum_(0.0) {
+    for (size_t i = 0; i < bounds.size() + 1; i++) {
+        this->buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::Observe(const double value) {
+    size_t i = 0;
+    while (i < this->bounds_.size() && value > this->bounds_[i]) {
+        i++;
+    }
+    this->buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    this->count_.fetch_add(1, std::memory_order_relaxed);
+    double sum = this->sum_.load(std::memory_order_relaxed);
+    while (!this->sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+    }
+}
+
+const std::vector<double> &Histogram::GetBounds() const {
+    return this->bounds_;
+}
+
+std::vector<uint64_t> Histogram::GetCumulativeCounts() const {
+    std::vector<uint64_t> counts(this->bounds_.size() + 1);
+    uint64_t              total = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        total += this->buckets_[i].load(std::memory_order_relaxed);
+        counts[i] = total;
+    }
+    return counts;
+}
+
+uint64_t Histogram::GetCount() const {
+    return this->count_.load(std::memory_order_relaxed);
+}
+
+double Histogram::GetSum() const {
+    return this->sum_.load(std::memory_order_relaxed);
+}
+
+HistogramTimer::HistogramTimer(Histogram &histogram)
+    : histogram_(histogram), start_(std::chrono::steady_clock::now()) {
+}
+
+HistogramTimer::~HistogramTimer() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - this->start_;
+    this->histogram_.Observe(elapsed.count());
+}
+
+MetricsRegistry &MetricsRegistry::GetInstance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+Counter &MetricsRegistry::GetCounter(const std::string &name, const std::string &help) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    std::unique_ptr<Counter>   &counter = this->counters_[name];
+    if (!counter) {
+        counter           = std::make_unique<Counter>();
+        this->help_[name] = help;
+    }
+    return *counter;
+}
+
+Gauge &MetricsRegistry::GetGauge(const std::string &name, const std::string &help) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    std::unique_ptr<Gauge>     &gauge = this->gauges_[name];
+    if (!gauge) {
+        gauge             = std::make_unique<Gauge>();
+        this->help_[name] = help;
+    }
+    return *gauge;
+}
+
+Histogram &MetricsRegistry::GetHistogram(const std::string &name, const std::string &help, const std::vector<double> &bounds) {
+    std::lock_guard<std::mutex>  lock(this->mutex_);
+    std::unique_ptr<Histogram> &histogram = this->histograms_[name];
+    if (!histogram) {
+        histogram         = std::make_unique<Histogram>(bounds);
+        this->help_[name] = help;
+    }
+    return *histogram;
+}
+
+std::string MetricsRegistry::ExportPrometheusText() const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    std::ostringstream          oss;
+
+    for (const auto &counter : this->counters_) {
+        oss << "# HELP " << counter.first << " " << this->help_.at(counter.first) << "\n";
+        oss << "# TYPE " << counter.first << " counter\n";
+        oss << counter.first << " " << counter.second->Value() << "\n";
+    }
+    for (const auto &gauge : this->gauges_) {
+        oss << "# HELP " << gauge.first << " " << this->help_.at(gauge.first) << "\n";
+        oss << "# TYPE " << gauge.first << " gauge\n";
+        oss << gauge.first << " " << gauge.second->Value() << "\n";
+    }
+    for (const auto &histogram : this->histograms_) {
+        const std::vector<double> &bounds = histogram.second->GetBounds();
+        std::vector<uint64_t>      counts = histogram.second->GetCumulativeCounts();
+        oss << "# HELP " << histogram.first << " " << this->help_.at(histogram.first) << "\n";
+        oss << "# TYPE " << histogram.first << " histogram\n";
+        for (size_t i = 0; i < bounds.size(); i++) {
+            oss << histogram.first << "_bucket{le=\"" << FormatDouble(bounds[i]) << "\"} " << counts[i] << "\n";
+        }
+        oss << histogram.first << "_bucket{le=\"+Inf\"} " << counts.back() << "\n";
+        oss << histogram.first << "_sum " << FormatDouble(histogram.second->GetSum()) << "\n";
+        oss << histogram.first << "_count " << histogram.second->GetCount() << "\n";
+    }
+    return oss.str();
+}
+
+}    // namespace utils
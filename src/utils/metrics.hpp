@@ -0,0 +1,226 @@
+/**
+ * @file metrics.hpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-12
+ * @copyright Copyright (c) 2024
+ * @brief Metrics registry class.
+ */
+
+#ifndef UTILS_METRICS_H_
+#define UTILS_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+/**
+ * @brief Default histogram buckets for latencies (in seconds).
+ */
+const std::vector<double> kDefaultLatencyBuckets = {0.00001, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0, 10.0};
+
+/**
+ * @class Counter
+ * @brief A monotonically increasing counter (lock-free).
+ */
+class Counter {
+public:
+    Counter();
+
+    /**
+     * @brief Increase the counter.
+     * @param value The value to be added.
+     */
+    void Increment(const uint64_t value = 1) {
+        this->value_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the current value of the counter.
+     * @return The current value.
+     */
+    uint64_t Value() const {
+        return this->value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value_; /**< The value of the counter. */
+};
+
+/**
+ * @class Gauge
+ * @brief A value that can go up and down (lock-free).
+ */
+class Gauge {
+public:
+    Gauge();
+
+    /**
+     * @brief Set the gauge to the given value.
+     * @param value The new value.
+     */
+    void Set(const int64_t value) {
+        this->value_.store(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Add the given value to the gauge.
+     * @param value The value to be added (may be negative).
+     */
+    void Add(const int64_t value) {
+        this->value_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the current value of the gauge.
+     * @return The current value.
+     */
+    int64_t Value() const {
+        return this->value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> value_; /**< The value of the gauge. */
+};
+
+/**
+ * @class Histogram
+ * @brief A histogram with fixed upper bounds (lock-free).
+ */
+class Histogram {
+public:
+    /**
+     * @brief Constructor for Histogram.
+     * @param bounds The upper bounds of the buckets in ascending order.
+     */
+    Histogram(const std::vector<double> &bounds);
+
+    /**
+     * @brief Record an observation.
+     * @param value The observed value.
+     */
+    void Observe(const double value);
+
+    /**
+     * @brief Get the upper bounds of the buckets.
+     * @return The upper bounds.
+     */
+    const std::vector<double> &GetBounds() const;
+
+    /**
+     * @brief Get the cumulative count of the observations in each bucket.
+     * @return The cumulative counts (the last element is the `+Inf` bucket).
+     */
+    std::vector<uint64_t> GetCumulativeCounts() const;
+
+    /**
+     * @brief Get the total number of observations.
+     * @return The number of observations.
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * @brief Get the sum of the observations.
+     * @return The sum of the observations.
+     */
+    double GetSum() const;
+
+private:
+    const std::vector<double>                bounds_;  /**< The upper bounds of the buckets. */
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_; /**< Non-cumulative counts (size: bounds + 1). */
+    std::atomic<uint64_t>                    count_;   /**< The number of observations. */
+    std::atomic<double>                      sum_;     /**< The sum of the observations. */
+};
+
+/**
+ * @class HistogramTimer
+ * @brief Record the elapsed time (in seconds) of a scope to a histogram.
+ *
+ * USEAGE:
+ * utils::HistogramTimer latency(histogram);    // Observed when leaving the scope
+ */
+class HistogramTimer {
+public:
+    HistogramTimer(Histogram &histogram);
+    ~HistogramTimer();
+
+    HistogramTimer(const HistogramTimer &)            = delete;
+    HistogramTimer &operator=(const HistogramTimer &) = delete;
+
+private:
+    Histogram                                         &histogram_; /**< The histogram to be recorded. */
+    std::chrono::time_point<std::chrono::steady_clock> start_;     /**< The start time point. */
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief A process-wide registry of counters, gauges and histograms.
+ *
+ * Registration takes a lock, while updating a metric is lock-free.
+ * Instrumented code keeps a reference to the metric, e.g.
+ * `static utils::Counter &counter = utils::MetricsRegistry::GetInstance().GetCounter("name", "help");`
+ */
+class MetricsRegistry {
+public:
+    /**
+     * @brief Get the process-wide instance.
+     * @return The registry.
+     */
+    static MetricsRegistry &GetInstance();
+
+    /**
+     * @brief Get the counter with the given name, registering it if needed.
+     * @param name The metric name.
+     * @param help The description of the metric.
+     * @return The counter.
+     */
+    Counter &GetCounter(const std::string &name, const std::string &help);
+
+    /**
+     * @brief Get the gauge with the given name, registering it if needed.
+     * @param name The metric name.
+     * @param help The description of the metric.
+     * @return The gauge.
+     */
+    Gauge &GetGauge(const std::string &name, const std::string &help);
+
+    /**
+     * @brief Get the histogram with the given name, registering it if needed.
+     * @param name The metric name.
+     * @param help The description of the metric.
+     * @param bounds The upper bounds of the buckets (used only at registration).
+     * @return The histogram.
+     */
+    Histogram &GetHistogram(const std::string &name, const std::string &help, const std::vector<double> &bounds = kDefaultLatencyBuckets);
+
+    /**
+     * @brief Export all metrics in the Prometheus text exposition format (version 0.0.4).
+     * @return The metrics as a string.
+     */
+    std::string ExportPrometheusText() const;
+
+private:
+    MetricsRegistry() = default;
+
+    mutable std::mutex                                mutex_;      /**< Lock for registration and export. */
+    std::map<std::string, std::string>                help_;       /**< Description of each metric. */
+    std::map<std::string, std::unique_ptr<Counter>>   counters_;   /**< Registered counters. */
+    std::map<std::string, std::unique_ptr<Gauge>>     gauges_;     /**< Registered gauges. */
+    std::map<std::string, std::unique_ptr<Histogram>> histograms_; /**< Registered histograms. */
+};
+
+namespace test {
+
+void Test_Metrics(const uint32_t mode, bool debug);
+
+}    // namespace test
+
+}    // namespace utils
+
+#endif    // UTILS_METRICS_H_
@@ -0,0 +1,108 @@
+/**
+ * @file metrics_test.cpp
+ * @author tomo-uchiyama@moegi.waseda.jp
+ * @date 2024-06-12
+ * @copyright Copyright (c) 2024
+ * @brief Metrics registry test implementation.
+ */
+
+#include "metrics.hpp"
+
+#include <thread>
+
+#include "logger.hpp"
+#include "utils.hpp"
+
+namespace {
+
+constexpr uint32_t kNumThreads    = 4;
+constexpr uint32_t kNumIncrements = 100000;
+
+}    // namespace
+
+namespace utils {
+namespace test {
+
+bool Test_Counter(const bool debug);
+bool Test_Histogram(const bool debug);
+bool Test_PrometheusText(const bool debug);
+
+void Test_Metrics(const uint32_t mode, bool debug) {
+    std::vector<std::string> modes         = {"Metrics unit tests", "Counter", "Histogram", "Prometheus text"};
+    uint32_t                 selected_mode = mode;
+    if (selected_mode < 1 || selected_mode > modes.size()) {
+        utils::OptionHelpMessage(LOCATION, modes);
+        exit(EXIT_FAILURE);
+    }
+
+    utils::PrintText(utils::Logger::StrWithSep(modes[selected_mode - 1]));
+    if (selected_mode == 1) {
+        debug = false;
+        utils::PrintTestResult("Test_Counter", Test_Counter(debug));
+        utils::PrintTestResult("Test_Histogram", Test_Histogram(debug));
+        utils::PrintTestResult("Test_PrometheusText", Test_PrometheusText(debug));
+    } else if (selected_mode == 2) {
+        utils::PrintTestResult("Test_Counter", Test_Counter(debug));
+    } else if (selected_mode == 3) {
+        utils::PrintTestResult("Test_Histogram", Test_Histogram(debug));
+    } else if (selected_mode == 4) {
+        utils::PrintTestResult("Test_PrometheusText", Test_PrometheusText(debug));
+    }
+    utils::PrintText(utils::kDash);
+}
+
+bool Test_Counter(const bool debug) {
+    Counter &counter = MetricsRegistry::GetInstance().GetCounter("test_counter_total", "Counter for Test_Counter.");
+    uint64_t start   = counter.Value();
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < kNumThreads; t++) {
+        threads.emplace_back([&counter]() {
+            for (uint32_t i = 0; i < kNumIncrements; i++) {
+                counter.Increment();
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    uint64_t diff = counter.Value() - start;
+    utils::Logger::DebugLog(LOCATION, "Counter: " + std::to_string(diff), debug);
+
+    // The same name returns the same counter.
+    Counter &same = MetricsRegistry::GetInstance().GetCounter("test_counter_total", "Counter for Test_Counter.");
+    return diff == static_cast<uint64_t>(kNumThreads) * kNumIncrements && &same == &counter;
+}
+
+bool Test_Histogram(const bool debug) {
+    Histogram histogram({1.0, 2.0, 4.0});
+    histogram.Observe(0.5);
+    histogram.Observe(1.0);
+    histogram.Observe(3.0);
+    histogram.Observe(8.0);
+
+    std::vector<uint64_t> counts = histogram.GetCumulativeCounts();
+    utils::Logger::DebugLog(LOCATION, "Buckets: " + utils::VectorToStr(counts), debug);
+    utils::Logger::DebugLog(LOCATION, "Sum: " + std::to_string(histogram.GetSum()), debug);
+
+    return counts == std::vector<uint64_t>({2, 2, 3, 4}) && histogram.GetCount() == 4 && histogram.GetSum() == 12.5;
+}
+
+bool Test_PrometheusText(const bool debug) {
+    MetricsRegistry &registry = MetricsRegistry::GetInstance();
+    registry.GetCounter("test_text_total", "Counter for Test_PrometheusText.").Increment(3);
+    registry.GetGauge("test_text_gauge", "Gauge for Test_PrometheusText.").Set(-7);
+    registry.GetHistogram("test_text_seconds", "Histogram for Test_PrometheusText.", {0.5}).Observe(0.25);
+
+    std::string text = registry.ExportPrometheusText();
+    utils::Logger::DebugLog(LOCATION, "Text:\n" + text, debug);
+
+    return text.find("# TYPE test_text_total counter\ntest_text_total 3\n") != std::string::npos &&
+           text.find("# TYPE test_text_gauge gauge\ntest_text_gauge -7\n") != std::string::npos &&
+           text.find("test_text_seconds_bucket{le=\"0.5\"} 1\n") != std::string::npos &&
+           text.find("test_text_seconds_bucket{le=\"+Inf\"} 1\n") != std::string::npos &&
+           text.find("test_text_seconds_sum 0.25\ntest_text_seconds_count 1\n") != std::string::npos;
+}
+
+}    // namespace test
+}    // namespace utils
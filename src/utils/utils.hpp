@@ -98,12 +98,13 @@ std::string ArrayToStr(const std::array<T, N> &array, const std::string &del = "
  * with the specified delimiter 'delimiter' between elements.
  *
  * @tparam T The type of elements in the vector. Default is uint32_t.
+ * @tparam Allocator The allocator of the vector (e.g. utils::HugePageAllocator).
  * @param vec The std::vector to be converted to a string.
  * @param del The delimiter string used to separate elements in the output string.
  * @return A string representation of the std::vector elements separated by 'delimiter'.
  */
-template <typename T = uint32_t>
-std::string VectorToStr(const std::vector<T> &vec, const std::string &del = " ") {
+template <typename T = uint32_t, typename Allocator = std::allocator<T>>
+std::string VectorToStr(const std::vector<T, Allocator> &vec, const std::string &del = " ") {
     std::stringstream ss;
     for (std::size_t i = 0; i < vec.size(); i++) {
         ss << vec[i];